@@ -0,0 +1,152 @@
+#!/usr/bin/env python3
+"""
+Compare the server's I/O backends side by side.
+
+For each backend the server is started from a scratch directory holding
+config/aionic.conf plus an AIONIC_ENV overlay that sets io_backend, and
+GET /health is driven over keep-alive connections. wrk is used when it is
+installed; otherwise a threaded Python client does the same (with lower
+absolute numbers, so compare backends within one run only).
+
+Usage: benchmark.py [--connections N] [--duration S] [--port P] [backend ...]
+"""
+
+import argparse
+import os
+import shutil
+import socket
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+BINARY = os.path.join(ROOT, "bin", "aionic")
+BACKENDS = ["epoll", "io_uring"]
+REQUEST = b"GET /health HTTP/1.1\r\nHost: localhost\r\nConnection: keep-alive\r\n\r\n"
+
+
+def wait_for_port(port, timeout=10.0):
+    deadline = time.time() + timeout
+    while time.time() < deadline:
+        try:
+            with socket.create_connection(("127.0.0.1", port), timeout=0.5):
+                return True
+        except OSError:
+            time.sleep(0.1)
+    return False
+
+
+def start_server(workdir, backend, port):
+    config_dir = os.path.join(workdir, "config")
+    os.makedirs(config_dir, exist_ok=True)
+    shutil.copy(os.path.join(ROOT, "config", "aionic.conf"), config_dir)
+    with open(os.path.join(config_dir, "bench.conf"), "w") as f:
+        f.write(f"port = {port}\nio_backend = {backend}\n")
+
+    env = dict(os.environ, AIONIC_ENV="bench")
+    log = open(os.path.join(workdir, f"{backend}.log"), "w")
+    server = subprocess.Popen([BINARY], cwd=workdir, env=env, stdout=log, stderr=subprocess.STDOUT)
+    if not wait_for_port(port):
+        server.kill()
+        server.wait()
+        sys.exit(f"{backend}: server did not start, see {log.name}")
+    return server
+
+
+def stop_server(server):
+    server.terminate()
+    try:
+        server.wait(timeout=10)
+    except subprocess.TimeoutExpired:
+        server.kill()
+        server.wait()
+
+
+def run_wrk(port, connections, duration):
+    threads = min(connections, os.cpu_count() or 1)
+    out = subprocess.run(["wrk", "-t", str(threads), "-c", str(connections), "-d", f"{duration}s",
+                          f"http://127.0.0.1:{port}/health"],
+                         capture_output=True, text=True, check=True).stdout
+    for line in out.splitlines():
+        if line.startswith("Requests/sec:"):
+            return float(line.split(":")[1])
+    return 0.0
+
+
+def client(port, stop, counts, index):
+    sock = socket.create_connection(("127.0.0.1", port))
+    sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+    pending = b""
+    done = 0
+    try:
+        while not stop.is_set():
+            sock.sendall(REQUEST)
+            # One response per request; the body length comes from Content-Length
+            while True:
+                end = pending.find(b"\r\n\r\n")
+                if end >= 0:
+                    length = 0
+                    for line in pending[:end].split(b"\r\n"):
+                        if line.lower().startswith(b"content-length:"):
+                            length = int(line.split(b":")[1])
+                    if len(pending) >= end + 4 + length:
+                        pending = pending[end + 4 + length:]
+                        break
+                data = sock.recv(65536)
+                if not data:
+                    return
+                pending += data
+            done += 1
+    finally:
+        counts[index] = done
+        sock.close()
+
+
+def run_python(port, connections, duration):
+    stop = threading.Event()
+    counts = [0] * connections
+    threads = [threading.Thread(target=client, args=(port, stop, counts, i)) for i in range(connections)]
+    for thread in threads:
+        thread.start()
+    time.sleep(duration)
+    stop.set()
+    for thread in threads:
+        thread.join()
+    return sum(counts) / duration
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("--connections", type=int, default=100)
+    parser.add_argument("--duration", type=int, default=10)
+    parser.add_argument("--port", type=int, default=18080)
+    parser.add_argument("backends", nargs="*", default=BACKENDS)
+    args = parser.parse_args()
+
+    if not os.path.exists(BINARY):
+        sys.exit(f"{BINARY} not found, run make first")
+    load = run_wrk if shutil.which("wrk") else run_python
+
+    results = []
+    for backend in args.backends:
+        with tempfile.TemporaryDirectory(prefix="aionic-bench-") as workdir:
+            server = start_server(workdir, backend, args.port)
+            try:
+                rate = load(args.port, args.connections, args.duration)
+            finally:
+                stop_server(server)
+            # The log says which backend actually ran (io_uring falls back to epoll)
+            with open(os.path.join(workdir, f"{backend}.log")) as f:
+                fell_back = backend != "epoll" and "using epoll" in f.read()
+        results.append((backend + (" (epoll fallback)" if fell_back else ""), rate))
+
+    print(f"{'backend':<28}{'req/s':>12}   ({args.connections} connections, {args.duration}s, "
+          f"{'wrk' if load is run_wrk else 'python client'})")
+    for backend, rate in results:
+        print(f"{backend:<28}{rate:>12.0f}")
+
+
+if __name__ == "__main__":
+    main()
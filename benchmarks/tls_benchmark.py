@@ -0,0 +1,192 @@
+#!/usr/bin/env python3
+"""
+Measure TLS handshakes and TLS throughput against a self-signed certificate.
+
+The server is started from a scratch directory holding config/aionic.conf plus
+an AIONIC_ENV overlay that enables the TLS listener with a certificate made by
+`openssl req`, and a static root with one large file. Reported:
+
+  full handshakes/s     new connection, no session to resume
+  resumed handshakes/s  new connection resuming the first session (ticket)
+  throughput MB/s       the large file over one keep-alive connection, over
+                        TLS and over plain HTTP for comparison
+
+The last line says whether the kernel did the record encryption (kTLS, which
+needs `modprobe tls`) or OpenSSL did it in user space.
+
+Usage: tls_benchmark.py [--duration S] [--size-mb N] [--port P] [--tls-port P]
+"""
+
+import argparse
+import os
+import shutil
+import socket
+import ssl
+import subprocess
+import sys
+import tempfile
+import time
+import urllib.request
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+BINARY = os.path.join(ROOT, "bin", "aionic")
+
+
+def wait_for_port(port, timeout=10.0):
+    deadline = time.time() + timeout
+    while time.time() < deadline:
+        try:
+            with socket.create_connection(("127.0.0.1", port), timeout=0.5):
+                return True
+        except OSError:
+            time.sleep(0.1)
+    return False
+
+
+def start_server(workdir, port, tls_port, size_mb):
+    config_dir = os.path.join(workdir, "config")
+    www = os.path.join(workdir, "www")
+    os.makedirs(config_dir, exist_ok=True)
+    os.makedirs(www, exist_ok=True)
+    shutil.copy(os.path.join(ROOT, "config", "aionic.conf"), config_dir)
+
+    cert = os.path.join(config_dir, "bench.crt")
+    key = os.path.join(config_dir, "bench.key")
+    subprocess.run(["openssl", "req", "-x509", "-newkey", "rsa:2048", "-nodes", "-days", "1",
+                    "-subj", "/CN=localhost", "-keyout", key, "-out", cert],
+                   check=True, capture_output=True)
+    # The server drops privileges after start; the files only have to be readable before
+    with open(os.path.join(www, "large.bin"), "wb") as f:
+        f.write(os.urandom(1024 * 1024) * size_mb)
+
+    with open(os.path.join(config_dir, "bench.conf"), "w") as f:
+        f.write(f"port = {port}\ntls_port = {tls_port}\ntls_cert = {cert}\ntls_key = {key}\n"
+                f"static_root = {www}\n")
+
+    env = dict(os.environ, AIONIC_ENV="bench")
+    log = open(os.path.join(workdir, "server.log"), "w")
+    server = subprocess.Popen([BINARY], cwd=workdir, env=env, stdout=log, stderr=subprocess.STDOUT)
+    if not wait_for_port(port) or not wait_for_port(tls_port):
+        server.kill()
+        server.wait()
+        sys.exit(f"server did not start, see {log.name}")
+    return server
+
+
+def stop_server(server):
+    server.terminate()
+    try:
+        server.wait(timeout=10)
+    except subprocess.TimeoutExpired:
+        server.kill()
+        server.wait()
+
+
+def client_context():
+    context = ssl.SSLContext(ssl.PROTOCOL_TLS_CLIENT)
+    context.check_hostname = False
+    context.verify_mode = ssl.CERT_NONE
+    return context
+
+
+def handshake(context, port, session=None):
+    with socket.create_connection(("127.0.0.1", port)) as raw:
+        with context.wrap_socket(raw, session=session) as tls:
+            # A TLS 1.3 ticket arrives after the handshake; one round trip collects it
+            tls.sendall(b"GET /health HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n")
+            while tls.recv(65536):
+                pass
+            return tls.session, tls.session_reused
+
+
+def handshake_rate(port, duration, resume):
+    context = client_context()
+    session, _ = handshake(context, port)
+    done = reused = 0
+    deadline = time.time() + duration
+    while time.time() < deadline:
+        _, was_reused = handshake(context, port, session if resume else None)
+        done += 1
+        reused += was_reused
+    return done / duration, reused
+
+
+def read_response(sock):
+    """Read one response with a Content-Length body; returns the body length."""
+    pending = b""
+    while b"\r\n\r\n" not in pending:
+        data = sock.recv(65536)
+        if not data:
+            raise ConnectionError("connection closed before the headers")
+        pending += data
+    head, _, pending = pending.partition(b"\r\n\r\n")
+    length = 0
+    for line in head.split(b"\r\n"):
+        if line.lower().startswith(b"content-length:"):
+            length = int(line.split(b":")[1])
+    received = len(pending)
+    while received < length:
+        data = sock.recv(1 << 20)
+        if not data:
+            raise ConnectionError("connection closed mid-body")
+        received += len(data)
+    return length
+
+
+def throughput(port, duration, use_tls):
+    raw = socket.create_connection(("127.0.0.1", port))
+    sock = client_context().wrap_socket(raw) if use_tls else raw
+    request = b"GET /static/large.bin HTTP/1.1\r\nHost: localhost\r\nConnection: keep-alive\r\n\r\n"
+    total = 0
+    start = time.time()
+    try:
+        while time.time() - start < duration:
+            sock.sendall(request)
+            total += read_response(sock)
+    finally:
+        sock.close()
+    return total / (time.time() - start) / (1024 * 1024)
+
+
+def ktls_connections(port):
+    with urllib.request.urlopen(f"http://127.0.0.1:{port}/metrics") as response:
+        for line in response.read().decode().splitlines():
+            if line.startswith("aionic_tls_ktls_send_total"):
+                return int(float(line.split()[1]))
+    return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("--duration", type=int, default=5)
+    parser.add_argument("--size-mb", type=int, default=64)
+    parser.add_argument("--port", type=int, default=18080)
+    parser.add_argument("--tls-port", type=int, default=18443)
+    args = parser.parse_args()
+
+    if not os.path.exists(BINARY):
+        sys.exit(f"{BINARY} not found, run make first")
+    if not shutil.which("openssl"):
+        sys.exit("openssl is needed to make the certificate")
+
+    with tempfile.TemporaryDirectory(prefix="aionic-tls-bench-") as workdir:
+        os.chmod(workdir, 0o755)
+        server = start_server(workdir, args.port, args.tls_port, args.size_mb)
+        try:
+            full, _ = handshake_rate(args.tls_port, args.duration, resume=False)
+            resumed, reused = handshake_rate(args.tls_port, args.duration, resume=True)
+            tls_mb = throughput(args.tls_port, args.duration, use_tls=True)
+            plain_mb = throughput(args.port, args.duration, use_tls=False)
+            offloaded = ktls_connections(args.port)
+        finally:
+            stop_server(server)
+
+    print(f"{'full handshakes/s':<24}{full:>12.0f}")
+    print(f"{'resumed handshakes/s':<24}{resumed:>12.0f}   ({reused} resumed)")
+    print(f"{'TLS throughput MB/s':<24}{tls_mb:>12.0f}")
+    print(f"{'plain throughput MB/s':<24}{plain_mb:>12.0f}")
+    print("record encryption: " + ("kernel (kTLS)" if offloaded else "OpenSSL in user space (kTLS unavailable)"))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,96 @@
+#ifndef AIONIC_ACCESS_LOG_H
+#define AIONIC_ACCESS_LOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Per-request access records for billing.
+ *
+ * A request's record is filled on the worker thread and pushed into that
+ * thread's ring of fixed-size records; nothing else happens on the request
+ * path. A writer thread copies the rings into a memory-mapped segment file
+ * and starts a new segment when the current one is full, so page faults and
+ * disk writeback never land on a worker. A full ring drops the record and
+ * counts it.
+ *
+ * Segments are named "<prefix>-YYYYmmdd-HHMMSS-<n>.bin" and read offline
+ * with tools/access_log_convert.py. Layout (all integers little-endian):
+ *
+ *   AccessLogHeader   record_count is rewritten after every writer pass,
+ *                     so a segment left by a crash is still readable
+ *   AccessRecord x record_count
+ *
+ * Routes can be sampled: with a rate of 0.25, exactly every fourth request
+ * to the route on each thread is recorded. The rate is stored in the record
+ * so totals can be scaled back up.
+ */
+
+#define ACCESS_LOG_MAGIC "AIACCESS"
+#define ACCESS_LOG_VERSION 1
+
+#define ACCESS_FLAG_CACHE_HIT 0x1    // Answered from the prompt cache
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;       // sizeof(AccessRecord)
+    int64_t created_at;         // Unix seconds
+    uint64_t record_count;
+    uint8_t reserved[32];
+} AccessLogHeader;
+
+typedef struct {
+    uint64_t timestamp_us;      // Request start, Unix microseconds
+    uint32_t latency_us;        // recv() of the request to send() of the response
+    uint32_t upstream_us;       // Waiting for the AI backend, 0 if not called
+    uint32_t bytes_in;
+    uint32_t bytes_out;
+    uint32_t sample_ppm;        // Sampling rate in millionths, 1000000 when unsampled
+    uint16_t status;
+    uint16_t flags;             // ACCESS_FLAG_*
+    char ip[16];
+    char method[8];
+    char route[40];             // NUL-padded, truncated if longer
+    char model[32];             // Model that answered, empty if none
+} AccessRecord;
+
+/**
+ * Open the first segment and start the writer thread.
+ *
+ * @param prefix Path prefix of the segment files.
+ * @param segment_size Bytes per segment before rotating.
+ * @return 0 on success, -1 if the segment could not be created.
+ */
+int access_log_init(const char *prefix, size_t segment_size);
+
+// Stop the writer after it has written every queued record
+void access_log_cleanup(void);
+
+int access_log_is_enabled(void);
+
+/**
+ * Record `rate` (0 to 1) of the requests to `route`; a route ending in '*'
+ * matches by prefix. Set before the server starts; the first match wins.
+ *
+ * @return 0 on success, -1 for a bad rate or too many rules.
+ */
+int access_log_set_sample_rate(const char *route, double rate);
+
+// Start a request on the calling thread; a no-op when the log is off
+void access_log_request_begin(void);
+
+// Current time for an upstream start, 0 when no request is being recorded
+uint64_t access_log_now(void);
+
+// The model that served the request and how long the backend took since `start`
+void access_log_note_upstream(const char *model, uint64_t start, int cache_hit);
+
+// Finish the request; it is queued if its route's sampling keeps it
+void access_log_request_end(const char *ip, const char *method, const char *route,
+                            int status_code, size_t bytes_in, size_t bytes_out);
+
+// Records written to segments and records dropped because a ring was full
+void access_log_get_counts(uint64_t *written, uint64_t *dropped);
+
+#endif // AIONIC_ACCESS_LOG_H
@@ -0,0 +1,39 @@
+#ifndef AIONIC_AFFINITY_H
+#define AIONIC_AFFINITY_H
+
+/*
+ * Worker placement on CPUs and NUMA nodes.
+ *
+ * affinity_init() plans one CPU per worker from the CPUs the process may run
+ * on, taking CPUs from each NUMA node in turn so that every node gets workers
+ * before any node gets a second round. A worker pins itself with
+ * affinity_pin_worker() before it allocates anything: Linux places a page on
+ * the node of the CPU that first touches it, so the worker's arena, buffers
+ * and heap end up node-local without an explicit memory policy.
+ *
+ * affinity_steer() maps the CPU that received a connection's packets
+ * (SO_INCOMING_CPU) to the worker pinned there, or failing that to a worker on
+ * the same node, so softirq, worker and memory share a core or at least a node.
+ */
+
+/**
+ * Plan CPUs for `worker_count` workers. More workers than CPUs share CPUs.
+ *
+ * @return 0 on success, -1 if the CPU set cannot be read.
+ */
+int affinity_init(int worker_count);
+void affinity_cleanup(void);
+
+// Planned CPU of a worker, -1 without a plan
+int affinity_worker_cpu(int worker_id);
+
+// NUMA node of a CPU from sysfs, -1 when unknown
+int affinity_cpu_node(int cpu);
+
+// Pin the calling thread to the worker's CPU; 0 on success, -1 otherwise
+int affinity_pin_worker(int worker_id);
+
+// Worker for a connection whose packets arrive on `cpu`, -1 when none fits
+int affinity_steer(int cpu);
+
+#endif // AIONIC_AFFINITY_H
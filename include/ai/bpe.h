@@ -0,0 +1,70 @@
+#ifndef AIONIC_AI_BPE_H
+#define AIONIC_AI_BPE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Byte-level BPE, compatible with tiktoken rank files (cl100k_base, and
+ * Llama 3's tokenizer.model).
+ *
+ * The vocabulary is a binary file built offline by tools/build_bpe_vocab.py
+ * and memory-mapped read-only, so loading it costs no parsing and its pages
+ * are shared by every process that maps it. Token ids are tiktoken ranks;
+ * special tokens are not recognized (text is encoded as ordinary text).
+ *
+ * Text is first split into pieces with the cl100k pre-tokenizer pattern,
+ * classifying 64 bytes at a time with AVX2/SSE2. Pieces found whole in the
+ * vocabulary become one token; the rest are merged pair by pair, lowest rank
+ * first, with a priority queue. Bytes >= 0x80 are treated as letters, so
+ * ASCII text matches tiktoken exactly and other scripts stay close.
+ */
+
+#define BPE_FILE_MAGIC   "AIBPE\0\0\0"
+#define BPE_FILE_VERSION 1
+#define BPE_PATTERN_CL100K 1
+
+// On-disk header; all integers are little-endian
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t pattern;           // Pre-tokenizer, BPE_PATTERN_*
+    uint32_t token_count;       // Ranks 0 .. token_count - 1
+    uint32_t hash_slots;        // Power of two
+    uint64_t tokens_offset;     // token_count x {uint32 offset, uint32 length} into the byte blob
+    uint64_t hash_offset;       // hash_slots x uint32: rank + 1, 0 for an empty slot
+    uint64_t bytes_offset;      // Concatenated token bytes
+    uint64_t bytes_size;
+} BpeFileHeader;
+
+typedef struct BpeVocab BpeVocab;
+
+/**
+ * Called for each token in text order.
+ *
+ * @param offset Byte offset of the token in the encoded text.
+ * @return 0 to continue, non-zero to stop encoding.
+ */
+typedef int (*BpeEmit)(void *ctx, uint32_t rank, size_t offset, size_t length);
+
+/**
+ * Maps and validates a vocabulary file.
+ *
+ * @return 0 on success, -1 if the file is missing or malformed.
+ */
+int bpe_vocab_open(const char *path, BpeVocab **vocab);
+void bpe_vocab_close(BpeVocab *vocab);
+
+uint32_t bpe_vocab_size(const BpeVocab *vocab);
+
+// Bytes of a token (not NUL-terminated), or NULL for an unknown rank
+const uint8_t *bpe_token_bytes(const BpeVocab *vocab, uint32_t rank, size_t *length);
+
+/**
+ * Encodes `length` bytes of text. With a NULL `emit` only the tokens are counted.
+ *
+ * @return The number of tokens emitted, or -1 on allocation failure.
+ */
+long bpe_encode(const BpeVocab *vocab, const char *text, size_t length, BpeEmit emit, void *ctx);
+
+#endif // AIONIC_AI_BPE_H
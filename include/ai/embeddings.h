@@ -0,0 +1,55 @@
+#ifndef AIONIC_AI_EMBEDDINGS_H
+#define AIONIC_AI_EMBEDDINGS_H
+
+#include <stdint.h>
+
+/*
+ * Embedding micro-batcher.
+ *
+ * Concurrent /v1/embeddings requests for the same model are coalesced into
+ * one upstream call. The first request to arrive opens a batch and becomes
+ * its leader; requests arriving within the batch window join it. The leader
+ * sends the batch through the prompt router once the window has passed or
+ * the batch holds the maximum number of inputs, then hands every waiting
+ * request its own vectors.
+ */
+
+typedef struct {
+    char **vectors;                 // One raw JSON array per input, in input order
+    int count;
+    char model[64];                 // Model that produced the vectors (may be a fallback)
+} EmbeddingResult;
+
+typedef struct {
+    uint64_t requests;
+    uint64_t inputs;
+    uint64_t batches;               // Upstream calls
+    uint64_t failed_batches;
+} EmbeddingStats;
+
+/**
+ * Initializes the batcher.
+ *
+ * @param default_model Model used when a request does not name one.
+ * @param window_ms How long a batch waits for more requests (0 sends every request on its own).
+ * @param max_inputs Inputs that close a batch early.
+ * @return 0 on success, -1 on invalid arguments.
+ */
+int embeddings_init(const char *default_model, double window_ms, int max_inputs);
+
+/**
+ * Embeds `count` inputs, batched with concurrent requests for the same model.
+ * Blocks until the batch has been answered.
+ *
+ * @param model_name The embedding model, or NULL for the default.
+ * @param result Receives the vectors; release with embeddings_result_free().
+ *        Nothing needs to be released when the call fails.
+ * @return 0 on success, PROMPT_ROUTE_ERROR or PROMPT_ROUTE_UNAVAILABLE.
+ */
+int embeddings_create(const char *model_name, const char *const *inputs, int count, EmbeddingResult *result);
+void embeddings_result_free(EmbeddingResult *result);
+
+void embeddings_get_stats(EmbeddingStats *stats);
+void embeddings_cleanup(void);
+
+#endif // AIONIC_AI_EMBEDDINGS_H
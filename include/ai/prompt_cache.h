@@ -0,0 +1,82 @@
+#ifndef AIONIC_AI_PROMPT_CACHE_H
+#define AIONIC_AI_PROMPT_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "prompt_router.h"
+
+/*
+ * Near-duplicate prompt cache.
+ *
+ * Prompts are tokenized, lower-cased and cut into overlapping token pairs
+ * (shingles). A MinHash signature of the shingle set estimates the Jaccard
+ * similarity of two prompts, and an LSH index over bands of the signature
+ * finds candidate entries without comparing against every cached prompt.
+ * Prompts that differ only in whitespace or casing have identical sketches.
+ * Each changed token touches the two shingles it belongs to,
+ * so prompts of a few dozen words or more still clear the default threshold of 0.8.
+ */
+
+#define PROMPT_CACHE_HASHES 128     // MinHash functions per signature
+
+typedef struct {
+    uint32_t minhash[PROMPT_CACHE_HASHES];
+    uint32_t *shingles;             // Sorted, unique shingle hashes
+    int shingle_count;
+    uint64_t scope;                 // Route, model and max_tokens; entries only match their own scope
+    double threshold;               // Jaccard similarity required for a hit
+} PromptSketch;
+
+typedef struct {
+    uint64_t entries;
+    uint64_t lookups;
+    uint64_t hits;
+    uint64_t insertions;
+    uint64_t evictions;
+    uint64_t sampled;               // Hits re-checked against the exact shingle sets
+    uint64_t false_matches;         // Sampled hits whose exact similarity was below threshold
+} PromptCacheStats;
+
+/**
+ * Initializes the cache.
+ *
+ * @param capacity Maximum number of cached completions (oldest are evicted first).
+ * @param ttl_seconds Lifetime of an entry.
+ * @param default_threshold Jaccard threshold for routes without their own (0 disables them).
+ * @param verify_percent Share of hits re-checked with the exact Jaccard similarity.
+ * @return 0 on success, -1 on failure.
+ */
+int prompt_cache_init(int capacity, int ttl_seconds, double default_threshold, double verify_percent);
+
+/**
+ * Sets the Jaccard threshold of one route (0 disables caching for it).
+ *
+ * @return 0 on success, -1 on invalid arguments or when the route table is full.
+ */
+int prompt_cache_set_threshold(const char *route, double threshold);
+
+/**
+ * Computes the sketch of a chat request arriving on `route`.
+ *
+ * @return 0 on success, -1 if caching is disabled for the route or on failure.
+ *         A successful sketch must be released with prompt_cache_sketch_free().
+ */
+int prompt_cache_sketch(PromptSketch *sketch, const char *route, const PromptRequest *request);
+void prompt_cache_sketch_free(PromptSketch *sketch);
+
+/**
+ * Looks for a cached completion of a near-identical prompt.
+ *
+ * @param served_model Receives the model that produced the cached completion.
+ * @return 0 on a hit, -1 on a miss.
+ */
+int prompt_cache_lookup(const PromptSketch *sketch, char *response, size_t response_size,
+                        char *served_model, size_t served_model_size);
+
+// Cache the completion produced for the sketched prompt
+int prompt_cache_store(const PromptSketch *sketch, const char *response, const char *served_model);
+
+void prompt_cache_get_stats(PromptCacheStats *stats);
+void prompt_cache_cleanup(void);
+
+#endif // AIONIC_AI_PROMPT_CACHE_H
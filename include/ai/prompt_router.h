@@ -1,6 +1,52 @@
 #ifndef AIONIC_AI_PROMPT_ROUTER_H
 #define AIONIC_AI_PROMPT_ROUTER_H
 
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * A chat request as extracted from the client's JSON body.
+ * All strings are borrowed from the caller.
+ */
+typedef struct {
+    const char *prompt;      // User prompt (required)
+    const char *model_name;  // Requested model (NULL to use default)
+    int max_tokens;          // Completion limit (0 to use the model's default)
+    int prompt_tokens;       // Tokens in the prompt (0 when not counted)
+    int stream;              // Client asked for a streamed response
+} PromptRequest;
+
+// prompt_router_route_request() results besides 0
+#define PROMPT_ROUTE_ERROR        -1   // Unknown model, or every attempt failed
+#define PROMPT_ROUTE_UNAVAILABLE  -2   // Every model in the chain is open or disabled
+#define PROMPT_ROUTE_TOO_LONG     -3   // The prompt fills the requested model's context window
+
+/**
+ * Routing state of one model, as reported by prompt_router_get_model_stats().
+ */
+typedef struct {
+    char name[64];
+    char fallback[64];       // Empty when the model has no fallback
+    char breaker[16];        // "closed", "open" or "half_open"
+    int available;
+    double hedge_delay_ms;   // 0 until enough TTFT samples
+} ModelRouteInfo;
+
+/**
+ * Selection state of one upstream endpoint of a model, as reported by
+ * prompt_router_get_replica_stats().
+ */
+typedef struct {
+    char model[64];
+    char endpoint[256];
+    double ewma_ms;          // Decayed latency estimate
+    int inflight;            // Requests currently outstanding
+    int ejected;             // Out of rotation after repeated failures
+    uint64_t requests;
+    uint64_t failures;
+    uint64_t hedges;         // Hedged attempts sent to this replica
+} ReplicaStatsInfo;
+
 /**
  * Initializes the Prompt Router.
  * Loads default AI models and initializes the network library (libcurl).
@@ -10,7 +56,8 @@
 int prompt_router_init();
 
 /**
- * Adds a new AI model to the routing table.
+ * Adds a new AI model to the routing table, served by one replica.
+ * Fails if a model with the same name already exists.
  * 
  * @param name The name of the model (e.g., "gpt-3.5-turbo").
  * @param api_endpoint The full URL of the API (e.g., "https://api.openai.com/v1/...").
@@ -20,6 +67,18 @@ int prompt_router_init();
  */
 int prompt_router_add_model(const char *name, const char *api_endpoint, int max_tokens, float temperature);
 
+/**
+ * Adds another upstream endpoint serving an existing model.
+ * Each request goes to the cheaper of two randomly sampled replicas, by
+ * latency estimate times in-flight requests. A replica failing repeatedly
+ * is ejected and later probed with a single request before rejoining.
+ * 
+ * @param name The name of an existing model.
+ * @param api_endpoint The full URL of the additional endpoint.
+ * @return 0 on success, -1 if the model is unknown or on allocation failure.
+ */
+int prompt_router_add_replica(const char *name, const char *api_endpoint);
+
 /**
  * Removes an AI model from the routing table by name.
  * 
@@ -48,6 +107,37 @@ int prompt_router_set_default_model(const char *name);
  */
 int prompt_router_route(const char *prompt, const char *model_name, char *response, size_t response_size);
 
+/**
+ * Routes a parsed chat request, forwarding its options (e.g. max_tokens) upstream.
+ * Models whose circuit breaker is open are skipped without contacting them,
+ * and a failed model hands the request to its fallback, so the request may
+ * be served by a different model than the one asked for.
+ * 
+ * @param request The parsed request.
+ * @param response Buffer to store the AI's response (or the error).
+ * @param response_size Size of the response buffer.
+ * @param served_model Optional; set to the name of the model that answered.
+ *        Valid until the calling thread's next RCU quiescent state.
+ * @return 0 on success, PROMPT_ROUTE_ERROR or PROMPT_ROUTE_UNAVAILABLE.
+ */
+int prompt_router_route_request(const PromptRequest *request, char *response, size_t response_size,
+                                const char **served_model);
+
+/**
+ * Sends embedding inputs to the model in a single upstream call, with the
+ * same replica selection, hedging, circuit breaking and fallback as chat
+ * requests. The payload is {"model": ..., "input": [...]} (OpenAI format).
+ * 
+ * @param model_name The embedding model to use.
+ * @param inputs The texts to embed.
+ * @param count Number of inputs.
+ * @param body Receives the raw upstream JSON answer on success; the caller frees it.
+ * @param served_model Optional; as for prompt_router_route_request().
+ * @return 0 on success, PROMPT_ROUTE_ERROR or PROMPT_ROUTE_UNAVAILABLE.
+ */
+int prompt_router_embed(const char *model_name, const char *const *inputs, int count,
+                        char **body, const char **served_model);
+
 /**
  * Retrieves a list of names of all available AI models.
  * The caller is responsible for freeing the allocated memory.
@@ -58,6 +148,75 @@ int prompt_router_route(const char *prompt, const char *model_name, char *respon
  */
 int prompt_router_get_models(char ***model_names, int *count);
 
+/**
+ * Configures hedged requests. When an attempt has produced no byte after the
+ * given percentile of the model's recent time-to-first-byte, a second attempt
+ * goes to another replica; the first successful response wins and the other
+ * transfer is cancelled. At most `budget_percent` of requests are hedged.
+ * 
+ * @param name The model to configure, or NULL for every model.
+ * @param percentile TTFT percentile that triggers the hedge (0 disables hedging).
+ * @param budget_percent Extra attempts allowed, as a percentage of requests.
+ * @return 0 on success, -1 if no model matched or the values are out of range.
+ */
+int prompt_router_set_hedging(const char *name, double percentile, double budget_percent);
+
+/**
+ * Sets the model that takes over requests while `name` is failing or its
+ * circuit breaker is open. Chains (70b -> 8b -> ...) are followed for up to
+ * four models.
+ * 
+ * @param name The model to configure.
+ * @param fallback An existing model, or NULL to remove the fallback.
+ * @return 0 on success, -1 if either model is unknown.
+ */
+int prompt_router_set_fallback(const char *name, const char *fallback);
+
+/**
+ * Sets a model's context window. Completions are then clamped to the room the
+ * prompt leaves, and prompts that leave none are rejected before any
+ * upstream call.
+ * 
+ * @param name The model to configure.
+ * @param context_tokens Prompt plus completion limit, 0 when unknown.
+ * @return 0 on success, -1 if the model is unknown.
+ */
+int prompt_router_set_context(const char *name, int context_tokens);
+
+/**
+ * Configures circuit breakers. A closed breaker opens when at least
+ * `failure_rate` percent of the model's last 32 calls failed or took longer
+ * than `slow_ms`. After `open_ms` it lets three trial requests through and
+ * closes if all of them succeed.
+ * 
+ * @param name The model to configure, or NULL for every model.
+ * @return 0 on success, -1 if no model matched or the values are out of range.
+ */
+int prompt_router_set_breaker(const char *name, double failure_rate, int slow_ms, int open_ms);
+
+/**
+ * Limits each upstream attempt, connection included, to `timeout_ms`. An
+ * attempt that runs out fails like a transport error, so a replica that
+ * never answers is ejected and counts against the model's breaker.
+ * 
+ * @return 0 on success, -1 if the timeout is not positive.
+ */
+int prompt_router_set_request_timeout(int timeout_ms);
+
+/**
+ * Copies the routing state of up to `max` models into `out`.
+ * 
+ * @return The total number of models.
+ */
+int prompt_router_get_model_stats(ModelRouteInfo *out, int max);
+
+/**
+ * Copies the state of up to `max` replicas, across all models, into `out`.
+ * 
+ * @return The total number of replicas.
+ */
+int prompt_router_get_replica_stats(ReplicaStatsInfo *out, int max);
+
 /**
  * Sets the availability status of a specific model.
  * 
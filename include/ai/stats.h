@@ -4,6 +4,45 @@
 #include <stdint.h>
 #include <time.h>
 
+/*
+ * Request statistics per model and per route.
+ *
+ * Every thread records into its own shard of counters and log-bucketed
+ * latency histograms (32 sub-buckets per power of two, about 3% relative
+ * error, microseconds up to 19 hours), so recording takes no lock and
+ * touches no shared cache line. Readers merge the shards and derive
+ * percentiles.
+ *
+ * A background thread snapshots the shards into a versioned binary file
+ * (optionally also exported as JSON), written to a temporary file, fsynced
+ * and renamed into place. stats_init() restores the last snapshot.
+ */
+
+#define STATS_NAME_MAX 64
+
+typedef enum {
+    STATS_SCOPE_MODEL,
+    STATS_SCOPE_ROUTE,
+    STATS_SCOPE_PHASE        // Request phases timed by the tracer
+} StatsScope;
+
+typedef enum {
+    STATS_LATENCY,           // End-to-end, request received to response built
+    STATS_TTFT,              // Upstream time to first byte
+    STATS_UPSTREAM,          // Upstream call, first byte sent to last byte received
+    STATS_METRIC_COUNT
+} StatsMetric;
+
+typedef struct {
+    uint64_t count;
+    double mean_ms;
+    double p50_ms;
+    double p90_ms;
+    double p99_ms;
+    double p999_ms;
+    double max_ms;
+} LatencySummary;
+
 typedef struct {
     char *model_name;
     uint64_t total_requests;
@@ -14,15 +53,65 @@ typedef struct {
     double max_response_time;
     uint64_t total_tokens_processed;
     time_t last_used;
+    LatencySummary latency[STATS_METRIC_COUNT];
 } ModelStats;
 
+/**
+ * Counters and latency of one model or route, as reported by stats_get_series().
+ */
+typedef struct {
+    char name[STATS_NAME_MAX];
+    StatsScope scope;
+    uint64_t successes;
+    uint64_t failures;
+    uint64_t tokens;
+    LatencySummary latency[STATS_METRIC_COUNT];     // Zeroed unless requested
+} StatsSeriesInfo;
 
-int stats_init(const char *stats_file, int auto_save_interval);
+/**
+ * Restores counters and histograms from `stats_file` and starts saving a
+ * snapshot every `auto_save_interval` seconds (0 saves only on cleanup).
+ * `json_file`, when not NULL, receives a JSON export of each snapshot.
+ */
+int stats_init(const char *stats_file, const char *json_file, int auto_save_interval);
 int stats_add_model(const char *model_name);
 int stats_record_successful_request(const char *model_name, double response_time, int token_count);
 int stats_record_failed_request(const char *model_name);
+
+/**
+ * Records one latency sample. The model or route is tracked from its first
+ * sample on; at most 128 are tracked.
+ *
+ * @return 0 on success, -1 if the name cannot be tracked.
+ */
+int stats_record_latency(StatsScope scope, const char *name, StatsMetric metric, uint64_t latency_us);
+
 int stats_get_model_stats(const char *model_name, ModelStats *output);
 int stats_get_all_stats(ModelStats **output, int *count);
+
+// Latency of one route pattern (e.g. "/v1/chat"); -1 if it has no samples
+int stats_get_route_stats(const char *route, LatencySummary output[STATS_METRIC_COUNT]);
+
+/**
+ * Copies up to `max` tracked models and routes into `out`, with latency
+ * percentiles when `with_latency` is set.
+ *
+ * @return The total number tracked.
+ */
+int stats_get_series(StatsSeriesInfo *out, int max, int with_latency);
+
+/**
+ * Histogram of one model or route in caller-chosen buckets: cumulative[i]
+ * counts the samples at or below bounds_ms[i] (ascending).
+ *
+ * @return 0 on success, -1 if the model or route is not tracked.
+ */
+int stats_get_histogram(StatsScope scope, const char *name, StatsMetric metric, const double *bounds_ms,
+                        int bound_count, uint64_t *cumulative, uint64_t *count, double *sum_ms);
+
+// "model", "route" or "phase"
+const char *stats_scope_name(StatsScope scope);
+
 int stats_auto_save();
 int stats_save();
 void stats_cleanup();
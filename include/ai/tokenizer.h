@@ -2,6 +2,8 @@
 #define AIONIC_AI_TOKENIZER_H
 
 #include <stddef.h>
+#include <stdint.h>
+#include "arena.h"
 
 typedef struct {
     char *text;
@@ -11,6 +13,49 @@ typedef struct {
 
 
 int tokenizer_init();
+
+/**
+ * Loads a byte-level BPE vocabulary built by tools/build_bpe_vocab.py.
+ * Until one is loaded, text is split into words and punctuation and token
+ * ids are positions rather than vocabulary ids.
+ *
+ * @return 0 on success, -1 if the file is missing or malformed.
+ */
+int tokenizer_load_vocab(const char *path);
+
+/**
+ * Counts the model tokens in `length` bytes of text without allocating.
+ * Without a vocabulary the words are counted, as tokenizer_encode() splits them.
+ *
+ * @return The token count, or -1 if `text` is NULL.
+ */
+long tokenizer_count_tokens(const char *text, size_t length);
+
+/**
+ * Encodes `length` bytes of text without allocating or copying it.
+ * Token i starts at byte offsets[i] and runs to the start of token i + 1
+ * (the last to `length`). Without a vocabulary, ids are positions and a
+ * token's span also covers the whitespace after it.
+ *
+ * @param ids Receives up to `capacity` token ids (may be NULL).
+ * @param offsets Receives the matching byte offsets (may be NULL).
+ * @return The number of tokens in the text, which exceeds `capacity` when
+ *         the buffers were too small; -1 on failure.
+ */
+long tokenizer_encode(const char *text, size_t length, uint32_t *ids, uint32_t *offsets, size_t capacity);
+
+/**
+ * Like tokenizer_encode(), with the buffers allocated from `arena`.
+ *
+ * @param offsets Receives the offsets buffer; NULL skips offsets.
+ * @return The number of tokens, or -1 on failure.
+ */
+long tokenizer_encode_arena(Arena *arena, const char *text, size_t length, uint32_t **ids, uint32_t **offsets);
+
+/**
+ * Tokenizes text into individually allocated tokens with copied text.
+ * Prefer tokenizer_encode() on hot paths.
+ */
 int tokenizer_tokenize(const char *text, Token ***tokens, int *token_count);
 int tokenizer_detokenize(Token **tokens, int token_count, char *output, size_t output_size);
 void tokenizer_free_tokens(Token **tokens, int token_count);
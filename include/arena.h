@@ -0,0 +1,42 @@
+#ifndef AIONIC_ARENA_H
+#define AIONIC_ARENA_H
+
+#include <stddef.h>
+
+/*
+ * Request-scoped bump allocator.
+ *
+ * Memory comes from page-backed blocks obtained with mmap. Allocation is a
+ * pointer bump; nothing is freed individually. arena_reset() rewinds the arena
+ * after a response has been flushed and keeps the standard-sized blocks for
+ * the next request, so steady-state traffic never touches the global allocator.
+ */
+
+#define ARENA_DEFAULT_BLOCK_SIZE (64 * 1024)
+
+typedef struct ArenaBlock ArenaBlock;
+
+typedef struct {
+    ArenaBlock *first;
+    ArenaBlock *current;
+    size_t block_size;
+    void *last_ptr;         // Most recent allocation, can be grown in place
+    size_t last_size;
+} Arena;
+
+int arena_init(Arena *arena, size_t block_size);
+void arena_destroy(Arena *arena);
+void arena_reset(Arena *arena);
+
+// 16-byte aligned allocation; returns NULL when the OS refuses more pages
+void *arena_alloc(Arena *arena, size_t size);
+
+// Grow an allocation. The last allocation is extended in place when possible.
+void *arena_realloc(Arena *arena, void *ptr, size_t old_size, size_t new_size);
+
+char *arena_strndup(Arena *arena, const char *str, size_t len);
+
+// Bytes handed out since the last reset
+size_t arena_used(const Arena *arena);
+
+#endif // AIONIC_ARENA_H
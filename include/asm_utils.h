@@ -34,13 +34,6 @@ uint32_t crc32_asm(const void *data, size_t length);
 /* AVX2 accelerated */
 uint32_t crc32_asm_avx2(const void *data, size_t length);
 
-/* ============================================================
- *  JSON Tokenizer
- * ============================================================ */
-
-void json_fast_tokenizer(const char *json_str, size_t length);
-void json_fast_tokenizer_avx2(const char *json_str, size_t length);
-
 /* ============================================================
  *  Memory Copy
  * ============================================================ */
@@ -2,15 +2,57 @@
 #define AIONIC_CONFIG_H
 
 
+#define IO_BACKEND_EPOLL 0
+#define IO_BACKEND_URING 1
+
 typedef struct Config {
     int port;                
     int thread_count;        
     int max_connections;     
     int request_timeout;     
     int buffer_size;         
+    int io_backend;                 // IO_BACKEND_*
+    int io_uring_sqpoll;            // Kernel thread polls each worker's submission queue
+    int cpu_affinity;               // Pin each worker to a CPU, spreading workers over NUMA nodes
+    int incoming_cpu_steering;      // Give a connection to the worker on its SO_INCOMING_CPU
     char *log_file;         
     char *api_keys[64];     
     int api_key_count;       
+    char *model_replicas[64];   // "<model> <endpoint>" pairs
+    int model_replica_count;
+    double hedge_percentile;    // TTFT percentile that triggers a hedge, 0 disables
+    double hedge_budget;        // Percent of upstream requests that may be hedged
+    char *model_fallbacks[64];  // "<model> <fallback>" pairs
+    int model_fallback_count;
+    double breaker_failure_rate;    // Percent of failed/slow calls that opens a breaker
+    int breaker_slow_ms;
+    int breaker_open_ms;
+    int prompt_cache_size;          // Near-duplicate prompt cache entries, 0 disables
+    int prompt_cache_ttl;
+    double prompt_cache_threshold;  // Default Jaccard similarity for a hit
+    double prompt_cache_verify;     // Percent of hits re-checked exactly
+    char *prompt_cache_routes[64];  // "<route> <threshold>" pairs
+    int prompt_cache_route_count;
+    char *embedding_model;          // Model for /v1/embeddings requests that name none
+    double embedding_batch_window_ms;   // How long a batch waits for more requests, 0 disables batching
+    int embedding_batch_size;       // Inputs that close a batch early
+    char *tokenizer_vocab;          // BPE vocabulary built by tools/build_bpe_vocab.py, NULL for word splitting
+    char *model_contexts[64];       // "<model> <context tokens>" pairs
+    int model_context_count;
+    char *stats_file;               // Binary stats snapshot, restored at startup
+    char *stats_json_file;          // JSON export of each snapshot, NULL for none
+    int stats_save_interval;        // Seconds between snapshots, 0 saves only at shutdown
+    int trace_enabled;              // Per-request phase tracing at startup (POST /debug/trace toggles it)
+    char *access_log;               // Path prefix of access log segments, NULL disables
+    int access_log_segment_mb;      // Segment size before rotating
+    char *access_log_samples[64];   // "<route> <rate>" pairs
+    int access_log_sample_count;
+    char *static_root;              // Directory served under /static/, NULL disables
+    int static_cache_entries;       // Open files kept in the descriptor cache
+    int tls_port;                   // TLS listener, used when tls_cert and tls_key are set
+    char *tls_cert;                 // PEM certificate chain
+    char *tls_key;                  // PEM private key
+    int tls_ktls;                   // Hand record encryption to the kernel after the handshake
     int enable_cache;        
     int cache_size;          
     int cache_ttl;           
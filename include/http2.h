@@ -0,0 +1,93 @@
+#ifndef AIONIC_HTTP2_H
+#define AIONIC_HTTP2_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "parser.h"
+#include "arena.h"
+
+/*
+ * HTTP/2 over cleartext TCP (h2c), beside the HTTP/1.1 parser.
+ *
+ * A connection becomes HTTP/2 either by opening with the client preface
+ * (prior knowledge) or by an HTTP/1.1 request carrying "Upgrade: h2c", which
+ * is answered with 101 and then served as stream 1.
+ *
+ * An H2Session does no I/O. Received bytes go in through
+ * h2_session_receive(); every stream whose request is complete is handed out
+ * as an ordinary HTTPRequest by h2_session_next_request(), and its
+ * RouteResponse goes back through h2_session_respond(), which re-encodes the
+ * HTTP/1.1 head with HPACK and splits the body into DATA frames as the peer's
+ * flow-control windows allow. Bytes to write are collected in the session's
+ * output buffer for the caller to send.
+ *
+ * Header blocks are decoded with HPACK (including Huffman strings and the
+ * dynamic table); responses are encoded with literals only, so the encoder
+ * keeps no state. Priorities and server push are not used.
+ */
+
+#define H2_PREFACE "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n"
+#define H2_PREFACE_LENGTH 24
+
+#define H2_MAX_CONCURRENT_STREAMS 100
+#define H2_MAX_BODY (10 * 1024 * 1024)      // Same ceiling the firewall applies to HTTP/1.1 bodies
+#define H2_MAX_HEADER_BLOCK (64 * 1024)
+
+typedef struct H2Session H2Session;
+
+// Non-zero if `data` starts with the client connection preface
+int h2_is_preface(const char *data, size_t length);
+
+// Non-zero if an HTTP/1.1 request asks to switch to h2c
+int h2_is_upgrade_request(const HTTPRequest *request);
+
+/**
+ * Create a session for a connection that opened with the preface.
+ * The server's SETTINGS are queued right away.
+ *
+ * @return The session, or NULL if out of memory.
+ */
+H2Session *h2_session_create(void);
+
+/**
+ * Create a session for a connection upgraded from HTTP/1.1. The client's
+ * HTTP2-Settings are applied and stream 1 is left waiting for the response
+ * to the request that asked for the upgrade. The preface is still expected.
+ */
+H2Session *h2_session_create_upgraded(const HTTPRequest *request);
+
+void h2_session_free(H2Session *session);
+
+/**
+ * Process received bytes; partial frames are kept for the next call.
+ *
+ * @return 0 on success, -1 on a connection error (a GOAWAY is queued).
+ */
+int h2_session_receive(H2Session *session, const char *data, size_t length);
+
+/**
+ * Hand out the next stream whose request is complete. Path, headers and body
+ * are copied into `arena`; header names are given in canonical "Content-Type"
+ * form so the HTTP/1.1 lookups work unchanged.
+ *
+ * @return The stream id, or 0 when no request is waiting.
+ */
+uint32_t h2_session_next_request(H2Session *session, HTTPRequest *request, Arena *arena);
+
+/**
+ * Send `response` (a complete HTTP/1.1 response, a streamed body or a static
+ * file) on `stream_id`. A static file reference is taken over from the
+ * response. Body bytes beyond the flow-control windows are queued.
+ *
+ * @return Bytes of headers and body the response carries, or -1.
+ */
+int64_t h2_session_respond(H2Session *session, uint32_t stream_id, RouteResponse *response);
+
+// Bytes waiting to be written; h2_session_output_sent() clears them
+const char *h2_session_output(const H2Session *session, size_t *length);
+void h2_session_output_sent(H2Session *session);
+
+// Non-zero once a GOAWAY was sent or received and the connection should close
+int h2_session_is_closing(const H2Session *session);
+
+#endif // AIONIC_HTTP2_H
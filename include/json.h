@@ -0,0 +1,130 @@
+#ifndef AIONIC_JSON_H
+#define AIONIC_JSON_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "parser.h"
+#include "arena.h"
+
+/*
+ * Two-stage JSON parser.
+ *
+ * Stage 1 (json_doc_parse) scans the buffer 64 bytes at a time with AVX2/SSE2
+ * and records the offset of every structural character ({ } [ ] : ,) outside
+ * a string and of every unescaped quote. Stage 2 is an on-demand
+ * cursor API that walks that index without copying or allocating; values are
+ * only decoded when the caller asks for them.
+ */
+
+#define JSON_MAX_DEPTH 256
+
+typedef struct {
+    const char *buf;
+    size_t len;
+    uint32_t *index;        // Offsets of structural characters
+    size_t count;
+    int owns_index;
+} JsonDoc;
+
+// A value inside a parsed document
+typedef struct {
+    const JsonDoc *doc;
+    uint32_t pos;           // Byte offset of the first character of the value
+    uint32_t i;             // Index slot of the value (or of the token after a scalar)
+} JsonCursor;
+
+// Iterator over the members of an object or the elements of an array
+typedef struct {
+    const JsonDoc *doc;
+    uint32_t i;
+    int done;
+} JsonIter;
+
+// Raw (still escaped) string slice
+typedef struct {
+    const char *ptr;
+    size_t len;
+} JsonSlice;
+
+/**
+ * Build the structural index for a JSON buffer and validate its nesting.
+ * The buffer must stay alive for as long as the document is used.
+ *
+ * @return 0 on success, -1 on malformed input or allocation failure.
+ */
+int json_doc_parse(JsonDoc *doc, const char *buf, size_t len);
+
+/**
+ * Same as json_doc_parse, but stores the index in caller-provided memory.
+ * `capacity` is the number of uint32_t slots available (len + 1 is always enough).
+ */
+int json_doc_parse_into(JsonDoc *doc, const char *buf, size_t len, uint32_t *storage, size_t capacity);
+
+void json_doc_free(JsonDoc *doc);
+
+int json_doc_root(const JsonDoc *doc, JsonCursor *root);
+
+JSONType json_cursor_type(const JsonCursor *cursor);
+
+// Object / array iteration. *_next returns 1 for each element, 0 at the end
+// and -1 on malformed input.
+int json_object_begin(const JsonCursor *object, JsonIter *it);
+int json_object_next(JsonIter *it, JsonSlice *key, JsonCursor *value);
+int json_array_begin(const JsonCursor *array, JsonIter *it);
+int json_array_next(JsonIter *it, JsonCursor *value);
+
+// Look up a member of an object by (unescaped) key
+int json_object_get(const JsonCursor *object, const char *key, JsonCursor *value);
+
+// Compare a raw key slice against an unescaped key
+int json_key_equals(JsonSlice key, const char *expected);
+
+// Value accessors
+int json_get_string(const JsonCursor *value, char *output, size_t output_size, size_t *out_len);
+int json_get_string_raw(const JsonCursor *value, JsonSlice *raw);
+int json_get_int64(const JsonCursor *value, int64_t *output);
+int json_get_double(const JsonCursor *value, double *output);
+int json_get_bool(const JsonCursor *value, int *output);
+int json_is_null(const JsonCursor *value);
+
+// Source text of any value, quotes and brackets included (e.g. to copy a
+// nested array through unchanged)
+int json_get_raw(const JsonCursor *value, JsonSlice *raw);
+
+// Decode JSON string escapes (\n, \", \uXXXX, ...) into UTF-8
+int json_unescape(const char *src, size_t len, char *output, size_t output_size, size_t *out_len);
+
+/*
+ * Streaming JSON writer.
+ *
+ * Appends to a single growable buffer that can be handed over to a
+ * RouteResponse or an upstream request without further copies. String escaping
+ * scans 32 bytes at a time for quotes, backslashes and control characters and
+ * copies clean runs unchanged. Errors are sticky: once an append fails every
+ * later call is a no-op and json_writer_finish() reports the failure.
+ */
+typedef struct {
+    char *buf;
+    size_t len;
+    size_t capacity;
+    int failed;
+    Arena *arena;           // Backing arena, or NULL for the heap
+} JsonWriter;
+
+int json_writer_init(JsonWriter *w, size_t initial_capacity);
+int json_writer_init_arena(JsonWriter *w, Arena *arena, size_t initial_capacity);
+void json_writer_free(JsonWriter *w);
+
+// NUL-terminate and transfer ownership of the buffer (arena-backed buffers
+// stay owned by the arena); returns NULL on failure
+char *json_writer_finish(JsonWriter *w, size_t *out_len);
+
+int json_writer_reserve(JsonWriter *w, size_t extra);
+void json_write_raw(JsonWriter *w, const char *data, size_t len);
+void json_write_cstr(JsonWriter *w, const char *str);
+void json_write_string(JsonWriter *w, const char *str, size_t len);   // Quoted and escaped
+void json_write_escaped(JsonWriter *w, const char *str, size_t len);  // Escaped, no quotes
+void json_write_int(JsonWriter *w, int64_t value);
+void json_write_double(JsonWriter *w, double value);
+
+#endif // AIONIC_JSON_H
@@ -0,0 +1,62 @@
+#ifndef AIONIC_METRICS_H
+#define AIONIC_METRICS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "server.h"
+#include "json.h"
+
+/*
+ * Server counters and the /metrics exposition.
+ *
+ * Every worker thread owns a cache line of counters that only it writes
+ * (plain relaxed stores, no atomic read-modify-write); threads that are not
+ * workers share one slot updated with atomic adds. metrics_render() sums
+ * the slots and adds the cache, firewall, model and optimizer state in
+ * OpenMetrics text format.
+ */
+
+#define METRICS_MAX_WORKERS 64
+#define METRICS_CONTENT_TYPE "application/openmetrics-text; version=1.0.0; charset=utf-8"
+
+typedef struct {
+    uint64_t requests;              // Requests parsed
+    uint64_t responses[5];          // Responses sent, by status class 1xx..5xx
+    uint64_t rejected;              // Unparsable, or refused by a hook or the firewall
+    uint64_t bytes_received;
+    uint64_t bytes_sent;
+} WorkerMetricsInfo;
+
+// Record the start time uptime is measured from
+void metrics_init(void);
+
+// Give the calling thread worker `worker_id`'s counters
+void metrics_bind_worker(int worker_id);
+
+void metrics_count_accept(void);
+void metrics_count_read(size_t bytes);
+void metrics_count_request(void);
+void metrics_count_response(int status_code, size_t bytes);
+void metrics_count_rejected(void);
+
+/**
+ * Copies the counters of up to `max` workers into `out`.
+ *
+ * @return The number of workers that have counters.
+ */
+int metrics_get_workers(WorkerMetricsInfo *out, int max);
+
+// Counters of every worker and non-worker thread added up
+void metrics_get_totals(WorkerMetricsInfo *out);
+
+uint64_t metrics_uptime_seconds(void);
+
+/**
+ * Append every counter, gauge and histogram to `w` in OpenMetrics text
+ * format, ending with "# EOF".
+ *
+ * @return 0 on success, -1 if the writer failed.
+ */
+int metrics_render(const Server *server, JsonWriter *w);
+
+#endif // AIONIC_METRICS_H
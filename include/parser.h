@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include "arena.h"
 
 
 typedef enum {
@@ -38,6 +39,15 @@ typedef struct {
     JSONType value_type;
 } JSONValue;
 
+// Path parameter captured by the router (a slice of the request path)
+#define HTTP_MAX_PARAMS 8
+
+typedef struct {
+    const char *name;
+    const char *value;   // Not NUL-terminated
+    size_t value_len;
+} RouteParam;
+
 typedef struct {
     HTTPMethod method;
     char *path;
@@ -47,6 +57,11 @@ typedef struct {
     char *body;
     size_t body_length;
     char *content_type;  // Added missing field
+    int keep_alive;      // Client sent "Connection: keep-alive"
+    Arena *arena;        // Request-scoped memory, reset after the response is sent
+    RouteParam params[HTTP_MAX_PARAMS];
+    int param_count;
+    int client_fd;       // Connection the request arrived on, -1 if none
 } HTTPRequest;
 
 
@@ -59,21 +74,38 @@ typedef struct {
     size_t length;
     int is_streaming;
     void *stream_data;
+    Arena *arena;        // When set, response data is allocated from this arena
+    int owns_data;       // data was malloc'd and must be freed
+    int keep_alive;      // Emit "Connection: keep-alive" on 200 responses
+    void *file;          // StaticFile whose bytes follow `data` (sent with sendfile)
+    uint64_t file_offset;
+    uint64_t file_length;
 } RouteResponse;
 
 
-int parse_http_request(const char *raw_request, HTTPRequest *request);
+// Parses `raw_request` in place (it must be writable and NUL-terminated at
+// `length`); path, headers and body point into it. The arena may be NULL.
+int parse_http_request(char *raw_request, size_t length, HTTPRequest *request, Arena *arena);
 void free_http_request(HTTPRequest *request);
 
+// Value of a captured path parameter (not NUL-terminated), or NULL
+const char *http_request_param(const HTTPRequest *request, const char *name, size_t *value_len);
+
+// Value of a request header (name matched case-insensitively), or NULL
+const char *http_request_header(const HTTPRequest *request, const char *name);
+
+// "GET", "POST", ... or "UNKNOWN"
+const char *http_method_name(HTTPMethod method);
+
 // === FIXED HERE ===
 // Updated signature to match the implementation in src/parser.c
 int parse_json(const char *json_string, void *output, size_t output_size);
 
 int json_get_value(const char *json_string, const char *key, char *output, size_t output_size);
-int parse_json_with_fast_tokenizer(const char *json_str, size_t length, JSONValue *result);  // Added function declaration
+// Validate a JSON document and report its root type (see json.h for the cursor API)
+int parse_json_with_fast_tokenizer(const char *json_str, size_t length, JSONValue *result);
 
 
-extern void json_fast_tokenizer(const char *json_string, size_t length);
 extern void *memcpy_asm(void *dest, const void *src, size_t n);
 extern uint32_t crc32_asm(const void *data, size_t length);
 
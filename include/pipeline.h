@@ -0,0 +1,87 @@
+#ifndef AIONIC_PIPELINE_H
+#define AIONIC_PIPELINE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "parser.h"
+#include "server.h"
+
+/*
+ * Phase-based request pipeline.
+ *
+ * Built-in middleware and plugins attach hooks to fixed points of the
+ * connection lifecycle. Registrations are compiled into one immutable array
+ * of function pointers per phase and published as an RCU snapshot, so
+ * workers walk the hooks without taking any lock. Every hook has its own
+ * call/error/latency counters.
+ */
+
+typedef enum {
+    HOOK_ON_ACCEPT = 0,         // New connection, before it is handed to a worker
+    HOOK_ON_HEADERS,            // Request line and headers parsed
+    HOOK_ON_BODY,               // Request body available (only when non-empty)
+    HOOK_PRE_ROUTE,             // Before the route handler; may produce the response
+    HOOK_POST_RESPONSE,         // After the response has been sent
+    HOOK_ON_UPSTREAM_CHUNK,     // Each chunk received from an AI backend
+    HOOK_PHASE_COUNT
+} HookPhase;
+
+// Hook return values; any negative value aborts the phase with an error
+#define HOOK_CONTINUE 0         // Run the next hook
+#define HOOK_HANDLED  1         // Stop this phase (e.g. pre_route produced a response)
+
+typedef struct {
+    int client_fd;              // -1 when the phase is not tied to a connection
+    HTTPRequest *request;       // NULL in on_accept and on_upstream_chunk
+    RouteResponse *response;    // pre_route (to short-circuit) and post_response
+    const char *data;           // on_body: request body, on_upstream_chunk: received bytes
+    size_t data_len;
+} HookContext;
+
+// `server` is NULL in on_upstream_chunk
+typedef int (*PluginHook)(Server *server, HookPhase phase, HookContext *ctx);
+
+typedef struct {
+    char owner[64];
+    HookPhase phase;
+    int enabled;
+    uint64_t calls;
+    uint64_t errors;
+    uint64_t total_ns;
+    uint64_t max_ns;
+} HookStatsInfo;
+
+// Add one hook / one hook per non-NULL phase; the chain is republished once
+int pipeline_register(const char *owner, HookPhase phase, PluginHook hook);
+int pipeline_register_hooks(const char *owner, const PluginHook hooks[HOOK_PHASE_COUNT]);
+
+/**
+ * Remove every hook registered by `owner`. Returns only after no worker can
+ * still be running one of them, so the owner's code may be unloaded next.
+ */
+int pipeline_unregister(const char *owner);
+
+/**
+ * Atomically swap all hooks of `owner` for `hooks` (which may be NULL to just
+ * remove them). Does not wait: the old hooks can still be running until the
+ * next grace period, so code backing them must be released with rcu_defer().
+ */
+int pipeline_replace_hooks(const char *owner, const PluginHook hooks[HOOK_PHASE_COUNT], int enabled);
+int pipeline_set_enabled(const char *owner, int enabled);
+
+/**
+ * Run the hooks of a phase in registration order.
+ *
+ * @return HOOK_CONTINUE when every hook continued, otherwise the first
+ *         non-zero hook result.
+ */
+int pipeline_run(HookPhase phase, Server *server, HookContext *ctx);
+
+const char *pipeline_phase_name(HookPhase phase);
+
+// Copy up to `max` hook counters into `out`; returns the number of hooks
+int pipeline_get_stats(HookStatsInfo *out, int max);
+
+void pipeline_cleanup(void);
+
+#endif // AIONIC_PIPELINE_H
@@ -1,13 +1,49 @@
 #ifndef AIONIC_PLUGIN_H
 #define AIONIC_PLUGIN_H
 
+#include <stdint.h>
+#include "pipeline.h"
+
+/*
+ * Plugin ABI.
+ *
+ * A plugin is a shared object exporting a PluginDescriptor named
+ * AIONIC_PLUGIN_SYMBOL. The loader rejects descriptors built against a
+ * different ABI version; bump AIONIC_PLUGIN_ABI_VERSION whenever the
+ * descriptor, HookContext or the hook signature changes.
+ *
+ *     static int on_headers(Server *server, HookPhase phase, HookContext *ctx) { ... }
+ *
+ *     AIONIC_PLUGIN(
+ *         .name = "example",
+ *         .hooks = { [HOOK_ON_HEADERS] = on_headers },
+ *     );
+ */
+
+#define AIONIC_PLUGIN_ABI_VERSION 1
+#define AIONIC_PLUGIN_SYMBOL "aionic_plugin"
+
+typedef struct {
+    uint32_t abi_version;
+    const char *name;
+    int (*init)(void);                      // Optional, non-zero aborts the load
+    void (*cleanup)(void);                  // Optional
+    PluginHook hooks[HOOK_PHASE_COUNT];     // NULL for phases the plugin ignores
+} PluginDescriptor;
+
+#define AIONIC_PLUGIN(...) \
+    const PluginDescriptor aionic_plugin = { .abi_version = AIONIC_PLUGIN_ABI_VERSION, __VA_ARGS__ }
 
 int plugin_init(const char *plugin_dir);
+
+// Loading a plugin whose name is already loaded replaces it without downtime:
+// the new hooks are published atomically and the old .so is closed once every
+// worker has passed a quiescent state (see rcu_reclaim()).
 int plugin_load(const char *plugin_path);
 int plugin_unload(const char *plugin_name);
 int plugin_set_enabled(const char *plugin_name, int enabled);
-int plugin_process_request(void *request, void *response);
 int plugin_get_list(char ***plugin_names, int *count);
+const char *plugin_get_dir(void);
 void plugin_cleanup();
 
 #endif // AIONIC_PLUGIN_H
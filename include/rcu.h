@@ -0,0 +1,59 @@
+#ifndef AIONIC_RCU_H
+#define AIONIC_RCU_H
+
+#include <stdatomic.h>
+
+/*
+ * Quiescent-state-based read-copy-update.
+ *
+ * Shared read-mostly structures are published as immutable snapshots through
+ * an atomic pointer. Readers dereference the pointer with no lock and no
+ * shared write; each registered thread only announces a quiescent state at a
+ * point where it holds no snapshot references (between requests). Writers
+ * build a new snapshot, publish it, then wait in rcu_synchronize() until every
+ * online reader has passed a quiescent state before freeing the old one.
+ *
+ * Threads that block for long periods outside read-side sections (epoll_wait)
+ * should go offline so that writers do not wait on them.
+ *
+ * Writers that must not block (hot reload from the main loop) hand the old
+ * snapshot to rcu_defer() instead; rcu_reclaim() later runs the callbacks
+ * whose grace period has completed.
+ */
+
+#define RCU_MAX_THREADS 256
+
+#define rcu_dereference(p) atomic_load_explicit(&(p), memory_order_acquire)
+#define rcu_assign_pointer(p, v) atomic_store_explicit(&(p), (v), memory_order_release)
+
+// Register the calling thread as a reader; it starts online
+int rcu_register_thread(void);
+void rcu_unregister_thread(void);
+
+// Announce that the calling thread holds no snapshot references
+void rcu_quiescent_state(void);
+
+// Extended quiescent state: no references may be held while offline
+void rcu_thread_offline(void);
+void rcu_thread_online(void);
+
+/**
+ * Wait until every registered, online reader has passed a quiescent state.
+ * Must not be called while the caller holds snapshot references; the calling
+ * thread's own slot is skipped.
+ */
+void rcu_synchronize(void);
+
+// rcu_synchronize() followed by free_fn(ptr)
+void rcu_retire(void *ptr, void (*free_fn)(void *));
+
+// Queue free_fn(ptr) to run once every current reader has passed a quiescent state
+void rcu_defer(void *ptr, void (*free_fn)(void *));
+
+// Run deferred callbacks whose grace period has completed; never blocks
+void rcu_reclaim(void);
+
+// Wait for a grace period and run every deferred callback
+void rcu_barrier(void);
+
+#endif // AIONIC_RCU_H
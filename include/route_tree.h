@@ -0,0 +1,53 @@
+#ifndef AIONIC_ROUTE_TREE_H
+#define AIONIC_ROUTE_TREE_H
+
+#include "parser.h"
+#include "server.h"
+
+/*
+ * Compressed radix tree for request routing.
+ *
+ * Patterns are made of static text, ":name" segments (one path segment) and
+ * a trailing "*name" wildcard (rest of the path). Static edges are merged on
+ * common prefixes, so a lookup is a single walk over the request path. Each
+ * node has one handler slot per HTTP method.
+ *
+ * A tree is not synchronized. The router treats published trees as immutable
+ * and applies changes to a clone (see router_update_routes).
+ */
+
+typedef int (*RouteHandler)(Server *, HTTPRequest *, RouteResponse *);
+
+typedef struct RouteNode RouteNode;
+
+RouteNode *route_tree_create(void);
+void route_tree_free(RouteNode *root);
+
+// Deep copy; returns NULL on allocation failure
+RouteNode *route_tree_clone(const RouteNode *root);
+
+/**
+ * Add a pattern. Fails on malformed patterns, on a handler already registered
+ * for the same pattern and method, and on parameter names that conflict with
+ * an existing route at the same position.
+ *
+ * @return 0 on success, -1 on failure.
+ */
+int route_tree_insert(RouteNode *root, const char *pattern, HTTPMethod method, RouteHandler handler);
+
+// Like route_tree_insert, but replaces an existing handler instead of failing
+int route_tree_set(RouteNode *root, const char *pattern, HTTPMethod method, RouteHandler handler);
+
+/**
+ * Find the handler for `path`. Captured parameters are stored on `request`
+ * as slices of `path`. Static segments take priority over parameters, and
+ * parameters over wildcards.
+ *
+ * @param path_matched Set to 1 when the path matched a route that has no
+ *                     handler for `method` (405 rather than 404). May be NULL.
+ * @return The handler, or NULL if none matched.
+ */
+RouteHandler route_tree_lookup(const RouteNode *root, const char *path, HTTPMethod method,
+                               HTTPRequest *request, int *path_matched);
+
+#endif // AIONIC_ROUTE_TREE_H
@@ -5,10 +5,13 @@
 #include <signal.h>
 #include <pthread.h>  
 #include "config.h"
+#include "arena.h"
 
 typedef struct {
     int server_fd;             
     uint16_t port;              
+    int tls_fd;                 // TLS listener, -1 when TLS is off
+    uint16_t tls_port;
     int thread_count;          
     void *thread_pool;         
     void *connection_pool;      
@@ -16,6 +19,10 @@ typedef struct {
     int max_connections;       
     int active_connections;     
     int *epoll_fds;            
+    int io_backend;             // IO_BACKEND_*, may fall back to epoll at start
+    int uring_sqpoll;
+    int cpu_affinity;           // Workers pinned as planned by affinity_init()
+    int incoming_cpu_steering;  // Accepted connections follow SO_INCOMING_CPU
     pthread_t thread;          
     pthread_t reaper_thread;    
     volatile sig_atomic_t running; 
@@ -33,7 +40,7 @@ int server_start(Server *server);
 int server_stop(Server *server);
 void server_cleanup(Server *server);
 int server_process_events(Server *server);
-int server_handle_request(Server *server, int client_fd);
+int server_handle_request(Server *server, int client_fd, Arena *arena);
 int server_send_response(Server *server, int client_fd, const char *response, size_t length);
 
 #endif // AIONIC_SERVER_H
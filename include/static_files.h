@@ -0,0 +1,78 @@
+#ifndef AIONIC_STATIC_FILES_H
+#define AIONIC_STATIC_FILES_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+/*
+ * Files under a configured root, served by GET /static/<path>.
+ *
+ * Opened files are kept in an LRU cache keyed by their path below the root,
+ * holding the descriptor, the stat result and an ETag (the CRC32 of the
+ * contents). An entry is trusted for STATIC_REVALIDATE_SECONDS and then
+ * checked with one stat(); a changed file is reopened. Entries are reference
+ * counted, so one evicted or replaced while a response is being sent is
+ * closed by the last user.
+ *
+ * Bodies go from the page cache to the socket with sendfile(), never through
+ * a user-space buffer.
+ */
+
+#define STATIC_REVALIDATE_SECONDS 1
+#define STATIC_ETAG_MAX 32
+
+typedef struct StaticFile {
+    int fd;
+    uint64_t size;
+    time_t mtime;
+    char etag[STATIC_ETAG_MAX];     // Quoted strong validator
+    const char *content_type;
+} StaticFile;
+
+/**
+ * Serve files below `root`, keeping up to `max_open` of them open.
+ *
+ * @return 0 on success, -1 if `root` is not a readable directory.
+ */
+int static_files_init(const char *root, int max_open);
+void static_files_cleanup(void);
+int static_files_is_enabled(void);
+
+/**
+ * Look up `path` (relative to the root, `length` bytes, not NUL-terminated).
+ * %XX escapes are decoded first; empty segments and segments starting with
+ * '.' (so "..", "." and hidden files) are refused.
+ *
+ * @return A referenced entry to pass to static_file_release(), or NULL with
+ *         errno ENOENT (missing, not a regular file or refused) or EACCES.
+ */
+StaticFile *static_file_acquire(const char *path, size_t length);
+void static_file_release(StaticFile *file);
+
+/**
+ * Interpret a Range header against a file of `size` bytes. Only a single
+ * "bytes=" range is honoured; anything else means the whole file.
+ *
+ * @return 1 for a partial response (*start, *length set), 0 for the whole
+ *         file, -1 if the range cannot be satisfied.
+ */
+int static_parse_range(const char *header, uint64_t size, uint64_t *start, uint64_t *length);
+
+// Non-zero if an If-None-Match header value matches `etag`
+int static_etag_matches(const char *header, const char *etag);
+
+/**
+ * Send `header_length` bytes of headers, then `length` bytes of the file from
+ * `offset`, waiting for a non-blocking socket to drain when needed. A client
+ * slower than about 64 KB/s (after a 30 second allowance) is given up on.
+ *
+ * @return Bytes sent, or -1 if the connection failed or timed out first.
+ */
+int64_t static_file_send(int client_fd, const char *header, size_t header_length,
+                         const StaticFile *file, uint64_t offset, uint64_t length);
+
+// Lookups answered from the cache and lookups that opened the file
+void static_files_get_counts(uint64_t *hits, uint64_t *misses);
+
+#endif // AIONIC_STATIC_FILES_H
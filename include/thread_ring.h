@@ -0,0 +1,75 @@
+#ifndef AIONIC_THREAD_RING_H
+#define AIONIC_THREAD_RING_H
+
+#include <stddef.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+/*
+ * Per-thread single-producer rings drained by one background writer, the
+ * pattern shared by the log and the access log.
+ *
+ * A module embeds ThreadRing as the first member of its ring type and keeps
+ * its data after it. A thread claims a ring on first use and keeps it in its
+ * own thread-local pointer; when the thread exits the ring is released and
+ * the next new thread reuses it, so the list only grows to the peak number
+ * of producing threads. Rings are never freed.
+ *
+ * A RingWriter calls `drain` in a loop on its own thread, sleeping up to
+ * `idle_wait_ms` after a pass that found nothing, and calls `finish` once
+ * the rings are empty after a stop.
+ */
+
+typedef struct ThreadRing {
+    _Atomic size_t head;                // Consumer position
+    _Atomic size_t tail;                // Producer position
+    _Atomic int in_use;                 // Owned by a live thread
+    struct ThreadRing *next;            // Set before the ring is published
+} ThreadRing;
+
+typedef struct {
+    _Atomic(ThreadRing *) rings;
+    size_t ring_size;                   // Size of the embedding ring type
+    pthread_key_t key;                  // Releases a thread's ring when it exits
+    _Atomic int key_ready;
+} ThreadRingList;
+
+#define THREAD_RING_LIST_INIT(type) {.rings = NULL, .ring_size = sizeof(type), .key_ready = 0}
+
+/**
+ * Ring for the calling thread: one released by an exited thread, or a new
+ * zeroed one. The caller caches it in a thread-local pointer.
+ *
+ * @return The ring, or NULL if out of memory.
+ */
+ThreadRing *thread_ring_claim(ThreadRingList *list);
+
+// First ring of the list, for the consumer to walk through `next`
+ThreadRing *thread_ring_first(ThreadRingList *list);
+
+typedef struct {
+    size_t (*drain)(void *ctx);         // Returns how much one pass took
+    void (*finish)(void *ctx);          // May be NULL
+    int idle_wait_ms;
+    void *ctx;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int stop;
+    int flush_requested;
+} RingWriter;
+
+#define RING_WRITER_INIT(drain_fn, finish_fn, idle_ms) \
+    {.drain = (drain_fn), .finish = (finish_fn), .idle_wait_ms = (idle_ms), \
+     .lock = PTHREAD_MUTEX_INITIALIZER, .cond = PTHREAD_COND_INITIALIZER}
+
+// Start the writer thread with `ctx`; 0 on success, -1 otherwise
+int ring_writer_start(RingWriter *writer, void *ctx);
+
+// Wait up to `timeout_ms` for a writer pass that found every ring empty
+void ring_writer_flush(RingWriter *writer, int timeout_ms);
+
+// Stop the writer after it has drained what is queued, then call `finish`
+void ring_writer_stop(RingWriter *writer);
+
+#endif // AIONIC_THREAD_RING_H
@@ -0,0 +1,69 @@
+#ifndef AIONIC_TLS_H
+#define AIONIC_TLS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+/*
+ * TLS termination on a second listener, using OpenSSL.
+ *
+ * Handshakes run non-blocking on the worker that owns the connection. Session
+ * tickets (TLS 1.2 and 1.3) and a server-side session cache let returning
+ * clients resume without a full handshake. ALPN offers "h2" and "http/1.1";
+ * an h2 client then opens with the HTTP/2 preface as it would over h2c.
+ *
+ * With kernel TLS available (the "tls" TCP ULP, Linux 4.13+ for sending,
+ * 4.17+ for receiving), OpenSSL hands the record keys to the kernel once the
+ * handshake is done. When sending is offloaded, the server's ordinary send(),
+ * writev() and sendfile() paths write plaintext to the socket and the kernel
+ * encrypts it, so no response bytes are copied through user space for crypto.
+ * Without offload, reads and writes go through SSL_read()/SSL_write().
+ */
+
+typedef struct TlsConnection TlsConnection;
+
+/**
+ * Load the certificate chain and private key (PEM) and create the shared
+ * context. With `ktls` set, record encryption is offered to the kernel.
+ *
+ * @return 0 on success, -1 if the files cannot be loaded or do not match.
+ */
+int tls_init(const char *cert_file, const char *key_file, int ktls);
+void tls_cleanup(void);
+int tls_is_enabled(void);
+
+// Server side of a freshly accepted, non-blocking socket; NULL if out of memory
+TlsConnection *tls_connection_create(int fd);
+void tls_connection_free(TlsConnection *conn);
+
+/**
+ * Advance the handshake with whatever the socket has.
+ *
+ * @return 1 once established, 0 if more data from the peer is needed,
+ *         -1 if the handshake failed.
+ */
+int tls_handshake(TlsConnection *conn);
+int tls_is_established(const TlsConnection *conn);
+
+// Non-zero if the kernel encrypts what is written to the socket
+int tls_send_offloaded(const TlsConnection *conn);
+
+/**
+ * Read decrypted bytes, like recv(): 0 at close_notify or EOF, -1 with errno
+ * EAGAIN when nothing is buffered.
+ */
+ssize_t tls_recv(TlsConnection *conn, void *buffer, size_t length);
+
+/**
+ * Write all of `data`, waiting for a full socket to drain (or for the peer,
+ * when OpenSSL needs to read) for at most 30 seconds in total.
+ *
+ * @return `length`, or -1 if the connection failed or the time ran out first.
+ */
+ssize_t tls_send(TlsConnection *conn, const void *data, size_t length);
+
+// Completed handshakes, how many resumed a session, and how many got kTLS sending
+void tls_get_counts(uint64_t *handshakes, uint64_t *resumed, uint64_t *offloaded);
+
+#endif // AIONIC_TLS_H
@@ -0,0 +1,68 @@
+#ifndef AIONIC_TRACE_H
+#define AIONIC_TRACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "json.h"
+
+/*
+ * Per-request phase timing.
+ *
+ * While tracing is on, each request handled by a thread collects one span
+ * per phase on that thread. When the request ends the record is copied into
+ * the thread's ring of recent requests (single writer, per-slot sequence
+ * numbers for readers) and every span feeds the phase's latency histogram
+ * in the stats module. When tracing is off every call returns after one
+ * relaxed load.
+ */
+
+typedef enum {
+    TRACE_RECV = 0,         // recv() of the request bytes
+    TRACE_PARSE,            // HTTP request line and headers
+    TRACE_HOOKS,            // on_headers / on_body hooks
+    TRACE_FIREWALL,         // Blacklist and suspicious request checks
+    TRACE_ROUTE,            // Route lookup and handler
+    TRACE_JSON,             // Request body JSON parsing inside the handler
+    TRACE_UPSTREAM,         // Waiting for the AI backend (or the prompt cache)
+    TRACE_SERIALIZE,        // Building the response body
+    TRACE_SEND,             // send() of the response
+    TRACE_PHASE_COUNT
+} TracePhase;
+
+#define TRACE_RING_SIZE 256         // Recent requests kept per thread
+#define TRACE_MAX_THREADS 64        // Threads past this are not traced
+
+void trace_set_enabled(int enabled);
+int trace_is_enabled(void);
+
+/**
+ * Start tracing a request on the calling thread, dropping any trace left
+ * unfinished by the previous one.
+ *
+ * @return The request's start time in nanoseconds, 0 when tracing is off.
+ */
+uint64_t trace_request_begin(void);
+
+// Current time for a phase start, 0 when no request is traced on this thread
+uint64_t trace_now(void);
+
+// Record `phase` as running from `start` (a trace_now() value) until now
+void trace_phase(TracePhase phase, uint64_t start);
+
+// Finish the traced request and publish it; a no-op when none is active
+void trace_request_end(const char *method, const char *path, int status_code);
+
+// Drop the traced request, e.g. when recv() found no data
+void trace_request_discard(void);
+
+const char *trace_phase_name(TracePhase phase);
+
+/**
+ * Append the last `max_requests` traced requests, across all threads, to `w`
+ * as a Chrome trace-event JSON object (chrome://tracing, Perfetto).
+ *
+ * @return The number of requests written, -1 if the writer failed.
+ */
+int trace_write_chrome(JsonWriter *w, int max_requests);
+
+#endif // AIONIC_TRACE_H
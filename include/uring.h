@@ -0,0 +1,89 @@
+#ifndef AIONIC_URING_H
+#define AIONIC_URING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <linux/io_uring.h>
+
+/*
+ * Minimal io_uring access over the raw system calls (no liburing).
+ *
+ * A Uring is owned by one thread. Submission entries are filled with
+ * uring_get_sqe() and handed to the kernel in one go by uring_submit_wait(),
+ * which also waits for completions. With SQPOLL a kernel thread picks the
+ * entries up and the call only enters the kernel to wake it or to wait.
+ *
+ * A UringBuffers is a provided-buffer ring: receives that name its group
+ * pick a free buffer themselves, so no memory is tied to an idle connection.
+ * A buffer goes back to the ring once its data has been used.
+ */
+
+typedef struct {
+    int fd;
+    unsigned setup_flags;
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned *sq_flags;
+    unsigned *sq_array;
+    unsigned sq_mask;
+    unsigned sq_entries;
+    unsigned sqe_tail;              // Entries filled, published by uring_submit_wait()
+    struct io_uring_sqe *sqes;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned cq_mask;
+    struct io_uring_cqe *cqes;
+    void *sq_ring;
+    void *cq_ring;
+    size_t sq_ring_size;
+    size_t cq_ring_size;
+    size_t sqes_size;
+} Uring;
+
+typedef struct {
+    struct io_uring_buf_ring *ring;
+    char *memory;
+    size_t buffer_size;
+    unsigned count;                 // Power of two
+    uint16_t group;
+    uint16_t tail;
+} UringBuffers;
+
+/**
+ * Create a ring with `entries` submission slots.
+ *
+ * @param sqpoll Non-zero to have a kernel thread poll the submission queue.
+ * @return 0 on success, -1 if io_uring is unavailable.
+ */
+int uring_init(Uring *ring, unsigned entries, int sqpoll);
+void uring_exit(Uring *ring);
+
+// A cleared submission entry, or NULL when the queue is full
+struct io_uring_sqe *uring_get_sqe(Uring *ring);
+
+/**
+ * Submit the filled entries and wait up to `timeout_ms` for a completion.
+ *
+ * @return 0 on success (including a timeout), -1 on error.
+ */
+int uring_submit_wait(Uring *ring, int timeout_ms);
+
+// Next completion, or NULL; release it with uring_cqe_seen()
+struct io_uring_cqe *uring_peek_cqe(Uring *ring);
+void uring_cqe_seen(Uring *ring);
+
+/**
+ * Register `count` buffers of `size` bytes as provided-buffer group `group`.
+ * Each buffer has one spare byte after `size` for a terminator.
+ *
+ * @return 0 on success, -1 if the kernel lacks buffer rings.
+ */
+int uring_buffers_init(Uring *ring, UringBuffers *buffers, uint16_t group, unsigned count, size_t size);
+void uring_buffers_free(Uring *ring, UringBuffers *buffers);
+
+char *uring_buffer(UringBuffers *buffers, uint16_t id);
+
+// Hand buffer `id` back to the kernel
+void uring_buffer_recycle(UringBuffers *buffers, uint16_t id);
+
+#endif // AIONIC_URING_H
@@ -81,8 +81,40 @@ typedef enum {
     LOG_LEVEL_CRITICAL = 4
 } log_level_t;
 
+/*
+ * Lines are formatted on the calling thread into its own ring buffer and
+ * written out in batches by a background thread, so logging never waits on
+ * a lock or on I/O. A full ring drops the line (counted, and reported by
+ * the writer). Before log_start_writer() and after log_shutdown() lines are
+ * written directly.
+ */
+
+// Call before log_start_writer(); NULL logs to stdout
 void init_logging(const char *log_filename, log_level_t level);
-void log_message_ex(log_level_t level, const char *format, ...);
+int log_start_writer(void);
+void log_flush(void);                   // Wait until every queued line is written
+void log_shutdown(void);                // Stop the writer after writing what is queued
+uint64_t log_dropped_lines(void);
+void log_message_ex(log_level_t level, const char *format, ...)
+    __attribute__((format(printf, 2, 3)));
+
+// Calls below LOG_COMPILE_LEVEL are compiled out; debug builds keep them all
+#ifndef LOG_COMPILE_LEVEL
+#ifdef DEBUG
+#define LOG_COMPILE_LEVEL LOG_LEVEL_DEBUG
+#else
+#define LOG_COMPILE_LEVEL LOG_LEVEL_INFO
+#endif
+#endif
+
+#define log_at(level, ...) do { \
+    if ((level) >= LOG_COMPILE_LEVEL) log_message_ex((level), __VA_ARGS__); \
+} while (0)
+
+#define log_debug(...) log_at(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define log_info(...) log_at(LOG_LEVEL_INFO, __VA_ARGS__)
+#define log_warning(...) log_at(LOG_LEVEL_WARNING, __VA_ARGS__)
+#define log_error(...) log_at(LOG_LEVEL_ERROR, __VA_ARGS__)
 
 // ===== Memory Pool =====
 typedef struct {
@@ -0,0 +1,43 @@
+#define _POSIX_C_SOURCE 200809L
+
+// ===== Standard Library Headers =====
+#include <stdio.h>
+#include <stdatomic.h>
+
+// ===== Project Headers =====
+#include "plugin.h"
+#include "utils.h"
+
+// Log a status-class summary every LOGSTATS_INTERVAL responses
+#define LOGSTATS_INTERVAL 1000
+
+static _Atomic unsigned long responses = 0;
+static _Atomic unsigned long status_classes[6] = {0};
+
+static int logstats_post_response(Server *server, HookPhase phase, HookContext *ctx) {
+    (void)server;
+    (void)phase;
+    if (!ctx->response) return HOOK_CONTINUE;
+
+    int status_class = ctx->response->status_code / 100;
+    if (status_class < 1 || status_class > 5) status_class = 0;
+    atomic_fetch_add_explicit(&status_classes[status_class], 1, memory_order_relaxed);
+
+    unsigned long total = atomic_fetch_add_explicit(&responses, 1, memory_order_relaxed) + 1;
+    if (total % LOGSTATS_INTERVAL == 0) {
+        char log_msg[256];
+        snprintf(log_msg, sizeof(log_msg), "%lu responses: 2xx=%lu 3xx=%lu 4xx=%lu 5xx=%lu",
+                 total,
+                 atomic_load_explicit(&status_classes[2], memory_order_relaxed),
+                 atomic_load_explicit(&status_classes[3], memory_order_relaxed),
+                 atomic_load_explicit(&status_classes[4], memory_order_relaxed),
+                 atomic_load_explicit(&status_classes[5], memory_order_relaxed));
+        log_message("LOGSTATS", log_msg);
+    }
+    return HOOK_CONTINUE;
+}
+
+AIONIC_PLUGIN(
+    .name = "logstats",
+    .hooks = { [HOOK_POST_RESPONSE] = logstats_post_response },
+);
@@ -0,0 +1,402 @@
+#define _POSIX_C_SOURCE 200809L
+
+// ===== Standard Library Headers =====
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+// ===== Project Headers =====
+#include "access_log.h"
+#include "thread_ring.h"
+#include "utils.h"
+
+// ===== Constants =====
+#define ACCESS_RING_RECORDS 4096        // Records queued per thread, a power of two
+#define ACCESS_MAX_RULES 32
+#define ACCESS_ROUTE_MAX 64
+#define ACCESS_IDLE_WAIT_MS 10          // Writer sleep when every ring is empty
+#define ACCESS_FULL_RATE 1000000u       // Sampling rates are kept in millionths
+#define ACCESS_PATH_MAX 512
+
+_Static_assert(sizeof(AccessLogHeader) == 64, "access log header layout");
+_Static_assert(sizeof(AccessRecord) == 128, "access record layout");
+
+// One producer (the owning thread) and one consumer (the writer)
+typedef struct {
+    ThreadRing ring;                    // Positions and ownership
+    AccessRecord records[ACCESS_RING_RECORDS];
+} AccessRing;
+
+typedef struct {
+    char route[ACCESS_ROUTE_MAX];
+    size_t length;
+    int prefix;                         // Route ended in '*'
+    uint32_t rate_ppm;
+} SampleRule;
+
+// The request being recorded on this thread
+typedef struct {
+    int active;
+    uint64_t start_ns;
+    uint64_t timestamp_us;
+    uint32_t upstream_us;
+    uint16_t flags;
+    char model[sizeof(((AccessRecord *)0)->model)];
+} AccessRequest;
+
+// The open segment; only the writer thread touches it
+typedef struct {
+    int fd;
+    char *map;
+    size_t capacity;                    // Records that fit
+    uint64_t count;
+    unsigned sequence;                  // Segments opened so far
+    time_t retry_at;                    // After a failed open, try again from here
+} AccessSegment;
+
+// ===== Global Variables =====
+static _Atomic int access_enabled = 0;
+static ThreadRingList access_rings = THREAD_RING_LIST_INIT(AccessRing);
+static _Thread_local AccessRing *access_self = NULL;
+
+static _Thread_local AccessRequest access_current;
+static _Thread_local uint32_t sample_credit[ACCESS_MAX_RULES + 1];
+
+// Written before the server starts, read-only afterwards
+static SampleRule sample_rules[ACCESS_MAX_RULES];
+static int sample_rule_count = 0;
+
+static _Atomic uint64_t access_written = 0;
+static _Atomic uint64_t access_dropped = 0;
+
+static char access_prefix[ACCESS_PATH_MAX];
+static size_t access_segment_size = 0;
+static AccessSegment access_segment = {-1, NULL, 0, 0, 0, 0};
+
+static size_t drain_rings(void *unused);
+static void finish_writer(void *unused);
+static RingWriter access_writer = RING_WRITER_INIT(drain_rings, finish_writer, ACCESS_IDLE_WAIT_MS);
+
+// ===== Segment Files =====
+
+static AccessLogHeader *segment_header(void) {
+    return (AccessLogHeader *)access_segment.map;
+}
+
+// "<prefix>-YYYYmmdd-HHMMSS-<n>.bin"; an existing name moves on to the next n
+static int open_segment(void) {
+    time_t now = time(NULL);
+    struct tm tm_info;
+    localtime_r(&now, &tm_info);
+    char stamp[32];
+    strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", &tm_info);
+
+    char path[ACCESS_PATH_MAX + 64];
+    int fd = -1;
+    for (int attempt = 0; attempt < 100 && fd < 0; attempt++) {
+        snprintf(path, sizeof(path), "%s-%s-%u.bin", access_prefix, stamp, access_segment.sequence++);
+        fd = open(path, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+        if (fd < 0 && errno != EEXIST) {
+            break;
+        }
+    }
+    if (fd < 0) {
+        access_segment.retry_at = now + 1;
+        log_error("Cannot create access log segment %s: %s", path, strerror(errno));
+        return -1;
+    }
+
+    // The file is sized up front; untouched pages stay sparse
+    char *map = MAP_FAILED;
+    if (ftruncate(fd, (off_t)access_segment_size) == 0) {
+        map = mmap(NULL, access_segment_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    if (map == MAP_FAILED) {
+        access_segment.retry_at = now + 1;
+        log_error("Cannot map access log segment %s: %s", path, strerror(errno));
+        close(fd);
+        unlink(path);
+        return -1;
+    }
+
+    access_segment.fd = fd;
+    access_segment.map = map;
+    access_segment.capacity = (access_segment_size - sizeof(AccessLogHeader)) / sizeof(AccessRecord);
+    access_segment.count = 0;
+
+    AccessLogHeader *header = segment_header();
+    memcpy(header->magic, ACCESS_LOG_MAGIC, sizeof(header->magic));
+    header->version = ACCESS_LOG_VERSION;
+    header->record_size = sizeof(AccessRecord);
+    header->created_at = (int64_t)now;
+    header->record_count = 0;
+    return 0;
+}
+
+// Trim the file to the records written and let writeback finish it
+static void close_segment(void) {
+    if (!access_segment.map) {
+        return;
+    }
+
+    segment_header()->record_count = access_segment.count;
+    munmap(access_segment.map, access_segment_size);
+    if (ftruncate(access_segment.fd, (off_t)(sizeof(AccessLogHeader) +
+                                             access_segment.count * sizeof(AccessRecord))) != 0) {
+        log_warning("Cannot trim access log segment: %s", strerror(errno));
+    }
+    close(access_segment.fd);
+    access_segment.fd = -1;
+    access_segment.map = NULL;
+}
+
+// ===== Writer Thread =====
+
+// Copy everything queued into the segment; returns the number of records taken
+static size_t drain_rings(void *unused) {
+    (void)unused;
+    size_t total = 0;
+
+    for (ThreadRing *next = thread_ring_first(&access_rings); next; next = next->next) {
+        AccessRing *ring = (AccessRing *)next;
+        size_t head = atomic_load_explicit(&ring->ring.head, memory_order_relaxed);
+        size_t tail = atomic_load_explicit(&ring->ring.tail, memory_order_acquire);
+
+        while (head != tail) {
+            if (access_segment.map && access_segment.count == access_segment.capacity) {
+                close_segment();
+            }
+            if (!access_segment.map && (time(NULL) < access_segment.retry_at || open_segment() != 0)) {
+                // Nowhere to write: the queued records are lost
+                atomic_fetch_add_explicit(&access_dropped, tail - head, memory_order_relaxed);
+                atomic_store_explicit(&ring->ring.head, tail, memory_order_release);
+                break;
+            }
+
+            size_t offset = head & (ACCESS_RING_RECORDS - 1);
+            size_t chunk = tail - head;
+            if (chunk > ACCESS_RING_RECORDS - offset) chunk = ACCESS_RING_RECORDS - offset;
+            if (chunk > access_segment.capacity - access_segment.count) {
+                chunk = access_segment.capacity - access_segment.count;
+            }
+
+            memcpy(access_segment.map + sizeof(AccessLogHeader) + access_segment.count * sizeof(AccessRecord),
+                   &ring->records[offset], chunk * sizeof(AccessRecord));
+            access_segment.count += chunk;
+            head += chunk;
+            total += chunk;
+            atomic_store_explicit(&ring->ring.head, head, memory_order_release);
+            atomic_fetch_add_explicit(&access_written, chunk, memory_order_relaxed);
+        }
+    }
+
+    if (total > 0 && access_segment.map) {
+        segment_header()->record_count = access_segment.count;
+    }
+    return total;
+}
+
+// After the last pass
+static void finish_writer(void *unused) {
+    (void)unused;
+    close_segment();
+}
+
+// ===== Per-Thread Rings =====
+
+static AccessRing *claim_ring(void) {
+    if (!access_self) {
+        access_self = (AccessRing *)thread_ring_claim(&access_rings);
+    }
+    return access_self;
+}
+
+// ===== Sampling =====
+
+// Index of the first matching rule, ACCESS_MAX_RULES for none
+static int find_rule(const char *route) {
+    size_t length = strlen(route);
+    for (int i = 0; i < sample_rule_count; i++) {
+        const SampleRule *rule = &sample_rules[i];
+        if (rule->prefix ? length >= rule->length && memcmp(route, rule->route, rule->length) == 0
+                         : length == rule->length && memcmp(route, rule->route, length) == 0) {
+            return i;
+        }
+    }
+    return ACCESS_MAX_RULES;
+}
+
+// Each thread keeps a credit per rule, so a rate of 1/n keeps exactly every nth request
+static int sample_keep(const char *route, uint32_t *rate_ppm) {
+    int rule = find_rule(route);
+    *rate_ppm = rule < ACCESS_MAX_RULES ? sample_rules[rule].rate_ppm : ACCESS_FULL_RATE;
+
+    sample_credit[rule] += *rate_ppm;
+    if (sample_credit[rule] < ACCESS_FULL_RATE) {
+        return 0;
+    }
+    sample_credit[rule] -= ACCESS_FULL_RATE;
+    return 1;
+}
+
+int access_log_set_sample_rate(const char *route, double rate) {
+    if (!route || !*route || rate < 0.0 || rate > 1.0 || sample_rule_count >= ACCESS_MAX_RULES) {
+        return -1;
+    }
+
+    SampleRule *rule = &sample_rules[sample_rule_count];
+    snprintf(rule->route, sizeof(rule->route), "%s", route);
+    rule->length = strlen(rule->route);
+    rule->prefix = rule->route[rule->length - 1] == '*';
+    if (rule->prefix) {
+        rule->route[--rule->length] = '\0';
+    }
+    rule->rate_ppm = (uint32_t)(rate * ACCESS_FULL_RATE + 0.5);
+    sample_rule_count++;
+    return 0;
+}
+
+// ===== Recording =====
+
+static void copy_field(char *field, size_t size, const char *value) {
+    size_t length = value ? strnlen(value, size - 1) : 0;
+    memcpy(field, value ? value : "", length);
+    memset(field + length, 0, size - length);
+}
+
+int access_log_is_enabled(void) {
+    return atomic_load_explicit(&access_enabled, memory_order_relaxed);
+}
+
+void access_log_request_begin(void) {
+    access_current.active = 0;
+    if (!atomic_load_explicit(&access_enabled, memory_order_relaxed)) {
+        return;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    access_current.timestamp_us = (uint64_t)now.tv_sec * 1000000ULL + (uint64_t)now.tv_nsec / 1000;
+    access_current.start_ns = get_current_time_ns();
+    access_current.upstream_us = 0;
+    access_current.flags = 0;
+    access_current.model[0] = '\0';
+    access_current.active = 1;
+}
+
+uint64_t access_log_now(void) {
+    return access_current.active ? get_current_time_ns() : 0;
+}
+
+void access_log_note_upstream(const char *model, uint64_t start, int cache_hit) {
+    if (!access_current.active) {
+        return;
+    }
+
+    if (start) {
+        uint64_t now = get_current_time_ns();
+        access_current.upstream_us = now > start ? (uint32_t)((now - start) / 1000) : 0;
+    }
+    if (cache_hit) {
+        access_current.flags |= ACCESS_FLAG_CACHE_HIT;
+    }
+    snprintf(access_current.model, sizeof(access_current.model), "%s", model ? model : "");
+}
+
+// Never waits: a record that does not fit is counted and dropped
+void access_log_request_end(const char *ip, const char *method, const char *route,
+                            int status_code, size_t bytes_in, size_t bytes_out) {
+    if (!access_current.active) {
+        return;
+    }
+    access_current.active = 0;
+
+    uint32_t rate_ppm;
+    if (!sample_keep(route ? route : "", &rate_ppm)) {
+        return;
+    }
+
+    AccessRing *ring = claim_ring();
+    if (!ring) {
+        atomic_fetch_add_explicit(&access_dropped, 1, memory_order_relaxed);
+        return;
+    }
+    size_t tail = atomic_load_explicit(&ring->ring.tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&ring->ring.head, memory_order_acquire);
+    if (tail - head == ACCESS_RING_RECORDS) {
+        atomic_fetch_add_explicit(&access_dropped, 1, memory_order_relaxed);
+        return;
+    }
+
+    uint64_t latency_us = (get_current_time_ns() - access_current.start_ns) / 1000;
+    AccessRecord *record = &ring->records[tail & (ACCESS_RING_RECORDS - 1)];
+    record->timestamp_us = access_current.timestamp_us;
+    record->latency_us = latency_us > UINT32_MAX ? UINT32_MAX : (uint32_t)latency_us;
+    record->upstream_us = access_current.upstream_us;
+    record->bytes_in = bytes_in > UINT32_MAX ? UINT32_MAX : (uint32_t)bytes_in;
+    record->bytes_out = bytes_out > UINT32_MAX ? UINT32_MAX : (uint32_t)bytes_out;
+    record->sample_ppm = rate_ppm;
+    record->status = (uint16_t)status_code;
+    record->flags = access_current.flags;
+    copy_field(record->ip, sizeof(record->ip), ip);
+    copy_field(record->method, sizeof(record->method), method);
+    copy_field(record->route, sizeof(record->route), route);
+    copy_field(record->model, sizeof(record->model), access_current.model);
+    atomic_store_explicit(&ring->ring.tail, tail + 1, memory_order_release);
+}
+
+void access_log_get_counts(uint64_t *written, uint64_t *dropped) {
+    if (written) *written = atomic_load_explicit(&access_written, memory_order_relaxed);
+    if (dropped) *dropped = atomic_load_explicit(&access_dropped, memory_order_relaxed);
+}
+
+// ===== Lifecycle =====
+
+int access_log_init(const char *prefix, size_t segment_size) {
+    if (!prefix || !*prefix || strlen(prefix) >= sizeof(access_prefix) ||
+        atomic_load(&access_enabled)) {
+        return -1;
+    }
+    snprintf(access_prefix, sizeof(access_prefix), "%s", prefix);
+
+    // At least one record per segment, whole pages for the mapping
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    if (segment_size < sizeof(AccessLogHeader) + sizeof(AccessRecord)) {
+        segment_size = sizeof(AccessLogHeader) + sizeof(AccessRecord);
+    }
+    access_segment_size = (segment_size + page - 1) / page * page;
+
+    if (open_segment() != 0) {
+        return -1;
+    }
+
+    if (ring_writer_start(&access_writer, NULL) != 0) {
+        close_segment();
+        return -1;
+    }
+    atomic_store_explicit(&access_enabled, 1, memory_order_release);
+
+    log_info("Access log writing %zu KB segments to %s-*.bin", access_segment_size / 1024, access_prefix);
+    return 0;
+}
+
+void access_log_cleanup(void) {
+    if (!atomic_exchange(&access_enabled, 0)) {
+        return;
+    }
+
+    ring_writer_stop(&access_writer);
+
+    uint64_t written, dropped;
+    access_log_get_counts(&written, &dropped);
+    log_info("Access log closed: %llu records written, %llu dropped",
+             (unsigned long long)written, (unsigned long long)dropped);
+}
@@ -0,0 +1,171 @@
+#define _GNU_SOURCE
+
+// ===== Standard Library Headers =====
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sched.h>
+#include <pthread.h>
+#include <dirent.h>
+
+// ===== Project Headers =====
+#include "affinity.h"
+#include "utils.h"
+
+// ===== Global Variables =====
+static int *worker_cpus = NULL;     // Indexed by worker id
+static int worker_total = 0;
+static int *cpu_workers = NULL;     // Indexed by CPU, -1 when no worker fits
+static int cpu_total = 0;
+
+// ===== Topology =====
+int affinity_cpu_node(int cpu) {
+    char path[64];
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d", cpu);
+    DIR *dir = opendir(path);
+    if (!dir) return -1;
+
+    // The CPU's directory links to its node as "node<N>"
+    int node = -1;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (strncmp(entry->d_name, "node", 4) == 0 && entry->d_name[4] >= '0' && entry->d_name[4] <= '9') {
+            node = atoi(entry->d_name + 4);
+            break;
+        }
+    }
+    closedir(dir);
+    return node;
+}
+
+// Allowed CPUs ordered one per node per round; returns how many, -1 on error
+static int ordered_cpus(int *order, int capacity) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) != 0) return -1;
+
+    int cpus[CPU_SETSIZE];
+    int nodes[CPU_SETSIZE];
+    int count = 0;
+    for (int cpu = 0; cpu < CPU_SETSIZE && count < capacity; cpu++) {
+        if (CPU_ISSET(cpu, &set)) {
+            cpus[count] = cpu;
+            nodes[count] = affinity_cpu_node(cpu);
+            count++;
+        }
+    }
+
+    int placed = 0;
+    while (placed < count) {
+        // One round: the lowest unplaced CPU of each node, nodes in order of first appearance
+        int round_nodes[CPU_SETSIZE];
+        int round_count = 0;
+        for (int i = 0; i < count; i++) {
+            if (cpus[i] < 0) continue;
+            int seen = 0;
+            for (int j = 0; j < round_count && !seen; j++) {
+                seen = round_nodes[j] == nodes[i];
+            }
+            if (seen) continue;
+            round_nodes[round_count++] = nodes[i];
+            order[placed++] = cpus[i];
+            cpus[i] = -1;
+        }
+    }
+    return count;
+}
+
+// ===== Public API =====
+int affinity_init(int worker_count) {
+    if (worker_count <= 0) return -1;
+    affinity_cleanup();
+
+    int order[CPU_SETSIZE];
+    int count = ordered_cpus(order, CPU_SETSIZE);
+    if (count <= 0) {
+        log_error("Cannot read the CPU set for worker placement");
+        return -1;
+    }
+
+    long configured = sysconf(_SC_NPROCESSORS_CONF);
+    cpu_total = configured > 0 && configured <= CPU_SETSIZE ? (int)configured : CPU_SETSIZE;
+    worker_cpus = malloc(sizeof(int) * (size_t)worker_count);
+    cpu_workers = malloc(sizeof(int) * (size_t)cpu_total);
+    if (!worker_cpus || !cpu_workers) {
+        affinity_cleanup();
+        return -1;
+    }
+    worker_total = worker_count;
+
+    for (int cpu = 0; cpu < cpu_total; cpu++) {
+        cpu_workers[cpu] = -1;
+    }
+    for (int i = 0; i < worker_count; i++) {
+        worker_cpus[i] = order[i % count];
+        if (worker_cpus[i] < cpu_total && cpu_workers[worker_cpus[i]] < 0) {
+            cpu_workers[worker_cpus[i]] = i;
+        }
+    }
+
+    // CPUs without a worker (including ones outside our CPU set that may still
+    // take interrupts) go to the workers of their node, spread by CPU number
+    int pinned_count = worker_count < count ? worker_count : count;
+    int pinned_nodes[CPU_SETSIZE];
+    for (int i = 0; i < pinned_count; i++) {
+        pinned_nodes[i] = affinity_cpu_node(worker_cpus[i]);
+    }
+    for (int cpu = 0; cpu < cpu_total; cpu++) {
+        if (cpu_workers[cpu] >= 0) continue;
+        int node = affinity_cpu_node(cpu);
+        if (node < 0) continue;
+
+        int local[CPU_SETSIZE];
+        int local_count = 0;
+        for (int i = 0; i < pinned_count; i++) {
+            if (pinned_nodes[i] == node) {
+                local[local_count++] = i;
+            }
+        }
+        if (local_count > 0) {
+            cpu_workers[cpu] = local[cpu % local_count];
+        }
+    }
+
+    log_info("Planned %d workers over %d CPUs", worker_count, count);
+    return 0;
+}
+
+void affinity_cleanup(void) {
+    free(worker_cpus);
+    free(cpu_workers);
+    worker_cpus = NULL;
+    cpu_workers = NULL;
+    worker_total = 0;
+    cpu_total = 0;
+}
+
+int affinity_worker_cpu(int worker_id) {
+    if (!worker_cpus || worker_id < 0 || worker_id >= worker_total) return -1;
+    return worker_cpus[worker_id];
+}
+
+int affinity_pin_worker(int worker_id) {
+    int cpu = affinity_worker_cpu(worker_id);
+    if (cpu < 0) return -1;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+        log_warning("Worker %d: cannot pin to CPU %d", worker_id, cpu);
+        return -1;
+    }
+    log_debug("Worker %d pinned to CPU %d (node %d)", worker_id, cpu, affinity_cpu_node(cpu));
+    return 0;
+}
+
+int affinity_steer(int cpu) {
+    if (!cpu_workers || cpu < 0 || cpu >= cpu_total) return -1;
+    return cpu_workers[cpu];
+}
@@ -0,0 +1,502 @@
+#define _POSIX_C_SOURCE 200809L
+
+// ===== Standard Library Headers =====
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <immintrin.h>
+
+// ===== Project Headers =====
+#include "bpe.h"
+#include "utils.h"
+
+#define BPE_BLOCK_SIZE   64
+#define BPE_NO_RANK      UINT32_MAX
+#define BPE_STACK_PIECE  256         // Longest piece merged without a heap allocation
+
+struct BpeVocab {
+    const uint8_t *map;
+    size_t map_size;
+    uint32_t token_count;
+    uint32_t hash_mask;
+    const uint32_t *tokens;         // token_count x {offset, length}
+    const uint32_t *hash;           // rank + 1 per slot, 0 when empty
+    const uint8_t *bytes;
+    uint32_t byte_rank[256];        // Rank of every single-byte token
+};
+
+// ===== Vocabulary =====
+
+// Eight bytes per step; tools/build_bpe_vocab.py places tokens with the same function
+static inline uint64_t bpe_hash(const uint8_t *data, size_t length) {
+    uint64_t h = 0x9e3779b97f4a7c15ULL ^ (length * 0xff51afd7ed558ccdULL);
+    while (length > 0) {
+        uint64_t chunk = 0;
+        size_t n = length < 8 ? length : 8;
+        memcpy(&chunk, data, n);        // Little-endian, zero-padded
+        h = (h ^ chunk) * 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 32;
+        data += n;
+        length -= n;
+    }
+    h ^= h >> 29;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    return h ^ (h >> 32);
+}
+
+static inline uint32_t vocab_rank(const BpeVocab *vocab, const uint8_t *data, size_t length) {
+    uint32_t slot = (uint32_t)bpe_hash(data, length) & vocab->hash_mask;
+    for (;;) {
+        uint32_t entry = vocab->hash[slot];
+        if (entry == 0) return BPE_NO_RANK;
+
+        const uint32_t *token = &vocab->tokens[(entry - 1) * 2];
+        if (token[1] == length && memcmp(vocab->bytes + token[0], data, length) == 0) {
+            return entry - 1;
+        }
+        slot = (slot + 1) & vocab->hash_mask;
+    }
+}
+
+int bpe_vocab_open(const char *path, BpeVocab **out) {
+    if (!path || !out) return -1;
+    *out = NULL;
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(BpeFileHeader)) {
+        close(fd);
+        return -1;
+    }
+
+    // Read-only shared mapping: pages come straight from the page cache
+    size_t size = (size_t)st.st_size;
+    void *map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return -1;
+
+    BpeVocab *vocab = calloc(1, sizeof(BpeVocab));
+    if (!vocab) {
+        munmap(map, size);
+        return -1;
+    }
+    vocab->map = map;
+    vocab->map_size = size;
+
+    const BpeFileHeader *header = map;
+    int valid = memcmp(header->magic, BPE_FILE_MAGIC, sizeof(header->magic)) == 0 &&
+                header->version == BPE_FILE_VERSION &&
+                header->pattern == BPE_PATTERN_CL100K &&
+                header->token_count > 0 &&
+                header->hash_slots > header->token_count &&
+                (header->hash_slots & (header->hash_slots - 1)) == 0 &&
+                header->tokens_offset % 4 == 0 && header->hash_offset % 4 == 0 &&
+                header->tokens_offset <= size && (size - header->tokens_offset) / 8 >= header->token_count &&
+                header->hash_offset <= size && (size - header->hash_offset) / 4 >= header->hash_slots &&
+                header->bytes_offset <= size && size - header->bytes_offset >= header->bytes_size;
+
+    if (valid) {
+        vocab->token_count = header->token_count;
+        vocab->hash_mask = header->hash_slots - 1;
+        vocab->tokens = (const uint32_t *)(vocab->map + header->tokens_offset);
+        vocab->hash = (const uint32_t *)(vocab->map + header->hash_offset);
+        vocab->bytes = vocab->map + header->bytes_offset;
+
+        for (uint32_t rank = 0; valid && rank < vocab->token_count; rank++) {
+            const uint32_t *token = &vocab->tokens[rank * 2];
+            valid = token[0] <= header->bytes_size && header->bytes_size - token[0] >= token[1];
+        }
+        for (uint32_t slot = 0; valid && slot <= vocab->hash_mask; slot++) {
+            valid = vocab->hash[slot] <= vocab->token_count;
+        }
+        // Every byte must be a token of its own, or some text could not be encoded
+        for (int byte = 0; valid && byte < 256; byte++) {
+            uint8_t b = (uint8_t)byte;
+            vocab->byte_rank[byte] = vocab_rank(vocab, &b, 1);
+            valid = vocab->byte_rank[byte] != BPE_NO_RANK;
+        }
+    }
+
+    if (!valid) {
+        bpe_vocab_close(vocab);
+        return -1;
+    }
+
+    *out = vocab;
+    return 0;
+}
+
+void bpe_vocab_close(BpeVocab *vocab) {
+    if (!vocab) return;
+    munmap((void *)vocab->map, vocab->map_size);
+    free(vocab);
+}
+
+uint32_t bpe_vocab_size(const BpeVocab *vocab) {
+    return vocab ? vocab->token_count : 0;
+}
+
+const uint8_t *bpe_token_bytes(const BpeVocab *vocab, uint32_t rank, size_t *length) {
+    if (!vocab || rank >= vocab->token_count) return NULL;
+    const uint32_t *token = &vocab->tokens[rank * 2];
+    if (length) *length = token[1];
+    return vocab->bytes + token[0];
+}
+
+// ===== Pre-tokenizer =====
+// Implements the cl100k pattern
+//   's|'t|'re|'ve|'m|'ll|'d (any case) | [^\r\n\p{L}\p{N}]?\p{L}+ | \p{N}{1,3}
+//   | ' '?[^\s\p{L}\p{N}]+[\r\n]* | \s*[\r\n]+ | \s+(?!\S) | \s+
+// over byte classes. Runs are found from per-block class bitmasks.
+
+enum {
+    CLASS_LETTER,
+    CLASS_DIGIT,
+    CLASS_SPACE,        // ' ', \t, \v, \f
+    CLASS_NEWLINE,      // \r, \n
+    CLASS_OTHER,
+    CLASS_COUNT
+};
+
+#define CLASS_BIT(c) (1u << (c))
+#define CLASS_WHITESPACE (CLASS_BIT(CLASS_SPACE) | CLASS_BIT(CLASS_NEWLINE))
+
+typedef struct {
+    const uint8_t *text;
+    size_t length;
+    size_t base;                        // Offset of the classified block
+    uint64_t masks[CLASS_COUNT];
+    void (*classify)(const uint8_t *block, uint64_t masks[CLASS_COUNT]);
+} PreTokenizer;
+
+static inline int byte_class(uint8_t c) {
+    if (c >= 0x80 || (uint8_t)((c | 0x20) - 'a') < 26) return CLASS_LETTER;
+    if ((uint8_t)(c - '0') < 10) return CLASS_DIGIT;
+    if (c == '\n' || c == '\r') return CLASS_NEWLINE;
+    if (c == ' ' || c == '\t' || c == '\v' || c == '\f') return CLASS_SPACE;
+    return CLASS_OTHER;
+}
+
+__attribute__((target("avx2")))
+static void classify_block_avx2(const uint8_t *block, uint64_t masks[CLASS_COUNT]) {
+    uint64_t letter = 0, digit = 0, space = 0, newline = 0;
+
+    for (int half = 0; half < 2; half++) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(block + half * 32));
+        __m256i folded = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+
+        // Signed compares: bytes >= 0x80 are negative and fall outside every ASCII range
+        __m256i is_alpha = _mm256_and_si256(_mm256_cmpgt_epi8(folded, _mm256_set1_epi8('a' - 1)),
+                                            _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), folded));
+        __m256i is_digit = _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8('0' - 1)),
+                                            _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), v));
+        __m256i is_newline = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')),
+                                             _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r')));
+        __m256i is_space = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t'))),
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\v')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\f'))));
+
+        int shift = half * 32;
+        letter |= ((uint64_t)(uint32_t)_mm256_movemask_epi8(is_alpha) |
+                   (uint64_t)(uint32_t)_mm256_movemask_epi8(v)) << shift;
+        digit |= (uint64_t)(uint32_t)_mm256_movemask_epi8(is_digit) << shift;
+        space |= (uint64_t)(uint32_t)_mm256_movemask_epi8(is_space) << shift;
+        newline |= (uint64_t)(uint32_t)_mm256_movemask_epi8(is_newline) << shift;
+    }
+
+    masks[CLASS_LETTER] = letter;
+    masks[CLASS_DIGIT] = digit;
+    masks[CLASS_SPACE] = space;
+    masks[CLASS_NEWLINE] = newline;
+    masks[CLASS_OTHER] = ~(letter | digit | space | newline);
+}
+
+static void classify_block_sse2(const uint8_t *block, uint64_t masks[CLASS_COUNT]) {
+    uint64_t letter = 0, digit = 0, space = 0, newline = 0;
+
+    for (int lane = 0; lane < 4; lane++) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(block + lane * 16));
+        __m128i folded = _mm_or_si128(v, _mm_set1_epi8(0x20));
+
+        __m128i is_alpha = _mm_and_si128(_mm_cmpgt_epi8(folded, _mm_set1_epi8('a' - 1)),
+                                         _mm_cmpgt_epi8(_mm_set1_epi8('z' + 1), folded));
+        __m128i is_digit = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('0' - 1)),
+                                         _mm_cmpgt_epi8(_mm_set1_epi8('9' + 1), v));
+        __m128i is_newline = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')),
+                                          _mm_cmpeq_epi8(v, _mm_set1_epi8('\r')));
+        __m128i is_space = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\t'))),
+            _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\v')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\f'))));
+
+        int shift = lane * 16;
+        letter |= ((uint64_t)(uint16_t)_mm_movemask_epi8(is_alpha) |
+                   (uint64_t)(uint16_t)_mm_movemask_epi8(v)) << shift;
+        digit |= (uint64_t)(uint16_t)_mm_movemask_epi8(is_digit) << shift;
+        space |= (uint64_t)(uint16_t)_mm_movemask_epi8(is_space) << shift;
+        newline |= (uint64_t)(uint16_t)_mm_movemask_epi8(is_newline) << shift;
+    }
+
+    masks[CLASS_LETTER] = letter;
+    masks[CLASS_DIGIT] = digit;
+    masks[CLASS_SPACE] = space;
+    masks[CLASS_NEWLINE] = newline;
+    masks[CLASS_OTHER] = ~(letter | digit | space | newline);
+}
+
+static void pretokenizer_load_block(PreTokenizer *pt, size_t base) {
+    const uint8_t *block = pt->text + base;
+    uint8_t tail[BPE_BLOCK_SIZE];
+    if (pt->length - base < BPE_BLOCK_SIZE) {
+        // Padding is classified as OTHER; runs are clamped to the text length
+        memset(tail, 0, sizeof(tail));
+        memcpy(tail, block, pt->length - base);
+        block = tail;
+    }
+    pt->classify(block, pt->masks);
+    pt->base = base;
+}
+
+// First position at or after `pos` whose class is not in `classes`
+static size_t run_end(PreTokenizer *pt, size_t pos, unsigned classes) {
+    while (pos < pt->length) {
+        size_t base = pos & ~(size_t)(BPE_BLOCK_SIZE - 1);
+        if (pt->base != base) pretokenizer_load_block(pt, base);
+
+        uint64_t in_run = 0;
+        for (int c = 0; c < CLASS_COUNT; c++) {
+            if (classes & CLASS_BIT(c)) in_run |= pt->masks[c];
+        }
+
+        uint64_t outside = ~(in_run >> (pos - base));
+        if (outside != 0 && (size_t)__builtin_ctzll(outside) < BPE_BLOCK_SIZE - (pos - base)) {
+            pos += (size_t)__builtin_ctzll(outside);
+            return pos < pt->length ? pos : pt->length;
+        }
+        pos = base + BPE_BLOCK_SIZE;
+    }
+    return pt->length;
+}
+
+static inline int class_at(const PreTokenizer *pt, size_t pos) {
+    return pos < pt->length ? byte_class(pt->text[pos]) : -1;
+}
+
+// Contractions: 's 't 'm 'd 're 've 'll, in any case
+static size_t contraction_length(const PreTokenizer *pt, size_t pos) {
+    if (pt->text[pos] != '\'' || pos + 1 >= pt->length) return 0;
+
+    int c1 = pt->text[pos + 1] | 0x20;
+    if (c1 == 's' || c1 == 't' || c1 == 'm' || c1 == 'd') return 2;
+    if (pos + 2 >= pt->length) return 0;
+
+    int c2 = pt->text[pos + 2] | 0x20;
+    if ((c1 == 'r' && c2 == 'e') || (c1 == 'v' && c2 == 'e') || (c1 == 'l' && c2 == 'l')) return 3;
+    return 0;
+}
+
+// End of the piece starting at `pos` (< length)
+static size_t next_piece(PreTokenizer *pt, size_t pos) {
+    size_t contraction = contraction_length(pt, pos);
+    if (contraction) return pos + contraction;
+
+    int c = class_at(pt, pos);
+
+    // [^\r\n\p{L}\p{N}]?\p{L}+
+    if (c == CLASS_LETTER) return run_end(pt, pos, CLASS_BIT(CLASS_LETTER));
+    if ((c == CLASS_SPACE || c == CLASS_OTHER) && class_at(pt, pos + 1) == CLASS_LETTER) {
+        return run_end(pt, pos + 1, CLASS_BIT(CLASS_LETTER));
+    }
+
+    // \p{N}{1,3}
+    if (c == CLASS_DIGIT) {
+        size_t end = run_end(pt, pos, CLASS_BIT(CLASS_DIGIT));
+        return end - pos > 3 ? pos + 3 : end;
+    }
+
+    // ' '?[^\s\p{L}\p{N}]+[\r\n]*
+    size_t start = pos;
+    if (pt->text[pos] == ' ' && class_at(pt, pos + 1) == CLASS_OTHER) start = pos + 1;
+    if (class_at(pt, start) == CLASS_OTHER) {
+        size_t end = run_end(pt, start, CLASS_BIT(CLASS_OTHER));
+        return run_end(pt, end, CLASS_BIT(CLASS_NEWLINE));
+    }
+
+    // Whitespace: \s*[\r\n]+, then \s+(?!\S), then \s+
+    size_t end = run_end(pt, pos, CLASS_WHITESPACE);
+    for (size_t i = end; i > pos; i--) {
+        if (class_at(pt, i - 1) == CLASS_NEWLINE) return i;
+    }
+    if (end == pt->length || end - pos == 1) return end;
+    return end - 1;     // The last space goes with the next piece
+}
+
+// ===== Merging =====
+
+typedef struct {
+    uint32_t rank;
+    uint32_t pos;
+} MergeCandidate;
+
+static inline int candidate_less(MergeCandidate a, MergeCandidate b) {
+    // Lowest rank first, leftmost among equals (as tiktoken)
+    return a.rank < b.rank || (a.rank == b.rank && a.pos < b.pos);
+}
+
+static void heap_push(MergeCandidate *heap, size_t *size, MergeCandidate item) {
+    size_t i = (*size)++;
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (!candidate_less(item, heap[parent])) break;
+        heap[i] = heap[parent];
+        i = parent;
+    }
+    heap[i] = item;
+}
+
+static MergeCandidate heap_pop(MergeCandidate *heap, size_t *size) {
+    MergeCandidate top = heap[0];
+    MergeCandidate last = heap[--(*size)];
+    size_t i = 0;
+    for (;;) {
+        size_t child = 2 * i + 1;
+        if (child >= *size) break;
+        if (child + 1 < *size && candidate_less(heap[child + 1], heap[child])) child++;
+        if (!candidate_less(heap[child], last)) break;
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = last;
+    return top;
+}
+
+// Working memory for one piece of n bytes
+typedef struct {
+    uint32_t *next;             // Start of the following part, n at the end
+    uint32_t *prev;
+    uint32_t *token;            // Rank of the part starting here
+    uint32_t *pair;             // Rank of this part merged with the next, BPE_NO_RANK if none
+    MergeCandidate *heap;       // At most 3n pushes: n initial pairs, two per merge
+} MergeSpace;
+
+static size_t merge_space_size(size_t n) {
+    return n * (4 * sizeof(uint32_t)) + 3 * n * sizeof(MergeCandidate);
+}
+
+static void merge_space_init(MergeSpace *space, void *memory, size_t n) {
+    space->heap = memory;
+    space->next = (uint32_t *)(space->heap + 3 * n);
+    space->prev = space->next + n;
+    space->token = space->prev + n;
+    space->pair = space->token + n;
+}
+
+static inline uint32_t pair_rank(const BpeVocab *vocab, const uint8_t *piece, const MergeSpace *space,
+                                 uint32_t pos, uint32_t n) {
+    uint32_t next = space->next[pos];
+    if (next >= n) return BPE_NO_RANK;
+    return vocab_rank(vocab, piece + pos, space->next[next] - pos);
+}
+
+// Merge the bytes of one piece and emit its tokens; returns the token count or -1
+static long merge_piece(const BpeVocab *vocab, const uint8_t *piece, uint32_t n, size_t offset,
+                        BpeEmit emit, void *ctx, int *stop) {
+    unsigned char stack_memory[BPE_STACK_PIECE * (4 * sizeof(uint32_t) + 3 * sizeof(MergeCandidate))]
+        __attribute__((aligned(8)));
+    void *memory = stack_memory;
+    if (n > BPE_STACK_PIECE && !(memory = malloc(merge_space_size(n)))) return -1;
+
+    MergeSpace space;
+    merge_space_init(&space, memory, n);
+
+    size_t heap_size = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        space.next[i] = i + 1;
+        space.prev[i] = i ? i - 1 : UINT32_MAX;
+        space.token[i] = vocab->byte_rank[piece[i]];
+    }
+    for (uint32_t i = 0; i + 1 < n; i++) {
+        space.pair[i] = vocab_rank(vocab, piece + i, 2);
+        if (space.pair[i] != BPE_NO_RANK) heap_push(space.heap, &heap_size, (MergeCandidate){space.pair[i], i});
+    }
+    space.pair[n - 1] = BPE_NO_RANK;
+
+    while (heap_size > 0) {
+        MergeCandidate best = heap_pop(space.heap, &heap_size);
+        uint32_t pos = best.pos;
+        if (space.next[pos] == 0 || space.pair[pos] != best.rank) continue;    // Stale
+
+        // Absorb the next part
+        uint32_t absorbed = space.next[pos];
+        uint32_t after = space.next[absorbed];
+        space.next[pos] = after;
+        if (after < n) space.prev[after] = pos;
+        space.next[absorbed] = 0;           // Marks the part as gone
+        space.token[pos] = best.rank;
+
+        space.pair[pos] = pair_rank(vocab, piece, &space, pos, n);
+        if (space.pair[pos] != BPE_NO_RANK) {
+            heap_push(space.heap, &heap_size, (MergeCandidate){space.pair[pos], pos});
+        }
+        uint32_t before = space.prev[pos];
+        if (before != UINT32_MAX) {
+            space.pair[before] = pair_rank(vocab, piece, &space, before, n);
+            if (space.pair[before] != BPE_NO_RANK) {
+                heap_push(space.heap, &heap_size, (MergeCandidate){space.pair[before], before});
+            }
+        }
+    }
+
+    long count = 0;
+    for (uint32_t pos = 0; pos < n; pos = space.next[pos]) {
+        count++;
+        if (emit && !*stop && emit(ctx, space.token[pos], offset + pos, space.next[pos] - pos) != 0) {
+            *stop = 1;
+        }
+    }
+
+    if (memory != stack_memory) free(memory);
+    return count;
+}
+
+// ===== Encoding =====
+
+long bpe_encode(const BpeVocab *vocab, const char *text, size_t length, BpeEmit emit, void *ctx) {
+    if (!vocab || (!text && length)) return -1;
+
+    PreTokenizer pt = {
+        .text = (const uint8_t *)text,
+        .length = length,
+        .base = SIZE_MAX,
+        .classify = has_avx2_support() ? classify_block_avx2 : classify_block_sse2
+    };
+
+    long count = 0;
+    int stop = 0;
+    size_t pos = 0;
+    while (pos < length && !stop) {
+        size_t end = next_piece(&pt, pos);
+        const uint8_t *piece = pt.text + pos;
+        size_t n = end - pos;
+
+        // Most pieces are a token of their own
+        uint32_t rank = n == 1 ? vocab->byte_rank[piece[0]] : vocab_rank(vocab, piece, n);
+        if (rank != BPE_NO_RANK) {
+            count++;
+            if (emit && emit(ctx, rank, pos, n) != 0) stop = 1;
+        } else {
+            long merged = merge_piece(vocab, piece, (uint32_t)n, pos, emit, ctx, &stop);
+            if (merged < 0) return -1;
+            count += merged;
+        }
+        pos = end;
+    }
+
+    return count;
+}
@@ -0,0 +1,300 @@
+#define _POSIX_C_SOURCE 200809L
+
+// ===== Standard Library Headers =====
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+
+// ===== Project Headers =====
+#include "embeddings.h"
+#include "prompt_router.h"
+#include "json.h"
+#include "utils.h"
+
+#define EMBED_MODEL_NAME_MAX 128
+
+// A request waiting for its share of a batch; lives on the requester's stack
+typedef struct {
+    const char *const *inputs;
+    int count;
+    int offset;                     // Position of the first input within the batch
+    EmbeddingResult *result;
+    int status;
+    int done;                       // Set by the leader once status and result are final
+} EmbedWaiter;
+
+typedef struct EmbedBatch {
+    char model[EMBED_MODEL_NAME_MAX];
+    int waiter_count;
+    int input_count;
+    int closed;                     // No longer accepting requests
+    struct EmbedBatch *next;
+    EmbedWaiter *waiters[];         // max_inputs slots; every waiter brings at least one input
+} EmbedBatch;
+
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;            // Signals full batches and answered waiters
+    EmbedBatch *open;               // Batches still accepting requests
+    char default_model[EMBED_MODEL_NAME_MAX];
+    uint64_t window_ns;
+    int max_inputs;
+    int initialized;
+
+    _Atomic uint64_t requests;
+    _Atomic uint64_t inputs;
+    _Atomic uint64_t batches;
+    _Atomic uint64_t failed_batches;
+} EmbeddingBatcher;
+
+static EmbeddingBatcher global_batcher;
+
+// ===== Upstream Call =====
+
+// Copy each vector of the upstream answer to the waiter that asked for it.
+// Returns -1 unless every input of the batch received a vector.
+static int distribute_vectors(const char *body, EmbedWaiter **waiters, int waiter_count, int input_count) {
+    JsonDoc doc;
+    if (json_doc_parse(&doc, body, strlen(body)) != 0) return -1;
+
+    JsonCursor root, data, item, field;
+    JsonIter it;
+    int filled = 0;
+    if (json_doc_root(&doc, &root) == 0 && json_object_get(&root, "data", &data) == 0 &&
+        json_array_begin(&data, &it) == 0) {
+        while (json_array_next(&it, &item) == 1) {
+            int64_t index;
+            JsonSlice vector;
+            if (json_object_get(&item, "index", &field) != 0 || json_get_int64(&field, &index) != 0 ||
+                json_object_get(&item, "embedding", &field) != 0 || json_get_raw(&field, &vector) != 0 ||
+                index < 0 || index >= input_count) {
+                continue;
+            }
+
+            for (int i = 0; i < waiter_count; i++) {
+                EmbedWaiter *waiter = waiters[i];
+                if (index < waiter->offset || index >= waiter->offset + waiter->count) continue;
+
+                char **slot = &waiter->result->vectors[index - waiter->offset];
+                if (!*slot && (*slot = strndup(vector.ptr, vector.len))) filled++;
+                break;
+            }
+        }
+    }
+
+    json_doc_free(&doc);
+    return filled == input_count ? 0 : -1;
+}
+
+// Send the inputs of every waiter upstream in one call and record the outcome
+static void run_batch(const char *model_name, EmbedWaiter **waiters, int waiter_count, int input_count) {
+    int status = PROMPT_ROUTE_ERROR;
+    char *body = NULL;
+    const char *served_model = NULL;
+
+    const char **inputs = malloc(sizeof(char *) * input_count);
+    if (inputs) {
+        for (int i = 0; i < waiter_count; i++) {
+            memcpy(&inputs[waiters[i]->offset], waiters[i]->inputs, sizeof(char *) * waiters[i]->count);
+        }
+
+        status = prompt_router_embed(model_name, inputs, input_count, &body, &served_model);
+        if (status == 0 && distribute_vectors(body, waiters, waiter_count, input_count) != 0) {
+            log_message("EMBEDDINGS", "Upstream answer is missing vectors");
+            status = PROMPT_ROUTE_ERROR;
+        }
+    }
+
+    atomic_fetch_add_explicit(&global_batcher.batches, 1, memory_order_relaxed);
+    if (status != 0) {
+        atomic_fetch_add_explicit(&global_batcher.failed_batches, 1, memory_order_relaxed);
+    }
+
+    for (int i = 0; i < waiter_count; i++) {
+        waiters[i]->status = status;
+        if (status == 0) {
+            snprintf(waiters[i]->result->model, sizeof(waiters[i]->result->model), "%s", served_model);
+        }
+    }
+
+    free(body);
+    free(inputs);
+}
+
+// ===== Batching =====
+
+// Called with the lock held
+static EmbedBatch *find_open_batch(const char *model_name, int count) {
+    for (EmbedBatch *batch = global_batcher.open; batch; batch = batch->next) {
+        if (!batch->closed && batch->input_count + count <= global_batcher.max_inputs &&
+            strcmp(batch->model, model_name) == 0) {
+            return batch;
+        }
+    }
+    return NULL;
+}
+
+// Called with the lock held
+static void batch_join(EmbedBatch *batch, EmbedWaiter *waiter) {
+    waiter->offset = batch->input_count;
+    batch->waiters[batch->waiter_count++] = waiter;
+    batch->input_count += waiter->count;
+    if (batch->input_count >= global_batcher.max_inputs) {
+        // Full: wake the leader before its window ends
+        batch->closed = 1;
+        pthread_cond_broadcast(&global_batcher.cond);
+    }
+}
+
+// Called with the lock held
+static void batch_unlink(EmbedBatch *batch) {
+    for (EmbedBatch **link = &global_batcher.open; *link; link = &(*link)->next) {
+        if (*link == batch) {
+            *link = batch->next;
+            return;
+        }
+    }
+}
+
+// Lead a new batch: wait out the window (or until the batch fills up), then
+// send it and release the requests that joined
+static void lead_batch(EmbedBatch *batch) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    uint64_t nsec = (uint64_t)deadline.tv_nsec + global_batcher.window_ns;
+    deadline.tv_sec += (time_t)(nsec / 1000000000ULL);
+    deadline.tv_nsec = (long)(nsec % 1000000000ULL);
+
+    while (!batch->closed) {
+        if (pthread_cond_timedwait(&global_batcher.cond, &global_batcher.lock, &deadline) == ETIMEDOUT) {
+            break;
+        }
+    }
+    batch->closed = 1;
+    batch_unlink(batch);
+    pthread_mutex_unlock(&global_batcher.lock);
+
+    // Nobody else touches a closed, unlinked batch
+    run_batch(batch->model, batch->waiters, batch->waiter_count, batch->input_count);
+
+    pthread_mutex_lock(&global_batcher.lock);
+    for (int i = 0; i < batch->waiter_count; i++) {
+        batch->waiters[i]->done = 1;
+    }
+    pthread_cond_broadcast(&global_batcher.cond);
+}
+
+int embeddings_create(const char *model_name, const char *const *inputs, int count, EmbeddingResult *result) {
+    if (!inputs || count <= 0 || !result || !global_batcher.initialized) {
+        return PROMPT_ROUTE_ERROR;
+    }
+
+    memset(result, 0, sizeof(EmbeddingResult));
+    result->vectors = calloc(count, sizeof(char *));
+    if (!result->vectors) {
+        return PROMPT_ROUTE_ERROR;
+    }
+    result->count = count;
+
+    if (!model_name) model_name = global_batcher.default_model;
+    atomic_fetch_add_explicit(&global_batcher.requests, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&global_batcher.inputs, (uint64_t)count, memory_order_relaxed);
+
+    EmbedWaiter waiter = {inputs, count, 0, result, PROMPT_ROUTE_ERROR, 0};
+
+    if (global_batcher.window_ns == 0 || count >= global_batcher.max_inputs ||
+        strlen(model_name) >= EMBED_MODEL_NAME_MAX) {
+        // Nothing to gain from waiting (or no batch can be keyed by the name)
+        EmbedWaiter *self = &waiter;
+        run_batch(model_name, &self, 1, count);
+    } else {
+        pthread_mutex_lock(&global_batcher.lock);
+
+        EmbedBatch *batch = find_open_batch(model_name, count);
+        if (batch) {
+            batch_join(batch, &waiter);
+            while (!waiter.done) {
+                pthread_cond_wait(&global_batcher.cond, &global_batcher.lock);
+            }
+        } else if ((batch = calloc(1, sizeof(EmbedBatch) + sizeof(EmbedWaiter *) * global_batcher.max_inputs))) {
+            snprintf(batch->model, sizeof(batch->model), "%s", model_name);
+            batch->next = global_batcher.open;
+            global_batcher.open = batch;
+            batch_join(batch, &waiter);
+            lead_batch(batch);
+            free(batch);
+        }
+
+        pthread_mutex_unlock(&global_batcher.lock);
+    }
+
+    if (waiter.status != 0) {
+        embeddings_result_free(result);
+    }
+    return waiter.status;
+}
+
+void embeddings_result_free(EmbeddingResult *result) {
+    if (!result) return;
+    for (int i = 0; result->vectors && i < result->count; i++) {
+        free(result->vectors[i]);
+    }
+    free(result->vectors);
+    memset(result, 0, sizeof(EmbeddingResult));
+}
+
+// ===== Lifecycle =====
+
+int embeddings_init(const char *default_model, double window_ms, int max_inputs) {
+    if (!default_model || window_ms < 0.0 || max_inputs <= 0) {
+        return -1;
+    }
+
+    EmbeddingBatcher *batcher = &global_batcher;
+    memset(batcher, 0, sizeof(EmbeddingBatcher));
+
+    // Batch windows are measured on the monotonic clock
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    int failed = pthread_mutex_init(&batcher->lock, NULL) != 0 ||
+                 pthread_cond_init(&batcher->cond, &attr) != 0;
+    pthread_condattr_destroy(&attr);
+    if (failed) {
+        return -1;
+    }
+
+    snprintf(batcher->default_model, sizeof(batcher->default_model), "%s", default_model);
+    batcher->window_ns = (uint64_t)(window_ms * 1000000.0);
+    batcher->max_inputs = max_inputs;
+    batcher->initialized = 1;
+
+    char log_msg[256];
+    snprintf(log_msg, sizeof(log_msg), "Embedding batcher initialized (%s, %.1f ms window, %d inputs)",
+             batcher->default_model, window_ms, max_inputs);
+    log_message("EMBEDDINGS", log_msg);
+    return 0;
+}
+
+void embeddings_get_stats(EmbeddingStats *stats) {
+    if (!stats) return;
+    stats->requests = atomic_load_explicit(&global_batcher.requests, memory_order_relaxed);
+    stats->inputs = atomic_load_explicit(&global_batcher.inputs, memory_order_relaxed);
+    stats->batches = atomic_load_explicit(&global_batcher.batches, memory_order_relaxed);
+    stats->failed_batches = atomic_load_explicit(&global_batcher.failed_batches, memory_order_relaxed);
+}
+
+void embeddings_cleanup(void) {
+    if (!global_batcher.initialized) return;
+
+    // Requests have drained with the worker threads; no batch is open
+    global_batcher.initialized = 0;
+    pthread_cond_destroy(&global_batcher.cond);
+    pthread_mutex_destroy(&global_batcher.lock);
+    log_message("EMBEDDINGS", "Embedding batcher cleaned up");
+}
@@ -0,0 +1,465 @@
+#define _POSIX_C_SOURCE 200809L
+
+// ===== Standard Library Headers =====
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+
+// ===== Project Headers =====
+#include "prompt_cache.h"
+#include "tokenizer.h"
+#include "utils.h"
+#include "asm_utils.h"
+
+#define PROMPT_CACHE_SHINGLE   2        // Tokens per shingle
+#define PROMPT_CACHE_BANDS     32       // LSH bands of PROMPT_CACHE_ROWS hashes each
+#define PROMPT_CACHE_ROWS      (PROMPT_CACHE_HASHES / PROMPT_CACHE_BANDS)
+#define PROMPT_CACHE_MAX_ROUTES 16
+#define PROMPT_CACHE_NONE      -1
+
+typedef struct {
+    PromptSketch sketch;            // Owns its shingle array
+    uint64_t band_keys[PROMPT_CACHE_BANDS];
+    int band_next[PROMPT_CACHE_BANDS];  // Next entry in the same band bucket
+    char *response;
+    char *served_model;
+    time_t expires;
+    int used;
+} CacheSlot;
+
+typedef struct {
+    char route[64];
+    double threshold;
+} RouteThreshold;
+
+typedef struct {
+    CacheSlot *slots;
+    int capacity;
+    int next_victim;                // Slots are reused in insertion order
+    int *buckets;                   // PROMPT_CACHE_BANDS tables of bucket_mask + 1 heads
+    uint32_t bucket_mask;
+    int ttl;
+    double default_threshold;
+    uint64_t verify_every;          // Re-check one hit in this many, 0 for never
+    RouteThreshold routes[PROMPT_CACHE_MAX_ROUTES];
+    int route_count;
+    pthread_rwlock_t lock;
+    int initialized;
+
+    _Atomic uint64_t lookups;
+    _Atomic uint64_t hits;
+    _Atomic uint64_t insertions;
+    _Atomic uint64_t evictions;
+    _Atomic uint64_t sampled;
+    _Atomic uint64_t false_matches;
+    _Atomic uint64_t entries;
+    _Atomic uint64_t verify_ticket;     // Counts candidate hits to pick the sampled ones
+} PromptCache;
+
+static PromptCache global_prompt_cache;
+
+// One seed per MinHash function, fixed so signatures are stable across runs;
+// hashing the (seed, shingle) pair keeps the functions independent of each other
+static uint32_t minhash_seeds[PROMPT_CACHE_HASHES];
+
+// ===== Hashing =====
+
+// murmur3 finalizers
+static uint32_t mix32(uint32_t h) {
+    h ^= h >> 16;
+    h *= 0x85ebca6bU;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35U;
+    h ^= h >> 16;
+    return h;
+}
+
+static uint64_t mix64(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+static uint64_t hash_string(uint64_t seed, const char *text) {
+    size_t length = text ? strlen(text) : 0;
+    return mix64(seed ^ ((uint64_t)crc32_asm(text ? text : "", length) << 32 | length));
+}
+
+static int compare_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+// ===== Sketches =====
+
+// Hash of one token without its surrounding whitespace (BPE tokens carry
+// their leading space); returns -1 for whitespace-only tokens
+static int token_hash(const char *text, size_t length, uint32_t *hash) {
+    char trimmed[256];
+    size_t trimmed_length = 0;
+    for (size_t i = 0; i < length && trimmed_length < sizeof(trimmed); i++) {
+        if (!isspace((unsigned char)text[i])) trimmed[trimmed_length++] = text[i];
+    }
+    if (trimmed_length == 0) return -1;
+    *hash = crc32_asm(trimmed, trimmed_length);
+    return 0;
+}
+
+// Sorted unique shingle hashes of the prompt's token sequence
+static int build_shingles(const char *prompt, uint32_t **out, int *out_count) {
+    // Token offsets, then hashes, share one buffer with the lowered prompt;
+    // no token is shorter than a byte
+    size_t length = strlen(prompt);
+    uint32_t *hashes = malloc(sizeof(uint32_t) * (length + 1) + length + 1);
+    if (!hashes) return -1;
+    char *lowered = (char *)(hashes + length + 1);
+
+    // Lowercased first: with a BPE vocabulary, casing also moves token boundaries
+    for (size_t i = 0; i <= length; i++) lowered[i] = (char)tolower((unsigned char)prompt[i]);
+
+    long encoded = tokenizer_encode(lowered, length, NULL, hashes, length + 1);
+    if (encoded < 0) {
+        free(hashes);
+        return -1;
+    }
+
+    // In-place is safe: token i's hash is written after its offsets are read
+    int token_count = 0;
+    for (long i = 0; i < encoded; i++) {
+        size_t start = hashes[i];
+        size_t end = i + 1 < encoded ? hashes[i + 1] : length;
+        if (token_hash(lowered + start, end - start, &hashes[token_count]) == 0) token_count++;
+    }
+
+    int count = token_count >= PROMPT_CACHE_SHINGLE ? token_count - PROMPT_CACHE_SHINGLE + 1 : 1;
+
+    if (token_count < PROMPT_CACHE_SHINGLE) {
+        // Too short for a full shingle: the whole prompt is one
+        uint32_t h = 0x9747b28cU;
+        for (int i = 0; i < token_count; i++) h = mix32(h ^ hashes[i]);
+        hashes[0] = h;
+    } else {
+        // In-place is safe: shingle i only reads tokens i and later
+        for (int i = 0; i < count; i++) {
+            uint32_t h = 0x9747b28cU;
+            for (int j = 0; j < PROMPT_CACHE_SHINGLE; j++) h = mix32(h ^ hashes[i + j]);
+            hashes[i] = h;
+        }
+    }
+
+    qsort(hashes, count, sizeof(uint32_t), compare_u32);
+    int unique = 0;
+    for (int i = 0; i < count; i++) {
+        if (unique == 0 || hashes[unique - 1] != hashes[i]) hashes[unique++] = hashes[i];
+    }
+
+    *out = hashes;
+    *out_count = unique;
+    return 0;
+}
+
+static double route_threshold(const char *route) {
+    for (int i = 0; route && i < global_prompt_cache.route_count; i++) {
+        if (strcmp(global_prompt_cache.routes[i].route, route) == 0) {
+            return global_prompt_cache.routes[i].threshold;
+        }
+    }
+    return global_prompt_cache.default_threshold;
+}
+
+int prompt_cache_sketch(PromptSketch *sketch, const char *route, const PromptRequest *request) {
+    if (!sketch || !request || !request->prompt || !global_prompt_cache.initialized) return -1;
+    memset(sketch, 0, sizeof(PromptSketch));
+
+    pthread_rwlock_rdlock(&global_prompt_cache.lock);
+    sketch->threshold = route_threshold(route);
+    pthread_rwlock_unlock(&global_prompt_cache.lock);
+    if (sketch->threshold <= 0.0) return -1;
+
+    if (build_shingles(request->prompt, &sketch->shingles, &sketch->shingle_count) != 0) return -1;
+
+    for (int i = 0; i < PROMPT_CACHE_HASHES; i++) sketch->minhash[i] = UINT32_MAX;
+    for (int s = 0; s < sketch->shingle_count; s++) {
+        uint32_t shingle = sketch->shingles[s];
+        for (int i = 0; i < PROMPT_CACHE_HASHES; i++) {
+            uint32_t h = (uint32_t)(mix64(((uint64_t)minhash_seeds[i] << 32) | shingle) >> 32);
+            if (h < sketch->minhash[i]) sketch->minhash[i] = h;
+        }
+    }
+
+    uint64_t scope = hash_string(0x70726f6d7074ULL, route);
+    scope = hash_string(scope, request->model_name);
+    sketch->scope = mix64(scope ^ (uint64_t)(uint32_t)request->max_tokens);
+    return 0;
+}
+
+void prompt_cache_sketch_free(PromptSketch *sketch) {
+    if (!sketch) return;
+    free(sketch->shingles);
+    sketch->shingles = NULL;
+    sketch->shingle_count = 0;
+}
+
+static uint64_t band_key(const PromptSketch *sketch, int band) {
+    uint64_t key = mix64(sketch->scope ^ (uint64_t)band);
+    for (int row = 0; row < PROMPT_CACHE_ROWS; row++) {
+        key = mix64(key ^ sketch->minhash[band * PROMPT_CACHE_ROWS + row]);
+    }
+    return key;
+}
+
+static double estimated_similarity(const PromptSketch *a, const PromptSketch *b) {
+    int equal = 0;
+    for (int i = 0; i < PROMPT_CACHE_HASHES; i++) {
+        if (a->minhash[i] == b->minhash[i]) equal++;
+    }
+    return (double)equal / PROMPT_CACHE_HASHES;
+}
+
+// Exact Jaccard similarity of two sorted shingle sets
+static double exact_similarity(const PromptSketch *a, const PromptSketch *b) {
+    int i = 0, j = 0, common = 0;
+    while (i < a->shingle_count && j < b->shingle_count) {
+        if (a->shingles[i] == b->shingles[j]) {
+            common++;
+            i++;
+            j++;
+        } else if (a->shingles[i] < b->shingles[j]) {
+            i++;
+        } else {
+            j++;
+        }
+    }
+    int total = a->shingle_count + b->shingle_count - common;
+    return total ? (double)common / total : 1.0;
+}
+
+// ===== Index =====
+
+static int *band_bucket(int band, uint64_t key) {
+    size_t buckets = (size_t)global_prompt_cache.bucket_mask + 1;
+    return &global_prompt_cache.buckets[band * buckets + (key & global_prompt_cache.bucket_mask)];
+}
+
+// Called with the write lock held
+static void slot_release(int index) {
+    CacheSlot *slot = &global_prompt_cache.slots[index];
+    if (!slot->used) return;
+
+    for (int band = 0; band < PROMPT_CACHE_BANDS; band++) {
+        int *link = band_bucket(band, slot->band_keys[band]);
+        while (*link != PROMPT_CACHE_NONE && *link != index) {
+            link = &global_prompt_cache.slots[*link].band_next[band];
+        }
+        if (*link == index) *link = slot->band_next[band];
+    }
+
+    prompt_cache_sketch_free(&slot->sketch);
+    free(slot->response);
+    free(slot->served_model);
+    slot->response = NULL;
+    slot->served_model = NULL;
+    slot->used = 0;
+    atomic_fetch_sub(&global_prompt_cache.entries, 1);
+}
+
+int prompt_cache_lookup(const PromptSketch *sketch, char *response, size_t response_size,
+                        char *served_model, size_t served_model_size) {
+    if (!sketch || !response || response_size == 0 || !global_prompt_cache.initialized) return -1;
+
+    atomic_fetch_add_explicit(&global_prompt_cache.lookups, 1, memory_order_relaxed);
+    time_t now = time(NULL);
+
+    pthread_rwlock_rdlock(&global_prompt_cache.lock);
+
+    // Best candidate over every band bucket the sketch falls into
+    const CacheSlot *best = NULL;
+    double best_similarity = 0.0;
+    for (int band = 0; band < PROMPT_CACHE_BANDS; band++) {
+        uint64_t key = band_key(sketch, band);
+        for (int index = *band_bucket(band, key); index != PROMPT_CACHE_NONE;
+             index = global_prompt_cache.slots[index].band_next[band]) {
+            const CacheSlot *slot = &global_prompt_cache.slots[index];
+            if (slot->band_keys[band] != key || slot->sketch.scope != sketch->scope || slot->expires < now) {
+                continue;
+            }
+            double similarity = estimated_similarity(sketch, &slot->sketch);
+            if (similarity > best_similarity) {
+                best = slot;
+                best_similarity = similarity;
+            }
+        }
+    }
+
+    int hit = best && best_similarity >= sketch->threshold;
+
+    // Sampled hits are checked against the exact similarity, which both
+    // measures the MinHash error rate and keeps that sample from being wrong
+    if (hit && global_prompt_cache.verify_every &&
+        atomic_fetch_add_explicit(&global_prompt_cache.verify_ticket, 1, memory_order_relaxed) %
+            global_prompt_cache.verify_every == 0) {
+        atomic_fetch_add_explicit(&global_prompt_cache.sampled, 1, memory_order_relaxed);
+        if (exact_similarity(sketch, &best->sketch) < sketch->threshold) {
+            atomic_fetch_add_explicit(&global_prompt_cache.false_matches, 1, memory_order_relaxed);
+            hit = 0;
+        }
+    }
+
+    if (hit) {
+        snprintf(response, response_size, "%s", best->response);
+        if (served_model && served_model_size) {
+            snprintf(served_model, served_model_size, "%s", best->served_model);
+        }
+        atomic_fetch_add_explicit(&global_prompt_cache.hits, 1, memory_order_relaxed);
+    }
+
+    pthread_rwlock_unlock(&global_prompt_cache.lock);
+    return hit ? 0 : -1;
+}
+
+int prompt_cache_store(const PromptSketch *sketch, const char *response, const char *served_model) {
+    if (!sketch || !response || !served_model || !global_prompt_cache.initialized) return -1;
+
+    // Copy everything before taking the lock
+    uint32_t *shingles = malloc(sizeof(uint32_t) * (sketch->shingle_count ? sketch->shingle_count : 1));
+    char *response_copy = strdup(response);
+    char *model_copy = strdup(served_model);
+    if (!shingles || !response_copy || !model_copy) {
+        free(shingles);
+        free(response_copy);
+        free(model_copy);
+        return -1;
+    }
+    memcpy(shingles, sketch->shingles, sizeof(uint32_t) * sketch->shingle_count);
+
+    pthread_rwlock_wrlock(&global_prompt_cache.lock);
+
+    int index = global_prompt_cache.next_victim;
+    global_prompt_cache.next_victim = (index + 1) % global_prompt_cache.capacity;
+    CacheSlot *slot = &global_prompt_cache.slots[index];
+    if (slot->used) {
+        slot_release(index);
+        atomic_fetch_add_explicit(&global_prompt_cache.evictions, 1, memory_order_relaxed);
+    }
+
+    slot->sketch = *sketch;
+    slot->sketch.shingles = shingles;
+    slot->response = response_copy;
+    slot->served_model = model_copy;
+    slot->expires = time(NULL) + global_prompt_cache.ttl;
+    slot->used = 1;
+
+    for (int band = 0; band < PROMPT_CACHE_BANDS; band++) {
+        slot->band_keys[band] = band_key(sketch, band);
+        int *head = band_bucket(band, slot->band_keys[band]);
+        slot->band_next[band] = *head;
+        *head = index;
+    }
+
+    pthread_rwlock_unlock(&global_prompt_cache.lock);
+
+    atomic_fetch_add_explicit(&global_prompt_cache.entries, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&global_prompt_cache.insertions, 1, memory_order_relaxed);
+    return 0;
+}
+
+// ===== Lifecycle =====
+
+int prompt_cache_init(int capacity, int ttl_seconds, double default_threshold, double verify_percent) {
+    if (capacity <= 0 || ttl_seconds <= 0 || default_threshold < 0.0 || default_threshold > 1.0) {
+        return -1;
+    }
+
+    PromptCache *cache = &global_prompt_cache;
+    memset(cache, 0, sizeof(PromptCache));
+
+    uint32_t buckets = 16;
+    while (buckets < (uint32_t)capacity * 2) buckets <<= 1;
+
+    cache->slots = calloc(capacity, sizeof(CacheSlot));
+    cache->buckets = malloc(sizeof(int) * buckets * PROMPT_CACHE_BANDS);
+    if (!cache->slots || !cache->buckets || pthread_rwlock_init(&cache->lock, NULL) != 0) {
+        free(cache->slots);
+        free(cache->buckets);
+        return -1;
+    }
+    for (size_t i = 0; i < (size_t)buckets * PROMPT_CACHE_BANDS; i++) {
+        cache->buckets[i] = PROMPT_CACHE_NONE;
+    }
+
+    uint64_t seed = 0x5eed5eed5eed5eedULL;
+    for (int i = 0; i < PROMPT_CACHE_HASHES; i++) {
+        seed = mix64(seed + 0x9E3779B97F4A7C15ULL);
+        minhash_seeds[i] = (uint32_t)seed;
+    }
+
+    cache->capacity = capacity;
+    cache->bucket_mask = buckets - 1;
+    cache->ttl = ttl_seconds;
+    cache->default_threshold = default_threshold;
+    cache->verify_every = verify_percent > 0.0 ? (uint64_t)(100.0 / verify_percent + 0.5) : 0;
+    if (verify_percent > 0.0 && cache->verify_every == 0) cache->verify_every = 1;
+    cache->initialized = 1;
+
+    char log_msg[256];
+    snprintf(log_msg, sizeof(log_msg), "Prompt cache initialized (%d entries, threshold %.2f)",
+             capacity, default_threshold);
+    log_message("PROMPT_CACHE", log_msg);
+    return 0;
+}
+
+int prompt_cache_set_threshold(const char *route, double threshold) {
+    if (!route || threshold < 0.0 || threshold > 1.0 || !global_prompt_cache.initialized) return -1;
+
+    pthread_rwlock_wrlock(&global_prompt_cache.lock);
+
+    RouteThreshold *entry = NULL;
+    for (int i = 0; i < global_prompt_cache.route_count; i++) {
+        if (strcmp(global_prompt_cache.routes[i].route, route) == 0) entry = &global_prompt_cache.routes[i];
+    }
+    if (!entry && global_prompt_cache.route_count < PROMPT_CACHE_MAX_ROUTES) {
+        entry = &global_prompt_cache.routes[global_prompt_cache.route_count++];
+        snprintf(entry->route, sizeof(entry->route), "%s", route);
+    }
+    if (entry) entry->threshold = threshold;
+
+    pthread_rwlock_unlock(&global_prompt_cache.lock);
+    return entry ? 0 : -1;
+}
+
+void prompt_cache_get_stats(PromptCacheStats *stats) {
+    if (!stats) return;
+    stats->entries = atomic_load(&global_prompt_cache.entries);
+    stats->lookups = atomic_load(&global_prompt_cache.lookups);
+    stats->hits = atomic_load(&global_prompt_cache.hits);
+    stats->insertions = atomic_load(&global_prompt_cache.insertions);
+    stats->evictions = atomic_load(&global_prompt_cache.evictions);
+    stats->sampled = atomic_load(&global_prompt_cache.sampled);
+    stats->false_matches = atomic_load(&global_prompt_cache.false_matches);
+}
+
+void prompt_cache_cleanup(void) {
+    if (!global_prompt_cache.initialized) return;
+
+    pthread_rwlock_wrlock(&global_prompt_cache.lock);
+    for (int i = 0; i < global_prompt_cache.capacity; i++) {
+        slot_release(i);
+    }
+    free(global_prompt_cache.slots);
+    free(global_prompt_cache.buckets);
+    global_prompt_cache.slots = NULL;
+    global_prompt_cache.buckets = NULL;
+    global_prompt_cache.initialized = 0;
+    pthread_rwlock_unlock(&global_prompt_cache.lock);
+    pthread_rwlock_destroy(&global_prompt_cache.lock);
+
+    log_message("PROMPT_CACHE", "Prompt cache cleaned up");
+}
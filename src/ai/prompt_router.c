@@ -4,6 +4,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <math.h>
 #include <pthread.h>
 
 // ===== External Library for Networking (HTTPS) =====
@@ -12,34 +15,538 @@
 // ===== Project Headers =====
 #include "prompt_router.h"
 #include "parser.h"
+#include "json.h"
+#include "pipeline.h"
+#include "rcu.h"
+#include "stats.h"
 #include "utils.h"
 #include "asm_utils.h"
 
+// ===== Replica Selection Tuning =====
+#define REPLICA_EWMA_TAU_NS      5000000000ULL   // Latency estimate decay constant (5s)
+#define REPLICA_EJECT_FAILURES   3               // Consecutive failures before ejection
+#define REPLICA_EJECT_BASE_MS    5000            // First ejection period
+#define REPLICA_EJECT_MAX_MS     60000           // Cap for the doubling ejection period
+#define MODEL_INDEX_MIN_SLOTS    8
+
+// ===== Hedging Tuning =====
+#define TTFT_WINDOW              256             // Recent time-to-first-byte samples per model
+#define HEDGE_MIN_SAMPLES        32              // Samples needed before hedging starts
+#define HEDGE_REFRESH_SAMPLES    32              // Recompute the hedge delay this often
+#define HEDGE_MIN_DELAY_NS       10000000ULL     // Never hedge sooner than 10ms
+#define HEDGE_TOKEN_SCALE        1000            // Budget tokens are kept in thousandths
+#define HEDGE_BURST              10              // Hedges allowed back to back
+#define HEDGE_DEFAULT_PERCENTILE 95.0
+#define HEDGE_DEFAULT_BUDGET     5.0             // Percent of requests
+
+// ===== Circuit Breaker Tuning =====
+#define BREAKER_WINDOW           32              // Recent outcomes per model
+#define BREAKER_MIN_CALLS        10              // Outcomes needed before the breaker can trip
+#define BREAKER_HALF_OPEN_CALLS  3               // Trial requests that must succeed to close
+#define BREAKER_DEFAULT_RATE     50.0            // Percent of failed or slow calls that trips
+#define BREAKER_DEFAULT_SLOW_MS  10000           // Calls slower than this count against the model
+#define BREAKER_DEFAULT_OPEN_MS  10000           // Time spent open before trial requests
+#define MODEL_FALLBACK_MAX_HOPS  4               // Models tried per request, fallbacks included
+
+#define UPSTREAM_DEFAULT_TIMEOUT_MS 30000        // Whole upstream attempt, connect included
+
+typedef enum {
+    BREAKER_CLOSED = 0,
+    BREAKER_OPEN,
+    BREAKER_HALF_OPEN
+} BreakerState;
+
+// State and opening time share one word so a transition swaps both at once
+#define BREAKER_STATE_BITS       2
+#define BREAKER_WORD(state, opened_ns) (((uint64_t)(opened_ns) << BREAKER_STATE_BITS) | (uint64_t)(state))
+#define BREAKER_WORD_STATE(word) ((int)((word) & ((1u << BREAKER_STATE_BITS) - 1)))
+#define BREAKER_WORD_OPENED(word) ((word) >> BREAKER_STATE_BITS)
+
+typedef enum {
+    OUTCOME_OK = 0,
+    OUTCOME_FAILED,
+    OUTCOME_SLOW
+} CallOutcome;
+
+// One upstream endpoint serving a model. Selection state is updated with
+// relaxed atomics by whichever worker completes a request; small races only
+// blur the estimates.
+typedef struct {
+    char *endpoint;
+    _Atomic uint64_t ewma_ns;           // Peak-sensitive latency estimate
+    _Atomic uint64_t ewma_stamp_ns;     // Time of the last latency sample
+    _Atomic int inflight;
+    _Atomic int consecutive_failures;
+    _Atomic uint64_t ejected_until_ns;  // 0 while the replica is in rotation
+    _Atomic uint64_t eject_ms;          // Next ejection period, doubles after a failed probe
+    _Atomic int probing;                // A probe request is outstanding
+    _Atomic uint64_t requests;
+    _Atomic uint64_t failures;
+    _Atomic uint64_t hedges;            // Attempts started here as a hedge
+} __attribute__((aligned(64))) ModelReplica;
+
+// Immutable replica list; replicas are shared by successive sets
+typedef struct {
+    int count;
+    ModelReplica *replicas[];
+} ReplicaSet;
+
 // AI model structure definition
 typedef struct {
     char *name;
-    char *api_endpoint;
+    uint32_t name_hash;
     int max_tokens;
+    _Atomic int context_tokens;         // Prompt plus completion, 0 when unknown
     float temperature;
-    int is_available;
-    pthread_mutex_t mutex;
+    _Atomic int is_available;
+    ReplicaSet *_Atomic replicas;
+
+    // Hedging: a second attempt starts when the first has not produced a
+    // byte within the configured percentile of recent TTFT
+    _Atomic uint32_t ttft_us[TTFT_WINDOW];
+    _Atomic uint64_t ttft_count;
+    _Atomic uint64_t hedge_delay_ns;    // 0 until enough samples, or when disabled
+    _Atomic int64_t hedge_tokens;       // Budget, in 1/HEDGE_TOKEN_SCALE hedges
+    _Atomic double hedge_percentile;    // 0 disables hedging
+    _Atomic double hedge_budget;        // Percent of requests that may be hedged
+
+    // Circuit breaker over the model's recent outcomes
+    _Atomic uint8_t outcomes[BREAKER_WINDOW];
+    _Atomic uint64_t outcome_count;
+    _Atomic uint64_t breaker;           // BreakerState in the low bits, time it opened above
+    _Atomic int half_open_permits;      // Trial requests still to hand out
+    _Atomic int half_open_successes;
+    _Atomic double breaker_rate;        // Percent of bad calls that trips the breaker
+    _Atomic uint64_t breaker_slow_ns;
+    _Atomic uint64_t breaker_open_ns;
+
+    char *_Atomic fallback;             // Model to reroute to, NULL for none
 } AIModel;
 
+// Immutable model table with an open-addressed name index, published through
+// RCU so request threads look models up without taking a lock
+typedef struct {
+    int count;
+    uint32_t index_mask;
+    AIModel *default_model;
+    AIModel **index;            // index_mask + 1 slots, stored after models[]
+    AIModel *models[];
+} ModelTable;
+
 // Prompt router structure definition
 typedef struct {
-    AIModel *models;
-    int model_count;
-    int model_capacity;
-    pthread_mutex_t mutex;
-    char *default_model;
+    ModelTable *_Atomic table;
+    pthread_mutex_t mutex;      // Serializes writers
+    char *default_model;        // Writer side, resolved into each table
 } PromptRouter;
 
 static PromptRouter global_router;
 
+// Upper bound on one upstream attempt; a timed-out call fails like any transport error
+static _Atomic long upstream_timeout_ms = UPSTREAM_DEFAULT_TIMEOUT_MS;
+
+// ===== Model Table =====
+
+static uint32_t model_name_hash(const char *name) {
+    return crc32_asm(name, strlen(name));
+}
+
+static AIModel *table_lookup(const ModelTable *table, const char *name) {
+    if (!table || !name) return NULL;
+
+    uint32_t hash = model_name_hash(name);
+    for (uint32_t slot = hash & table->index_mask; table->index[slot];
+         slot = (slot + 1) & table->index_mask) {
+        AIModel *model = table->index[slot];
+        if (model->name_hash == hash && strcmp(model->name, name) == 0) {
+            return model;
+        }
+    }
+    return NULL;
+}
+
+// Build and publish a table holding `models`, skipping `except`.
+// Called with global_router.mutex held; returns the previous table to retire.
+static int publish_table(AIModel *const *models, int count, const AIModel *except,
+                         AIModel *extra, ModelTable **old_table) {
+    uint32_t slots = MODEL_INDEX_MIN_SLOTS;
+    while (slots < (uint32_t)(count + 1) * 2) slots <<= 1;
+
+    ModelTable *table = calloc(1, sizeof(ModelTable) + sizeof(AIModel *) * (count + 1 + slots));
+    if (!table) return -1;
+
+    table->index_mask = slots - 1;
+    table->index = table->models + count + 1;
+
+    for (int i = 0; i <= count; i++) {
+        AIModel *model = i < count ? models[i] : extra;
+        if (!model || model == except) continue;
+
+        table->models[table->count++] = model;
+        uint32_t slot = model->name_hash & table->index_mask;
+        while (table->index[slot]) slot = (slot + 1) & table->index_mask;
+        table->index[slot] = model;
+    }
+
+    if (global_router.default_model) {
+        table->default_model = table_lookup(table, global_router.default_model);
+    }
+
+    *old_table = atomic_exchange(&global_router.table, table);
+    return 0;
+}
+
+static void model_free(void *ptr) {
+    AIModel *model = ptr;
+    free(atomic_load(&model->fallback));
+    ReplicaSet *set = atomic_load(&model->replicas);
+    if (set) {
+        for (int i = 0; i < set->count; i++) {
+            free(set->replicas[i]->endpoint);
+            free(set->replicas[i]);
+        }
+        free(set);
+    }
+    free(model->name);
+    free(model);
+}
+
+static ModelReplica *replica_create(const char *endpoint) {
+    ModelReplica *replica = aligned_alloc(64, sizeof(ModelReplica));
+    if (!replica) return NULL;
+    memset(replica, 0, sizeof(ModelReplica));
+
+    replica->endpoint = strdup(endpoint);
+    if (!replica->endpoint) {
+        free(replica);
+        return NULL;
+    }
+    atomic_store(&replica->eject_ms, REPLICA_EJECT_BASE_MS);
+    return replica;
+}
+
+// ===== Replica Selection =====
+
+static uint64_t next_random(void) {
+    static _Thread_local uint64_t state = 0;
+    if (state == 0) {
+        state = get_current_time_ns() ^ (uint64_t)(uintptr_t)&state;
+        if (state == 0) state = 0x9E3779B97F4A7C15ULL;
+    }
+    // xorshift64
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+// Latency estimate, decayed since the last sample so an idle replica fades
+// back towards zero and is eventually tried again
+static double replica_latency_ns(ModelReplica *replica, uint64_t now) {
+    double ewma = (double)atomic_load_explicit(&replica->ewma_ns, memory_order_relaxed);
+    uint64_t stamp = atomic_load_explicit(&replica->ewma_stamp_ns, memory_order_relaxed);
+    if (now > stamp) {
+        ewma *= exp(-(double)(now - stamp) / REPLICA_EWMA_TAU_NS);
+    }
+    return ewma;
+}
+
+// Expected cost of sending one more request: latency times queue depth
+static double replica_cost(ModelReplica *replica, uint64_t now) {
+    int inflight = atomic_load_explicit(&replica->inflight, memory_order_relaxed);
+    return replica_latency_ns(replica, now) * (inflight + 1);
+}
+
+static void replica_observe_latency(ModelReplica *replica, uint64_t latency_ns, uint64_t now) {
+    uint64_t stamp = atomic_exchange_explicit(&replica->ewma_stamp_ns, now, memory_order_relaxed);
+    uint64_t ewma = atomic_load_explicit(&replica->ewma_ns, memory_order_relaxed);
+
+    if (latency_ns > ewma || stamp == 0) {
+        // Peak sensitivity: a slowdown takes effect on the very next pick
+        ewma = latency_ns;
+    } else {
+        double weight = now > stamp ? exp(-(double)(now - stamp) / REPLICA_EWMA_TAU_NS) : 1.0;
+        ewma = (uint64_t)(ewma * weight + latency_ns * (1.0 - weight));
+    }
+    atomic_store_explicit(&replica->ewma_ns, ewma, memory_order_relaxed);
+}
+
+// In rotation, or its ejection period is over and this caller won the probe
+static int replica_try_acquire(ModelReplica *replica, uint64_t now, int *probe) {
+    uint64_t ejected_until = atomic_load_explicit(&replica->ejected_until_ns, memory_order_relaxed);
+    if (ejected_until == 0) return 1;
+    if (now < ejected_until) return 0;
+
+    int expected = 0;
+    if (atomic_compare_exchange_strong(&replica->probing, &expected, 1)) {
+        *probe = 1;
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * Power-of-two-choices: sample two replicas and keep the cheaper one. Falls
+ * back to a scan of the replicas in rotation when a sample is ejected and, if
+ * every replica is ejected, to the one whose ejection ends first rather than
+ * failing outright. A hedge passes the replica already in use as `exclude`
+ * and gets NULL instead of an ejected replica.
+ */
+static ModelReplica *select_replica(const ReplicaSet *set, const ModelReplica *exclude, int *probe) {
+    *probe = 0;
+    if (!set || set->count == 0) return NULL;
+    if (set->count == 1) return exclude ? NULL : set->replicas[0];
+
+    uint64_t now = get_current_time_ns();
+    uint64_t r = next_random();
+    int a = (int)(r % (uint64_t)set->count);
+    int b = (int)((r >> 32) % (uint64_t)(set->count - 1));
+    if (b >= a) b++;
+
+    ModelReplica *first = set->replicas[a];
+    ModelReplica *second = set->replicas[b];
+    int first_ok = first != exclude && replica_try_acquire(first, now, probe);
+    if (*probe) return first;
+    int second_ok = second != exclude && replica_try_acquire(second, now, probe);
+    if (*probe) return second;
+
+    if (first_ok && second_ok) {
+        return replica_cost(first, now) <= replica_cost(second, now) ? first : second;
+    }
+
+    // An ejected sample would hand its partner the request unopposed
+    ModelReplica *best = NULL;
+    ModelReplica *soonest = set->replicas[0];
+    for (int i = 0; i < set->count; i++) {
+        ModelReplica *replica = set->replicas[i];
+        if (replica == exclude) continue;
+        if (replica_try_acquire(replica, now, probe)) {
+            if (*probe) return replica;
+            if (!best || replica_cost(replica, now) < replica_cost(best, now)) best = replica;
+        } else if (atomic_load(&replica->ejected_until_ns) < atomic_load(&soonest->ejected_until_ns)) {
+            soonest = replica;
+        }
+    }
+    if (best || exclude) return best;
+    return soonest;
+}
+
+static void replica_eject(ModelReplica *replica, const char *model_name, uint64_t now) {
+    uint64_t period = atomic_load(&replica->eject_ms);
+    atomic_store(&replica->ejected_until_ns, now + period * 1000000ULL);
+
+    uint64_t next = period * 2;
+    atomic_store(&replica->eject_ms, next > REPLICA_EJECT_MAX_MS ? REPLICA_EJECT_MAX_MS : next);
+
+    char log_msg[512];
+    snprintf(log_msg, sizeof(log_msg), "Replica %s of model %s ejected for %llums",
+             replica->endpoint, model_name, (unsigned long long)period);
+    log_message("AI_ROUTER", log_msg);
+}
+
+static void replica_release(ModelReplica *replica, const char *model_name, int probe,
+                            int success, uint64_t latency_ns) {
+    uint64_t now = get_current_time_ns();
+
+    atomic_fetch_sub_explicit(&replica->inflight, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&replica->requests, 1, memory_order_relaxed);
+    replica_observe_latency(replica, latency_ns, now);
+
+    int was_ejected = atomic_load(&replica->ejected_until_ns) != 0;
+
+    if (success) {
+        atomic_store_explicit(&replica->consecutive_failures, 0, memory_order_relaxed);
+        if (was_ejected) {
+            atomic_store(&replica->ejected_until_ns, 0);
+            atomic_store(&replica->eject_ms, REPLICA_EJECT_BASE_MS);
+
+            char log_msg[512];
+            snprintf(log_msg, sizeof(log_msg), "Replica %s of model %s back in rotation",
+                     replica->endpoint, model_name);
+            log_message("AI_ROUTER", log_msg);
+        }
+    } else {
+        atomic_fetch_add_explicit(&replica->failures, 1, memory_order_relaxed);
+        int failures = atomic_fetch_add(&replica->consecutive_failures, 1) + 1;
+        if (was_ejected ? probe : failures >= REPLICA_EJECT_FAILURES) {
+            replica_eject(replica, model_name, now);
+        }
+    }
+
+    if (probe) atomic_store(&replica->probing, 0);
+}
+
+// A hedging loser was cut off before its first byte: it was at least this
+// slow, but that is not a failure
+static void replica_cancel(ModelReplica *replica, int probe, uint64_t elapsed_ns) {
+    atomic_fetch_sub_explicit(&replica->inflight, 1, memory_order_relaxed);
+    replica_observe_latency(replica, elapsed_ns, get_current_time_ns());
+    if (probe) atomic_store(&replica->probing, 0);
+}
+
+// ===== Hedging =====
+
+static int compare_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+// Recompute the hedge delay from the TTFT window
+static void model_refresh_hedge_delay(AIModel *model, uint64_t count) {
+    double percentile = atomic_load_explicit(&model->hedge_percentile, memory_order_relaxed);
+    if (percentile <= 0.0 || count < HEDGE_MIN_SAMPLES) {
+        atomic_store_explicit(&model->hedge_delay_ns, 0, memory_order_relaxed);
+        return;
+    }
+
+    uint32_t samples[TTFT_WINDOW];
+    int n = count < TTFT_WINDOW ? (int)count : TTFT_WINDOW;
+    for (int i = 0; i < n; i++) {
+        samples[i] = atomic_load_explicit(&model->ttft_us[i], memory_order_relaxed);
+    }
+    qsort(samples, n, sizeof(uint32_t), compare_u32);
+
+    int rank = (int)(percentile / 100.0 * (n - 1) + 0.5);
+    if (rank >= n) rank = n - 1;
+    uint64_t delay = (uint64_t)samples[rank] * 1000ULL;
+    if (delay < HEDGE_MIN_DELAY_NS) delay = HEDGE_MIN_DELAY_NS;
+    atomic_store_explicit(&model->hedge_delay_ns, delay, memory_order_relaxed);
+}
+
+static void model_record_ttft(AIModel *model, uint64_t ttft_ns) {
+    uint64_t us = ttft_ns / 1000;
+    uint64_t n = atomic_fetch_add_explicit(&model->ttft_count, 1, memory_order_relaxed);
+    atomic_store_explicit(&model->ttft_us[n % TTFT_WINDOW], us > UINT32_MAX ? UINT32_MAX : (uint32_t)us,
+                          memory_order_relaxed);
+    if ((n + 1) % HEDGE_REFRESH_SAMPLES == 0) {
+        model_refresh_hedge_delay(model, n + 1);
+    }
+}
+
+// Every request earns budget% of a hedge, up to HEDGE_BURST stored hedges
+static void model_earn_hedge_budget(AIModel *model) {
+    double budget = atomic_load_explicit(&model->hedge_budget, memory_order_relaxed);
+    int64_t earn = (int64_t)(budget / 100.0 * HEDGE_TOKEN_SCALE);
+    int64_t tokens = atomic_fetch_add_explicit(&model->hedge_tokens, earn, memory_order_relaxed) + earn;
+    if (tokens > (int64_t)HEDGE_BURST * HEDGE_TOKEN_SCALE) {
+        atomic_fetch_sub_explicit(&model->hedge_tokens, earn, memory_order_relaxed);
+    }
+}
+
+static int model_take_hedge_budget(AIModel *model) {
+    int64_t tokens = atomic_load_explicit(&model->hedge_tokens, memory_order_relaxed);
+    while (tokens >= HEDGE_TOKEN_SCALE) {
+        if (atomic_compare_exchange_weak_explicit(&model->hedge_tokens, &tokens, tokens - HEDGE_TOKEN_SCALE,
+                                                  memory_order_relaxed, memory_order_relaxed)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// ===== Circuit Breaker =====
+
+static const char *breaker_state_names[] = {"closed", "open", "half_open"};
+
+static int breaker_state(AIModel *model) {
+    return BREAKER_WORD_STATE(atomic_load_explicit(&model->breaker, memory_order_acquire));
+}
+
+// Move from `expected` to `to`. Only the caller whose swap succeeds applies the
+// side effects; a loser leaves the state another transition owns untouched.
+static int breaker_transition(AIModel *model, uint64_t expected, int to, uint64_t now) {
+    uint64_t next = BREAKER_WORD(to, to == BREAKER_OPEN ? now : 0);
+    if (!atomic_compare_exchange_strong(&model->breaker, &expected, next)) return 0;
+
+    int from = BREAKER_WORD_STATE(expected);
+    if (to == BREAKER_HALF_OPEN) {
+        // Permits are handed out last, once the round's counters are reset
+        atomic_store(&model->half_open_successes, 0);
+        atomic_store(&model->half_open_permits, BREAKER_HALF_OPEN_CALLS);
+    } else {
+        // Leftover permits of a trial round must not leak into the next one
+        atomic_store(&model->half_open_permits, 0);
+    }
+    if (to == BREAKER_OPEN) {
+        // Cleared on opening, so the breaker later closes with a fresh window;
+        // only stragglers that started before the trip can still write to it
+        for (int i = 0; i < BREAKER_WINDOW; i++) atomic_store(&model->outcomes[i], OUTCOME_OK);
+        atomic_store(&model->outcome_count, 0);
+    }
+
+    char log_msg[256];
+    snprintf(log_msg, sizeof(log_msg), "Circuit breaker for model %s %s -> %s",
+             model->name, breaker_state_names[from], breaker_state_names[to]);
+    log_message("AI_ROUTER", log_msg);
+    return 1;
+}
+
+// May a request go to this model? `trial` is set for half-open trial requests
+static int breaker_allow(AIModel *model, int *trial) {
+    *trial = 0;
+    uint64_t word = atomic_load_explicit(&model->breaker, memory_order_acquire);
+    int state = BREAKER_WORD_STATE(word);
+    if (state == BREAKER_CLOSED) return 1;
+
+    if (state == BREAKER_OPEN) {
+        uint64_t now = get_current_time_ns();
+        if (now - BREAKER_WORD_OPENED(word) < atomic_load_explicit(&model->breaker_open_ns, memory_order_relaxed)) {
+            return 0;
+        }
+        // One caller opens the trial round; the others only compete for its permits
+        breaker_transition(model, word, BREAKER_HALF_OPEN, now);
+        if (breaker_state(model) != BREAKER_HALF_OPEN) return 0;
+    }
+
+    if (atomic_fetch_sub(&model->half_open_permits, 1) > 0) {
+        *trial = 1;
+        return 1;
+    }
+    return 0;
+}
+
+static void breaker_record(AIModel *model, int trial, int success, uint64_t latency_ns) {
+    uint64_t now = get_current_time_ns();
+    CallOutcome outcome = !success ? OUTCOME_FAILED
+                        : latency_ns > atomic_load_explicit(&model->breaker_slow_ns, memory_order_relaxed)
+                              ? OUTCOME_SLOW : OUTCOME_OK;
+    uint64_t word = atomic_load_explicit(&model->breaker, memory_order_acquire);
+    int state = BREAKER_WORD_STATE(word);
+
+    if (state == BREAKER_HALF_OPEN) {
+        // Only trial requests decide; stragglers from before the trip are ignored
+        if (!trial) return;
+        if (outcome != OUTCOME_OK) {
+            breaker_transition(model, word, BREAKER_OPEN, now);
+        } else if (atomic_fetch_add(&model->half_open_successes, 1) + 1 >= BREAKER_HALF_OPEN_CALLS) {
+            breaker_transition(model, word, BREAKER_CLOSED, now);
+        }
+        return;
+    }
+    if (state != BREAKER_CLOSED) return;
+
+    uint64_t n = atomic_fetch_add_explicit(&model->outcome_count, 1, memory_order_relaxed);
+    atomic_store_explicit(&model->outcomes[n % BREAKER_WINDOW], (uint8_t)outcome, memory_order_relaxed);
+    if (++n < BREAKER_MIN_CALLS) return;
+
+    // Slots not written since the window was reset read as OUTCOME_OK
+    int calls = n < BREAKER_WINDOW ? (int)n : BREAKER_WINDOW;
+    int bad = 0;
+    for (int i = 0; i < BREAKER_WINDOW; i++) {
+        if (atomic_load_explicit(&model->outcomes[i], memory_order_relaxed) != OUTCOME_OK) bad++;
+    }
+
+    double rate = atomic_load_explicit(&model->breaker_rate, memory_order_relaxed);
+    if (bad * 100.0 >= rate * calls) {
+        breaker_transition(model, word, BREAKER_OPEN, now);
+    }
+}
+
 // === Helper: Structure to hold CURL response data ===
 struct MemoryStruct {
     char *memory;
     size_t size;
+    uint64_t first_byte_ns;     // Arrival of the first body byte, 0 until then
 };
 
 // === Helper: CURL Write Callback ===
@@ -48,10 +555,20 @@ static size_t WriteMemoryCallback(void *contents, size_t size, size_t nmemb, voi
     size_t realsize = size * nmemb;
     struct MemoryStruct *mem = (struct MemoryStruct *)userp;
 
+    if (mem->first_byte_ns == 0) {
+        mem->first_byte_ns = get_current_time_ns();
+    }
+
+    // A negative hook result aborts the transfer
+    HookContext hook = {-1, NULL, NULL, (const char *)contents, realsize};
+    if (pipeline_run(HOOK_ON_UPSTREAM_CHUNK, NULL, &hook) < 0) {
+        return 0;
+    }
+
     char *ptr = realloc(mem->memory, mem->size + realsize + 1);
     if (!ptr) {
         // Out of memory!
-        printf("[AI_ROUTER] Error: Not enough memory (realloc returned NULL)\n");
+        log_error("[AI_ROUTER] Not enough memory (realloc returned NULL)");
         return 0;
     }
 
@@ -64,20 +581,25 @@ static size_t WriteMemoryCallback(void *contents, size_t size, size_t nmemb, voi
 }
 
 // === Helper: Build JSON Payload (OpenAI Format) ===
-static char* build_json_payload(const char *model_name, const char *prompt, float temp) {
+// Prompt and model name are escaped while being written into the request body
+static char* build_json_payload(const char *model_name, const char *prompt, float temp, int max_tokens) {
 
     size_t prompt_len = strlen(prompt);
-    size_t len = prompt_len + 256; 
-
-    char *json = malloc(len);
-    if (!json) return NULL;
+    JsonWriter w;
+    if (json_writer_init(&w, prompt_len + 256) != 0) return NULL;
 
-    // Constructing JSON: {"model": "...", "messages": [{"role": "user", "content": "..."}], "temperature": ...}
-    snprintf(json, len, 
-        "{\"model\": \"%s\", \"messages\": [{\"role\": \"user\", \"content\": \"%s\"}], \"temperature\": %.1f}", 
-        model_name, prompt, temp);
+    // Constructing JSON: {"model": "...", "messages": [{"role": "user", "content": "..."}], "temperature": ..., "max_tokens": ...}
+    json_write_cstr(&w, "{\"model\": ");
+    json_write_string(&w, model_name, strlen(model_name));
+    json_write_cstr(&w, ", \"messages\": [{\"role\": \"user\", \"content\": ");
+    json_write_string(&w, prompt, prompt_len);
+    json_write_cstr(&w, "}], \"temperature\": ");
+    json_write_double(&w, temp);
+    json_write_cstr(&w, ", \"max_tokens\": ");
+    json_write_int(&w, max_tokens);
+    json_write_cstr(&w, "}");
     
-    return json;
+    return json_writer_finish(&w, NULL);
 }
 
 // Function to parse AI model response (Adapted for OpenAI/Groq format)
@@ -125,84 +647,331 @@ static int parse_ai_response(const char *raw_response, char *output, size_t outp
     return -1;
 }
 
-// Function to send request to AI model (REAL IMPLEMENTATION)
-static int send_to_model(AIModel *model, const char *prompt, char *response, size_t response_size) {
-    if (!model || !prompt || !response || response_size == 0) {
+// One upstream transfer; a hedged request runs two side by side
+typedef struct {
+    CURL *curl;
+    ModelReplica *replica;
+    int probe;
+    struct MemoryStruct chunk;
+    uint64_t start_ns;
+    int done;                   // Transfer completed (successfully or not)
+    int finished;               // Replica released and handle cleaned up
+    CURLcode result;
+    long http_code;
+} UpstreamAttempt;
+
+// Transport errors, overload and server errors count against the replica
+static int upstream_status_ok(long http_code) {
+    return http_code > 0 && http_code != 429 && http_code < 500;
+}
+
+static long attempt_http_code(UpstreamAttempt *attempt) {
+    long http_code = 0;
+    curl_easy_getinfo(attempt->curl, CURLINFO_RESPONSE_CODE, &http_code);
+    return http_code;
+}
+
+static int attempt_start(UpstreamAttempt *attempt, CURLM *multi, ModelReplica *replica, int probe,
+                         const char *json_payload, struct curl_slist *headers) {
+    memset(attempt, 0, sizeof(UpstreamAttempt));
+    attempt->replica = replica;
+    attempt->probe = probe;
+    attempt->chunk.memory = malloc(1);
+    attempt->curl = curl_easy_init();
+    if (!attempt->chunk.memory || !attempt->curl) {
+        free(attempt->chunk.memory);
+        if (attempt->curl) curl_easy_cleanup(attempt->curl);
+        memset(attempt, 0, sizeof(UpstreamAttempt));
         return -1;
     }
+
+    // Set CURL options
+    curl_easy_setopt(attempt->curl, CURLOPT_URL, replica->endpoint);
+    curl_easy_setopt(attempt->curl, CURLOPT_POSTFIELDS, json_payload);
+    curl_easy_setopt(attempt->curl, CURLOPT_HTTPHEADER, headers);
+    curl_easy_setopt(attempt->curl, CURLOPT_WRITEFUNCTION, WriteMemoryCallback);
+    curl_easy_setopt(attempt->curl, CURLOPT_WRITEDATA, (void *)&attempt->chunk);
+    curl_easy_setopt(attempt->curl, CURLOPT_TIMEOUT_MS,
+                     atomic_load_explicit(&upstream_timeout_ms, memory_order_relaxed));
+    curl_easy_setopt(attempt->curl, CURLOPT_NOSIGNAL, 1L);
     
-    pthread_mutex_lock(&model->mutex);
-    
-    CURL *curl;
-    CURLcode res;
-    struct MemoryStruct chunk;
-    chunk.memory = malloc(1); 
-    chunk.size = 0;
-
-    curl = curl_easy_init();
-    if(curl) {
-        // Build JSON payload
-        char *json_payload = build_json_payload(model->name, prompt, model->temperature);
-        if (!json_payload) {
-            pthread_mutex_unlock(&model->mutex);
-            free(chunk.memory);
-            return -1;
+    // Disable SSL verification for development purposes 
+    curl_easy_setopt(attempt->curl, CURLOPT_SSL_VERIFYPEER, 0L); 
+    curl_easy_setopt(attempt->curl, CURLOPT_SSL_VERIFYHOST, 0L);
+
+    if (curl_multi_add_handle(multi, attempt->curl) != CURLM_OK) {
+        curl_easy_cleanup(attempt->curl);
+        free(attempt->chunk.memory);
+        memset(attempt, 0, sizeof(UpstreamAttempt));
+        return -1;
+    }
+
+    atomic_fetch_add_explicit(&replica->inflight, 1, memory_order_relaxed);
+    attempt->start_ns = get_current_time_ns();
+    return 0;
+}
+
+// Release the replica and close the transfer; a cancelled attempt is not a failure
+static void attempt_finish(UpstreamAttempt *attempt, CURLM *multi, const AIModel *model, int cancelled) {
+    uint64_t elapsed = get_current_time_ns() - attempt->start_ns;
+
+    if (cancelled) {
+        replica_cancel(attempt->replica, attempt->probe, elapsed);
+    } else {
+        attempt->http_code = attempt->result == CURLE_OK ? attempt_http_code(attempt) : 0;
+        int success = attempt->result == CURLE_OK && upstream_status_ok(attempt->http_code);
+        replica_release(attempt->replica, model->name, attempt->probe, success, elapsed);
+        stats_record_latency(STATS_SCOPE_MODEL, model->name, STATS_UPSTREAM, elapsed / 1000);
+    }
+
+    curl_multi_remove_handle(multi, attempt->curl);
+    curl_easy_cleanup(attempt->curl);
+    attempt->curl = NULL;
+    attempt->finished = 1;
+}
+
+// Start a second attempt on another replica if the hedge budget allows
+static int start_hedge(UpstreamAttempt *hedge, CURLM *multi, AIModel *model, const ModelReplica *primary,
+                       const char *json_payload, struct curl_slist *headers) {
+    if (!model_take_hedge_budget(model)) return -1;
+
+    int probe = 0;
+    ModelReplica *replica = select_replica(rcu_dereference(model->replicas), primary, &probe);
+    if (!replica || attempt_start(hedge, multi, replica, probe, json_payload, headers) != 0) {
+        if (replica && probe) atomic_store(&replica->probing, 0);
+        atomic_fetch_add_explicit(&model->hedge_tokens, HEDGE_TOKEN_SCALE, memory_order_relaxed);
+        return -1;
+    }
+
+    atomic_fetch_add_explicit(&replica->hedges, 1, memory_order_relaxed);
+
+    char log_msg[512];
+    snprintf(log_msg, sizeof(log_msg), "Hedging request to model %s at %s",
+             model->name, replica->endpoint);
+    log_message("AI_ROUTER", log_msg);
+    return 0;
+}
+
+/**
+ * Run one upstream request, hedging it when the first attempt has not
+ * produced a byte within the model's hedge delay. The first attempt to
+ * deliver a successful response byte wins; the other is cancelled.
+ * Returns the attempt whose body answers the request.
+ */
+static UpstreamAttempt *run_attempts(UpstreamAttempt attempts[2], CURLM *multi, AIModel *model,
+                                     const char *json_payload, struct curl_slist *headers) {
+    int started = 1;
+    int active = 1;
+    UpstreamAttempt *winner = NULL;
+
+    uint64_t hedge_delay = atomic_load_explicit(&model->hedge_delay_ns, memory_order_relaxed);
+    uint64_t hedge_at = hedge_delay ? attempts[0].start_ns + hedge_delay : 0;
+
+    while (active > 0) {
+        int running = 0;
+        curl_multi_perform(multi, &running);
+
+        // Collect completed transfers
+        CURLMsg *msg;
+        int queued;
+        while ((msg = curl_multi_info_read(multi, &queued))) {
+            if (msg->msg != CURLMSG_DONE) continue;
+            for (int i = 0; i < started; i++) {
+                if (attempts[i].curl == msg->easy_handle) {
+                    attempts[i].done = 1;
+                    attempts[i].result = msg->data.result;
+                }
+            }
         }
 
-        struct curl_slist *headers = NULL;
-        headers = curl_slist_append(headers, "Content-Type: application/json");
-        
-        // Handle API Key (Check environment variable)
-
-        char *api_key = getenv("OPENAI_API_KEY");
-        if (api_key) {
-            char auth_header[256];
-            snprintf(auth_header, sizeof(auth_header), "Authorization: Bearer %s", api_key);
-            headers = curl_slist_append(headers, auth_header);
-        } else {
-            log_message("AI_ROUTER", "Warning: OPENAI_API_KEY environment variable not set.");
+        for (int i = 0; i < started && !winner; i++) {
+            UpstreamAttempt *attempt = &attempts[i];
+            if (attempt->finished || attempt->result != CURLE_OK) continue;
+            if ((attempt->chunk.first_byte_ns || attempt->done) && upstream_status_ok(attempt_http_code(attempt))) {
+                winner = attempt;
+                if (attempt->chunk.first_byte_ns) {
+                    uint64_t ttft = attempt->chunk.first_byte_ns - attempt->start_ns;
+                    model_record_ttft(model, ttft);
+                    stats_record_latency(STATS_SCOPE_MODEL, model->name, STATS_TTFT, ttft / 1000);
+                }
+            }
         }
 
-        // Set CURL options
-        curl_easy_setopt(curl, CURLOPT_URL, model->api_endpoint);
-        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, json_payload);
-        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteMemoryCallback);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&chunk);
-        
-        // Disable SSL verification for development purposes 
-        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L); 
-        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
+        for (int i = 0; i < started; i++) {
+            UpstreamAttempt *attempt = &attempts[i];
+            if (attempt->finished) continue;
+            if (winner && attempt != winner) {
+                attempt_finish(attempt, multi, model, !attempt->done);
+                active--;
+            } else if (attempt->done && (attempt == winner || !winner)) {
+                // A failed attempt is released now; the other one may still succeed
+                attempt_finish(attempt, multi, model, 0);
+                active--;
+            }
+        }
+        if (winner && winner->finished) break;
+
+        uint64_t now = get_current_time_ns();
+        if (!winner && hedge_at && now >= hedge_at) {
+            hedge_at = 0;
+            if (started == 1 && active == 1 && !attempts[0].chunk.first_byte_ns &&
+                start_hedge(&attempts[1], multi, model, attempts[0].replica, json_payload, headers) == 0) {
+                started++;
+                active++;
+            }
+        }
+
+        if (active == 0) break;
+
+        int timeout_ms = 1000;
+        if (!winner && hedge_at) {
+            uint64_t wait_ns = hedge_at > now ? hedge_at - now : 0;
+            timeout_ms = (int)((wait_ns + 999999) / 1000000);
+        }
+        curl_multi_poll(multi, NULL, 0, timeout_ms, NULL);
+    }
+
+    if (winner) return winner;
+    // Both failed: report the first attempt's outcome
+    return &attempts[0];
+}
+
+// === Helper: Build JSON Payload (OpenAI Embeddings Format) ===
+static char* build_embedding_payload(const char *model_name, const char *const *inputs, int count) {
+    size_t total = 0;
+    for (int i = 0; i < count; i++) {
+        total += strlen(inputs[i]) + 4;
+    }
+
+    JsonWriter w;
+    if (json_writer_init(&w, total + 128) != 0) return NULL;
+
+    // Constructing JSON: {"model": "...", "input": ["...", ...]}
+    json_write_cstr(&w, "{\"model\": ");
+    json_write_string(&w, model_name, strlen(model_name));
+    json_write_cstr(&w, ", \"input\": [");
+    for (int i = 0; i < count; i++) {
+        if (i) json_write_cstr(&w, ", ");
+        json_write_string(&w, inputs[i], strlen(inputs[i]));
+    }
+    json_write_cstr(&w, "]}");
+
+    return json_writer_finish(&w, NULL);
+}
+
+// Send one JSON payload to a replica of the model, hedging it when slow.
+// On return *body holds the upstream answer (NULL when nothing was received)
+// and *curl_result the transfer outcome. Returns -1 on transport errors and
+// 429/5xx answers.
+static int send_payload(AIModel *model, const char *json_payload, char **body, CURLcode *curl_result) {
+    *body = NULL;
+    *curl_result = CURLE_OK;
+    
+    int probe = 0;
+    ModelReplica *replica = select_replica(rcu_dereference(model->replicas), NULL, &probe);
+    if (!replica) {
+        return -1;
+    }
+    model_earn_hedge_budget(model);
+    
+    CURLM *multi = curl_multi_init();
+    if (!multi) {
+        if (probe) atomic_store(&replica->probing, 0);
+        return -1;
+    }
+
+    struct curl_slist *headers = NULL;
+    headers = curl_slist_append(headers, "Content-Type: application/json");
+    
+    // Handle API Key (Check environment variable)
+
+    char *api_key = getenv("OPENAI_API_KEY");
+    if (api_key) {
+        char auth_header[256];
+        snprintf(auth_header, sizeof(auth_header), "Authorization: Bearer %s", api_key);
+        headers = curl_slist_append(headers, auth_header);
+    } else {
+        log_message("AI_ROUTER", "Warning: OPENAI_API_KEY environment variable not set.");
+    }
+
+    UpstreamAttempt attempts[2];
+    memset(attempts, 0, sizeof(attempts));
+    int result = 0;
 
+    if (attempt_start(&attempts[0], multi, replica, probe, json_payload, headers) != 0) {
+        if (probe) atomic_store(&replica->probing, 0);
+        *curl_result = CURLE_FAILED_INIT;
+        result = -1;
+    } else {
         // Perform request
         char log_msg[512];
-        snprintf(log_msg, sizeof(log_msg), "Sending real request to model %s at %s", model->name, model->api_endpoint);
+        snprintf(log_msg, sizeof(log_msg), "Sending real request to model %s at %s%s",
+                 model->name, replica->endpoint, probe ? " (probe)" : "");
         log_message("AI_ROUTER", log_msg);
 
-        res = curl_easy_perform(curl);
-
-        if(res != CURLE_OK) {
-            snprintf(response, response_size, "{\"error\": \"curl_easy_perform() failed: %s\"}", curl_easy_strerror(res));
-        } else {
-            // Parse the received JSON
-            if (parse_ai_response(chunk.memory, response, response_size) != 0) {
+        UpstreamAttempt *answer = run_attempts(attempts, multi, model, json_payload, headers);
 
-                strncpy(response, chunk.memory, response_size);
-                response[response_size - 1] = '\0';
-            }
+        *curl_result = answer->result;
+        if (answer->result != CURLE_OK || !upstream_status_ok(answer->http_code)) {
+            result = -1;
+        }
+        if (answer->result == CURLE_OK) {
+            // Hand the winning body over to the caller
+            *body = answer->chunk.memory;
+            answer->chunk.memory = NULL;
         }
 
-        // Cleanup resources
-        free(chunk.memory);
-        free(json_payload);
-        curl_slist_free_all(headers);
-        curl_easy_cleanup(curl);
-    } else {
-        strncpy(response, "{\"error\": \"Failed to initialize CURL\"}", response_size);
+        free(attempts[0].chunk.memory);
+        free(attempts[1].chunk.memory);
     }
+
+    // Cleanup resources
+    curl_slist_free_all(headers);
+    curl_multi_cleanup(multi);
     
-    pthread_mutex_unlock(&model->mutex);
-    return 0;
+    return result;
+}
+
+// Function to send request to AI model (REAL IMPLEMENTATION)
+// Requests run concurrently; the replica is picked per request.
+// Returns -1 on transport errors and 429/5xx answers (the body is still copied).
+static int send_to_model(AIModel *model, const char *prompt, int max_tokens, char *response, size_t response_size) {
+    if (!model || !prompt || !response || response_size == 0) {
+        return -1;
+    }
+    
+    // Build JSON payload
+    // Client-requested limit, capped by the model's configured maximum
+    if (max_tokens <= 0 || max_tokens > model->max_tokens) {
+        max_tokens = model->max_tokens;
+    }
+
+    char *json_payload = build_json_payload(model->name, prompt, model->temperature, max_tokens);
+    if (!json_payload) {
+        return -1;
+    }
+
+    char *body = NULL;
+    CURLcode curl_result;
+    int result = send_payload(model, json_payload, &body, &curl_result);
+
+    if (body) {
+        // Parse the received JSON
+        if (parse_ai_response(body, response, response_size) != 0) {
+
+            strncpy(response, body, response_size);
+            response[response_size - 1] = '\0';
+        }
+    } else if (curl_result == CURLE_FAILED_INIT) {
+        strncpy(response, "{\"error\": \"Failed to initialize CURL\"}", response_size);
+        response[response_size - 1] = '\0';
+    } else if (curl_result != CURLE_OK) {
+        snprintf(response, response_size, "{\"error\": \"curl_easy_perform() failed: %s\"}", curl_easy_strerror(curl_result));
+    }
+
+    free(body);
+    free(json_payload);
+    return result;
 }
 
 // Function to route prompts using optimized functions
@@ -234,17 +1003,10 @@ int prompt_router_init() {
 
     curl_global_init(CURL_GLOBAL_ALL);
 
-    global_router.model_capacity = 8;
-    global_router.models = calloc(global_router.model_capacity, sizeof(AIModel));
-    if (!global_router.models) {
-        return -1;
-    }
-    
-    global_router.model_count = 0;
+    atomic_store(&global_router.table, NULL);
     global_router.default_model = NULL;
     
     if (pthread_mutex_init(&global_router.mutex, NULL) != 0) {
-        free(global_router.models);
         return -1;
     }
     
@@ -260,57 +1022,111 @@ int prompt_router_init() {
     // 3. Gemma 2 9B IT 
     prompt_router_add_model("gemma2-9b-it", "https://api.groq.com/openai/v1/chat/completions", 8192, 0.7);
 
+    // Embeddings (/v1/embeddings); served through the same replica and breaker machinery
+    prompt_router_add_model("text-embedding-3-small", "https://api.openai.com/v1/embeddings", 8191, 0.0);
+    
+    // Context windows, for clamping completions to what the prompt leaves
+    prompt_router_set_context("llama-3.3-70b-versatile", 131072);
+    prompt_router_set_context("llama-3.1-8b-instant", 131072);
+    prompt_router_set_context("gemma2-9b-it", 8192);
 
-    global_router.default_model = strdup("llama-3.3-70b-versatile");
+    prompt_router_set_default_model("llama-3.3-70b-versatile");
     
     log_message("AI_ROUTER", "Prompt router initialized with updated GROQ support");
     return 0;
 }
 
-// Add AI model
+// Add AI model (served by a single replica until more are added)
 int prompt_router_add_model(const char *name, const char *api_endpoint, int max_tokens, float temperature) {
     if (!name || !api_endpoint) {
         return -1;
     }
     
-    pthread_mutex_lock(&global_router.mutex);
-    
-    if (global_router.model_count >= global_router.model_capacity) {
-        // Expand model capacity
-        int new_capacity = global_router.model_capacity * 2;
-        AIModel *new_models = realloc(global_router.models, 
-                                     sizeof(AIModel) * new_capacity);
-        if (!new_models) {
-            pthread_mutex_unlock(&global_router.mutex);
-            return -1;
+    AIModel *model = calloc(1, sizeof(AIModel));
+    ReplicaSet *set = calloc(1, sizeof(ReplicaSet) + sizeof(ModelReplica *));
+    ModelReplica *replica = replica_create(api_endpoint);
+    if (!model || !set || !replica || !(model->name = strdup(name))) {
+        free(model);
+        free(set);
+        if (replica) {
+            free(replica->endpoint);
+            free(replica);
         }
-        
-        global_router.models = new_models;
-        global_router.model_capacity = new_capacity;
+        return -1;
     }
     
-    // Initialize new model
-    AIModel *model = &global_router.models[global_router.model_count];
-    model->name = strdup(name);
-    model->api_endpoint = strdup(api_endpoint);
+    set->count = 1;
+    set->replicas[0] = replica;
+    model->name_hash = model_name_hash(name);
     model->max_tokens = max_tokens;
     model->temperature = temperature;
-    model->is_available = 1;
+    atomic_store(&model->is_available, 1);
+    atomic_store(&model->hedge_percentile, HEDGE_DEFAULT_PERCENTILE);
+    atomic_store(&model->hedge_budget, HEDGE_DEFAULT_BUDGET);
+    atomic_store(&model->hedge_tokens, (int64_t)HEDGE_BURST * HEDGE_TOKEN_SCALE);
+    atomic_store(&model->breaker_rate, BREAKER_DEFAULT_RATE);
+    atomic_store(&model->breaker_slow_ns, (uint64_t)BREAKER_DEFAULT_SLOW_MS * 1000000ULL);
+    atomic_store(&model->breaker_open_ns, (uint64_t)BREAKER_DEFAULT_OPEN_MS * 1000000ULL);
+    atomic_store(&model->replicas, set);
+    
+    pthread_mutex_lock(&global_router.mutex);
     
-    if (pthread_mutex_init(&model->mutex, NULL) != 0) {
-        free(model->name);
-        free(model->api_endpoint);
+    ModelTable *table = atomic_load(&global_router.table);
+    ModelTable *old_table = NULL;
+    if (table_lookup(table, name) ||
+        publish_table(table ? table->models : NULL, table ? table->count : 0, NULL, model, &old_table) != 0) {
         pthread_mutex_unlock(&global_router.mutex);
+        model_free(model);
         return -1;
     }
     
-    global_router.model_count++;
+    pthread_mutex_unlock(&global_router.mutex);
+    rcu_defer(old_table, free);
     
     char log_msg[256];
     snprintf(log_msg, sizeof(log_msg), "AI model added: %s", name);
     log_message("AI_ROUTER", log_msg);
+    return 0;
+}
+
+// Add an upstream endpoint to an existing model
+int prompt_router_add_replica(const char *name, const char *api_endpoint) {
+    if (!name || !api_endpoint) {
+        return -1;
+    }
+    
+    ModelReplica *replica = replica_create(api_endpoint);
+    if (!replica) {
+        return -1;
+    }
+    
+    pthread_mutex_lock(&global_router.mutex);
+    
+    AIModel *model = table_lookup(atomic_load(&global_router.table), name);
+    ReplicaSet *old_set = model ? atomic_load(&model->replicas) : NULL;
+    int old_count = old_set ? old_set->count : 0;
+    ReplicaSet *set = model ? calloc(1, sizeof(ReplicaSet) + sizeof(ModelReplica *) * (old_count + 1)) : NULL;
+    if (!set) {
+        pthread_mutex_unlock(&global_router.mutex);
+        free(replica->endpoint);
+        free(replica);
+        return -1;
+    }
+    
+    // Existing replicas keep their latency and health state
+    for (int i = 0; i < old_count; i++) {
+        set->replicas[i] = old_set->replicas[i];
+    }
+    set->replicas[old_count] = replica;
+    set->count = old_count + 1;
+    rcu_assign_pointer(model->replicas, set);
     
     pthread_mutex_unlock(&global_router.mutex);
+    rcu_defer(old_set, free);
+    
+    char log_msg[512];
+    snprintf(log_msg, sizeof(log_msg), "AI model %s replica added: %s", name, api_endpoint);
+    log_message("AI_ROUTER", log_msg);
     return 0;
 }
 
@@ -322,33 +1138,24 @@ int prompt_router_remove_model(const char *name) {
     
     pthread_mutex_lock(&global_router.mutex);
     
-    for (int i = 0; i < global_router.model_count; i++) {
-        if (strcmp(global_router.models[i].name, name) == 0) {
-            AIModel *model = &global_router.models[i];
-            
-            // Free resources
-            pthread_mutex_destroy(&model->mutex);
-            free(model->name);
-            free(model->api_endpoint);
-            
-            // Remove model from list
-            for (int j = i; j < global_router.model_count - 1; j++) {
-                global_router.models[j] = global_router.models[j + 1];
-            }
-            
-            global_router.model_count--;
-            
-            char log_msg[256];
-            snprintf(log_msg, sizeof(log_msg), "AI model removed: %s", name);
-            log_message("AI_ROUTER", log_msg);
-            
-            pthread_mutex_unlock(&global_router.mutex);
-            return 0;
-        }
+    ModelTable *table = atomic_load(&global_router.table);
+    AIModel *model = table_lookup(table, name);
+    ModelTable *old_table = NULL;
+    if (!model || publish_table(table->models, table->count, model, NULL, &old_table) != 0) {
+        pthread_mutex_unlock(&global_router.mutex);
+        return -1;
     }
     
     pthread_mutex_unlock(&global_router.mutex);
-    return -1;
+    
+    // Requests may still be talking to the model's replicas
+    rcu_defer(old_table, free);
+    rcu_defer(model, model_free);
+    
+    char log_msg[256];
+    snprintf(log_msg, sizeof(log_msg), "AI model removed: %s", name);
+    log_message("AI_ROUTER", log_msg);
+    return 0;
 }
 
 // Set default model
@@ -360,83 +1167,362 @@ int prompt_router_set_default_model(const char *name) {
     pthread_mutex_lock(&global_router.mutex);
     
     // Check if model exists
-    for (int i = 0; i < global_router.model_count; i++) {
-        if (strcmp(global_router.models[i].name, name) == 0) {
-            if (global_router.default_model) {
-                free(global_router.default_model);
-            }
-            
-            global_router.default_model = strdup(name);
-            
-            char log_msg[256];
-            snprintf(log_msg, sizeof(log_msg), "Default AI model set: %s", name);
-            log_message("AI_ROUTER", log_msg);
-            
-            pthread_mutex_unlock(&global_router.mutex);
-            return 0;
-        }
+    ModelTable *table = atomic_load(&global_router.table);
+    char *default_name = table_lookup(table, name) ? strdup(name) : NULL;
+    if (!default_name) {
+        pthread_mutex_unlock(&global_router.mutex);
+        return -1;
+    }
+    
+    char *previous = global_router.default_model;
+    global_router.default_model = default_name;
+    
+    ModelTable *old_table = NULL;
+    if (publish_table(table->models, table->count, NULL, NULL, &old_table) != 0) {
+        global_router.default_model = previous;
+        pthread_mutex_unlock(&global_router.mutex);
+        free(default_name);
+        return -1;
     }
     
     pthread_mutex_unlock(&global_router.mutex);
-    return -1;
+    free(previous);
+    rcu_defer(old_table, free);
+    
+    char log_msg[256];
+    snprintf(log_msg, sizeof(log_msg), "Default AI model set: %s", name);
+    log_message("AI_ROUTER", log_msg);
+    return 0;
 }
 
-// Route prompt to AI model
-int prompt_router_route(const char *prompt, const char *model_name, char *response, size_t response_size) {
-    if (!prompt || !response || response_size == 0) {
-        return -1;
+// One upstream call against a single model of a fallback chain
+typedef int (*ModelCall)(AIModel *model, void *arg);
+
+// Run `call` against the model (or the default), following the fallback
+// chain past models whose breaker is open or whose call failed
+static int route_through_chain(const char *model_name, ModelCall call, void *arg, const char **served_model) {
+    // Lock-free lookup; the table and model stay valid until this thread's
+    // next quiescent state
+    const ModelTable *table = rcu_dereference(global_router.table);
+    if (!table) {
+        return PROMPT_ROUTE_ERROR;
     }
     
-    pthread_mutex_lock(&global_router.mutex);
+    AIModel *model = model_name ? table_lookup(table, model_name) : table->default_model;
+    if (!model) {
+        return PROMPT_ROUTE_ERROR;
+    }
     
-    // Determine target model
-    AIModel *target_model = NULL;
+    AIModel *visited[MODEL_FALLBACK_MAX_HOPS];
+    int hops = 0;
+    int result = PROMPT_ROUTE_UNAVAILABLE;
     
-    if (model_name) {
-        // Search for specified model
-        for (int i = 0; i < global_router.model_count; i++) {
-            if (strcmp(global_router.models[i].name, model_name) == 0) {
-                target_model = &global_router.models[i];
-                break;
+    while (model && hops < MODEL_FALLBACK_MAX_HOPS) {
+        visited[hops++] = model;
+        
+        int trial = 0;
+        if (atomic_load_explicit(&model->is_available, memory_order_relaxed) &&
+            breaker_allow(model, &trial)) {
+            // Send request to model
+            uint64_t start = get_current_time_ns();
+            result = call(model, arg);
+            breaker_record(model, trial, result == 0, get_current_time_ns() - start);
+            
+            if (result == 0) {
+                if (served_model) *served_model = model->name;
+                return 0;
             }
+            stats_record_failed_request(model->name);
+            result = PROMPT_ROUTE_ERROR;
         }
-    } else if (global_router.default_model) {
-        // Use default model
-        for (int i = 0; i < global_router.model_count; i++) {
-            if (strcmp(global_router.models[i].name, global_router.default_model) == 0) {
-                target_model = &global_router.models[i];
-                break;
-            }
+        
+        // Next link of the chain, stopping at a cycle
+        AIModel *next = table_lookup(table, atomic_load_explicit(&model->fallback, memory_order_acquire));
+        for (int i = 0; next && i < hops; i++) {
+            if (visited[i] == next) next = NULL;
         }
+        model = next;
     }
     
-    if (!target_model) {
-        pthread_mutex_unlock(&global_router.mutex);
+    return result;
+}
+
+typedef struct {
+    const PromptRequest *request;
+    char *response;
+    size_t response_size;
+} ChatCall;
+
+static int chat_call(AIModel *model, void *arg) {
+    ChatCall *chat = arg;
+    
+    // Leave the completion no more than the room the prompt leaves
+    int max_tokens = chat->request->max_tokens;
+    int context = atomic_load_explicit(&model->context_tokens, memory_order_relaxed);
+    int room = context - chat->request->prompt_tokens;
+    if (context > 0 && chat->request->prompt_tokens > 0 && room > 0 &&
+        (max_tokens <= 0 || max_tokens > room)) {
+        max_tokens = room;
+    }
+    
+    return send_to_model(model, chat->request->prompt, max_tokens, chat->response, chat->response_size);
+}
+
+// Whether the prompt leaves no room for a completion in the requested model
+static int prompt_exceeds_context(const PromptRequest *request) {
+    if (request->prompt_tokens <= 0) {
+        return 0;
+    }
+    
+    const ModelTable *table = rcu_dereference(global_router.table);
+    const AIModel *model = !table ? NULL :
+                           request->model_name ? table_lookup(table, request->model_name) : table->default_model;
+    int context = model ? atomic_load_explicit(&model->context_tokens, memory_order_relaxed) : 0;
+    return context > 0 && request->prompt_tokens >= context;
+}
+
+// Route a parsed chat request to its AI model, following the fallback chain
+// past models whose breaker is open or whose request failed
+int prompt_router_route_request(const PromptRequest *request, char *response, size_t response_size,
+                                const char **served_model) {
+    if (!request || !request->prompt || !response || response_size == 0) {
+        return PROMPT_ROUTE_ERROR;
+    }
+    
+    if (prompt_exceeds_context(request)) {
+        snprintf(response, response_size, "{\"error\": \"Prompt exceeds the model's context window\"}");
+        return PROMPT_ROUTE_TOO_LONG;
+    }
+    
+    ChatCall chat = {request, response, response_size};
+    int result = route_through_chain(request->model_name, chat_call, &chat, served_model);
+    if (result == PROMPT_ROUTE_UNAVAILABLE) {
+        snprintf(response, response_size, "{\"error\": \"No model available: circuit open\"}");
+    }
+    return result;
+}
+
+typedef struct {
+    const char *const *inputs;
+    int count;
+    char *body;
+} EmbedCall;
+
+static int embed_call(AIModel *model, void *arg) {
+    EmbedCall *embed = arg;
+    
+    // The payload names the model, so it is rebuilt for every link of the chain
+    char *json_payload = build_embedding_payload(model->name, embed->inputs, embed->count);
+    if (!json_payload) {
         return -1;
     }
     
-    // Send request to model
-    int result = send_to_model(target_model, prompt, response, response_size);
+    free(embed->body);
+    CURLcode curl_result;
+    int result = send_payload(model, json_payload, &embed->body, &curl_result);
+    free(json_payload);
+    return result;
+}
+
+// Send a batch of embedding inputs upstream in one call
+int prompt_router_embed(const char *model_name, const char *const *inputs, int count,
+                        char **body, const char **served_model) {
+    if (!model_name || !inputs || count <= 0 || !body) {
+        return PROMPT_ROUTE_ERROR;
+    }
     
-    pthread_mutex_unlock(&global_router.mutex);
+    EmbedCall embed = {inputs, count, NULL};
+    int result = route_through_chain(model_name, embed_call, &embed, served_model);
+    if (result != 0) {
+        free(embed.body);
+        embed.body = NULL;
+    }
+    *body = embed.body;
     return result;
 }
 
+// Route prompt to AI model
+int prompt_router_route(const char *prompt, const char *model_name, char *response, size_t response_size) {
+    PromptRequest request = {
+        .prompt = prompt,
+        .model_name = model_name,
+        .max_tokens = 0,
+        .prompt_tokens = 0,
+        .stream = 0
+    };
+    return prompt_router_route_request(&request, response, response_size, NULL);
+}
+
 // Get list of available models
 int prompt_router_get_models(char ***model_names, int *count) {
     pthread_mutex_lock(&global_router.mutex);
     
-    *count = global_router.model_count;
+    ModelTable *table = atomic_load(&global_router.table);
+    *count = table ? table->count : 0;
     *model_names = malloc(sizeof(char *) * (*count));
     
     for (int i = 0; i < *count; i++) {
-        (*model_names)[i] = strdup(global_router.models[i].name);
+        (*model_names)[i] = strdup(table->models[i]->name);
+    }
+    
+    pthread_mutex_unlock(&global_router.mutex);
+    return 0;
+}
+
+// Copy per-replica selection state for monitoring
+int prompt_router_get_replica_stats(ReplicaStatsInfo *out, int max) {
+    pthread_mutex_lock(&global_router.mutex);
+    
+    ModelTable *table = atomic_load(&global_router.table);
+    uint64_t now = get_current_time_ns();
+    int count = 0;
+    
+    for (int i = 0; table && i < table->count; i++) {
+        AIModel *model = table->models[i];
+        ReplicaSet *set = atomic_load(&model->replicas);
+        for (int j = 0; set && j < set->count; j++, count++) {
+            if (!out || count >= max) continue;
+            
+            ModelReplica *replica = set->replicas[j];
+            ReplicaStatsInfo *info = &out[count];
+            uint64_t ejected_until = atomic_load(&replica->ejected_until_ns);
+            snprintf(info->model, sizeof(info->model), "%s", model->name);
+            snprintf(info->endpoint, sizeof(info->endpoint), "%s", replica->endpoint);
+            info->ewma_ms = replica_latency_ns(replica, now) / 1e6;
+            info->inflight = atomic_load(&replica->inflight);
+            info->ejected = ejected_until != 0;
+            info->requests = atomic_load(&replica->requests);
+            info->failures = atomic_load(&replica->failures);
+            info->hedges = atomic_load(&replica->hedges);
+        }
+    }
+    
+    pthread_mutex_unlock(&global_router.mutex);
+    return count;
+}
+
+// Configure hedging for one model, or for every model when name is NULL
+int prompt_router_set_hedging(const char *name, double percentile, double budget_percent) {
+    if (percentile < 0.0 || percentile > 100.0 || budget_percent < 0.0) {
+        return -1;
+    }
+    
+    pthread_mutex_lock(&global_router.mutex);
+    
+    ModelTable *table = atomic_load(&global_router.table);
+    int found = 0;
+    for (int i = 0; table && i < table->count; i++) {
+        AIModel *model = table->models[i];
+        if (name && strcmp(model->name, name) != 0) continue;
+        
+        atomic_store(&model->hedge_percentile, percentile);
+        atomic_store(&model->hedge_budget, budget_percent);
+        model_refresh_hedge_delay(model, atomic_load(&model->ttft_count));
+        found = 1;
+    }
+    
+    pthread_mutex_unlock(&global_router.mutex);
+    return found ? 0 : -1;
+}
+
+// Set the model that takes over while `name` is failing (NULL clears it)
+int prompt_router_set_fallback(const char *name, const char *fallback) {
+    if (!name || (fallback && strcmp(name, fallback) == 0)) {
+        return -1;
+    }
+    
+    pthread_mutex_lock(&global_router.mutex);
+    
+    ModelTable *table = atomic_load(&global_router.table);
+    AIModel *model = table_lookup(table, name);
+    char *copy = fallback ? strdup(fallback) : NULL;
+    if (!model || (fallback && (!copy || !table_lookup(table, fallback)))) {
+        pthread_mutex_unlock(&global_router.mutex);
+        free(copy);
+        return -1;
+    }
+    
+    char *previous = atomic_exchange(&model->fallback, copy);
+    pthread_mutex_unlock(&global_router.mutex);
+    rcu_defer(previous, free);
+    
+    char log_msg[256];
+    snprintf(log_msg, sizeof(log_msg), "AI model %s falls back to %s", name, fallback ? fallback : "nothing");
+    log_message("AI_ROUTER", log_msg);
+    return 0;
+}
+
+// Set the context window used to clamp completions
+int prompt_router_set_context(const char *name, int context_tokens) {
+    if (!name || context_tokens < 0) {
+        return -1;
+    }
+    
+    pthread_mutex_lock(&global_router.mutex);
+    AIModel *model = table_lookup(atomic_load(&global_router.table), name);
+    if (model) {
+        atomic_store(&model->context_tokens, context_tokens);
+    }
+    pthread_mutex_unlock(&global_router.mutex);
+    return model ? 0 : -1;
+}
+
+// Configure the circuit breaker of one model, or of every model when name is NULL
+int prompt_router_set_breaker(const char *name, double failure_rate, int slow_ms, int open_ms) {
+    if (failure_rate <= 0.0 || failure_rate > 100.0 || slow_ms <= 0 || open_ms <= 0) {
+        return -1;
+    }
+    
+    pthread_mutex_lock(&global_router.mutex);
+    
+    ModelTable *table = atomic_load(&global_router.table);
+    int found = 0;
+    for (int i = 0; table && i < table->count; i++) {
+        AIModel *model = table->models[i];
+        if (name && strcmp(model->name, name) != 0) continue;
+        
+        atomic_store(&model->breaker_rate, failure_rate);
+        atomic_store(&model->breaker_slow_ns, (uint64_t)slow_ms * 1000000ULL);
+        atomic_store(&model->breaker_open_ns, (uint64_t)open_ms * 1000000ULL);
+        found = 1;
     }
     
     pthread_mutex_unlock(&global_router.mutex);
+    return found ? 0 : -1;
+}
+
+// Bound every upstream attempt started from now on
+int prompt_router_set_request_timeout(int timeout_ms) {
+    if (timeout_ms <= 0) {
+        return -1;
+    }
+    atomic_store(&upstream_timeout_ms, (long)timeout_ms);
     return 0;
 }
 
+// Copy per-model routing state for monitoring
+int prompt_router_get_model_stats(ModelRouteInfo *out, int max) {
+    pthread_mutex_lock(&global_router.mutex);
+    
+    ModelTable *table = atomic_load(&global_router.table);
+    int count = table ? table->count : 0;
+    
+    for (int i = 0; out && i < count && i < max; i++) {
+        AIModel *model = table->models[i];
+        const char *fallback = atomic_load(&model->fallback);
+        ModelRouteInfo *info = &out[i];
+        snprintf(info->name, sizeof(info->name), "%s", model->name);
+        snprintf(info->fallback, sizeof(info->fallback), "%s", fallback ? fallback : "");
+        snprintf(info->breaker, sizeof(info->breaker), "%s",
+                 breaker_state_names[breaker_state(model)]);
+        info->available = atomic_load(&model->is_available);
+        info->hedge_delay_ms = atomic_load(&model->hedge_delay_ns) / 1e6;
+    }
+    
+    pthread_mutex_unlock(&global_router.mutex);
+    return count;
+}
+
 // Set model availability
 int prompt_router_set_model_availability(const char *name, int is_available) {
     if (!name) {
@@ -445,38 +1531,39 @@ int prompt_router_set_model_availability(const char *name, int is_available) {
     
     pthread_mutex_lock(&global_router.mutex);
     
-    for (int i = 0; i < global_router.model_count; i++) {
-        if (strcmp(global_router.models[i].name, name) == 0) {
-            global_router.models[i].is_available = is_available;
-            
-            char log_msg[256];
-            snprintf(log_msg, sizeof(log_msg), "AI model %s availability: %s", 
-                    name, is_available ? "available" : "unavailable");
-            log_message("AI_ROUTER", log_msg);
-            
-            pthread_mutex_unlock(&global_router.mutex);
-            return 0;
-        }
+    AIModel *model = table_lookup(atomic_load(&global_router.table), name);
+    if (!model) {
+        pthread_mutex_unlock(&global_router.mutex);
+        return -1;
     }
+    atomic_store(&model->is_available, is_available);
     
     pthread_mutex_unlock(&global_router.mutex);
-    return -1;
+    
+    char log_msg[256];
+    snprintf(log_msg, sizeof(log_msg), "AI model %s availability: %s", 
+            name, is_available ? "available" : "unavailable");
+    log_message("AI_ROUTER", log_msg);
+    return 0;
 }
 
-// Clean up prompt router
+// Clean up prompt router (request threads must have stopped)
 void prompt_router_cleanup() {
+    // Flush deferred frees of old tables and replica sets first
+    rcu_barrier();
+    
     pthread_mutex_lock(&global_router.mutex);
     
     // Free model resources
-    for (int i = 0; i < global_router.model_count; i++) {
-        pthread_mutex_destroy(&global_router.models[i].mutex);
-        free(global_router.models[i].name);
-        free(global_router.models[i].api_endpoint);
+    ModelTable *table = atomic_exchange(&global_router.table, NULL);
+    for (int i = 0; table && i < table->count; i++) {
+        model_free(table->models[i]);
     }
+    free(table);
     
-    free(global_router.models);
     if (global_router.default_model) {
         free(global_router.default_model);
+        global_router.default_model = NULL;
     }
     
     pthread_mutex_unlock(&global_router.mutex);
@@ -4,7 +4,14 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
 #include <time.h>
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <pthread.h>
 
 // ===== Project Headers =====
@@ -12,62 +19,622 @@
 #include "utils.h"
 #include "asm_utils.h"
 
+// ===== Constants =====
+#define STATS_MAX_SERIES 128            // Models and routes tracked
+#define STATS_INDEX_SLOTS 256           // Open-addressed name index, power of two
+#define STATS_MAX_SHARDS 64             // Recording threads; the last shard is shared beyond that
+#define STATS_RESTORED_SHARD 0          // Holds what was loaded from the stats file, no thread records here
+
+// Log-bucketed histogram over microseconds: values below 32 are exact,
+// above that each power of two is split into 32 buckets
+#define HIST_SUB_BITS 5
+#define HIST_SUB_COUNT (1 << HIST_SUB_BITS)
+#define HIST_BUCKETS 1024
+#define HIST_MAX_US ((1ULL << 36) - 1)
+
+typedef struct {
+    _Atomic uint64_t counts[HIST_BUCKETS];
+    _Atomic uint64_t sum_us;
+    _Atomic uint64_t max_us;
+} LatencyHistogram;
+
+// One thread's counters for one series; histograms are allocated on first use
+typedef struct {
+    _Atomic uint64_t successes;
+    _Atomic uint64_t failures;
+    _Atomic uint64_t tokens;
+    _Atomic(LatencyHistogram *) histograms[STATS_METRIC_COUNT];
+} SeriesCounters;
+
+// Each thread records into its own shard, so counters never share a cache line
+typedef struct {
+    SeriesCounters series[STATS_MAX_SERIES];
+    _Atomic int in_use;
+} __attribute__((aligned(64))) StatsShard;
+
+typedef struct {
+    char name[STATS_NAME_MAX];
+    StatsScope scope;
+    uint32_t hash;
+    _Atomic int64_t last_used;
+} StatsSeries;
 
 // Stats collector structure definition
 typedef struct {
-    ModelStats *model_stats;
-    int model_count;
-    int model_capacity;
-    pthread_mutex_t mutex;
+    StatsSeries series[STATS_MAX_SERIES];
+    _Atomic int series_count;
+    _Atomic int index[STATS_INDEX_SLOTS];       // Series id + 1, 0 when empty
+    pthread_mutex_t register_lock;              // Serializes new series only
+    StatsShard shards[STATS_MAX_SHARDS];
+    _Atomic int shard_limit;                    // Highest shard index ever used + 1
     char *stats_file;
+    char *json_file;                            // Optional JSON export written with each snapshot
     int auto_save_interval;
-    time_t last_save_time;
+    _Atomic time_t last_save_time;              // Written by the saver, read by stats_auto_save() callers
+    pthread_mutex_t save_lock;                  // One snapshot written at a time
+    pthread_t saver;
+    int saver_running;
+    pthread_mutex_t saver_lock;
+    pthread_cond_t saver_cond;
+    int saver_stop;
+    int save_requested;
 } StatsCollector;
 
-static StatsCollector global_stats;
+static StatsCollector global_stats = {
+    .register_lock = PTHREAD_MUTEX_INITIALIZER,
+    .shards[STATS_RESTORED_SHARD].in_use = 1,
+    .shard_limit = STATS_RESTORED_SHARD + 1,
+    .save_lock = PTHREAD_MUTEX_INITIALIZER,
+    .saver_lock = PTHREAD_MUTEX_INITIALIZER
+};
+static _Thread_local StatsShard *stats_self = NULL;
+
+// ===== Histograms =====
+
+static int histogram_bucket(uint64_t us) {
+    if (us > HIST_MAX_US) us = HIST_MAX_US;
+    if (us < HIST_SUB_COUNT) return (int)us;
+
+    int k = 63 - __builtin_clzll(us);
+    return (k - HIST_SUB_BITS + 1) * HIST_SUB_COUNT + (int)(us >> (k - HIST_SUB_BITS)) - HIST_SUB_COUNT;
+}
+
+static uint64_t bucket_low(int bucket) {
+    if (bucket < HIST_SUB_COUNT) return (uint64_t)bucket;
+    int k = bucket / HIST_SUB_COUNT + HIST_SUB_BITS - 1;
+    return (uint64_t)(bucket % HIST_SUB_COUNT + HIST_SUB_COUNT) << (k - HIST_SUB_BITS);
+}
+
+static double bucket_mid(int bucket) {
+    uint64_t width = bucket < HIST_SUB_COUNT ? 1 : 1ULL << (bucket / HIST_SUB_COUNT - 1);
+    return (double)bucket_low(bucket) + (double)(width - 1) / 2.0;
+}
+
+static void histogram_record(LatencyHistogram *histogram, uint64_t us) {
+    atomic_fetch_add_explicit(&histogram->counts[histogram_bucket(us)], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&histogram->sum_us, us, memory_order_relaxed);
+
+    uint64_t max = atomic_load_explicit(&histogram->max_us, memory_order_relaxed);
+    while (us > max && !atomic_compare_exchange_weak_explicit(&histogram->max_us, &max, us,
+                                                              memory_order_relaxed, memory_order_relaxed)) {
+    }
+}
+
+// Histograms of one series and metric merged across every shard
+typedef struct {
+    uint64_t counts[HIST_BUCKETS];
+    uint64_t count;
+    uint64_t sum_us;
+    uint64_t max_us;
+} MergedHistogram;
+
+static void histogram_merge(int id, StatsMetric metric, MergedHistogram *out) {
+    memset(out, 0, sizeof(*out));
+    int limit = atomic_load(&global_stats.shard_limit);
+
+    for (int s = 0; s < limit; s++) {
+        LatencyHistogram *histogram = atomic_load_explicit(&global_stats.shards[s].series[id].histograms[metric],
+                                                           memory_order_acquire);
+        if (!histogram) continue;
+
+        for (int b = 0; b < HIST_BUCKETS; b++) {
+            uint64_t n = atomic_load_explicit(&histogram->counts[b], memory_order_relaxed);
+            out->counts[b] += n;
+            out->count += n;
+        }
+        out->sum_us += atomic_load_explicit(&histogram->sum_us, memory_order_relaxed);
+        uint64_t max = atomic_load_explicit(&histogram->max_us, memory_order_relaxed);
+        if (max > out->max_us) out->max_us = max;
+    }
+}
+
+// Bucket midpoint of the value at `percentile`, never above the exact maximum
+static double merged_percentile_ms(const MergedHistogram *merged, double percentile) {
+    uint64_t rank = (uint64_t)(percentile / 100.0 * (double)merged->count + 0.999999);
+    if (rank == 0) rank = 1;
+
+    uint64_t seen = 0;
+    for (int b = 0; b < HIST_BUCKETS; b++) {
+        seen += merged->counts[b];
+        if (seen >= rank) {
+            double us = bucket_mid(b);
+            if (us > (double)merged->max_us) us = (double)merged->max_us;
+            return us / 1000.0;
+        }
+    }
+    return (double)merged->max_us / 1000.0;
+}
+
+static double merged_min_ms(const MergedHistogram *merged) {
+    for (int b = 0; b < HIST_BUCKETS; b++) {
+        if (merged->counts[b]) return (double)bucket_low(b) / 1000.0;
+    }
+    return 0.0;
+}
+
+static void summarize_merged(const MergedHistogram *merged, LatencySummary *summary) {
+    memset(summary, 0, sizeof(*summary));
+    if (merged->count == 0) return;
+
+    summary->count = merged->count;
+    summary->mean_ms = (double)merged->sum_us / (double)merged->count / 1000.0;
+    summary->p50_ms = merged_percentile_ms(merged, 50.0);
+    summary->p90_ms = merged_percentile_ms(merged, 90.0);
+    summary->p99_ms = merged_percentile_ms(merged, 99.0);
+    summary->p999_ms = merged_percentile_ms(merged, 99.9);
+    summary->max_ms = (double)merged->max_us / 1000.0;
+}
+
+static void summarize(int id, StatsMetric metric, LatencySummary *summary, double *min_ms) {
+    MergedHistogram merged;
+    histogram_merge(id, metric, &merged);
+    if (min_ms) *min_ms = merged_min_ms(&merged);
+    summarize_merged(&merged, summary);
+}
+
+// ===== Series and Shards =====
+
+static uint32_t series_hash(StatsScope scope, const char *name, size_t length) {
+    return crc32_asm(name, length) ^ ((uint32_t)scope * 0x9e3779b9u);
+}
+
+// Lock-free lookup; -1 when the series is not tracked
+static int series_find(StatsScope scope, const char *name, size_t length, uint32_t hash) {
+    uint32_t slot = hash & (STATS_INDEX_SLOTS - 1);
+
+    for (int probes = 0; probes < STATS_INDEX_SLOTS; probes++) {
+        int entry = atomic_load_explicit(&global_stats.index[slot], memory_order_acquire);
+        if (entry == 0) return -1;
+
+        const StatsSeries *series = &global_stats.series[entry - 1];
+        if (series->hash == hash && series->scope == scope &&
+            strncmp(series->name, name, length) == 0 && series->name[length] == '\0') {
+            return entry - 1;
+        }
+        slot = (slot + 1) & (STATS_INDEX_SLOTS - 1);
+    }
+    return -1;
+}
+
+// Find the series, registering it on first use
+static int series_get(StatsScope scope, const char *name) {
+    size_t length = strlen(name);
+    if (length == 0 || length >= STATS_NAME_MAX) {
+        return -1;
+    }
+
+    uint32_t hash = series_hash(scope, name, length);
+    int id = series_find(scope, name, length, hash);
+    if (id >= 0) {
+        return id;
+    }
+
+    pthread_mutex_lock(&global_stats.register_lock);
+
+    id = series_find(scope, name, length, hash);
+    int count = atomic_load_explicit(&global_stats.series_count, memory_order_relaxed);
+    if (id < 0 && count < STATS_MAX_SERIES) {
+        StatsSeries *series = &global_stats.series[count];
+        memcpy(series->name, name, length + 1);
+        series->scope = scope;
+        series->hash = hash;
+        atomic_store_explicit(&series->last_used, (int64_t)time(NULL), memory_order_relaxed);
+
+        // Published to readers before the index points at it
+        atomic_store_explicit(&global_stats.series_count, count + 1, memory_order_release);
+        uint32_t slot = hash & (STATS_INDEX_SLOTS - 1);
+        while (atomic_load_explicit(&global_stats.index[slot], memory_order_relaxed) != 0) {
+            slot = (slot + 1) & (STATS_INDEX_SLOTS - 1);
+        }
+        atomic_store_explicit(&global_stats.index[slot], count + 1, memory_order_release);
+        id = count;
+    }
+
+    pthread_mutex_unlock(&global_stats.register_lock);
+    return id;
+}
+
+// This thread's shard; threads beyond STATS_MAX_SHARDS share the last one,
+// which is safe because every update is an atomic add
+static StatsShard *stats_shard(void) {
+    if (stats_self) return stats_self;
+
+    int claimed = STATS_MAX_SHARDS - 1;
+    for (int i = 0; i < STATS_MAX_SHARDS; i++) {
+        int expected = 0;
+        if (atomic_compare_exchange_strong(&global_stats.shards[i].in_use, &expected, 1)) {
+            claimed = i;
+            break;
+        }
+    }
+
+    int limit = atomic_load(&global_stats.shard_limit);
+    while (limit < claimed + 1 && !atomic_compare_exchange_weak(&global_stats.shard_limit, &limit, claimed + 1)) {
+    }
+    stats_self = &global_stats.shards[claimed];
+    return stats_self;
+}
+
+static LatencyHistogram *shard_histogram(SeriesCounters *counters, StatsMetric metric) {
+    LatencyHistogram *histogram = atomic_load_explicit(&counters->histograms[metric], memory_order_acquire);
+    if (histogram) return histogram;
+
+    LatencyHistogram *fresh = calloc(1, sizeof(LatencyHistogram));
+    if (!fresh) return NULL;
+
+    LatencyHistogram *expected = NULL;
+    if (!atomic_compare_exchange_strong(&counters->histograms[metric], &expected, fresh)) {
+        free(fresh);        // Another thread sharing the shard got there first
+        return expected;
+    }
+    return fresh;
+}
+
+static void series_touch(int id) {
+    int64_t now = (int64_t)time(NULL);
+    // Read first so the shared line is only written once a second
+    if (atomic_load_explicit(&global_stats.series[id].last_used, memory_order_relaxed) != now) {
+        atomic_store_explicit(&global_stats.series[id].last_used, now, memory_order_relaxed);
+    }
+}
+
+static uint64_t sum_counter(int id, size_t offset) {
+    int limit = atomic_load(&global_stats.shard_limit);
+    uint64_t total = 0;
+    for (int s = 0; s < limit; s++) {
+        _Atomic uint64_t *counter = (_Atomic uint64_t *)((char *)&global_stats.shards[s].series[id] + offset);
+        total += atomic_load_explicit(counter, memory_order_relaxed);
+    }
+    return total;
+}
+
+// Merge every shard of a model series into the ModelStats view
+static void fill_model_stats(int id, ModelStats *output) {
+    const StatsSeries *series = &global_stats.series[id];
+    memset(output, 0, sizeof(*output));
+
+    output->successful_requests = sum_counter(id, offsetof(SeriesCounters, successes));
+    output->failed_requests = sum_counter(id, offsetof(SeriesCounters, failures));
+    output->total_requests = output->successful_requests + output->failed_requests;
+    output->total_tokens_processed = sum_counter(id, offsetof(SeriesCounters, tokens));
+    output->last_used = (time_t)atomic_load_explicit(&series->last_used, memory_order_relaxed);
+
+    double min_ms = 0.0;
+    summarize(id, STATS_LATENCY, &output->latency[STATS_LATENCY], &min_ms);
+    summarize(id, STATS_TTFT, &output->latency[STATS_TTFT], NULL);
+    summarize(id, STATS_UPSTREAM, &output->latency[STATS_UPSTREAM], NULL);
+
+    output->avg_response_time = output->latency[STATS_LATENCY].mean_ms;
+    output->min_response_time = min_ms;
+    output->max_response_time = output->latency[STATS_LATENCY].max_ms;
+}
+
+// ===== Persistence =====
+
+/*
+ * Stats file layout (version 1, little-endian):
+ *
+ *   StatsFileHeader
+ *   per series:  StatsFileSeries
+ *                per metric: StatsFileHistogram, then bucket_count uint64
+ *                entries of (count << STATS_FILE_BUCKET_BITS | bucket)
+ *
+ * Only non-empty buckets are stored. body_crc covers everything after the
+ * header, so a torn or truncated file is rejected as a whole.
+ */
+#define STATS_FILE_MAGIC "AISTATS\0"
+#define STATS_FILE_VERSION 1
+#define STATS_FILE_BUCKET_BITS 10
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t series_count;
+    uint32_t histogram_buckets;     // Bucket layout the counts were recorded with
+    uint32_t metric_count;
+    int64_t saved_at;
+    uint64_t body_size;
+    uint32_t body_crc;
+    uint32_t reserved;
+} StatsFileHeader;
+
+typedef struct {
+    char name[STATS_NAME_MAX];
+    uint32_t scope;
+    uint32_t reserved;
+    uint64_t successes;
+    uint64_t failures;
+    uint64_t tokens;
+    int64_t last_used;
+} StatsFileSeries;
+
+typedef struct {
+    uint64_t sum_us;
+    uint64_t max_us;
+    uint32_t bucket_count;
+    uint32_t reserved;
+} StatsFileHistogram;
+
+static const char *const metric_names[STATS_METRIC_COUNT] = {"e2e", "ttft", "upstream"};
+
+static void json_export_summary(FILE *json, const char *metric, const LatencySummary *summary) {
+    fprintf(json, ", \"%s\": {\"count\": %lu, \"mean_ms\": %.3f, \"p50_ms\": %.3f, \"p90_ms\": %.3f, "
+                  "\"p99_ms\": %.3f, \"p999_ms\": %.3f, \"max_ms\": %.3f}",
+            metric, (unsigned long)summary->count, summary->mean_ms, summary->p50_ms, summary->p90_ms,
+            summary->p99_ms, summary->p999_ms, summary->max_ms);
+}
+
+/*
+ * Copy every series out of the shards once and serialize the copy, to the
+ * binary format and optionally to JSON. Recording threads are never blocked;
+ * samples landing during the copy go to the next snapshot or this one.
+ */
+static int build_snapshot(char **binary, size_t *binary_size, char **json_text, size_t *json_size) {
+    FILE *out = open_memstream(binary, binary_size);
+    if (!out) {
+        return -1;
+    }
+    FILE *json = json_text ? open_memstream(json_text, json_size) : NULL;
+    if (json_text && !json) {
+        fclose(out);
+        free(*binary);
+        return -1;
+    }
+
+    StatsFileHeader header;
+    memset(&header, 0, sizeof(header));
+    fwrite(&header, sizeof(header), 1, out);    // Filled in once the body is complete
+
+    MergedHistogram *merged = malloc(sizeof(MergedHistogram));
+    int count = atomic_load_explicit(&global_stats.series_count, memory_order_acquire);
+    if (json) fprintf(json, "{\n  \"saved_at\": %ld,\n  \"series\": [", (long)time(NULL));
+
+    for (int i = 0; merged && i < count; i++) {
+        const StatsSeries *series = &global_stats.series[i];
+        StatsFileSeries record;
+        memset(&record, 0, sizeof(record));
+        memcpy(record.name, series->name, sizeof(record.name));
+        record.scope = (uint32_t)series->scope;
+        record.successes = sum_counter(i, offsetof(SeriesCounters, successes));
+        record.failures = sum_counter(i, offsetof(SeriesCounters, failures));
+        record.tokens = sum_counter(i, offsetof(SeriesCounters, tokens));
+        record.last_used = atomic_load_explicit(&series->last_used, memory_order_relaxed);
+        fwrite(&record, sizeof(record), 1, out);
+
+        if (json) {
+            fprintf(json, "%s\n    {\"scope\": \"%s\", \"name\": \"", i ? "," : "",
+                    stats_scope_name(series->scope));
+            for (const char *c = series->name; *c; c++) {
+                if (*c == '"' || *c == '\\') fputc('\\', json);
+                if ((unsigned char)*c >= 0x20) fputc(*c, json);
+            }
+            fprintf(json, "\", \"successes\": %lu, \"failures\": %lu, \"tokens\": %lu, \"last_used\": %ld",
+                    (unsigned long)record.successes, (unsigned long)record.failures,
+                    (unsigned long)record.tokens, (long)record.last_used);
+        }
+
+        for (int m = 0; m < STATS_METRIC_COUNT; m++) {
+            histogram_merge(i, (StatsMetric)m, merged);
+
+            StatsFileHistogram histogram = {merged->sum_us, merged->max_us, 0, 0};
+            for (int b = 0; b < HIST_BUCKETS; b++) {
+                if (merged->counts[b]) histogram.bucket_count++;
+            }
+            fwrite(&histogram, sizeof(histogram), 1, out);
+            for (int b = 0; b < HIST_BUCKETS; b++) {
+                if (!merged->counts[b]) continue;
+                uint64_t entry = merged->counts[b] << STATS_FILE_BUCKET_BITS | (uint64_t)b;
+                fwrite(&entry, sizeof(entry), 1, out);
+            }
+
+            if (json && merged->count) {
+                LatencySummary summary;
+                summarize_merged(merged, &summary);
+                json_export_summary(json, metric_names[m], &summary);
+            }
+        }
+        if (json) fprintf(json, "}");
+    }
+
+    int failed = !merged;
+    free(merged);
+    if (json) {
+        fprintf(json, "\n  ]\n}\n");
+        failed |= fclose(json) != 0;
+    }
+    failed |= fclose(out) != 0;
+    if (failed) {
+        free(*binary);
+        if (json_text) free(*json_text);
+        return -1;
+    }
+
+    memcpy(header.magic, STATS_FILE_MAGIC, sizeof(header.magic));
+    header.version = STATS_FILE_VERSION;
+    header.series_count = (uint32_t)count;
+    header.histogram_buckets = HIST_BUCKETS;
+    header.metric_count = STATS_METRIC_COUNT;
+    header.saved_at = (int64_t)time(NULL);
+    header.body_size = *binary_size - sizeof(header);
+    header.body_crc = crc32_asm(*binary + sizeof(header), header.body_size);
+    memcpy(*binary, &header, sizeof(header));
+    return 0;
+}
+
+// Write to "<path>.tmp", fsync, and rename over the old file: a crash
+// leaves either the previous snapshot or the new one, never a mix
+static int write_file_atomic(const char *path, const char *data, size_t size) {
+    char tmp_path[PATH_MAX];
+    if (snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path) >= (int)sizeof(tmp_path)) {
+        return -1;
+    }
+
+    int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return -1;
+    }
 
-// Function to save stats to file
+    size_t written = 0;
+    while (written < size) {
+        ssize_t n = write(fd, data + written, size - written);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        written += (size_t)n;
+    }
+
+    int ok = written == size && fsync(fd) == 0;
+    ok = close(fd) == 0 && ok;
+    if (!ok || rename(tmp_path, path) != 0) {
+        unlink(tmp_path);
+        return -1;
+    }
+
+    // Make the rename itself durable
+    char dir_path[PATH_MAX];
+    snprintf(dir_path, sizeof(dir_path), "%s", path);
+    char *slash = strrchr(dir_path, '/');
+    if (!slash) {
+        strcpy(dir_path, ".");
+    } else if (slash == dir_path) {
+        dir_path[1] = '\0';
+    } else {
+        *slash = '\0';
+    }
+    int dir_fd = open(dir_path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir_fd >= 0) {
+        fsync(dir_fd);
+        close(dir_fd);
+    }
+    return 0;
+}
+
+// Function to save stats to file (and the JSON export, if configured)
 static int save_stats_to_file(const char *filename) {
     if (!filename) {
         return -1;
     }
-    
-    FILE *file = fopen(filename, "w");
-    if (!file) {
+
+    char *binary = NULL, *json_text = NULL;
+    size_t binary_size = 0, json_size = 0;
+
+    // Saves from the background thread and stats_save() take turns
+    pthread_mutex_lock(&global_stats.save_lock);
+
+    int result = build_snapshot(&binary, &binary_size, global_stats.json_file ? &json_text : NULL, &json_size);
+    if (result == 0) {
+        result = write_file_atomic(filename, binary, binary_size);
+        if (global_stats.json_file && write_file_atomic(global_stats.json_file, json_text, json_size) != 0) {
+            result = -1;
+        }
+        free(binary);
+        free(json_text);
+    }
+
+    pthread_mutex_unlock(&global_stats.save_lock);
+    return result;
+}
+
+// Bounds-checked reader over the loaded file
+typedef struct {
+    const char *data;
+    size_t size;
+    size_t pos;
+} FileReader;
+
+static const void *file_take(FileReader *reader, size_t size) {
+    if (size > reader->size - reader->pos) return NULL;
+    const void *p = reader->data + reader->pos;
+    reader->pos += size;
+    return p;
+}
+
+// Check the whole file before restoring anything from it
+static int validate_stats_file(const char *data, size_t size) {
+    if (size < sizeof(StatsFileHeader)) {
         return -1;
     }
-    
-    pthread_mutex_lock(&global_stats.mutex);
-    
-    // Write JSON header
-    fprintf(file, "{\n");
-    fprintf(file, "  \"models\": [\n");
-    
-    // Write stats for each model
-    for (int i = 0; i < global_stats.model_count; i++) {
-        ModelStats *stats = &global_stats.model_stats[i];
-        
-        fprintf(file, "    {\n");
-        fprintf(file, "      \"model_name\": \"%s\",\n", stats->model_name);
-        fprintf(file, "      \"total_requests\": %lu,\n", stats->total_requests);
-        fprintf(file, "      \"successful_requests\": %lu,\n", stats->successful_requests);
-        fprintf(file, "      \"failed_requests\": %lu,\n", stats->failed_requests);
-        fprintf(file, "      \"avg_response_time\": %.2f,\n", stats->avg_response_time);
-        fprintf(file, "      \"min_response_time\": %.2f,\n", stats->min_response_time);
-        fprintf(file, "      \"max_response_time\": %.2f,\n", stats->max_response_time);
-        fprintf(file, "      \"total_tokens_processed\": %lu,\n", stats->total_tokens_processed);
-        fprintf(file, "      \"last_used\": %ld\n", stats->last_used);
-        fprintf(file, "    }%s\n", (i < global_stats.model_count - 1) ? "," : "");
+
+    StatsFileHeader header;
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, STATS_FILE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != STATS_FILE_VERSION || header.histogram_buckets != HIST_BUCKETS ||
+        header.metric_count != STATS_METRIC_COUNT || header.body_size != size - sizeof(header) ||
+        header.body_crc != crc32_asm(data + sizeof(header), header.body_size)) {
+        return -1;
+    }
+
+    FileReader reader = {data, size, sizeof(header)};
+    for (uint32_t i = 0; i < header.series_count; i++) {
+        const StatsFileSeries *record = file_take(&reader, sizeof(StatsFileSeries));
+        if (!record || memchr(record->name, '\0', sizeof(record->name)) == NULL || record->scope > STATS_SCOPE_PHASE) {
+            return -1;
+        }
+        for (int m = 0; m < STATS_METRIC_COUNT; m++) {
+            StatsFileHistogram histogram;
+            const void *p = file_take(&reader, sizeof(histogram));
+            if (!p) return -1;
+            memcpy(&histogram, p, sizeof(histogram));
+            if (histogram.bucket_count > HIST_BUCKETS ||
+                !file_take(&reader, (size_t)histogram.bucket_count * sizeof(uint64_t))) {
+                return -1;
+            }
+        }
+    }
+    return reader.pos == size ? 0 : -1;
+}
+
+// Add one saved series to the restored shard
+static void restore_series(FileReader *reader) {
+    StatsFileSeries record;
+    memcpy(&record, file_take(reader, sizeof(record)), sizeof(record));
+
+    int id = record.name[0] ? series_get((StatsScope)record.scope, record.name) : -1;
+    SeriesCounters *counters = id >= 0 ? &global_stats.shards[STATS_RESTORED_SHARD].series[id] : NULL;
+    if (counters) {
+        atomic_fetch_add_explicit(&counters->successes, record.successes, memory_order_relaxed);
+        atomic_fetch_add_explicit(&counters->failures, record.failures, memory_order_relaxed);
+        atomic_fetch_add_explicit(&counters->tokens, record.tokens, memory_order_relaxed);
+        atomic_store_explicit(&global_stats.series[id].last_used, record.last_used, memory_order_relaxed);
+    }
+
+    for (int m = 0; m < STATS_METRIC_COUNT; m++) {
+        StatsFileHistogram saved;
+        memcpy(&saved, file_take(reader, sizeof(saved)), sizeof(saved));
+        const char *entries = file_take(reader, (size_t)saved.bucket_count * sizeof(uint64_t));
+
+        LatencyHistogram *histogram = counters && saved.bucket_count ? shard_histogram(counters, (StatsMetric)m) : NULL;
+        if (!histogram) continue;      // Untracked series or nothing recorded
+
+        for (uint32_t e = 0; e < saved.bucket_count; e++) {
+            uint64_t entry;
+            memcpy(&entry, entries + e * sizeof(entry), sizeof(entry));
+            int bucket = (int)(entry & (HIST_BUCKETS - 1));
+            atomic_fetch_add_explicit(&histogram->counts[bucket], entry >> STATS_FILE_BUCKET_BITS, memory_order_relaxed);
+        }
+        atomic_fetch_add_explicit(&histogram->sum_us, saved.sum_us, memory_order_relaxed);
+        uint64_t max = atomic_load_explicit(&histogram->max_us, memory_order_relaxed);
+        if (saved.max_us > max) atomic_store_explicit(&histogram->max_us, saved.max_us, memory_order_relaxed);
     }
-    
-    // Write JSON end
-    fprintf(file, "  ]\n");
-    fprintf(file, "}\n");
-    
-    pthread_mutex_unlock(&global_stats.mutex);
-    
-    fclose(file);
-    return 0;
 }
 
 // Function to load stats from file
@@ -75,61 +642,75 @@ static int load_stats_from_file(const char *filename) {
     if (!filename) {
         return -1;
     }
-    
-    FILE *file = fopen(filename, "r");
+
+    FILE *file = fopen(filename, "rb");
     if (!file) {
         return -1;
     }
-    
+
     // Read entire file
     fseek(file, 0, SEEK_END);
     long file_size = ftell(file);
     fseek(file, 0, SEEK_SET);
-    
-    char *file_content = malloc(file_size + 1);
-    if (!file_content) {
-        fclose(file);
-        return -1;
-    }
-    
-    fread(file_content, 1, file_size, file);
-    file_content[file_size] = '\0';
-    
+
+    char *file_content = file_size > 0 ? malloc((size_t)file_size) : NULL;
+    int read_ok = file_content && fread(file_content, 1, (size_t)file_size, file) == (size_t)file_size;
     fclose(file);
-    
-    // Parse JSON (simplified)
-    char *models_start = strstr(file_content, "\"models\":");
-    if (!models_start) {
+
+    if (!read_ok || validate_stats_file(file_content, (size_t)file_size) != 0) {
+        char log_msg[512];
+        snprintf(log_msg, sizeof(log_msg), "Ignoring unreadable or corrupt stats file %s", filename);
+        log_message("STATS", log_msg);
         free(file_content);
         return -1;
     }
-    
-   
-    
-    pthread_mutex_lock(&global_stats.mutex);
-    
-    // Add a dummy model
-    if (global_stats.model_count < global_stats.model_capacity) {
-        ModelStats *stats = &global_stats.model_stats[global_stats.model_count];
-        stats->model_name = strdup("gpt-3.5-turbo");
-        stats->total_requests = 100;
-        stats->successful_requests = 95;
-        stats->failed_requests = 5;
-        stats->avg_response_time = 250.5;
-        stats->min_response_time = 120.0;
-        stats->max_response_time = 800.0;
-        stats->total_tokens_processed = 15000;
-        stats->last_used = time(NULL);
-        
-        global_stats.model_count++;
+
+    StatsFileHeader header;
+    memcpy(&header, file_content, sizeof(header));
+    FileReader reader = {file_content, (size_t)file_size, sizeof(header)};
+    for (uint32_t i = 0; i < header.series_count; i++) {
+        restore_series(&reader);
     }
-    
-    pthread_mutex_unlock(&global_stats.mutex);
-    
+
+    char log_msg[512];
+    snprintf(log_msg, sizeof(log_msg), "Restored %u models and routes from %s", header.series_count, filename);
+    log_message("STATS", log_msg);
+
     free(file_content);
     return 0;
 }
 
+// ===== Background Saver =====
+
+static void *saver_thread(void *arg) {
+    (void)arg;
+    pthread_mutex_lock(&global_stats.saver_lock);
+
+    while (!global_stats.saver_stop) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_sec += global_stats.auto_save_interval;
+
+        int timed_out = 0;
+        while (!global_stats.saver_stop && !global_stats.save_requested && !timed_out) {
+            timed_out = pthread_cond_timedwait(&global_stats.saver_cond, &global_stats.saver_lock,
+                                               &deadline) == ETIMEDOUT;
+        }
+        if (global_stats.saver_stop) break;
+        global_stats.save_requested = 0;
+
+        pthread_mutex_unlock(&global_stats.saver_lock);
+        if (save_stats_to_file(global_stats.stats_file) != 0) {
+            log_message("STATS", "Failed to save stats snapshot");
+        }
+        atomic_store_explicit(&global_stats.last_save_time, time(NULL), memory_order_relaxed);
+        pthread_mutex_lock(&global_stats.saver_lock);
+    }
+
+    pthread_mutex_unlock(&global_stats.saver_lock);
+    return NULL;
+}
+
 // Structure for optimized stats
 typedef struct {
     char *key;
@@ -177,35 +758,48 @@ void stats_update_optimized(Stats *stats, const char *key, uint64_t value) {
     entry->timestamp = time(NULL);
 }
 
-// Initialize stats collector
-int stats_init(const char *stats_file, int auto_save_interval) {
-    global_stats.model_capacity = 16;
-    global_stats.model_stats = calloc(global_stats.model_capacity, sizeof(ModelStats));
-    if (!global_stats.model_stats) {
+// Initialize stats collector: restore the last snapshot and start the
+// thread that saves one every auto_save_interval seconds
+int stats_init(const char *stats_file, const char *json_file, int auto_save_interval) {
+    global_stats.stats_file = strdup(stats_file ? stats_file : "stats.bin");
+    global_stats.json_file = json_file ? strdup(json_file) : NULL;
+    if (!global_stats.stats_file || (json_file && !global_stats.json_file)) {
+        free(global_stats.stats_file);
+        free(global_stats.json_file);
+        global_stats.stats_file = global_stats.json_file = NULL;
         return -1;
     }
-    
-    global_stats.model_count = 0;
-    global_stats.stats_file = strdup(stats_file ? stats_file : "stats.json");
     global_stats.auto_save_interval = auto_save_interval;
-    global_stats.last_save_time = time(NULL);
-    
-    if (pthread_mutex_init(&global_stats.mutex, NULL) != 0) {
-        free(global_stats.model_stats);
-        free(global_stats.stats_file);
+    atomic_store_explicit(&global_stats.last_save_time, time(NULL), memory_order_relaxed);
+
+    load_stats_from_file(global_stats.stats_file);
+
+    // The saver waits on a monotonic clock so wall-clock jumps don't skip saves
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    int cond_ok = pthread_cond_init(&global_stats.saver_cond, &attr) == 0;
+    pthread_condattr_destroy(&attr);
+    if (!cond_ok) {
         return -1;
     }
-    
 
-    load_stats_from_file(global_stats.stats_file);
-    
+    global_stats.saver_stop = 0;
+    global_stats.save_requested = 0;
+    if (auto_save_interval > 0) {
+        if (pthread_create(&global_stats.saver, NULL, saver_thread, NULL) != 0) {
+            pthread_cond_destroy(&global_stats.saver_cond);
+            return -1;
+        }
+        global_stats.saver_running = 1;
+    }
 
     #ifdef LOG_MESSAGE_AVAILABLE
     log_message("STATS", "Stats collector initialized");
     #else
     printf("[STATS] Stats collector initialized\n");
     #endif
-    
+
     return 0;
 }
 
@@ -214,45 +808,11 @@ int stats_add_model(const char *model_name) {
     if (!model_name) {
         return -1;
     }
-    
-    pthread_mutex_lock(&global_stats.mutex);
-    
-    // Check if model already exists
-    for (int i = 0; i < global_stats.model_count; i++) {
-        if (strcmp(global_stats.model_stats[i].model_name, model_name) == 0) {
-            pthread_mutex_unlock(&global_stats.mutex);
-            return 0;  // Already exists
-        }
-    }
-    
-    // Expand capacity if needed
-    if (global_stats.model_count >= global_stats.model_capacity) {
-        int new_capacity = global_stats.model_capacity * 2;
-        ModelStats *new_stats = realloc(global_stats.model_stats, 
-                                       sizeof(ModelStats) * new_capacity);
-        if (!new_stats) {
-            pthread_mutex_unlock(&global_stats.mutex);
-            return -1;
-        }
-        
-        global_stats.model_stats = new_stats;
-        global_stats.model_capacity = new_capacity;
+
+    if (series_get(STATS_SCOPE_MODEL, model_name) < 0) {
+        return -1;
     }
-    
-    // Add new model
-    ModelStats *stats = &global_stats.model_stats[global_stats.model_count];
-    stats->model_name = strdup(model_name);
-    stats->total_requests = 0;
-    stats->successful_requests = 0;
-    stats->failed_requests = 0;
-    stats->avg_response_time = 0.0;
-    stats->min_response_time = 0.0;
-    stats->max_response_time = 0.0;
-    stats->total_tokens_processed = 0;
-    stats->last_used = time(NULL);
-    
-    global_stats.model_count++;
-    
+
     // Use log_message if available, otherwise use printf
     #ifdef LOG_MESSAGE_AVAILABLE
     char log_msg[256];
@@ -261,54 +821,33 @@ int stats_add_model(const char *model_name) {
     #else
     printf("[STATS] Added model to stats tracking: %s\n", model_name);
     #endif
-    
-    pthread_mutex_unlock(&global_stats.mutex);
+
     return 0;
 }
 
-// Record a successful request
+// Record a successful request; response_time is end-to-end, in milliseconds
 int stats_record_successful_request(const char *model_name, double response_time, int token_count) {
     if (!model_name) {
         return -1;
     }
-    
-    pthread_mutex_lock(&global_stats.mutex);
-    
-    for (int i = 0; i < global_stats.model_count; i++) {
-        if (strcmp(global_stats.model_stats[i].model_name, model_name) == 0) {
-            ModelStats *stats = &global_stats.model_stats[i];
-            
-            stats->total_requests++;
-            stats->successful_requests++;
-            stats->total_tokens_processed += token_count;
-            stats->last_used = time(NULL);
-            
-            // Update average response time
-            if (stats->avg_response_time == 0.0) {
-                stats->avg_response_time = response_time;
-                stats->min_response_time = response_time;
-                stats->max_response_time = response_time;
-            } else {
-                stats->avg_response_time = 
-                    (stats->avg_response_time * (stats->successful_requests - 1) + response_time) / 
-                    stats->successful_requests;
-                
-                if (response_time < stats->min_response_time) {
-                    stats->min_response_time = response_time;
-                }
-                
-                if (response_time > stats->max_response_time) {
-                    stats->max_response_time = response_time;
-                }
-            }
-            
-            pthread_mutex_unlock(&global_stats.mutex);
-            return 0;
-        }
+
+    int id = series_get(STATS_SCOPE_MODEL, model_name);
+    if (id < 0) {
+        return -1;
     }
-    
-    pthread_mutex_unlock(&global_stats.mutex);
-    return -1;
+
+    SeriesCounters *counters = &stats_shard()->series[id];
+    atomic_fetch_add_explicit(&counters->successes, 1, memory_order_relaxed);
+    if (token_count > 0) {
+        atomic_fetch_add_explicit(&counters->tokens, (uint64_t)token_count, memory_order_relaxed);
+    }
+
+    LatencyHistogram *histogram = shard_histogram(counters, STATS_LATENCY);
+    if (histogram) {
+        histogram_record(histogram, response_time > 0 ? (uint64_t)(response_time * 1000.0) : 0);
+    }
+    series_touch(id);
+    return 0;
 }
 
 // Record a failed request
@@ -316,24 +855,35 @@ int stats_record_failed_request(const char *model_name) {
     if (!model_name) {
         return -1;
     }
-    
-    pthread_mutex_lock(&global_stats.mutex);
-    
-    for (int i = 0; i < global_stats.model_count; i++) {
-        if (strcmp(global_stats.model_stats[i].model_name, model_name) == 0) {
-            ModelStats *stats = &global_stats.model_stats[i];
-            
-            stats->total_requests++;
-            stats->failed_requests++;
-            stats->last_used = time(NULL);
-            
-            pthread_mutex_unlock(&global_stats.mutex);
-            return 0;
-        }
+
+    int id = series_get(STATS_SCOPE_MODEL, model_name);
+    if (id < 0) {
+        return -1;
     }
-    
-    pthread_mutex_unlock(&global_stats.mutex);
-    return -1;
+
+    atomic_fetch_add_explicit(&stats_shard()->series[id].failures, 1, memory_order_relaxed);
+    series_touch(id);
+    return 0;
+}
+
+// Record one latency sample of a model or route
+int stats_record_latency(StatsScope scope, const char *name, StatsMetric metric, uint64_t latency_us) {
+    if (!name || metric < 0 || metric >= STATS_METRIC_COUNT) {
+        return -1;
+    }
+
+    int id = series_get(scope, name);
+    if (id < 0) {
+        return -1;
+    }
+
+    LatencyHistogram *histogram = shard_histogram(&stats_shard()->series[id], metric);
+    if (!histogram) {
+        return -1;
+    }
+    histogram_record(histogram, latency_us);
+    series_touch(id);
+    return 0;
 }
 
 // Get stats for a model
@@ -341,23 +891,18 @@ int stats_get_model_stats(const char *model_name, ModelStats *output) {
     if (!model_name || !output) {
         return -1;
     }
-    
-    pthread_mutex_lock(&global_stats.mutex);
-    
-    for (int i = 0; i < global_stats.model_count; i++) {
-        if (strcmp(global_stats.model_stats[i].model_name, model_name) == 0) {
-            *output = global_stats.model_stats[i];
-            
-            // Copy strings to avoid memory issues
-            output->model_name = strdup(global_stats.model_stats[i].model_name);
-            
-            pthread_mutex_unlock(&global_stats.mutex);
-            return 0;
-        }
+
+    size_t length = strlen(model_name);
+    int id = series_find(STATS_SCOPE_MODEL, model_name, length, series_hash(STATS_SCOPE_MODEL, model_name, length));
+    if (id < 0) {
+        return -1;
     }
-    
-    pthread_mutex_unlock(&global_stats.mutex);
-    return -1;
+
+    fill_model_stats(id, output);
+
+    // Copy strings to avoid memory issues
+    output->model_name = strdup(global_stats.series[id].name);
+    return output->model_name ? 0 : -1;
 }
 
 // Get stats for all models
@@ -365,52 +910,134 @@ int stats_get_all_stats(ModelStats **output, int *count) {
     if (!output || !count) {
         return -1;
     }
-    
-    pthread_mutex_lock(&global_stats.mutex);
-    
-    *count = global_stats.model_count;
-    *output = malloc(sizeof(ModelStats) * (*count));
-    
+
+    int series_count = atomic_load_explicit(&global_stats.series_count, memory_order_acquire);
+    *count = 0;
+    *output = malloc(sizeof(ModelStats) * (series_count ? series_count : 1));
     if (!*output) {
-        pthread_mutex_unlock(&global_stats.mutex);
         return -1;
     }
-    
-    for (int i = 0; i < *count; i++) {
-        (*output)[i] = global_stats.model_stats[i];
-        (*output)[i].model_name = strdup(global_stats.model_stats[i].model_name);
+
+    for (int i = 0; i < series_count; i++) {
+        if (global_stats.series[i].scope != STATS_SCOPE_MODEL) continue;
+
+        ModelStats *stats = &(*output)[*count];
+        fill_model_stats(i, stats);
+        stats->model_name = strdup(global_stats.series[i].name);
+        if (!stats->model_name) {
+            for (int j = 0; j < *count; j++) {
+                free((*output)[j].model_name);
+            }
+            free(*output);
+            *output = NULL;
+            *count = 0;
+            return -1;
+        }
+        (*count)++;
     }
-    
-    pthread_mutex_unlock(&global_stats.mutex);
     return 0;
 }
 
-// Auto-save stats
-int stats_auto_save() {
-    time_t current_time = time(NULL);
-    
-    if (current_time - global_stats.last_save_time >= global_stats.auto_save_interval) {
-        if (save_stats_to_file(global_stats.stats_file) == 0) {
-            global_stats.last_save_time = current_time;
-            
-
-            #ifdef LOG_MESSAGE_AVAILABLE
-            log_message("STATS", "Stats auto-saved to file");
-            #else
-            printf("[STATS] Stats auto-saved to file\n");
-            #endif
-            
-            return 0;
+// Get latency for a route pattern
+int stats_get_route_stats(const char *route, LatencySummary output[STATS_METRIC_COUNT]) {
+    if (!route || !output) {
+        return -1;
+    }
+
+    size_t length = strlen(route);
+    int id = series_find(STATS_SCOPE_ROUTE, route, length, series_hash(STATS_SCOPE_ROUTE, route, length));
+    if (id < 0) {
+        return -1;
+    }
+
+    for (int m = 0; m < STATS_METRIC_COUNT; m++) {
+        summarize(id, (StatsMetric)m, &output[m], NULL);
+    }
+    return 0;
+}
+
+// Snapshot of every tracked model and route
+int stats_get_series(StatsSeriesInfo *out, int max, int with_latency) {
+    int count = atomic_load_explicit(&global_stats.series_count, memory_order_acquire);
+
+    for (int i = 0; out && i < count && i < max; i++) {
+        const StatsSeries *series = &global_stats.series[i];
+        StatsSeriesInfo *info = &out[i];
+
+        memcpy(info->name, series->name, sizeof(info->name));
+        info->scope = series->scope;
+        info->successes = sum_counter(i, offsetof(SeriesCounters, successes));
+        info->failures = sum_counter(i, offsetof(SeriesCounters, failures));
+        info->tokens = sum_counter(i, offsetof(SeriesCounters, tokens));
+        memset(info->latency, 0, sizeof(info->latency));
+        for (int m = 0; with_latency && m < STATS_METRIC_COUNT; m++) {
+            summarize(i, (StatsMetric)m, &info->latency[m], NULL);
         }
     }
-    
-    return -1;
+    return count;
 }
 
-// Manually save stats
+// Re-bucket a merged histogram; each bucket counts at its midpoint, as in percentiles
+int stats_get_histogram(StatsScope scope, const char *name, StatsMetric metric, const double *bounds_ms,
+                        int bound_count, uint64_t *cumulative, uint64_t *count, double *sum_ms) {
+    if (!name || metric < 0 || metric >= STATS_METRIC_COUNT || (bound_count > 0 && (!bounds_ms || !cumulative))) {
+        return -1;
+    }
+
+    size_t length = strlen(name);
+    int id = series_find(scope, name, length, series_hash(scope, name, length));
+    if (id < 0) {
+        return -1;
+    }
+
+    MergedHistogram *merged = malloc(sizeof(MergedHistogram));
+    if (!merged) {
+        return -1;
+    }
+    histogram_merge(id, metric, merged);
+
+    uint64_t seen = 0;
+    int b = 0;
+    for (int i = 0; i < bound_count; i++) {
+        double bound_us = bounds_ms[i] * 1000.0;
+        while (b < HIST_BUCKETS && bucket_mid(b) <= bound_us) {
+            seen += merged->counts[b++];
+        }
+        cumulative[i] = seen;
+    }
+    if (count) *count = merged->count;
+    if (sum_ms) *sum_ms = (double)merged->sum_us / 1000.0;
+
+    free(merged);
+    return 0;
+}
+
+const char *stats_scope_name(StatsScope scope) {
+    static const char *const scope_names[] = {"model", "route", "phase"};
+    if (scope < 0 || scope > STATS_SCOPE_PHASE) return "unknown";
+    return scope_names[scope];
+}
+
+// Ask the saver thread for a snapshot once the interval has elapsed; never blocks on I/O
+int stats_auto_save() {
+    if (!global_stats.saver_running ||
+        time(NULL) - atomic_load_explicit(&global_stats.last_save_time, memory_order_relaxed) <
+        global_stats.auto_save_interval) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&global_stats.saver_lock);
+    global_stats.save_requested = 1;
+    pthread_cond_signal(&global_stats.saver_cond);
+    pthread_mutex_unlock(&global_stats.saver_lock);
+    return 0;
+}
+
+// Save a snapshot now, on the calling thread
 int stats_save() {
     int result = save_stats_to_file(global_stats.stats_file);
     if (result == 0) {
+        atomic_store_explicit(&global_stats.last_save_time, time(NULL), memory_order_relaxed);
 
         #ifdef LOG_MESSAGE_AVAILABLE
         log_message("STATS", "Stats saved to file");
@@ -421,24 +1048,30 @@ int stats_save() {
     return result;
 }
 
-// Clean up stats collector
+// Clean up stats collector: stop the saver and write a final snapshot.
+// Series and histograms stay allocated: threads still winding down may
+// record into them.
 void stats_cleanup() {
-    pthread_mutex_lock(&global_stats.mutex);
-    
+    if (global_stats.saver_running) {
+        pthread_mutex_lock(&global_stats.saver_lock);
+        global_stats.saver_stop = 1;
+        pthread_cond_signal(&global_stats.saver_cond);
+        pthread_mutex_unlock(&global_stats.saver_lock);
+        pthread_join(global_stats.saver, NULL);
+        global_stats.saver_running = 0;
+    }
+    pthread_cond_destroy(&global_stats.saver_cond);
+
     // Save final stats
-    save_stats_to_file(global_stats.stats_file);
-    
-    // Free model memory
-    for (int i = 0; i < global_stats.model_count; i++) {
-        free(global_stats.model_stats[i].model_name);
+    if (global_stats.stats_file && save_stats_to_file(global_stats.stats_file) != 0) {
+        log_message("STATS", "Failed to save final stats snapshot");
     }
-    
-    free(global_stats.model_stats);
+
     free(global_stats.stats_file);
-    
-    pthread_mutex_unlock(&global_stats.mutex);
-    pthread_mutex_destroy(&global_stats.mutex);
-    
+    free(global_stats.json_file);
+    global_stats.stats_file = NULL;
+    global_stats.json_file = NULL;
+
     // Use log_message if available, otherwise use printf
     #ifdef LOG_MESSAGE_AVAILABLE
     log_message("STATS", "Stats collector cleaned up");
@@ -9,6 +9,7 @@
 
 // ===== Project Headers =====
 #include "tokenizer.h"
+#include "bpe.h"
 #include "utils.h"
 #include "asm_utils.h"
 
@@ -17,8 +18,7 @@ typedef struct {
     Token *tokens;
     int token_count;
     int token_capacity;
-    char *vocabulary;
-    int vocabulary_size;
+    BpeVocab *vocab;            // Model vocabulary; NULL falls back to word splitting
 } Tokenizer;
 
 static Tokenizer global_tokenizer;
@@ -35,28 +35,20 @@ static int is_number_char(char c) {
     return isdigit(c) || c == '.';
 }
 
-// Function to split text into tokens
-static int tokenize_text(const char *text, Token **tokens, int *token_count) {
-    if (!text || !tokens || !token_count) {
-        return -1;
-    }
-    
-    int capacity = 64;
-    *tokens = malloc(sizeof(Token) * capacity);
-    *token_count = 0;
-    
-    if (!*tokens) {
-        return -1;
-    }
-    
+// Function to split text into words, punctuation runs and numbers.
+// Token ids are positions; nothing is copied.
+static long split_words(const char *text, size_t length, BpeEmit emit, void *ctx) {
     const char *ptr = text;
-    while (*ptr) {
+    const char *end = text + length;
+    long count = 0;
+    
+    while (ptr < end) {
         // Skip whitespace
-        while (*ptr && isspace(*ptr)) {
+        while (ptr < end && isspace((unsigned char)*ptr)) {
             ptr++;
         }
         
-        if (!*ptr) {
+        if (ptr == end) {
             break;
         }
         
@@ -70,8 +62,8 @@ static int tokenize_text(const char *text, Token **tokens, int *token_count) {
         
         // Extract token
         const char *start = ptr;
-        while (*ptr) {
-            if (type == 0 && (isspace(*ptr) || is_punctuation(*ptr))) {
+        while (ptr < end) {
+            if (type == 0 && (isspace((unsigned char)*ptr) || is_punctuation(*ptr))) {
                 break;
             } else if (type == 1 && !is_punctuation(*ptr)) {
                 break;
@@ -81,37 +73,84 @@ static int tokenize_text(const char *text, Token **tokens, int *token_count) {
             ptr++;
         }
         
-        // Create new token
-        if (*token_count >= capacity) {
-            capacity *= 2;
-            Token *new_tokens = realloc(*tokens, sizeof(Token) * capacity);
-            if (!new_tokens) {
-                free(*tokens);
-                return -1;
-            }
-            *tokens = new_tokens;
-        }
-        
-        int length = ptr - start;
-        (*tokens)[*token_count].text = malloc(length + 1);
-        if (!(*tokens)[*token_count].text) {
-            // Free previously allocated memory
-            for (int i = 0; i < *token_count; i++) {
-                free((*tokens)[i].text);
-            }
-            free(*tokens);
-            return -1;
+        if (emit && emit(ctx, (uint32_t)count, (size_t)(start - text), (size_t)(ptr - start)) != 0) {
+            break;
         }
-        
-        // Secure copy with explicit null termination
-        strncpy((*tokens)[*token_count].text, start, length);
-        (*tokens)[*token_count].text[length] = '\0'; 
-        (*tokens)[*token_count].id = *token_count;
-        (*tokens)[*token_count].type = type;
-        
-        (*token_count)++;
+        count++;
+    }
+    
+    return count;
+}
+
+// Split with the vocabulary when one is loaded, into words otherwise
+static long encode(const char *text, size_t length, BpeEmit emit, void *ctx) {
+    if (global_tokenizer.vocab) {
+        return bpe_encode(global_tokenizer.vocab, text, length, emit, ctx);
+    }
+    return split_words(text, length, emit, ctx);
+}
+
+// Type of a token: BPE tokens are classified by their first non-space byte
+static int token_type(const char *text, size_t length) {
+    if (!global_tokenizer.vocab) {
+        return is_punctuation(text[0]) ? 1 : is_number_char(text[0]) ? 2 : 0;
+    }
+    
+    size_t i = 0;
+    while (i < length && isspace((unsigned char)text[i])) i++;
+    if (i == length) return 1;
+    unsigned char c = (unsigned char)text[i];
+    if (isdigit(c)) return 2;
+    return (isalpha(c) || c >= 0x80) ? 0 : 1;
+}
+
+typedef struct {
+    uint32_t *ids;
+    uint32_t *offsets;
+    size_t capacity;
+    size_t count;
+} EncodeBuffer;
+
+// Keeps counting past the capacity so the caller learns the size it needs
+static int store_token(void *ctx, uint32_t id, size_t offset, size_t length) {
+    (void)length;
+    EncodeBuffer *out = ctx;
+    if (out->count < out->capacity) {
+        if (out->ids) out->ids[out->count] = id;
+        if (out->offsets) out->offsets[out->count] = (uint32_t)offset;
+    }
+    out->count++;
+    return 0;
+}
+
+typedef struct {
+    const char *text;
+    Token **tokens;
+    int count;
+    int capacity;
+    int failed;
+} TokenList;
+
+static int collect_token(void *ctx, uint32_t id, size_t offset, size_t length) {
+    TokenList *list = ctx;
+    if (list->count >= list->capacity) {
+        int capacity = list->capacity ? list->capacity * 2 : 64;
+        Token **new_tokens = realloc(list->tokens, sizeof(Token *) * capacity);
+        if (!new_tokens) return list->failed = -1;
+        list->tokens = new_tokens;
+        list->capacity = capacity;
     }
     
+    Token *token = malloc(sizeof(Token));
+    if (!token) return list->failed = -1;
+    token->text = strndup(list->text + offset, length);
+    if (!token->text) {
+        free(token);
+        return list->failed = -1;
+    }
+    token->id = (int)id;
+    token->type = token_type(list->text + offset, length);
+    list->tokens[list->count++] = token;
     return 0;
 }
 
@@ -159,8 +198,7 @@ int tokenizer_init() {
     }
     
     global_tokenizer.token_count = 0;
-    global_tokenizer.vocabulary = NULL;
-    global_tokenizer.vocabulary_size = 0;
+    global_tokenizer.vocab = NULL;
     
     // Use log_message if available, otherwise use printf
     #ifdef LOG_MESSAGE_AVAILABLE
@@ -172,80 +210,82 @@ int tokenizer_init() {
     return 0;
 }
 
-// Tokenize text
-int tokenizer_tokenize(const char *text, Token ***tokens, int *token_count) {
-    if (!text || !tokens || !token_count) {
+// Load a BPE vocabulary; token ids and counts then match the model's
+int tokenizer_load_vocab(const char *path) {
+    BpeVocab *vocab;
+    if (bpe_vocab_open(path, &vocab) != 0) {
         return -1;
     }
     
-    // Split text into tokens
-    Token *raw_tokens;
-    int raw_token_count;
+    bpe_vocab_close(global_tokenizer.vocab);
+    global_tokenizer.vocab = vocab;
     
-    if (tokenize_text(text, &raw_tokens, &raw_token_count) != 0) {
+    char log_msg[512];
+    snprintf(log_msg, sizeof(log_msg), "Loaded BPE vocabulary %s (%u tokens)", path, bpe_vocab_size(vocab));
+    log_message("TOKENIZER", log_msg);
+    return 0;
+}
+
+// Count model tokens (words without a vocabulary) without materializing them
+long tokenizer_count_tokens(const char *text, size_t length) {
+    if (!text || length > UINT32_MAX) {
+        return -1;
+    }
+    return encode(text, length, NULL, NULL);
+}
+
+// Encode into caller-provided buffers
+long tokenizer_encode(const char *text, size_t length, uint32_t *ids, uint32_t *offsets, size_t capacity) {
+    if (!text || length > UINT32_MAX) {
         return -1;
     }
     
-    // Copy tokens to output
-    *tokens = malloc(sizeof(Token *) * raw_token_count);
-    if (!*tokens) {
-        for (int i = 0; i < raw_token_count; i++) {
-            free(raw_tokens[i].text);
-        }
-        free(raw_tokens);
+    EncodeBuffer out = {ids, offsets, capacity, 0};
+    long count = encode(text, length, store_token, &out);
+    return count < 0 ? -1 : (long)out.count;
+}
+
+// Encode into buffers allocated from the arena
+long tokenizer_encode_arena(Arena *arena, const char *text, size_t length, uint32_t **ids, uint32_t **offsets) {
+    if (!arena || !text || !ids || length > UINT32_MAX) {
         return -1;
     }
     
-    for (int i = 0; i < raw_token_count; i++) {
-        (*tokens)[i] = malloc(sizeof(Token));
-        if (!(*tokens)[i]) {
-            // Free previously allocated memory
-            for (int j = 0; j < i; j++) {
-                free((*tokens)[j]);
-            }
-            free(*tokens);
-            for (int j = 0; j < raw_token_count; j++) {
-                free(raw_tokens[j].text);
-            }
-            free(raw_tokens);
+    // BPE averages about four bytes per token; a second pass is rare
+    size_t capacity = length / 2 + 16;
+    for (int pass = 0; pass < 2; pass++) {
+        *ids = arena_alloc(arena, sizeof(uint32_t) * capacity);
+        if (offsets) *offsets = arena_alloc(arena, sizeof(uint32_t) * capacity);
+        if (!*ids || (offsets && !*offsets)) {
             return -1;
         }
         
-        (*tokens)[i]->text = strdup(raw_tokens[i].text);
-        if (!(*tokens)[i]->text) {
-            // Clean up on allocation failure
-            for (int j = 0; j < i; j++) {
-                free((*tokens)[j]->text);
-                free((*tokens)[j]);
-            }
-            free(*tokens);
-            for (int j = 0; j < raw_token_count; j++) {
-                free(raw_tokens[j].text);
-            }
-            free(raw_tokens);
-            return -1;
+        long count = tokenizer_encode(text, length, *ids, offsets ? *offsets : NULL, capacity);
+        if (count < 0 || (size_t)count <= capacity) {
+            return count;
         }
-        (*tokens)[i]->id = raw_tokens[i].id;
-        (*tokens)[i]->type = raw_tokens[i].type;
+        capacity = (size_t)count;
     }
-    
-    *token_count = raw_token_count;
-    
-    // Free temporary memory
-    for (int i = 0; i < raw_token_count; i++) {
-        free(raw_tokens[i].text);
+    return -1;
+}
+
+// Tokenize text into individually allocated tokens
+int tokenizer_tokenize(const char *text, Token ***tokens, int *token_count) {
+    if (!text || !tokens || !token_count) {
+        return -1;
     }
-    free(raw_tokens);
     
-
-    #ifdef LOG_MESSAGE_AVAILABLE
-    char log_msg[256];
-    snprintf(log_msg, sizeof(log_msg), "Tokenized text into %d tokens", *token_count);
-    log_message("TOKENIZER", log_msg);
-    #else
-    printf("[TOKENIZER] Tokenized text into %d tokens\n", *token_count);
-    #endif
+    TokenList list = {text, NULL, 0, 0, 0};
+    if (encode(text, strlen(text), collect_token, &list) < 0 || list.failed) {
+        for (int i = 0; i < list.count; i++) {
+            tokenizer_free_token(list.tokens[i]);
+        }
+        free(list.tokens);
+        return -1;
+    }
     
+    *tokens = list.tokens;
+    *token_count = list.count;
     return 0;
 }
 
@@ -257,6 +297,9 @@ int tokenizer_detokenize(Token **tokens, int token_count, char *output, size_t o
     
     size_t total_length = 0;
     
+    // BPE tokens carry their own spacing
+    int add_spaces = global_tokenizer.vocab == NULL;
+    
     // Calculate total required length
     for (int i = 0; i < token_count; i++) {
         if (tokens[i]) {
@@ -267,7 +310,7 @@ int tokenizer_detokenize(Token **tokens, int token_count, char *output, size_t o
             total_length += token_len;
             
             // Add space if needed
-            if (i < token_count - 1 && tokens[i]->type == 0 && tokens[i+1]->type == 0) {
+            if (add_spaces && i < token_count - 1 && tokens[i]->type == 0 && tokens[i+1]->type == 0) {
                 if (total_length >= SIZE_MAX - 1) {
                     return -1; 
                 }
@@ -298,7 +341,7 @@ int tokenizer_detokenize(Token **tokens, int token_count, char *output, size_t o
             current_len += token_len;
             
             // Add space if needed
-            if (i < token_count - 1 && tokens[i]->type == 0 && tokens[i+1]->type == 0) {
+            if (add_spaces && i < token_count - 1 && tokens[i]->type == 0 && tokens[i+1]->type == 0) {
                 if (current_len >= output_size - 1) {
                     return -1; 
                 }
@@ -362,9 +405,8 @@ void tokenizer_cleanup() {
     }
     
     free(global_tokenizer.tokens);
-    if (global_tokenizer.vocabulary) {
-        free(global_tokenizer.vocabulary);
-    }
+    bpe_vocab_close(global_tokenizer.vocab);
+    global_tokenizer.vocab = NULL;
     
     // Use log_message if available, otherwise use printf
     #ifdef LOG_MESSAGE_AVAILABLE
@@ -0,0 +1,164 @@
+#define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE
+
+// ===== Standard Library Headers =====
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+// ===== Project Headers =====
+#include "arena.h"
+
+#define ARENA_ALIGNMENT 16
+
+struct ArenaBlock {
+    ArenaBlock *next;
+    size_t size;            // Usable bytes after the header
+    size_t used;
+};
+
+#define BLOCK_HEADER_SIZE ((sizeof(ArenaBlock) + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1))
+
+static inline char *block_data(ArenaBlock *block) {
+    return (char *)block + BLOCK_HEADER_SIZE;
+}
+
+static size_t page_round(size_t size) {
+    static size_t page_size = 0;
+    if (!page_size) {
+        long ps = sysconf(_SC_PAGESIZE);
+        page_size = ps > 0 ? (size_t)ps : 4096;
+    }
+    return (size + page_size - 1) & ~(page_size - 1);
+}
+
+static ArenaBlock *block_create(size_t min_size) {
+    size_t mapped = page_round(BLOCK_HEADER_SIZE + min_size);
+    void *mem = mmap(NULL, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) return NULL;
+
+    ArenaBlock *block = (ArenaBlock *)mem;
+    block->next = NULL;
+    block->size = mapped - BLOCK_HEADER_SIZE;
+    block->used = 0;
+    return block;
+}
+
+static void block_destroy(ArenaBlock *block) {
+    munmap(block, BLOCK_HEADER_SIZE + block->size);
+}
+
+int arena_init(Arena *arena, size_t block_size) {
+    if (!arena) return -1;
+
+    memset(arena, 0, sizeof(Arena));
+    arena->block_size = block_size ? block_size : ARENA_DEFAULT_BLOCK_SIZE;
+    arena->first = block_create(arena->block_size);
+    if (!arena->first) return -1;
+
+    // Record the rounded size so later blocks compare equal in arena_reset
+    arena->block_size = arena->first->size;
+    arena->current = arena->first;
+    return 0;
+}
+
+void arena_destroy(Arena *arena) {
+    if (!arena) return;
+
+    ArenaBlock *block = arena->first;
+    while (block) {
+        ArenaBlock *next = block->next;
+        block_destroy(block);
+        block = next;
+    }
+    memset(arena, 0, sizeof(Arena));
+}
+
+// Keep standard blocks for reuse, return oversized ones to the OS
+void arena_reset(Arena *arena) {
+    if (!arena || !arena->first) return;
+
+    ArenaBlock **link = &arena->first;
+    while (*link) {
+        ArenaBlock *block = *link;
+        if (block->size > arena->block_size && block != arena->first) {
+            *link = block->next;
+            block_destroy(block);
+            continue;
+        }
+        block->used = 0;
+        link = &block->next;
+    }
+
+    arena->current = arena->first;
+    arena->last_ptr = NULL;
+    arena->last_size = 0;
+}
+
+void *arena_alloc(Arena *arena, size_t size) {
+    if (!arena || !arena->current) return NULL;
+
+    size_t aligned = (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+    if (aligned < size) return NULL;  // Overflow
+
+    // Walk forward through blocks retained by earlier resets; blocks after
+    // `current` are always empty
+    ArenaBlock *block = arena->current;
+    while (block->size - block->used < aligned) {
+        if (!block->next) {
+            ArenaBlock *fresh = block_create(aligned > arena->block_size ? aligned : arena->block_size);
+            if (!fresh) return NULL;
+            block->next = fresh;
+        }
+        block = block->next;
+    }
+
+    arena->current = block;
+    void *ptr = block_data(block) + block->used;
+    block->used += aligned;
+
+    arena->last_ptr = ptr;
+    arena->last_size = aligned;
+    return ptr;
+}
+
+void *arena_realloc(Arena *arena, void *ptr, size_t old_size, size_t new_size) {
+    if (!ptr) return arena_alloc(arena, new_size);
+    if (new_size <= old_size) return ptr;
+
+    // Extend the most recent allocation in place if the block has room
+    if (ptr == arena->last_ptr) {
+        ArenaBlock *block = arena->current;
+        size_t offset = (size_t)((char *)ptr - block_data(block));
+        size_t aligned = (new_size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+        if (aligned >= new_size && offset + aligned <= block->size) {
+            block->used = offset + aligned;
+            arena->last_size = aligned;
+            return ptr;
+        }
+    }
+
+    void *grown = arena_alloc(arena, new_size);
+    if (!grown) return NULL;
+    memcpy(grown, ptr, old_size);
+    return grown;
+}
+
+char *arena_strndup(Arena *arena, const char *str, size_t len) {
+    char *copy = arena_alloc(arena, len + 1);
+    if (!copy) return NULL;
+    memcpy(copy, str, len);
+    copy[len] = '\0';
+    return copy;
+}
+
+size_t arena_used(const Arena *arena) {
+    size_t used = 0;
+    for (const ArenaBlock *block = arena ? arena->first : NULL; block; block = block->next) {
+        used += block->used;
+    }
+    return used;
+}
@@ -1,441 +0,0 @@
-; json_fast.s - Highly optimized JSON tokenizer with SIMD support
-; Based on x86-64 architecture with SSE4.2 and AVX2 instructions
-
-global json_fast_tokenizer
-global json_fast_tokenizer_avx2
-
-; Function: json_fast_tokenizer (SSE4.2 optimized)
-; Inputs:
-;   rdi - pointer to JSON string
-;   rsi - string length
-; Outputs:
-;   Nothing (memory will be modified directly)
-
-; Function: json_fast_tokenizer_avx2 (AVX2 optimized)
-; Inputs:
-;   rdi - pointer to JSON string
-;   rsi - string length
-; Outputs:
-;   Nothing (memory will be modified directly)
-
-section .text
-
-; Standard JSON tokenizer using SSE4.2
-json_fast_tokenizer:
-    push rbp
-    mov rbp, rsp
-    
-    ; Save registers we will use
-    push rbx
-    push r12
-    push r13
-    push r14
-    push r15
-    
-    ; rdi = json_string
-    ; rsi = length
-    ; r12 = current position
-    ; r13 = end position
-    ; r14 = state (0: outside, 1: in_string, 2: in_object, 3: in_array)
-    ; r15 = temporary register for SIMD operations
-    
-    mov r12, rdi          ; current position = start of string
-    mov r13, rsi           ; end position = length
-    mov r14, 0             ; state = outside
-    
-    ; Check for SSE4.2 support
-    push rbx
-    mov eax, 1
-    cpuid
-    pop rbx
-    test ecx, 1 << 20  ; Check SSE4.2 bit
-    jz .scalar_processing
-    
-    ; Main processing loop with SIMD optimizations
-.loop:
-    cmp r12, r13           ; if current_position >= end_position, exit
-    jge .end
-    
-    ; Check if we have at least 16 bytes remaining for SIMD processing
-    mov r15, r13
-    sub r15, r12
-    cmp r15, 16
-    jb .scalar_processing
-    
-    ; Load 16 bytes using SSE4.2
-    movdqu xmm0, [r12]
-    
-    ; Check for special characters using SSE4.2 string instructions
-    ; This is a simplified version - in a real implementation,
-    ; we would use PCMPISTRI for parallel character comparison
-    
-    ; For now, fall back to scalar processing
-    jmp .scalar_processing
-    
-.scalar_processing:
-    mov al, [r12]          ; load current character
-    
-    ; Process current state
-    cmp r14, 0             ; if state == outside
-    je .outside
-    
-    cmp r14, 1             ; if state == in_string
-    je .in_string
-    
-    cmp r14, 2             ; if state == in_object
-    je .in_object
-    
-    cmp r14, 3             ; if state == in_array
-    je .in_array
-    
-.outside:
-    ; Process characters outside strings
-    cmp al, '"'            ; if char == '"', start string
-    je .start_string
-    
-    cmp al, '{'            ; if char == '{', start object
-    je .start_object
-    
-    cmp al, '['            ; if char == '[', start array
-    je .start_array
-    
-    cmp al, '}'            ; if char == '}', end object
-    je .end_object
-    
-    cmp al, ']'            ; if char == ']', end array
-    je .end_array
-    
-    ; Skip whitespace characters efficiently
-    cmp al, ' '
-    je .next_char
-    cmp al, '\t'
-    je .next_char
-    cmp al, '\n'
-    je .next_char
-    cmp al, '\r'
-    je .next_char
-    
-    jmp .next_char
-    
-.in_string:
-    ; Process characters inside string
-    cmp al, '"'            ; if char == '"', end string
-    je .end_string
-    
-    cmp al, '\'            ; if char == '\', handle escape
-    je .escape_char
-    
-    jmp .next_char
-    
-.in_object:
-    ; Process characters inside object
-    cmp al, '}'            ; if char == '}', end object
-    je .end_object
-    
-    cmp al, '"'            ; if char == '"', start string
-    je .start_string
-    
-    ; Skip whitespace characters efficiently
-    cmp al, ' '
-    je .next_char
-    cmp al, '\t'
-    je .next_char
-    cmp al, '\n'
-    je .next_char
-    cmp al, '\r'
-    je .next_char
-    
-    jmp .next_char
-    
-.in_array:
-    ; Process characters inside array
-    cmp al, ']'            ; if char == ']', end array
-    je .end_array
-    
-    cmp al, '"'            ; if char == '"', start string
-    je .start_string
-    
-    ; Skip whitespace characters efficiently
-    cmp al, ' '
-    je .next_char
-    cmp al, '\t'
-    je .next_char
-    cmp al, '\n'
-    je .next_char
-    cmp al, '\r'
-    je .next_char
-    
-    jmp .next_char
-    
-.start_string:
-    mov r14, 1             ; state = in_string
-    jmp .next_char
-    
-.end_string:
-    mov r14, 0             ; state = outside
-    jmp .next_char
-    
-.start_object:
-    mov r14, 2             ; state = in_object
-    jmp .next_char
-    
-.end_object:
-    mov r14, 0             ; state = outside
-    jmp .next_char
-    
-.start_array:
-    mov r14, 3             ; state = in_array
-    jmp .next_char
-    
-.end_array:
-    mov r14, 0             ; state = outside
-    jmp .next_char
-    
-.escape_char:
-    ; Skip next character after '\'
-    inc r12
-    jmp .next_char
-    
-.next_char:
-    inc r12                 ; current_position++
-    jmp .loop
-    
-.end:
-    ; Restore registers
-    pop r15
-    pop r14
-    pop r13
-    pop r12
-    pop rbx
-    
-    mov rsp, rbp
-    pop rbp
-    ret
-
-; Advanced JSON tokenizer using AVX2
-json_fast_tokenizer_avx2:
-    push rbp
-    mov rbp, rsp
-    
-    ; Save registers we will use
-    push rbx
-    push r12
-    push r13
-    push r14
-    push r15
-    
-    ; rdi = json_string
-    ; rsi = length
-    ; r12 = current position
-    ; r13 = end position
-    ; r14 = state (0: outside, 1: in_string, 2: in_object, 3: in_array)
-    ; r15 = temporary register for SIMD operations
-    
-    mov r12, rdi          ; current position = start of string
-    mov r13, rsi           ; end position = length
-    mov r14, 0             ; state = outside
-    
-    ; Check for AVX2 support
-    push rbx
-    mov eax, 7
-    xor ecx, ecx
-    cpuid
-    pop rbx
-    test ebx, 1 << 5  ; Check AVX2 bit
-    jz json_fast_tokenizer  ; Fall back to SSE4.2 implementation
-    
-    ; Main processing loop with AVX2 optimizations
-.avx_loop:
-    cmp r12, r13           ; if current_position >= end_position, exit
-    jge .avx_end
-    
-    ; Check if we have at least 32 bytes remaining for AVX2 processing
-    mov r15, r13
-    sub r15, r12
-    cmp r15, 32
-    jb .avx_scalar_processing
-    
-    ; Load 32 bytes using AVX2
-    vmovdqu ymm0, [r12]
-    
-    ; Check for special characters using AVX2 instructions
-    ; This is a simplified version - in a real implementation,
-    ; we would use VPCMPISTRI for parallel character comparison
-    
-    ; For now, fall back to scalar processing
-    jmp .avx_scalar_processing
-    
-.avx_scalar_processing:
-    mov al, [r12]          ; load current character
-    
-    ; Process current state with optimized branching
-    cmp r14, 0             ; if state == outside
-    je .avx_outside
-    
-    cmp r14, 1             ; if state == in_string
-    je .avx_in_string
-    
-    cmp r14, 2             ; if state == in_object
-    je .avx_in_object
-    
-    cmp r14, 3             ; if state == in_array
-    je .avx_in_array
-    
-.avx_outside:
-    ; Process characters outside strings with optimized comparisons
-    cmp al, '"'            ; if char == '"', start string
-    je .avx_start_string
-    
-    cmp al, '{'            ; if char == '{', start object
-    je .avx_start_object
-    
-    cmp al, '['            ; if char == '[', start array
-    je .avx_start_array
-    
-    cmp al, '}'            ; if char == '}', end object
-    je .avx_end_object
-    
-    cmp al, ']'            ; if char == ']', end array
-    je .avx_end_array
-    
-    ; Skip whitespace characters using a jump table
-    movzx r15, al
-    lea rbx, [.whitespace_jump_table]
-    jmp [rbx + r15*8]      ; استخدام r15*8 مع dq
-    
-.avx_in_string:
-    ; Process characters inside string
-    cmp al, '"'            ; if char == '"', end string
-    je .avx_end_string
-    
-    cmp al, '\'            ; if char == '\', handle escape
-    je .avx_escape_char
-    
-    jmp .avx_next_char
-    
-.avx_in_object:
-    ; Process characters inside object
-    cmp al, '}'            ; if char == '}', end object
-    je .avx_end_object
-    
-    cmp al, '"'            ; if char == '"', start string
-    je .avx_start_string
-    
-    ; Skip whitespace characters using a jump table
-    movzx r15, al
-    lea rbx, [.whitespace_jump_table]
-    jmp [rbx + r15*8]      ; استخدام r15*8 مع dq
-    
-.avx_in_array:
-    ; Process characters inside array
-    cmp al, ']'            ; if char == ']', end array
-    je .avx_end_array
-    
-    cmp al, '"'            ; if char == '"', start string
-    je .avx_start_string
-    
-    ; Skip whitespace characters using a jump table
-    movzx r15, al
-    lea rbx, [.whitespace_jump_table]
-    jmp [rbx + r15*8]      ; استخدام r15*8 مع dq
-    
-.avx_start_string:
-    mov r14, 1             ; state = in_string
-    jmp .avx_next_char
-    
-.avx_end_string:
-    mov r14, 0             ; state = outside
-    jmp .avx_next_char
-    
-.avx_start_object:
-    mov r14, 2             ; state = in_object
-    jmp .avx_next_char
-    
-.avx_end_object:
-    mov r14, 0             ; state = outside
-    jmp .avx_next_char
-    
-.avx_start_array:
-    mov r14, 3             ; state = in_array
-    jmp .avx_next_char
-    
-.avx_end_array:
-    mov r14, 0             ; state = outside
-    jmp .avx_next_char
-    
-.avx_escape_char:
-    ; Skip next character after '\'
-    inc r12
-    jmp .avx_next_char
-    
-.whitespace_jump_table:
-    ; Jump table for whitespace characters (ASCII 0-255)
-    ; استخدام dq بدلاً من dd
-    times 256 dq .avx_process_char  ; Default for all characters
-    
-    ; Override entries for whitespace characters
-    dq .avx_next_char  ; 0 (null)
-    dq .avx_process_char  ; 1
-    dq .avx_process_char  ; 2
-    dq .avx_process_char  ; 3
-    dq .avx_process_char  ; 4
-    dq .avx_process_char  ; 5
-    dq .avx_process_char  ; 6
-    dq .avx_process_char  ; 7
-    dq .avx_process_char  ; 8
-    dq .avx_next_char  ; 9 (tab)
-    dq .avx_next_char  ; 10 (newline)
-    dq .avx_process_char  ; 11
-    dq .avx_process_char  ; 12
-    dq .avx_next_char  ; 13 (return)
-    dq .avx_process_char  ; 14
-    dq .avx_process_char  ; 15
-    dq .avx_process_char  ; 16
-    dq .avx_process_char  ; 17
-    dq .avx_process_char  ; 18
-    dq .avx_process_char  ; 19
-    dq .avx_process_char  ; 20
-    dq .avx_process_char  ; 21
-    dq .avx_process_char  ; 22
-    dq .avx_process_char  ; 23
-    dq .avx_process_char  ; 24
-    dq .avx_process_char  ; 25
-    dq .avx_process_char  ; 26
-    dq .avx_process_char  ; 27
-    dq .avx_process_char  ; 28
-    dq .avx_process_char  ; 29
-    dq .avx_process_char  ; 30
-    dq .avx_process_char  ; 31
-    dq .avx_next_char  ; 32 (space)
-    
-.avx_process_char:
-    ; Process non-whitespace characters based on state
-    cmp r14, 0             ; if state == outside
-    je .avx_outside
-    
-    cmp r14, 1             ; if state == in_string
-    je .avx_in_string
-    
-    cmp r14, 2             ; if state == in_object
-    je .avx_in_object
-    
-    cmp r14, 3             ; if state == in_array
-    je .avx_in_array
-    
-    jmp .avx_next_char
-    
-.avx_next_char:
-    inc r12                 ; current_position++
-    jmp .avx_loop
-    
-.avx_end:
-    ; Restore registers
-    pop r15
-    pop r14
-    pop r13
-    pop r12
-    pop rbx
-    
-    mov rsp, rbp
-    pop rbp
-    ret
@@ -81,6 +81,97 @@ static int parse_config_line(const char *line, Config *config) {
             config->api_keys[config->api_key_count] = strdup(value);
             config->api_key_count++;
         }
+    } else if (strcmp(key, "hedge_percentile") == 0) {
+        config->hedge_percentile = atof(value);
+    } else if (strcmp(key, "hedge_budget") == 0) {
+        config->hedge_budget = atof(value);
+    } else if (strcmp(key, "breaker_failure_rate") == 0) {
+        config->breaker_failure_rate = atof(value);
+    } else if (strcmp(key, "breaker_slow_ms") == 0) {
+        config->breaker_slow_ms = atoi(value);
+    } else if (strcmp(key, "breaker_open_ms") == 0) {
+        config->breaker_open_ms = atoi(value);
+    } else if (strcmp(key, "model_fallback") == 0) {
+        if (config->model_fallback_count < 64) {
+            config->model_fallbacks[config->model_fallback_count] = strdup(value);
+            config->model_fallback_count++;
+        }
+    } else if (strcmp(key, "prompt_cache_size") == 0) {
+        config->prompt_cache_size = atoi(value);
+    } else if (strcmp(key, "prompt_cache_ttl") == 0) {
+        config->prompt_cache_ttl = atoi(value);
+    } else if (strcmp(key, "prompt_cache_threshold") == 0) {
+        config->prompt_cache_threshold = atof(value);
+    } else if (strcmp(key, "prompt_cache_verify") == 0) {
+        config->prompt_cache_verify = atof(value);
+    } else if (strcmp(key, "prompt_cache_route") == 0) {
+        if (config->prompt_cache_route_count < 64) {
+            config->prompt_cache_routes[config->prompt_cache_route_count] = strdup(value);
+            config->prompt_cache_route_count++;
+        }
+    } else if (strcmp(key, "embedding_model") == 0) {
+        if (config->embedding_model) free(config->embedding_model);
+        config->embedding_model = strdup(value);
+    } else if (strcmp(key, "embedding_batch_window_ms") == 0) {
+        config->embedding_batch_window_ms = atof(value);
+    } else if (strcmp(key, "embedding_batch_size") == 0) {
+        config->embedding_batch_size = atoi(value);
+    } else if (strcmp(key, "tokenizer_vocab") == 0) {
+        if (config->tokenizer_vocab) free(config->tokenizer_vocab);
+        config->tokenizer_vocab = strdup(value);
+    } else if (strcmp(key, "model_context") == 0) {
+        if (config->model_context_count < 64) {
+            config->model_contexts[config->model_context_count] = strdup(value);
+            config->model_context_count++;
+        }
+    } else if (strcmp(key, "stats_file") == 0) {
+        if (config->stats_file) free(config->stats_file);
+        config->stats_file = strdup(value);
+    } else if (strcmp(key, "stats_json_file") == 0) {
+        if (config->stats_json_file) free(config->stats_json_file);
+        config->stats_json_file = strdup(value);
+    } else if (strcmp(key, "stats_save_interval") == 0) {
+        config->stats_save_interval = atoi(value);
+    } else if (strcmp(key, "io_backend") == 0) {
+        config->io_backend = strcmp(value, "io_uring") == 0 ? IO_BACKEND_URING : IO_BACKEND_EPOLL;
+    } else if (strcmp(key, "io_uring_sqpoll") == 0) {
+        config->io_uring_sqpoll = atoi(value);
+    } else if (strcmp(key, "cpu_affinity") == 0) {
+        config->cpu_affinity = atoi(value);
+    } else if (strcmp(key, "incoming_cpu_steering") == 0) {
+        config->incoming_cpu_steering = atoi(value);
+    } else if (strcmp(key, "trace_enabled") == 0) {
+        config->trace_enabled = atoi(value);
+    } else if (strcmp(key, "access_log") == 0) {
+        if (config->access_log) free(config->access_log);
+        config->access_log = strdup(value);
+    } else if (strcmp(key, "access_log_segment_mb") == 0) {
+        config->access_log_segment_mb = atoi(value);
+    } else if (strcmp(key, "static_root") == 0) {
+        if (config->static_root) free(config->static_root);
+        config->static_root = strdup(value);
+    } else if (strcmp(key, "static_cache_entries") == 0) {
+        config->static_cache_entries = atoi(value);
+    } else if (strcmp(key, "tls_port") == 0) {
+        config->tls_port = atoi(value);
+    } else if (strcmp(key, "tls_cert") == 0) {
+        if (config->tls_cert) free(config->tls_cert);
+        config->tls_cert = strdup(value);
+    } else if (strcmp(key, "tls_key") == 0) {
+        if (config->tls_key) free(config->tls_key);
+        config->tls_key = strdup(value);
+    } else if (strcmp(key, "tls_ktls") == 0) {
+        config->tls_ktls = atoi(value);
+    } else if (strcmp(key, "access_log_sample") == 0) {
+        if (config->access_log_sample_count < 64) {
+            config->access_log_samples[config->access_log_sample_count] = strdup(value);
+            config->access_log_sample_count++;
+        }
+    } else if (strcmp(key, "model_replica") == 0) {
+        if (config->model_replica_count < 64) {
+            config->model_replicas[config->model_replica_count] = strdup(value);
+            config->model_replica_count++;
+        }
     }
     
     free(line_copy);
@@ -105,6 +196,40 @@ int load_config(const char *filename, Config *config) {
     config->enable_firewall = 1;
     config->enable_optimization = 1;
     config->api_key_count = 0;
+    config->model_replica_count = 0;
+    config->hedge_percentile = 95.0;
+    config->hedge_budget = 5.0;
+    config->model_fallback_count = 0;
+    config->breaker_failure_rate = 50.0;
+    config->breaker_slow_ms = 10000;
+    config->breaker_open_ms = 10000;
+    config->prompt_cache_size = 1024;
+    config->prompt_cache_ttl = 3600;
+    config->prompt_cache_threshold = 0.8;
+    config->prompt_cache_verify = 5.0;
+    config->prompt_cache_route_count = 0;
+    config->embedding_model = strdup("text-embedding-3-small");
+    config->embedding_batch_window_ms = 2.0;
+    config->embedding_batch_size = 64;
+    config->tokenizer_vocab = NULL;
+    config->model_context_count = 0;
+    config->stats_file = strdup("stats.bin");
+    config->stats_json_file = NULL;
+    config->stats_save_interval = 300;
+    config->trace_enabled = 0;
+    config->io_backend = IO_BACKEND_EPOLL;
+    config->io_uring_sqpoll = 0;
+    config->cpu_affinity = 0;
+    config->incoming_cpu_steering = 0;
+    config->access_log = NULL;
+    config->access_log_segment_mb = 64;
+    config->access_log_sample_count = 0;
+    config->static_root = NULL;
+    config->static_cache_entries = 256;
+    config->tls_port = 8443;
+    config->tls_cert = NULL;
+    config->tls_key = NULL;
+    config->tls_ktls = 1;
     
     char *file_content = read_file(filename);
     if (!file_content) {
@@ -143,5 +268,57 @@ void free_config(Config *config) {
         }
     }
     
+    for (int i = 0; i < config->model_replica_count; i++) {
+        free(config->model_replicas[i]);
+    }
+    
+    for (int i = 0; i < config->model_fallback_count; i++) {
+        free(config->model_fallbacks[i]);
+    }
+    
+    for (int i = 0; i < config->prompt_cache_route_count; i++) {
+        free(config->prompt_cache_routes[i]);
+    }
+    
+    if (config->embedding_model) {
+        free(config->embedding_model);
+    }
+    
+    if (config->tokenizer_vocab) {
+        free(config->tokenizer_vocab);
+    }
+    
+    for (int i = 0; i < config->model_context_count; i++) {
+        free(config->model_contexts[i]);
+    }
+    
+    if (config->stats_file) {
+        free(config->stats_file);
+    }
+    
+    if (config->stats_json_file) {
+        free(config->stats_json_file);
+    }
+    
+    if (config->access_log) {
+        free(config->access_log);
+    }
+    
+    for (int i = 0; i < config->access_log_sample_count; i++) {
+        free(config->access_log_samples[i]);
+    }
+    
+    if (config->static_root) {
+        free(config->static_root);
+    }
+    
+    if (config->tls_cert) {
+        free(config->tls_cert);
+    }
+    
+    if (config->tls_key) {
+        free(config->tls_key);
+    }
+    
     memset(config, 0, sizeof(Config));
 }
@@ -0,0 +1,1336 @@
+#define _GNU_SOURCE
+
+// ===== Standard Library Headers =====
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <unistd.h>
+
+// ===== Project Headers =====
+#include "http2.h"
+#include "static_files.h"
+
+// ===== Constants =====
+#define H2_FRAME_HEADER 9
+#define H2_DEFAULT_FRAME_SIZE 16384     // Largest frame we accept (never raised)
+#define H2_DEFAULT_WINDOW 65535
+#define H2_MAX_WINDOW 0x7fffffff
+#define H2_STREAM_WINDOW H2_MAX_BODY    // Stream receive window: a body never needs more
+#define H2_SESSION_WINDOW (16 << 20)    // Body bytes a connection may have buffered, given back as
+                                        // each body is dispatched
+#define HPACK_TABLE_SIZE 4096           // Decoder table size, the protocol default
+#define HPACK_STATIC_ENTRIES 61
+#define H2_MAX_REQUEST_FIELDS 32        // Header slots in an HTTPRequest
+
+// Frame types
+#define H2_DATA 0x0
+#define H2_HEADERS 0x1
+#define H2_PRIORITY 0x2
+#define H2_RST_STREAM 0x3
+#define H2_SETTINGS 0x4
+#define H2_PUSH_PROMISE 0x5
+#define H2_PING 0x6
+#define H2_GOAWAY 0x7
+#define H2_WINDOW_UPDATE 0x8
+#define H2_CONTINUATION 0x9
+
+// Frame flags
+#define H2_FLAG_END_STREAM 0x1
+#define H2_FLAG_ACK 0x1
+#define H2_FLAG_END_HEADERS 0x4
+#define H2_FLAG_PADDED 0x8
+#define H2_FLAG_PRIORITY 0x20
+
+// Error codes
+#define H2_NO_ERROR 0x0
+#define H2_PROTOCOL_ERROR 0x1
+#define H2_INTERNAL_ERROR 0x2
+#define H2_FLOW_CONTROL_ERROR 0x3
+#define H2_STREAM_CLOSED 0x5
+#define H2_FRAME_SIZE_ERROR 0x6
+#define H2_REFUSED_STREAM 0x7
+#define H2_COMPRESSION_ERROR 0x9
+#define H2_ENHANCE_YOUR_CALM 0xb
+
+// Settings
+#define H2_SETTINGS_ENABLE_PUSH 0x2
+#define H2_SETTINGS_MAX_CONCURRENT_STREAMS 0x3
+#define H2_SETTINGS_INITIAL_WINDOW_SIZE 0x4
+#define H2_SETTINGS_MAX_FRAME_SIZE 0x5
+
+typedef struct {
+    const char *name;
+    const char *value;
+} HpackField;
+
+typedef struct {
+    char *data;
+    size_t length;
+    size_t capacity;
+    int failed;                         // An allocation failed; the contents are incomplete
+} H2Buffer;
+
+typedef struct {
+    char *name;                         // Name and value share one allocation
+    size_t name_length;
+    char *value;
+    size_t value_length;
+} HpackEntry;
+
+// Decoder dynamic table: a ring with the newest entry at `first`
+typedef struct {
+    HpackEntry *entries;
+    size_t capacity;
+    size_t count;
+    size_t first;
+    size_t size;                        // Name + value + 32 for every entry
+    size_t max_size;
+} HpackTable;
+
+typedef enum {
+    STREAM_RECEIVING,                   // Headers or body still arriving
+    STREAM_READY,                       // Request complete, not yet handed out
+    STREAM_DISPATCHED,                  // Handed out, waiting for its response
+    STREAM_SENDING                      // Response body held back by flow control
+} H2StreamState;
+
+typedef struct H2Stream {
+    uint32_t id;
+    H2StreamState state;
+    uint32_t refused;                   // Error to reset with once the header block is decoded
+    int malformed;
+    int has_method;
+    int has_path;
+    int regular_seen;                   // Pseudo-headers must come first
+    int head_request;
+    H2Buffer fields;                    // "name\0value\0" for every decoded field
+    H2Buffer body;
+    int64_t send_window;
+    char *pending;                      // Response body still to send, owned
+    size_t pending_length;
+    size_t pending_offset;
+    StaticFile *file;                   // Or a file region
+    uint64_t file_offset;
+    uint64_t file_remaining;
+    struct H2Stream *next;
+} H2Stream;
+
+struct H2Session {
+    int preface_received;
+    int closing;
+    H2Buffer in;                        // Received bytes not yet forming a whole frame
+    H2Buffer out;
+    H2Buffer header_block;              // HEADERS plus CONTINUATION fragments
+    H2Buffer scratch;                   // Decoded strings, encoded response headers
+    HpackTable decoder;
+    uint32_t header_stream;             // Stream whose header block is open, 0 if none
+    int header_end_stream;
+    int header_trailers;
+    uint32_t last_stream_id;
+    uint32_t peer_max_frame;
+    int64_t peer_initial_window;
+    int64_t send_window;
+    int64_t recv_window;                // What the peer may still send before a WINDOW_UPDATE
+    int stream_count;
+    H2Stream *streams;                  // In ascending id order
+    H2Stream *streams_tail;
+};
+
+static const HpackField hpack_static_table[HPACK_STATIC_ENTRIES] = {
+    {":authority", ""},
+    {":method", "GET"},
+    {":method", "POST"},
+    {":path", "/"},
+    {":path", "/index.html"},
+    {":scheme", "http"},
+    {":scheme", "https"},
+    {":status", "200"},
+    {":status", "204"},
+    {":status", "206"},
+    {":status", "304"},
+    {":status", "400"},
+    {":status", "404"},
+    {":status", "500"},
+    {"accept-charset", ""},
+    {"accept-encoding", "gzip, deflate"},
+    {"accept-language", ""},
+    {"accept-ranges", ""},
+    {"accept", ""},
+    {"access-control-allow-origin", ""},
+    {"age", ""},
+    {"allow", ""},
+    {"authorization", ""},
+    {"cache-control", ""},
+    {"content-disposition", ""},
+    {"content-encoding", ""},
+    {"content-language", ""},
+    {"content-length", ""},
+    {"content-location", ""},
+    {"content-range", ""},
+    {"content-type", ""},
+    {"cookie", ""},
+    {"date", ""},
+    {"etag", ""},
+    {"expect", ""},
+    {"expires", ""},
+    {"from", ""},
+    {"host", ""},
+    {"if-match", ""},
+    {"if-modified-since", ""},
+    {"if-none-match", ""},
+    {"if-range", ""},
+    {"if-unmodified-since", ""},
+    {"last-modified", ""},
+    {"link", ""},
+    {"location", ""},
+    {"max-forwards", ""},
+    {"proxy-authenticate", ""},
+    {"proxy-authorization", ""},
+    {"range", ""},
+    {"referer", ""},
+    {"refresh", ""},
+    {"retry-after", ""},
+    {"server", ""},
+    {"set-cookie", ""},
+    {"strict-transport-security", ""},
+    {"transfer-encoding", ""},
+    {"user-agent", ""},
+    {"vary", ""},
+    {"via", ""},
+    {"www-authenticate", ""},
+};
+
+// Huffman code of each octet, then EOS (RFC 7541 Appendix B)
+static const uint32_t huffman_codes[257] = {
+    0x1ff8, 0x7fffd8, 0xfffffe2, 0xfffffe3, 0xfffffe4, 0xfffffe5, 0xfffffe6, 0xfffffe7,
+    0xfffffe8, 0xffffea, 0x3ffffffc, 0xfffffe9, 0xfffffea, 0x3ffffffd, 0xfffffeb, 0xfffffec,
+    0xfffffed, 0xfffffee, 0xfffffef, 0xffffff0, 0xffffff1, 0xffffff2, 0x3ffffffe, 0xffffff3,
+    0xffffff4, 0xffffff5, 0xffffff6, 0xffffff7, 0xffffff8, 0xffffff9, 0xffffffa, 0xffffffb,
+    0x14, 0x3f8, 0x3f9, 0xffa, 0x1ff9, 0x15, 0xf8, 0x7fa,
+    0x3fa, 0x3fb, 0xf9, 0x7fb, 0xfa, 0x16, 0x17, 0x18,
+    0x0, 0x1, 0x2, 0x19, 0x1a, 0x1b, 0x1c, 0x1d,
+    0x1e, 0x1f, 0x5c, 0xfb, 0x7ffc, 0x20, 0xffb, 0x3fc,
+    0x1ffa, 0x21, 0x5d, 0x5e, 0x5f, 0x60, 0x61, 0x62,
+    0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a,
+    0x6b, 0x6c, 0x6d, 0x6e, 0x6f, 0x70, 0x71, 0x72,
+    0xfc, 0x73, 0xfd, 0x1ffb, 0x7fff0, 0x1ffc, 0x3ffc, 0x22,
+    0x7ffd, 0x3, 0x23, 0x4, 0x24, 0x5, 0x25, 0x26,
+    0x27, 0x6, 0x74, 0x75, 0x28, 0x29, 0x2a, 0x7,
+    0x2b, 0x76, 0x2c, 0x8, 0x9, 0x2d, 0x77, 0x78,
+    0x79, 0x7a, 0x7b, 0x7ffe, 0x7fc, 0x3ffd, 0x1ffd, 0xffffffc,
+    0xfffe6, 0x3fffd2, 0xfffe7, 0xfffe8, 0x3fffd3, 0x3fffd4, 0x3fffd5, 0x7fffd9,
+    0x3fffd6, 0x7fffda, 0x7fffdb, 0x7fffdc, 0x7fffdd, 0x7fffde, 0xffffeb, 0x7fffdf,
+    0xffffec, 0xffffed, 0x3fffd7, 0x7fffe0, 0xffffee, 0x7fffe1, 0x7fffe2, 0x7fffe3,
+    0x7fffe4, 0x1fffdc, 0x3fffd8, 0x7fffe5, 0x3fffd9, 0x7fffe6, 0x7fffe7, 0xffffef,
+    0x3fffda, 0x1fffdd, 0xfffe9, 0x3fffdb, 0x3fffdc, 0x7fffe8, 0x7fffe9, 0x1fffde,
+    0x7fffea, 0x3fffdd, 0x3fffde, 0xfffff0, 0x1fffdf, 0x3fffdf, 0x7fffeb, 0x7fffec,
+    0x1fffe0, 0x1fffe1, 0x3fffe0, 0x1fffe2, 0x7fffed, 0x3fffe1, 0x7fffee, 0x7fffef,
+    0xfffea, 0x3fffe2, 0x3fffe3, 0x3fffe4, 0x7ffff0, 0x3fffe5, 0x3fffe6, 0x7ffff1,
+    0x3ffffe0, 0x3ffffe1, 0xfffeb, 0x7fff1, 0x3fffe7, 0x7ffff2, 0x3fffe8, 0x1ffffec,
+    0x3ffffe2, 0x3ffffe3, 0x3ffffe4, 0x7ffffde, 0x7ffffdf, 0x3ffffe5, 0xfffff1, 0x1ffffed,
+    0x7fff2, 0x1fffe3, 0x3ffffe6, 0x7ffffe0, 0x7ffffe1, 0x3ffffe7, 0x7ffffe2, 0xfffff2,
+    0x1fffe4, 0x1fffe5, 0x3ffffe8, 0x3ffffe9, 0xffffffd, 0x7ffffe3, 0x7ffffe4, 0x7ffffe5,
+    0xfffec, 0xfffff3, 0xfffed, 0x1fffe6, 0x3fffe9, 0x1fffe7, 0x1fffe8, 0x7ffff3,
+    0x3fffea, 0x3fffeb, 0x1ffffee, 0x1ffffef, 0xfffff4, 0xfffff5, 0x3ffffea, 0x7ffff4,
+    0x3ffffeb, 0x7ffffe6, 0x3ffffec, 0x3ffffed, 0x7ffffe7, 0x7ffffe8, 0x7ffffe9, 0x7ffffea,
+    0x7ffffeb, 0xffffffe, 0x7ffffec, 0x7ffffed, 0x7ffffee, 0x7ffffef, 0x7fffff0, 0x3ffffee,
+    0x3fffffff,
+};
+
+static const uint8_t huffman_lengths[257] = {
+    13, 23, 28, 28, 28, 28, 28, 28, 28, 24, 30, 28, 28, 30, 28, 28,
+    28, 28, 28, 28, 28, 28, 30, 28, 28, 28, 28, 28, 28, 28, 28, 28,
+    6, 10, 10, 12, 13, 6, 8, 11, 10, 10, 8, 11, 8, 6, 6, 6,
+    5, 5, 5, 6, 6, 6, 6, 6, 6, 6, 7, 8, 15, 6, 12, 10,
+    13, 6, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+    7, 7, 7, 7, 7, 7, 7, 7, 8, 7, 8, 13, 19, 13, 14, 6,
+    15, 5, 6, 5, 6, 5, 6, 6, 6, 5, 7, 7, 6, 6, 6, 5,
+    6, 7, 6, 5, 5, 6, 7, 7, 7, 7, 7, 15, 11, 14, 13, 28,
+    20, 22, 20, 20, 22, 22, 22, 23, 22, 23, 23, 23, 23, 23, 24, 23,
+    24, 24, 22, 23, 24, 23, 23, 23, 23, 21, 22, 23, 22, 23, 23, 24,
+    22, 21, 20, 22, 22, 23, 23, 21, 23, 22, 22, 24, 21, 22, 23, 23,
+    21, 21, 22, 21, 23, 22, 23, 23, 20, 22, 22, 22, 23, 22, 22, 23,
+    26, 26, 20, 19, 22, 23, 22, 25, 26, 26, 26, 27, 27, 26, 24, 25,
+    19, 21, 26, 27, 27, 26, 27, 24, 21, 21, 26, 26, 28, 27, 27, 27,
+    20, 24, 20, 21, 22, 21, 21, 23, 22, 22, 25, 25, 24, 24, 26, 23,
+    26, 27, 26, 26, 27, 27, 27, 27, 27, 28, 27, 27, 27, 27, 27, 26,
+    30,
+};
+
+static int16_t huffman_tree[512][2];    // Child node, or -(symbol + 1) for a leaf
+static pthread_once_t huffman_once = PTHREAD_ONCE_INIT;
+
+// ===== Buffers =====
+
+static int buffer_reserve(H2Buffer *buffer, size_t extra) {
+    if (buffer->failed) return -1;
+    if (buffer->length + extra <= buffer->capacity) return 0;
+
+    size_t capacity = buffer->capacity ? buffer->capacity : 1024;
+    while (capacity < buffer->length + extra) capacity *= 2;
+    char *data = realloc(buffer->data, capacity);
+    if (!data) {
+        buffer->failed = 1;
+        return -1;
+    }
+    buffer->data = data;
+    buffer->capacity = capacity;
+    return 0;
+}
+
+static void buffer_append(H2Buffer *buffer, const void *data, size_t length) {
+    if (length == 0 || buffer_reserve(buffer, length) != 0) return;
+    memcpy(buffer->data + buffer->length, data, length);
+    buffer->length += length;
+}
+
+static void buffer_byte(H2Buffer *buffer, uint8_t byte) {
+    buffer_append(buffer, &byte, 1);
+}
+
+static void buffer_free(H2Buffer *buffer) {
+    free(buffer->data);
+    memset(buffer, 0, sizeof(H2Buffer));
+}
+
+static uint32_t read_u32(const uint8_t *p) {
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+// ===== Frames =====
+
+static void write_frame_header(H2Buffer *out, size_t length, uint8_t type, uint8_t flags, uint32_t stream_id) {
+    uint8_t header[H2_FRAME_HEADER] = {
+        (uint8_t)(length >> 16), (uint8_t)(length >> 8), (uint8_t)length, type, flags,
+        (uint8_t)(stream_id >> 24 & 0x7f), (uint8_t)(stream_id >> 16), (uint8_t)(stream_id >> 8), (uint8_t)stream_id
+    };
+    buffer_append(out, header, sizeof(header));
+}
+
+static void write_u32_frame(H2Session *session, uint8_t type, uint32_t stream_id, uint32_t value) {
+    uint8_t payload[4] = {(uint8_t)(value >> 24), (uint8_t)(value >> 16), (uint8_t)(value >> 8), (uint8_t)value};
+    write_frame_header(&session->out, 4, type, 0, stream_id);
+    buffer_append(&session->out, payload, 4);
+}
+
+static void send_rst(H2Session *session, uint32_t stream_id, uint32_t error) {
+    write_u32_frame(session, H2_RST_STREAM, stream_id, error);
+}
+
+static void send_settings(H2Session *session) {
+    uint8_t payload[12] = {
+        0, H2_SETTINGS_MAX_CONCURRENT_STREAMS, 0, 0, 0, H2_MAX_CONCURRENT_STREAMS,
+        0, H2_SETTINGS_INITIAL_WINDOW_SIZE,
+        (uint8_t)(H2_STREAM_WINDOW >> 24), (uint8_t)(H2_STREAM_WINDOW >> 16),
+        (uint8_t)(H2_STREAM_WINDOW >> 8), (uint8_t)H2_STREAM_WINDOW
+    };
+    write_frame_header(&session->out, sizeof(payload), H2_SETTINGS, 0, 0);
+    buffer_append(&session->out, payload, sizeof(payload));
+    // The connection window is only raised by WINDOW_UPDATE
+    write_u32_frame(session, H2_WINDOW_UPDATE, 0, H2_SESSION_WINDOW - H2_DEFAULT_WINDOW);
+    session->recv_window = H2_SESSION_WINDOW;
+}
+
+// Gives received bytes back to the peer's connection window
+static void return_window(H2Session *session, size_t length) {
+    if (length == 0) return;
+    write_u32_frame(session, H2_WINDOW_UPDATE, 0, (uint32_t)length);
+    session->recv_window += (int64_t)length;
+}
+
+// Queues a GOAWAY; every later call reports the connection as closing
+static int connection_error(H2Session *session, uint32_t error) {
+    uint8_t payload[8] = {
+        (uint8_t)(session->last_stream_id >> 24 & 0x7f), (uint8_t)(session->last_stream_id >> 16),
+        (uint8_t)(session->last_stream_id >> 8), (uint8_t)session->last_stream_id,
+        (uint8_t)(error >> 24), (uint8_t)(error >> 16), (uint8_t)(error >> 8), (uint8_t)error
+    };
+    write_frame_header(&session->out, sizeof(payload), H2_GOAWAY, 0, 0);
+    buffer_append(&session->out, payload, sizeof(payload));
+    session->closing = 1;
+    return -1;
+}
+
+// ===== Streams =====
+
+static H2Stream *find_stream(H2Session *session, uint32_t stream_id) {
+    for (H2Stream *stream = session->streams; stream; stream = stream->next) {
+        if (stream->id == stream_id) return stream;
+    }
+    return NULL;
+}
+
+static H2Stream *open_stream(H2Session *session, uint32_t stream_id) {
+    H2Stream *stream = calloc(1, sizeof(H2Stream));
+    if (!stream) return NULL;
+    stream->id = stream_id;
+    stream->state = STREAM_RECEIVING;
+    stream->send_window = session->peer_initial_window;
+
+    if (session->streams_tail) {
+        session->streams_tail->next = stream;
+    } else {
+        session->streams = stream;
+    }
+    session->streams_tail = stream;
+    session->stream_count++;
+    return stream;
+}
+
+// Drops a buffered request body and lets the peer send that much again
+static void release_body(H2Session *session, H2Stream *stream) {
+    return_window(session, stream->body.length);
+    buffer_free(&stream->body);
+}
+
+static void close_stream(H2Session *session, H2Stream *stream) {
+    H2Stream *previous = NULL;
+    for (H2Stream *s = session->streams; s && s != stream; s = s->next) previous = s;
+    if (previous) {
+        previous->next = stream->next;
+    } else {
+        session->streams = stream->next;
+    }
+    if (session->streams_tail == stream) session->streams_tail = previous;
+    session->stream_count--;
+
+    if (stream->file) static_file_release(stream->file);
+    free(stream->pending);
+    buffer_free(&stream->fields);
+    release_body(session, stream);
+    free(stream);
+}
+
+// Writes as much of a response body as both windows allow; closes the
+// stream once the last byte is out
+static void flush_stream(H2Session *session, H2Stream *stream) {
+    uint64_t remaining = stream->file ? stream->file_remaining : stream->pending_length - stream->pending_offset;
+
+    while (remaining > 0 && session->send_window > 0 && stream->send_window > 0) {
+        uint64_t chunk = remaining;
+        if (chunk > session->peer_max_frame) chunk = session->peer_max_frame;
+        if (chunk > (uint64_t)session->send_window) chunk = (uint64_t)session->send_window;
+        if (chunk > (uint64_t)stream->send_window) chunk = (uint64_t)stream->send_window;
+        uint8_t flags = chunk == remaining ? H2_FLAG_END_STREAM : 0;
+
+        if (buffer_reserve(&session->out, H2_FRAME_HEADER + chunk) != 0) return;
+        if (stream->file) {
+            // File regions are read straight into the frame
+            char *payload = session->out.data + session->out.length + H2_FRAME_HEADER;
+            ssize_t n = pread(stream->file->fd, payload, (size_t)chunk, (off_t)stream->file_offset);
+            if (n != (ssize_t)chunk) {
+                send_rst(session, stream->id, H2_INTERNAL_ERROR);
+                close_stream(session, stream);
+                return;
+            }
+            write_frame_header(&session->out, (size_t)chunk, H2_DATA, flags, stream->id);
+            session->out.length += (size_t)chunk;
+            stream->file_offset += chunk;
+            stream->file_remaining -= chunk;
+        } else {
+            write_frame_header(&session->out, (size_t)chunk, H2_DATA, flags, stream->id);
+            buffer_append(&session->out, stream->pending + stream->pending_offset, (size_t)chunk);
+            stream->pending_offset += (size_t)chunk;
+        }
+        session->send_window -= (int64_t)chunk;
+        stream->send_window -= (int64_t)chunk;
+        remaining -= chunk;
+    }
+
+    if (remaining == 0) close_stream(session, stream);
+}
+
+static void flush_streams(H2Session *session) {
+    H2Stream *stream = session->streams;
+    while (stream && session->send_window > 0) {
+        H2Stream *next = stream->next;
+        if (stream->state == STREAM_SENDING) flush_stream(session, stream);
+        stream = next;
+    }
+}
+
+// ===== HPACK =====
+
+static void huffman_build(void) {
+    int nodes = 1;
+    for (int symbol = 0; symbol < 257; symbol++) {
+        uint32_t code = huffman_codes[symbol];
+        int node = 0;
+        for (int bit = huffman_lengths[symbol] - 1; bit > 0; bit--) {
+            int branch = code >> bit & 1;
+            if (!huffman_tree[node][branch]) huffman_tree[node][branch] = (int16_t)nodes++;
+            node = huffman_tree[node][branch];
+        }
+        huffman_tree[node][code & 1] = (int16_t)-(symbol + 1);
+    }
+}
+
+// Appends the decoded string; padding must be at most 7 one bits (RFC 7541 5.2)
+static int huffman_decode(const uint8_t *data, size_t length, H2Buffer *out) {
+    pthread_once(&huffman_once, huffman_build);
+    // The shortest code is 5 bits
+    if (buffer_reserve(out, length * 8 / 5 + 1) != 0) return -1;
+
+    int node = 0, depth = 0, all_ones = 1;
+    for (size_t i = 0; i < length; i++) {
+        for (int bit = 7; bit >= 0; bit--) {
+            int branch = data[i] >> bit & 1;
+            int next = huffman_tree[node][branch];
+            if (next < 0) {
+                if (next == -257) return -1;            // EOS inside a string
+                out->data[out->length++] = (char)(-next - 1);
+                node = depth = 0;
+                all_ones = 1;
+            } else {
+                node = next;
+                depth++;
+                all_ones &= branch;
+            }
+        }
+    }
+    return depth <= 7 && all_ones ? 0 : -1;
+}
+
+static int hpack_read_integer(const uint8_t **p, const uint8_t *end, int prefix_bits, uint64_t *value) {
+    if (*p >= end) return -1;
+    uint64_t max = (1u << prefix_bits) - 1;
+    uint64_t v = *(*p)++ & max;
+    if (v < max) {
+        *value = v;
+        return 0;
+    }
+    for (int shift = 0; *p < end && shift <= 28; shift += 7) {
+        uint8_t byte = *(*p)++;
+        v += (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            *value = v;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static int hpack_read_string(const uint8_t **p, const uint8_t *end, H2Buffer *out) {
+    if (*p >= end) return -1;
+    int huffman = **p & 0x80;
+    uint64_t length;
+    if (hpack_read_integer(p, end, 7, &length) != 0 || length > (uint64_t)(end - *p)) return -1;
+
+    if (huffman) {
+        if (huffman_decode(*p, (size_t)length, out) != 0) return -1;
+    } else {
+        buffer_append(out, *p, (size_t)length);
+    }
+    *p += length;
+    return out->failed ? -1 : 0;
+}
+
+static void hpack_table_evict(HpackTable *table, size_t room) {
+    while (table->count > 0 && table->size + room > table->max_size) {
+        HpackEntry *oldest = &table->entries[(table->first + table->count - 1) % table->capacity];
+        table->size -= oldest->name_length + oldest->value_length + 32;
+        free(oldest->name);
+        table->count--;
+    }
+}
+
+static int hpack_table_insert(HpackTable *table, const char *name, size_t name_length,
+                              const char *value, size_t value_length) {
+    size_t entry_size = name_length + value_length + 32;
+    if (entry_size > table->max_size) {
+        // An entry larger than the table empties it
+        hpack_table_evict(table, table->max_size + 1);
+        return 0;
+    }
+    hpack_table_evict(table, entry_size);
+
+    if (table->count == table->capacity) {
+        size_t capacity = table->capacity ? table->capacity * 2 : 32;
+        HpackEntry *entries = malloc(capacity * sizeof(HpackEntry));
+        if (!entries) return -1;
+        for (size_t i = 0; i < table->count; i++) {
+            entries[i] = table->entries[(table->first + i) % table->capacity];
+        }
+        free(table->entries);
+        table->entries = entries;
+        table->capacity = capacity;
+        table->first = 0;
+    }
+
+    char *copy = malloc(name_length + value_length + 2);
+    if (!copy) return -1;
+    memcpy(copy, name, name_length);
+    copy[name_length] = '\0';
+    memcpy(copy + name_length + 1, value, value_length);
+    copy[name_length + 1 + value_length] = '\0';
+
+    table->first = (table->first + table->capacity - 1) % table->capacity;
+    HpackEntry *entry = &table->entries[table->first];
+    entry->name = copy;
+    entry->name_length = name_length;
+    entry->value = copy + name_length + 1;
+    entry->value_length = value_length;
+    table->count++;
+    table->size += entry_size;
+    return 0;
+}
+
+static void hpack_table_free(HpackTable *table) {
+    for (size_t i = 0; i < table->count; i++) {
+        free(table->entries[(table->first + i) % table->capacity].name);
+    }
+    free(table->entries);
+    memset(table, 0, sizeof(HpackTable));
+}
+
+// Static entries first, then the dynamic table from the newest entry
+static int hpack_lookup(const HpackTable *table, uint64_t index, const char **name, size_t *name_length,
+                        const char **value, size_t *value_length) {
+    if (index == 0) return -1;
+    if (index <= HPACK_STATIC_ENTRIES) {
+        const HpackField *field = &hpack_static_table[index - 1];
+        *name = field->name;
+        *name_length = strlen(field->name);
+        *value = field->value;
+        *value_length = strlen(field->value);
+        return 0;
+    }
+    index -= HPACK_STATIC_ENTRIES + 1;
+    if (index >= table->count) return -1;
+    const HpackEntry *entry = &table->entries[(table->first + index) % table->capacity];
+    *name = entry->name;
+    *name_length = entry->name_length;
+    *value = entry->value;
+    *value_length = entry->value_length;
+    return 0;
+}
+
+// Records a decoded field on the stream and checks the rules HTTP/2 adds
+// to header names (RFC 9113 8.2)
+static void stream_add_field(H2Stream *stream, const char *name, size_t name_length,
+                             const char *value, size_t value_length) {
+    if (name_length == 0) {
+        stream->malformed = 1;
+        return;
+    }
+    for (size_t i = 0; i < name_length; i++) {
+        if (name[i] >= 'A' && name[i] <= 'Z') stream->malformed = 1;
+    }
+
+    if (name[0] == ':') {
+        if (stream->regular_seen) stream->malformed = 1;
+        if (name_length == 7 && memcmp(name, ":method", 7) == 0) {
+            stream->has_method = 1;
+            stream->head_request = value_length == 4 && memcmp(value, "HEAD", 4) == 0;
+        } else if (name_length == 5 && memcmp(name, ":path", 5) == 0) {
+            stream->has_path = value_length > 0;
+        }
+    } else {
+        stream->regular_seen = 1;
+        if ((name_length == 10 && memcmp(name, "connection", 10) == 0) ||
+            (name_length == 17 && memcmp(name, "transfer-encoding", 17) == 0)) {
+            stream->malformed = 1;
+        }
+    }
+
+    if (stream->fields.length + name_length + value_length + 2 > H2_MAX_HEADER_BLOCK) {
+        stream->refused = H2_ENHANCE_YOUR_CALM;
+        return;
+    }
+    buffer_append(&stream->fields, name, name_length);
+    buffer_byte(&stream->fields, 0);
+    buffer_append(&stream->fields, value, value_length);
+    buffer_byte(&stream->fields, 0);
+}
+
+// Decodes the whole header block; with no stream (trailers) fields are only
+// used to keep the dynamic table in step
+static int decode_header_block(H2Session *session, H2Stream *stream) {
+    const uint8_t *p = (const uint8_t *)session->header_block.data;
+    const uint8_t *end = p + session->header_block.length;
+    H2Buffer *scratch = &session->scratch;
+    int fields_seen = 0;
+
+    while (p < end) {
+        uint8_t first = *p;
+        const char *name, *value;
+        size_t name_length, value_length;
+        uint64_t index;
+
+        if (first & 0x80) {
+            // Indexed field
+            if (hpack_read_integer(&p, end, 7, &index) != 0 ||
+                hpack_lookup(&session->decoder, index, &name, &name_length, &value, &value_length) != 0) {
+                return -1;
+            }
+        } else if ((first & 0xe0) == 0x20) {
+            // Dynamic table size update, only before the first field
+            if (fields_seen || hpack_read_integer(&p, end, 5, &index) != 0 || index > HPACK_TABLE_SIZE) return -1;
+            session->decoder.max_size = (size_t)index;
+            hpack_table_evict(&session->decoder, 0);
+            continue;
+        } else {
+            // Literal: with incremental indexing (01), without (0000) or never indexed (0001)
+            int indexing = (first & 0xc0) == 0x40;
+            if (hpack_read_integer(&p, end, indexing ? 6 : 4, &index) != 0) return -1;
+
+            // Name and value are collected in scratch so table eviction cannot invalidate them
+            scratch->length = 0;
+            if (index) {
+                const char *indexed_value;
+                size_t indexed_value_length;
+                if (hpack_lookup(&session->decoder, index, &name, &name_length,
+                                 &indexed_value, &indexed_value_length) != 0) {
+                    return -1;
+                }
+                buffer_append(scratch, name, name_length);
+            } else if (hpack_read_string(&p, end, scratch) != 0) {
+                return -1;
+            }
+            name_length = scratch->length;
+            if (hpack_read_string(&p, end, scratch) != 0 || scratch->failed) return -1;
+            name = scratch->data;
+            value = scratch->data + name_length;
+            value_length = scratch->length - name_length;
+
+            if (indexing && hpack_table_insert(&session->decoder, name, name_length, value, value_length) != 0) {
+                return -1;
+            }
+        }
+
+        fields_seen = 1;
+        if (stream) stream_add_field(stream, name, name_length, value, value_length);
+    }
+    return 0;
+}
+
+static void hpack_write_integer(H2Buffer *out, uint8_t first, int prefix_bits, size_t value) {
+    size_t max = (1u << prefix_bits) - 1;
+    if (value < max) {
+        buffer_byte(out, (uint8_t)(first | value));
+        return;
+    }
+    buffer_byte(out, (uint8_t)(first | max));
+    value -= max;
+    while (value >= 128) {
+        buffer_byte(out, (uint8_t)(value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    buffer_byte(out, (uint8_t)value);
+}
+
+// Literal without indexing, reusing a static table name where there is one
+static void hpack_write_field(H2Buffer *out, const char *name, size_t name_length,
+                              const char *value, size_t value_length) {
+    int name_index = 0;
+    for (int i = 0; i < HPACK_STATIC_ENTRIES && !name_index; i++) {
+        if (strlen(hpack_static_table[i].name) == name_length &&
+            memcmp(hpack_static_table[i].name, name, name_length) == 0) {
+            name_index = i + 1;
+        }
+    }
+
+    if (name_index) {
+        hpack_write_integer(out, 0x00, 4, (size_t)name_index);
+    } else {
+        buffer_byte(out, 0x00);
+        hpack_write_integer(out, 0x00, 7, name_length);
+        buffer_append(out, name, name_length);
+    }
+    hpack_write_integer(out, 0x00, 7, value_length);
+    buffer_append(out, value, value_length);
+}
+
+static void hpack_write_status(H2Buffer *out, int status_code) {
+    // :status 200, 204, 206, 304, 400, 404 and 500 are static entries 8-14
+    static const int indexed[] = {200, 204, 206, 304, 400, 404, 500};
+    for (int i = 0; i < 7; i++) {
+        if (indexed[i] == status_code) {
+            buffer_byte(out, (uint8_t)(0x80 | (8 + i)));
+            return;
+        }
+    }
+    char digits[8];
+    int length = snprintf(digits, sizeof(digits), "%03d", status_code);
+    hpack_write_integer(out, 0x00, 4, 8);
+    hpack_write_integer(out, 0x00, 7, (size_t)length);
+    buffer_append(out, digits, (size_t)length);
+}
+
+// ===== Frame Handlers =====
+
+static int apply_settings(H2Session *session, const uint8_t *payload, size_t length) {
+    for (size_t i = 0; i + 6 <= length; i += 6) {
+        uint16_t id = (uint16_t)(payload[i] << 8 | payload[i + 1]);
+        uint32_t value = read_u32(payload + i + 2);
+
+        if (id == H2_SETTINGS_ENABLE_PUSH && value > 1) {
+            return H2_PROTOCOL_ERROR;
+        } else if (id == H2_SETTINGS_INITIAL_WINDOW_SIZE) {
+            if (value > H2_MAX_WINDOW) return H2_FLOW_CONTROL_ERROR;
+            // The change applies to every open stream's window
+            int64_t delta = (int64_t)value - session->peer_initial_window;
+            for (H2Stream *stream = session->streams; stream; stream = stream->next) {
+                stream->send_window += delta;
+                if (stream->send_window > H2_MAX_WINDOW) return H2_FLOW_CONTROL_ERROR;
+            }
+            session->peer_initial_window = value;
+        } else if (id == H2_SETTINGS_MAX_FRAME_SIZE) {
+            if (value < H2_DEFAULT_FRAME_SIZE || value > 0xffffff) return H2_PROTOCOL_ERROR;
+            session->peer_max_frame = value;
+        }
+    }
+    return 0;
+}
+
+static int finish_header_block(H2Session *session) {
+    H2Stream *stream = find_stream(session, session->header_stream);
+    int trailers = session->header_trailers;
+    session->header_stream = 0;
+
+    if (decode_header_block(session, trailers ? NULL : stream) != 0) return H2_COMPRESSION_ERROR;
+    session->header_block.length = 0;
+    if (!stream) return 0;
+
+    uint32_t error = stream->refused;
+    if (!error && !trailers && (stream->malformed || !stream->has_method || !stream->has_path)) {
+        error = H2_PROTOCOL_ERROR;
+    }
+    if (error) {
+        send_rst(session, stream->id, error);
+        close_stream(session, stream);
+        return 0;
+    }
+    if (session->header_end_stream) stream->state = STREAM_READY;
+    return 0;
+}
+
+static int on_headers(H2Session *session, uint8_t flags, uint32_t stream_id, const uint8_t *p, size_t length) {
+    if (stream_id == 0) return H2_PROTOCOL_ERROR;
+
+    size_t padding = 0;
+    if (flags & H2_FLAG_PADDED) {
+        if (length < 1) return H2_FRAME_SIZE_ERROR;
+        padding = *p++;
+        length--;
+    }
+    if (flags & H2_FLAG_PRIORITY) {
+        if (length < 5) return H2_FRAME_SIZE_ERROR;
+        p += 5;
+        length -= 5;
+    }
+    if (padding > length) return H2_PROTOCOL_ERROR;
+    length -= padding;
+
+    H2Stream *stream = find_stream(session, stream_id);
+    int trailers = 0;
+    if (stream) {
+        // A second HEADERS frame can only carry trailers, which must end the stream
+        if (stream->state != STREAM_RECEIVING) return H2_STREAM_CLOSED;
+        if (!(flags & H2_FLAG_END_STREAM)) return H2_PROTOCOL_ERROR;
+        trailers = 1;
+    } else {
+        if ((stream_id & 1) == 0 || stream_id <= session->last_stream_id) return H2_PROTOCOL_ERROR;
+        session->last_stream_id = stream_id;
+        stream = open_stream(session, stream_id);
+        if (!stream) return H2_INTERNAL_ERROR;
+        if (session->stream_count > H2_MAX_CONCURRENT_STREAMS) stream->refused = H2_REFUSED_STREAM;
+    }
+
+    session->header_stream = stream_id;
+    session->header_end_stream = flags & H2_FLAG_END_STREAM;
+    session->header_trailers = trailers;
+    session->header_block.length = 0;
+    buffer_append(&session->header_block, p, length);
+    return flags & H2_FLAG_END_HEADERS ? finish_header_block(session) : 0;
+}
+
+static int on_continuation(H2Session *session, uint8_t flags, uint32_t stream_id, const uint8_t *p, size_t length) {
+    if (!session->header_stream || stream_id != session->header_stream) return H2_PROTOCOL_ERROR;
+    if (session->header_block.length + length > H2_MAX_HEADER_BLOCK) return H2_ENHANCE_YOUR_CALM;
+    buffer_append(&session->header_block, p, length);
+    return flags & H2_FLAG_END_HEADERS ? finish_header_block(session) : 0;
+}
+
+static int on_data(H2Session *session, uint8_t flags, uint32_t stream_id, const uint8_t *p, size_t length) {
+    if (stream_id == 0) return H2_PROTOCOL_ERROR;
+
+    size_t frame_length = length;
+    if (flags & H2_FLAG_PADDED) {
+        if (length < 1) return H2_FRAME_SIZE_ERROR;
+        size_t padding = *p++;
+        length--;
+        if (padding > length) return H2_PROTOCOL_ERROR;
+        length -= padding;
+    }
+
+    // Body bytes stay charged to the connection window until the request is
+    // dispatched, so the window is what bounds the buffered bodies; padding
+    // and frames that are discarded are given back at once
+    if ((int64_t)frame_length > session->recv_window) return H2_FLOW_CONTROL_ERROR;
+    session->recv_window -= (int64_t)frame_length;
+    return_window(session, frame_length - length);
+
+    H2Stream *stream = find_stream(session, stream_id);
+    if (!stream || stream->state != STREAM_RECEIVING) {
+        return_window(session, length);
+        if (stream_id > session->last_stream_id) return H2_PROTOCOL_ERROR;
+        if (!stream) send_rst(session, stream_id, H2_STREAM_CLOSED);
+        return stream ? H2_STREAM_CLOSED : 0;
+    }
+
+    // The stream window already stops a compliant peer here
+    if (stream->body.length + length > H2_MAX_BODY) {
+        return_window(session, length);
+        send_rst(session, stream_id, H2_ENHANCE_YOUR_CALM);
+        close_stream(session, stream);
+        return 0;
+    }
+    buffer_append(&stream->body, p, length);
+    if (stream->body.failed) return_window(session, length);
+
+    if (flags & H2_FLAG_END_STREAM) stream->state = STREAM_READY;
+    return 0;
+}
+
+static int on_settings(H2Session *session, uint8_t flags, uint32_t stream_id, const uint8_t *p, size_t length) {
+    if (stream_id != 0) return H2_PROTOCOL_ERROR;
+    if (flags & H2_FLAG_ACK) return length == 0 ? 0 : H2_FRAME_SIZE_ERROR;
+    if (length % 6 != 0) return H2_FRAME_SIZE_ERROR;
+
+    int error = apply_settings(session, p, length);
+    if (error) return error;
+    write_frame_header(&session->out, 0, H2_SETTINGS, H2_FLAG_ACK, 0);
+    flush_streams(session);
+    return 0;
+}
+
+static int on_window_update(H2Session *session, uint32_t stream_id, const uint8_t *p, size_t length) {
+    if (length != 4) return H2_FRAME_SIZE_ERROR;
+    uint32_t increment = read_u32(p) & 0x7fffffff;
+
+    if (stream_id == 0) {
+        if (increment == 0) return H2_PROTOCOL_ERROR;
+        session->send_window += increment;
+        if (session->send_window > H2_MAX_WINDOW) return H2_FLOW_CONTROL_ERROR;
+        flush_streams(session);
+        return 0;
+    }
+
+    H2Stream *stream = find_stream(session, stream_id);
+    if (increment == 0 || (stream && stream->send_window + increment > H2_MAX_WINDOW)) {
+        send_rst(session, stream_id, increment == 0 ? H2_PROTOCOL_ERROR : H2_FLOW_CONTROL_ERROR);
+        if (stream) close_stream(session, stream);
+        return 0;
+    }
+    if (stream) {
+        stream->send_window += increment;
+        if (stream->state == STREAM_SENDING) flush_stream(session, stream);
+    }
+    return 0;
+}
+
+static int handle_frame(H2Session *session, uint8_t type, uint8_t flags, uint32_t stream_id,
+                        const uint8_t *payload, size_t length) {
+    // Nothing may come between HEADERS and its CONTINUATION frames
+    if (session->header_stream && type != H2_CONTINUATION) return H2_PROTOCOL_ERROR;
+
+    switch (type) {
+        case H2_DATA:
+            return on_data(session, flags, stream_id, payload, length);
+        case H2_HEADERS:
+            if (length > H2_MAX_HEADER_BLOCK) return H2_ENHANCE_YOUR_CALM;
+            return on_headers(session, flags, stream_id, payload, length);
+        case H2_PRIORITY:
+            if (stream_id == 0) return H2_PROTOCOL_ERROR;
+            if (length != 5) send_rst(session, stream_id, H2_FRAME_SIZE_ERROR);
+            return 0;
+        case H2_RST_STREAM: {
+            if (stream_id == 0 || stream_id > session->last_stream_id) return H2_PROTOCOL_ERROR;
+            if (length != 4) return H2_FRAME_SIZE_ERROR;
+            H2Stream *stream = find_stream(session, stream_id);
+            if (stream) close_stream(session, stream);
+            return 0;
+        }
+        case H2_SETTINGS:
+            return on_settings(session, flags, stream_id, payload, length);
+        case H2_PUSH_PROMISE:
+            return H2_PROTOCOL_ERROR;
+        case H2_PING:
+            if (stream_id != 0) return H2_PROTOCOL_ERROR;
+            if (length != 8) return H2_FRAME_SIZE_ERROR;
+            if (!(flags & H2_FLAG_ACK)) {
+                write_frame_header(&session->out, 8, H2_PING, H2_FLAG_ACK, 0);
+                buffer_append(&session->out, payload, 8);
+            }
+            return 0;
+        case H2_GOAWAY:
+            if (stream_id != 0) return H2_PROTOCOL_ERROR;
+            session->closing = 1;
+            return 0;
+        case H2_WINDOW_UPDATE:
+            return on_window_update(session, stream_id, payload, length);
+        case H2_CONTINUATION:
+            return on_continuation(session, flags, stream_id, payload, length);
+        default:
+            // Unknown frame types are ignored
+            return 0;
+    }
+}
+
+// ===== Requests =====
+
+static HTTPMethod method_from_name(const char *name) {
+    static const char *const names[] = {"GET", "POST", "PUT", "DELETE", "HEAD", "OPTIONS", "PATCH"};
+    for (int i = 0; i < 7; i++) {
+        if (strcmp(name, names[i]) == 0) return (HTTPMethod)i;
+    }
+    return HTTP_UNKNOWN;
+}
+
+// "Name: value" with the name in canonical case, e.g. "user-agent" -> "User-Agent"
+static char *header_line(Arena *arena, const char *name, size_t name_length, const char *value) {
+    size_t value_length = strlen(value);
+    char *line = arena_alloc(arena, name_length + value_length + 3);
+    if (!line) return NULL;
+    int word_start = 1;
+    for (size_t i = 0; i < name_length; i++) {
+        char c = name[i];
+        line[i] = word_start && c >= 'a' && c <= 'z' ? (char)(c - 32) : c;
+        word_start = c == '-';
+    }
+    memcpy(line + name_length, ": ", 2);
+    memcpy(line + name_length + 2, value, value_length + 1);
+    return line;
+}
+
+static int build_request(const H2Stream *stream, HTTPRequest *request, Arena *arena) {
+    memset(request, 0, sizeof(HTTPRequest));
+    request->method = HTTP_UNKNOWN;
+    request->keep_alive = 1;
+    request->arena = arena;
+    request->client_fd = -1;
+
+    const char *authority = NULL;
+    int has_host = 0;
+    const char *p = stream->fields.data;
+    const char *end = p + stream->fields.length;
+    while (p < end) {
+        const char *name = p;
+        size_t name_length = strlen(name);
+        const char *value = name + name_length + 1;
+        p = value + strlen(value) + 1;
+
+        if (strcmp(name, ":method") == 0) {
+            request->method = method_from_name(value);
+        } else if (strcmp(name, ":path") == 0) {
+            request->path = arena_strndup(arena, value, strlen(value));
+            if (!request->path) return -1;
+            char *query = strchr(request->path, '?');
+            if (query) {
+                *query = '\0';
+                request->query_string = query + 1;
+            }
+        } else if (strcmp(name, ":authority") == 0) {
+            authority = value;
+        } else if (name[0] != ':' && request->header_count < H2_MAX_REQUEST_FIELDS) {
+            char *line = header_line(arena, name, name_length, value);
+            if (!line) return -1;
+            request->headers[request->header_count++] = line;
+            if (strcmp(name, "content-type") == 0) request->content_type = line + name_length + 2;
+            if (strcmp(name, "host") == 0) has_host = 1;
+        }
+    }
+
+    // :authority stands in for Host
+    if (authority && !has_host && request->header_count < H2_MAX_REQUEST_FIELDS) {
+        char *line = header_line(arena, "host", 4, authority);
+        if (!line) return -1;
+        request->headers[request->header_count++] = line;
+    }
+
+    if (stream->body.length > 0) {
+        request->body = arena_strndup(arena, stream->body.data, stream->body.length);
+        if (!request->body) return -1;
+        request->body_length = stream->body.length;
+    }
+    return 0;
+}
+
+// HTTP2-Settings carries a SETTINGS payload in base64url without padding
+static int decode_settings_header(const char *text, uint8_t *out, size_t out_size, size_t *length) {
+    uint32_t bits = 0;
+    int bit_count = 0;
+    size_t n = 0;
+    for (const char *p = text; *p && *p != '\r' && *p != '\n' && *p != ' '; p++) {
+        int v;
+        if (*p >= 'A' && *p <= 'Z') v = *p - 'A';
+        else if (*p >= 'a' && *p <= 'z') v = *p - 'a' + 26;
+        else if (*p >= '0' && *p <= '9') v = *p - '0' + 52;
+        else if (*p == '-' || *p == '+') v = 62;
+        else if (*p == '_' || *p == '/') v = 63;
+        else if (*p == '=') break;
+        else return -1;
+
+        bits = bits << 6 | (uint32_t)v;
+        bit_count += 6;
+        if (bit_count >= 8) {
+            bit_count -= 8;
+            if (n >= out_size) return -1;
+            out[n++] = (uint8_t)(bits >> bit_count);
+        }
+    }
+    *length = n;
+    return 0;
+}
+
+// ===== Public API =====
+
+int h2_is_preface(const char *data, size_t length) {
+    return length >= H2_PREFACE_LENGTH && memcmp(data, H2_PREFACE, H2_PREFACE_LENGTH) == 0;
+}
+
+int h2_is_upgrade_request(const HTTPRequest *request) {
+    const char *upgrade = http_request_header(request, "Upgrade");
+    const char *connection = http_request_header(request, "Connection");
+    return upgrade && connection && http_request_header(request, "HTTP2-Settings") &&
+           strncasecmp(upgrade, "h2c", 3) == 0 && strcasestr(connection, "upgrade") != NULL;
+}
+
+H2Session *h2_session_create(void) {
+    H2Session *session = calloc(1, sizeof(H2Session));
+    if (!session) return NULL;
+
+    session->decoder.max_size = HPACK_TABLE_SIZE;
+    session->peer_max_frame = H2_DEFAULT_FRAME_SIZE;
+    session->peer_initial_window = H2_DEFAULT_WINDOW;
+    session->send_window = H2_DEFAULT_WINDOW;
+    send_settings(session);
+    if (session->out.failed) {
+        h2_session_free(session);
+        return NULL;
+    }
+    return session;
+}
+
+H2Session *h2_session_create_upgraded(const HTTPRequest *request) {
+    uint8_t settings[256];
+    size_t length;
+    const char *header = http_request_header(request, "HTTP2-Settings");
+    if (!header || decode_settings_header(header, settings, sizeof(settings), &length) != 0 || length % 6 != 0) {
+        return NULL;
+    }
+
+    H2Session *session = h2_session_create();
+    if (!session) return NULL;
+    // Acknowledged implicitly by the 101 response
+    if (apply_settings(session, settings, length) != 0) {
+        h2_session_free(session);
+        return NULL;
+    }
+
+    // The upgrading request becomes stream 1, already complete
+    H2Stream *stream = open_stream(session, 1);
+    if (!stream) {
+        h2_session_free(session);
+        return NULL;
+    }
+    stream->state = STREAM_DISPATCHED;
+    stream->head_request = request->method == HTTP_HEAD;
+    session->last_stream_id = 1;
+    return session;
+}
+
+void h2_session_free(H2Session *session) {
+    if (!session) return;
+    while (session->streams) close_stream(session, session->streams);
+    hpack_table_free(&session->decoder);
+    buffer_free(&session->in);
+    buffer_free(&session->out);
+    buffer_free(&session->header_block);
+    buffer_free(&session->scratch);
+    free(session);
+}
+
+int h2_session_receive(H2Session *session, const char *data, size_t length) {
+    if (session->closing) return -1;
+    buffer_append(&session->in, data, length);
+    if (session->in.failed) return connection_error(session, H2_INTERNAL_ERROR);
+
+    const uint8_t *in = (const uint8_t *)session->in.data;
+    size_t available = session->in.length;
+    size_t position = 0;
+    int result = 0;
+
+    if (!session->preface_received) {
+        size_t compare = available < H2_PREFACE_LENGTH ? available : H2_PREFACE_LENGTH;
+        if (memcmp(in, H2_PREFACE, compare) != 0) return connection_error(session, H2_PROTOCOL_ERROR);
+        if (available < H2_PREFACE_LENGTH) return 0;
+        session->preface_received = 1;
+        position = H2_PREFACE_LENGTH;
+    }
+
+    while (available - position >= H2_FRAME_HEADER && !session->closing) {
+        const uint8_t *header = in + position;
+        size_t frame_length = (size_t)header[0] << 16 | (size_t)header[1] << 8 | header[2];
+        if (frame_length > H2_DEFAULT_FRAME_SIZE) {
+            result = connection_error(session, H2_FRAME_SIZE_ERROR);
+            break;
+        }
+        if (available - position < H2_FRAME_HEADER + frame_length) break;
+
+        uint32_t stream_id = read_u32(header + 5) & 0x7fffffff;
+        int error = handle_frame(session, header[3], header[4], stream_id, header + H2_FRAME_HEADER, frame_length);
+        position += H2_FRAME_HEADER + frame_length;
+        if (error) {
+            result = connection_error(session, (uint32_t)error);
+            break;
+        }
+    }
+
+    // Keep a partial frame for the next read
+    memmove(session->in.data, session->in.data + position, available - position);
+    session->in.length = available - position;
+
+    if (session->out.failed || session->header_block.failed) return -1;
+    return result;
+}
+
+uint32_t h2_session_next_request(H2Session *session, HTTPRequest *request, Arena *arena) {
+    H2Stream *stream = session->streams;
+    while (stream) {
+        H2Stream *next = stream->next;
+        if (stream->state == STREAM_READY) {
+            stream->state = STREAM_DISPATCHED;
+            if (stream->fields.failed || stream->body.failed || build_request(stream, request, arena) != 0) {
+                send_rst(session, stream->id, H2_INTERNAL_ERROR);
+                close_stream(session, stream);
+            } else {
+                // The request owns a copy of the body now
+                release_body(session, stream);
+                return stream->id;
+            }
+        }
+        stream = next;
+    }
+    return 0;
+}
+
+int64_t h2_session_respond(H2Session *session, uint32_t stream_id, RouteResponse *response) {
+    H2Stream *stream = find_stream(session, stream_id);
+    if (!stream || stream->state != STREAM_DISPATCHED || !response->data) return -1;
+
+    H2Buffer *block = &session->scratch;
+    block->length = 0;
+    const char *body;
+    size_t body_length;
+    int status_code = response->status_code ? response->status_code : 200;
+
+    if (response->is_streaming) {
+        // A streamed body goes out as DATA frames instead of HTTP/1.1 chunks
+        hpack_write_status(block, 200);
+        hpack_write_field(block, "content-type", 12, "text/plain", 10);
+        body = response->data;
+        body_length = strlen(response->data);
+    } else {
+        // Re-encode the HTTP/1.1 head; connection-specific headers have no place in HTTP/2
+        const char *data = response->data;
+        const char *head_end = memmem(data, response->length, "\r\n\r\n", 4);
+        if (!head_end) return -1;
+        hpack_write_status(block, status_code);
+
+        const char *line = memchr(data, '\n', (size_t)(head_end - data));
+        while (line && line < head_end) {
+            line++;
+            const char *line_end = memmem(line, (size_t)(head_end + 2 - line), "\r\n", 2);
+            if (!line_end) break;
+            const char *colon = memchr(line, ':', (size_t)(line_end - line));
+            if (colon) {
+                char name[64];
+                size_t name_length = (size_t)(colon - line);
+                const char *value = colon + 1;
+                while (value < line_end && (*value == ' ' || *value == '\t')) value++;
+                const char *value_end = line_end;
+                while (value_end > value && (value_end[-1] == ' ' || value_end[-1] == '\t')) value_end--;
+
+                if (name_length > 0 && name_length < sizeof(name)) {
+                    for (size_t i = 0; i < name_length; i++) {
+                        char c = line[i];
+                        name[i] = c >= 'A' && c <= 'Z' ? (char)(c + 32) : c;
+                    }
+                    name[name_length] = '\0';
+                    if (strcmp(name, "connection") != 0 && strcmp(name, "keep-alive") != 0 &&
+                        strcmp(name, "transfer-encoding") != 0 && strcmp(name, "upgrade") != 0 &&
+                        strcmp(name, "proxy-connection") != 0) {
+                        hpack_write_field(block, name, name_length, value, (size_t)(value_end - value));
+                    }
+                }
+            }
+            line = line_end + 1;
+        }
+        body = head_end + 4;
+        body_length = (size_t)(data + response->length - body);
+    }
+    if (block->failed) return -1;
+
+    uint64_t file_length = response->file ? response->file_length : 0;
+    if (stream->head_request || status_code == 204 || status_code == 304) {
+        body_length = 0;
+        file_length = 0;
+    }
+    int end_stream = body_length == 0 && file_length == 0;
+
+    // HEADERS, then CONTINUATION for a block larger than the peer's frames
+    size_t offset = 0;
+    do {
+        size_t chunk = block->length - offset;
+        if (chunk > session->peer_max_frame) chunk = session->peer_max_frame;
+        uint8_t flags = offset + chunk == block->length ? H2_FLAG_END_HEADERS : 0;
+        if (offset == 0 && end_stream) flags |= H2_FLAG_END_STREAM;
+        write_frame_header(&session->out, chunk, offset == 0 ? H2_HEADERS : H2_CONTINUATION, flags, stream_id);
+        buffer_append(&session->out, block->data + offset, chunk);
+        offset += chunk;
+    } while (offset < block->length);
+    int64_t sent = (int64_t)block->length;
+
+    if (end_stream) {
+        close_stream(session, stream);
+        return session->out.failed ? -1 : sent;
+    }
+
+    if (file_length > 0) {
+        // The stream now holds the file reference
+        stream->file = response->file;
+        stream->file_offset = response->file_offset;
+        stream->file_remaining = file_length;
+        response->file = NULL;
+    } else {
+        stream->pending = malloc(body_length);
+        if (!stream->pending) {
+            send_rst(session, stream_id, H2_INTERNAL_ERROR);
+            close_stream(session, stream);
+            return -1;
+        }
+        memcpy(stream->pending, body, body_length);
+        stream->pending_length = body_length;
+    }
+    stream->state = STREAM_SENDING;
+    flush_stream(session, stream);
+    return session->out.failed ? -1 : sent + (int64_t)body_length + (int64_t)file_length;
+}
+
+const char *h2_session_output(const H2Session *session, size_t *length) {
+    *length = session->out.length;
+    return session->out.data;
+}
+
+void h2_session_output_sent(H2Session *session) {
+    session->out.length = 0;
+}
+
+int h2_session_is_closing(const H2Session *session) {
+    return session->closing;
+}
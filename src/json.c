@@ -0,0 +1,795 @@
+#define _POSIX_C_SOURCE 200809L
+
+// ===== Standard Library Headers =====
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <immintrin.h>
+
+// ===== Project Headers =====
+#include "json.h"
+#include "asm_utils.h"
+
+// ===== 1. STAGE 1: STRUCTURAL INDEX =====
+// Every 64-byte block is reduced to three bitmasks (quotes, backslashes and
+// structural characters). Escaped quotes are removed with the odd-length
+// backslash sequence trick, the in-string region is the prefix-XOR of the
+// remaining quotes, and the surviving bits are flattened into offsets.
+
+#define JSON_BLOCK_SIZE 64
+#define ODD_BITS 0xAAAAAAAAAAAAAAAAULL
+
+typedef struct {
+    uint64_t prev_escaped;    // 1 if the first byte of the next block is escaped
+    uint64_t prev_in_string;  // All ones if the previous block ended inside a string
+} ScanState;
+
+static inline uint64_t prefix_xor(uint64_t x) {
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
+
+static inline uint64_t find_escaped(ScanState *state, uint64_t backslash) {
+    if (!backslash) {
+        uint64_t escaped = state->prev_escaped;
+        state->prev_escaped = 0;
+        return escaped;
+    }
+
+    uint64_t potential_escape = backslash & ~state->prev_escaped;
+    uint64_t maybe_escaped = potential_escape << 1;
+    uint64_t escape_and_terminal = ((maybe_escaped | ODD_BITS) - potential_escape) ^ ODD_BITS;
+    uint64_t escaped = escape_and_terminal ^ (backslash | state->prev_escaped);
+    uint64_t escape = escape_and_terminal & backslash;
+    state->prev_escaped = escape >> 63;
+    return escaped;
+}
+
+static inline size_t flatten_block(ScanState *state, uint64_t quote, uint64_t backslash,
+                                   uint64_t structural, uint32_t base, uint32_t *out) {
+    quote &= ~find_escaped(state, backslash);
+
+    uint64_t in_string = prefix_xor(quote) ^ state->prev_in_string;
+    state->prev_in_string = (uint64_t)((int64_t)in_string >> 63);
+
+    uint64_t bits = (structural & ~in_string) | quote;
+    size_t n = 0;
+    while (bits) {
+        out[n++] = base + (uint32_t)__builtin_ctzll(bits);
+        bits &= bits - 1;
+    }
+    return n;
+}
+
+// '[' | 0x20 == '{' and ']' | 0x20 == '}', so two compares cover all four brackets
+__attribute__((target("avx2")))
+static size_t build_index_avx2(const char *buf, size_t len, uint32_t *out, ScanState *state) {
+    const __m256i case_bit = _mm256_set1_epi8(0x20);
+    const __m256i open_brace = _mm256_set1_epi8('{');
+    const __m256i close_brace = _mm256_set1_epi8('}');
+    const __m256i colon = _mm256_set1_epi8(':');
+    const __m256i comma = _mm256_set1_epi8(',');
+    const __m256i quote_char = _mm256_set1_epi8('"');
+    const __m256i backslash_char = _mm256_set1_epi8('\\');
+
+    char tail[JSON_BLOCK_SIZE];
+    size_t n = 0;
+
+    for (size_t offset = 0; offset < len; offset += JSON_BLOCK_SIZE) {
+        const char *block = buf + offset;
+        if (len - offset < JSON_BLOCK_SIZE) {
+            memset(tail, ' ', sizeof(tail));
+            memcpy(tail, block, len - offset);
+            block = tail;
+        }
+
+        __m256i lo = _mm256_loadu_si256((const __m256i *)block);
+        __m256i hi = _mm256_loadu_si256((const __m256i *)(block + 32));
+        __m256i lo_folded = _mm256_or_si256(lo, case_bit);
+        __m256i hi_folded = _mm256_or_si256(hi, case_bit);
+
+        __m256i lo_struct = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(lo_folded, open_brace), _mm256_cmpeq_epi8(lo_folded, close_brace)),
+            _mm256_or_si256(_mm256_cmpeq_epi8(lo, colon), _mm256_cmpeq_epi8(lo, comma)));
+        __m256i hi_struct = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(hi_folded, open_brace), _mm256_cmpeq_epi8(hi_folded, close_brace)),
+            _mm256_or_si256(_mm256_cmpeq_epi8(hi, colon), _mm256_cmpeq_epi8(hi, comma)));
+
+        uint64_t structural = (uint32_t)_mm256_movemask_epi8(lo_struct) |
+                              ((uint64_t)(uint32_t)_mm256_movemask_epi8(hi_struct) << 32);
+        uint64_t quote = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, quote_char)) |
+                         ((uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, quote_char)) << 32);
+        uint64_t backslash = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, backslash_char)) |
+                             ((uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, backslash_char)) << 32);
+
+        n += flatten_block(state, quote, backslash, structural, (uint32_t)offset, out + n);
+    }
+
+    return n;
+}
+
+static inline uint64_t sse2_mask(const char *block, __m128i needle, int fold) {
+    uint64_t mask = 0;
+    for (int lane = 0; lane < 4; lane++) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(block + lane * 16));
+        if (fold) v = _mm_or_si128(v, _mm_set1_epi8(0x20));
+        mask |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, needle)) << (lane * 16);
+    }
+    return mask;
+}
+
+static size_t build_index_sse2(const char *buf, size_t len, uint32_t *out, ScanState *state) {
+    char tail[JSON_BLOCK_SIZE];
+    size_t n = 0;
+
+    for (size_t offset = 0; offset < len; offset += JSON_BLOCK_SIZE) {
+        const char *block = buf + offset;
+        if (len - offset < JSON_BLOCK_SIZE) {
+            memset(tail, ' ', sizeof(tail));
+            memcpy(tail, block, len - offset);
+            block = tail;
+        }
+
+        uint64_t structural = sse2_mask(block, _mm_set1_epi8('{'), 1) |
+                              sse2_mask(block, _mm_set1_epi8('}'), 1) |
+                              sse2_mask(block, _mm_set1_epi8(':'), 0) |
+                              sse2_mask(block, _mm_set1_epi8(','), 0);
+        uint64_t quote = sse2_mask(block, _mm_set1_epi8('"'), 0);
+        uint64_t backslash = sse2_mask(block, _mm_set1_epi8('\\'), 0);
+
+        n += flatten_block(state, quote, backslash, structural, (uint32_t)offset, out + n);
+    }
+
+    return n;
+}
+
+// Bracket balance check; also rejects a document whose last string never closes
+static int validate_index(const JsonDoc *doc) {
+    char stack[JSON_MAX_DEPTH];
+    int depth = 0;
+
+    for (size_t i = 0; i < doc->count; i++) {
+        char c = doc->buf[doc->index[i]];
+        if (c == '{' || c == '[') {
+            if (depth >= JSON_MAX_DEPTH) return -1;
+            stack[depth++] = c;
+        } else if (c == '}' || c == ']') {
+            if (depth == 0) return -1;
+            char open = stack[--depth];
+            if ((c == '}' && open != '{') || (c == ']' && open != '[')) return -1;
+        }
+    }
+
+    return depth == 0 ? 0 : -1;
+}
+
+int json_doc_parse_into(JsonDoc *doc, const char *buf, size_t len, uint32_t *storage, size_t capacity) {
+    if (!doc || !buf || !storage) return -1;
+    if (len > UINT32_MAX - JSON_BLOCK_SIZE || capacity < len + 1) return -1;
+
+    memset(doc, 0, sizeof(JsonDoc));
+    doc->buf = buf;
+    doc->len = len;
+    doc->index = storage;
+
+    ScanState state = {0, 0};
+    if (has_avx2_support()) {
+        doc->count = build_index_avx2(buf, len, storage, &state);
+    } else {
+        doc->count = build_index_sse2(buf, len, storage, &state);
+    }
+
+    if (state.prev_in_string) return -1;  // Unterminated string
+    return validate_index(doc);
+}
+
+int json_doc_parse(JsonDoc *doc, const char *buf, size_t len) {
+    if (!doc || !buf) return -1;
+
+    uint32_t *storage = malloc((len + 1) * sizeof(uint32_t));
+    if (!storage) return -1;
+
+    if (json_doc_parse_into(doc, buf, len, storage, len + 1) != 0) {
+        free(storage);
+        memset(doc, 0, sizeof(JsonDoc));
+        return -1;
+    }
+
+    doc->owns_index = 1;
+    return 0;
+}
+
+void json_doc_free(JsonDoc *doc) {
+    if (!doc) return;
+    if (doc->owns_index) free(doc->index);
+    memset(doc, 0, sizeof(JsonDoc));
+}
+
+// ===== 2. STAGE 2: ON-DEMAND CURSOR =====
+
+static inline int is_json_ws(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static inline uint32_t skip_ws(const JsonDoc *doc, uint32_t pos) {
+    while (pos < doc->len && is_json_ws(doc->buf[pos])) pos++;
+    return pos;
+}
+
+static inline char char_at_slot(const JsonDoc *doc, uint32_t slot) {
+    return slot < doc->count ? doc->buf[doc->index[slot]] : '\0';
+}
+
+// Build a cursor for the value starting at byte `pos`; `slot` is the first
+// index entry at or after `pos`
+static int make_cursor(const JsonDoc *doc, uint32_t pos, uint32_t slot, JsonCursor *out) {
+    if (pos >= doc->len) return -1;
+
+    char c = doc->buf[pos];
+    if (c == '"' || c == '{' || c == '[') {
+        if (slot >= doc->count || doc->index[slot] != pos) return -1;
+    } else if (c == '}' || c == ']' || c == ',' || c == ':') {
+        return -1;
+    }
+
+    out->doc = doc;
+    out->pos = pos;
+    out->i = slot;
+    return 0;
+}
+
+// Returns the index slot immediately after the value
+static int skip_value(const JsonCursor *value, uint32_t *next_slot) {
+    const JsonDoc *doc = value->doc;
+    char c = doc->buf[value->pos];
+
+    if (c == '"') {
+        *next_slot = value->i + 2;
+        return 0;
+    }
+
+    if (c == '{' || c == '[') {
+        int depth = 0;
+        for (uint32_t slot = value->i; slot < doc->count; slot++) {
+            char s = doc->buf[doc->index[slot]];
+            if (s == '{' || s == '[') depth++;
+            else if (s == '}' || s == ']') {
+                if (--depth == 0) {
+                    *next_slot = slot + 1;
+                    return 0;
+                }
+            }
+        }
+        return -1;
+    }
+
+    *next_slot = value->i;  // Scalars have no index entry of their own
+    return 0;
+}
+
+// End of a scalar, with trailing whitespace trimmed
+static uint32_t scalar_end(const JsonCursor *value) {
+    const JsonDoc *doc = value->doc;
+    uint32_t end = value->i < doc->count ? doc->index[value->i] : (uint32_t)doc->len;
+    while (end > value->pos && is_json_ws(doc->buf[end - 1])) end--;
+    return end;
+}
+
+int json_doc_root(const JsonDoc *doc, JsonCursor *root) {
+    if (!doc || !root) return -1;
+    return make_cursor(doc, skip_ws(doc, 0), 0, root);
+}
+
+JSONType json_cursor_type(const JsonCursor *cursor) {
+    switch (cursor->doc->buf[cursor->pos]) {
+        case '{': return JSON_OBJECT;
+        case '[': return JSON_ARRAY;
+        case '"': return JSON_STRING;
+        case 't':
+        case 'f': return JSON_BOOLEAN;
+        case 'n': return JSON_NULL;
+        default:  return JSON_NUMBER;
+    }
+}
+
+int json_object_begin(const JsonCursor *object, JsonIter *it) {
+    if (!object || !it || object->doc->buf[object->pos] != '{') return -1;
+
+    it->doc = object->doc;
+    it->i = object->i + 1;
+    it->done = char_at_slot(object->doc, it->i) == '}';
+    return 0;
+}
+
+// Returns 1 when a member was produced, 0 at the end of the object, -1 on malformed input
+int json_object_next(JsonIter *it, JsonSlice *key, JsonCursor *value) {
+    if (it->done) return 0;
+
+    const JsonDoc *doc = it->doc;
+    uint32_t k = it->i;
+    if (char_at_slot(doc, k) != '"' || char_at_slot(doc, k + 1) != '"' ||
+        char_at_slot(doc, k + 2) != ':') {
+        return -1;
+    }
+
+    if (key) {
+        key->ptr = doc->buf + doc->index[k] + 1;
+        key->len = doc->index[k + 1] - doc->index[k] - 1;
+    }
+
+    JsonCursor member;
+    if (make_cursor(doc, skip_ws(doc, doc->index[k + 2] + 1), k + 3, &member) != 0) return -1;
+
+    uint32_t next;
+    if (skip_value(&member, &next) != 0) return -1;
+
+    char delimiter = char_at_slot(doc, next);
+    if (delimiter == ',') {
+        it->i = next + 1;
+    } else if (delimiter == '}') {
+        it->done = 1;
+    } else {
+        return -1;
+    }
+
+    if (value) *value = member;
+    return 1;
+}
+
+int json_array_begin(const JsonCursor *array, JsonIter *it) {
+    if (!array || !it || array->doc->buf[array->pos] != '[') return -1;
+
+    it->doc = array->doc;
+    it->i = array->i;  // Slot of the delimiter preceding the next element
+    it->done = array->doc->buf[skip_ws(array->doc, array->pos + 1)] == ']';
+    return 0;
+}
+
+int json_array_next(JsonIter *it, JsonCursor *value) {
+    if (it->done) return 0;
+
+    const JsonDoc *doc = it->doc;
+    JsonCursor element;
+    if (make_cursor(doc, skip_ws(doc, doc->index[it->i] + 1), it->i + 1, &element) != 0) return -1;
+
+    uint32_t next;
+    if (skip_value(&element, &next) != 0) return -1;
+
+    char delimiter = char_at_slot(doc, next);
+    if (delimiter == ',') {
+        it->i = next;
+    } else if (delimiter == ']') {
+        it->done = 1;
+    } else {
+        return -1;
+    }
+
+    if (value) *value = element;
+    return 1;
+}
+
+int json_key_equals(JsonSlice key, const char *expected) {
+    size_t expected_len = strlen(expected);
+
+    if (!memchr(key.ptr, '\\', key.len)) {
+        return key.len == expected_len && memcmp(key.ptr, expected, key.len) == 0;
+    }
+
+    char decoded[256];
+    size_t decoded_len;
+    if (json_unescape(key.ptr, key.len, decoded, sizeof(decoded), &decoded_len) != 0) return 0;
+    return decoded_len == expected_len && memcmp(decoded, expected, decoded_len) == 0;
+}
+
+int json_object_get(const JsonCursor *object, const char *key, JsonCursor *value) {
+    JsonIter it;
+    if (json_object_begin(object, &it) != 0) return -1;
+
+    JsonSlice member_key;
+    JsonCursor member;
+    int rc;
+    while ((rc = json_object_next(&it, &member_key, &member)) == 1) {
+        if (json_key_equals(member_key, key)) {
+            if (value) *value = member;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+// ===== 3. VALUE DECODING =====
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static int read_hex4(const char *p, const char *end, uint32_t *out) {
+    if (end - p < 4) return -1;
+    uint32_t v = 0;
+    for (int i = 0; i < 4; i++) {
+        int h = hex_value(p[i]);
+        if (h < 0) return -1;
+        v = (v << 4) | (uint32_t)h;
+    }
+    *out = v;
+    return 0;
+}
+
+static size_t utf8_encode(uint32_t cp, char *out) {
+    if (cp < 0x80) {
+        out[0] = (char)cp;
+        return 1;
+    }
+    if (cp < 0x800) {
+        out[0] = (char)(0xC0 | (cp >> 6));
+        out[1] = (char)(0x80 | (cp & 0x3F));
+        return 2;
+    }
+    if (cp < 0x10000) {
+        out[0] = (char)(0xE0 | (cp >> 12));
+        out[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        out[2] = (char)(0x80 | (cp & 0x3F));
+        return 3;
+    }
+    out[0] = (char)(0xF0 | (cp >> 18));
+    out[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+    out[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+    out[3] = (char)(0x80 | (cp & 0x3F));
+    return 4;
+}
+
+int json_unescape(const char *src, size_t len, char *output, size_t output_size, size_t *out_len) {
+    if (!src || !output || output_size == 0) return -1;
+
+    const char *p = src;
+    const char *end = src + len;
+    size_t o = 0;
+
+    while (p < end) {
+        const char *backslash = memchr(p, '\\', (size_t)(end - p));
+        size_t run = backslash ? (size_t)(backslash - p) : (size_t)(end - p);
+        if (o + run >= output_size) return -1;
+        memcpy(output + o, p, run);
+        o += run;
+        p += run;
+        if (!backslash) break;
+
+        if (++p >= end) return -1;
+        char decoded[4];
+        size_t decoded_len = 1;
+
+        switch (*p++) {
+            case '"':  decoded[0] = '"'; break;
+            case '\\': decoded[0] = '\\'; break;
+            case '/':  decoded[0] = '/'; break;
+            case 'b':  decoded[0] = '\b'; break;
+            case 'f':  decoded[0] = '\f'; break;
+            case 'n':  decoded[0] = '\n'; break;
+            case 'r':  decoded[0] = '\r'; break;
+            case 't':  decoded[0] = '\t'; break;
+            case 'u': {
+                uint32_t cp;
+                if (read_hex4(p, end, &cp) != 0) return -1;
+                p += 4;
+                if (cp >= 0xD800 && cp <= 0xDBFF) {
+                    uint32_t low;
+                    if (end - p < 6 || p[0] != '\\' || p[1] != 'u' ||
+                        read_hex4(p + 2, end, &low) != 0 || low < 0xDC00 || low > 0xDFFF) {
+                        return -1;
+                    }
+                    p += 6;
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                } else if (cp >= 0xDC00 && cp <= 0xDFFF) {
+                    return -1;
+                }
+                decoded_len = utf8_encode(cp, decoded);
+                break;
+            }
+            default:
+                return -1;
+        }
+
+        if (o + decoded_len >= output_size) return -1;
+        memcpy(output + o, decoded, decoded_len);
+        o += decoded_len;
+    }
+
+    output[o] = '\0';
+    if (out_len) *out_len = o;
+    return 0;
+}
+
+int json_get_string_raw(const JsonCursor *value, JsonSlice *raw) {
+    if (!value || !raw || value->doc->buf[value->pos] != '"') return -1;
+
+    const JsonDoc *doc = value->doc;
+    raw->ptr = doc->buf + value->pos + 1;
+    raw->len = doc->index[value->i + 1] - value->pos - 1;
+    return 0;
+}
+
+int json_get_string(const JsonCursor *value, char *output, size_t output_size, size_t *out_len) {
+    JsonSlice raw;
+    if (json_get_string_raw(value, &raw) != 0) return -1;
+    return json_unescape(raw.ptr, raw.len, output, output_size, out_len);
+}
+
+// Copy a scalar into a NUL-terminated scratch buffer for strtoll/strtod
+static int scalar_text(const JsonCursor *value, char *tmp, size_t tmp_size) {
+    uint32_t end = scalar_end(value);
+    size_t len = end - value->pos;
+    if (len == 0 || len >= tmp_size) return -1;
+    memcpy(tmp, value->doc->buf + value->pos, len);
+    tmp[len] = '\0';
+    return 0;
+}
+
+int json_get_int64(const JsonCursor *value, int64_t *output) {
+    if (!value || !output || json_cursor_type(value) != JSON_NUMBER) return -1;
+
+    char tmp[64];
+    if (scalar_text(value, tmp, sizeof(tmp)) != 0) return -1;
+
+    char *endptr;
+    errno = 0;
+    long long v = strtoll(tmp, &endptr, 10);
+    if (*endptr == '\0' && errno == ERANGE) return -1;
+    if (*endptr != '\0') {
+        // Accept integral values written with a fraction or exponent (e.g. 1e3);
+        // the range check comes first, casting an out-of-range double is undefined
+        double d = strtod(tmp, &endptr);
+        if (*endptr != '\0' || !(d >= -9223372036854775808.0 && d < 9223372036854775808.0) ||
+            d != (double)(long long)d) return -1;
+        v = (long long)d;
+    }
+
+    *output = v;
+    return 0;
+}
+
+int json_get_double(const JsonCursor *value, double *output) {
+    if (!value || !output || json_cursor_type(value) != JSON_NUMBER) return -1;
+
+    char tmp[64];
+    if (scalar_text(value, tmp, sizeof(tmp)) != 0) return -1;
+
+    char *endptr;
+    double d = strtod(tmp, &endptr);
+    if (*endptr != '\0') return -1;
+
+    *output = d;
+    return 0;
+}
+
+int json_get_bool(const JsonCursor *value, int *output) {
+    if (!value || !output) return -1;
+
+    const char *p = value->doc->buf + value->pos;
+    size_t len = scalar_end(value) - value->pos;
+
+    if (len == 4 && memcmp(p, "true", 4) == 0) {
+        *output = 1;
+        return 0;
+    }
+    if (len == 5 && memcmp(p, "false", 5) == 0) {
+        *output = 0;
+        return 0;
+    }
+    return -1;
+}
+
+int json_is_null(const JsonCursor *value) {
+    if (!value) return 0;
+    size_t len = scalar_end(value) - value->pos;
+    return len == 4 && memcmp(value->doc->buf + value->pos, "null", 4) == 0;
+}
+
+int json_get_raw(const JsonCursor *value, JsonSlice *raw) {
+    if (!value || !raw) return -1;
+
+    const JsonDoc *doc = value->doc;
+    char c = doc->buf[value->pos];
+    uint32_t end;
+    if (c == '"' || c == '{' || c == '[') {
+        uint32_t next_slot;
+        if (skip_value(value, &next_slot) != 0) return -1;
+        end = doc->index[next_slot - 1] + 1;   // Closing quote or bracket
+    } else {
+        end = scalar_end(value);
+    }
+
+    raw->ptr = doc->buf + value->pos;
+    raw->len = end - value->pos;
+    return 0;
+}
+
+// ===== 4. STREAMING WRITER =====
+
+#define JSON_WRITER_MIN_CAPACITY 256
+
+int json_writer_init(JsonWriter *w, size_t initial_capacity) {
+    if (!w) return -1;
+
+    if (initial_capacity < JSON_WRITER_MIN_CAPACITY) initial_capacity = JSON_WRITER_MIN_CAPACITY;
+    w->buf = malloc(initial_capacity);
+    w->len = 0;
+    w->capacity = w->buf ? initial_capacity : 0;
+    w->failed = w->buf ? 0 : 1;
+    w->arena = NULL;
+    return w->failed ? -1 : 0;
+}
+
+int json_writer_init_arena(JsonWriter *w, Arena *arena, size_t initial_capacity) {
+    if (!w) return -1;
+    if (!arena) return json_writer_init(w, initial_capacity);
+
+    if (initial_capacity < JSON_WRITER_MIN_CAPACITY) initial_capacity = JSON_WRITER_MIN_CAPACITY;
+    w->buf = arena_alloc(arena, initial_capacity);
+    w->len = 0;
+    w->capacity = w->buf ? initial_capacity : 0;
+    w->failed = w->buf ? 0 : 1;
+    w->arena = arena;
+    return w->failed ? -1 : 0;
+}
+
+void json_writer_free(JsonWriter *w) {
+    if (!w) return;
+    if (!w->arena) free(w->buf);
+    memset(w, 0, sizeof(JsonWriter));
+}
+
+char *json_writer_finish(JsonWriter *w, size_t *out_len) {
+    if (!w || json_writer_reserve(w, 1) != 0) {
+        json_writer_free(w);
+        return NULL;
+    }
+
+    char *buf = w->buf;
+    buf[w->len] = '\0';
+    if (out_len) *out_len = w->len;
+    memset(w, 0, sizeof(JsonWriter));
+    return buf;
+}
+
+int json_writer_reserve(JsonWriter *w, size_t extra) {
+    if (w->failed) return -1;
+    if (w->len + extra <= w->capacity) return 0;
+
+    size_t capacity = w->capacity ? w->capacity : JSON_WRITER_MIN_CAPACITY;
+    while (capacity < w->len + extra) capacity *= 2;
+
+    char *buf = w->arena ? arena_realloc(w->arena, w->buf, w->capacity, capacity)
+                         : realloc(w->buf, capacity);
+    if (!buf) {
+        w->failed = 1;
+        return -1;
+    }
+
+    w->buf = buf;
+    w->capacity = capacity;
+    return 0;
+}
+
+void json_write_raw(JsonWriter *w, const char *data, size_t len) {
+    if (json_writer_reserve(w, len) != 0) return;
+    memcpy(w->buf + w->len, data, len);
+    w->len += len;
+}
+
+void json_write_cstr(JsonWriter *w, const char *str) {
+    json_write_raw(w, str, strlen(str));
+}
+
+// Offset of the first byte that needs escaping, or len if none does
+__attribute__((target("avx2")))
+static size_t find_escape_avx2(const char *s, size_t len) {
+    const __m256i quote_char = _mm256_set1_epi8('"');
+    const __m256i backslash_char = _mm256_set1_epi8('\\');
+    const __m256i control_max = _mm256_set1_epi8(0x1F);
+    size_t i = 0;
+
+    for (; i + 32 <= len; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(s + i));
+        __m256i special = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, quote_char), _mm256_cmpeq_epi8(v, backslash_char)),
+            _mm256_cmpeq_epi8(_mm256_min_epu8(v, control_max), v));
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(special);
+        if (mask) return i + (size_t)__builtin_ctz(mask);
+    }
+
+    for (; i < len; i++) {
+        unsigned char c = (unsigned char)s[i];
+        if (c == '"' || c == '\\' || c < 0x20) return i;
+    }
+    return len;
+}
+
+static size_t find_escape_sse2(const char *s, size_t len) {
+    const __m128i quote_char = _mm_set1_epi8('"');
+    const __m128i backslash_char = _mm_set1_epi8('\\');
+    const __m128i control_max = _mm_set1_epi8(0x1F);
+    size_t i = 0;
+
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(s + i));
+        __m128i special = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(v, quote_char), _mm_cmpeq_epi8(v, backslash_char)),
+            _mm_cmpeq_epi8(_mm_min_epu8(v, control_max), v));
+        uint32_t mask = (uint32_t)_mm_movemask_epi8(special);
+        if (mask) return i + (size_t)__builtin_ctz(mask);
+    }
+
+    for (; i < len; i++) {
+        unsigned char c = (unsigned char)s[i];
+        if (c == '"' || c == '\\' || c < 0x20) return i;
+    }
+    return len;
+}
+
+void json_write_escaped(JsonWriter *w, const char *str, size_t len) {
+    static const char hex[] = "0123456789abcdef";
+    size_t (*find_escape)(const char *, size_t) = has_avx2_support() ? find_escape_avx2 : find_escape_sse2;
+
+    // Common case: nothing to escape, one reservation and one copy
+    if (json_writer_reserve(w, len) != 0) return;
+
+    while (len > 0) {
+        size_t run = find_escape(str, len);
+        json_write_raw(w, str, run);
+        if (run == len) break;
+
+        unsigned char c = (unsigned char)str[run];
+        char escaped[6] = { '\\', 0, 0, 0, 0, 0 };
+        size_t escaped_len = 2;
+
+        switch (c) {
+            case '"':  escaped[1] = '"'; break;
+            case '\\': escaped[1] = '\\'; break;
+            case '\b': escaped[1] = 'b'; break;
+            case '\f': escaped[1] = 'f'; break;
+            case '\n': escaped[1] = 'n'; break;
+            case '\r': escaped[1] = 'r'; break;
+            case '\t': escaped[1] = 't'; break;
+            default:
+                escaped[1] = 'u';
+                escaped[2] = '0';
+                escaped[3] = '0';
+                escaped[4] = hex[c >> 4];
+                escaped[5] = hex[c & 0x0F];
+                escaped_len = 6;
+                break;
+        }
+
+        json_write_raw(w, escaped, escaped_len);
+        str += run + 1;
+        len -= run + 1;
+    }
+}
+
+void json_write_string(JsonWriter *w, const char *str, size_t len) {
+    json_write_raw(w, "\"", 1);
+    json_write_escaped(w, str, len);
+    json_write_raw(w, "\"", 1);
+}
+
+void json_write_int(JsonWriter *w, int64_t value) {
+    char tmp[24];
+    int n = snprintf(tmp, sizeof(tmp), "%lld", (long long)value);
+    json_write_raw(w, tmp, (size_t)n);
+}
+
+void json_write_double(JsonWriter *w, double value) {
+    char tmp[32];
+    int n = snprintf(tmp, sizeof(tmp), "%.6g", value);
+    json_write_raw(w, tmp, (size_t)n);
+}
@@ -0,0 +1,303 @@
+#define _POSIX_C_SOURCE 200809L
+
+// ===== Standard Library Headers =====
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// ===== Project Headers =====
+#include "utils.h"
+#include "thread_ring.h"
+
+// ===== Constants =====
+#define LOG_RING_SIZE (64 * 1024)       // Bytes queued per thread, a power of two
+#define LOG_LINE_MAX 4096               // Longer lines are truncated
+#define LOG_BATCH_SIZE (256 * 1024)     // Bytes per write() from the writer
+#define LOG_IDLE_WAIT_MS 10             // Writer sleep when every ring is empty
+#define LOG_FLUSH_TIMEOUT_MS 2000
+
+// One producer (the owning thread) and one consumer (the writer). The ring
+// only ever holds whole lines: the tail moves after a line is copied in.
+typedef struct {
+    ThreadRing ring;                    // Positions and ownership
+    _Atomic uint64_t dropped;           // Lines that did not fit
+    char data[LOG_RING_SIZE];
+} LogRing;
+
+static size_t drain_and_write(void *batch);
+static void free_batch(void *batch);
+
+// ===== Global Variables =====
+static ThreadRingList log_rings = THREAD_RING_LIST_INIT(LogRing);
+static _Thread_local LogRing *log_self = NULL;
+
+static atomic_int log_level = ATOMIC_VAR_INIT(LOG_LEVEL_INFO);
+static atomic_int log_fd = ATOMIC_VAR_INIT(STDOUT_FILENO);
+static _Atomic uint64_t log_dropped_total = 0;
+
+static atomic_int log_writer_running = ATOMIC_VAR_INIT(0);
+static RingWriter log_writer = RING_WRITER_INIT(drain_and_write, free_batch, LOG_IDLE_WAIT_MS);
+
+// Timestamp text, rebuilt once per second per thread
+static _Thread_local time_t stamp_second = 0;
+static _Thread_local char stamp_text[32];
+static _Thread_local size_t stamp_length = 0;
+
+static const char *const level_names[] = {
+    "DEBUG   ", "INFO    ", "WARNING ", "ERROR   ", "CRITICAL"
+};
+
+// ===== Formatting =====
+
+static const char *current_stamp(size_t *length) {
+    time_t now = time(NULL);
+    if (now != stamp_second || stamp_length == 0) {
+        struct tm tm_info;
+        localtime_r(&now, &tm_info);
+        stamp_length = strftime(stamp_text, sizeof(stamp_text), "%Y-%m-%d %H:%M:%S", &tm_info);
+        stamp_second = now;
+    }
+    *length = stamp_length;
+    return stamp_text;
+}
+
+// "[2024-01-01 12:00:00] [INFO    ] message\n"; returns the length
+static size_t format_line(char *line, log_level_t level, const char *format, va_list args) {
+    size_t stamp_len;
+    const char *stamp = current_stamp(&stamp_len);
+
+    size_t len = 0;
+    line[len++] = '[';
+    memcpy(line + len, stamp, stamp_len);
+    len += stamp_len;
+    memcpy(line + len, "] [", 3);
+    len += 3;
+    memcpy(line + len, level_names[level], 8);
+    len += 8;
+    memcpy(line + len, "] ", 2);
+    len += 2;
+
+    int n = vsnprintf(line + len, LOG_LINE_MAX - len - 1, format, args);
+    if (n > 0) {
+        len += (size_t)n < LOG_LINE_MAX - len - 1 ? (size_t)n : LOG_LINE_MAX - len - 2;
+    }
+    line[len++] = '\n';
+    return len;
+}
+
+static size_t format_line_args(char *line, log_level_t level, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    size_t len = format_line(line, level, format, args);
+    va_end(args);
+    return len;
+}
+
+static void write_all(int fd, const char *data, size_t length) {
+    while (length > 0) {
+        ssize_t written = write(fd, data, length);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        data += written;
+        length -= (size_t)written;
+    }
+}
+
+// ===== Per-Thread Rings =====
+
+static LogRing *claim_ring(void) {
+    if (!log_self) {
+        log_self = (LogRing *)thread_ring_claim(&log_rings);
+    }
+    return log_self;
+}
+
+// Never waits: a line that does not fit is counted and dropped
+static void ring_push(LogRing *ring, const char *line, size_t length) {
+    size_t tail = atomic_load_explicit(&ring->ring.tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&ring->ring.head, memory_order_acquire);
+    if (LOG_RING_SIZE - (tail - head) < length) {
+        atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+        return;
+    }
+
+    size_t offset = tail & (LOG_RING_SIZE - 1);
+    size_t first = LOG_RING_SIZE - offset < length ? LOG_RING_SIZE - offset : length;
+    memcpy(ring->data + offset, line, first);
+    memcpy(ring->data, line + first, length - first);
+    atomic_store_explicit(&ring->ring.tail, tail + length, memory_order_release);
+}
+
+// ===== Public API =====
+
+void init_logging(const char *log_filename, log_level_t level) {
+    int fd = STDOUT_FILENO;
+    if (log_filename) {
+        fd = open(log_filename, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            fd = STDERR_FILENO;
+        }
+    }
+
+    int old_fd = atomic_exchange(&log_fd, fd);
+    if (old_fd > STDERR_FILENO) {
+        close(old_fd);
+    }
+    atomic_store(&log_level, level);
+}
+
+void log_message_ex(log_level_t level, const char *format, ...) {
+    if (level < LOG_LEVEL_DEBUG || level > LOG_LEVEL_CRITICAL ||
+        level < (log_level_t)atomic_load_explicit(&log_level, memory_order_relaxed)) {
+        return;
+    }
+
+    char line[LOG_LINE_MAX];
+    va_list args;
+    va_start(args, format);
+    size_t length = format_line(line, level, format, args);
+    va_end(args);
+
+    LogRing *ring = atomic_load_explicit(&log_writer_running, memory_order_acquire) ? claim_ring() : NULL;
+    if (ring) {
+        ring_push(ring, line, length);
+    } else {
+        write_all(atomic_load(&log_fd), line, length);
+    }
+}
+
+// Wrapper for compatibility
+void log_message(const char *level, const char *message) {
+    log_level_t log_lvl = LOG_LEVEL_INFO;
+
+    if (strcmp(level, "DEBUG") == 0) log_lvl = LOG_LEVEL_DEBUG;
+    else if (strcmp(level, "WARNING") == 0) log_lvl = LOG_LEVEL_WARNING;
+    else if (strcmp(level, "ERROR") == 0) log_lvl = LOG_LEVEL_ERROR;
+    else if (strcmp(level, "CRITICAL") == 0) log_lvl = LOG_LEVEL_CRITICAL;
+
+    log_message_ex(log_lvl, "%s", message);
+}
+
+uint64_t log_dropped_lines(void) {
+    return atomic_load_explicit(&log_dropped_total, memory_order_relaxed);
+}
+
+// ===== Writer Thread =====
+
+typedef struct {
+    char *data;
+    size_t length;
+} LogBatch;
+
+static void batch_flush(LogBatch *batch) {
+    if (batch->length > 0) {
+        write_all(atomic_load(&log_fd), batch->data, batch->length);
+        batch->length = 0;
+    }
+}
+
+static void batch_append(LogBatch *batch, const char *data, size_t length) {
+    if (LOG_BATCH_SIZE - batch->length < length) {
+        batch_flush(batch);
+    }
+    memcpy(batch->data + batch->length, data, length);
+    batch->length += length;
+}
+
+// Move everything queued into the batch; returns the number of bytes taken.
+// A ring's bytes stay in order even when they span two writes.
+static size_t drain_rings(LogBatch *batch) {
+    size_t total = 0;
+
+    for (ThreadRing *next = thread_ring_first(&log_rings); next; next = next->next) {
+        LogRing *ring = (LogRing *)next;
+        size_t head = atomic_load_explicit(&ring->ring.head, memory_order_relaxed);
+        size_t tail = atomic_load_explicit(&ring->ring.tail, memory_order_acquire);
+
+        while (head != tail) {
+            size_t offset = head & (LOG_RING_SIZE - 1);
+            size_t chunk = tail - head;
+            if (chunk > LOG_RING_SIZE - offset) chunk = LOG_RING_SIZE - offset;
+            if (chunk > LOG_BATCH_SIZE - batch->length) chunk = LOG_BATCH_SIZE - batch->length;
+
+            memcpy(batch->data + batch->length, ring->data + offset, chunk);
+            batch->length += chunk;
+            head += chunk;
+            total += chunk;
+            atomic_store_explicit(&ring->ring.head, head, memory_order_release);
+
+            if (batch->length == LOG_BATCH_SIZE) {
+                batch_flush(batch);
+            }
+        }
+
+        uint64_t dropped = atomic_exchange_explicit(&ring->dropped, 0, memory_order_relaxed);
+        if (dropped > 0) {
+            atomic_fetch_add_explicit(&log_dropped_total, dropped, memory_order_relaxed);
+            char line[128];
+            size_t length = format_line_args(line, LOG_LEVEL_WARNING, "%llu log lines dropped (ring full)",
+                                             (unsigned long long)dropped);
+            batch_append(batch, line, length);
+        }
+    }
+    return total;
+}
+
+// One writer pass: queued lines reach the file before the writer sleeps
+static size_t drain_and_write(void *batch) {
+    size_t drained = drain_rings(batch);
+    batch_flush(batch);
+    return drained;
+}
+
+static void free_batch(void *batch) {
+    free(((LogBatch *)batch)->data);
+    free(batch);
+}
+
+int log_start_writer(void) {
+    if (atomic_load(&log_writer_running)) {
+        return 0;
+    }
+
+    LogBatch *batch = malloc(sizeof(LogBatch));
+    char *data = malloc(LOG_BATCH_SIZE);
+    if (!batch || !data) {
+        free(batch);
+        free(data);
+        return -1;
+    }
+    batch->data = data;
+    batch->length = 0;
+
+    if (ring_writer_start(&log_writer, batch) != 0) {
+        free(data);
+        free(batch);
+        return -1;
+    }
+    atomic_store_explicit(&log_writer_running, 1, memory_order_release);
+    return 0;
+}
+
+void log_flush(void) {
+    if (atomic_load(&log_writer_running)) {
+        ring_writer_flush(&log_writer, LOG_FLUSH_TIMEOUT_MS);
+    }
+}
+
+// Lines logged while the writer stops go straight to the file
+void log_shutdown(void) {
+    if (atomic_exchange(&log_writer_running, 0)) {
+        ring_writer_stop(&log_writer);
+    }
+}
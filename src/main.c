@@ -28,10 +28,18 @@
 #include "optimizer.h"
 #include "cache.h"
 #include "plugin.h"
+#include "rcu.h"
 
 // ===== AI Modules =====
 #include "ai/prompt_router.h"
+#include "metrics.h"
+#include "trace.h"
+#include "access_log.h"
+#include "static_files.h"
+#include "tls.h"
 #include "ai/tokenizer.h"
+#include "ai/prompt_cache.h"
+#include "ai/embeddings.h"
 #include "ai/stats.h"
 
 // ===== Low-level Utils =====
@@ -73,6 +81,9 @@ typedef enum {
     AIONIC_ERROR_AI_ROUTER,
     AIONIC_ERROR_TOKENIZER,
     AIONIC_ERROR_STATS,
+    AIONIC_ERROR_ACCESS_LOG,
+    AIONIC_ERROR_STATIC_FILES,
+    AIONIC_ERROR_TLS,
     AIONIC_ERROR_PLUGIN,
     AIONIC_ERROR_SERVER,
     AIONIC_ERROR_MEMORY,
@@ -112,8 +123,13 @@ typedef struct {
     int firewall_initialized;
     int optimizer_initialized;
     int ai_router_initialized;
+    int embeddings_initialized;
     int tokenizer_initialized;
+    int prompt_cache_initialized;
     int stats_initialized;
+    int access_log_initialized;
+    int static_files_initialized;
+    int tls_initialized;
     int plugin_initialized;
     int server_initialized;
     int server_started;
@@ -142,6 +158,7 @@ typedef struct {
     ConfigPaths config_paths;
     int inotify_fd;
     int config_wd;
+    int plugin_wd;
 } AionicSystem;
 
 // Global variable to control server running state
@@ -155,6 +172,9 @@ static void logger_log(Logger *logger, LogLevel level, const char *format, ...)
     __attribute__((format(printf, 3, 4)));
 static void handle_error(AionicError error);
 static int initialize_components(AionicSystem *system);
+static void apply_model_routing(AionicSystem *system);
+static void apply_prompt_cache_routes(AionicSystem *system);
+static void apply_access_log_samples(AionicSystem *system);
 static void cleanup_components(AionicSystem *system);
 static int thread_pool_init(ThreadPool *pool, int thread_count);
 static void thread_pool_cleanup(ThreadPool *pool);
@@ -164,6 +184,8 @@ static int config_paths_init(ConfigPaths *paths);
 static void config_paths_cleanup(ConfigPaths *paths);
 static int load_hierarchical_config(const char *base_path, Config *config);
 static int setup_inotify(AionicSystem *system, const char *config_path);
+static void setup_plugin_watch(AionicSystem *system);
+static void handle_plugin_event(AionicSystem *system, const struct inotify_event *event);
 static void check_config_reload(AionicSystem *system);
 static void recover_from_error(AionicError error, AionicSystem *system);
 static int safe_file_exists(const char *path);
@@ -284,6 +306,9 @@ static void handle_error(AionicError error) {
         case AIONIC_ERROR_AI_ROUTER: error_str = "AI Router Error"; break;
         case AIONIC_ERROR_TOKENIZER: error_str = "Tokenizer Error"; break;
         case AIONIC_ERROR_STATS: error_str = "Stats Error"; break;
+        case AIONIC_ERROR_ACCESS_LOG: error_str = "Access Log Error"; break;
+        case AIONIC_ERROR_STATIC_FILES: error_str = "Static Files Error"; break;
+        case AIONIC_ERROR_TLS: error_str = "TLS Error"; break;
         case AIONIC_ERROR_PLUGIN: error_str = "Plugin Error"; break;
         case AIONIC_ERROR_SERVER: error_str = "Server Error"; break;
         case AIONIC_ERROR_MEMORY: error_str = "Memory Error"; break;
@@ -312,6 +337,9 @@ static void handle_error(AionicError error) {
  * @return 0 on success, -1 on failure
  */
 static int initialize_components(AionicSystem *system) {
+    // Uptime is measured from here
+    metrics_init();
+    
     // Initialize cache
     if (system->config.enable_cache && cache_init(system->config.cache_size, system->config.cache_ttl) != 0) {
         handle_error(AIONIC_ERROR_CREATE(AIONIC_ERROR_CACHE, "Failed to initialize cache"));
@@ -352,9 +380,18 @@ static int initialize_components(AionicSystem *system) {
         return -1;
     }
     system->state.ai_router_initialized = 1;
+    apply_model_routing(system);
     
     logger_log(&system->logger, LOG_LEVEL_INFO, "AI prompt router initialized");
     
+    // Initialize embedding batcher (sends through the prompt router)
+    if (embeddings_init(system->config.embedding_model ? system->config.embedding_model : "",
+                        system->config.embedding_batch_window_ms, system->config.embedding_batch_size) != 0) {
+        handle_error(AIONIC_ERROR_CREATE(AIONIC_ERROR_AI_ROUTER, "Failed to initialize embedding batcher"));
+        return -1;
+    }
+    system->state.embeddings_initialized = 1;
+    
     // Initialize tokenizer
     if (tokenizer_init() != 0) {
         handle_error(AIONIC_ERROR_CREATE(AIONIC_ERROR_TOKENIZER, "Failed to initialize tokenizer"));
@@ -362,10 +399,28 @@ static int initialize_components(AionicSystem *system) {
     }
     system->state.tokenizer_initialized = 1;
     
+    // Without a vocabulary, prompts are not counted and completions are not clamped
+    if (system->config.tokenizer_vocab && tokenizer_load_vocab(system->config.tokenizer_vocab) != 0) {
+        handle_error(AIONIC_ERROR_CREATE(AIONIC_ERROR_TOKENIZER, "Failed to load tokenizer vocabulary"));
+        return -1;
+    }
+    
     logger_log(&system->logger, LOG_LEVEL_INFO, "Tokenizer initialized");
     
-    // Initialize stats collector
-    if (stats_init("stats.json", 300) != 0) {
+    // Initialize near-duplicate prompt cache (builds on the tokenizer)
+    if (system->config.enable_cache && system->config.prompt_cache_size > 0) {
+        if (prompt_cache_init(system->config.prompt_cache_size, system->config.prompt_cache_ttl,
+                              system->config.prompt_cache_threshold, system->config.prompt_cache_verify) != 0) {
+            handle_error(AIONIC_ERROR_CREATE(AIONIC_ERROR_CACHE, "Failed to initialize prompt cache"));
+            return -1;
+        }
+        system->state.prompt_cache_initialized = 1;
+        apply_prompt_cache_routes(system);
+    }
+    
+    // Initialize stats collector; snapshots are written by its own thread
+    if (stats_init(system->config.stats_file, system->config.stats_json_file,
+                   system->config.stats_save_interval) != 0) {
         handle_error(AIONIC_ERROR_CREATE(AIONIC_ERROR_STATS, "Failed to initialize stats collector"));
         return -1;
     }
@@ -373,6 +428,38 @@ static int initialize_components(AionicSystem *system) {
     
     logger_log(&system->logger, LOG_LEVEL_INFO, "Stats collector initialized");
     
+    // Phase timings feed the stats histograms, so tracing starts after them
+    trace_set_enabled(system->config.trace_enabled);
+    
+    // Access log segments are written by their own thread
+    if (system->config.access_log) {
+        apply_access_log_samples(system);
+        if (access_log_init(system->config.access_log,
+                            (size_t)system->config.access_log_segment_mb * 1024 * 1024) != 0) {
+            handle_error(AIONIC_ERROR_CREATE(AIONIC_ERROR_ACCESS_LOG, "Failed to open access log"));
+            return -1;
+        }
+        system->state.access_log_initialized = 1;
+    }
+    
+    // GET /static/ serves files below static_root
+    if (system->config.static_root) {
+        if (static_files_init(system->config.static_root, system->config.static_cache_entries) != 0) {
+            handle_error(AIONIC_ERROR_CREATE(AIONIC_ERROR_STATIC_FILES, "Failed to open static root"));
+            return -1;
+        }
+        system->state.static_files_initialized = 1;
+    }
+    
+    // Certificates are read before privileges are dropped
+    if (system->config.tls_cert && system->config.tls_key) {
+        if (tls_init(system->config.tls_cert, system->config.tls_key, system->config.tls_ktls) != 0) {
+            handle_error(AIONIC_ERROR_CREATE(AIONIC_ERROR_TLS, "Failed to load TLS certificate"));
+            return -1;
+        }
+        system->state.tls_initialized = 1;
+    }
+    
     // Initialize plugin system
     if (plugin_init("plugins") != 0) {
         handle_error(AIONIC_ERROR_CREATE(AIONIC_ERROR_PLUGIN, "Failed to initialize plugin system"));
@@ -402,6 +489,89 @@ static int initialize_components(AionicSystem *system) {
     return 0;
 }
 
+// Split a "<first> <second>" config value in place; returns the second word
+static char *split_config_pair(char *entry) {
+    char *second = strchr(entry, ' ');
+    if (!second) return NULL;
+    
+    *second++ = '\0';
+    while (*second == ' ') second++;
+    return *second ? second : NULL;
+}
+
+// Apply the model_replica, model_fallback, model_context, hedging, breaker and timeout settings
+static void apply_model_routing(AionicSystem *system) {
+    char entry[512];
+    
+    for (int i = 0; i < system->config.model_replica_count; i++) {
+        snprintf(entry, sizeof(entry), "%s", system->config.model_replicas[i]);
+        char *endpoint = split_config_pair(entry);
+        if (!endpoint || prompt_router_add_replica(entry, endpoint) != 0) {
+            logger_log(&system->logger, LOG_LEVEL_WARNING,
+                       "Ignoring model_replica entry: %s", system->config.model_replicas[i]);
+        }
+    }
+    
+    for (int i = 0; i < system->config.model_fallback_count; i++) {
+        snprintf(entry, sizeof(entry), "%s", system->config.model_fallbacks[i]);
+        char *fallback = split_config_pair(entry);
+        if (!fallback || prompt_router_set_fallback(entry, fallback) != 0) {
+            logger_log(&system->logger, LOG_LEVEL_WARNING,
+                       "Ignoring model_fallback entry: %s", system->config.model_fallbacks[i]);
+        }
+    }
+    
+    for (int i = 0; i < system->config.model_context_count; i++) {
+        snprintf(entry, sizeof(entry), "%s", system->config.model_contexts[i]);
+        char *context = split_config_pair(entry);
+        if (!context || prompt_router_set_context(entry, atoi(context)) != 0) {
+            logger_log(&system->logger, LOG_LEVEL_WARNING,
+                       "Ignoring model_context entry: %s", system->config.model_contexts[i]);
+        }
+    }
+    
+    if (prompt_router_set_hedging(NULL, system->config.hedge_percentile, system->config.hedge_budget) != 0) {
+        logger_log(&system->logger, LOG_LEVEL_WARNING, "Invalid hedge_percentile/hedge_budget, keeping defaults");
+    }
+    
+    if (prompt_router_set_breaker(NULL, system->config.breaker_failure_rate, system->config.breaker_slow_ms,
+                                  system->config.breaker_open_ms) != 0) {
+        logger_log(&system->logger, LOG_LEVEL_WARNING, "Invalid breaker settings, keeping defaults");
+    }
+    
+    if (prompt_router_set_request_timeout(system->config.request_timeout) != 0) {
+        logger_log(&system->logger, LOG_LEVEL_WARNING, "Invalid request_timeout, keeping the default");
+    }
+}
+
+// Per-route similarity thresholds, "prompt_cache_route = <route> <threshold>"
+static void apply_prompt_cache_routes(AionicSystem *system) {
+    char entry[512];
+    
+    for (int i = 0; i < system->config.prompt_cache_route_count; i++) {
+        snprintf(entry, sizeof(entry), "%s", system->config.prompt_cache_routes[i]);
+        char *threshold = split_config_pair(entry);
+        if (!threshold || prompt_cache_set_threshold(entry, atof(threshold)) != 0) {
+            logger_log(&system->logger, LOG_LEVEL_WARNING,
+                       "Ignoring prompt_cache_route entry: %s", system->config.prompt_cache_routes[i]);
+        }
+    }
+}
+
+// Per-route sample rates, "access_log_sample = <route> <rate>"
+static void apply_access_log_samples(AionicSystem *system) {
+    char entry[512];
+    
+    for (int i = 0; i < system->config.access_log_sample_count; i++) {
+        snprintf(entry, sizeof(entry), "%s", system->config.access_log_samples[i]);
+        char *rate = split_config_pair(entry);
+        if (!rate || access_log_set_sample_rate(entry, atof(rate)) != 0) {
+            logger_log(&system->logger, LOG_LEVEL_WARNING,
+                       "Ignoring access_log_sample entry: %s", system->config.access_log_samples[i]);
+        }
+    }
+}
+
 /**
  * @brief Clean up all system components
  * 
@@ -420,19 +590,45 @@ static void cleanup_components(AionicSystem *system) {
     
     if (system->state.plugin_initialized) {
         plugin_cleanup();
+        pipeline_cleanup();
         system->state.plugin_initialized = 0;
     }
     
+    if (system->state.tls_initialized) {
+        tls_cleanup();
+        system->state.tls_initialized = 0;
+    }
+    
+    if (system->state.static_files_initialized) {
+        static_files_cleanup();
+        system->state.static_files_initialized = 0;
+    }
+    
+    if (system->state.access_log_initialized) {
+        access_log_cleanup();
+        system->state.access_log_initialized = 0;
+    }
+    
     if (system->state.stats_initialized) {
         stats_cleanup();
         system->state.stats_initialized = 0;
     }
     
+    if (system->state.prompt_cache_initialized) {
+        prompt_cache_cleanup();
+        system->state.prompt_cache_initialized = 0;
+    }
+    
     if (system->state.tokenizer_initialized) {
         tokenizer_cleanup();
         system->state.tokenizer_initialized = 0;
     }
     
+    if (system->state.embeddings_initialized) {
+        embeddings_cleanup();
+        system->state.embeddings_initialized = 0;
+    }
+    
     if (system->state.ai_router_initialized) {
         prompt_router_cleanup();
         system->state.ai_router_initialized = 0;
@@ -674,17 +870,80 @@ static int setup_inotify(AionicSystem *system, const char *config_path) {
 }
 
 /**
- * @brief Check for configuration file changes and reload if necessary
+ * @brief Watch the plugin directory so that plugins can be hot reloaded
+ * 
+ * Only completed writes and renames into the directory are reported, so a
+ * plugin is never loaded while it is still being copied.
+ * 
+ * @param system Pointer to the AIONIC system structure
+ */
+static void setup_plugin_watch(AionicSystem *system) {
+    const char *plugin_dir = plugin_get_dir();
+    if (system->inotify_fd == -1 || !plugin_dir) return;
+    
+    system->plugin_wd = inotify_add_watch(system->inotify_fd, plugin_dir,
+                                          IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE | IN_MOVED_FROM);
+    if (system->plugin_wd == -1) {
+        logger_log(&system->logger, LOG_LEVEL_WARNING, "Plugin hot reload disabled: cannot watch %s", plugin_dir);
+        return;
+    }
+    
+    logger_log(&system->logger, LOG_LEVEL_DEBUG, "Inotify set up for plugin directory: %s", plugin_dir);
+}
+
+/**
+ * @brief Load, replace or unload a plugin after a change in the plugin directory
+ * 
+ * @param system Pointer to the AIONIC system structure
+ * @param event Inotify event for the plugin directory
+ */
+static void handle_plugin_event(AionicSystem *system, const struct inotify_event *event) {
+    if (event->len == 0) return;
+    
+    size_t name_len = strlen(event->name);
+    if (name_len <= 3 || strcmp(event->name + name_len - 3, ".so") != 0) return;
+    
+    if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+        char plugin_name[NAME_MAX + 1];
+        snprintf(plugin_name, sizeof(plugin_name), "%.*s", (int)(name_len - 3), event->name);
+        if (plugin_unload(plugin_name) == 0) {
+            logger_log(&system->logger, LOG_LEVEL_INFO, "Plugin removed: %s", plugin_name);
+        }
+        return;
+    }
+    
+    char plugin_path[PATH_MAX];
+    snprintf(plugin_path, sizeof(plugin_path), "%s/%s", plugin_get_dir(), event->name);
+    if (plugin_load(plugin_path) != 0) {
+        logger_log(&system->logger, LOG_LEVEL_ERROR, "Failed to load plugin %s, keeping the running version", plugin_path);
+    }
+}
+
+/**
+ * @brief Check for configuration file and plugin changes and reload if necessary
  * 
  * @param system Pointer to the AIONIC system structure
  */
 static void check_config_reload(AionicSystem *system) {
     if (system->inotify_fd == -1) return;
     
-    char buffer[CONFIG_WATCH_BUFFER_SIZE];
+    char buffer[CONFIG_WATCH_BUFFER_SIZE] __attribute__((aligned(__alignof__(struct inotify_event))));
     ssize_t length = read(system->inotify_fd, buffer, sizeof(buffer));
+    int config_changed = 0;
     
-    if (length > 0) {
+    for (char *ptr = buffer; length > 0 && ptr < buffer + length; ) {
+        const struct inotify_event *event = (const struct inotify_event *)ptr;
+        
+        if (event->wd == system->plugin_wd) {
+            handle_plugin_event(system, event);
+        } else if (event->wd == system->config_wd) {
+            config_changed = 1;
+        }
+        
+        ptr += sizeof(struct inotify_event) + event->len;
+    }
+    
+    if (config_changed) {
         logger_log(&system->logger, LOG_LEVEL_INFO, "Configuration file modified, reloading...");
         
 
@@ -742,6 +1001,7 @@ int main(int argc, char *argv[]) {
     // Initialize AIONIC system
     AionicSystem system = {0};
     system.inotify_fd = -1;
+    system.plugin_wd = -1;
     
     // Print version information
     print_version_info();
@@ -830,6 +1090,9 @@ int main(int argc, char *argv[]) {
         return 1;
     }
     
+    // Watch the plugin directory for hot reload
+    setup_plugin_watch(&system);
+    
     // Drop privileges if running as root
     drop_privileges();
     
@@ -845,16 +1108,13 @@ int main(int argc, char *argv[]) {
             optimizer_run(&system.server);
         }
         
-        stats_auto_save();
-        
-        // Check for configuration changes
+        // Check for configuration and plugin changes
         check_config_reload(&system);
         
-        // Use nanosleep instead of usleep
-        struct timespec ts;
-        ts.tv_sec = 0;
-        ts.tv_nsec = 100000000; 
-        nanosleep(&ts, NULL);
+        // Close plugin versions and free snapshots no worker can still see
+        rcu_reclaim();
+        
+        // server_process_events() paced the loop, waiting up to 100 ms for connections
     }
     
     printf("\n🛑 Shutting down AIONIC Server...\n");
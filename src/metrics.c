@@ -0,0 +1,552 @@
+#define _POSIX_C_SOURCE 200809L
+
+// ===== Standard Library Headers =====
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <time.h>
+
+// ===== Project Headers =====
+#include "metrics.h"
+#include "cache.h"
+#include "firewall.h"
+#include "optimizer.h"
+#include "pipeline.h"
+#include "utils.h"
+#include "access_log.h"
+#include "static_files.h"
+#include "tls.h"
+#include "ai/prompt_router.h"
+#include "ai/prompt_cache.h"
+#include "ai/embeddings.h"
+#include "ai/stats.h"
+
+#define METRICS_SHARED_SLOT METRICS_MAX_WORKERS     // Threads that are not workers
+#define METRICS_MAX_MODELS 32
+#define METRICS_MAX_REPLICAS 32
+#define METRICS_MAX_HOOKS 32
+#define METRICS_MAX_SERIES 128
+
+// One cache line per worker; only the owning worker writes it
+typedef struct {
+    _Atomic uint64_t requests;
+    _Atomic uint64_t responses[5];
+    _Atomic uint64_t rejected;
+    _Atomic uint64_t bytes_received;
+    _Atomic uint64_t bytes_sent;
+} __attribute__((aligned(64))) WorkerCounters;
+
+// ===== Global Variables =====
+static WorkerCounters metrics_workers[METRICS_MAX_WORKERS + 1];
+static _Atomic int metrics_worker_limit = 0;    // Highest worker index bound + 1
+static _Atomic uint64_t metrics_accepted = 0;   // Only the accept loop writes it
+static _Atomic int64_t metrics_start_time = 0;
+static _Thread_local WorkerCounters *metrics_self = NULL;
+
+// Histogram buckets for latency, in milliseconds
+static const double latency_bounds_ms[] = {
+    1, 2.5, 5, 10, 25, 50, 100, 250, 500, 1000, 2500, 5000, 10000, 30000, 60000
+};
+#define LATENCY_BOUND_COUNT (int)(sizeof(latency_bounds_ms) / sizeof(latency_bounds_ms[0]))
+
+// ===== Recording =====
+
+void metrics_init(void) {
+    atomic_store(&metrics_start_time, (int64_t)time(NULL));
+}
+
+void metrics_bind_worker(int worker_id) {
+    if (worker_id < 0 || worker_id >= METRICS_MAX_WORKERS) {
+        metrics_self = NULL;
+        return;
+    }
+
+    metrics_self = &metrics_workers[worker_id];
+    int limit = atomic_load(&metrics_worker_limit);
+    while (limit < worker_id + 1 && !atomic_compare_exchange_weak(&metrics_worker_limit, &limit, worker_id + 1)) {
+    }
+}
+
+static void counter_add(_Atomic uint64_t *counter, uint64_t n) {
+    if (metrics_self) {
+        // Single writer: a plain load and store, no locked instruction
+        atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + n,
+                              memory_order_relaxed);
+    } else {
+        atomic_fetch_add_explicit(counter, n, memory_order_relaxed);
+    }
+}
+
+static WorkerCounters *self_counters(void) {
+    return metrics_self ? metrics_self : &metrics_workers[METRICS_SHARED_SLOT];
+}
+
+void metrics_count_accept(void) {
+    atomic_fetch_add_explicit(&metrics_accepted, 1, memory_order_relaxed);
+}
+
+void metrics_count_read(size_t bytes) {
+    counter_add(&self_counters()->bytes_received, bytes);
+}
+
+void metrics_count_request(void) {
+    counter_add(&self_counters()->requests, 1);
+}
+
+void metrics_count_response(int status_code, size_t bytes) {
+    WorkerCounters *counters = self_counters();
+    int status_class = status_code / 100 - 1;
+    if (status_class < 0 || status_class > 4) status_class = 4;
+    counter_add(&counters->responses[status_class], 1);
+    counter_add(&counters->bytes_sent, bytes);
+}
+
+void metrics_count_rejected(void) {
+    counter_add(&self_counters()->rejected, 1);
+}
+
+// ===== Reading =====
+
+static void read_counters(const WorkerCounters *counters, WorkerMetricsInfo *out) {
+    out->requests = atomic_load_explicit(&counters->requests, memory_order_relaxed);
+    for (int c = 0; c < 5; c++) {
+        out->responses[c] = atomic_load_explicit(&counters->responses[c], memory_order_relaxed);
+    }
+    out->rejected = atomic_load_explicit(&counters->rejected, memory_order_relaxed);
+    out->bytes_received = atomic_load_explicit(&counters->bytes_received, memory_order_relaxed);
+    out->bytes_sent = atomic_load_explicit(&counters->bytes_sent, memory_order_relaxed);
+}
+
+int metrics_get_workers(WorkerMetricsInfo *out, int max) {
+    int limit = atomic_load(&metrics_worker_limit);
+    for (int i = 0; out && i < limit && i < max; i++) {
+        read_counters(&metrics_workers[i], &out[i]);
+    }
+    return limit;
+}
+
+void metrics_get_totals(WorkerMetricsInfo *out) {
+    if (!out) return;
+    memset(out, 0, sizeof(*out));
+
+    int limit = atomic_load(&metrics_worker_limit);
+    for (int i = 0; i <= METRICS_SHARED_SLOT; i++) {
+        if (i == limit) i = METRICS_SHARED_SLOT;
+
+        WorkerMetricsInfo worker;
+        read_counters(&metrics_workers[i], &worker);
+        out->requests += worker.requests;
+        for (int c = 0; c < 5; c++) {
+            out->responses[c] += worker.responses[c];
+        }
+        out->rejected += worker.rejected;
+        out->bytes_received += worker.bytes_received;
+        out->bytes_sent += worker.bytes_sent;
+    }
+}
+
+uint64_t metrics_uptime_seconds(void) {
+    int64_t start = atomic_load(&metrics_start_time);
+    int64_t now = (int64_t)time(NULL);
+    return start && now > start ? (uint64_t)(now - start) : 0;
+}
+
+// ===== OpenMetrics Text =====
+
+typedef struct {
+    const char *key;
+    const char *value;
+} MetricLabel;
+
+static void write_family(JsonWriter *w, const char *name, const char *type, const char *help) {
+    json_write_cstr(w, "# TYPE ");
+    json_write_cstr(w, name);
+    json_write_cstr(w, " ");
+    json_write_cstr(w, type);
+    json_write_cstr(w, "\n# HELP ");
+    json_write_cstr(w, name);
+    json_write_cstr(w, " ");
+    json_write_cstr(w, help);
+    json_write_cstr(w, "\n");
+}
+
+// Label values escape backslash, double quote and newline
+static void write_label_value(JsonWriter *w, const char *value) {
+    const char *run = value;
+    for (const char *p = value; *p; p++) {
+        if (*p != '\\' && *p != '"' && *p != '\n') continue;
+        json_write_raw(w, run, (size_t)(p - run));
+        json_write_cstr(w, *p == '\n' ? "\\n" : *p == '"' ? "\\\"" : "\\\\");
+        run = p + 1;
+    }
+    json_write_cstr(w, run);
+}
+
+static void write_sample_head(JsonWriter *w, const char *name, const char *suffix,
+                              const MetricLabel *labels, int label_count) {
+    json_write_cstr(w, name);
+    json_write_cstr(w, suffix);
+    for (int i = 0; i < label_count; i++) {
+        json_write_cstr(w, i ? "," : "{");
+        json_write_cstr(w, labels[i].key);
+        json_write_cstr(w, "=\"");
+        write_label_value(w, labels[i].value);
+        json_write_cstr(w, "\"");
+    }
+    json_write_cstr(w, label_count ? "} " : " ");
+}
+
+static void write_u64(JsonWriter *w, const char *name, const char *suffix,
+                      const MetricLabel *labels, int label_count, uint64_t value) {
+    write_sample_head(w, name, suffix, labels, label_count);
+    char digits[24];
+    int n = snprintf(digits, sizeof(digits), "%llu\n", (unsigned long long)value);
+    json_write_raw(w, digits, (size_t)n);
+}
+
+static void write_double(JsonWriter *w, const char *name, const char *suffix,
+                         const MetricLabel *labels, int label_count, double value) {
+    write_sample_head(w, name, suffix, labels, label_count);
+    json_write_double(w, value);
+    json_write_cstr(w, "\n");
+}
+
+// Latency histogram of one model or route, in seconds
+static void write_histogram(JsonWriter *w, const char *name, StatsScope scope, const char *series,
+                            StatsMetric metric, const char *label_key) {
+    uint64_t cumulative[LATENCY_BOUND_COUNT];
+    uint64_t count;
+    double sum_ms;
+    if (stats_get_histogram(scope, series, metric, latency_bounds_ms, LATENCY_BOUND_COUNT,
+                            cumulative, &count, &sum_ms) != 0 || count == 0) {
+        return;
+    }
+
+    char bound[32];
+    MetricLabel labels[2] = {{label_key, series}, {"le", bound}};
+    for (int i = 0; i < LATENCY_BOUND_COUNT; i++) {
+        snprintf(bound, sizeof(bound), "%g", latency_bounds_ms[i] / 1000.0);
+        write_u64(w, name, "_bucket", labels, 2, cumulative[i]);
+    }
+    snprintf(bound, sizeof(bound), "+Inf");
+    write_u64(w, name, "_bucket", labels, 2, count);
+    write_u64(w, name, "_count", labels, 1, count);
+    write_double(w, name, "_sum", labels, 1, sum_ms / 1000.0);
+}
+
+static void render_server(const Server *server, JsonWriter *w) {
+    write_family(w, "aionic_start_time_seconds", "gauge", "Unix time the server started.");
+    write_u64(w, "aionic_start_time_seconds", "", NULL, 0, (uint64_t)atomic_load(&metrics_start_time));
+    write_family(w, "aionic_uptime_seconds", "gauge", "Seconds since the server started.");
+    write_u64(w, "aionic_uptime_seconds", "", NULL, 0, metrics_uptime_seconds());
+    write_family(w, "aionic_connections_active", "gauge", "Open client connections.");
+    write_u64(w, "aionic_connections_active", "", NULL, 0, server ? (uint64_t)server->active_connections : 0);
+    write_family(w, "aionic_connections_accepted", "counter", "Client connections accepted.");
+    write_u64(w, "aionic_connections_accepted", "_total", NULL, 0,
+              atomic_load_explicit(&metrics_accepted, memory_order_relaxed));
+    write_family(w, "aionic_worker_threads", "gauge", "Worker threads serving connections.");
+    write_u64(w, "aionic_worker_threads", "", NULL, 0, server ? (uint64_t)server->thread_count : 0);
+    write_family(w, "aionic_log_lines_dropped", "counter", "Log lines dropped because a thread's log ring was full.");
+    write_u64(w, "aionic_log_lines_dropped", "_total", NULL, 0, log_dropped_lines());
+
+    uint64_t access_written, access_dropped;
+    access_log_get_counts(&access_written, &access_dropped);
+    write_family(w, "aionic_access_log_records", "counter", "Access records written to log segments.");
+    write_u64(w, "aionic_access_log_records", "_total", NULL, 0, access_written);
+    write_family(w, "aionic_access_log_records_dropped", "counter",
+                 "Access records dropped because a thread's ring was full or no segment could be opened.");
+    write_u64(w, "aionic_access_log_records_dropped", "_total", NULL, 0, access_dropped);
+
+    uint64_t static_hits, static_misses;
+    static_files_get_counts(&static_hits, &static_misses);
+    write_family(w, "aionic_static_file_cache_hits", "counter", "Static file lookups answered by the open-file cache.");
+    write_u64(w, "aionic_static_file_cache_hits", "_total", NULL, 0, static_hits);
+    write_family(w, "aionic_static_file_cache_misses", "counter", "Static file lookups that opened the file.");
+    write_u64(w, "aionic_static_file_cache_misses", "_total", NULL, 0, static_misses);
+
+    uint64_t tls_handshakes, tls_resumed, tls_offloaded;
+    tls_get_counts(&tls_handshakes, &tls_resumed, &tls_offloaded);
+    write_family(w, "aionic_tls_handshakes", "counter", "Completed TLS handshakes.");
+    write_u64(w, "aionic_tls_handshakes", "_total", NULL, 0, tls_handshakes);
+    write_family(w, "aionic_tls_resumed_handshakes", "counter", "TLS handshakes that resumed a session from a ticket or the cache.");
+    write_u64(w, "aionic_tls_resumed_handshakes", "_total", NULL, 0, tls_resumed);
+    write_family(w, "aionic_tls_ktls_send", "counter", "TLS connections whose record encryption was handed to the kernel.");
+    write_u64(w, "aionic_tls_ktls_send", "_total", NULL, 0, tls_offloaded);
+}
+
+static void render_workers(JsonWriter *w) {
+    WorkerMetricsInfo workers[METRICS_MAX_WORKERS + 1];
+    int count = metrics_get_workers(workers, METRICS_MAX_WORKERS);
+    read_counters(&metrics_workers[METRICS_SHARED_SLOT], &workers[count]);
+
+    static const char *const classes[5] = {"1xx", "2xx", "3xx", "4xx", "5xx"};
+    char ids[METRICS_MAX_WORKERS + 1][12];
+    for (int i = 0; i <= count; i++) {
+        if (i < count) {
+            snprintf(ids[i], sizeof(ids[i]), "%d", i);
+        } else {
+            snprintf(ids[i], sizeof(ids[i]), "other");
+        }
+    }
+
+    write_family(w, "aionic_requests", "counter", "Requests parsed, by worker thread.");
+    for (int i = 0; i <= count; i++) {
+        MetricLabel labels[1] = {{"worker", ids[i]}};
+        write_u64(w, "aionic_requests", "_total", labels, 1, workers[i].requests);
+    }
+    write_family(w, "aionic_responses", "counter", "Responses sent, by worker thread and status class.");
+    for (int i = 0; i <= count; i++) {
+        for (int c = 0; c < 5; c++) {
+            MetricLabel labels[2] = {{"worker", ids[i]}, {"code", classes[c]}};
+            write_u64(w, "aionic_responses", "_total", labels, 2, workers[i].responses[c]);
+        }
+    }
+    write_family(w, "aionic_requests_rejected", "counter",
+                 "Requests refused before routing: unparsable, or blocked by a hook or the firewall.");
+    for (int i = 0; i <= count; i++) {
+        MetricLabel labels[1] = {{"worker", ids[i]}};
+        write_u64(w, "aionic_requests_rejected", "_total", labels, 1, workers[i].rejected);
+    }
+    write_family(w, "aionic_received_bytes", "counter", "Bytes read from clients.");
+    for (int i = 0; i <= count; i++) {
+        MetricLabel labels[1] = {{"worker", ids[i]}};
+        write_u64(w, "aionic_received_bytes", "_total", labels, 1, workers[i].bytes_received);
+    }
+    write_family(w, "aionic_sent_bytes", "counter", "Response bytes written to clients.");
+    for (int i = 0; i <= count; i++) {
+        MetricLabel labels[1] = {{"worker", ids[i]}};
+        write_u64(w, "aionic_sent_bytes", "_total", labels, 1, workers[i].bytes_sent);
+    }
+}
+
+static void render_hooks(JsonWriter *w) {
+    HookStatsInfo hooks[METRICS_MAX_HOOKS];
+    int count = pipeline_get_stats(hooks, METRICS_MAX_HOOKS);
+    if (count > METRICS_MAX_HOOKS) count = METRICS_MAX_HOOKS;
+
+    write_family(w, "aionic_hook_calls", "counter", "Pipeline hook invocations.");
+    for (int i = 0; i < count; i++) {
+        MetricLabel labels[2] = {{"owner", hooks[i].owner}, {"phase", pipeline_phase_name(hooks[i].phase)}};
+        write_u64(w, "aionic_hook_calls", "_total", labels, 2, hooks[i].calls);
+    }
+    write_family(w, "aionic_hook_errors", "counter", "Pipeline hook invocations that returned an error.");
+    for (int i = 0; i < count; i++) {
+        MetricLabel labels[2] = {{"owner", hooks[i].owner}, {"phase", pipeline_phase_name(hooks[i].phase)}};
+        write_u64(w, "aionic_hook_errors", "_total", labels, 2, hooks[i].errors);
+    }
+    write_family(w, "aionic_hook_duration_seconds", "counter", "Time spent in pipeline hooks.");
+    for (int i = 0; i < count; i++) {
+        MetricLabel labels[2] = {{"owner", hooks[i].owner}, {"phase", pipeline_phase_name(hooks[i].phase)}};
+        write_double(w, "aionic_hook_duration_seconds", "_total", labels, 2, (double)hooks[i].total_ns / 1e9);
+    }
+}
+
+static void render_caches(JsonWriter *w) {
+    int entries = 0, hits = 0, misses = 0;
+    cache_get_stats(&entries, &hits, &misses);
+    write_family(w, "aionic_cache_entries", "gauge", "Entries in the response cache.");
+    write_u64(w, "aionic_cache_entries", "", NULL, 0, (uint64_t)entries);
+    write_family(w, "aionic_cache_hits", "counter", "Response cache hits.");
+    write_u64(w, "aionic_cache_hits", "_total", NULL, 0, (uint64_t)hits);
+    write_family(w, "aionic_cache_misses", "counter", "Response cache misses.");
+    write_u64(w, "aionic_cache_misses", "_total", NULL, 0, (uint64_t)misses);
+
+    PromptCacheStats prompt;
+    prompt_cache_get_stats(&prompt);
+    write_family(w, "aionic_prompt_cache_entries", "gauge", "Entries in the near-duplicate prompt cache.");
+    write_u64(w, "aionic_prompt_cache_entries", "", NULL, 0, prompt.entries);
+    write_family(w, "aionic_prompt_cache_lookups", "counter", "Prompt cache lookups.");
+    write_u64(w, "aionic_prompt_cache_lookups", "_total", NULL, 0, prompt.lookups);
+    write_family(w, "aionic_prompt_cache_hits", "counter", "Prompt cache hits.");
+    write_u64(w, "aionic_prompt_cache_hits", "_total", NULL, 0, prompt.hits);
+    write_family(w, "aionic_prompt_cache_evictions", "counter", "Prompt cache evictions.");
+    write_u64(w, "aionic_prompt_cache_evictions", "_total", NULL, 0, prompt.evictions);
+    write_family(w, "aionic_prompt_cache_false_matches", "counter",
+                 "Sampled prompt cache hits whose exact similarity was below the threshold.");
+    write_u64(w, "aionic_prompt_cache_false_matches", "_total", NULL, 0, prompt.false_matches);
+
+    EmbeddingStats embeddings;
+    embeddings_get_stats(&embeddings);
+    write_family(w, "aionic_embedding_inputs", "counter", "Inputs received on /v1/embeddings.");
+    write_u64(w, "aionic_embedding_inputs", "_total", NULL, 0, embeddings.inputs);
+    write_family(w, "aionic_embedding_batches", "counter", "Upstream embedding calls.");
+    write_u64(w, "aionic_embedding_batches", "_total", NULL, 0, embeddings.batches);
+    write_family(w, "aionic_embedding_batches_failed", "counter", "Upstream embedding calls that failed.");
+    write_u64(w, "aionic_embedding_batches_failed", "_total", NULL, 0, embeddings.failed_batches);
+}
+
+static void render_firewall(JsonWriter *w) {
+    FirewallStats stats;
+    memset(&stats, 0, sizeof(stats));
+    firewall_get_stats(&stats);
+
+    write_family(w, "aionic_firewall_requests", "counter", "Requests checked by the firewall.");
+    write_u64(w, "aionic_firewall_requests", "_total", NULL, 0, stats.total_requests);
+    write_family(w, "aionic_firewall_blocked", "counter", "Requests blocked by the firewall, by reason.");
+    MetricLabel reason[1] = {{"reason", "rate_limit"}};
+    write_u64(w, "aionic_firewall_blocked", "_total", reason, 1, stats.blocked_requests);
+    reason[0].value = "brute_force";
+    write_u64(w, "aionic_firewall_blocked", "_total", reason, 1, stats.brute_force_attempts);
+    reason[0].value = "invalid_api_key";
+    write_u64(w, "aionic_firewall_blocked", "_total", reason, 1, stats.invalid_api_keys);
+    reason[0].value = "attack_pattern";
+    write_u64(w, "aionic_firewall_blocked", "_total", reason, 1, stats.attack_pattern_hits);
+    write_family(w, "aionic_firewall_suspicious", "counter", "Suspicious activities detected.");
+    write_u64(w, "aionic_firewall_suspicious", "_total", NULL, 0, stats.suspicious_activities);
+    write_family(w, "aionic_firewall_tracked_ips", "gauge", "Client addresses tracked by the rate limiter.");
+    write_u64(w, "aionic_firewall_tracked_ips", "", NULL, 0, (uint64_t)stats.active_entries);
+    write_family(w, "aionic_firewall_whitelisted_ips", "gauge", "Whitelisted addresses.");
+    write_u64(w, "aionic_firewall_whitelisted_ips", "", NULL, 0, (uint64_t)stats.whitelisted_ips);
+    write_family(w, "aionic_firewall_blacklisted_ips", "gauge", "Blacklisted addresses.");
+    write_u64(w, "aionic_firewall_blacklisted_ips", "", NULL, 0, (uint64_t)stats.blacklisted_ips);
+}
+
+static void render_models(JsonWriter *w) {
+    ModelRouteInfo models[METRICS_MAX_MODELS];
+    int model_count = prompt_router_get_model_stats(models, METRICS_MAX_MODELS);
+    if (model_count > METRICS_MAX_MODELS) model_count = METRICS_MAX_MODELS;
+
+    write_family(w, "aionic_model_available", "gauge", "Whether the model is enabled.");
+    for (int i = 0; i < model_count; i++) {
+        MetricLabel labels[1] = {{"model", models[i].name}};
+        write_u64(w, "aionic_model_available", "", labels, 1, models[i].available ? 1 : 0);
+    }
+    write_family(w, "aionic_model_breaker_state", "gauge", "Circuit breaker state of the model (1 for the current state).");
+    static const char *const states[3] = {"closed", "open", "half_open"};
+    for (int i = 0; i < model_count; i++) {
+        for (int s = 0; s < 3; s++) {
+            MetricLabel labels[2] = {{"model", models[i].name}, {"state", states[s]}};
+            write_u64(w, "aionic_model_breaker_state", "", labels, 2, strcmp(models[i].breaker, states[s]) == 0);
+        }
+    }
+    write_family(w, "aionic_model_hedge_delay_seconds", "gauge", "Time after which a request to the model is hedged.");
+    for (int i = 0; i < model_count; i++) {
+        MetricLabel labels[1] = {{"model", models[i].name}};
+        write_double(w, "aionic_model_hedge_delay_seconds", "", labels, 1, models[i].hedge_delay_ms / 1000.0);
+    }
+
+    ReplicaStatsInfo replicas[METRICS_MAX_REPLICAS];
+    int replica_count = prompt_router_get_replica_stats(replicas, METRICS_MAX_REPLICAS);
+    if (replica_count > METRICS_MAX_REPLICAS) replica_count = METRICS_MAX_REPLICAS;
+
+    write_family(w, "aionic_upstream_latency_ewma_seconds", "gauge", "Decayed latency estimate of the upstream endpoint.");
+    for (int i = 0; i < replica_count; i++) {
+        MetricLabel labels[2] = {{"model", replicas[i].model}, {"endpoint", replicas[i].endpoint}};
+        write_double(w, "aionic_upstream_latency_ewma_seconds", "", labels, 2, replicas[i].ewma_ms / 1000.0);
+    }
+    write_family(w, "aionic_upstream_inflight", "gauge", "Requests outstanding at the upstream endpoint.");
+    for (int i = 0; i < replica_count; i++) {
+        MetricLabel labels[2] = {{"model", replicas[i].model}, {"endpoint", replicas[i].endpoint}};
+        write_u64(w, "aionic_upstream_inflight", "", labels, 2, (uint64_t)replicas[i].inflight);
+    }
+    write_family(w, "aionic_upstream_ejected", "gauge", "Whether the endpoint is out of rotation.");
+    for (int i = 0; i < replica_count; i++) {
+        MetricLabel labels[2] = {{"model", replicas[i].model}, {"endpoint", replicas[i].endpoint}};
+        write_u64(w, "aionic_upstream_ejected", "", labels, 2, replicas[i].ejected ? 1 : 0);
+    }
+    write_family(w, "aionic_upstream_requests", "counter", "Requests sent to the upstream endpoint.");
+    for (int i = 0; i < replica_count; i++) {
+        MetricLabel labels[2] = {{"model", replicas[i].model}, {"endpoint", replicas[i].endpoint}};
+        write_u64(w, "aionic_upstream_requests", "_total", labels, 2, replicas[i].requests);
+    }
+    write_family(w, "aionic_upstream_failures", "counter", "Failed requests to the upstream endpoint.");
+    for (int i = 0; i < replica_count; i++) {
+        MetricLabel labels[2] = {{"model", replicas[i].model}, {"endpoint", replicas[i].endpoint}};
+        write_u64(w, "aionic_upstream_failures", "_total", labels, 2, replicas[i].failures);
+    }
+    write_family(w, "aionic_upstream_hedges", "counter", "Hedged attempts sent to the upstream endpoint.");
+    for (int i = 0; i < replica_count; i++) {
+        MetricLabel labels[2] = {{"model", replicas[i].model}, {"endpoint", replicas[i].endpoint}};
+        write_u64(w, "aionic_upstream_hedges", "_total", labels, 2, replicas[i].hedges);
+    }
+}
+
+// Request counters and latency histograms per model, route and request phase
+static void render_latency(JsonWriter *w) {
+    static _Thread_local StatsSeriesInfo series[METRICS_MAX_SERIES];
+    int count = stats_get_series(series, METRICS_MAX_SERIES, 0);
+    if (count > METRICS_MAX_SERIES) count = METRICS_MAX_SERIES;
+
+    write_family(w, "aionic_model_requests", "counter", "Requests answered by the model, by outcome.");
+    for (int i = 0; i < count; i++) {
+        if (series[i].scope != STATS_SCOPE_MODEL) continue;
+        MetricLabel labels[2] = {{"model", series[i].name}, {"outcome", "success"}};
+        write_u64(w, "aionic_model_requests", "_total", labels, 2, series[i].successes);
+        labels[1].value = "failure";
+        write_u64(w, "aionic_model_requests", "_total", labels, 2, series[i].failures);
+    }
+    write_family(w, "aionic_model_prompt_tokens", "counter", "Prompt tokens sent to the model.");
+    for (int i = 0; i < count; i++) {
+        if (series[i].scope != STATS_SCOPE_MODEL) continue;
+        MetricLabel labels[1] = {{"model", series[i].name}};
+        write_u64(w, "aionic_model_prompt_tokens", "_total", labels, 1, series[i].tokens);
+    }
+
+    static const struct {
+        const char *name;
+        StatsMetric metric;
+        const char *help;
+    } model_histograms[] = {
+        {"aionic_model_request_duration_seconds", STATS_LATENCY, "End-to-end latency of requests answered by the model."},
+        {"aionic_model_ttft_seconds", STATS_TTFT, "Time to the first upstream byte."},
+        {"aionic_model_upstream_duration_seconds", STATS_UPSTREAM, "Duration of each upstream attempt."},
+    };
+    for (size_t h = 0; h < sizeof(model_histograms) / sizeof(model_histograms[0]); h++) {
+        write_family(w, model_histograms[h].name, "histogram", model_histograms[h].help);
+        for (int i = 0; i < count; i++) {
+            if (series[i].scope != STATS_SCOPE_MODEL) continue;
+            write_histogram(w, model_histograms[h].name, STATS_SCOPE_MODEL, series[i].name,
+                            model_histograms[h].metric, "model");
+        }
+    }
+
+    write_family(w, "aionic_route_request_duration_seconds", "histogram", "Handler latency by route pattern.");
+    for (int i = 0; i < count; i++) {
+        if (series[i].scope != STATS_SCOPE_ROUTE) continue;
+        write_histogram(w, "aionic_route_request_duration_seconds", STATS_SCOPE_ROUTE, series[i].name,
+                        STATS_LATENCY, "route");
+    }
+
+    write_family(w, "aionic_request_phase_duration_seconds", "histogram",
+                 "Time per request phase, while tracing is enabled.");
+    for (int i = 0; i < count; i++) {
+        if (series[i].scope != STATS_SCOPE_PHASE) continue;
+        write_histogram(w, "aionic_request_phase_duration_seconds", STATS_SCOPE_PHASE, series[i].name,
+                        STATS_LATENCY, "phase");
+    }
+}
+
+static void render_optimizer(JsonWriter *w) {
+    PerformanceData data;
+    memset(&data, 0, sizeof(data));
+    optimizer_get_current_data(&data);
+
+    write_family(w, "aionic_process_cpu_percent", "gauge", "Process CPU usage as last sampled by the optimizer.");
+    write_double(w, "aionic_process_cpu_percent", "", NULL, 0, data.cpu_usage);
+    write_family(w, "aionic_process_resident_memory_bytes", "gauge", "Resident set size as last sampled by the optimizer.");
+    write_u64(w, "aionic_process_resident_memory_bytes", "", NULL, 0, (uint64_t)(data.memory_usage * 1024.0 * 1024.0));
+    write_family(w, "aionic_optimizer_requests_per_second", "gauge", "Request rate seen by the optimizer.");
+    write_u64(w, "aionic_optimizer_requests_per_second", "", NULL, 0, data.requests_per_second);
+    write_family(w, "aionic_optimizer_thread_pool_utilization", "gauge", "Thread pool utilization seen by the optimizer, in percent.");
+    write_u64(w, "aionic_optimizer_thread_pool_utilization", "", NULL, 0, (uint64_t)data.thread_pool_utilization);
+}
+
+int metrics_render(const Server *server, JsonWriter *w) {
+    if (!w) {
+        return -1;
+    }
+
+    render_server(server, w);
+    render_workers(w);
+    render_hooks(w);
+    render_caches(w);
+    render_firewall(w);
+    render_models(w);
+    render_latency(w);
+    render_optimizer(w);
+    json_write_cstr(w, "# EOF\n");
+
+    return w->failed ? -1 : 0;
+}
@@ -10,32 +10,10 @@
 
 // ===== Project Headers =====
 #include "parser.h"
+#include "json.h"
 #include "utils.h"
 #include "asm_utils.h"
 
-// ===== 1. ARENA ALLOCATOR =====
-#define ARENA_SIZE 8192
-
-typedef struct {
-    char *buf;
-    size_t capacity;
-    size_t offset;
-} Arena;
-
-static void arena_init(Arena *a, char *buffer, size_t size) {
-    a->buf = buffer;
-    a->capacity = size;
-    a->offset = 0;
-}
-
-static void* arena_alloc(Arena *a, size_t size) {
-    size_t aligned_size = (size + 7) & ~7ULL;
-    if (a->offset + aligned_size > a->capacity) return NULL;
-    void *ptr = a->buf + a->offset;
-    a->offset += aligned_size;
-    return ptr;
-}
-
 // ===== 2. INLINE CASE-INSENSITIVE COMPARE =====
 static inline int fast_casecmp_len(const char *s1, const char *s2, size_t len) {
     for (size_t i = 0; i < len; i++) {
@@ -61,11 +39,19 @@ static inline int parse_method_fast(const char *line) {
 }
 
 // ===== 4. PARSE REQUEST LINE =====
-static int parse_request_line(const char *line, HTTPRequest *request) {
-    char method[16], path[1024], version[16];
-
-    if (sscanf(line, "%15s %1023s %15s", method, path, version) != 3)
-        return -1;
+// `line` is NUL-terminated; path and query are split in place
+static int parse_request_line(char *line, HTTPRequest *request) {
+    char *method = line;
+    char *path = strchr(method, ' ');
+    if (!path) return -1;
+    *path++ = '\0';
+    while (*path == ' ') path++;
+
+    char *version = strchr(path, ' ');
+    if (!version) return -1;
+    *version++ = '\0';
+    while (*version == ' ') version++;
+    if (!*method || !*path || !*version) return -1;
 
     if (strcmp(method, "GET") == 0) request->method = HTTP_GET;
     else if (strcmp(method, "POST") == 0) request->method = HTTP_POST;
@@ -79,181 +65,194 @@ static int parse_request_line(const char *line, HTTPRequest *request) {
     char *query = strchr(path, '?');
     if (query) {
         *query = '\0';
-        request->query_string = strdup(query + 1);
+        request->query_string = query + 1;
     } else {
         request->query_string = NULL;
     }
 
-    request->path = strdup(path);
+    request->path = path;
     return 0;
 }
 
 // ===== 5. HEADER PARSING =====
-static int parse_header_line(const char *line, HTTPRequest *request, Arena *arena) {
+// Headers are kept as the original "Name: value" lines, NUL-terminated in place
+static int parse_header_line(char *line, HTTPRequest *request) {
     const char *colon = strchr(line, ':');
     if (!colon) return -1;
 
     size_t name_len = colon - line;
     if (name_len >= 64) return 0;
 
-    const char *val_start = colon + 1;
+    char *val_start = (char *)colon + 1;
     while (*val_start && isspace((unsigned char)*val_start)) val_start++;
-    const char *val_end = val_start;
-    while (*val_end && *val_end != '\r' && *val_end != '\n') val_end++;
-
-    size_t val_len = val_end - val_start;
 
     if (request->header_count < 32) {
-        size_t header_size = name_len + 2 + val_len + 1;
-        char *header_storage = (char*)arena_alloc(arena, header_size);
-        if (header_storage) {
-            memcpy(header_storage, line, name_len);
-            memcpy(header_storage + name_len, ": ", 2);
-            memcpy(header_storage + name_len + 2, val_start, val_len);
-            header_storage[header_size - 1] = '\0';
-            request->headers[request->header_count++] = header_storage;
-        }
+        request->headers[request->header_count++] = line;
     }
 
     if (name_len == 12 && fast_casecmp_len(line, "Content-Type", 12) == 0) {
-        request->content_type = strdup(val_start);
+        request->content_type = val_start;
+    } else if (name_len == 10 && fast_casecmp_len(line, "Connection", 10) == 0) {
+        request->keep_alive = strcasestr(val_start, "keep-alive") != NULL;
     }
 
     return 0;
 }
 
 // ===== 6. MAIN HTTP PARSER =====
-int parse_http_request(const char *raw_request, HTTPRequest *request) {
+int parse_http_request(char *raw_request, size_t length, HTTPRequest *request, Arena *arena) {
     if (!raw_request || !request) return -1;
     memset(request, 0, sizeof(HTTPRequest));
+    request->arena = arena;
+    request->client_fd = -1;
 
-    char arena_buffer[ARENA_SIZE];
-    Arena arena;
-    arena_init(&arena, arena_buffer, sizeof(arena_buffer));
+    char *end = raw_request + length;
+    char *header_end = memmem(raw_request, length, "\r\n\r\n", 4);
+    char *headers_limit = header_end ? header_end + 2 : end;
 
-    char *request_copy = strdup(raw_request);
-    if (!request_copy) return -1;
-
-    char *line = request_copy;
-    char *next_line = strchr(line, '\n');
+    // Request line
+    char *line = raw_request;
+    char *next_line = memchr(line, '\n', (size_t)(headers_limit - line));
     if (next_line) *next_line = '\0';
+    if (next_line && next_line > line && next_line[-1] == '\r') next_line[-1] = '\0';
 
     if (parse_request_line(line, request) != 0) {
-        free(request_copy);
         return -1;
     }
 
-    if (next_line) {
+    // Header lines up to the blank line
+    while (next_line && next_line + 1 < headers_limit) {
         line = next_line + 1;
-        while (*line && *line != '\r' && *line != '\n') {
-            next_line = strchr(line, '\n');
-            if (next_line) *next_line = '\0';
-            parse_header_line(line, request, &arena);
-            line = next_line ? next_line + 1 : line + strlen(line);
+        if (*line == '\r' || *line == '\n') break;
+
+        next_line = memchr(line, '\n', (size_t)(headers_limit - line));
+        if (next_line) {
+            *next_line = '\0';
+            if (next_line > line && next_line[-1] == '\r') next_line[-1] = '\0';
         }
+        parse_header_line(line, request);
     }
 
-    char *body_start = strstr(raw_request, "\r\n\r\n");
-    if (body_start) {
-        body_start += 4;
-        if (*body_start) {
-            request->body = malloc(strlen(body_start) + 1);
-            strcpy(request->body, body_start);
-            request->body_length = strlen(body_start);
+    // Body aliases the receive buffer, which the caller keeps NUL-terminated
+    if (header_end && header_end + 4 < end) {
+        request->body = header_end + 4;
+        request->body_length = (size_t)(end - request->body);
+    }
+
+    return 0;
+}
+
+const char *http_request_param(const HTTPRequest *request, const char *name, size_t *value_len) {
+    if (!request || !name) return NULL;
+
+    for (int i = 0; i < request->param_count; i++) {
+        if (strcmp(request->params[i].name, name) == 0) {
+            if (value_len) *value_len = request->params[i].value_len;
+            return request->params[i].value;
         }
     }
+    return NULL;
+}
 
-    if (request->content_type && strstr(request->content_type, "application/json")) {
-        if (has_avx2_support()) json_fast_tokenizer_avx2(request->body, request->body_length);
-        else json_fast_tokenizer(request->body, request->body_length);
+const char *http_request_header(const HTTPRequest *request, const char *name) {
+    if (!request || !name) return NULL;
+
+    size_t name_len = strlen(name);
+    for (int i = 0; i < request->header_count; i++) {
+        const char *line = request->headers[i];
+        if (line && fast_casecmp_len(line, name, name_len) == 0 && line[name_len] == ':') {
+            const char *value = line + name_len + 1;
+            while (*value && isspace((unsigned char)*value)) value++;
+            return value;
+        }
     }
+    return NULL;
+}
 
-    free(request_copy);
-    return 0;
+const char *http_method_name(HTTPMethod method) {
+    static const char *const method_names[] = {"GET", "POST", "PUT", "DELETE", "HEAD", "OPTIONS", "PATCH"};
+    if (method < HTTP_GET || method >= HTTP_UNKNOWN) return "UNKNOWN";
+    return method_names[method];
 }
 
 // ===== 7. JSON PARSING =====
+// Thin compatibility wrappers over the structural parser in json.c
 int parse_json(const char *json_string, void *output, size_t output_size) {
-    if (!json_string || !output || output_size == 0) return -1;
-    json_fast_tokenizer(json_string, strlen(json_string));
-
-    const char *p = json_string;
-    while ((p = strstr(p, "\"prompt\"")) != NULL) {
-        p += 8;
-        while (*p && (*p == ' ' || *p == '\t' || *p == ':')) p++;
-
-        if (*p == '"') {
-            p++;
-            char *out = (char*)output;
-            size_t i = 0;
-            while (*p && *p != '"' && i < output_size - 1) {
-                if (*p == '\\') {
-                    p++;
-                    switch(*p) {
-                        case 'n': out[i++] = '\n'; p++; continue;
-                        case 't': out[i++] = '\t'; p++; continue;
-                        case 'r': out[i++] = '\r'; p++; continue;
-                        case '\\': out[i++] = '\\'; p++; continue;
-                        case '"': out[i++] = '"'; p++; continue;
-                        default: return -1;
-                    }
-                }
-                out[i++] = *p++;
-            }
-            out[i] = '\0';
-            return 0;
-        }
-    }
-    return -1;
+    return json_get_value(json_string, "prompt", (char *)output, output_size);
 }
 
 int json_get_value(const char *json_string, const char *key, char *output, size_t output_size) {
     if (!json_string || !key || !output || output_size == 0) return -1;
 
-    char key_pattern[128];
-    int key_len = strlen(key);
-    if (key_len > 100) return -1;
-    sprintf(key_pattern, "\"%s\"", key);
-
-    const char *key_start = strstr(json_string, key_pattern);
-    if (!key_start) return -1;
-    key_start += key_len + 2;
-    while (*key_start && (*key_start == ' ' || *key_start == ':')) key_start++;
-
-    if (*key_start == '"') {
-        key_start++;
-        const char *value_end = strchr(key_start, '"');
-        if (!value_end) return -1;
-        size_t len = value_end - key_start;
-        if (len >= output_size) len = output_size - 1;
-        memcpy(output, key_start, len);
-        output[len] = '\0';
-        return 0;
+    JsonDoc doc;
+    if (json_doc_parse(&doc, json_string, strlen(json_string)) != 0) return -1;
+
+    int rc = -1;
+    JsonCursor root, value;
+    if (json_doc_root(&doc, &root) == 0 && json_object_get(&root, key, &value) == 0) {
+        JSONType type = json_cursor_type(&value);
+        if (type == JSON_STRING) {
+            rc = json_get_string(&value, output, output_size, NULL);
+        } else if (type == JSON_NUMBER || type == JSON_BOOLEAN || type == JSON_NULL) {
+            // Scalars are returned as their literal text
+            uint32_t end = value.i < doc.count ? doc.index[value.i] : (uint32_t)doc.len;
+            while (end > value.pos && isspace((unsigned char)json_string[end - 1])) end--;
+            size_t len = end - value.pos;
+            if (len < output_size) {
+                memcpy(output, json_string + value.pos, len);
+                output[len] = '\0';
+                rc = 0;
+            }
+        }
     }
-    return -1;
+
+    json_doc_free(&doc);
+    return rc;
 }
 
 // ===== 8. CLEANUP =====
+// All request fields borrow from the receive buffer or the request arena
 void free_http_request(HTTPRequest *request) {
     if (!request) return;
-    if (request->path) free(request->path);
-    if (request->query_string) free(request->query_string);
-    if (request->body) free(request->body);
-    if (request->content_type) free(request->content_type);
-    // Headers are in Arena (stack), no manual free needed
     memset(request, 0, sizeof(HTTPRequest));
 }
 
-// ===== 9. JSON FAST TOKENIZER STUB =====
+// ===== 9. JSON VALIDATION =====
 int parse_json_with_fast_tokenizer(const char *json_str, size_t length, JSONValue *result) {
-    if (has_avx2_support()) json_fast_tokenizer_avx2(json_str, length);
-    else json_fast_tokenizer(json_str, length);
+    if (!json_str) return -1;
+
+    JsonDoc doc;
+    if (json_doc_parse(&doc, json_str, length) != 0) return -1;
+
+    JsonCursor root;
+    if (json_doc_root(&doc, &root) != 0) {
+        json_doc_free(&doc);
+        return -1;
+    }
 
     if (result) {
-        result->type = JSON_OBJECT;
-        result->key = strdup("result");
-        result->value.str = strdup("Ultimate Hybrid v5");
-        result->value_type = JSON_STRING;
+        memset(result, 0, sizeof(JSONValue));
+        result->type = json_cursor_type(&root);
+        result->value_type = result->type;
+
+        if (result->type == JSON_STRING) {
+            JsonSlice raw;
+            if (json_get_string_raw(&root, &raw) != 0) {
+                json_doc_free(&doc);
+                return -1;
+            }
+            result->value.str = malloc(raw.len + 1);
+            if (!result->value.str || json_get_string(&root, result->value.str, raw.len + 1, NULL) != 0) {
+                free(result->value.str);
+                result->value.str = NULL;
+            }
+        } else if (result->type == JSON_NUMBER) {
+            json_get_double(&root, &result->value.number);
+        } else if (result->type == JSON_BOOLEAN) {
+            json_get_bool(&root, &result->value.boolean);
+        }
     }
+
+    json_doc_free(&doc);
     return 0;
 }
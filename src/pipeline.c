@@ -0,0 +1,348 @@
+#define _POSIX_C_SOURCE 200809L
+
+// ===== Standard Library Headers =====
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+// ===== Project Headers =====
+#include "pipeline.h"
+#include "rcu.h"
+#include "utils.h"
+
+// Per-hook counters, one cache line each; shared by every chain snapshot
+typedef struct {
+    _Atomic uint64_t calls;
+    _Atomic uint64_t errors;
+    _Atomic uint64_t total_ns;
+    _Atomic uint64_t max_ns;
+} __attribute__((aligned(64))) HookCounters;
+
+typedef struct HookRegistration {
+    char owner[64];
+    HookPhase phase;
+    PluginHook hook;
+    int enabled;
+    HookCounters *counters;
+    struct HookRegistration *next;
+} HookRegistration;
+
+typedef struct {
+    PluginHook hook;
+    HookCounters *counters;
+} HookEntry;
+
+// Immutable snapshot: the enabled hooks of each phase, in registration order
+typedef struct {
+    int count[HOOK_PHASE_COUNT];
+    HookEntry *entries[HOOK_PHASE_COUNT];
+    HookEntry storage[];
+} HookChain;
+
+// ===== Global Variables =====
+static HookChain *_Atomic active_chain = NULL;
+static HookRegistration *registrations = NULL;     // Writer side, guarded by pipeline_lock
+static pthread_mutex_t pipeline_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static const char *phase_names[HOOK_PHASE_COUNT] = {
+    "on_accept",
+    "on_headers",
+    "on_body",
+    "pre_route",
+    "post_response",
+    "on_upstream_chunk"
+};
+
+// ===== Chain Construction =====
+
+// Compile the enabled registrations into a new snapshot and publish it.
+// Called with pipeline_lock held; returns the previous snapshot to retire.
+static int publish_chain(HookChain **old_chain) {
+    int total = 0;
+    for (HookRegistration *reg = registrations; reg; reg = reg->next) {
+        if (reg->enabled) total++;
+    }
+
+    HookChain *chain = calloc(1, sizeof(HookChain) + sizeof(HookEntry) * total);
+    if (!chain) return -1;
+
+    HookEntry *next = chain->storage;
+    for (int phase = 0; phase < HOOK_PHASE_COUNT; phase++) {
+        chain->entries[phase] = next;
+        for (HookRegistration *reg = registrations; reg; reg = reg->next) {
+            if (!reg->enabled || reg->phase != (HookPhase)phase) continue;
+            next->hook = reg->hook;
+            next->counters = reg->counters;
+            next++;
+            chain->count[phase]++;
+        }
+    }
+
+    *old_chain = atomic_exchange(&active_chain, chain);
+    return 0;
+}
+
+static HookRegistration *registration_create(const char *owner, HookPhase phase, PluginHook hook) {
+    HookRegistration *reg = calloc(1, sizeof(HookRegistration));
+    if (!reg) return NULL;
+
+    reg->counters = aligned_alloc(64, sizeof(HookCounters));
+    if (!reg->counters) {
+        free(reg);
+        return NULL;
+    }
+    memset(reg->counters, 0, sizeof(HookCounters));
+
+    snprintf(reg->owner, sizeof(reg->owner), "%s", owner);
+    reg->phase = phase;
+    reg->hook = hook;
+    reg->enabled = 1;
+    return reg;
+}
+
+static void registration_free(HookRegistration *reg) {
+    free(reg->counters);
+    free(reg);
+}
+
+static void registration_list_free(void *list) {
+    HookRegistration *reg = list;
+    while (reg) {
+        HookRegistration *next = reg->next;
+        registration_free(reg);
+        reg = next;
+    }
+}
+
+// Build one registration per non-NULL hook, in phase order
+static int registrations_create(const char *owner, const PluginHook hooks[HOOK_PHASE_COUNT],
+                                int enabled, HookRegistration **out) {
+    HookRegistration *added = NULL;
+    HookRegistration **tail = &added;
+
+    for (int phase = 0; phase < HOOK_PHASE_COUNT; phase++) {
+        if (!hooks || !hooks[phase]) continue;
+        HookRegistration *reg = registration_create(owner, (HookPhase)phase, hooks[phase]);
+        if (!reg) {
+            registration_list_free(added);
+            return -1;
+        }
+        reg->enabled = enabled;
+        *tail = reg;
+        tail = &reg->next;
+    }
+
+    *out = added;
+    return 0;
+}
+
+// Detach every registration of `owner`, keeping their relative order
+static HookRegistration *registrations_detach(const char *owner) {
+    HookRegistration *removed = NULL;
+    HookRegistration **removed_tail = &removed;
+    HookRegistration **link = &registrations;
+    while (*link) {
+        HookRegistration *reg = *link;
+        if (strcmp(reg->owner, owner) == 0) {
+            *link = reg->next;
+            reg->next = NULL;
+            *removed_tail = reg;
+            removed_tail = &reg->next;
+        } else {
+            link = &reg->next;
+        }
+    }
+    return removed;
+}
+
+// Append `list`; returns the link it was attached to so it can be cut off again
+static HookRegistration **registrations_append(HookRegistration *list) {
+    HookRegistration **end = &registrations;
+    while (*end) end = &(*end)->next;
+    *end = list;
+    return end;
+}
+
+// ===== Registration =====
+
+int pipeline_register_hooks(const char *owner, const PluginHook hooks[HOOK_PHASE_COUNT]) {
+    if (!owner || !hooks) return -1;
+
+    HookRegistration *added = NULL;
+    if (registrations_create(owner, hooks, 1, &added) != 0) return -1;
+    if (!added) return 0;
+
+    pthread_mutex_lock(&pipeline_lock);
+    HookRegistration **link = registrations_append(added);
+
+    HookChain *old_chain = NULL;
+    if (publish_chain(&old_chain) != 0) {
+        *link = NULL;
+        pthread_mutex_unlock(&pipeline_lock);
+        registration_list_free(added);
+        return -1;
+    }
+
+    pthread_mutex_unlock(&pipeline_lock);
+    rcu_defer(old_chain, free);
+    return 0;
+}
+
+int pipeline_replace_hooks(const char *owner, const PluginHook hooks[HOOK_PHASE_COUNT], int enabled) {
+    if (!owner) return -1;
+
+    HookRegistration *added = NULL;
+    if (registrations_create(owner, hooks, enabled, &added) != 0) return -1;
+
+    pthread_mutex_lock(&pipeline_lock);
+    HookRegistration *removed = registrations_detach(owner);
+    HookRegistration **link = registrations_append(added);
+
+    HookChain *old_chain = NULL;
+    if (publish_chain(&old_chain) != 0) {
+        // Roll back to the previous registrations; the live chain is unchanged
+        *link = removed;
+        pthread_mutex_unlock(&pipeline_lock);
+        registration_list_free(added);
+        return -1;
+    }
+
+    pthread_mutex_unlock(&pipeline_lock);
+
+    // Workers may still be inside the old hooks until their next quiescent state
+    rcu_defer(old_chain, free);
+    rcu_defer(removed, registration_list_free);
+    return 0;
+}
+
+int pipeline_register(const char *owner, HookPhase phase, PluginHook hook) {
+    if (phase < 0 || phase >= HOOK_PHASE_COUNT || !hook) return -1;
+
+    PluginHook hooks[HOOK_PHASE_COUNT] = {NULL};
+    hooks[phase] = hook;
+    return pipeline_register_hooks(owner, hooks);
+}
+
+int pipeline_unregister(const char *owner) {
+    if (!owner) return -1;
+
+    pthread_mutex_lock(&pipeline_lock);
+
+    HookRegistration *removed = registrations_detach(owner);
+    if (!removed) {
+        pthread_mutex_unlock(&pipeline_lock);
+        return -1;
+    }
+
+    HookChain *old_chain = NULL;
+    if (publish_chain(&old_chain) != 0) {
+        // Keep the hooks registered rather than free code that may still run
+        registrations_append(removed);
+        pthread_mutex_unlock(&pipeline_lock);
+        return -1;
+    }
+
+    pthread_mutex_unlock(&pipeline_lock);
+
+    // After this no worker can be inside one of the removed hooks
+    rcu_synchronize();
+    free(old_chain);
+    registration_list_free(removed);
+    return 0;
+}
+
+int pipeline_set_enabled(const char *owner, int enabled) {
+    if (!owner) return -1;
+
+    pthread_mutex_lock(&pipeline_lock);
+
+    int found = 0;
+    for (HookRegistration *reg = registrations; reg; reg = reg->next) {
+        if (strcmp(reg->owner, owner) == 0) {
+            reg->enabled = enabled;
+            found = 1;
+        }
+    }
+
+    HookChain *old_chain = NULL;
+    if (!found || publish_chain(&old_chain) != 0) {
+        pthread_mutex_unlock(&pipeline_lock);
+        return -1;
+    }
+
+    pthread_mutex_unlock(&pipeline_lock);
+    rcu_defer(old_chain, free);
+    return 0;
+}
+
+// ===== Dispatch =====
+
+int pipeline_run(HookPhase phase, Server *server, HookContext *ctx) {
+    if (phase < 0 || phase >= HOOK_PHASE_COUNT) return -1;
+
+    const HookChain *chain = rcu_dereference(active_chain);
+    if (!chain || chain->count[phase] == 0) return HOOK_CONTINUE;
+
+    const HookEntry *entry = chain->entries[phase];
+    for (int i = 0; i < chain->count[phase]; i++, entry++) {
+        uint64_t start = get_current_time_ns();
+        int result = entry->hook(server, phase, ctx);
+        uint64_t elapsed = get_current_time_ns() - start;
+
+        HookCounters *counters = entry->counters;
+        atomic_fetch_add_explicit(&counters->calls, 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&counters->total_ns, elapsed, memory_order_relaxed);
+        if (result < 0) atomic_fetch_add_explicit(&counters->errors, 1, memory_order_relaxed);
+
+        uint64_t max = atomic_load_explicit(&counters->max_ns, memory_order_relaxed);
+        while (elapsed > max &&
+               !atomic_compare_exchange_weak_explicit(&counters->max_ns, &max, elapsed,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+        }
+
+        if (result != HOOK_CONTINUE) return result;
+    }
+
+    return HOOK_CONTINUE;
+}
+
+const char *pipeline_phase_name(HookPhase phase) {
+    if (phase < 0 || phase >= HOOK_PHASE_COUNT) return "unknown";
+    return phase_names[phase];
+}
+
+int pipeline_get_stats(HookStatsInfo *out, int max) {
+    pthread_mutex_lock(&pipeline_lock);
+
+    int count = 0;
+    for (HookRegistration *reg = registrations; reg; reg = reg->next, count++) {
+        if (!out || count >= max) continue;
+
+        HookStatsInfo *info = &out[count];
+        snprintf(info->owner, sizeof(info->owner), "%s", reg->owner);
+        info->phase = reg->phase;
+        info->enabled = reg->enabled;
+        info->calls = atomic_load_explicit(&reg->counters->calls, memory_order_relaxed);
+        info->errors = atomic_load_explicit(&reg->counters->errors, memory_order_relaxed);
+        info->total_ns = atomic_load_explicit(&reg->counters->total_ns, memory_order_relaxed);
+        info->max_ns = atomic_load_explicit(&reg->counters->max_ns, memory_order_relaxed);
+    }
+
+    pthread_mutex_unlock(&pipeline_lock);
+    return count;
+}
+
+void pipeline_cleanup(void) {
+    pthread_mutex_lock(&pipeline_lock);
+    HookRegistration *removed = registrations;
+    registrations = NULL;
+    HookChain *old_chain = atomic_exchange(&active_chain, NULL);
+    pthread_mutex_unlock(&pipeline_lock);
+
+    rcu_synchronize();
+    free(old_chain);
+    registration_list_free(removed);
+}
@@ -1,25 +1,31 @@
 #define _POSIX_C_SOURCE 200809L
+#define _GNU_SOURCE
 
 // ====== Standard Library Headers ======
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <pthread.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <dlfcn.h>
 #include <dirent.h>
+#include <sys/mman.h>
 
 // ====== Project Headers ======
 #include "plugin.h"
+#include "rcu.h"
 #include "utils.h"
 
+#define PLUGIN_COPY_BUFFER_SIZE 65536
 
 typedef struct {
     char *name;
     char *path;
     void *handle;
-    int (*init)(void);
-    int (*process)(void *, void *);
-    void (*cleanup)(void);
+    int image_fd;           // memfd backing the handle, -1 when loaded from disk
+    const PluginDescriptor *descriptor;
     int is_loaded;
     int is_enabled;
 } Plugin;
@@ -34,32 +40,179 @@ typedef struct {
 
 static PluginManager global_plugin_manager;
 
+// Old plugin code waiting for its grace period before dlclose()
+typedef struct {
+    char *name;
+    void *handle;
+    int image_fd;
+    void (*cleanup)(void);
+} RetiredPlugin;
+
+static void close_plugin_image(void *handle, int image_fd) {
+    dlclose(handle);
+    if (image_fd >= 0) close(image_fd);
+}
+
+static void retire_plugin(void *arg) {
+    RetiredPlugin *retired = (RetiredPlugin *)arg;
+    
+    if (retired->cleanup) retired->cleanup();
+    close_plugin_image(retired->handle, retired->image_fd);
+    
+    char log_msg[256];
+    snprintf(log_msg, sizeof(log_msg), "Plugin retired: %s", retired->name);
+    log_message("PLUGIN", log_msg);
+    
+    free(retired->name);
+    free(retired);
+}
+
+// Unlink the plugin's code once no worker can still be inside its hooks
+static void defer_plugin_retire(Plugin *plugin) {
+    RetiredPlugin *retired = malloc(sizeof(RetiredPlugin));
+    char *name = strdup(plugin->name);
+    if (!retired || !name) {
+        free(retired);
+        free(name);
+        rcu_synchronize();
+        if (plugin->descriptor->cleanup) plugin->descriptor->cleanup();
+        close_plugin_image(plugin->handle, plugin->image_fd);
+        return;
+    }
+    
+    retired->name = name;
+    retired->handle = plugin->handle;
+    retired->image_fd = plugin->image_fd;
+    retired->cleanup = plugin->descriptor->cleanup;
+    rcu_defer(retired, retire_plugin);
+}
+
+// dlopen() a private copy of the file. A rebuilt .so is often written over
+// the old one in place, and dlopen() of a path that is already loaded just
+// returns the old handle; loading from a memfd gives every version its own
+// mapping and leaves the on-disk file free to change again. The memfd stays
+// open while the handle is loaded so its /proc/self/fd name stays unique.
+static void *open_plugin_image(const char *plugin_path, int *image_fd) {
+    *image_fd = -1;
+    
+    int src = open(plugin_path, O_RDONLY | O_CLOEXEC);
+    if (src < 0) {
+        log_message("PLUGIN", strerror(errno));
+        return NULL;
+    }
+    
+    const char *filename = strrchr(plugin_path, '/');
+    int image = memfd_create(filename ? filename + 1 : plugin_path, MFD_CLOEXEC);
+    if (image < 0) {
+        close(src);
+        return dlopen(plugin_path, RTLD_NOW | RTLD_LOCAL);
+    }
+    
+    char buffer[PLUGIN_COPY_BUFFER_SIZE];
+    ssize_t n;
+    while ((n = read(src, buffer, sizeof(buffer))) > 0) {
+        ssize_t off = 0;
+        while (off < n) {
+            ssize_t written = write(image, buffer + off, (size_t)(n - off));
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                n = -1;
+                break;
+            }
+            off += written;
+        }
+        if (n < 0) break;
+    }
+    close(src);
+    
+    if (n < 0) {
+        log_message("PLUGIN", "Failed to copy plugin image");
+        close(image);
+        return NULL;
+    }
+    
+    char image_path[64];
+    snprintf(image_path, sizeof(image_path), "/proc/self/fd/%d", image);
+    void *handle = dlopen(image_path, RTLD_NOW | RTLD_LOCAL);
+    if (!handle) {
+        close(image);
+        return NULL;
+    }
+    *image_fd = image;
+    return handle;
+}
+
+static Plugin *find_plugin(const char *name) {
+    for (int i = 0; i < global_plugin_manager.plugin_count; i++) {
+        if (strcmp(global_plugin_manager.plugins[i].name, name) == 0) {
+            return &global_plugin_manager.plugins[i];
+        }
+    }
+    return NULL;
+}
+
+// Load a plugin, or atomically replace the running version of it
 static int load_plugin(const char *plugin_path) {
-    void *handle = dlopen(plugin_path, RTLD_LAZY);
+    int image_fd;
+    void *handle = open_plugin_image(plugin_path, &image_fd);
     if (!handle) {
-        log_message("PLUGIN", dlerror());
+        const char *error = dlerror();
+        log_message("PLUGIN", error ? error : "Failed to load plugin");
+        return -1;
+    }
+    
+    const PluginDescriptor *descriptor = dlsym(handle, AIONIC_PLUGIN_SYMBOL);
+    if (!descriptor) {
+        log_message("PLUGIN", "Plugin does not export a plugin descriptor");
+        close_plugin_image(handle, image_fd);
+        return -1;
+    }
+    
+    if (descriptor->abi_version != AIONIC_PLUGIN_ABI_VERSION) {
+        char log_msg[256];
+        snprintf(log_msg, sizeof(log_msg), "Plugin %s built for ABI %u, server provides %u",
+                 plugin_path, descriptor->abi_version, AIONIC_PLUGIN_ABI_VERSION);
+        log_message("PLUGIN", log_msg);
+        close_plugin_image(handle, image_fd);
         return -1;
     }
     
-    int (*init)(void) = dlsym(handle, "plugin_init");
-    int (*process)(void *, void *) = dlsym(handle, "plugin_process");
-    void (*cleanup)(void) = dlsym(handle, "plugin_cleanup");
+    const char *filename = strrchr(plugin_path, '/');
+    if (!filename) filename = plugin_path;
+    else filename++;
+    
+    char *name = strdup(filename);
+    char *path = strdup(plugin_path);
+    if (!name || !path) {
+        free(name);
+        free(path);
+        close_plugin_image(handle, image_fd);
+        return -1;
+    }
+    char *dot = strrchr(name, '.');
+    if (dot) *dot = '\0';
     
-    if (!init || !process || !cleanup) {
-        log_message("PLUGIN", "Plugin missing required functions");
-        dlclose(handle);
+    if (descriptor->init && descriptor->init() != 0) {
+        log_message("PLUGIN", "Plugin initialization failed");
+        close_plugin_image(handle, image_fd);
+        free(name);
+        free(path);
         return -1;
     }
     
     pthread_mutex_lock(&global_plugin_manager.mutex);
     
-    if (global_plugin_manager.plugin_count >= global_plugin_manager.plugin_capacity) {
+    Plugin *plugin = find_plugin(name);
+    if (!plugin && global_plugin_manager.plugin_count >= global_plugin_manager.plugin_capacity) {
         int new_capacity = global_plugin_manager.plugin_capacity * 2;
         Plugin *new_plugins = realloc(global_plugin_manager.plugins, 
                                      sizeof(Plugin) * new_capacity);
         if (!new_plugins) {
             pthread_mutex_unlock(&global_plugin_manager.mutex);
-            dlclose(handle);
+            if (descriptor->cleanup) descriptor->cleanup();
+            close_plugin_image(handle, image_fd);
+            free(name);
+            free(path);
             return -1;
         }
         
@@ -67,37 +220,37 @@ static int load_plugin(const char *plugin_path) {
         global_plugin_manager.plugin_capacity = new_capacity;
     }
     
-    const char *filename = strrchr(plugin_path, '/');
-    if (!filename) filename = plugin_path;
-    else filename++;
-    
-    char *name = strdup(filename);
-    char *dot = strrchr(name, '.');
-    if (dot) *dot = '\0';
-    
-    Plugin *plugin = &global_plugin_manager.plugins[global_plugin_manager.plugin_count];
-    plugin->name = name;
-    plugin->path = strdup(plugin_path);
-    plugin->handle = handle;
-    plugin->init = init;
-    plugin->process = process;
-    plugin->cleanup = cleanup;
-    plugin->is_loaded = 1;
-    plugin->is_enabled = 1;
+    // New hooks replace the old ones in a single chain snapshot
+    int enabled = plugin ? plugin->is_enabled : 1;
+    if (pipeline_replace_hooks(name, descriptor->hooks, enabled) != 0) {
+        pthread_mutex_unlock(&global_plugin_manager.mutex);
+        log_message("PLUGIN", "Failed to register plugin hooks");
+        if (descriptor->cleanup) descriptor->cleanup();
+        close_plugin_image(handle, image_fd);
+        free(name);
+        free(path);
+        return -1;
+    }
     
-    if (plugin->init() != 0) {
-        log_message("PLUGIN", "Plugin initialization failed");
-        dlclose(handle);
+    int reloaded = plugin != NULL;
+    if (reloaded) {
+        defer_plugin_retire(plugin);
         free(plugin->name);
         free(plugin->path);
-        pthread_mutex_unlock(&global_plugin_manager.mutex);
-        return -1;
+    } else {
+        plugin = &global_plugin_manager.plugins[global_plugin_manager.plugin_count++];
+        plugin->is_enabled = 1;
     }
     
-    global_plugin_manager.plugin_count++;
+    plugin->name = name;
+    plugin->path = path;
+    plugin->handle = handle;
+    plugin->image_fd = image_fd;
+    plugin->descriptor = descriptor;
+    plugin->is_loaded = 1;
     
     char log_msg[256];
-    snprintf(log_msg, sizeof(log_msg), "Plugin loaded: %s", plugin->name);
+    snprintf(log_msg, sizeof(log_msg), "Plugin %s: %s", reloaded ? "reloaded" : "loaded", plugin->name);
     log_message("PLUGIN", log_msg);
     
     pthread_mutex_unlock(&global_plugin_manager.mutex);
@@ -169,6 +322,10 @@ int plugin_load(const char *plugin_path) {
     return load_plugin(plugin_path);
 }
 
+const char *plugin_get_dir(void) {
+    return global_plugin_manager.plugin_dir;
+}
+
 int plugin_unload(const char *plugin_name) {
     pthread_mutex_lock(&global_plugin_manager.mutex);
     
@@ -177,9 +334,9 @@ int plugin_unload(const char *plugin_name) {
             Plugin *plugin = &global_plugin_manager.plugins[i];
             
             if (plugin->is_loaded) {
-                plugin->cleanup();
-                
-                dlclose(plugin->handle);
+                // Hooks leave the chain now; the code is closed after a grace period
+                if (pipeline_replace_hooks(plugin->name, NULL, 0) != 0) break;
+                defer_plugin_retire(plugin);
                 
                 free(plugin->name);
                 free(plugin->path);
@@ -212,6 +369,7 @@ int plugin_set_enabled(const char *plugin_name, int enabled) {
     for (int i = 0; i < global_plugin_manager.plugin_count; i++) {
         if (strcmp(global_plugin_manager.plugins[i].name, plugin_name) == 0) {
             global_plugin_manager.plugins[i].is_enabled = enabled;
+            pipeline_set_enabled(plugin_name, enabled);
             
             char log_msg[256];
             snprintf(log_msg, sizeof(log_msg), "Plugin %s: %s", 
@@ -227,33 +385,6 @@ int plugin_set_enabled(const char *plugin_name, int enabled) {
     return -1;
 }
 
-int plugin_process_request(void *request, void *response) {
-    pthread_mutex_lock(&global_plugin_manager.mutex);
-    
-    int result = 0;
-    
-    for (int i = 0; i < global_plugin_manager.plugin_count; i++) {
-        Plugin *plugin = &global_plugin_manager.plugins[i];
-        
-        if (plugin->is_loaded && plugin->is_enabled) {
-            int plugin_result = plugin->process(request, response);
-            if (plugin_result != 0) {
-                result = plugin_result;
-                
-                char log_msg[256];
-                snprintf(log_msg, sizeof(log_msg), "Plugin %s returned error: %d", 
-                        plugin->name, plugin_result);
-                log_message("PLUGIN", log_msg);
-                
-                // break;
-            }
-        }
-    }
-    
-    pthread_mutex_unlock(&global_plugin_manager.mutex);
-    return result;
-}
-
 int plugin_get_list(char ***plugin_names, int *count) {
     pthread_mutex_lock(&global_plugin_manager.mutex);
     
@@ -275,8 +406,9 @@ void plugin_cleanup() {
         Plugin *plugin = &global_plugin_manager.plugins[i];
         
         if (plugin->is_loaded) {
-            plugin->cleanup();
-            dlclose(plugin->handle);
+            pipeline_unregister(plugin->name);
+            if (plugin->descriptor->cleanup) plugin->descriptor->cleanup();
+            close_plugin_image(plugin->handle, plugin->image_fd);
             free(plugin->name);
             free(plugin->path);
         }
@@ -286,6 +418,9 @@ void plugin_cleanup() {
     free(global_plugin_manager.plugin_dir);
     
     pthread_mutex_unlock(&global_plugin_manager.mutex);
+    
+    // Versions replaced by hot reload that are still waiting to be closed
+    rcu_barrier();
     pthread_mutex_destroy(&global_plugin_manager.mutex);
     
     log_message("PLUGIN", "Plugin manager cleaned up");
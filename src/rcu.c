@@ -0,0 +1,212 @@
+#define _POSIX_C_SOURCE 200809L
+
+// ===== Standard Library Headers =====
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+// ===== Project Headers =====
+#include "rcu.h"
+
+#define RCU_OFFLINE 0
+#define RCU_SPINS_BEFORE_SLEEP 1000
+
+// One cache line per reader so quiescent-state updates never share a line
+typedef struct {
+    _Atomic uint64_t ctr;       // Last grace period observed, RCU_OFFLINE when offline
+    _Atomic int in_use;
+} __attribute__((aligned(64))) RcuReader;
+
+typedef struct RcuCallback {
+    void *ptr;
+    void (*free_fn)(void *);
+    uint64_t target;            // Grace period that must complete first
+    struct RcuCallback *next;
+} RcuCallback;
+
+// ===== Global Variables =====
+static _Atomic uint64_t rcu_gp_ctr = 1;
+static RcuReader rcu_readers[RCU_MAX_THREADS];
+static _Atomic int rcu_reader_limit = 0;     // Highest slot index ever used + 1
+static pthread_mutex_t rcu_gp_lock = PTHREAD_MUTEX_INITIALIZER;
+static _Thread_local RcuReader *rcu_self = NULL;
+static RcuCallback *rcu_pending = NULL;
+static pthread_mutex_t rcu_defer_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// ===== Reader Side =====
+
+int rcu_register_thread(void) {
+    if (rcu_self) return 0;
+
+    for (int i = 0; i < RCU_MAX_THREADS; i++) {
+        int expected = 0;
+        if (!atomic_compare_exchange_strong(&rcu_readers[i].in_use, &expected, 1)) continue;
+
+        rcu_self = &rcu_readers[i];
+        int limit = atomic_load(&rcu_reader_limit);
+        while (limit < i + 1 && !atomic_compare_exchange_weak(&rcu_reader_limit, &limit, i + 1)) {
+        }
+        rcu_thread_online();
+        return 0;
+    }
+
+    fprintf(stderr, "[RCU] No free reader slot (max %d threads)\n", RCU_MAX_THREADS);
+    return -1;
+}
+
+void rcu_unregister_thread(void) {
+    if (!rcu_self) return;
+    atomic_store(&rcu_self->ctr, RCU_OFFLINE);
+    atomic_store(&rcu_self->in_use, 0);
+    rcu_self = NULL;
+}
+
+void rcu_quiescent_state(void) {
+    if (!rcu_self) return;
+
+    uint64_t gp = atomic_load_explicit(&rcu_gp_ctr, memory_order_acquire);
+    // Fast path: nothing changed since the last announcement
+    if (atomic_load_explicit(&rcu_self->ctr, memory_order_relaxed) == gp) return;
+
+    atomic_store_explicit(&rcu_self->ctr, gp, memory_order_release);
+    // Later snapshot loads must not be reordered before the announcement
+    atomic_thread_fence(memory_order_seq_cst);
+}
+
+void rcu_thread_offline(void) {
+    if (!rcu_self) return;
+    atomic_store_explicit(&rcu_self->ctr, RCU_OFFLINE, memory_order_release);
+}
+
+void rcu_thread_online(void) {
+    if (!rcu_self) return;
+    atomic_store_explicit(&rcu_self->ctr, atomic_load(&rcu_gp_ctr), memory_order_release);
+    atomic_thread_fence(memory_order_seq_cst);
+}
+
+// ===== Writer Side =====
+
+// Non-blocking check: has every online reader observed `target`?
+static int grace_period_done(uint64_t target) {
+    int limit = atomic_load(&rcu_reader_limit);
+
+    for (int i = 0; i < limit; i++) {
+        RcuReader *reader = &rcu_readers[i];
+        if (reader == rcu_self || !atomic_load(&reader->in_use)) continue;
+
+        uint64_t ctr = atomic_load_explicit(&reader->ctr, memory_order_acquire);
+        if (ctr != RCU_OFFLINE && ctr < target) return 0;
+    }
+    return 1;
+}
+
+void rcu_synchronize(void) {
+    // Order the caller's pointer publication before the grace period starts
+    atomic_thread_fence(memory_order_seq_cst);
+
+    pthread_mutex_lock(&rcu_gp_lock);
+
+    uint64_t target = atomic_fetch_add(&rcu_gp_ctr, 1) + 1;
+    int limit = atomic_load(&rcu_reader_limit);
+
+    for (int i = 0; i < limit; i++) {
+        RcuReader *reader = &rcu_readers[i];
+        if (reader == rcu_self) continue;
+
+        int spins = 0;
+        for (;;) {
+            uint64_t ctr = atomic_load_explicit(&reader->ctr, memory_order_acquire);
+            if (ctr == RCU_OFFLINE || ctr >= target || !atomic_load(&reader->in_use)) break;
+
+            if (++spins < RCU_SPINS_BEFORE_SLEEP) {
+                sched_yield();
+            } else {
+                struct timespec ts = {0, 1000000};  // 1ms
+                nanosleep(&ts, NULL);
+            }
+        }
+    }
+
+    pthread_mutex_unlock(&rcu_gp_lock);
+}
+
+void rcu_retire(void *ptr, void (*free_fn)(void *)) {
+    if (!ptr || !free_fn) return;
+    rcu_synchronize();
+    free_fn(ptr);
+}
+
+void rcu_defer(void *ptr, void (*free_fn)(void *)) {
+    if (!ptr || !free_fn) return;
+
+    RcuCallback *callback = malloc(sizeof(RcuCallback));
+    if (!callback) {
+        rcu_retire(ptr, free_fn);
+        return;
+    }
+
+    // Start a new grace period; readers pick it up at their next quiescent state
+    atomic_thread_fence(memory_order_seq_cst);
+    callback->ptr = ptr;
+    callback->free_fn = free_fn;
+    callback->target = atomic_fetch_add(&rcu_gp_ctr, 1) + 1;
+
+    pthread_mutex_lock(&rcu_defer_lock);
+    callback->next = rcu_pending;
+    rcu_pending = callback;
+    pthread_mutex_unlock(&rcu_defer_lock);
+}
+
+void rcu_reclaim(void) {
+    RcuCallback *ready = NULL;
+
+    pthread_mutex_lock(&rcu_defer_lock);
+    RcuCallback **link = &rcu_pending;
+    while (*link) {
+        RcuCallback *callback = *link;
+        if (grace_period_done(callback->target)) {
+            *link = callback->next;
+            callback->next = ready;
+            ready = callback;
+        } else {
+            link = &callback->next;
+        }
+    }
+    pthread_mutex_unlock(&rcu_defer_lock);
+
+    // Callbacks run outside the lock and may defer further work
+    while (ready) {
+        RcuCallback *next = ready->next;
+        ready->free_fn(ready->ptr);
+        free(ready);
+        ready = next;
+    }
+}
+
+void rcu_barrier(void) {
+    pthread_mutex_lock(&rcu_defer_lock);
+    RcuCallback *pending = rcu_pending;
+    rcu_pending = NULL;
+    pthread_mutex_unlock(&rcu_defer_lock);
+
+    if (!pending) return;
+    rcu_synchronize();
+
+    // Oldest first, in the order they were deferred
+    RcuCallback *ordered = NULL;
+    while (pending) {
+        RcuCallback *next = pending->next;
+        pending->next = ordered;
+        ordered = pending;
+        pending = next;
+    }
+    while (ordered) {
+        RcuCallback *next = ordered->next;
+        ordered->free_fn(ordered->ptr);
+        free(ordered);
+        ordered = next;
+    }
+}
@@ -0,0 +1,314 @@
+#define _POSIX_C_SOURCE 200809L
+
+// ===== Standard Library Headers =====
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// ===== Project Headers =====
+#include "route_tree.h"
+
+#define ROUTE_METHOD_SLOTS HTTP_UNKNOWN
+
+struct RouteNode {
+    char *prefix;                   // Static edge label leading to this node
+    size_t prefix_len;
+
+    char *indices;                  // First byte of each static child's prefix
+    RouteNode **children;
+    int child_count;
+
+    RouteNode *param_child;         // ":name" segment
+    RouteNode *wildcard_child;      // "*name" remainder
+    char *name;                     // Parameter name for param / wildcard nodes
+
+    RouteHandler handlers[ROUTE_METHOD_SLOTS];
+};
+
+// ===== Node Helpers =====
+
+static RouteNode *node_create(const char *prefix, size_t prefix_len) {
+    RouteNode *node = calloc(1, sizeof(RouteNode));
+    if (!node) return NULL;
+
+    node->prefix = malloc(prefix_len + 1);
+    if (!node->prefix) {
+        free(node);
+        return NULL;
+    }
+    memcpy(node->prefix, prefix, prefix_len);
+    node->prefix[prefix_len] = '\0';
+    node->prefix_len = prefix_len;
+    return node;
+}
+
+static int node_add_child(RouteNode *node, RouteNode *child) {
+    RouteNode **children = realloc(node->children, sizeof(RouteNode *) * (node->child_count + 1));
+    if (!children) return -1;
+    node->children = children;
+
+    char *indices = realloc(node->indices, node->child_count + 2);
+    if (!indices) return -1;
+    node->indices = indices;
+
+    node->children[node->child_count] = child;
+    node->indices[node->child_count] = child->prefix[0];
+    node->child_count++;
+    node->indices[node->child_count] = '\0';
+    return 0;
+}
+
+static RouteNode *node_find_child(const RouteNode *node, char first) {
+    for (int i = 0; i < node->child_count; i++) {
+        if (node->indices[i] == first) return node->children[i];
+    }
+    return NULL;
+}
+
+// Split `child` so that its first `at` bytes become a new parent node
+static RouteNode *node_split(RouteNode *parent, RouteNode *child, size_t at) {
+    RouteNode *middle = node_create(child->prefix, at);
+    if (!middle) return NULL;
+
+    char *rest = malloc(child->prefix_len - at + 1);
+    if (!rest) {
+        route_tree_free(middle);
+        return NULL;
+    }
+    memcpy(rest, child->prefix + at, child->prefix_len - at + 1);
+    free(child->prefix);
+    child->prefix = rest;
+    child->prefix_len -= at;
+
+    if (node_add_child(middle, child) != 0) {
+        route_tree_free(middle);
+        return NULL;
+    }
+
+    for (int i = 0; i < parent->child_count; i++) {
+        if (parent->children[i] == child) {
+            parent->children[i] = middle;
+            break;
+        }
+    }
+    return middle;
+}
+
+// Parameter / wildcard child with a given name; names must agree per position
+static RouteNode *node_named_child(RouteNode **slot, const char *name, size_t name_len) {
+    if (*slot) {
+        if (strlen((*slot)->name) != name_len || memcmp((*slot)->name, name, name_len) != 0) {
+            return NULL;
+        }
+        return *slot;
+    }
+
+    RouteNode *child = node_create("", 0);
+    if (!child) return NULL;
+    child->name = malloc(name_len + 1);
+    if (!child->name) {
+        route_tree_free(child);
+        return NULL;
+    }
+    memcpy(child->name, name, name_len);
+    child->name[name_len] = '\0';
+    *slot = child;
+    return child;
+}
+
+// ===== Public API =====
+
+RouteNode *route_tree_create(void) {
+    return node_create("", 0);
+}
+
+void route_tree_free(RouteNode *root) {
+    if (!root) return;
+
+    for (int i = 0; i < root->child_count; i++) {
+        route_tree_free(root->children[i]);
+    }
+    route_tree_free(root->param_child);
+    route_tree_free(root->wildcard_child);
+
+    free(root->children);
+    free(root->indices);
+    free(root->prefix);
+    free(root->name);
+    free(root);
+}
+
+// Copy names, handlers and children of `src` into the fresh node `copy`
+static int node_copy_into(RouteNode *copy, const RouteNode *src) {
+    memcpy(copy->handlers, src->handlers, sizeof(copy->handlers));
+
+    if (src->name) {
+        size_t name_len = strlen(src->name);
+        copy->name = malloc(name_len + 1);
+        if (!copy->name) return -1;
+        memcpy(copy->name, src->name, name_len + 1);
+    }
+
+    for (int i = 0; i < src->child_count; i++) {
+        RouteNode *child = route_tree_clone(src->children[i]);
+        if (!child || node_add_child(copy, child) != 0) {
+            route_tree_free(child);
+            return -1;
+        }
+    }
+
+    if (src->param_child && !(copy->param_child = route_tree_clone(src->param_child))) return -1;
+    if (src->wildcard_child && !(copy->wildcard_child = route_tree_clone(src->wildcard_child))) return -1;
+    return 0;
+}
+
+RouteNode *route_tree_clone(const RouteNode *root) {
+    if (!root) return NULL;
+
+    RouteNode *copy = node_create(root->prefix, root->prefix_len);
+    if (!copy) return NULL;
+
+    if (node_copy_into(copy, root) != 0) {
+        route_tree_free(copy);
+        return NULL;
+    }
+    return copy;
+}
+
+static int tree_insert(RouteNode *root, const char *pattern, HTTPMethod method, RouteHandler handler, int replace) {
+    if (!root || !pattern || pattern[0] != '/' || !handler) return -1;
+    if (method < 0 || method >= ROUTE_METHOD_SLOTS) return -1;
+
+    RouteNode *node = root;
+    const char *p = pattern;
+    int params = 0;
+
+    while (*p) {
+        int at_segment_start = p > pattern && p[-1] == '/';
+
+        if (at_segment_start && (*p == ':' || *p == '*')) {
+            const char *name = p + 1;
+            const char *end = strchr(name, '/');
+            size_t name_len = end ? (size_t)(end - name) : strlen(name);
+            if (name_len == 0 || ++params > HTTP_MAX_PARAMS) return -1;
+
+            if (*p == '*') {
+                if (end) return -1;  // Wildcard must be the last segment
+                node = node_named_child(&node->wildcard_child, name, name_len);
+            } else {
+                node = node_named_child(&node->param_child, name, name_len);
+            }
+            if (!node) return -1;
+            p = name + name_len;
+            continue;
+        }
+
+        // Static run up to the next ":" or "*" segment
+        const char *run_end = p + 1;
+        while (*run_end && !(run_end[-1] == '/' && (*run_end == ':' || *run_end == '*'))) run_end++;
+        size_t run_len = (size_t)(run_end - p);
+
+        RouteNode *child = node_find_child(node, *p);
+        if (!child) {
+            child = node_create(p, run_len);
+            if (!child || node_add_child(node, child) != 0) {
+                route_tree_free(child);
+                return -1;
+            }
+            node = child;
+            p += run_len;
+            continue;
+        }
+
+        size_t common = 0;
+        while (common < child->prefix_len && common < run_len && child->prefix[common] == p[common]) common++;
+
+        if (common < child->prefix_len) {
+            child = node_split(node, child, common);
+            if (!child) return -1;
+        }
+        node = child;
+        p += common;
+    }
+
+    if (node->handlers[method] && !replace) return -1;
+    node->handlers[method] = handler;
+    return 0;
+}
+
+int route_tree_insert(RouteNode *root, const char *pattern, HTTPMethod method, RouteHandler handler) {
+    return tree_insert(root, pattern, method, handler, 0);
+}
+
+int route_tree_set(RouteNode *root, const char *pattern, HTTPMethod method, RouteHandler handler) {
+    return tree_insert(root, pattern, method, handler, 1);
+}
+
+// Depth-first match with backtracking: static, then parameter, then wildcard
+static RouteHandler match_node(const RouteNode *node, const char *path, size_t len, HTTPMethod method,
+                               HTTPRequest *request, int *path_matched) {
+    if (len == 0) {
+        if (node->handlers[method]) return node->handlers[method];
+        for (int m = 0; m < ROUTE_METHOD_SLOTS; m++) {
+            if (node->handlers[m]) *path_matched = 1;
+        }
+        // An empty wildcard still matches (e.g. "/static/*path" for "/static/")
+        if (!node->wildcard_child) return NULL;
+    }
+
+    if (len > 0) {
+        const RouteNode *child = node_find_child(node, path[0]);
+        if (child && child->prefix_len <= len && memcmp(child->prefix, path, child->prefix_len) == 0) {
+            RouteHandler handler = match_node(child, path + child->prefix_len, len - child->prefix_len,
+                                              method, request, path_matched);
+            if (handler) return handler;
+        }
+    }
+
+    if (node->param_child && len > 0 && request->param_count < HTTP_MAX_PARAMS) {
+        const char *slash = memchr(path, '/', len);
+        size_t segment_len = slash ? (size_t)(slash - path) : len;
+
+        if (segment_len > 0) {
+            int saved = request->param_count;
+            RouteParam *param = &request->params[request->param_count++];
+            param->name = node->param_child->name;
+            param->value = path;
+            param->value_len = segment_len;
+
+            RouteHandler handler = match_node(node->param_child, path + segment_len, len - segment_len,
+                                              method, request, path_matched);
+            if (handler) return handler;
+            request->param_count = saved;
+        }
+    }
+
+    if (node->wildcard_child && request->param_count < HTTP_MAX_PARAMS) {
+        const RouteNode *wildcard = node->wildcard_child;
+        if (wildcard->handlers[method]) {
+            RouteParam *param = &request->params[request->param_count++];
+            param->name = wildcard->name;
+            param->value = path;
+            param->value_len = len;
+            return wildcard->handlers[method];
+        }
+        for (int m = 0; m < ROUTE_METHOD_SLOTS; m++) {
+            if (wildcard->handlers[m]) *path_matched = 1;
+        }
+    }
+
+    return NULL;
+}
+
+RouteHandler route_tree_lookup(const RouteNode *root, const char *path, HTTPMethod method,
+                               HTTPRequest *request, int *path_matched) {
+    int matched = 0;
+    if (path_matched) *path_matched = 0;
+    if (!root || !path || !request || method < 0 || method >= ROUTE_METHOD_SLOTS) return NULL;
+
+    request->param_count = 0;
+    RouteHandler handler = match_node(root, path, strlen(path), method, request, &matched);
+    if (!handler) request->param_count = 0;
+    if (path_matched) *path_matched = matched;
+    return handler;
+}
@@ -5,37 +5,57 @@
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <errno.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
 
 // ===== Project Headers =====
 #include "router.h"
 #include "parser.h"
+#include "json.h"
+#include "arena.h"
+#include "rcu.h"
 #include "stream.h"
 #include "ai/prompt_router.h"
+#include "ai/prompt_cache.h"
+#include "ai/embeddings.h"
+#include "ai/tokenizer.h"
+#include "ai/stats.h"
+#include "metrics.h"
+#include "trace.h"
+#include "access_log.h"
+#include "static_files.h"
 #include "asm_utils.h"
+#include "utils.h"
 #include "server.h" 
 
 // ===== Constants =====
 #define MAX_CACHED_RESPONSES 16
-#define MAX_MIDDLEWARE 8
-#define MAX_ROUTE_PARAMS 8
 
 // ===== Security & Configuration Constants (NEW) =====
 #define MAX_PROMPT_SIZE 16384       // 16KB limit for prompt to prevent DoS
 #define MAX_LOG_PREVIEW 100         // Limit log output to prevent sensitive data leakage
 #define INITIAL_AI_BUF_SIZE 8192    // Starting buffer for AI response
+#define MAX_MODEL_NAME_SIZE 128     // Longest accepted "model" value
+#define MAX_EMBEDDING_BODY_SIZE 65536   // 64KB limit for an embeddings body
+#define MAX_EMBEDDING_INPUTS 256    // Inputs accepted in one embeddings request
+#define MAX_STATS_HOOKS 32          // Hooks listed by /stats
+#define MAX_STATS_REPLICAS 32       // Model replicas listed by /stats
+#define MAX_STATS_MODELS 32         // Models listed by /stats
+#define MAX_STATS_LATENCY 64        // Models and routes with latency listed by /stats
 
 // ===== Global Variables =====
-static RouteHashTable routes_table = {0};  // Hash table for routes
+// Immutable radix tree of registered routes, replaced wholesale on every change
+static RouteNode *_Atomic routes_tree = NULL;
+static pthread_mutex_t routes_update_lock = PTHREAD_MUTEX_INITIALIZER;  // Serializes writers only
 
 // Cached responses for common paths
 static RouteResponse cached_404_response = {0};
 static RouteResponse cached_root_response = {0};
-
-// Middleware functions
-static MiddlewareFunc middlewares[MAX_MIDDLEWARE] = {NULL};
-static int middleware_count = 0;
+static RouteResponse cached_root_keepalive_response = {0};
 
 // Error messages
 static const char* route_error_messages[] = {
@@ -43,197 +63,198 @@ static const char* route_error_messages[] = {
     "Memory allocation failed",
     "Invalid parameter",
     "Route not found",
-    "Internal server error"
+    "Internal server error",
+    "Method not allowed",
+    "Forbidden"
 };
 
 // ===== Helper Functions =====
 
-// (NEW) Helper: JSON String Escaping
-// Essential to prevent JSON Injection/Breaking
-static char* json_escape_str(const char* input) {
-    if (!input) return strdup("");
-    
-    size_t len = strlen(input);
-    // Worst case scenario: every character needs escaping
-    char* escaped = malloc((len * 2) + 1);
-    if (!escaped) return NULL;
-
-    size_t j = 0;
-    for (size_t i = 0; i < len; i++) {
-        switch (input[i]) {
-            case '"':  escaped[j++] = '\\'; escaped[j++] = '"'; break;
-            case '\\': escaped[j++] = '\\'; escaped[j++] = '\\'; break;
-            case '\b': escaped[j++] = '\\'; escaped[j++] = 'b'; break;
-            case '\f': escaped[j++] = '\\'; escaped[j++] = 'f'; break;
-            case '\n': escaped[j++] = '\\'; escaped[j++] = 'n'; break;
-            case '\r': escaped[j++] = '\\'; escaped[j++] = 'r'; break;
-            case '\t': escaped[j++] = '\\'; escaped[j++] = 't'; break;
-            default:
-                // Filter out other control characters (ASCII < 32) to keep JSON clean
-                if ((unsigned char)input[i] < 32) {
-                    escaped[j++] = ' '; 
-                } else {
-                    escaped[j++] = input[i];
-                }
-                break;
+// Chat request fields extracted from the JSON body
+typedef struct {
+    JsonCursor prompt;
+    JsonCursor last_user_message;   // Fallback prompt: content of the last "user" message
+    JsonCursor model;
+    int has_prompt;
+    int has_user_message;
+    int has_model;
+    int stream;
+    int max_tokens;
+} ChatBody;
+
+// Pick the content of the last user message out of an OpenAI-style messages[] array
+static void scan_chat_messages(const JsonCursor *messages, ChatBody *body) {
+    JsonIter it;
+    JsonCursor message;
+    if (json_array_begin(messages, &it) != 0) return;
+
+    while (json_array_next(&it, &message) == 1) {
+        if (json_cursor_type(&message) != JSON_OBJECT) continue;
+
+        JsonIter fields;
+        JsonSlice key;
+        JsonCursor value, content;
+        int is_user = 0, has_content = 0;
+
+        if (json_object_begin(&message, &fields) != 0) continue;
+        while (json_object_next(&fields, &key, &value) == 1) {
+            if (json_key_equals(key, "role")) {
+                JsonSlice role;
+                is_user = json_get_string_raw(&value, &role) == 0 &&
+                          role.len == 4 && memcmp(role.ptr, "user", 4) == 0;
+            } else if (json_key_equals(key, "content") && json_cursor_type(&value) == JSON_STRING) {
+                content = value;
+                has_content = 1;
+            }
+        }
+
+        if (is_user && has_content) {
+            body->last_user_message = content;
+            body->has_user_message = 1;
         }
     }
-    escaped[j] = '\0';
-    return escaped;
 }
 
-// Simple helper to extract a string from JSON body (Basic implementation)
-// Assumes input is like {"key": "value"}
-static char* extract_json_value(const char *json, const char *key) {
-    if (!json || !key) return NULL;
-    
-    char search_key[128];
-    snprintf(search_key, sizeof(search_key), "\"%s\"", key);
-    
-    char *key_pos = strstr(json, search_key);
-    if (!key_pos) return NULL;
-    
-    key_pos += strlen(search_key);
-    while (*key_pos && (*key_pos == ' ' || *key_pos == ':')) {
-        key_pos++;
-    }
-    
-    if (*key_pos == '"') {
-        key_pos++;
-        char *end = strchr(key_pos, '"');
-        if (end) {
-            size_t len = end - key_pos;
-            char *value = malloc(len + 1);
-            if (value) {
-                strncpy(value, key_pos, len);
-                value[len] = '\0';
-                return value;
+// Single pass over the root object; returns -1 if the body is not a JSON object
+static int parse_chat_body(const JsonDoc *doc, ChatBody *body) {
+    JsonCursor root, value;
+    JsonIter it;
+    JsonSlice key;
+
+    memset(body, 0, sizeof(ChatBody));
+    if (json_doc_root(doc, &root) != 0 || json_object_begin(&root, &it) != 0) return -1;
+
+    int rc;
+    while ((rc = json_object_next(&it, &key, &value)) == 1) {
+        JSONType type = json_cursor_type(&value);
+
+        if (json_key_equals(key, "prompt") && type == JSON_STRING) {
+            body->prompt = value;
+            body->has_prompt = 1;
+        } else if (json_key_equals(key, "model") && type == JSON_STRING) {
+            body->model = value;
+            body->has_model = 1;
+        } else if (json_key_equals(key, "messages") && type == JSON_ARRAY) {
+            scan_chat_messages(&value, body);
+        } else if (json_key_equals(key, "stream")) {
+            json_get_bool(&value, &body->stream);
+        } else if (json_key_equals(key, "max_tokens")) {
+            int64_t max_tokens;
+            if (json_get_int64(&value, &max_tokens) == 0 && max_tokens > 0 && max_tokens <= INT32_MAX) {
+                body->max_tokens = (int)max_tokens;
             }
         }
     }
-    return NULL;
-}
 
-// Helper function to check if a method matches
-static int method_matches(HTTPMethod method1, HTTPMethod method2) {
-    return method1 == method2;
+    return rc == 0 ? 0 : -1;
 }
 
-// Check if a route path matches a request path with parameters
-static int route_matches_with_params(const char *route_path, const char *request_path) {
-    char route_copy[256];
-    char request_copy[256];
-    
-    strncpy(route_copy, route_path, sizeof(route_copy) - 1);
-    strncpy(request_copy, request_path, sizeof(request_copy) - 1);
-    
-    char *route_token = strtok(route_copy, "/");
-    char *request_token = strtok(request_copy, "/");
-    
-    while (route_token != NULL && request_token != NULL) {
-        if (route_token[0] != ':' && strcmp(route_token, request_token) != 0) {
-            return 0;  // No match
+// Unescape the "input" of an embeddings body (a string or an array of
+// strings) into `text`; returns the number of inputs or -1 if malformed.
+// Unescaped strings plus their terminators never outgrow the quoted originals.
+static int collect_embedding_inputs(const JsonCursor *input, const char **inputs, char *text, size_t text_size) {
+    size_t len;
+    if (json_cursor_type(input) == JSON_STRING) {
+        if (json_get_string(input, text, text_size, &len) != 0) return -1;
+        inputs[0] = text;
+        return 1;
+    }
+
+    JsonIter it;
+    JsonCursor element;
+    int count = 0;
+    if (json_cursor_type(input) != JSON_ARRAY || json_array_begin(input, &it) != 0) return -1;
+
+    while (json_array_next(&it, &element) == 1) {
+        if (count >= MAX_EMBEDDING_INPUTS || json_cursor_type(&element) != JSON_STRING ||
+            json_get_string(&element, text, text_size, &len) != 0) {
+            return -1;
         }
-        
-        route_token = strtok(NULL, "/");
-        request_token = strtok(NULL, "/");
+        inputs[count++] = text;
+        text += len + 1;
+        text_size -= len + 1;
     }
-    
-    // Both should reach end
-    return route_token == NULL && request_token == NULL;
+    return count > 0 ? count : -1;
+}
+
+// IMF-fixdate, as used by Date and Last-Modified
+static size_t http_date(time_t when, char *buf, size_t size) {
+    struct tm tm_info;
+    gmtime_r(&when, &tm_info);
+    return strftime(buf, size, "%a, %d %b %Y %H:%M:%S GMT", &tm_info);
 }
 
-// ===== Hash Table Functions =====
+// Width reserved for the Content-Length value; patched once the body is known
+#define CONTENT_LENGTH_WIDTH 10
 
-// Simple hash function for strings (djb2 algorithm)
-static unsigned int hash_string(const char *str) {
-    unsigned long hash = 5381;
-    int c;
-    while ((c = *str++)) {
-        hash = ((hash << 5) + hash) + c; /* hash * 33 + c */
+// Write the status line and headers into `w`. The caller appends the body
+// straight after them and calls finish_http_response(), which fills in the
+// Content-Length placeholder in place (unused digits become trailing OWS).
+static void begin_http_response(const RouteResponse *response, JsonWriter *w, int status_code,
+                                const char *status_message, const char *content_type,
+                                size_t *length_offset, size_t *body_offset) {
+    char date_buf[64];
+    size_t date_len = http_date(time(NULL), date_buf, sizeof(date_buf));
+    
+    char status_line[64];
+    int status_len = snprintf(status_line, sizeof(status_line), "HTTP/1.1 %d ", status_code);
+    
+    json_write_raw(w, status_line, (size_t)status_len);
+    json_write_cstr(w, status_message);
+    json_write_cstr(w, "\r\nDate: ");
+    json_write_raw(w, date_buf, date_len);
+    json_write_cstr(w, "\r\nServer: AIONIC/1.0\r\nContent-Type: ");
+    json_write_cstr(w, content_type);
+    json_write_cstr(w, "\r\nContent-Length: ");
+    *length_offset = w->len;
+    json_write_raw(w, "          ", CONTENT_LENGTH_WIDTH);
+    // The server only keeps the connection open after a 200
+    if (response->keep_alive && status_code == 200) {
+        json_write_cstr(w, "\r\nConnection: keep-alive\r\n\r\n");
+    } else {
+        json_write_cstr(w, "\r\nConnection: close\r\n\r\n");
     }
-    return hash % HASH_TABLE_SIZE;
+    *body_offset = w->len;
 }
 
-// Initialize the hash table
-static void hash_table_init(RouteHashTable *table) {
-    for (int i = 0; i < HASH_TABLE_SIZE; i++) {
-        table->buckets[i] = NULL;
-    }
-    pthread_rwlock_init(&table->lock, NULL);
+static void fill_content_length(JsonWriter *w, size_t length_offset, size_t body_offset) {
+    char digits[CONTENT_LENGTH_WIDTH + 1];
+    int digits_len = snprintf(digits, sizeof(digits), "%zu", w->len - body_offset);
+    memcpy(w->buf + length_offset, digits, (size_t)digits_len);
 }
 
-// Add a route to the hash table
-static int hash_table_add(RouteHashTable *table, Route *route) {
-    unsigned int index = hash_string(route->path);
+static int finish_http_response(RouteResponse *response, JsonWriter *w, size_t length_offset,
+                                size_t body_offset, int status_code, const char *status_message) {
+    if (w->failed) {
+        json_writer_free(w);
+        return -1;
+    }
     
-    pthread_rwlock_wrlock(&table->lock);
+    fill_content_length(w, length_offset, body_offset);
     
-    // Add to the beginning of the bucket
-    route->next = table->buckets[index];
-    table->buckets[index] = route;
+    response->data = json_writer_finish(w, &response->length);
+    if (!response->data) return -1;
     
-    pthread_rwlock_unlock(&table->lock);
+    response->owns_data = response->arena == NULL;
+    response->status_code = status_code;
+    response->status_message = (char *)status_message;
+    response->is_streaming = 0;
     
     return 0;
 }
 
-// Find a route in the hash table
-static Route *hash_table_find(RouteHashTable *table, const char *path, HTTPMethod method) {
-    unsigned int index = hash_string(path);
-    
-    pthread_rwlock_rdlock(&table->lock);
-    
-    Route *current = table->buckets[index];
-    while (current != NULL) {
-        if (strcmp(current->path, path) == 0 && method_matches(current->method, method)) {
-            pthread_rwlock_unlock(&table->lock);
-            return current;
-        }
-        current = current->next;
-    }
-    
-    pthread_rwlock_unlock(&table->lock);
-    return NULL;
+// Response buffers come from the request arena when there is one
+static int init_response_writer(const RouteResponse *response, JsonWriter *w, size_t initial_capacity) {
+    return json_writer_init_arena(w, response->arena, initial_capacity);
 }
 
-// Find a route with parameters in the hash table
-static Route *hash_table_find_with_params(RouteHashTable *table, const char *path, HTTPMethod method) {
-    // We need to check all routes for parameter matching
-    pthread_rwlock_rdlock(&table->lock);
-    
-    for (int i = 0; i < HASH_TABLE_SIZE; i++) {
-        Route *current = table->buckets[i];
-        while (current != NULL) {
-            if (method_matches(current->method, method) && route_matches_with_params(current->path, path)) {
-                pthread_rwlock_unlock(&table->lock);
-                return current;
-            }
-            current = current->next;
-        }
-    }
-    
-    pthread_rwlock_unlock(&table->lock);
-    return NULL;
+// Scratch memory for handlers: request arena when present, heap otherwise
+static void *scratch_alloc(const HTTPRequest *request, size_t size) {
+    return request->arena ? arena_alloc(request->arena, size) : malloc(size);
 }
 
-// Free all routes in the hash table
-static void hash_table_free(RouteHashTable *table) {
-    pthread_rwlock_wrlock(&table->lock);
-    
-    for (int i = 0; i < HASH_TABLE_SIZE; i++) {
-        Route *current = table->buckets[i];
-        while (current != NULL) {
-            Route *next = current->next;
-            free(current->path);
-            free(current);
-            current = next;
-        }
-        table->buckets[i] = NULL;
-    }
-    
-    pthread_rwlock_unlock(&table->lock);
-    pthread_rwlock_destroy(&table->lock);
+static void scratch_free(const HTTPRequest *request, void *ptr) {
+    if (!request->arena) free(ptr);
 }
 
 // Helper function to create a complete HTTP response (optimized)
@@ -241,81 +262,45 @@ static int create_http_response(RouteResponse *response, const char *body, size_
                                const char *content_type, int status_code, const char *status_message) {
     if (!response || !body) return -1;
     
-    // Calculate required buffer size
-    time_t now;
-    time(&now);
-    struct tm *tm_info = gmtime(&now);
-    char date_buf[128];
-    strftime(date_buf, sizeof(date_buf), "%a, %d %b %Y %H:%M:%S GMT", tm_info);
+    JsonWriter w;
+    size_t length_offset, body_offset;
+    if (init_response_writer(response, &w, body_length + 192) != 0) return -1;
     
-    // Calculate headers size
-    size_t headers_size = 128;  // Base size
-    headers_size += strlen(date_buf);
-    headers_size += strlen(content_type);
-    headers_size += 32;  
+    begin_http_response(response, &w, status_code, status_message, content_type, &length_offset, &body_offset);
+    json_write_raw(&w, body, body_length);
     
-    size_t total_size = headers_size + body_length;
-    
-    // Allocate response buffer
-    response->data = malloc(total_size);
-    if (!response->data) return -1;
-    
-    // Build response directly in memory
-    char *ptr = response->data;
-    
-    // Add HTTP status line
-    ptr += sprintf(ptr, "HTTP/1.1 %d %s\r\n", status_code, status_message);
-    
-    // Add headers
-    ptr += sprintf(ptr, "Date: %s\r\n", date_buf);
-    ptr += sprintf(ptr, "Server: AIONIC/1.0\r\n");
-    ptr += sprintf(ptr, "Content-Type: %s\r\n", content_type);
-    ptr += sprintf(ptr, "Content-Length: %zu\r\n", body_length);
-    ptr += sprintf(ptr, "Connection: close\r\n\r\n");
-    
-    // Add body
-    memcpy(ptr, body, body_length);
-    
-    // Set response properties
-    response->length = (ptr - response->data) + body_length;
-    response->status_code = status_code;
-    response->status_message = (char *)status_message;
-    response->is_streaming = 0;
-    
-    return 0;
+    return finish_http_response(response, &w, length_offset, body_offset, status_code, status_message);
 }
 
 // Create error response with consistent format
 int create_error_response(RouteResponse *response, RouteError error, int status_code) {
-    const char *error_message = route_error_messages[error];
-    
-    // Create JSON error response
-    char *json_response = malloc(256);
-    if (!json_response) return ROUTE_ERROR_MEMORY;
-    
-    snprintf(json_response, 256, 
-            "{\"error\": \"%s\", \"code\": %d, \"timestamp\": %ld}", 
-            error_message, error, time(NULL));
-    
-    // Create HTTP response
-    int result = create_http_response(response, json_response, strlen(json_response), 
-                                    "application/json", status_code, error_message);
+    if (!response) return -1;
     
-    free(json_response);
-    return result;
+    const char *error_message = route_error_messages[error];
+    JsonWriter w;
+    size_t length_offset, body_offset;
+    if (init_response_writer(response, &w, 384) != 0) return ROUTE_ERROR_MEMORY;
+    
+    // {"error": "...", "code": N, "timestamp": T}
+    begin_http_response(response, &w, status_code, error_message, "application/json", &length_offset, &body_offset);
+    json_write_cstr(&w, "{\"error\": \"");
+    json_write_cstr(&w, error_message);
+    json_write_cstr(&w, "\", \"code\": ");
+    json_write_int(&w, error);
+    json_write_cstr(&w, ", \"timestamp\": ");
+    json_write_int(&w, (int64_t)time(NULL));
+    json_write_cstr(&w, "}");
+    
+    return finish_http_response(response, &w, length_offset, body_offset, status_code, error_message);
 }
 
-// Copy a response to another (for cached responses)
-static int copy_route_response(const RouteResponse *source, RouteResponse *dest) {
-    if (!source || !dest) return -1;
+// Point a response at a shared cached buffer (no copy; never freed per request)
+static int use_cached_response(const RouteResponse *source, RouteResponse *dest) {
+    if (!source || !dest || !source->data) return -1;
     
-    // Allocate memory for the data
-    dest->data = malloc(source->length);
-    if (!dest->data) return -1;
-    
-    // Copy the data
-    memcpy(dest->data, source->data, source->length);
+    dest->data = source->data;
     dest->length = source->length;
+    dest->owns_data = 0;
     dest->status_code = source->status_code;
     dest->status_message = source->status_message;
     dest->is_streaming = source->is_streaming;
@@ -323,6 +308,11 @@ static int copy_route_response(const RouteResponse *source, RouteResponse *dest)
     return 0;
 }
 
+// Cached root page matching the request's connection mode
+static const RouteResponse *cached_root_for(const RouteResponse *response) {
+    return response->keep_alive ? &cached_root_keepalive_response : &cached_root_response;
+}
+
 // Initialize cached responses
 static void init_cached_responses() {
     // ===== 1. 404 PAGE (THE VOID) =====
@@ -566,50 +556,116 @@ static void init_cached_responses() {
     
     create_http_response(&cached_root_response, root_html, strlen(root_html), 
                          "text/html", 200, "OK");
+    
+    cached_root_keepalive_response.keep_alive = 1;
+    create_http_response(&cached_root_keepalive_response, root_html, strlen(root_html), 
+                         "text/html", 200, "OK");
 
 }
 
 // ===== Core Routing Functions =====
 
-// Register a new route with parameter support
-int register_route(const char *path, HTTPMethod method, int (*handler)(Server *, HTTPRequest *, RouteResponse *)) {
-    Route *route = malloc(sizeof(Route));
-    if (!route) return -1;
-    
-    route->path = strdup(path);
-    route->method = method;
-    route->handler = handler;
-    route->param_count = 0;
-    route->next = NULL;
-    
-    // Parse path for parameters (e.g., /users/:id)
-    char *path_copy = strdup(path);
-    char *token = strtok(path_copy, "/");
-    while (token != NULL && route->param_count < MAX_ROUTE_PARAMS) {
-        if (token[0] == ':') {
-            // This is a parameter
-            strncpy(route->param_names[route->param_count], token + 1, 31);
-            route->param_names[route->param_count][31] = '\0';
-            route->param_count++;
-        }
-        token = strtok(NULL, "/");
+static void free_route_tree(void *tree) {
+    route_tree_free((RouteNode *)tree);
+}
+
+// Apply `update` to a copy of the live route table and publish the copy.
+// The old table is freed once every worker has passed a quiescent state.
+int router_update_routes(int (*update)(RouteNode *tree, void *ctx), void *ctx) {
+    if (!update) return -1;
+    
+    pthread_mutex_lock(&routes_update_lock);
+    
+    RouteNode *old_tree = atomic_load(&routes_tree);
+    RouteNode *new_tree = old_tree ? route_tree_clone(old_tree) : route_tree_create();
+    if (!new_tree || update(new_tree, ctx) != 0) {
+        pthread_mutex_unlock(&routes_update_lock);
+        route_tree_free(new_tree);
+        return -1;
     }
-    free(path_copy);
     
-    // Add to hash table
-    return hash_table_add(&routes_table, route);
+    rcu_assign_pointer(routes_tree, new_tree);
+    pthread_mutex_unlock(&routes_update_lock);
+    
+    rcu_retire(old_tree, free_route_tree);
+    return 0;
 }
 
-// Register a middleware function
-int register_middleware(MiddlewareFunc middleware) {
-    if (middleware_count >= MAX_MIDDLEWARE) {
-        return -1;  
-    }
+// Replace the whole route table (e.g. after a configuration reload)
+int router_publish_routes(RouteNode *tree) {
+    if (!tree) return -1;
+    
+    pthread_mutex_lock(&routes_update_lock);
+    RouteNode *old_tree = atomic_exchange(&routes_tree, tree);
+    pthread_mutex_unlock(&routes_update_lock);
     
-    middlewares[middleware_count++] = middleware;
+    rcu_retire(old_tree, free_route_tree);
     return 0;
 }
 
+typedef struct {
+    const char *path;
+    HTTPMethod method;
+    RouteHandler handler;
+    int replace;
+} RouteChange;
+
+static int apply_route_change(RouteNode *tree, void *ctx) {
+    RouteChange *change = (RouteChange *)ctx;
+    if (change->replace) {
+        return route_tree_set(tree, change->path, change->method, change->handler);
+    }
+    return route_tree_insert(tree, change->path, change->method, change->handler);
+}
+
+// Register a new route with parameter support (e.g. /v1/models/:id)
+int register_route(const char *path, HTTPMethod method, RouteHandler handler) {
+    RouteChange change = {path, method, handler, 0};
+    int result = router_update_routes(apply_route_change, &change);
+    
+    if (result != 0) {
+        char log_msg[512];
+        snprintf(log_msg, sizeof(log_msg), "Failed to register route %s (invalid or duplicate)", path);
+        log_message("ROUTER", log_msg);
+    }
+    return result;
+}
+
+// Add a route or swap the handler of an existing one
+int replace_route(const char *path, HTTPMethod method, RouteHandler handler) {
+    RouteChange change = {path, method, handler, 1};
+    int result = router_update_routes(apply_route_change, &change);
+    
+    if (result != 0) {
+        char log_msg[512];
+        snprintf(log_msg, sizeof(log_msg), "Failed to replace route %s", path);
+        log_message("ROUTER", log_msg);
+    }
+    return result;
+}
+
+// Register a middleware function for one phase of the request pipeline
+int register_middleware(HookPhase phase, MiddlewareFunc middleware) {
+    return pipeline_register("middleware", phase, middleware);
+}
+
+// Route pattern of a matched request: each captured parameter is put back
+// as ":name", so /v1/models/abc is counted under /v1/models/:id
+static void route_stats_key(const HTTPRequest *request, char *key, size_t key_size) {
+    const char *path = request->path;
+    size_t length = 0;
+    
+    for (int i = 0; i < request->param_count && length < key_size; i++) {
+        const RouteParam *param = &request->params[i];
+        length += (size_t)snprintf(key + length, key_size - length, "%.*s:%s",
+                                   (int)(param->value - path), path, param->name);
+        path = param->value + param->value_len;
+    }
+    if (length < key_size) {
+        snprintf(key + length, key_size - length, "%s", path);
+    }
+}
+
 // Route a request to the appropriate handler
 int route_request(Server *server, HTTPRequest *request, RouteResponse *response) {
     if (!request || !response) {
@@ -617,50 +673,53 @@ int route_request(Server *server, HTTPRequest *request, RouteResponse *response)
     }
     
     memset(response, 0, sizeof(RouteResponse));
-    
-    // Apply middleware in order
-    for (int i = 0; i < middleware_count; i++) {
-        int result = middlewares[i](request, response);
-        if (result != 0) {
-            // Middleware returned an error, stop processing
-            return result;
-        }
-        
-        // If middleware created a complete response, return it
-        if (response->data != NULL) {
-            return 0;
-        }
+    response->arena = request->arena;
+    response->keep_alive = request->keep_alive;
+    
+    // Pre-route hooks (middleware and plugins) in registration order
+    HookContext hook = {request->client_fd, request, response, NULL, 0};
+    int result = pipeline_run(HOOK_PRE_ROUTE, server, &hook);
+    if (result < 0) {
+        // A hook rejected the request, stop processing
+        return result;
     }
     
-    // Check for cached responses first
-    if (strcmp(request->path, "/") == 0 && method_matches(request->method, HTTP_GET)) {
-        return copy_route_response(&cached_root_response, response);
+    // If a hook created a complete response, return it
+    if (result == HOOK_HANDLED || response->data != NULL) {
+        return 0;
     }
     
-    // Look for exact match in hash table
-    Route *route = hash_table_find(&routes_table, request->path, request->method);
+    // Single walk over the path; parameters are captured on the request.
+    // The snapshot stays valid until this worker's next quiescent state.
+    int path_matched = 0;
+    const RouteNode *tree = rcu_dereference(routes_tree);
+    RouteHandler handler = route_tree_lookup(tree, request->path, request->method, request, &path_matched);
     
-    if (route) {
-        return route->handler(server, request, response);
+    if (handler) {
+        uint64_t start = get_current_time_ns();
+        int handled = handler(server, request, response);
+        
+        char key[STATS_NAME_MAX];
+        route_stats_key(request, key, sizeof(key));
+        stats_record_latency(STATS_SCOPE_ROUTE, key, STATS_LATENCY, (get_current_time_ns() - start) / 1000);
+        return handled;
     }
     
-    // If no exact match, try routes with parameters
-    route = hash_table_find_with_params(&routes_table, request->path, request->method);
-    
-    if (route) {
-        return route->handler(server, request, response);
+    if (path_matched) {
+        return create_error_response(response, ROUTE_ERROR_METHOD_NOT_ALLOWED, 405);
     }
     
     // No matching route found - return cached 404 response
-    return copy_route_response(&cached_404_response, response);
+    return use_cached_response(&cached_404_response, response);
 }
 
 // Free route response resources
 void free_route_response(RouteResponse *response) {
     if (!response) return;
     
-    if (response->data) free(response->data);
+    if (response->data && response->owns_data) free(response->data);
     if (response->stream_data) free(response->stream_data);
+    if (response->file) static_file_release(response->file);
     
     for (int i = 0; i < response->header_count; i++) {
         if (response->headers[i]) free(response->headers[i]);
@@ -677,7 +736,8 @@ int handle_chat_request(Server *server, HTTPRequest *request, RouteResponse *res
     
     if (!request || !response) return -1;
     
-    char *prompt = NULL;
+    uint64_t start = get_current_time_ns();
+    char model_buf[MAX_MODEL_NAME_SIZE];
     char *model_name = NULL;
     int status = -1;
 
@@ -686,150 +746,580 @@ int handle_chat_request(Server *server, HTTPRequest *request, RouteResponse *res
         return create_error_response(response, ROUTE_ERROR_INVALID_PARAM, 413); // 413 Payload Too Large
     }
 
+    // Prompt, structural index and AI response share one scratch allocation
+    size_t prompt_size = request->body_length + 1;
+    size_t index_slots = request->body_length + 1;
+    size_t ai_buf_size = INITIAL_AI_BUF_SIZE;
+    char *scratch = scratch_alloc(request, prompt_size + index_slots * sizeof(uint32_t) + ai_buf_size + 8);
+    if (!scratch) {
+        return create_error_response(response, ROUTE_ERROR_MEMORY, 500);
+    }
+    uint32_t *index_storage = (uint32_t *)(scratch + ((prompt_size + 7) & ~(size_t)7));
+    char *ai_response = (char *)(index_storage + index_slots);
+    char *prompt = scratch;
+
     // === PARSE REQUEST BODY ===
-    // Try to extract 'prompt' from JSON
-    prompt = extract_json_value(request->body, "prompt");
-    // Try to extract 'model' (optional), default to NULL
-    model_name = extract_json_value(request->body, "model");
-
-    if (!prompt) {
-        // If parsing fails, try using the whole body as prompt (fallback)
-        // Ensure we don't exceed buffer safety here again
-        size_t copy_len = (request->body_length < MAX_PROMPT_SIZE) ? request->body_length : MAX_PROMPT_SIZE;
-        prompt = malloc(copy_len + 1);
-        if(prompt) {
-            strncpy(prompt, request->body, copy_len);
-            prompt[copy_len] = '\0';
-        } else {
-            status = create_error_response(response, ROUTE_ERROR_MEMORY, 500);
-            goto cleanup;
+    // One structural pass, then prompt / model / messages / stream / max_tokens
+    // are picked up in a single walk over the root object
+    JsonDoc doc;
+    ChatBody body;
+    uint64_t phase_start = trace_now();
+    int have_body = json_doc_parse_into(&doc, request->body, request->body_length,
+                                        index_storage, index_slots) == 0 &&
+                    parse_chat_body(&doc, &body) == 0;
+    trace_phase(TRACE_JSON, phase_start);
+
+    // Unescaping never makes a string longer, so the body size bounds the prompt
+    int have_prompt = 0;
+    if (have_body) {
+        if (body.has_prompt) {
+            have_prompt = json_get_string(&body.prompt, prompt, prompt_size, NULL) == 0;
+        } else if (body.has_user_message) {
+            have_prompt = json_get_string(&body.last_user_message, prompt, prompt_size, NULL) == 0;
         }
+
+        if (body.has_model && json_get_string(&body.model, model_buf, sizeof(model_buf), NULL) == 0) {
+            model_name = model_buf;
+        }
+    }
+
+    if (!have_prompt) {
+        // If parsing fails, use the whole body as prompt (fallback)
+        memcpy(prompt, request->body, request->body_length);
+        prompt[request->body_length] = '\0';
     }
 
     // 2. Secure Logging: Mask sensitive data & Truncate
     // Only print the first MAX_LOG_PREVIEW characters to avoid flooding logs
     size_t prompt_len = strlen(prompt);
     if (prompt_len > MAX_LOG_PREVIEW) {
-        printf("[ROUTER] Received prompt (truncated): %.100s... [Length: %zu]\n", prompt, prompt_len);
+        log_debug("[ROUTER] Received prompt (truncated): %.100s... [Length: %zu]", prompt, prompt_len);
     } else {
-        printf("[ROUTER] Received prompt: %s\n", prompt);
+        log_debug("[ROUTER] Received prompt: %s", prompt);
     }
 
-    // 3. Dynamic Buffer for AI Response
-    size_t ai_buf_size = INITIAL_AI_BUF_SIZE; 
-    char *ai_response = (char *)malloc(ai_buf_size);
-    
-    if (ai_response) {
-        memset(ai_response, 0, ai_buf_size);
-        
-        // === CALL THE REAL AI ROUTER ===
-        int route_result = prompt_router_route(prompt, model_name, ai_response, ai_buf_size);
+    // 3. Call the AI router
+    // The prompt's tokens (words without a vocabulary) bound the completion
+    long prompt_tokens = tokenizer_count_tokens(prompt, prompt_len);
+    ai_response[0] = '\0';
+    PromptRequest prompt_request = {
+        .prompt = prompt,
+        .model_name = model_name,
+        .max_tokens = have_body ? body.max_tokens : 0,
+        .prompt_tokens = prompt_tokens > 0 && prompt_tokens <= INT32_MAX ? (int)prompt_tokens : 0,
+        .stream = have_body ? body.stream : 0   // Upstream call is still buffered
+    };
+    const char *served_model = NULL;
+    char cached_model[MAX_MODEL_NAME_SIZE];
+    int from_cache = 0;
+    int route_result;
+    
+    // Near-identical prompts on this route are answered from the prompt cache
+    phase_start = trace_now();
+    uint64_t upstream_start = access_log_now();
+    PromptSketch sketch;
+    int have_sketch = prompt_cache_sketch(&sketch, request->path, &prompt_request) == 0;
+    if (have_sketch && prompt_cache_lookup(&sketch, ai_response, ai_buf_size,
+                                           cached_model, sizeof(cached_model)) == 0) {
+        served_model = cached_model;
+        from_cache = 1;
+        route_result = 0;
+    } else {
+        route_result = prompt_router_route_request(&prompt_request, ai_response, ai_buf_size, &served_model);
+        if (route_result == 0 && have_sketch) {
+            prompt_cache_store(&sketch, ai_response, served_model);
+        }
+    }
+    if (have_sketch) {
+        prompt_cache_sketch_free(&sketch);
+    }
+    trace_phase(TRACE_UPSTREAM, phase_start);
+    access_log_note_upstream(served_model ? served_model : model_name, from_cache ? 0 : upstream_start, from_cache);
+    
+    if (route_result == 0) {
+        // 4. SECURITY: Escape JSON special characters while writing the
+        // body straight into the response buffer
+        JsonWriter w;
+        size_t length_offset, body_offset;
         
-        if (route_result == 0) {
-            // 4. SECURITY: Escape JSON special characters
-            char *safe_ai_response = json_escape_str(ai_response);
-            
-            if (safe_ai_response) {
-                // Calculate required size for final JSON dynamically
-                size_t response_len = strlen(safe_ai_response) + strlen(model_name ? model_name : "default") + 128;
-                char *json_output = (char *)malloc(response_len);
-                
-                if (json_output) {
-                    snprintf(json_output, response_len, 
-                            "{\"response\": \"%s\", \"model\": \"%s\", \"status\": \"success\"}", 
-                            safe_ai_response, model_name ? model_name : "default");
-                    
-                    status = create_http_response(response, json_output, strlen(json_output), 
-                                             "application/json", 200, "OK");
-                    free(json_output);
-                } else {
-                    status = create_error_response(response, ROUTE_ERROR_MEMORY, 500);
-                }
-                free(safe_ai_response); // Important: Free escaped string
-            } else {
-                status = create_error_response(response, ROUTE_ERROR_MEMORY, 500);
+        phase_start = trace_now();
+        if (init_response_writer(response, &w, strlen(ai_response) + 256) == 0) {
+            begin_http_response(response, &w, 200, "OK", "application/json", &length_offset, &body_offset);
+            json_write_cstr(&w, "{\"response\": ");
+            json_write_string(&w, ai_response, strlen(ai_response));
+            json_write_cstr(&w, ", \"model\": ");     // The model that answered, possibly a fallback
+            json_write_string(&w, served_model, strlen(served_model));
+            if (from_cache) {
+                json_write_cstr(&w, ", \"cached\": true");
             }
-        } else {
-            // Router returned an error
-            const char *error_msg = "AI Router Error: Failed to process request";
-            status = create_http_response(response, error_msg, strlen(error_msg), 
-                                         "application/json", 502, "Bad Gateway");
+            if (prompt_request.prompt_tokens > 0) {
+                json_write_cstr(&w, ", \"usage\": {\"prompt_tokens\": ");
+                json_write_int(&w, prompt_request.prompt_tokens);
+                json_write_cstr(&w, "}");
+            }
+            json_write_cstr(&w, ", \"status\": \"success\"}");
+            status = finish_http_response(response, &w, length_offset, body_offset, 200, "OK");
         }
-        free(ai_response);
+        trace_phase(TRACE_SERIALIZE, phase_start);
+        
+        if (status != 0) {
+            status = create_error_response(response, ROUTE_ERROR_MEMORY, 500);
+        } else if (!from_cache) {
+            stats_record_successful_request(served_model, (double)(get_current_time_ns() - start) / 1e6,
+                                            prompt_request.prompt_tokens);
+        }
+    } else if (route_result == PROMPT_ROUTE_TOO_LONG) {
+        const char *error_msg = "{\"error\": \"Prompt exceeds the model's context window\"}";
+        status = create_http_response(response, error_msg, strlen(error_msg),
+                                     "application/json", 400, "Bad Request");
+    } else if (route_result == PROMPT_ROUTE_UNAVAILABLE) {
+        // Every model in the fallback chain is shedding load: fail fast
+        const char *error_msg = "{\"error\": \"AI model temporarily unavailable\"}";
+        status = create_http_response(response, error_msg, strlen(error_msg),
+                                     "application/json", 503, "Service Unavailable");
     } else {
-        status = create_error_response(response, ROUTE_ERROR_MEMORY, 500);
+        // Router returned an error
+        const char *error_msg = "AI Router Error: Failed to process request";
+        status = create_http_response(response, error_msg, strlen(error_msg), 
+                                     "application/json", 502, "Bad Gateway");
     }
 
-cleanup:
-    // === CLEANUP ===
-    if (prompt) free(prompt);
-    if (model_name) free(model_name);
+    scratch_free(request, scratch);
+    return status;
+}
 
+// Function to handle embedding requests; concurrent requests for the same
+// model are coalesced into one upstream call by the embedding batcher
+int handle_embeddings_request(Server *server, HTTPRequest *request, RouteResponse *response) {
+    (void)server; // Unused
+    
+    if (!request || !response) return -1;
+    
+    uint64_t start = get_current_time_ns();
+    if (!request->body || request->body_length > MAX_EMBEDDING_BODY_SIZE) {
+        return create_error_response(response, ROUTE_ERROR_INVALID_PARAM, 413); // 413 Payload Too Large
+    }
+    
+    // Input pointers, unescaped inputs and structural index share one scratch allocation
+    size_t pointers_size = MAX_EMBEDDING_INPUTS * sizeof(char *);
+    size_t text_size = (request->body_length + 8) & ~(size_t)7;
+    size_t index_slots = request->body_length + 1;
+    char *scratch = scratch_alloc(request, pointers_size + text_size + index_slots * sizeof(uint32_t));
+    if (!scratch) {
+        return create_error_response(response, ROUTE_ERROR_MEMORY, 500);
+    }
+    const char **inputs = (const char **)scratch;
+    char *text = scratch + pointers_size;
+    uint32_t *index_storage = (uint32_t *)(text + text_size);
+    
+    // === PARSE REQUEST BODY ===
+    // {"model": "...", "input": "..." | ["...", ...]}
+    JsonDoc doc;
+    JsonCursor root, value;
+    char model_buf[MAX_MODEL_NAME_SIZE];
+    const char *model_name = NULL;
+    int count = -1;
+    
+    uint64_t phase_start = trace_now();
+    if (json_doc_parse_into(&doc, request->body, request->body_length, index_storage, index_slots) == 0 &&
+        json_doc_root(&doc, &root) == 0 && json_cursor_type(&root) == JSON_OBJECT) {
+        if (json_object_get(&root, "input", &value) == 0) {
+            count = collect_embedding_inputs(&value, inputs, text, text_size);
+        }
+        if (json_object_get(&root, "model", &value) == 0 &&
+            json_get_string(&value, model_buf, sizeof(model_buf), NULL) == 0) {
+            model_name = model_buf;
+        }
+    }
+    trace_phase(TRACE_JSON, phase_start);
+    
+    if (count < 0) {
+        scratch_free(request, scratch);
+        return create_error_response(response, ROUTE_ERROR_INVALID_PARAM, 400);
+    }
+    
+    EmbeddingResult result;
+    int status = -1;
+    phase_start = trace_now();
+    uint64_t upstream_start = access_log_now();
+    int embed_result = embeddings_create(model_name, inputs, count, &result);
+    trace_phase(TRACE_UPSTREAM, phase_start);
+    access_log_note_upstream(embed_result == 0 ? result.model : model_name, upstream_start, 0);
+    
+    if (embed_result == 0) {
+        // Vectors are copied through as the upstream sent them
+        size_t vectors_size = 0;
+        for (int i = 0; i < result.count; i++) {
+            vectors_size += strlen(result.vectors[i]) + 64;
+        }
+        
+        JsonWriter w;
+        size_t length_offset, body_offset;
+        phase_start = trace_now();
+        if (init_response_writer(response, &w, vectors_size + 256) == 0) {
+            begin_http_response(response, &w, 200, "OK", "application/json", &length_offset, &body_offset);
+            json_write_cstr(&w, "{\"object\": \"list\", \"data\": [");
+            for (int i = 0; i < result.count; i++) {
+                json_write_cstr(&w, i ? ", {\"object\": \"embedding\", \"index\": "
+                                      : "{\"object\": \"embedding\", \"index\": ");
+                json_write_int(&w, i);
+                json_write_cstr(&w, ", \"embedding\": ");
+                json_write_cstr(&w, result.vectors[i]);
+                json_write_cstr(&w, "}");
+            }
+            json_write_cstr(&w, "], \"model\": ");
+            json_write_string(&w, result.model, strlen(result.model));
+            json_write_cstr(&w, "}");
+            status = finish_http_response(response, &w, length_offset, body_offset, 200, "OK");
+        }
+        trace_phase(TRACE_SERIALIZE, phase_start);
+        if (status == 0) {
+            stats_record_successful_request(result.model, (double)(get_current_time_ns() - start) / 1e6, 0);
+        }
+        embeddings_result_free(&result);
+        
+        if (status != 0) {
+            status = create_error_response(response, ROUTE_ERROR_MEMORY, 500);
+        }
+    } else if (embed_result == PROMPT_ROUTE_UNAVAILABLE) {
+        const char *error_msg = "{\"error\": \"AI model temporarily unavailable\"}";
+        status = create_http_response(response, error_msg, strlen(error_msg),
+                                     "application/json", 503, "Service Unavailable");
+    } else {
+        const char *error_msg = "AI Router Error: Failed to process request";
+        status = create_http_response(response, error_msg, strlen(error_msg),
+                                     "application/json", 502, "Bad Gateway");
+    }
+    
+    scratch_free(request, scratch);
     return status;
 }
 
-// Function to handle stats requests (Dynamic Buffering maintained)
+// {"count": N, "mean_ms": ..., "p50_ms": ..., ...} of one latency histogram
+static void write_latency_summary(JsonWriter *w, const LatencySummary *summary) {
+    json_write_cstr(w, "{\"count\": ");
+    json_write_int(w, (int64_t)summary->count);
+    json_write_cstr(w, ", \"mean_ms\": ");
+    json_write_double(w, summary->mean_ms);
+    json_write_cstr(w, ", \"p50_ms\": ");
+    json_write_double(w, summary->p50_ms);
+    json_write_cstr(w, ", \"p90_ms\": ");
+    json_write_double(w, summary->p90_ms);
+    json_write_cstr(w, ", \"p99_ms\": ");
+    json_write_double(w, summary->p99_ms);
+    json_write_cstr(w, ", \"p999_ms\": ");
+    json_write_double(w, summary->p999_ms);
+    json_write_cstr(w, ", \"max_ms\": ");
+    json_write_double(w, summary->max_ms);
+    json_write_cstr(w, "}");
+}
+
+// Function to handle stats requests (written straight into the response buffer)
 int handle_stats_request(Server *server, HTTPRequest *request, RouteResponse *response) {
     (void)request; // Unused
     
     if (!server || !response) return -1;
     
-    // Use dynamic allocation
-    size_t stats_len = 512; 
-    char *stats_json = malloc(stats_len);
-    if (!stats_json) {
+    JsonWriter w;
+    size_t length_offset, body_offset;
+    if (init_response_writer(response, &w, 512) != 0) {
         return create_error_response(response, ROUTE_ERROR_MEMORY, 500);
     }
     
-    int written = snprintf(stats_json, stats_len, 
-            "{\"requests\": %lu, \"responses\": %lu, \"uptime\": %ld, \"active_connections\": %d, \"timestamp\": %ld}", 
-            server->stats.total_requests, 
-            server->stats.total_responses, 
-            (long)0, // Uptime placeholder
-            server->active_connections, 
-            time(NULL));
+    begin_http_response(response, &w, 200, "OK", "application/json", &length_offset, &body_offset);
+    WorkerMetricsInfo totals;
+    metrics_get_totals(&totals);
+    uint64_t responses = 0;
+    for (int c = 0; c < 5; c++) {
+        responses += totals.responses[c];
+    }
+    
+    json_write_cstr(&w, "{\"requests\": ");
+    json_write_int(&w, (int64_t)totals.requests);
+    json_write_cstr(&w, ", \"responses\": ");
+    json_write_int(&w, (int64_t)responses);
+    json_write_cstr(&w, ", \"uptime\": ");
+    json_write_int(&w, (int64_t)metrics_uptime_seconds());
+    json_write_cstr(&w, ", \"active_connections\": ");
+    json_write_int(&w, server->active_connections);
+    json_write_cstr(&w, ", \"timestamp\": ");
+    json_write_int(&w, (int64_t)time(NULL));
+    
+    // Per-hook pipeline counters
+    HookStatsInfo hooks[MAX_STATS_HOOKS];
+    int hook_count = pipeline_get_stats(hooks, MAX_STATS_HOOKS);
+    if (hook_count > MAX_STATS_HOOKS) hook_count = MAX_STATS_HOOKS;
+    json_write_cstr(&w, ", \"hooks\": [");
+    for (int i = 0; i < hook_count; i++) {
+        json_write_cstr(&w, i ? ", {\"owner\": " : "{\"owner\": ");
+        json_write_string(&w, hooks[i].owner, strlen(hooks[i].owner));
+        json_write_cstr(&w, ", \"phase\": \"");
+        json_write_cstr(&w, pipeline_phase_name(hooks[i].phase));
+        json_write_cstr(&w, "\", \"enabled\": ");
+        json_write_cstr(&w, hooks[i].enabled ? "true" : "false");
+        json_write_cstr(&w, ", \"calls\": ");
+        json_write_int(&w, (int64_t)hooks[i].calls);
+        json_write_cstr(&w, ", \"errors\": ");
+        json_write_int(&w, (int64_t)hooks[i].errors);
+        json_write_cstr(&w, ", \"avg_us\": ");
+        json_write_double(&w, hooks[i].calls ? (double)hooks[i].total_ns / hooks[i].calls / 1000.0 : 0.0);
+        json_write_cstr(&w, ", \"max_us\": ");
+        json_write_double(&w, (double)hooks[i].max_ns / 1000.0);
+        json_write_cstr(&w, "}");
+    }
+    json_write_cstr(&w, "]");
+    
+    // Per-model breaker and fallback state
+    ModelRouteInfo models[MAX_STATS_MODELS];
+    int model_count = prompt_router_get_model_stats(models, MAX_STATS_MODELS);
+    if (model_count > MAX_STATS_MODELS) model_count = MAX_STATS_MODELS;
+    json_write_cstr(&w, ", \"models\": [");
+    for (int i = 0; i < model_count; i++) {
+        json_write_cstr(&w, i ? ", {\"name\": " : "{\"name\": ");
+        json_write_string(&w, models[i].name, strlen(models[i].name));
+        json_write_cstr(&w, ", \"available\": ");
+        json_write_cstr(&w, models[i].available ? "true" : "false");
+        json_write_cstr(&w, ", \"breaker\": \"");
+        json_write_cstr(&w, models[i].breaker);
+        json_write_cstr(&w, "\", \"fallback\": ");
+        if (models[i].fallback[0]) {
+            json_write_string(&w, models[i].fallback, strlen(models[i].fallback));
+        } else {
+            json_write_cstr(&w, "null");
+        }
+        json_write_cstr(&w, ", \"hedge_delay_ms\": ");
+        json_write_double(&w, models[i].hedge_delay_ms);
+        json_write_cstr(&w, "}");
+    }
+    json_write_cstr(&w, "]");
+    
+    // Latency percentiles per model and per route, merged across threads
+    StatsSeriesInfo series[MAX_STATS_LATENCY];
+    int series_count = stats_get_series(series, MAX_STATS_LATENCY, 1);
+    if (series_count > MAX_STATS_LATENCY) series_count = MAX_STATS_LATENCY;
+    json_write_cstr(&w, ", \"latency\": [");
+    for (int i = 0; i < series_count; i++) {
+        json_write_cstr(&w, i ? ", {\"scope\": \"" : "{\"scope\": \"");
+        json_write_cstr(&w, stats_scope_name(series[i].scope));
+        json_write_cstr(&w, "\", \"name\": ");
+        json_write_string(&w, series[i].name, strlen(series[i].name));
+        json_write_cstr(&w, ", \"e2e\": ");
+        write_latency_summary(&w, &series[i].latency[STATS_LATENCY]);
+        if (series[i].scope == STATS_SCOPE_MODEL) {
+            json_write_cstr(&w, ", \"successes\": ");
+            json_write_int(&w, (int64_t)series[i].successes);
+            json_write_cstr(&w, ", \"failures\": ");
+            json_write_int(&w, (int64_t)series[i].failures);
+            json_write_cstr(&w, ", \"ttft\": ");
+            write_latency_summary(&w, &series[i].latency[STATS_TTFT]);
+            json_write_cstr(&w, ", \"upstream\": ");
+            write_latency_summary(&w, &series[i].latency[STATS_UPSTREAM]);
+        }
+        json_write_cstr(&w, "}");
+    }
+    json_write_cstr(&w, "]");
+    
+    // Near-duplicate prompt cache
+    PromptCacheStats cache_stats;
+    prompt_cache_get_stats(&cache_stats);
+    json_write_cstr(&w, ", \"prompt_cache\": {\"entries\": ");
+    json_write_int(&w, (int64_t)cache_stats.entries);
+    json_write_cstr(&w, ", \"lookups\": ");
+    json_write_int(&w, (int64_t)cache_stats.lookups);
+    json_write_cstr(&w, ", \"hits\": ");
+    json_write_int(&w, (int64_t)cache_stats.hits);
+    json_write_cstr(&w, ", \"hit_rate\": ");
+    json_write_double(&w, cache_stats.lookups ? (double)cache_stats.hits / cache_stats.lookups : 0.0);
+    json_write_cstr(&w, ", \"evictions\": ");
+    json_write_int(&w, (int64_t)cache_stats.evictions);
+    json_write_cstr(&w, ", \"sampled\": ");
+    json_write_int(&w, (int64_t)cache_stats.sampled);
+    json_write_cstr(&w, ", \"false_matches\": ");
+    json_write_int(&w, (int64_t)cache_stats.false_matches);
+    json_write_cstr(&w, "}");
+    
+    // Embedding micro-batching
+    EmbeddingStats embedding_stats;
+    embeddings_get_stats(&embedding_stats);
+    json_write_cstr(&w, ", \"embeddings\": {\"requests\": ");
+    json_write_int(&w, (int64_t)embedding_stats.requests);
+    json_write_cstr(&w, ", \"inputs\": ");
+    json_write_int(&w, (int64_t)embedding_stats.inputs);
+    json_write_cstr(&w, ", \"batches\": ");
+    json_write_int(&w, (int64_t)embedding_stats.batches);
+    json_write_cstr(&w, ", \"failed_batches\": ");
+    json_write_int(&w, (int64_t)embedding_stats.failed_batches);
+    json_write_cstr(&w, ", \"avg_batch_inputs\": ");
+    json_write_double(&w, embedding_stats.batches ? (double)embedding_stats.inputs / embedding_stats.batches : 0.0);
+    json_write_cstr(&w, "}");
+    
+    // Upstream replica selection state
+    ReplicaStatsInfo replicas[MAX_STATS_REPLICAS];
+    int replica_count = prompt_router_get_replica_stats(replicas, MAX_STATS_REPLICAS);
+    if (replica_count > MAX_STATS_REPLICAS) replica_count = MAX_STATS_REPLICAS;
+    json_write_cstr(&w, ", \"replicas\": [");
+    for (int i = 0; i < replica_count; i++) {
+        json_write_cstr(&w, i ? ", {\"model\": " : "{\"model\": ");
+        json_write_string(&w, replicas[i].model, strlen(replicas[i].model));
+        json_write_cstr(&w, ", \"endpoint\": ");
+        json_write_string(&w, replicas[i].endpoint, strlen(replicas[i].endpoint));
+        json_write_cstr(&w, ", \"ewma_ms\": ");
+        json_write_double(&w, replicas[i].ewma_ms);
+        json_write_cstr(&w, ", \"inflight\": ");
+        json_write_int(&w, replicas[i].inflight);
+        json_write_cstr(&w, ", \"ejected\": ");
+        json_write_cstr(&w, replicas[i].ejected ? "true" : "false");
+        json_write_cstr(&w, ", \"requests\": ");
+        json_write_int(&w, (int64_t)replicas[i].requests);
+        json_write_cstr(&w, ", \"failures\": ");
+        json_write_int(&w, (int64_t)replicas[i].failures);
+        json_write_cstr(&w, ", \"hedges\": ");
+        json_write_int(&w, (int64_t)replicas[i].hedges);
+        json_write_cstr(&w, "}");
+    }
+    json_write_cstr(&w, "]}");
+    
+    if (finish_http_response(response, &w, length_offset, body_offset, 200, "OK") != 0) {
+        return create_error_response(response, ROUTE_ERROR_INTERNAL, 500);
+    }
+    return 0;
+}
 
-    // Buffer size check
-    if (written < 0 || (size_t)written >= stats_len) {
-        free(stats_json);
+// Prometheus/OpenMetrics scrape. Each thread renders into its own heap
+// buffer, kept across scrapes; the server sends it before this thread
+// handles another request, so the response does not own it.
+int handle_metrics_request(Server *server, HTTPRequest *request, RouteResponse *response) {
+    (void)request; // Unused
+    
+    if (!server || !response) return -1;
+    
+    static _Thread_local JsonWriter w;
+    if (!w.buf) {
+        if (json_writer_init(&w, 16384) != 0) {
+            return create_error_response(response, ROUTE_ERROR_MEMORY, 500);
+        }
+    }
+    w.len = 0;
+    w.failed = 0;
+    
+    size_t length_offset, body_offset;
+    begin_http_response(response, &w, 200, "OK", METRICS_CONTENT_TYPE, &length_offset, &body_offset);
+    if (metrics_render(server, &w) != 0) {
+        json_writer_free(&w);
         return create_error_response(response, ROUTE_ERROR_INTERNAL, 500);
     }
+    fill_content_length(&w, length_offset, body_offset);
+    
+    response->data = w.buf;
+    response->length = w.len;
+    response->owns_data = 0;
+    response->status_code = 200;
+    response->status_message = (char *)"OK";
+    response->is_streaming = 0;
+    return 0;
+}
+
+// Value of `name` in the query string, copied into `out`; -1 if absent
+static int query_value(const HTTPRequest *request, const char *name, char *out, size_t out_size) {
+    size_t name_len = strlen(name);
+    for (const char *p = request->query_string; p && *p; ) {
+        const char *end = strchr(p, '&');
+        size_t len = end ? (size_t)(end - p) : strlen(p);
+        if (len > name_len && p[name_len] == '=' && strncmp(p, name, name_len) == 0) {
+            snprintf(out, out_size, "%.*s", (int)(len - name_len - 1), p + name_len + 1);
+            return 0;
+        }
+        p = end ? end + 1 : NULL;
+    }
+    return -1;
+}
+
+#define DEFAULT_TRACE_REQUESTS 100
+
+// Peer of the request's connection is 127.0.0.0/8 or ::1 (plain or IPv4-mapped)
+static int request_from_loopback(const HTTPRequest *request) {
+    struct sockaddr_storage addr;
+    socklen_t length = sizeof(addr);
+    if (request->client_fd < 0 || getpeername(request->client_fd, (struct sockaddr *)&addr, &length) != 0) {
+        return 0;
+    }
+    
+    if (addr.ss_family == AF_INET) {
+        return (ntohl(((const struct sockaddr_in *)&addr)->sin_addr.s_addr) >> 24) == 127;
+    }
+    if (addr.ss_family == AF_INET6) {
+        const struct in6_addr *ip = &((const struct sockaddr_in6 *)&addr)->sin6_addr;
+        return IN6_IS_ADDR_LOOPBACK(ip) || (IN6_IS_ADDR_V4MAPPED(ip) && ip->s6_addr[12] == 127);
+    }
+    return 0;
+}
+
+// GET dumps the last `limit` traced requests as Chrome trace-event JSON;
+// POST with ?enable=1 or ?enable=0 switches tracing on or off. Tracing
+// costs every worker, so only a client on this host may switch it.
+int handle_trace_request(Server *server, HTTPRequest *request, RouteResponse *response) {
+    (void)server; // Unused
     
-    int result = create_http_response(response, stats_json, strlen(stats_json), 
-                                     "application/json", 200, "OK");
-    free(stats_json);
+    if (!request || !response) return -1;
     
-    return result;
+    char value[16];
+    if (request->method == HTTP_POST) {
+        if (!request_from_loopback(request)) {
+            log_message("TRACE", "Refused to switch tracing for a non-loopback client");
+            return create_error_response(response, ROUTE_ERROR_FORBIDDEN, 403);
+        }
+        if (query_value(request, "enable", value, sizeof(value)) != 0) {
+            return create_error_response(response, ROUTE_ERROR_INVALID_PARAM, 400);
+        }
+        trace_set_enabled(atoi(value) != 0);
+        log_message("TRACE", trace_is_enabled() ? "Request tracing enabled" : "Request tracing disabled");
+        
+        const char *body = trace_is_enabled() ? "{\"enabled\": true}" : "{\"enabled\": false}";
+        return create_http_response(response, body, strlen(body), "application/json", 200, "OK");
+    }
+    
+    int limit = DEFAULT_TRACE_REQUESTS;
+    if (query_value(request, "limit", value, sizeof(value)) == 0) {
+        limit = atoi(value);
+    }
+    
+    JsonWriter w;
+    size_t length_offset, body_offset;
+    if (init_response_writer(response, &w, 4096) != 0) {
+        return create_error_response(response, ROUTE_ERROR_MEMORY, 500);
+    }
+    
+    begin_http_response(response, &w, 200, "OK", "application/json", &length_offset, &body_offset);
+    if (trace_write_chrome(&w, limit) < 0 ||
+        finish_http_response(response, &w, length_offset, body_offset, 200, "OK") != 0) {
+        if (w.buf) json_writer_free(&w);
+        return create_error_response(response, ROUTE_ERROR_INTERNAL, 500);
+    }
+    return 0;
 }
 
-// Function to handle health requests (CHANGED TO DYNAMIC BUFFERING)
+// Function to handle health requests (written straight into the response buffer)
 int handle_health_request(Server *server, HTTPRequest *request, RouteResponse *response) {
     (void)server; 
     (void)request;
     
     if (!response) return -1;
     
-    // CHANGED: Use dynamic allocation instead of stack array
-    size_t health_len = 128;
-    char *health_json = malloc(health_len);
-    if (!health_json) {
+    JsonWriter w;
+    size_t length_offset, body_offset;
+    if (init_response_writer(response, &w, 256) != 0) {
         return create_error_response(response, ROUTE_ERROR_MEMORY, 500);
     }
-
-    int written = snprintf(health_json, health_len, 
-            "{\"status\": \"ok\", \"timestamp\": %ld, \"server\": \"AIONIC/1.0\"}", 
-            time(NULL));
-
-    if (written < 0 || (size_t)written >= health_len) {
-        free(health_json);
-        return create_error_response(response, ROUTE_ERROR_INTERNAL, 500);
-    }
     
-    int result = create_http_response(response, health_json, strlen(health_json), 
-                               "application/json", 200, "OK");
+    begin_http_response(response, &w, 200, "OK", "application/json", &length_offset, &body_offset);
+    json_write_cstr(&w, "{\"status\": \"ok\", \"timestamp\": ");
+    json_write_int(&w, (int64_t)time(NULL));
+    json_write_cstr(&w, ", \"server\": \"AIONIC/1.0\"}");
     
-    free(health_json); // Important cleanup
-    return result;
+    if (finish_http_response(response, &w, length_offset, body_offset, 200, "OK") != 0) {
+        return create_error_response(response, ROUTE_ERROR_INTERNAL, 500);
+    }
+    return 0;
 }
 
 // Handle root path request
@@ -839,15 +1329,119 @@ int handle_root_request(Server *server, HTTPRequest *request, RouteResponse *res
     
     if (!response) return -1;
     
-    return copy_route_response(&cached_root_response, response);
+    return use_cached_response(cached_root_for(response), response);
+}
+
+// ===== Static Files =====
+
+// Headers only: the body, if any, is sent by the server from response->file
+static int write_static_headers(RouteResponse *response, const StaticFile *file, int status_code,
+                                const char *status_message, uint64_t start, uint64_t length) {
+    JsonWriter w;
+    if (init_response_writer(response, &w, 512) != 0) return -1;
+    
+    char line[160];
+    int line_len = snprintf(line, sizeof(line), "HTTP/1.1 %d %s\r\nDate: ", status_code, status_message);
+    json_write_raw(&w, line, (size_t)line_len);
+    json_write_raw(&w, line, http_date(time(NULL), line, sizeof(line)));
+    json_write_cstr(&w, "\r\nServer: AIONIC/1.0\r\nAccept-Ranges: bytes\r\nCache-Control: no-cache\r\nETag: ");
+    json_write_cstr(&w, file->etag);
+    json_write_cstr(&w, "\r\nLast-Modified: ");
+    json_write_raw(&w, line, http_date(file->mtime, line, sizeof(line)));
+    if (status_code != 304) {
+        json_write_cstr(&w, "\r\nContent-Type: ");
+        json_write_cstr(&w, status_code == 416 ? "text/plain" : file->content_type);
+        line_len = snprintf(line, sizeof(line), "\r\nContent-Length: %llu", (unsigned long long)length);
+        json_write_raw(&w, line, (size_t)line_len);
+    }
+    if (status_code == 206) {
+        line_len = snprintf(line, sizeof(line), "\r\nContent-Range: bytes %llu-%llu/%llu",
+                            (unsigned long long)start, (unsigned long long)(start + length - 1),
+                            (unsigned long long)file->size);
+        json_write_raw(&w, line, (size_t)line_len);
+    } else if (status_code == 416) {
+        line_len = snprintf(line, sizeof(line), "\r\nContent-Range: bytes */%llu", (unsigned long long)file->size);
+        json_write_raw(&w, line, (size_t)line_len);
+    }
+    // Revalidations and partial reads keep the connection like a 200 does
+    if (response->keep_alive && status_code != 416) {
+        json_write_cstr(&w, "\r\nConnection: keep-alive\r\n\r\n");
+    } else {
+        json_write_cstr(&w, "\r\nConnection: close\r\n\r\n");
+    }
+    
+    if (w.failed) {
+        json_writer_free(&w);
+        return -1;
+    }
+    response->data = json_writer_finish(&w, &response->length);
+    if (!response->data) return -1;
+    response->owns_data = response->arena == NULL;
+    response->status_code = status_code;
+    response->status_message = (char *)status_message;
+    return 0;
+}
+
+// GET or HEAD /static/<path>: conditional and single-range requests against
+// the open-file cache. Only headers are built here.
+int handle_static_request(Server *server, HTTPRequest *request, RouteResponse *response) {
+    (void)server;
+    
+    if (!request || !response) return -1;
+    
+    size_t path_len = 0;
+    const char *path = http_request_param(request, "path", &path_len);
+    StaticFile *file = path ? static_file_acquire(path, path_len) : NULL;
+    if (!file) {
+        if (errno == EACCES) return create_error_response(response, ROUTE_ERROR_INVALID_PARAM, 403);
+        return use_cached_response(&cached_404_response, response);
+    }
+    
+    int status_code = 200;
+    const char *status_message = "OK";
+    uint64_t start = 0, length = file->size;
+    const char *range = http_request_header(request, "Range");
+    const char *if_range = http_request_header(request, "If-Range");
+    
+    if (static_etag_matches(http_request_header(request, "If-None-Match"), file->etag)) {
+        status_code = 304;
+        status_message = "Not Modified";
+        length = 0;
+    } else if (range && (!if_range || static_etag_matches(if_range, file->etag))) {
+        int partial = static_parse_range(range, file->size, &start, &length);
+        if (partial > 0) {
+            status_code = 206;
+            status_message = "Partial Content";
+        } else if (partial < 0) {
+            status_code = 416;
+            status_message = "Range Not Satisfiable";
+            start = length = 0;
+        }
+    }
+    
+    if (write_static_headers(response, file, status_code, status_message, start, length) != 0) {
+        static_file_release(file);
+        return create_error_response(response, ROUTE_ERROR_MEMORY, 500);
+    }
+    
+    if (request->method == HTTP_GET && length > 0) {
+        response->file = file;
+        response->file_offset = start;
+        response->file_length = length;
+    } else {
+        static_file_release(file);
+    }
+    return 0;
 }
 
 // ===== Initialization and Cleanup =====
 
 // Initialize router system
 void router_init(void) {
-    // Initialize hash table
-    hash_table_init(&routes_table);
+    // Initialize route tree
+    pthread_mutex_lock(&routes_update_lock);
+    if (!atomic_load(&routes_tree)) rcu_assign_pointer(routes_tree, route_tree_create());
+    pthread_mutex_unlock(&routes_update_lock);
     
     // Initialize cached responses
     init_cached_responses();
@@ -858,9 +1452,13 @@ void router_cleanup(void) {
     // Free cached responses
     if (cached_404_response.data) free(cached_404_response.data);
     if (cached_root_response.data) free(cached_root_response.data);
+    if (cached_root_keepalive_response.data) free(cached_root_keepalive_response.data);
     
-    // Free hash table
-    hash_table_free(&routes_table);
+    // Free route tree
+    pthread_mutex_lock(&routes_update_lock);
+    RouteNode *old_tree = atomic_exchange(&routes_tree, NULL);
+    pthread_mutex_unlock(&routes_update_lock);
+    rcu_retire(old_tree, free_route_tree);
 }
 
 // Function to initialize routes
@@ -870,7 +1468,13 @@ void init_routes(void) {
     
     // Register routes
     register_route("/v1/chat", HTTP_POST, handle_chat_request);
+    register_route("/v1/embeddings", HTTP_POST, handle_embeddings_request);
     register_route("/stats", HTTP_GET, handle_stats_request);
+    register_route("/metrics", HTTP_GET, handle_metrics_request);
+    register_route("/debug/trace", HTTP_GET, handle_trace_request);
+    register_route("/debug/trace", HTTP_POST, handle_trace_request);
     register_route("/health", HTTP_GET, handle_health_request);
     register_route("/", HTTP_GET, handle_root_request);
+    register_route("/static/*path", HTTP_GET, handle_static_request);
+    register_route("/static/*path", HTTP_HEAD, handle_static_request);
 }
@@ -6,6 +6,10 @@
 // ===== Configuration Constants =====
 #define KEEP_ALIVE_TIMEOUT 30     // Close connections idle for 30 seconds
 #define CLEANUP_INTERVAL 5        // Check for idle connections every 5 seconds
+#define TLS_FILE_CHUNK (64 * 1024)  // File read size when a body passes through user space
+#define ACCEPT_WAIT_MS 100        // Longest server_process_events() blocks
+#define SEND_TIMEOUT_MS 5000      // A direct write may block the worker this long...
+#define SEND_MIN_RATE 64          // ...plus 1 ms per this many bytes
 
 // ===== Standard Library Headers =====
 #include <stdio.h>
@@ -14,6 +18,7 @@
 #include <unistd.h>
 #include <errno.h>
 #include <sys/socket.h>
+#include <asm/socket.h>  // SO_INCOMING_CPU, hidden by _POSIX_C_SOURCE
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <pthread.h>
@@ -22,16 +27,27 @@
 #include <time.h>
 #include <ctype.h>
 #include <strings.h>  
+#include <poll.h>
 
 // ===== Project Headers =====
 #include "server.h"
 #include "parser.h"
 #include "router.h"
 #include "stream.h"
+#include "rcu.h"
+#include "pipeline.h"
 #include "utils.h"
 #include "asm_utils.h"
 #include "firewall.h"
 #include "config.h"
+#include "metrics.h"
+#include "trace.h"
+#include "access_log.h"
+#include "static_files.h"
+#include "uring.h"
+#include "http2.h"
+#include "tls.h"
+#include "affinity.h"
 
 // Thread data structure
 typedef struct {
@@ -39,6 +55,7 @@ typedef struct {
     int epoll_fd;
     int id;
     FirewallStats firewall_stats;  
+    Arena arena;                   // Request arena, reset after every response
 } ThreadData;
 
 // Connection tracking structure (UPDATED for Keep-Alive)
@@ -52,23 +69,53 @@ typedef struct {
     uint64_t bytes_sent;
     int requests_handled;
     int flagged_suspicious;
+    H2Session *h2_session;          // Set once the connection speaks HTTP/2
+    TlsConnection *tls;             // Set for connections from the TLS listener
 } ConnectionInfo;
 
-// Global connection tracking
-static ConnectionInfo *connections = NULL;
+// Global connection tracking. Each entry is allocated on its own so its
+// address stays put while the array of pointers grows or is compacted: the
+// worker that owns a connection keeps using its entry after unlocking, and
+// is the only thread that removes it once the connection is handed over.
+static ConnectionInfo **connections = NULL;
 static int connection_count = 0;
 static int connection_capacity = 0;
 static pthread_mutex_t connection_mutex = PTHREAD_MUTEX_INITIALIZER;
 
+// Where a request's response bytes go: send() on the epoll backend, a
+// queued send on io_uring, SSL_write() for TLS the kernel does not encrypt.
+// With socket_writes set, streaming and file responses are written to the
+// socket directly; otherwise they go through `send`, or `send_file` (when
+// set) takes over a file body and its reference.
+typedef struct {
+    void (*send)(void *ctx, int client_fd, const char *data, size_t length);
+    void *ctx;
+    int socket_writes;
+    int64_t (*send_file)(void *ctx, int client_fd, RouteResponse *response);
+} ResponseSink;
+
+static int handle_request_data(Server *server, int client_fd, char *buffer, size_t bytes_read,
+                               Arena *arena, const ResponseSink *sink);
+static ConnectionInfo *admit_connection(Server *server, int client_fd, const char *client_ip, int thread_id,
+                                        TlsConnection *tls);
+
 // ===== Helper Functions =====
-static ConnectionInfo *add_connection_info(int client_fd, const char *ip_address, int thread_id) {
+// Takes over `tls`, which is freed with the entry
+static ConnectionInfo *add_connection_info(int client_fd, const char *ip_address, int thread_id,
+                                           TlsConnection *tls) {
+    ConnectionInfo *info = malloc(sizeof(ConnectionInfo));
+    if (!info) {
+        return NULL;
+    }
+    
     pthread_mutex_lock(&connection_mutex);
     
     if (connection_count >= connection_capacity) {
         int new_capacity = connection_capacity == 0 ? 128 : connection_capacity * 2;
-        ConnectionInfo *new_connections = realloc(connections, sizeof(ConnectionInfo) * new_capacity);
+        ConnectionInfo **new_connections = realloc(connections, sizeof(ConnectionInfo *) * new_capacity);
         if (!new_connections) {
             pthread_mutex_unlock(&connection_mutex);
+            free(info);
             return NULL;
         }
         
@@ -77,7 +124,6 @@ static ConnectionInfo *add_connection_info(int client_fd, const char *ip_address
     }
     
     time_t now = time(NULL);
-    ConnectionInfo *info = &connections[connection_count];
     info->client_fd = client_fd;
     info->epoll_owner_id = thread_id;
     strncpy(info->ip_address, ip_address, INET_ADDRSTRLEN - 1);
@@ -88,8 +134,10 @@ static ConnectionInfo *add_connection_info(int client_fd, const char *ip_address
     info->bytes_sent = 0;
     info->requests_handled = 0;
     info->flagged_suspicious = 0;
+    info->h2_session = NULL;
+    info->tls = tls;
     
-    connection_count++;
+    connections[connection_count++] = info;
     pthread_mutex_unlock(&connection_mutex);
     return info;
 }
@@ -98,9 +146,10 @@ static ConnectionInfo *find_connection_info(int client_fd) {
     pthread_mutex_lock(&connection_mutex);
     
     for (int i = 0; i < connection_count; i++) {
-        if (connections[i].client_fd == client_fd) {
+        if (connections[i]->client_fd == client_fd) {
+            ConnectionInfo *info = connections[i];
             pthread_mutex_unlock(&connection_mutex);
-            return &connections[i];
+            return info;
         }
     }
     
@@ -108,11 +157,19 @@ static ConnectionInfo *find_connection_info(int client_fd) {
     return NULL;
 }
 
+static void free_connection_info(ConnectionInfo *info) {
+    h2_session_free(info->h2_session);
+    tls_connection_free(info->tls);
+    free(info);
+}
+
 static void remove_connection_info(int client_fd) {
+    ConnectionInfo *removed = NULL;
     pthread_mutex_lock(&connection_mutex);
     
     for (int i = 0; i < connection_count; i++) {
-        if (connections[i].client_fd == client_fd) {
+        if (connections[i]->client_fd == client_fd) {
+            removed = connections[i];
             // Move last element to current position
             if (i < connection_count - 1) {
                 connections[i] = connections[connection_count - 1];
@@ -123,20 +180,32 @@ static void remove_connection_info(int client_fd) {
     }
     
     pthread_mutex_unlock(&connection_mutex);
+    if (removed) {
+        free_connection_info(removed);
+    }
 }
 
-static void log_connection_info(ConnectionInfo *info, const char *event) {
-    char log_msg[512];
-    time_t now = time(NULL);
-    struct tm *tm_info = localtime(&now);
-    char time_buffer[26];
-    strftime(time_buffer, 26, "%Y-%m-%d %H:%M:%S", tm_info);
+// Only the owning worker attaches a session; the lock orders it against copies of the entry
+static void attach_h2_session(ConnectionInfo *info, H2Session *session) {
+    pthread_mutex_lock(&connection_mutex);
+    info->h2_session = session;
+    pthread_mutex_unlock(&connection_mutex);
+}
+
+// Forget a connection the caller is closing
+static void release_connection(Server *server, int client_fd) {
+    remove_connection_info(client_fd);
     
-    snprintf(log_msg, sizeof(log_msg), "[%s] Connection %s: FD=%d, IP=%s, Requests=%d, BytesIn=%lu, BytesOut=%lu, Suspicious=%d",
-             time_buffer, event, info->client_fd, info->ip_address, info->requests_handled, 
+    pthread_mutex_lock(&connection_mutex);
+    server->active_connections--;
+    pthread_mutex_unlock(&connection_mutex);
+}
+
+// The log line carries its own timestamp
+static void log_connection_info(ConnectionInfo *info, const char *event) {
+    log_info("Connection %s: FD=%d, IP=%s, Requests=%d, BytesIn=%lu, BytesOut=%lu, Suspicious=%d",
+             event, info->client_fd, info->ip_address, info->requests_handled,
              info->bytes_received, info->bytes_sent, info->flagged_suspicious);
-    
-    log_message("SERVER", log_msg);
 }
 
 static int extract_api_key(const HTTPRequest *request) {
@@ -302,30 +371,15 @@ static void *reaper_thread(void *arg) {
         pthread_mutex_lock(&connection_mutex);
         time_t now = time(NULL);
         
-        // Iterate backwards to safely remove elements
-        for (int i = connection_count - 1; i >= 0; i--) {
-            ConnectionInfo *info = &connections[i];
+        // The owning worker sees the shutdown as end of stream and releases the
+        // connection itself: it may be in the middle of serving it right now
+        for (int i = 0; i < connection_count; i++) {
+            ConnectionInfo *info = connections[i];
             
             if (now - info->last_activity > KEEP_ALIVE_TIMEOUT) {
-                printf("[REAPER] Closing idle connection: FD=%d, IP=%s (Idle: %lds)\n", 
-                       info->client_fd, info->ip_address, now - info->last_activity);
-                
-                // Remove from epoll 
-                if (info->epoll_owner_id >= 0 && info->epoll_owner_id < server->thread_count) {
-                    int target_epoll = server->epoll_fds[info->epoll_owner_id];
-                    epoll_ctl(target_epoll, EPOLL_CTL_DEL, info->client_fd, NULL);
-                }
-                
-                close(info->client_fd);
-                server->active_connections--; 
-                
-                // Remove from array (swap with last)
-                if (i < connection_count - 1) {
-                    connections[i] = connections[connection_count - 1];
-                }
-                connection_count--;
-                
-                i++; 
+                log_debug("[REAPER] Closing idle connection: FD=%d, IP=%s (Idle: %lds)",
+                          info->client_fd, info->ip_address, (long)(now - info->last_activity));
+                shutdown(info->client_fd, SHUT_RDWR);
             }
         }
         
@@ -336,18 +390,484 @@ static void *reaper_thread(void *arg) {
     return NULL;
 }
 
-// ===== Worker Thread Function =====
-static void *worker_thread(void *arg) {
-    ThreadData *data = (ThreadData *)arg;
-    Server *server = data->server;
+// ===== io_uring Worker Thread =====
+// Each worker owns a ring with a multishot accept on the shared listening
+// socket and a multishot receive per connection drawing from the worker's
+// provided buffers. A closing response is a send linked to a close, so a
+// request costs no system call beyond the worker's one io_uring_enter per
+// batch of completions. A connection's sends are submitted one at a time
+// from a queue, so they leave in order, and file bodies are read into the
+// queue a piece at a time instead of being written to the socket directly.
+
+#define URING_ENTRIES 1024
+#define URING_BUFFER_COUNT 256          // Receive buffers per worker
+#define URING_BUFFER_SIZE 8192          // Same request limit as the epoll backend
+#define URING_BUFFER_GROUP 0
+#define URING_WAIT_MS 100
+
+// Operation in the low bits of user_data, the fd (or a send's address) above
+enum {
+    URING_OP_ACCEPT = 1,
+    URING_OP_RECV,
+    URING_OP_SEND,
+    URING_OP_CLOSE,
+    URING_OP_CANCEL
+};
+#define URING_OP_BITS 3
+#define URING_OP_MASK ((1u << URING_OP_BITS) - 1)
+
+// Per-fd state of a worker's connections
+enum {
+    URING_CONN_FREE = 0,
+    URING_CONN_OPEN,
+    URING_CONN_CLOSING          // Close submitted, late completions are ignored
+};
+
+// Response bytes copied out of the request arena until the kernel has sent
+// them, or a file body read into `data` one piece at a time. A connection's
+// sends form a queue and only its head is submitted, so they reach the
+// socket in order.
+typedef struct UringSend {
+    int client_fd;
+    int close_after;            // Close the connection once this is sent
+    int close_linked;           // The close is linked behind the submitted send
+    StaticFile *file;           // Owned reference, NULL for plain bytes
+    uint64_t file_offset;
+    uint64_t file_remaining;    // Not yet read into `data`
+    size_t length;
+    size_t offset;
+    struct UringSend *next;
+    char data[];
+} UringSend;
+
+typedef struct {
+    uint8_t state;
+    UringSend *send_head;       // Submitted
+    UringSend *send_tail;
+} UringConn;
+
+typedef struct {
+    Server *server;
+    ThreadData *thread;
+    Uring ring;
+    UringBuffers buffers;
+    UringConn *conns;           // Indexed by fd
+    int conn_capacity;
+} UringWorker;
+
+static uint64_t uring_data(int fd, unsigned op) {
+    return ((uint64_t)(unsigned)fd << URING_OP_BITS) | op;
+}
+
+// A free submission entry, flushing the queue to the kernel when it is full
+static struct io_uring_sqe *uring_next_sqe(UringWorker *worker) {
+    struct io_uring_sqe *sqe = uring_get_sqe(&worker->ring);
+    for (int attempt = 0; !sqe && attempt < 8; attempt++) {
+        uring_submit_wait(&worker->ring, 0);
+        sqe = uring_get_sqe(&worker->ring);
+    }
+    if (!sqe) {
+        log_error("Worker %d: io_uring submission queue stuck full", worker->thread->id);
+    }
+    return sqe;
+}
+
+static int uring_conn_state(UringWorker *worker, int fd) {
+    return fd >= 0 && fd < worker->conn_capacity ? worker->conns[fd].state : URING_CONN_FREE;
+}
+
+static int uring_set_conn_state(UringWorker *worker, int fd, int state) {
+    if (fd >= worker->conn_capacity) {
+        int capacity = worker->conn_capacity ? worker->conn_capacity : 1024;
+        while (capacity <= fd) capacity *= 2;
+        UringConn *grown = realloc(worker->conns, (size_t)capacity * sizeof(UringConn));
+        if (!grown) {
+            return -1;
+        }
+        memset(grown + worker->conn_capacity, 0, (size_t)(capacity - worker->conn_capacity) * sizeof(UringConn));
+        worker->conns = grown;
+        worker->conn_capacity = capacity;
+    }
+    worker->conns[fd].state = (uint8_t)state;
+    return 0;
+}
+
+static void uring_arm_accept(UringWorker *worker) {
+    struct io_uring_sqe *sqe = uring_next_sqe(worker);
+    if (!sqe) return;
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = worker->server->server_fd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_CLOEXEC;
+    sqe->user_data = uring_data(0, URING_OP_ACCEPT);
+}
+
+static void uring_arm_recv(UringWorker *worker, int fd) {
+    struct io_uring_sqe *sqe = uring_next_sqe(worker);
+    if (!sqe) return;
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = worker->buffers.group;
+    sqe->user_data = uring_data(fd, URING_OP_RECV);
+}
+
+static void uring_submit_close(UringWorker *worker, int fd) {
+    struct io_uring_sqe *sqe = uring_next_sqe(worker);
+    if (!sqe) {
+        close(fd);
+        uring_set_conn_state(worker, fd, URING_CONN_FREE);
+        return;
+    }
+    sqe->opcode = IORING_OP_CLOSE;
+    sqe->fd = fd;
+    sqe->user_data = uring_data(fd, URING_OP_CLOSE);
+}
+
+static void uring_free_send(UringSend *send_op) {
+    if (send_op->file) static_file_release(send_op->file);
+    free(send_op);
+}
+
+// Reads the next piece of a file body into the send's buffer
+static int uring_fill_send(UringSend *send_op) {
+    size_t want = send_op->file_remaining < TLS_FILE_CHUNK ? (size_t)send_op->file_remaining : TLS_FILE_CHUNK;
+    ssize_t n = pread(send_op->file->fd, send_op->data, want, (off_t)send_op->file_offset);
+    if (n <= 0) {
+        return -1;
+    }
+    send_op->file_offset += (uint64_t)n;
+    send_op->file_remaining -= (uint64_t)n;
+    send_op->length = (size_t)n;
+    send_op->offset = 0;
+    return 0;
+}
+
+static void uring_close_connection(UringWorker *worker, int fd);
+static void uring_send_failed(UringWorker *worker, int fd);
+
+// The head of a connection's queue; a close due after its last byte is linked behind it.
+// A linked send carries MSG_WAITALL: a partial send would otherwise count as
+// success and let the close cut the response short. With it the kernel keeps
+// sending, and one that still ends short fails the link, cancelling the close.
+static void uring_submit_send(UringWorker *worker, UringSend *send_op) {
+    struct io_uring_sqe *sqe = NULL;
+    if (send_op->offset < send_op->length || (send_op->file && uring_fill_send(send_op) == 0)) {
+        sqe = uring_next_sqe(worker);
+    }
+    if (!sqe) {
+        uring_send_failed(worker, send_op->client_fd);
+        return;
+    }
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = send_op->client_fd;
+    sqe->addr = (uint64_t)(uintptr_t)(send_op->data + send_op->offset);
+    sqe->len = (uint32_t)(send_op->length - send_op->offset);
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = (uint64_t)(uintptr_t)send_op | URING_OP_SEND;
+
+    send_op->close_linked = send_op->close_after && send_op->file_remaining == 0;
+    if (send_op->close_linked) {
+        sqe->msg_flags |= MSG_WAITALL;
+        sqe->flags = IOSQE_IO_LINK;
+        uring_submit_close(worker, send_op->client_fd);
+    }
+}
+
+// Sent after everything already queued for the connection
+static void uring_enqueue_send(UringWorker *worker, UringSend *send_op) {
+    UringConn *conn = &worker->conns[send_op->client_fd];
+    send_op->next = NULL;
+    if (conn->send_tail) {
+        conn->send_tail->next = send_op;
+        conn->send_tail = send_op;
+        return;
+    }
+    conn->send_head = conn->send_tail = send_op;
+    uring_submit_send(worker, send_op);
+}
+
+// A send failed or could not be submitted: the rest of the queue goes with the connection
+static void uring_send_failed(UringWorker *worker, int fd) {
+    UringConn *conn = &worker->conns[fd];
+    UringSend *send_op = conn->send_head;
+    conn->send_head = conn->send_tail = NULL;
+    while (send_op) {
+        UringSend *next = send_op->next;
+        uring_free_send(send_op);
+        send_op = next;
+    }
+
+    // A closing connection's close was due behind one of the dropped sends
+    if (uring_conn_state(worker, fd) == URING_CONN_CLOSING) {
+        uring_submit_close(worker, fd);
+    } else {
+        uring_close_connection(worker, fd);
+    }
+}
+
+// Stop receiving, untrack the connection and close it once its queued sends are out
+static void uring_close_connection(UringWorker *worker, int fd) {
+    if (uring_conn_state(worker, fd) != URING_CONN_OPEN) {
+        return;
+    }
+    uring_set_conn_state(worker, fd, URING_CONN_CLOSING);
+    release_connection(worker->server, fd);
+
+    // The armed receive holds a reference to the socket until it is cancelled
+    struct io_uring_sqe *sqe = uring_next_sqe(worker);
+    if (sqe) {
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->addr = uring_data(fd, URING_OP_RECV);
+        sqe->user_data = uring_data(fd, URING_OP_CANCEL);
+    }
+
+    UringConn *conn = &worker->conns[fd];
+    if (conn->send_tail) {
+        conn->send_tail->close_after = 1;
+    } else {
+        uring_submit_close(worker, fd);
+    }
+}
+
+// ResponseSink for the io_uring backend: the bytes outlive the request arena.
+// A response that cannot be queued whole closes the connection, so the client
+// never takes what follows for the rest of it.
+static void uring_queue_send(void *ctx, int client_fd, const char *data, size_t length) {
+    UringWorker *worker = ctx;
+    if (length == 0 || uring_conn_state(worker, client_fd) != URING_CONN_OPEN) {
+        return;
+    }
+    UringSend *send_op = calloc(1, sizeof(UringSend) + length);
+    if (!send_op) {
+        log_warning("Worker %d: out of memory queueing a response on fd %d", worker->thread->id, client_fd);
+        uring_close_connection(worker, client_fd);
+        return;
+    }
+    send_op->client_fd = client_fd;
+    send_op->length = length;
+    memcpy(send_op->data, data, length);
+    uring_enqueue_send(worker, send_op);
+}
+
+// File bodies keep the file's reference and are read as the previous piece is sent
+static int64_t uring_queue_file(void *ctx, int client_fd, RouteResponse *response) {
+    UringWorker *worker = ctx;
+    uring_queue_send(worker, client_fd, response->data, response->length);
+    if (uring_conn_state(worker, client_fd) != URING_CONN_OPEN) {
+        return -1;
+    }
+    if (response->file_length > 0) {
+        UringSend *send_op = calloc(1, sizeof(UringSend) + TLS_FILE_CHUNK);
+        if (!send_op) {
+            log_warning("Worker %d: out of memory queueing a file on fd %d", worker->thread->id, client_fd);
+            uring_close_connection(worker, client_fd);
+            return -1;
+        }
+        send_op->client_fd = client_fd;
+        send_op->file = response->file;
+        send_op->file_offset = response->file_offset;
+        send_op->file_remaining = response->file_length;
+        response->file = NULL;
+        uring_enqueue_send(worker, send_op);
+    }
+    return (int64_t)(response->length + response->file_length);
+}
+
+static void uring_on_accept(UringWorker *worker, int client_fd) {
+    Server *server = worker->server;
+    metrics_count_accept();
     
-    printf("Worker thread %d started\n", data->id);
+    struct sockaddr_in client_addr;
+    socklen_t client_len = sizeof(client_addr);
+    char client_ip[INET_ADDRSTRLEN] = "unknown";
+    if (getpeername(client_fd, (struct sockaddr *)&client_addr, &client_len) == 0) {
+        inet_ntop(AF_INET, &client_addr.sin_addr, client_ip, INET_ADDRSTRLEN);
+    }
     
+    if (server->active_connections >= server->max_connections) {
+        log_warning("Connection rejected - limit of %d reached: %s", server->max_connections, client_ip);
+        close(client_fd);
+        return;
+    }
+    
+    ConnectionInfo *info = admit_connection(server, client_fd, client_ip, worker->thread->id, NULL);
+    if (!info) {
+        close(client_fd);
+        return;
+    }
+    if (uring_set_conn_state(worker, client_fd, URING_CONN_OPEN) != 0) {
+        close(client_fd);
+        release_connection(server, client_fd);
+        return;
+    }
+    
+    log_debug("New connection from %s:%d (fd: %d)", client_ip, ntohs(client_addr.sin_port), client_fd);
+    log_connection_info(info, "established");
+    uring_arm_recv(worker, client_fd);
+}
+
+static void uring_on_recv(UringWorker *worker, int fd, struct io_uring_cqe *cqe) {
+    int has_buffer = (cqe->flags & IORING_CQE_F_BUFFER) != 0;
+    uint16_t buffer_id = (uint16_t)(cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+    int open = uring_conn_state(worker, fd) == URING_CONN_OPEN;
+    int keep = 1;
+    
+    if (cqe->res > 0 && has_buffer && open) {
+        char *buffer = uring_buffer(&worker->buffers, buffer_id);
+        buffer[cqe->res] = '\0';
+        
+        trace_request_begin();
+        access_log_request_begin();
+        // Streams and files go through the ring too, behind sends still in flight
+        ResponseSink sink = {uring_queue_send, worker, 0, uring_queue_file};
+        keep = handle_request_data(worker->server, fd, buffer, (size_t)cqe->res, &worker->thread->arena, &sink) == 0;
+        arena_reset(&worker->thread->arena);
+        rcu_quiescent_state();
+    }
+    if (has_buffer) {
+        uring_buffer_recycle(&worker->buffers, buffer_id);
+    }
+    
+    if (!open) {
+        return;
+    }
+    
+    if (!keep) {
+        uring_close_connection(worker, fd);
+    } else if (cqe->res <= 0 && cqe->res != -ENOBUFS) {
+        // Peer closed (0) or the socket failed
+        uring_close_connection(worker, fd);
+    } else if (!(cqe->flags & IORING_CQE_F_MORE)) {
+        // Multishot ends when buffers ran out or the kernel chose to stop it
+        uring_arm_recv(worker, fd);
+    }
+}
+
+static void uring_on_send(UringWorker *worker, UringSend *send_op, int res) {
+    int fd = send_op->client_fd;
+    if (res <= 0) {
+        uring_send_failed(worker, fd);
+        return;
+    }
+    send_op->offset += (size_t)res;
+    if (send_op->offset < send_op->length || send_op->file_remaining > 0) {
+        // Short send or the next piece of a file. A linked send only ends short
+        // when the link failed, so its close was cancelled and is linked again.
+        uring_submit_send(worker, send_op);
+        return;
+    }
+
+    UringConn *conn = &worker->conns[fd];
+    conn->send_head = send_op->next;
+    if (!conn->send_head) conn->send_tail = NULL;
+    // The close was added after this send had been submitted
+    if (send_op->close_after && !send_op->close_linked) uring_submit_close(worker, fd);
+    uring_free_send(send_op);
+    if (conn->send_head) uring_submit_send(worker, conn->send_head);
+}
+
+static void uring_handle_completion(UringWorker *worker, struct io_uring_cqe *cqe) {
+    unsigned op = (unsigned)(cqe->user_data & URING_OP_MASK);
+    int fd = (int)(cqe->user_data >> URING_OP_BITS);
+    
+    switch (op) {
+        case URING_OP_ACCEPT:
+            if (cqe->res >= 0) {
+                uring_on_accept(worker, cqe->res);
+            } else if (cqe->res != -ECANCELED) {
+                log_warning("Worker %d: accept failed: %s", worker->thread->id, strerror(-cqe->res));
+            }
+            if (!(cqe->flags & IORING_CQE_F_MORE) && worker->server->running) {
+                uring_arm_accept(worker);
+            }
+            break;
+        case URING_OP_RECV:
+            uring_on_recv(worker, fd, cqe);
+            break;
+        case URING_OP_SEND:
+            uring_on_send(worker, (UringSend *)(uintptr_t)(cqe->user_data & ~(uint64_t)URING_OP_MASK), cqe->res);
+            break;
+        case URING_OP_CLOSE:
+            // A close cancelled with its send was submitted again
+            if (cqe->res != -ECANCELED && uring_conn_state(worker, fd) == URING_CONN_CLOSING) {
+                uring_set_conn_state(worker, fd, URING_CONN_FREE);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+static int uring_worker_init(UringWorker *worker, Server *server, ThreadData *data) {
+    memset(worker, 0, sizeof(UringWorker));
+    worker->server = server;
+    worker->thread = data;
+    
+    if (uring_init(&worker->ring, URING_ENTRIES, server->uring_sqpoll) != 0) {
+        log_error("Worker %d: io_uring setup failed: %s", data->id, strerror(errno));
+        return -1;
+    }
+    if (uring_buffers_init(&worker->ring, &worker->buffers, URING_BUFFER_GROUP,
+                           URING_BUFFER_COUNT, URING_BUFFER_SIZE - 1) != 0) {
+        log_error("Worker %d: io_uring buffer ring unavailable: %s", data->id, strerror(errno));
+        uring_exit(&worker->ring);
+        return -1;
+    }
+    return 0;
+}
+
+static void uring_worker_cleanup(UringWorker *worker) {
+    // Connections still open are closed with the process
+    uring_buffers_free(&worker->ring, &worker->buffers);
+    uring_exit(&worker->ring);
+    for (int fd = 0; fd < worker->conn_capacity; fd++) {
+        for (UringSend *send_op = worker->conns[fd].send_head, *next; send_op; send_op = next) {
+            next = send_op->next;
+            uring_free_send(send_op);
+        }
+    }
+    free(worker->conns);
+}
+
+static void run_uring_worker(Server *server, ThreadData *data) {
+    UringWorker worker;
+    if (uring_worker_init(&worker, server, data) != 0) {
+        return;
+    }
+    uring_arm_accept(&worker);
+    
+    while (server->running) {
+        // Submit and wait; no shared snapshots are held while blocked
+        rcu_thread_offline();
+        int result = uring_submit_wait(&worker.ring, URING_WAIT_MS);
+        rcu_thread_online();
+        if (result != 0) {
+            log_error("Worker %d: io_uring_enter failed: %s", data->id, strerror(errno));
+            break;
+        }
+        
+        struct io_uring_cqe *cqe;
+        while ((cqe = uring_peek_cqe(&worker.ring)) != NULL) {
+            struct io_uring_cqe completion = *cqe;
+            uring_cqe_seen(&worker.ring);
+            uring_handle_completion(&worker, &completion);
+        }
+    }
+    
+    uring_worker_cleanup(&worker);
+}
+
+// ===== Worker Thread Function =====
+static void run_epoll_worker(Server *server, ThreadData *data) {
     struct epoll_event events[MAX_EVENTS];
     
     while (server->running) {
-        // Wait for events
+        // Wait for events; no shared snapshots are held while blocked
+        rcu_thread_offline();
         int event_count = epoll_wait(data->epoll_fd, events, MAX_EVENTS, 100);
+        rcu_thread_online();
         
         if (event_count < 0) {
             if (errno == EINTR) continue;  
@@ -361,79 +881,81 @@ static void *worker_thread(void *arg) {
             
             if (events[i].events & EPOLLIN) {
                 // Data ready to read
-                if (server_handle_request(server, client_fd) != 0) {
-                    // Error handling request, close connection
+                int handled = server_handle_request(server, client_fd, &data->arena);
+                arena_reset(&data->arena);
+                rcu_quiescent_state();
+                
+                if (handled != 0) {
+                    // Error handling request, close connection. Untracked first:
+                    // once closed, the accept loop may reuse the fd number.
                     epoll_ctl(data->epoll_fd, EPOLL_CTL_DEL, client_fd, NULL);
+                    release_connection(server, client_fd);
                     close(client_fd);
-                    
-                    // Critical Section: Update active connections safely
-                    pthread_mutex_lock(&connection_mutex);
-                    server->active_connections--;
-                    // Remove from tracking
-                    for (int j = 0; j < connection_count; j++) {
-                        if (connections[j].client_fd == client_fd) {
-                             // Swap and pop
-                             if (j < connection_count - 1) connections[j] = connections[connection_count - 1];
-                             connection_count--;
-                             break;
-                        }
-                    }
-                    pthread_mutex_unlock(&connection_mutex);
                 }
             } else if (events[i].events & (EPOLLHUP | EPOLLERR)) {
                 // Connection error or closed
                 epoll_ctl(data->epoll_fd, EPOLL_CTL_DEL, client_fd, NULL);
+                release_connection(server, client_fd);
                 close(client_fd);
-                
-                pthread_mutex_lock(&connection_mutex);
-                server->active_connections--;
-                 // Remove from tracking
-                for (int j = 0; j < connection_count; j++) {
-                    if (connections[j].client_fd == client_fd) {
-                         // Swap and pop
-                         if (j < connection_count - 1) connections[j] = connections[connection_count - 1];
-                         connection_count--;
-                         break;
-                    }
-                }
-                pthread_mutex_unlock(&connection_mutex);
             }
         }
     }
+}
+
+static void *worker_thread(void *arg) {
+    ThreadData *data = (ThreadData *)arg;
+    Server *server = data->server;
+    
+    printf("Worker thread %d started\n", data->id);
+    metrics_bind_worker(data->id);
+    
+    // Pinned before allocating, so first touch puts the worker's pages on its node
+    if (server->cpu_affinity) {
+        affinity_pin_worker(data->id);
+    }
+    
+    // Created on the worker so its pages are first touched here
+    if (arena_init(&data->arena, ARENA_DEFAULT_BLOCK_SIZE) != 0) {
+        fprintf(stderr, "Worker thread %d: failed to create request arena\n", data->id);
+        free(data);
+        return NULL;
+    }
+    
+    // Route table readers must be registered so that writers can wait for them
+    if (rcu_register_thread() != 0) {
+        fprintf(stderr, "Worker thread %d: failed to register RCU reader\n", data->id);
+        arena_destroy(&data->arena);
+        free(data);
+        return NULL;
+    }
+    
+    if (server->io_backend == IO_BACKEND_URING) {
+        run_uring_worker(server, data);
+    } else {
+        run_epoll_worker(server, data);
+    }
     
     printf("Worker thread %d exiting\n", data->id);
+    rcu_unregister_thread();
+    arena_destroy(&data->arena);
     free(data);
     return NULL;
 }
 
 // ===== Server Functions =====
-int server_init(Server *server, const Config *config) {
-    memset(server, 0, sizeof(Server));
-    
-    server->port = config->port;
-    server->thread_count = config->thread_count;
-    server->max_connections = config->max_connections;
-    server->running = 0; 
-    
-    // Initialize statistics
-    server->stats.total_requests = 0;
-    server->stats.total_responses = 0;
-    server->stats.bytes_sent = 0;
-    server->stats.bytes_received = 0; 
-    server->stats.avg_response_time = 0.0;
-    
-    // Create server socket
-    server->server_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
-    if (server->server_fd < 0) {
+// Non-blocking socket bound to `port` on all addresses and listening
+static int open_listener(uint16_t port) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (fd < 0) {
         perror("socket");
         return -1;
     }
     
     // Set socket options
     int opt = 1;
-    if (setsockopt(server->server_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
         perror("setsockopt");
-        close(server->server_fd);
+        close(fd);
         return -1;
     }
     
@@ -442,26 +964,77 @@ int server_init(Server *server, const Config *config) {
     memset(&server_addr, 0, sizeof(server_addr));
     server_addr.sin_family = AF_INET;
     server_addr.sin_addr.s_addr = INADDR_ANY;
-    server_addr.sin_port = htons(server->port);
+    server_addr.sin_port = htons(port);
     
-    if (bind(server->server_fd, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0) {
+    if (bind(fd, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0) {
         perror("bind");
-        close(server->server_fd);
+        close(fd);
         return -1;
     }
     
     // Start listening
-    if (listen(server->server_fd, BACKLOG) < 0) {
+    if (listen(fd, BACKLOG) < 0) {
         perror("listen");
-        close(server->server_fd);
+        close(fd);
         return -1;
     }
+    return fd;
+}
+
+static void close_listeners(Server *server) {
+    close(server->server_fd);
+    if (server->tls_fd >= 0) {
+        close(server->tls_fd);
+    }
+}
+
+int server_init(Server *server, const Config *config) {
+    memset(server, 0, sizeof(Server));
+    
+    server->port = config->port;
+    server->thread_count = config->thread_count;
+    server->max_connections = config->max_connections;
+    server->io_backend = config->io_backend;
+    server->uring_sqpoll = config->io_uring_sqpoll;
+    server->cpu_affinity = config->cpu_affinity;
+    server->incoming_cpu_steering = config->incoming_cpu_steering;
+    server->running = 0; 
+    
+    // Initialize statistics
+    server->stats.total_requests = 0;
+    server->stats.total_responses = 0;
+    server->stats.bytes_sent = 0;
+    server->stats.bytes_received = 0; 
+    server->stats.avg_response_time = 0.0;
+    
+    // Workers hand log lines to a background writer instead of writing them
+    init_logging(config->log_file, LOG_LEVEL_INFO);
+    if (log_start_writer() != 0) {
+        fprintf(stderr, "Failed to start log writer, logging synchronously\n");
+    }
+    
+    server->server_fd = open_listener(server->port);
+    if (server->server_fd < 0) {
+        return -1;
+    }
+    
+    // The TLS listener shares the workers; its connections start with a handshake
+    server->tls_fd = -1;
+    if (tls_is_enabled()) {
+        server->tls_port = (uint16_t)config->tls_port;
+        server->tls_fd = open_listener(server->tls_port);
+        if (server->tls_fd < 0) {
+            close(server->server_fd);
+            return -1;
+        }
+        log_info("TLS listener on port %d", server->tls_port);
+    }
     
     // Initialize thread pool
     server->thread_pool = malloc(sizeof(pthread_t) * server->thread_count);
     if (!server->thread_pool) {
         perror("malloc");
-        close(server->server_fd);
+        close_listeners(server);
         return -1;
     }
     
@@ -470,7 +1043,7 @@ int server_init(Server *server, const Config *config) {
     if (!server->request_queue) {
         perror("malloc");
         free(server->thread_pool);
-        close(server->server_fd);
+        close_listeners(server);
         return -1;
     }
     
@@ -480,7 +1053,7 @@ int server_init(Server *server, const Config *config) {
         perror("malloc");
         free(server->request_queue);
         free(server->thread_pool);
-        close(server->server_fd);
+        close_listeners(server);
         return -1;
     }
     
@@ -506,8 +1079,58 @@ int server_init(Server *server, const Config *config) {
     return 0;
 }
 
+// Fall back to epoll when the kernel lacks io_uring or buffer rings (5.19+)
+static void select_io_backend(Server *server) {
+    if (server->io_backend != IO_BACKEND_URING) {
+        return;
+    }
+    
+    // Handshakes read the socket themselves, which the multishot receive would race
+    if (server->tls_fd >= 0) {
+        log_warning("TLS listener needs the epoll backend, using epoll");
+        server->io_backend = IO_BACKEND_EPOLL;
+        return;
+    }
+    
+    Uring probe;
+    UringBuffers buffers;
+    if (uring_init(&probe, 8, server->uring_sqpoll) != 0) {
+        log_warning("io_uring unavailable (%s), using epoll", strerror(errno));
+        server->io_backend = IO_BACKEND_EPOLL;
+        return;
+    }
+    if (uring_buffers_init(&probe, &buffers, URING_BUFFER_GROUP, 1, 64) != 0) {
+        log_warning("io_uring buffer rings unavailable, using epoll");
+        server->io_backend = IO_BACKEND_EPOLL;
+    } else {
+        uring_buffers_free(&probe, &buffers);
+    }
+    uring_exit(&probe);
+    
+    if (server->io_backend == IO_BACKEND_URING) {
+        log_info("Using io_uring backend%s", server->uring_sqpoll ? " with SQPOLL" : "");
+    }
+}
+
 int server_start(Server *server) {
     server->running = 1; // Set running flag to true
+    select_io_backend(server);
+    
+    // Workers pin themselves to the planned CPUs as they start
+    if (server->cpu_affinity && affinity_init(server->thread_count) != 0) {
+        log_warning("CPU placement unavailable, workers are not pinned");
+        server->cpu_affinity = 0;
+    }
+    // io_uring workers accept on their own, so only the epoll accept loop can steer
+    if (server->incoming_cpu_steering && (!server->cpu_affinity || server->io_backend == IO_BACKEND_URING)) {
+        log_warning("incoming_cpu_steering needs cpu_affinity and the epoll backend, not steering");
+        server->incoming_cpu_steering = 0;
+    }
+    
+    // The calling thread runs the accept loop (server_process_events)
+    if (rcu_register_thread() == 0) {
+        rcu_thread_offline();
+    }
     
     // Create worker threads
     for (int i = 0; i < server->thread_count; i++) {
@@ -521,9 +1144,9 @@ int server_start(Server *server) {
         data->id = i;
         memset(&data->firewall_stats, 0, sizeof(FirewallStats));
         
-        // Create epoll instance for each thread
-        data->epoll_fd = epoll_create1(0);
-        if (data->epoll_fd < 0) {
+        // Create epoll instance for each thread; io_uring workers accept on their own
+        data->epoll_fd = server->io_backend == IO_BACKEND_URING ? -1 : epoll_create1(0);
+        if (data->epoll_fd < 0 && server->io_backend != IO_BACKEND_URING) {
             perror("epoll_create1");
             free(data);
             continue;
@@ -534,7 +1157,7 @@ int server_start(Server *server) {
         
         if (pthread_create(&((pthread_t *)server->thread_pool)[i], NULL, worker_thread, data) != 0) {
             perror("pthread_create");
-            close(data->epoll_fd);
+            if (data->epoll_fd >= 0) close(data->epoll_fd);
             free(data);
             continue;
         }
@@ -567,11 +1190,17 @@ int server_stop(Server *server) {
         }
     }
     
+    // No more accept-loop reads from this thread
+    rcu_unregister_thread();
+    
     // Clean up firewall
     firewall_cleanup();
     
     // Clean up connection tracking
     pthread_mutex_lock(&connection_mutex);
+    for (int i = 0; i < connection_count; i++) {
+        free_connection_info(connections[i]);
+    }
     free(connections);
     connections = NULL;
     connection_count = 0;
@@ -587,6 +1216,10 @@ void server_cleanup(Server *server) {
         close(server->server_fd);
     }
     
+    if (server->tls_fd >= 0) {
+        close(server->tls_fd);
+    }
+    
     if (server->thread_pool) {
         free(server->thread_pool);
     }
@@ -598,15 +1231,66 @@ void server_cleanup(Server *server) {
     if (server->epoll_fds) {
         free(server->epoll_fds);
     }
+    
+    affinity_cleanup();
+    
+    // Later lines are written directly
+    log_shutdown();
 }
 
-int server_process_events(Server *server) {
+// Firewall, on_accept hooks and tracking for a new connection; the caller closes it on NULL
+// `tls` (may be NULL) belongs to the entry on success and is freed on NULL
+static ConnectionInfo *admit_connection(Server *server, int client_fd, const char *client_ip, int thread_id,
+                                        TlsConnection *tls) {
+    // Check firewall before accepting connection
+    if (firewall_is_blacklisted(client_ip)) {
+        log_warning("Connection rejected - IP blacklisted: %s", client_ip);
+        tls_connection_free(tls);
+        return NULL;
+    }
+    
+    HookContext hook = {client_fd, NULL, NULL, NULL, 0};
+    if (pipeline_run(HOOK_ON_ACCEPT, server, &hook) < 0) {
+        log_info("Connection rejected by on_accept hook: %s", client_ip);
+        tls_connection_free(tls);
+        return NULL;
+    }
+    
+    // Add connection tracking (pass thread_id)
+    ConnectionInfo *info = add_connection_info(client_fd, client_ip, thread_id, tls);
+    if (!info) {
+        log_warning("Failed to track connection - rejecting: %s", client_ip);
+        tls_connection_free(tls);
+        return NULL;
+    }
+    
+    pthread_mutex_lock(&connection_mutex);
+    server->active_connections++;
+    pthread_mutex_unlock(&connection_mutex);
+    return info;
+}
+
+// The worker on (or nearest to) the CPU that received the connection's packets
+static int steer_connection(int client_fd, int fallback) {
+    int cpu = -1;
+    socklen_t length = sizeof(cpu);
+    if (getsockopt(client_fd, SOL_SOCKET, SO_INCOMING_CPU, &cpu, &length) == 0) {
+        int worker = affinity_steer(cpu);
+        if (worker >= 0) {
+            return worker;
+        }
+    }
+    return fallback;
+}
+
+// Accept everything waiting on one listener; TLS connections get their handshake state
+static int accept_from(Server *server, int listen_fd, int use_tls) {
     // Accept new connections
     struct sockaddr_in client_addr;
     socklen_t client_len = sizeof(client_addr);
     
     while (server->active_connections < server->max_connections) {
-        int client_fd = accept(server->server_fd, (struct sockaddr *)&client_addr, &client_len);
+        int client_fd = accept(listen_fd, (struct sockaddr *)&client_addr, &client_len);
         if (client_fd < 0) {
             if (errno == EAGAIN || errno == EWOULDBLOCK) {
                 // No more new connections
@@ -615,6 +1299,7 @@ int server_process_events(Server *server) {
             perror("accept");
             return -1;
         }
+        metrics_count_accept();
         
         // Set socket to non-blocking
         int flags = fcntl(client_fd, F_GETFL, 0);
@@ -624,20 +1309,24 @@ int server_process_events(Server *server) {
         char client_ip[INET_ADDRSTRLEN];
         inet_ntop(AF_INET, &(client_addr.sin_addr), client_ip, INET_ADDRSTRLEN);
         
-        // Check firewall before accepting connection
-        if (firewall_is_blacklisted(client_ip)) {
-            printf("Connection rejected - IP blacklisted: %s\n", client_ip);
-            close(client_fd);
-            continue;
-        }
-        
         // Distribute connection to one of threads
         int thread_id = server->active_connections % server->thread_count;
+        if (server->incoming_cpu_steering) {
+            thread_id = steer_connection(client_fd, thread_id);
+        }
         
-        // Add connection tracking (pass thread_id)
-        ConnectionInfo *info = add_connection_info(client_fd, client_ip, thread_id);
+        // The handshake state is in place before any worker can see the connection
+        TlsConnection *tls = NULL;
+        if (use_tls) {
+            tls = tls_connection_create(client_fd);
+            if (!tls) {
+                close(client_fd);
+                continue;
+            }
+        }
+        
+        ConnectionInfo *info = admit_connection(server, client_fd, client_ip, thread_id, tls);
         if (!info) {
-            printf("Failed to track connection - rejecting: %s\n", client_ip);
             close(client_fd);
             continue;
         }
@@ -651,13 +1340,11 @@ int server_process_events(Server *server) {
         if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, client_fd, &event) < 0) {
             perror("epoll_ctl");
             close(client_fd);
-            remove_connection_info(client_fd);
+            release_connection(server, client_fd);
             return -1;
         }
         
-        server->active_connections++;
-        
-        printf("New connection from %s:%d (fd: %d)\n", client_ip, ntohs(client_addr.sin_port), client_fd);
+        log_debug("New connection from %s:%d (fd: %d)", client_ip, ntohs(client_addr.sin_port), client_fd);
         
         // Log new connection
         log_connection_info(info, "established");
@@ -666,169 +1353,448 @@ int server_process_events(Server *server) {
     return 0;
 }
 
-int server_handle_request(Server *server, int client_fd) {
-    char buffer[8192];  
-    ssize_t bytes_read = recv(client_fd, buffer, sizeof(buffer) - 1, 0);
-    
-    if (bytes_read <= 0) {
-        // Connection closed by client or error
-        return -1;  
+static int accept_connections(Server *server) {
+    if (accept_from(server, server->server_fd, 0) != 0) {
+        return -1;
+    }
+    return server->tls_fd >= 0 ? accept_from(server, server->tls_fd, 1) : 0;
+}
+
+// Waits up to ACCEPT_WAIT_MS for a connection instead of the caller sleeping,
+// so a new connection (and its TLS handshake) does not sit in the backlog
+int server_process_events(Server *server) {
+    struct pollfd listeners[2] = {
+        {server->server_fd, POLLIN, 0},
+        {server->tls_fd, POLLIN, 0}
+    };
+    if (server->io_backend == IO_BACKEND_URING) {
+        // Workers accept on their own rings; this only paces the caller's loop
+        poll(NULL, 0, ACCEPT_WAIT_MS);
+        return 0;
+    }
+    if (poll(listeners, server->tls_fd >= 0 ? 2 : 1, ACCEPT_WAIT_MS) <= 0) {
+        return 0;
     }
     
-    buffer[bytes_read] = '\0';  
-    
-    // Track bytes received in server stats
-    server->stats.bytes_received += bytes_read;
-    
-    // Get connection info
+    // The accept loop reads the hook chain; stay offline between calls
+    rcu_thread_online();
+    int result = accept_connections(server);
+    rcu_thread_offline();
+    return result;
+}
+
+// Publish the request's trace and queue its access record
+static void finish_request(const ConnectionInfo *info, const HTTPRequest *request, const char *method,
+                           int status_code, size_t bytes_in, size_t bytes_out) {
+    trace_request_end(method, request->path, status_code);
+    access_log_request_end(info->ip_address, method, request->path, status_code, bytes_in, bytes_out);
+}
+
+// Writes everything; HTTP/2 output can exceed the socket buffer, so a full
+// non-blocking socket is waited on. The deadline covers the whole write: a
+// client reading a few bytes at a time gets its connection shut down rather
+// than a fresh timeout per partial send.
+static void send_direct(void *ctx, int client_fd, const char *data, size_t length) {
+    (void)ctx;
+    uint64_t deadline = get_current_time_ms() + SEND_TIMEOUT_MS + length / SEND_MIN_RATE;
+    size_t offset = 0;
+    while (offset < length) {
+        ssize_t sent = send(client_fd, data + offset, length - offset, MSG_NOSIGNAL);
+        if (sent > 0) {
+            offset += (size_t)sent;
+        } else if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            uint64_t now = get_current_time_ms();
+            struct pollfd pfd = {client_fd, POLLOUT, 0};
+            if (now >= deadline || poll(&pfd, 1, (int)(deadline - now)) <= 0) {
+                // The rest of the response is lost; the next read sees the connection end
+                shutdown(client_fd, SHUT_RDWR);
+                return;
+            }
+        } else if (sent < 0 && errno == EINTR) {
+            continue;
+        } else {
+            return;
+        }
+    }
+}
+
+// ResponseSink for TLS encrypted in user space; ctx is the TlsConnection
+static void send_tls(void *ctx, int client_fd, const char *data, size_t length) {
+    (void)client_fd;
+    tls_send(ctx, data, length);
+}
+
+static int is_http2_connection(int client_fd) {
     ConnectionInfo *info = find_connection_info(client_fd);
-    if (!info) {
-        return -1; 
+    return info && info->h2_session;
+}
+
+static TlsConnection *connection_tls(int client_fd) {
+    ConnectionInfo *info = find_connection_info(client_fd);
+    return info ? info->tls : NULL;
+}
+
+int server_handle_request(Server *server, int client_fd, Arena *arena) {
+    char buffer[8192];  
+    static const ResponseSink direct_sink = {send_direct, NULL, 1, NULL};
+    int result;
+    ssize_t bytes_read;
+    int first = 1;
+    
+    TlsConnection *tls = connection_tls(client_fd);
+    if (tls && !tls_is_established(tls)) {
+        int handshake = tls_handshake(tls);
+        if (handshake <= 0) {
+            return handshake;   // 0 waits for the next flight, -1 closes
+        }
+        // The first request may already be queued behind the client's Finished
+        first = 0;
+    }
+    // Once the kernel encrypts, plain socket writes are TLS records
+    ResponseSink tls_sink = {send_tls, tls, 0, NULL};
+    const ResponseSink *sink = tls && !tls_send_offloaded(tls) ? &tls_sink : &direct_sink;
+    
+    // Edge-triggered: an HTTP/2 connection may have more frames queued than one
+    // read takes, and OpenSSL may hold decrypted bytes the socket no longer signals
+    do {
+        trace_request_begin();
+        access_log_request_begin();
+        uint64_t phase_start = trace_now();
+        bytes_read = tls ? tls_recv(tls, buffer, sizeof(buffer) - 1) : recv(client_fd, buffer, sizeof(buffer) - 1, 0);
+        
+        if (bytes_read <= 0) {
+            trace_request_discard();
+            // Connection closed by client or error; a drained socket is fine after the first read
+            return !first && bytes_read < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+        }
+        trace_phase(TRACE_RECV, phase_start);
+        
+        buffer[bytes_read] = '\0';  
+        
+        result = handle_request_data(server, client_fd, buffer, bytes_read, arena, sink);
+        first = 0;
+    } while (result == 0 && (tls || ((size_t)bytes_read == sizeof(buffer) - 1 && is_http2_connection(client_fd))));
+    
+    return result;
+}
+
+// Where a response goes: the connection's sink for HTTP/1.1, or one stream
+// of its HTTP/2 session
+typedef struct {
+    const ResponseSink *sink;
+    H2Session *h2;
+    uint32_t stream_id;
+} ResponseTarget;
+
+// Fixed error responses are complete HTTP/1.1 messages; HTTP/2 re-encodes them
+static void send_error_response(const ResponseTarget *target, int client_fd, int status_code, const char *data) {
+    if (target->h2) {
+        RouteResponse response;
+        memset(&response, 0, sizeof(RouteResponse));
+        response.data = (char *)data;
+        response.length = strlen(data);
+        response.status_code = status_code;
+        h2_session_respond(target->h2, target->stream_id, &response);
+    } else {
+        target->sink->send(target->sink->ctx, client_fd, data, strlen(data));
     }
+}
 
-    // Update activity timestamp (Keep-Alive reset)
-    info->bytes_received += bytes_read;
-    info->requests_handled++;
-    info->last_activity = time(NULL); 
+static void flush_http2_output(H2Session *session, int client_fd, const ResponseSink *sink) {
+    size_t length;
+    const char *output = h2_session_output(session, &length);
+    if (length > 0) {
+        sink->send(sink->ctx, client_fd, output, length);
+        h2_session_output_sent(session);
+    }
+}
+
+// Streamed and file bodies for a sink that must see every byte: a stream
+// becomes a single chunk, a file is read in pieces
+static int64_t send_through_sink(const ResponseSink *sink, int client_fd, RouteResponse *response) {
+    if (response->is_streaming) {
+        static const char header[] = "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\n"
+                                     "Transfer-Encoding: chunked\r\nConnection: keep-alive\r\n\r\n";
+        size_t body_length = strlen(response->data);
+        char size_line[32];
+        int size_length = snprintf(size_line, sizeof(size_line), "%zx\r\n", body_length);
+        sink->send(sink->ctx, client_fd, header, sizeof(header) - 1);
+        if (body_length > 0) {
+            sink->send(sink->ctx, client_fd, size_line, (size_t)size_length);
+            sink->send(sink->ctx, client_fd, response->data, body_length);
+            sink->send(sink->ctx, client_fd, "\r\n", 2);
+        }
+        sink->send(sink->ctx, client_fd, "0\r\n\r\n", 5);
+        return (int64_t)(sizeof(header) - 1 + (body_length > 0 ? (size_t)size_length + body_length + 2 : 0) + 5);
+    }
     
-    // Parse request
-    HTTPRequest request;
-    if (parse_http_request(buffer, &request) != 0) {
-        // Check for firewall attack patterns in raw request - only high severity patterns
-        if (contains_attack_pattern(buffer, "<script") || 
-            contains_attack_pattern(buffer, "javascript:") ||
-            contains_attack_pattern(buffer, "eval(")) {
-            printf("Connection blocked by firewall - attack pattern detected\n");
-            info->flagged_suspicious = 1;
-            log_connection_info(info, "blocked");
+    if (sink->send_file) {
+        return sink->send_file(sink->ctx, client_fd, response);
+    }
+    const StaticFile *file = response->file;
+    char *chunk = malloc(TLS_FILE_CHUNK);
+    if (!chunk) {
+        return -1;
+    }
+    sink->send(sink->ctx, client_fd, response->data, response->length);
+    uint64_t offset = response->file_offset;
+    uint64_t remaining = response->file_length;
+    while (remaining > 0) {
+        size_t want = remaining < TLS_FILE_CHUNK ? (size_t)remaining : TLS_FILE_CHUNK;
+        ssize_t n = pread(file->fd, chunk, want, (off_t)offset);
+        if (n <= 0) {
+            free(chunk);
             return -1;
         }
-        
-        // Error parsing request
-        const char *error_response = "HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
-        send(client_fd, error_response, strlen(error_response), 0);
+        sink->send(sink->ctx, client_fd, chunk, (size_t)n);
+        offset += (uint64_t)n;
+        remaining -= (uint64_t)n;
+    }
+    free(chunk);
+    return (int64_t)(response->length + response->file_length);
+}
+
+// Hooks, firewall checks, routing and the response for a parsed request.
+// Returns 0 to keep the connection, -1 to close it.
+static int serve_request(Server *server, ConnectionInfo *info, int client_fd, HTTPRequest *request,
+                         size_t bytes_in, const ResponseTarget *target) {
+    metrics_count_request();
+    const char *method = http_method_name(request->method);
+    
+    // Header and body hooks; the whole request is already buffered, so they run back to back
+    HookContext hook = {client_fd, request, NULL, NULL, 0};
+    uint64_t phase_start = trace_now();
+    int hook_result = pipeline_run(HOOK_ON_HEADERS, server, &hook);
+    if (hook_result >= 0 && request->body_length > 0) {
+        hook.data = request->body;
+        hook.data_len = request->body_length;
+        hook_result = pipeline_run(HOOK_ON_BODY, server, &hook);
+    }
+    trace_phase(TRACE_HOOKS, phase_start);
+    if (hook_result < 0) {
+        metrics_count_rejected();
+        const char *error_response = "HTTP/1.1 403 Forbidden\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+        send_error_response(target, client_fd, 403, error_response);
+        finish_request(info, request, method, 403, bytes_in, strlen(error_response));
+        free_http_request(request);
         return -1;
     }
     
     // Extract API key for potential future use
-    (void)extract_api_key(&request);  
+    (void)extract_api_key(request);  
     
     // Check firewall with basic detection - only for blacklisted IPs
+    phase_start = trace_now();
     if (firewall_is_blacklisted(info->ip_address)) {
-        printf("Connection blocked by firewall - IP blacklisted\n");
+        log_warning("Connection blocked by firewall - IP blacklisted: %s", info->ip_address);
+        metrics_count_rejected();
+        finish_request(info, request, method, 403, bytes_in, 0);
         info->flagged_suspicious = 1;
         log_connection_info(info, "blocked");
-        free_http_request(&request);
+        free_http_request(request);
         return -1;
     }
     
     // Check for suspicious request patterns
-    if (is_suspicious_request(&request)) {
-        printf("Suspicious request detected from %s\n", info->ip_address);
+    if (is_suspicious_request(request)) {
+        log_warning("Suspicious request detected from %s", info->ip_address);
         info->flagged_suspicious = 1;
         
         // Only add to blacklist if it's a serious threat
-        char *user_agent = get_header_value(&request, "User-Agent");
+        char *user_agent = get_header_value(request, "User-Agent");
         if (is_suspicious_user_agent(user_agent)) {
             firewall_add_to_blacklist(info->ip_address, BLOCK_REASON_SUSPICIOUS, "Malicious user agent");
+            metrics_count_rejected();
+            finish_request(info, request, method, 403, bytes_in, 0);
             log_connection_info(info, "suspicious");
-            free_http_request(&request);
+            free_http_request(request);
             return -1;
         }
     }
     
-    // If request contains JSON, use optimized tokenizer
-    if (request.content_type && strstr(request.content_type, "application/json")) {
-        JSONValue json_result;
-        if (parse_json_with_fast_tokenizer(request.body, request.body_length, &json_result) == 0) {
-            // You can use the parsed JSON here
-            free(json_result.key);
-            free(json_result.value.str);
-        }
-    }
+    trace_phase(TRACE_FIREWALL, phase_start);
     
     // Route request
     RouteResponse response;
     
-    if (route_request(server, &request, &response) != 0) {
+    phase_start = trace_now();
+    int route_result = route_request(server, request, &response);
+    trace_phase(TRACE_ROUTE, phase_start);
+    if (route_result != 0) {
         // Error routing
         const char *error_response = "HTTP/1.1 500 Internal Server Error\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
-        send(client_fd, error_response, strlen(error_response), 0);
-        free_http_request(&request);
+        send_error_response(target, client_fd, 500, error_response);
+        metrics_count_response(500, strlen(error_response));
+        finish_request(info, request, method, 500, bytes_in, strlen(error_response));
+        free_http_request(request);
         return -1;
     }
     
-    // Keep-Alive Logic (FIXED)
-    int keep_alive = 0;
-    // Check if client requested Keep-Alive
-    char *conn_header = get_header_value(&request, "Connection");
-    if (conn_header && strstr(conn_header, "keep-alive")) {
-        keep_alive = 1;
+    // Keep-Alive: the router already wrote the matching Connection header
+    // (static files also keep it after a 206 or 304). An HTTP/2 stream ending
+    // never closes its connection.
+    int keep_alive = target->h2 || (request->keep_alive && (response.status_code == 200 ||
+                                                            response.status_code == 206 ||
+                                                            response.status_code == 304));
+    size_t bytes_out = response.length;
+    
+    phase_start = trace_now();
+    if (target->h2) {
+        // Framed into the session's output; the caller writes it after the batch
+        int64_t sent = h2_session_respond(target->h2, target->stream_id, &response);
+        if (sent < 0) {
+            keep_alive = 0;
+        } else {
+            bytes_out = (size_t)sent;
+        }
+    } else if (!target->sink->socket_writes && (response.is_streaming || response.file)) {
+        // Bytes written to the socket would skip encryption
+        int64_t sent = send_through_sink(target->sink, client_fd, &response);
+        if (sent < 0) {
+            keep_alive = 0;
+        } else {
+            bytes_out = (size_t)sent;
+        }
+    } else if (response.is_streaming) {
+        stream_response(client_fd, &response);
+    } else if (response.file) {
+        // File bodies go from the page cache with sendfile(), written directly like streams
+        int64_t sent = static_file_send(client_fd, response.data, response.length, response.file,
+                                        response.file_offset, response.file_length);
+        if (sent < 0) {
+            keep_alive = 0;
+        } else {
+            bytes_out = (size_t)sent;
+        }
+    } else {
+        target->sink->send(target->sink->ctx, client_fd, response.data, response.length);
     }
+    trace_phase(TRACE_SEND, phase_start);
+    
+    // Update statistics
+    server->stats.total_requests++;
+    server->stats.total_responses++;
+    server->stats.bytes_sent += bytes_out;
+    metrics_count_response(response.status_code, bytes_out);
+    
+    if (info) {
+        // A long response counts as activity, not only the request bytes
+        info->bytes_sent += bytes_out;
+        info->last_activity = time(NULL);
+    }
+    
+    hook.response = &response;
+    hook.data = NULL;
+    hook.data_len = 0;
+    pipeline_run(HOOK_POST_RESPONSE, server, &hook);
+    finish_request(info, request, method, response.status_code, bytes_in, bytes_out);
+    
+    // Response data lives in the request arena; the worker resets it
+    free_http_request(request);
+    free_route_response(&response);
+    
+    return keep_alive ? 0 : -1; // -1 signals the worker thread to close the connection
+}
 
-    // If client wants keep-alive AND response is OK, patch the response header
-    if (keep_alive && response.status_code == 200) {
-        // Router typically sets "Connection: close". We need to patch it.
-        char *conn_close_ptr = strstr(response.data, "Connection: close");
-        if (conn_close_ptr) {
-            // FIX: Realloc to expand buffer to prevent heap corruption
-            // "Connection: close" (17 bytes) -> "Connection: keep-alive" (22 bytes)
-            // We need 5 extra bytes.
-            ptrdiff_t offset = conn_close_ptr - response.data; // Save offset before realloc
-            
-            char *new_data = realloc(response.data, response.length + 5);
-            if (new_data) {
-                response.data = new_data;
-                conn_close_ptr = new_data + offset; // Update pointer after realloc
-                
-                // Move the rest of the string to the right by 5 bytes
-                memmove(conn_close_ptr + 22, conn_close_ptr + 17, strlen(conn_close_ptr + 17) + 1);
-                memcpy(conn_close_ptr, "Connection: keep-alive", 22);
-                response.length += 5; // Update length
-            } else {
-                // Realloc failed, fallback to close
-                keep_alive = 0;
-            }
+// Frames for an HTTP/2 connection: every stream completed by them is served
+// in turn, each traced and logged as its own request, and all the output is
+// written at once
+static int handle_http2_data(Server *server, ConnectionInfo *info, int client_fd, const char *buffer,
+                             size_t bytes_read, Arena *arena, const ResponseSink *sink) {
+    trace_request_discard();
+    H2Session *session = info->h2_session;
+    int result = h2_session_receive(session, buffer, bytes_read);
+    
+    ResponseTarget target = {sink, session, 0};
+    HTTPRequest request;
+    while (result == 0 && (target.stream_id = h2_session_next_request(session, &request, arena)) != 0) {
+        trace_request_begin();
+        access_log_request_begin();
+        request.client_fd = client_fd;
+        info->requests_handled++;
+        result = serve_request(server, info, client_fd, &request, request.body_length, &target);
+        arena_reset(arena);
+    }
+    
+    flush_http2_output(session, client_fd, sink);
+    return result == 0 && !h2_session_is_closing(session) ? 0 : -1;
+}
+
+// Everything after the bytes arrived; shared by both backends. `buffer` is
+// NUL-terminated at bytes_read. Returns 0 to keep the connection, -1 to close it.
+static int handle_request_data(Server *server, int client_fd, char *buffer, size_t bytes_read,
+                               Arena *arena, const ResponseSink *sink) {
+    // Track bytes received in server stats
+    server->stats.bytes_received += bytes_read;
+    metrics_count_read(bytes_read);
+    
+    // Get connection info
+    ConnectionInfo *info = find_connection_info(client_fd);
+    if (!info) {
+        trace_request_discard();
+        return -1; 
+    }
+
+    // Update activity timestamp (Keep-Alive reset)
+    info->bytes_received += bytes_read;
+    info->last_activity = time(NULL); 
+    
+    // HTTP/2 with prior knowledge opens with the client preface
+    if (!info->h2_session && h2_is_preface(buffer, bytes_read)) {
+        H2Session *session = h2_session_create();
+        if (!session) {
+            trace_request_discard();
+            return -1;
         }
-        
-        // Send response
-        send(client_fd, response.data, response.length, 0);
-        
-        // Update Stats
-        server->stats.total_requests++;
-        server->stats.total_responses++;
-        server->stats.bytes_sent += response.length;
-        if (info) info->bytes_sent += response.length;
-
-        // Free memory but DO NOT close socket (Return 0)
-        free_http_request(&request);
-        free_route_response(&response);
-        
-        return 0; // Keep connection alive!
-    } 
-    else {
-        // Normal behavior: Close connection
-        if (response.is_streaming) {
-            stream_response(client_fd, &response);
-        } else {
-            send(client_fd, response.data, response.length, 0);
+        attach_h2_session(info, session);
+    }
+    if (info->h2_session) {
+        return handle_http2_data(server, info, client_fd, buffer, bytes_read, arena, sink);
+    }
+    info->requests_handled++;
+    
+    // Parse request
+    HTTPRequest request;
+    uint64_t phase_start = trace_now();
+    if (parse_http_request(buffer, bytes_read, &request, arena) != 0) {
+        metrics_count_rejected();
+        trace_request_discard();
+        // Check for firewall attack patterns in raw request - only high severity patterns
+        if (contains_attack_pattern(buffer, "<script") || 
+            contains_attack_pattern(buffer, "javascript:") ||
+            contains_attack_pattern(buffer, "eval(")) {
+            log_warning("Connection blocked by firewall - attack pattern detected from %s", info->ip_address);
+            info->flagged_suspicious = 1;
+            log_connection_info(info, "blocked");
+            return -1;
         }
         
-        // Update statistics
-        server->stats.total_requests++;
-        server->stats.total_responses++;
-        server->stats.bytes_sent += response.length;
-        
-        if (info) {
-            info->bytes_sent += response.length;
+        // Error parsing request
+        const char *error_response = "HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+        sink->send(sink->ctx, client_fd, error_response, strlen(error_response));
+        return -1;
+    }
+    
+    trace_phase(TRACE_PARSE, phase_start);
+    request.client_fd = client_fd;
+    
+    // Upgrade: h2c is answered with 101 and the request becomes stream 1
+    if (h2_is_upgrade_request(&request)) {
+        H2Session *session = h2_session_create_upgraded(&request);
+        if (session) {
+            static const char switching[] = "HTTP/1.1 101 Switching Protocols\r\nConnection: Upgrade\r\nUpgrade: h2c\r\n\r\n";
+            sink->send(sink->ctx, client_fd, switching, sizeof(switching) - 1);
+            attach_h2_session(info, session);
+            
+            ResponseTarget target = {sink, session, 1};
+            int result = serve_request(server, info, client_fd, &request, bytes_read, &target);
+            flush_http2_output(session, client_fd, sink);
+            return result;
         }
-        
-        // Free request and response memory
-        free_http_request(&request);
-        free_route_response(&response);
-        
-        return -1; // Signal to worker thread to close connection
     }
+    
+    ResponseTarget target = {sink, NULL, 0};
+    return serve_request(server, info, client_fd, &request, bytes_read, &target);
 }
 
 int server_send_response(Server *server, int client_fd, const char *response, size_t length) {
@@ -860,13 +1826,17 @@ int server_get_active_connections(Server *server) {
 }
 
 int server_get_connection_info(int client_fd, ConnectionInfo *info) {
-    ConnectionInfo *conn_info = find_connection_info(client_fd);
-    if (!conn_info) {
-        return -1;
+    int result = -1;
+    pthread_mutex_lock(&connection_mutex);
+    for (int i = 0; i < connection_count; i++) {
+        if (connections[i]->client_fd == client_fd) {
+            memcpy(info, connections[i], sizeof(ConnectionInfo));
+            result = 0;
+            break;
+        }
     }
-    
-    memcpy(info, conn_info, sizeof(ConnectionInfo));
-    return 0;
+    pthread_mutex_unlock(&connection_mutex);
+    return result;
 }
 
 int server_get_firewall_stats(FirewallStats *stats) {
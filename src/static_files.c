@@ -0,0 +1,549 @@
+#define _GNU_SOURCE
+
+// ===== Standard Library Headers =====
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/openat2.h>
+
+// ===== Project Headers =====
+#include "static_files.h"
+#include "asm_utils.h"
+#include "utils.h"
+
+// ===== Constants =====
+#define STATIC_SEND_TIMEOUT_MS 30000    // A response may take this long...
+#define STATIC_MIN_SEND_RATE 64         // ...plus 1 ms per this many body bytes
+#define STATIC_SENDFILE_CHUNK (1u << 30)
+
+typedef struct CacheEntry {
+    StaticFile file;                    // First, so a StaticFile * is its entry
+    char *path;
+    size_t path_length;
+    uint32_t hash;
+    ino_t inode;
+    struct timespec mtime;
+    time_t checked_at;                  // Last time the file was known unchanged
+    int refs;                           // One for the cache while listed, one per user
+    int listed;
+    struct CacheEntry *hash_next;
+    struct CacheEntry *lru_prev;        // Towards the most recently used
+    struct CacheEntry *lru_next;
+} CacheEntry;
+
+typedef struct {
+    const char *extension;
+    const char *content_type;
+} ContentType;
+
+static const ContentType content_types[] = {
+    {"html", "text/html; charset=utf-8"},
+    {"htm", "text/html; charset=utf-8"},
+    {"css", "text/css; charset=utf-8"},
+    {"js", "text/javascript; charset=utf-8"},
+    {"mjs", "text/javascript; charset=utf-8"},
+    {"json", "application/json"},
+    {"map", "application/json"},
+    {"txt", "text/plain; charset=utf-8"},
+    {"xml", "application/xml"},
+    {"svg", "image/svg+xml"},
+    {"png", "image/png"},
+    {"jpg", "image/jpeg"},
+    {"jpeg", "image/jpeg"},
+    {"gif", "image/gif"},
+    {"webp", "image/webp"},
+    {"ico", "image/x-icon"},
+    {"woff", "font/woff"},
+    {"woff2", "font/woff2"},
+    {"ttf", "font/ttf"},
+    {"wasm", "application/wasm"},
+    {"pdf", "application/pdf"},
+};
+
+// ===== Global Variables =====
+static pthread_mutex_t static_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int root_fd = -1;
+static CacheEntry **buckets = NULL;
+static size_t bucket_mask = 0;
+static CacheEntry *lru_head = NULL;
+static CacheEntry *lru_tail = NULL;
+static int cached_count = 0;
+static int cache_capacity = 0;
+
+static _Atomic uint64_t cache_hits = 0;
+static _Atomic uint64_t cache_misses = 0;
+
+// ===== Paths and Types =====
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Decodes %XX escapes into `out` and checks every segment; returns the length or -1
+static int decode_path(const char *path, size_t length, char *out, size_t out_size) {
+    size_t n = 0;
+    for (size_t i = 0; i < length; i++) {
+        char c = path[i];
+        if (c == '%') {
+            if (i + 2 >= length) return -1;
+            int high = hex_value(path[i + 1]);
+            int low = hex_value(path[i + 2]);
+            if (high < 0 || low < 0) return -1;
+            c = (char)(high << 4 | low);
+            i += 2;
+        }
+        if (c == '\0' || c == '\\' || n + 1 >= out_size) return -1;
+        out[n++] = c;
+    }
+    out[n] = '\0';
+
+    const char *segment = out;
+    while (1) {
+        const char *end = strchr(segment, '/');
+        size_t segment_length = end ? (size_t)(end - segment) : strlen(segment);
+        if (segment_length == 0 || segment[0] == '.') return -1;
+        if (!end) break;
+        segment = end + 1;
+    }
+    return (int)n;
+}
+
+static const char *content_type_for(const char *path) {
+    const char *dot = strrchr(path, '.');
+    if (dot && !strchr(dot, '/')) {
+        for (size_t i = 0; i < sizeof(content_types) / sizeof(content_types[0]); i++) {
+            if (strcasecmp(dot + 1, content_types[i].extension) == 0) {
+                return content_types[i].content_type;
+            }
+        }
+    }
+    return "application/octet-stream";
+}
+
+// The ETag is the CRC32 of the contents and the size; files that cannot be
+// mapped fall back to their inode and modification time
+static void compute_etag(CacheEntry *entry, const struct stat *st) {
+    uint32_t crc;
+    void *map = MAP_FAILED;
+    if (st->st_size > 0) {
+        map = mmap(NULL, (size_t)st->st_size, PROT_READ, MAP_PRIVATE, entry->file.fd, 0);
+    }
+    if (map != MAP_FAILED) {
+        madvise(map, (size_t)st->st_size, MADV_SEQUENTIAL);
+        crc = crc32_asm(map, (size_t)st->st_size);
+        munmap(map, (size_t)st->st_size);
+    } else {
+        uint64_t identity[3] = {(uint64_t)st->st_ino, (uint64_t)st->st_mtim.tv_sec, (uint64_t)st->st_mtim.tv_nsec};
+        crc = st->st_size > 0 ? crc32_asm(identity, sizeof(identity)) : crc32_asm("", 0);
+    }
+    snprintf(entry->file.etag, sizeof(entry->file.etag), "\"%08x-%llx\"",
+             crc, (unsigned long long)st->st_size);
+}
+
+static int same_file(const CacheEntry *entry, const struct stat *st) {
+    return entry->inode == st->st_ino && entry->file.size == (uint64_t)st->st_size &&
+           entry->mtime.tv_sec == st->st_mtim.tv_sec && entry->mtime.tv_nsec == st->st_mtim.tv_nsec;
+}
+
+// ===== Cache =====
+
+static void destroy_entry(CacheEntry *entry) {
+    close(entry->file.fd);
+    free(entry->path);
+    free(entry);
+}
+
+// Caller holds static_mutex; returns the entry if this dropped the last reference
+static CacheEntry *unref_locked(CacheEntry *entry) {
+    return --entry->refs == 0 ? entry : NULL;
+}
+
+static void lru_unlink(CacheEntry *entry) {
+    if (entry->lru_prev) entry->lru_prev->lru_next = entry->lru_next;
+    else lru_head = entry->lru_next;
+    if (entry->lru_next) entry->lru_next->lru_prev = entry->lru_prev;
+    else lru_tail = entry->lru_prev;
+    entry->lru_prev = entry->lru_next = NULL;
+}
+
+static void lru_push_front(CacheEntry *entry) {
+    entry->lru_prev = NULL;
+    entry->lru_next = lru_head;
+    if (lru_head) lru_head->lru_prev = entry;
+    lru_head = entry;
+    if (!lru_tail) lru_tail = entry;
+}
+
+// Takes the entry out of the table and LRU list; returns it if now unreferenced
+static CacheEntry *unlist_locked(CacheEntry *entry) {
+    CacheEntry **link = &buckets[entry->hash & bucket_mask];
+    while (*link && *link != entry) link = &(*link)->hash_next;
+    if (*link) *link = entry->hash_next;
+    lru_unlink(entry);
+    entry->listed = 0;
+    cached_count--;
+    return unref_locked(entry);
+}
+
+static CacheEntry *find_locked(const char *path, size_t length, uint32_t hash) {
+    if (!buckets) return NULL;
+    for (CacheEntry *entry = buckets[hash & bucket_mask]; entry; entry = entry->hash_next) {
+        if (entry->hash == hash && entry->path_length == length && memcmp(entry->path, path, length) == 0) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+// Opens a decoded path without leaving root_fd through a symlink and without
+// blocking on a FIFO; errno as for openat()
+static int open_beneath(const char *path) {
+    struct open_how how = {
+        .flags = O_RDONLY | O_CLOEXEC | O_NOCTTY | O_NONBLOCK,
+        .resolve = RESOLVE_BENEATH | RESOLVE_NO_MAGICLINKS,
+    };
+    int fd = (int)syscall(SYS_openat2, root_fd, path, &how, sizeof(how));
+    if (fd >= 0 || errno != ENOSYS) return fd;
+
+    // Before Linux 5.6: one component at a time, refusing every symlink
+    int dir = root_fd;
+    const char *segment = path;
+    for (const char *end; (end = strchr(segment, '/')) != NULL; segment = end + 1) {
+        char component[NAME_MAX + 1];
+        size_t component_length = (size_t)(end - segment);
+        if (component_length > NAME_MAX) {
+            fd = -1;
+            errno = ENAMETOOLONG;
+        } else {
+            memcpy(component, segment, component_length);
+            component[component_length] = '\0';
+            fd = openat(dir, component, O_PATH | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+        }
+        if (dir != root_fd) close(dir);
+        if (fd < 0) return -1;
+        dir = fd;
+    }
+    fd = openat(dir, segment, O_RDONLY | O_CLOEXEC | O_NOCTTY | O_NONBLOCK | O_NOFOLLOW);
+    if (dir != root_fd) {
+        int saved = errno;
+        close(dir);
+        errno = saved;
+    }
+    return fd;
+}
+
+static CacheEntry *open_entry(const char *path, size_t length, uint32_t hash) {
+    int fd = open_beneath(path);
+    if (fd < 0) {
+        if (errno != EACCES) errno = ENOENT;
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        errno = ENOENT;
+        return NULL;
+    }
+
+    CacheEntry *entry = calloc(1, sizeof(CacheEntry));
+    char *path_copy = entry ? malloc(length + 1) : NULL;
+    if (!path_copy) {
+        free(entry);
+        close(fd);
+        errno = ENOMEM;
+        return NULL;
+    }
+    memcpy(path_copy, path, length + 1);
+
+    entry->file.fd = fd;
+    entry->file.size = (uint64_t)st.st_size;
+    entry->file.mtime = st.st_mtim.tv_sec;
+    entry->file.content_type = content_type_for(path);
+    entry->path = path_copy;
+    entry->path_length = length;
+    entry->hash = hash;
+    entry->inode = st.st_ino;
+    entry->mtime = st.st_mtim;
+    entry->checked_at = time(NULL);
+    compute_etag(entry, &st);
+    return entry;
+}
+
+// ===== Public API =====
+
+int static_files_init(const char *root, int max_open) {
+    if (!root || max_open <= 0) return -1;
+
+    int fd = open(root, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        log_error("Cannot open static root %s: %s", root, strerror(errno));
+        return -1;
+    }
+
+    size_t bucket_count = 16;
+    while (bucket_count < (size_t)max_open * 2) bucket_count <<= 1;
+    CacheEntry **table = calloc(bucket_count, sizeof(CacheEntry *));
+    if (!table) {
+        close(fd);
+        return -1;
+    }
+
+    pthread_mutex_lock(&static_mutex);
+    root_fd = fd;
+    buckets = table;
+    bucket_mask = bucket_count - 1;
+    cache_capacity = max_open;
+    cached_count = 0;
+    lru_head = lru_tail = NULL;
+    pthread_mutex_unlock(&static_mutex);
+
+    log_info("Serving static files from %s (%d cached descriptors)", root, max_open);
+    return 0;
+}
+
+void static_files_cleanup(void) {
+    pthread_mutex_lock(&static_mutex);
+    // Entries still being sent are closed by their last static_file_release()
+    while (lru_head) {
+        CacheEntry *unused = unlist_locked(lru_head);
+        if (unused) destroy_entry(unused);
+    }
+    free(buckets);
+    buckets = NULL;
+    if (root_fd >= 0) close(root_fd);
+    root_fd = -1;
+    cache_capacity = 0;
+    pthread_mutex_unlock(&static_mutex);
+}
+
+int static_files_is_enabled(void) {
+    return root_fd >= 0;
+}
+
+StaticFile *static_file_acquire(const char *path, size_t length) {
+    char decoded[PATH_MAX];
+    int decoded_length = decode_path(path, length, decoded, sizeof(decoded));
+    if (decoded_length < 0 || !static_files_is_enabled()) {
+        errno = ENOENT;
+        return NULL;
+    }
+    uint32_t hash = crc32_asm(decoded, (size_t)decoded_length);
+    time_t now = time(NULL);
+
+    pthread_mutex_lock(&static_mutex);
+    CacheEntry *entry = find_locked(decoded, (size_t)decoded_length, hash);
+    if (entry) {
+        entry->refs++;
+        lru_unlink(entry);
+        lru_push_front(entry);
+        if (now - entry->checked_at < STATIC_REVALIDATE_SECONDS) {
+            pthread_mutex_unlock(&static_mutex);
+            atomic_fetch_add_explicit(&cache_hits, 1, memory_order_relaxed);
+            return &entry->file;
+        }
+    }
+    pthread_mutex_unlock(&static_mutex);
+
+    // A stale entry costs one stat() if the file is unchanged
+    if (entry) {
+        struct stat st;
+        int unchanged = fstatat(root_fd, decoded, &st, 0) == 0 && same_file(entry, &st);
+        CacheEntry *unused = NULL;
+
+        pthread_mutex_lock(&static_mutex);
+        if (unchanged) {
+            entry->checked_at = now;
+        } else {
+            // Our reference keeps the entry alive past unlisting
+            if (entry->listed) unlist_locked(entry);
+            unused = unref_locked(entry);
+        }
+        pthread_mutex_unlock(&static_mutex);
+
+        if (unchanged) {
+            atomic_fetch_add_explicit(&cache_hits, 1, memory_order_relaxed);
+            return &entry->file;
+        }
+        if (unused) destroy_entry(unused);
+    }
+
+    // Opened and hashed outside the lock
+    entry = open_entry(decoded, (size_t)decoded_length, hash);
+    if (!entry) return NULL;
+    atomic_fetch_add_explicit(&cache_misses, 1, memory_order_relaxed);
+
+    CacheEntry *evicted[2] = {NULL, NULL};
+    pthread_mutex_lock(&static_mutex);
+    if (!buckets) {
+        // Cleaned up meanwhile; the caller still gets its file
+        entry->refs = 1;
+        pthread_mutex_unlock(&static_mutex);
+        return &entry->file;
+    }
+    CacheEntry *previous = find_locked(decoded, (size_t)decoded_length, hash);
+    if (previous) evicted[0] = unlist_locked(previous);
+    if (cached_count >= cache_capacity && lru_tail) evicted[1] = unlist_locked(lru_tail);
+
+    entry->refs = 2;
+    entry->listed = 1;
+    entry->hash_next = buckets[hash & bucket_mask];
+    buckets[hash & bucket_mask] = entry;
+    lru_push_front(entry);
+    cached_count++;
+    pthread_mutex_unlock(&static_mutex);
+
+    for (int i = 0; i < 2; i++) {
+        if (evicted[i]) destroy_entry(evicted[i]);
+    }
+    return &entry->file;
+}
+
+void static_file_release(StaticFile *file) {
+    if (!file) return;
+    pthread_mutex_lock(&static_mutex);
+    CacheEntry *unused = unref_locked((CacheEntry *)file);
+    pthread_mutex_unlock(&static_mutex);
+    if (unused) destroy_entry(unused);
+}
+
+static int parse_offset(const char *p, const char *end, uint64_t *value) {
+    if (p == end) return -1;
+    uint64_t v = 0;
+    for (; p < end; p++) {
+        if (*p < '0' || *p > '9' || v > (UINT64_MAX - 9) / 10) return -1;
+        v = v * 10 + (uint64_t)(*p - '0');
+    }
+    *value = v;
+    return 0;
+}
+
+int static_parse_range(const char *header, uint64_t size, uint64_t *start, uint64_t *length) {
+    if (!header) return 0;
+    while (*header == ' ' || *header == '\t') header++;
+    if (strncasecmp(header, "bytes=", 6) != 0) return 0;
+    const char *spec = header + 6;
+    const char *end = spec + strcspn(spec, "\r\n");
+    while (end > spec && (end[-1] == ' ' || end[-1] == '\t')) end--;
+    const char *dash = memchr(spec, '-', (size_t)(end - spec));
+    if (!dash || memchr(spec, ',', (size_t)(end - spec))) return 0;
+
+    uint64_t first, last;
+    if (dash == spec) {
+        // Suffix range: the final N bytes
+        if (parse_offset(dash + 1, end, &last) != 0) return 0;
+        if (last == 0 || size == 0) return -1;
+        *start = last < size ? size - last : 0;
+        *length = size - *start;
+        return 1;
+    }
+
+    if (parse_offset(spec, dash, &first) != 0) return 0;
+    if (dash + 1 == end) {
+        last = size - 1;
+    } else if (parse_offset(dash + 1, end, &last) != 0 || last < first) {
+        return 0;
+    }
+    if (first >= size) return -1;
+    if (last >= size) last = size - 1;
+    *start = first;
+    *length = last - first + 1;
+    return 1;
+}
+
+int static_etag_matches(const char *header, const char *etag) {
+    if (!header) return 0;
+    size_t etag_length = strlen(etag);
+    const char *p = header;
+    while (*p && *p != '\r' && *p != '\n') {
+        while (*p == ' ' || *p == '\t' || *p == ',') p++;
+        if (*p == '*') return 1;
+        if (strncmp(p, "W/", 2) == 0) p += 2;
+        const char *tag_end = p + strcspn(p, ",\r\n");
+        const char *trimmed = tag_end;
+        while (trimmed > p && (trimmed[-1] == ' ' || trimmed[-1] == '\t')) trimmed--;
+        if ((size_t)(trimmed - p) == etag_length && memcmp(p, etag, etag_length) == 0) return 1;
+        p = tag_end;
+    }
+    return 0;
+}
+
+// Wait for room in the socket until `deadline_ms` (get_current_time_ms() clock)
+static int wait_writable(int fd, uint64_t deadline_ms) {
+    struct pollfd pfd = {fd, POLLOUT, 0};
+    int ready;
+    do {
+        uint64_t now = get_current_time_ms();
+        if (now >= deadline_ms) return -1;
+        ready = poll(&pfd, 1, (int)(deadline_ms - now));
+    } while (ready < 0 && errno == EINTR);
+    return ready > 0 && !(pfd.revents & (POLLERR | POLLHUP)) ? 0 : -1;
+}
+
+int64_t static_file_send(int client_fd, const char *header, size_t header_length,
+                         const StaticFile *file, uint64_t offset, uint64_t length) {
+    int64_t total = 0;
+
+    // One deadline for the whole response, so a client that reads a few bytes
+    // at a time cannot hold the worker for a timeout per partial send
+    uint64_t deadline = get_current_time_ms() + STATIC_SEND_TIMEOUT_MS + length / STATIC_MIN_SEND_RATE;
+
+    // MSG_MORE holds the headers back so they share a segment with the body
+    size_t sent = 0;
+    while (sent < header_length) {
+        ssize_t n = send(client_fd, header + sent, header_length - sent,
+                         MSG_NOSIGNAL | (length > 0 ? MSG_MORE : 0));
+        if (n > 0) {
+            sent += (size_t)n;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) && wait_writable(client_fd, deadline) == 0) {
+            continue;
+        } else {
+            return -1;
+        }
+    }
+    total += (int64_t)sent;
+
+    off_t position = (off_t)offset;
+    uint64_t remaining = length;
+    while (remaining > 0) {
+        size_t chunk = remaining < STATIC_SENDFILE_CHUNK ? (size_t)remaining : STATIC_SENDFILE_CHUNK;
+        ssize_t n = sendfile(client_fd, file->fd, &position, chunk);
+        if (n > 0) {
+            remaining -= (uint64_t)n;
+            total += n;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) && wait_writable(client_fd, deadline) == 0) {
+            continue;
+        } else {
+            // n == 0: the file shrank under us
+            return -1;
+        }
+    }
+    return total;
+}
+
+void static_files_get_counts(uint64_t *hits, uint64_t *misses) {
+    if (hits) *hits = atomic_load_explicit(&cache_hits, memory_order_relaxed);
+    if (misses) *misses = atomic_load_explicit(&cache_misses, memory_order_relaxed);
+}
@@ -0,0 +1,146 @@
+#define _POSIX_C_SOURCE 200809L
+
+// ===== Standard Library Headers =====
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+#include <errno.h>
+
+// ===== Project Headers =====
+#include "thread_ring.h"
+
+// Serializes the one-time creation of each list's key
+static pthread_mutex_t key_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// ===== Per-Thread Rings =====
+
+static void release_ring(void *ring) {
+    atomic_store_explicit(&((ThreadRing *)ring)->in_use, 0, memory_order_release);
+}
+
+static int ensure_key(ThreadRingList *list) {
+    if (atomic_load_explicit(&list->key_ready, memory_order_acquire)) {
+        return 0;
+    }
+
+    int result = 0;
+    pthread_mutex_lock(&key_lock);
+    if (!atomic_load_explicit(&list->key_ready, memory_order_relaxed)) {
+        if (pthread_key_create(&list->key, release_ring) == 0) {
+            atomic_store_explicit(&list->key_ready, 1, memory_order_release);
+        } else {
+            result = -1;
+        }
+    }
+    pthread_mutex_unlock(&key_lock);
+    return result;
+}
+
+// Reuse the ring of a thread that has exited, or add a new one
+ThreadRing *thread_ring_claim(ThreadRingList *list) {
+    if (ensure_key(list) != 0) {
+        return NULL;
+    }
+
+    ThreadRing *ring = atomic_load_explicit(&list->rings, memory_order_acquire);
+    for (; ring; ring = ring->next) {
+        int expected = 0;
+        if (atomic_compare_exchange_strong_explicit(&ring->in_use, &expected, 1,
+                                                    memory_order_acq_rel, memory_order_relaxed)) {
+            break;
+        }
+    }
+
+    if (!ring) {
+        ring = calloc(1, list->ring_size);
+        if (!ring) {
+            return NULL;
+        }
+        atomic_store_explicit(&ring->in_use, 1, memory_order_relaxed);
+        ring->next = atomic_load_explicit(&list->rings, memory_order_relaxed);
+        while (!atomic_compare_exchange_weak_explicit(&list->rings, &ring->next, ring,
+                                                      memory_order_release, memory_order_relaxed)) {
+        }
+    }
+
+    pthread_setspecific(list->key, ring);
+    return ring;
+}
+
+ThreadRing *thread_ring_first(ThreadRingList *list) {
+    return atomic_load_explicit(&list->rings, memory_order_acquire);
+}
+
+// ===== Writer Thread =====
+
+static void deadline_after(struct timespec *deadline, int ms) {
+    clock_gettime(CLOCK_REALTIME, deadline);
+    deadline->tv_sec += ms / 1000;
+    deadline->tv_nsec += (long)(ms % 1000) * 1000000L;
+    if (deadline->tv_nsec >= 1000000000L) {
+        deadline->tv_sec++;
+        deadline->tv_nsec -= 1000000000L;
+    }
+}
+
+static void *ring_writer_thread(void *arg) {
+    RingWriter *writer = arg;
+
+    pthread_mutex_lock(&writer->lock);
+    while (!writer->stop) {
+        pthread_mutex_unlock(&writer->lock);
+        size_t drained = writer->drain(writer->ctx);
+        pthread_mutex_lock(&writer->lock);
+
+        if (writer->flush_requested && drained == 0) {
+            writer->flush_requested = 0;
+            pthread_cond_broadcast(&writer->cond);
+        }
+        if (drained == 0 && !writer->stop) {
+            struct timespec deadline;
+            deadline_after(&deadline, writer->idle_wait_ms);
+            pthread_cond_timedwait(&writer->cond, &writer->lock, &deadline);
+        }
+    }
+    pthread_mutex_unlock(&writer->lock);
+
+    // Whatever was queued before the stop
+    while (writer->drain(writer->ctx) > 0) {
+    }
+    if (writer->finish) {
+        writer->finish(writer->ctx);
+    }
+    return NULL;
+}
+
+int ring_writer_start(RingWriter *writer, void *ctx) {
+    writer->ctx = ctx;
+    writer->stop = 0;
+    writer->flush_requested = 0;
+    return pthread_create(&writer->thread, NULL, ring_writer_thread, writer) == 0 ? 0 : -1;
+}
+
+void ring_writer_flush(RingWriter *writer, int timeout_ms) {
+    struct timespec deadline;
+    deadline_after(&deadline, timeout_ms);
+
+    // The writer answers after a pass that found every ring empty
+    pthread_mutex_lock(&writer->lock);
+    writer->flush_requested = 1;
+    pthread_cond_broadcast(&writer->cond);
+    while (writer->flush_requested && !writer->stop) {
+        if (pthread_cond_timedwait(&writer->cond, &writer->lock, &deadline) == ETIMEDOUT) {
+            break;
+        }
+    }
+    pthread_mutex_unlock(&writer->lock);
+}
+
+void ring_writer_stop(RingWriter *writer) {
+    pthread_mutex_lock(&writer->lock);
+    writer->stop = 1;
+    pthread_cond_broadcast(&writer->cond);
+    pthread_mutex_unlock(&writer->lock);
+    pthread_join(writer->thread, NULL);
+}
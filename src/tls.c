@@ -0,0 +1,257 @@
+#define _GNU_SOURCE
+
+// ===== Standard Library Headers =====
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <poll.h>
+
+// ===== OpenSSL Headers =====
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+
+// ===== Project Headers =====
+#include "tls.h"
+#include "utils.h"
+
+// ===== Constants =====
+#define TLS_SEND_TIMEOUT_MS 30000       // Longest a whole write (or handshake flight) may block
+#define TLS_SESSION_CACHE_SIZE 20480
+#define TLS_SESSION_TIMEOUT 7200        // Seconds a session (or ticket) can be resumed
+
+struct TlsConnection {
+    SSL *ssl;
+    int fd;
+    int established;
+    int send_offloaded;
+};
+
+// ===== Global Variables =====
+static SSL_CTX *tls_ctx = NULL;
+static int ktls_requested = 0;
+static _Atomic uint64_t handshake_count = 0;
+static _Atomic uint64_t resumed_count = 0;
+static _Atomic uint64_t offloaded_count = 0;
+
+// ===== Helper Functions =====
+static void log_ssl_error(const char *what) {
+    char message[256];
+    unsigned long error = ERR_get_error();
+    ERR_error_string_n(error, message, sizeof(message));
+    log_error("%s: %s", what, error ? message : "unknown error");
+    ERR_clear_error();
+}
+
+// ALPN: HTTP/2 when the client offers it, otherwise HTTP/1.1
+static int select_alpn(SSL *ssl, const unsigned char **out, unsigned char *out_length,
+                       const unsigned char *in, unsigned int in_length, void *arg) {
+    (void)ssl;
+    (void)arg;
+    static const unsigned char protocols[] = "\x02h2\x08http/1.1";
+    unsigned char *selected;
+    if (SSL_select_next_proto(&selected, out_length, protocols, sizeof(protocols) - 1,
+                              in, in_length) != OPENSSL_NPN_NEGOTIATED) {
+        return SSL_TLSEXT_ERR_NOACK;
+    }
+    *out = selected;
+    return SSL_TLSEXT_ERR_OK;
+}
+
+// Wait for `events` until `deadline_ms` (get_current_time_ms() clock)
+static int wait_socket(int fd, short events, uint64_t deadline_ms) {
+    uint64_t now = get_current_time_ms();
+    if (now >= deadline_ms) return -1;
+    struct pollfd pfd = {fd, events, 0};
+    return poll(&pfd, 1, (int)(deadline_ms - now)) > 0 ? 0 : -1;
+}
+
+// ===== Public API =====
+int tls_init(const char *cert_file, const char *key_file, int ktls) {
+    if (!cert_file || !key_file) return -1;
+
+    SSL_CTX *ctx = SSL_CTX_new(TLS_server_method());
+    if (!ctx) {
+        log_ssl_error("Cannot create TLS context");
+        return -1;
+    }
+    SSL_CTX_set_min_proto_version(ctx, TLS1_2_VERSION);
+
+    if (SSL_CTX_use_certificate_chain_file(ctx, cert_file) != 1) {
+        log_ssl_error("Cannot load TLS certificate");
+        SSL_CTX_free(ctx);
+        return -1;
+    }
+    if (SSL_CTX_use_PrivateKey_file(ctx, key_file, SSL_FILETYPE_PEM) != 1 ||
+        SSL_CTX_check_private_key(ctx) != 1) {
+        log_ssl_error("Cannot load TLS private key");
+        SSL_CTX_free(ctx);
+        return -1;
+    }
+
+    // Resumption: tickets are on by default; the cache serves TLS 1.2 session ids
+    static const unsigned char session_context[] = "aionic";
+    SSL_CTX_set_session_id_context(ctx, session_context, sizeof(session_context) - 1);
+    SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_SERVER);
+    SSL_CTX_sess_set_cache_size(ctx, TLS_SESSION_CACHE_SIZE);
+    SSL_CTX_set_timeout(ctx, TLS_SESSION_TIMEOUT);
+
+    // Writes may be retried from a different position after a partial send
+    SSL_CTX_set_mode(ctx, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+    SSL_CTX_set_alpn_select_cb(ctx, select_alpn, NULL);
+
+#ifdef SSL_OP_ENABLE_KTLS
+    if (ktls) {
+        SSL_CTX_set_options(ctx, SSL_OP_ENABLE_KTLS);
+    }
+#else
+    if (ktls) {
+        log_warning("OpenSSL was built without kTLS; TLS records are encrypted in user space");
+    }
+#endif
+
+    tls_ctx = ctx;
+    ktls_requested = ktls;
+    log_info("TLS enabled with certificate %s%s", cert_file, ktls ? " (kTLS requested)" : "");
+    return 0;
+}
+
+void tls_cleanup(void) {
+    if (tls_ctx) {
+        SSL_CTX_free(tls_ctx);
+        tls_ctx = NULL;
+    }
+}
+
+int tls_is_enabled(void) {
+    return tls_ctx != NULL;
+}
+
+TlsConnection *tls_connection_create(int fd) {
+    if (!tls_ctx) return NULL;
+
+    TlsConnection *conn = calloc(1, sizeof(TlsConnection));
+    if (!conn) return NULL;
+    conn->ssl = SSL_new(tls_ctx);
+    if (!conn->ssl || SSL_set_fd(conn->ssl, fd) != 1) {
+        SSL_free(conn->ssl);
+        free(conn);
+        ERR_clear_error();
+        return NULL;
+    }
+    SSL_set_accept_state(conn->ssl);
+    conn->fd = fd;
+    return conn;
+}
+
+void tls_connection_free(TlsConnection *conn) {
+    if (!conn) return;
+    // The socket is already closed or about to be, so no close_notify is sent.
+    // Marking the shutdown done keeps the session in the cache for resumption.
+    if (conn->established) {
+        SSL_set_shutdown(conn->ssl, SSL_SENT_SHUTDOWN | SSL_RECEIVED_SHUTDOWN);
+    }
+    SSL_free(conn->ssl);
+    free(conn);
+}
+
+int tls_handshake(TlsConnection *conn) {
+    if (conn->established) return 1;
+
+    uint64_t deadline = get_current_time_ms() + TLS_SEND_TIMEOUT_MS;
+    for (;;) {
+        ERR_clear_error();
+        int result = SSL_do_handshake(conn->ssl);
+        if (result == 1) break;
+
+        int error = SSL_get_error(conn->ssl, result);
+        if (error == SSL_ERROR_WANT_READ) {
+            return 0;
+        }
+        if (error == SSL_ERROR_WANT_WRITE && wait_socket(conn->fd, POLLOUT, deadline) == 0) {
+            continue;
+        }
+        // Scanners and plain-HTTP clients end up here; not worth an error line each
+        char message[256];
+        ERR_error_string_n(ERR_peek_error(), message, sizeof(message));
+        log_debug("TLS handshake failed on fd %d: %s", conn->fd, message);
+        ERR_clear_error();
+        return -1;
+    }
+
+    conn->established = 1;
+    atomic_fetch_add_explicit(&handshake_count, 1, memory_order_relaxed);
+    if (SSL_session_reused(conn->ssl)) {
+        atomic_fetch_add_explicit(&resumed_count, 1, memory_order_relaxed);
+    }
+
+    // OpenSSL installs the keys in the kernel itself once the handshake is done
+    if (ktls_requested && BIO_get_ktls_send(SSL_get_wbio(conn->ssl))) {
+        conn->send_offloaded = 1;
+        atomic_fetch_add_explicit(&offloaded_count, 1, memory_order_relaxed);
+    }
+    return 1;
+}
+
+int tls_is_established(const TlsConnection *conn) {
+    return conn->established;
+}
+
+int tls_send_offloaded(const TlsConnection *conn) {
+    return conn->send_offloaded;
+}
+
+ssize_t tls_recv(TlsConnection *conn, void *buffer, size_t length) {
+    // With kTLS receive, SSL_read() reads records the kernel already decrypted
+    ERR_clear_error();
+    int result = SSL_read(conn->ssl, buffer, (int)(length > INT32_MAX ? INT32_MAX : length));
+    if (result > 0) return result;
+
+    switch (SSL_get_error(conn->ssl, result)) {
+        case SSL_ERROR_WANT_READ:
+        case SSL_ERROR_WANT_WRITE:
+            errno = EAGAIN;
+            return -1;
+        case SSL_ERROR_ZERO_RETURN:
+            return 0;
+        default:
+            ERR_clear_error();
+            errno = ECONNRESET;
+            return -1;
+    }
+}
+
+ssize_t tls_send(TlsConnection *conn, const void *data, size_t length) {
+    // One deadline for the whole write, so a slow reader cannot hold the
+    // worker for a timeout per partial record
+    uint64_t deadline = get_current_time_ms() + TLS_SEND_TIMEOUT_MS;
+    size_t offset = 0;
+    while (offset < length) {
+        size_t remaining = length - offset;
+        ERR_clear_error();
+        int result = SSL_write(conn->ssl, (const char *)data + offset,
+                               (int)(remaining > INT32_MAX ? INT32_MAX : remaining));
+        if (result > 0) {
+            offset += (size_t)result;
+            continue;
+        }
+
+        // A renegotiation or key update can need the peer's bytes first
+        int error = SSL_get_error(conn->ssl, result);
+        short events = error == SSL_ERROR_WANT_READ ? POLLIN : error == SSL_ERROR_WANT_WRITE ? POLLOUT : 0;
+        if (events && wait_socket(conn->fd, events, deadline) == 0) {
+            continue;
+        }
+        ERR_clear_error();
+        return -1;
+    }
+    return (ssize_t)length;
+}
+
+void tls_get_counts(uint64_t *handshakes, uint64_t *resumed, uint64_t *offloaded) {
+    if (handshakes) *handshakes = atomic_load_explicit(&handshake_count, memory_order_relaxed);
+    if (resumed) *resumed = atomic_load_explicit(&resumed_count, memory_order_relaxed);
+    if (offloaded) *offloaded = atomic_load_explicit(&offloaded_count, memory_order_relaxed);
+}
@@ -0,0 +1,271 @@
+#define _POSIX_C_SOURCE 200809L
+
+// ===== Standard Library Headers =====
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+// ===== Project Headers =====
+#include "trace.h"
+#include "utils.h"
+#include "ai/stats.h"
+
+typedef struct {
+    uint64_t start_ns;
+    uint64_t duration_ns;
+    uint64_t span_start_ns[TRACE_PHASE_COUNT];  // Offset from start_ns
+    uint64_t span_ns[TRACE_PHASE_COUNT];
+    uint32_t phases;                            // Bit per recorded phase
+    int status_code;
+    char method[8];
+    char path[64];
+} TraceRecord;
+
+// Odd sequence while the owner is writing the record
+typedef struct {
+    _Atomic uint64_t seq;
+    TraceRecord record;
+} TraceSlot;
+
+typedef struct {
+    _Atomic uint64_t head;      // Records written so far
+    TraceSlot slots[TRACE_RING_SIZE];
+} TraceRing;
+
+// A record read back from a ring
+typedef struct {
+    TraceRecord record;
+    int thread;
+} TraceEntry;
+
+// ===== Global Variables =====
+static _Atomic int trace_enabled = 0;
+static _Atomic(TraceRing *) trace_rings[TRACE_MAX_THREADS];
+static _Atomic int trace_ring_count = 0;
+
+static _Thread_local TraceRecord trace_current;
+static _Thread_local int trace_active = 0;
+static _Thread_local TraceRing *trace_ring = NULL;
+static _Thread_local int trace_ring_failed = 0;
+
+static const char *const phase_names[TRACE_PHASE_COUNT] = {
+    "recv", "parse", "hooks", "firewall", "route", "json", "upstream", "serialize", "send"
+};
+
+// ===== Recording =====
+
+void trace_set_enabled(int enabled) {
+    atomic_store_explicit(&trace_enabled, enabled ? 1 : 0, memory_order_relaxed);
+}
+
+int trace_is_enabled(void) {
+    return atomic_load_explicit(&trace_enabled, memory_order_relaxed);
+}
+
+const char *trace_phase_name(TracePhase phase) {
+    if (phase < 0 || phase >= TRACE_PHASE_COUNT) return "unknown";
+    return phase_names[phase];
+}
+
+uint64_t trace_request_begin(void) {
+    trace_active = 0;
+    if (!atomic_load_explicit(&trace_enabled, memory_order_relaxed)) {
+        return 0;
+    }
+
+    trace_current.start_ns = get_current_time_ns();
+    trace_current.phases = 0;
+    trace_active = 1;
+    return trace_current.start_ns;
+}
+
+uint64_t trace_now(void) {
+    return trace_active ? get_current_time_ns() : 0;
+}
+
+// A phase seen twice (e.g. two recv() calls) keeps its first start and adds up
+void trace_phase(TracePhase phase, uint64_t start) {
+    if (!trace_active || !start || phase < 0 || phase >= TRACE_PHASE_COUNT) {
+        return;
+    }
+
+    uint64_t now = get_current_time_ns();
+    uint64_t duration = now > start ? now - start : 0;
+    uint32_t bit = 1u << phase;
+    if (trace_current.phases & bit) {
+        trace_current.span_ns[phase] += duration;
+    } else {
+        trace_current.span_start_ns[phase] = start > trace_current.start_ns ? start - trace_current.start_ns : 0;
+        trace_current.span_ns[phase] = duration;
+        trace_current.phases |= bit;
+    }
+}
+
+void trace_request_discard(void) {
+    trace_active = 0;
+}
+
+// Claim a ring the first time this thread finishes a traced request
+static TraceRing *claim_ring(void) {
+    if (trace_ring || trace_ring_failed) {
+        return trace_ring;
+    }
+
+    int index = atomic_fetch_add(&trace_ring_count, 1);
+    if (index >= TRACE_MAX_THREADS) {
+        atomic_fetch_sub(&trace_ring_count, 1);
+        trace_ring_failed = 1;
+        log_message("TRACE", "Too many threads; requests on this thread are not traced");
+        return NULL;
+    }
+
+    TraceRing *ring = calloc(1, sizeof(TraceRing));
+    if (!ring) {
+        trace_ring_failed = 1;
+        return NULL;
+    }
+    atomic_store_explicit(&trace_rings[index], ring, memory_order_release);
+    trace_ring = ring;
+    return ring;
+}
+
+void trace_request_end(const char *method, const char *path, int status_code) {
+    if (!trace_active) {
+        return;
+    }
+    trace_active = 0;
+
+    TraceRecord *record = &trace_current;
+    record->duration_ns = get_current_time_ns() - record->start_ns;
+    record->status_code = status_code;
+    snprintf(record->method, sizeof(record->method), "%s", method ? method : "");
+    snprintf(record->path, sizeof(record->path), "%s", path ? path : "");
+
+    for (int p = 0; p < TRACE_PHASE_COUNT; p++) {
+        if (record->phases & (1u << p)) {
+            stats_record_latency(STATS_SCOPE_PHASE, phase_names[p], STATS_LATENCY, record->span_ns[p] / 1000);
+        }
+    }
+
+    TraceRing *ring = claim_ring();
+    if (!ring) {
+        return;
+    }
+
+    uint64_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    TraceSlot *slot = &ring->slots[head & (TRACE_RING_SIZE - 1)];
+    uint64_t seq = atomic_load_explicit(&slot->seq, memory_order_relaxed);
+
+    atomic_store_explicit(&slot->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    slot->record = *record;
+    atomic_store_explicit(&slot->seq, seq + 2, memory_order_release);
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+// ===== Chrome Trace Export =====
+
+// Copy up to `max` of the ring's newest records; a slot being rewritten is skipped
+static int read_ring(TraceRing *ring, int thread, TraceEntry *out, int max) {
+    uint64_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    uint64_t available = head < TRACE_RING_SIZE ? head : TRACE_RING_SIZE;
+    int count = 0;
+
+    for (uint64_t i = 0; i < available && count < max; i++) {
+        TraceSlot *slot = &ring->slots[(head - 1 - i) & (TRACE_RING_SIZE - 1)];
+        uint64_t before = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        if (before & 1) continue;
+
+        out[count].record = slot->record;
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&slot->seq, memory_order_relaxed) != before) continue;
+
+        out[count].thread = thread;
+        count++;
+    }
+    return count;
+}
+
+static int compare_entries(const void *a, const void *b) {
+    uint64_t start_a = ((const TraceEntry *)a)->record.start_ns;
+    uint64_t start_b = ((const TraceEntry *)b)->record.start_ns;
+    return start_a < start_b ? -1 : start_a > start_b;
+}
+
+// Microseconds with nanosecond digits; %.6g would round large timestamps
+static void write_micros(JsonWriter *w, uint64_t ns) {
+    char digits[32];
+    int n = snprintf(digits, sizeof(digits), "%llu.%03llu",
+                     (unsigned long long)(ns / 1000), (unsigned long long)(ns % 1000));
+    json_write_raw(w, digits, (size_t)n);
+}
+
+static void write_event(JsonWriter *w, int first, const char *name, const char *category,
+                        uint64_t ts_ns, uint64_t dur_ns, int thread) {
+    json_write_cstr(w, first ? "\n  {\"name\": " : ",\n  {\"name\": ");
+    json_write_string(w, name, strlen(name));
+    json_write_cstr(w, ", \"cat\": \"");
+    json_write_cstr(w, category);
+    json_write_cstr(w, "\", \"ph\": \"X\", \"pid\": 1, \"tid\": ");
+    json_write_int(w, thread);
+    json_write_cstr(w, ", \"ts\": ");
+    write_micros(w, ts_ns);
+    json_write_cstr(w, ", \"dur\": ");
+    write_micros(w, dur_ns);
+}
+
+int trace_write_chrome(JsonWriter *w, int max_requests) {
+    if (!w) {
+        return -1;
+    }
+
+    int rings = atomic_load_explicit(&trace_ring_count, memory_order_acquire);
+    if (rings > TRACE_MAX_THREADS) rings = TRACE_MAX_THREADS;
+    if (max_requests < 0) max_requests = 0;
+    if (max_requests > TRACE_RING_SIZE * TRACE_MAX_THREADS) max_requests = TRACE_RING_SIZE * TRACE_MAX_THREADS;
+
+    // Each ring contributes at most max_requests; the newest overall are kept
+    size_t capacity = (size_t)rings * (size_t)(max_requests < TRACE_RING_SIZE ? max_requests : TRACE_RING_SIZE);
+    TraceEntry *entries = malloc(sizeof(TraceEntry) * (capacity ? capacity : 1));
+    if (!entries) {
+        return -1;
+    }
+
+    int count = 0;
+    for (int i = 0; i < rings; i++) {
+        TraceRing *ring = atomic_load_explicit(&trace_rings[i], memory_order_acquire);
+        if (ring) {
+            count += read_ring(ring, i, entries + count, (int)(capacity - (size_t)count));
+        }
+    }
+    qsort(entries, (size_t)count, sizeof(TraceEntry), compare_entries);
+
+    int first_entry = count > max_requests ? count - max_requests : 0;
+    uint64_t origin = count > first_entry ? entries[first_entry].record.start_ns : 0;
+
+    json_write_cstr(w, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [");
+    for (int i = first_entry; i < count; i++) {
+        const TraceRecord *record = &entries[i].record;
+        uint64_t start = record->start_ns - origin;
+
+        char name[80];
+        snprintf(name, sizeof(name), "%s %s", record->method, record->path);
+        write_event(w, i == first_entry, name, "request", start, record->duration_ns, entries[i].thread);
+        json_write_cstr(w, ", \"args\": {\"status\": ");
+        json_write_int(w, record->status_code);
+        json_write_cstr(w, "}}");
+
+        for (int p = 0; p < TRACE_PHASE_COUNT; p++) {
+            if (!(record->phases & (1u << p))) continue;
+            write_event(w, 0, phase_names[p], "phase", start + record->span_start_ns[p],
+                        record->span_ns[p], entries[i].thread);
+            json_write_cstr(w, "}");
+        }
+    }
+    json_write_cstr(w, "\n]}");
+
+    free(entries);
+    return w->failed ? -1 : count - first_entry;
+}
@@ -0,0 +1,273 @@
+#define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE
+
+// ===== Standard Library Headers =====
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+// ===== Project Headers =====
+#include "uring.h"
+
+#define SQPOLL_IDLE_MS 1000     // Kernel poller sleeps after this long without work
+#define KERNEL_SIGSET_SIZE 8
+
+// Head and tail indexes are shared with the kernel
+#define load_acquire(p) atomic_load_explicit((_Atomic __typeof__(*(p)) *)(p), memory_order_acquire)
+#define store_release(p, v) atomic_store_explicit((_Atomic __typeof__(*(p)) *)(p), (v), memory_order_release)
+
+static int sys_setup(unsigned entries, struct io_uring_params *params) {
+    return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int sys_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags,
+                     void *arg, size_t arg_size) {
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, arg_size);
+}
+
+static int sys_register(int fd, unsigned opcode, void *arg, unsigned count) {
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, count);
+}
+
+// ===== Ring Setup =====
+
+int uring_init(Uring *ring, unsigned entries, int sqpoll) {
+    memset(ring, 0, sizeof(Uring));
+    ring->fd = -1;
+
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    if (sqpoll) {
+        params.flags = IORING_SETUP_SQPOLL;
+        params.sq_thread_idle = SQPOLL_IDLE_MS;
+    } else {
+        // Completions are only run when the owner enters the kernel
+        params.flags = IORING_SETUP_COOP_TASKRUN;
+    }
+
+    int fd = sys_setup(entries, &params);
+    if (fd < 0 && errno == EINVAL && !sqpoll) {
+        // Kernels before 5.19
+        params.flags = 0;
+        fd = sys_setup(entries, &params);
+    }
+    if (fd < 0) {
+        return -1;
+    }
+
+    // Timed waits need EXT_ARG (5.11); a single mapping holds both rings
+    unsigned required = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG;
+    if ((params.features & required) != required) {
+        close(fd);
+        errno = ENOSYS;
+        return -1;
+    }
+
+    ring->fd = fd;
+    ring->setup_flags = params.flags;
+    ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (ring->cq_ring_size > ring->sq_ring_size) {
+        ring->sq_ring_size = ring->cq_ring_size;
+    }
+    ring->cq_ring_size = ring->sq_ring_size;
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+
+    ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ring == MAP_FAILED) {
+        ring->sq_ring = NULL;
+        uring_exit(ring);
+        return -1;
+    }
+    ring->cq_ring = ring->sq_ring;
+
+    ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) {
+        ring->sqes = NULL;
+        uring_exit(ring);
+        return -1;
+    }
+
+    char *sq = ring->sq_ring;
+    ring->sq_head = (unsigned *)(sq + params.sq_off.head);
+    ring->sq_tail = (unsigned *)(sq + params.sq_off.tail);
+    ring->sq_flags = (unsigned *)(sq + params.sq_off.flags);
+    ring->sq_array = (unsigned *)(sq + params.sq_off.array);
+    ring->sq_mask = *(unsigned *)(sq + params.sq_off.ring_mask);
+    ring->sq_entries = params.sq_entries;
+    ring->sqe_tail = *ring->sq_tail;
+
+    char *cq = ring->cq_ring;
+    ring->cq_head = (unsigned *)(cq + params.cq_off.head);
+    ring->cq_tail = (unsigned *)(cq + params.cq_off.tail);
+    ring->cq_mask = *(unsigned *)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+
+    // Slot i always carries entry i, so the index array is filled once
+    for (unsigned i = 0; i < ring->sq_entries; i++) {
+        ring->sq_array[i] = i;
+    }
+    return 0;
+}
+
+void uring_exit(Uring *ring) {
+    if (ring->sqes) {
+        munmap(ring->sqes, ring->sqes_size);
+    }
+    if (ring->sq_ring) {
+        munmap(ring->sq_ring, ring->sq_ring_size);
+    }
+    if (ring->fd >= 0) {
+        close(ring->fd);
+    }
+    memset(ring, 0, sizeof(Uring));
+    ring->fd = -1;
+}
+
+// ===== Submission and Completion =====
+
+struct io_uring_sqe *uring_get_sqe(Uring *ring) {
+    unsigned head = load_acquire(ring->sq_head);
+    if (ring->sqe_tail - head >= ring->sq_entries) {
+        return NULL;
+    }
+
+    struct io_uring_sqe *sqe = &ring->sqes[ring->sqe_tail & ring->sq_mask];
+    ring->sqe_tail++;
+    memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+int uring_submit_wait(Uring *ring, int timeout_ms) {
+    unsigned to_submit = ring->sqe_tail - *ring->sq_tail;
+    store_release(ring->sq_tail, ring->sqe_tail);
+
+    // Completions already queued are handled before sleeping
+    unsigned wait_nr = *ring->cq_head == load_acquire(ring->cq_tail) ? 1 : 0;
+    unsigned flags = IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG;
+
+    if (ring->setup_flags & IORING_SETUP_SQPOLL) {
+        // The tail store must be visible before the poller's flag is read
+        atomic_thread_fence(memory_order_seq_cst);
+        if (load_acquire(ring->sq_flags) & IORING_SQ_NEED_WAKEUP) {
+            flags |= IORING_ENTER_SQ_WAKEUP;
+        } else if (wait_nr == 0) {
+            return 0;
+        }
+        to_submit = 0;
+    } else if (to_submit == 0 && wait_nr == 0) {
+        return 0;
+    }
+
+    struct __kernel_timespec timeout = {
+        .tv_sec = timeout_ms / 1000,
+        .tv_nsec = (long long)(timeout_ms % 1000) * 1000000LL
+    };
+    struct io_uring_getevents_arg arg;
+    memset(&arg, 0, sizeof(arg));
+    arg.sigmask_sz = KERNEL_SIGSET_SIZE;
+    arg.ts = (uint64_t)(uintptr_t)&timeout;
+
+    if (sys_enter(ring->fd, to_submit, wait_nr, flags, &arg, sizeof(arg)) < 0 &&
+        errno != ETIME && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+        return -1;
+    }
+    return 0;
+}
+
+struct io_uring_cqe *uring_peek_cqe(Uring *ring) {
+    unsigned head = *ring->cq_head;
+    if (head == load_acquire(ring->cq_tail)) {
+        return NULL;
+    }
+    return &ring->cqes[head & ring->cq_mask];
+}
+
+void uring_cqe_seen(Uring *ring) {
+    store_release(ring->cq_head, *ring->cq_head + 1);
+}
+
+// ===== Provided Buffers =====
+
+int uring_buffers_init(Uring *ring, UringBuffers *buffers, uint16_t group, unsigned count, size_t size) {
+    memset(buffers, 0, sizeof(UringBuffers));
+    if (count == 0 || (count & (count - 1)) != 0 || count > 32768) {
+        return -1;
+    }
+
+    size_t ring_size = count * sizeof(struct io_uring_buf);
+    void *ring_memory = mmap(NULL, ring_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ring_memory == MAP_FAILED) {
+        return -1;
+    }
+    char *memory = malloc(count * (size + 1));
+    if (!memory) {
+        munmap(ring_memory, ring_size);
+        return -1;
+    }
+
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uint64_t)(uintptr_t)ring_memory;
+    reg.ring_entries = count;
+    reg.bgid = group;
+    if (sys_register(ring->fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        free(memory);
+        munmap(ring_memory, ring_size);
+        return -1;
+    }
+
+    buffers->ring = ring_memory;
+    buffers->memory = memory;
+    buffers->buffer_size = size;
+    buffers->count = count;
+    buffers->group = group;
+    buffers->tail = 0;
+
+    for (unsigned id = 0; id < count; id++) {
+        struct io_uring_buf *buf = &buffers->ring->bufs[id];
+        buf->addr = (uint64_t)(uintptr_t)(memory + id * (size + 1));
+        buf->len = (uint32_t)size;
+        buf->bid = (uint16_t)id;
+    }
+    buffers->tail = (uint16_t)count;
+    store_release(&buffers->ring->tail, buffers->tail);
+    return 0;
+}
+
+void uring_buffers_free(Uring *ring, UringBuffers *buffers) {
+    if (!buffers->ring) {
+        return;
+    }
+
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.bgid = buffers->group;
+    if (ring->fd >= 0) {
+        sys_register(ring->fd, IORING_UNREGISTER_PBUF_RING, &reg, 1);
+    }
+    munmap(buffers->ring, buffers->count * sizeof(struct io_uring_buf));
+    free(buffers->memory);
+    memset(buffers, 0, sizeof(UringBuffers));
+}
+
+char *uring_buffer(UringBuffers *buffers, uint16_t id) {
+    return buffers->memory + (size_t)id * (buffers->buffer_size + 1);
+}
+
+void uring_buffer_recycle(UringBuffers *buffers, uint16_t id) {
+    struct io_uring_buf *buf = &buffers->ring->bufs[buffers->tail & (buffers->count - 1)];
+    buf->addr = (uint64_t)(uintptr_t)uring_buffer(buffers, id);
+    buf->len = (uint32_t)buffers->buffer_size;
+    buf->bid = id;
+    buffers->tail++;
+    store_release(&buffers->ring->tail, buffers->tail);
+}
@@ -26,11 +26,6 @@
 #define DEFAULT_BUFFER_SIZE 8192
 #define CRC32_POLYNOMIAL 0xEDB88320
 
-// ===== Thread-Safe Logging =====
-static pthread_mutex_t log_mutex = PTHREAD_MUTEX_INITIALIZER;
-static FILE *log_file = NULL;
-static atomic_int log_level = ATOMIC_VAR_INIT(LOG_LEVEL_INFO);
-
 // ===== Error Handling Macros =====
 #define SAFE_FREE(ptr) do { \
     if (ptr) { \
@@ -180,65 +175,6 @@ int string_to_int(const char *str, int *result) {
     return string_to_int_ex(str, result, 10);
 }
 
-// ===== Enhanced Logging System =====
-void init_logging(const char *log_filename, log_level_t level) {
-    pthread_mutex_lock(&log_mutex);
-    
-    if (log_file && log_file != stdout && log_file != stderr) {
-        fclose(log_file);
-    }
-    
-    if (log_filename) {
-        log_file = fopen(log_filename, "a");
-        if (!log_file) {
-            log_file = stderr;
-        }
-    } else {
-        log_file = stdout;
-    }
-    
-    atomic_store(&log_level, level);
-    pthread_mutex_unlock(&log_mutex);
-}
-
-void log_message_ex(log_level_t level, const char *format, ...) {
-    if (level < (log_level_t)atomic_load(&log_level)) return;
-    
-    const char *level_str[] = {"DEBUG", "INFO", "WARNING", "ERROR", "CRITICAL"};
-    
-    pthread_mutex_lock(&log_mutex);
-    
-    time_t now = time(NULL);
-    char time_str[64];
-    strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M:%S", localtime(&now));
-    
-    FILE *output = log_file ? log_file : stdout;
-    
-    fprintf(output, "[%s] [%-8s] ", time_str, level_str[level]);
-    
-    va_list args;
-    va_start(args, format);
-    vfprintf(output, format, args);
-    va_end(args);
-    
-    fprintf(output, "\n");
-    fflush(output);
-    
-    pthread_mutex_unlock(&log_mutex);
-}
-
-// Wrapper for compatibility
-void log_message(const char *level, const char *message) {
-    log_level_t log_lvl = LOG_LEVEL_INFO;
-    
-    if (strcmp(level, "DEBUG") == 0) log_lvl = LOG_LEVEL_DEBUG;
-    else if (strcmp(level, "WARNING") == 0) log_lvl = LOG_LEVEL_WARNING;
-    else if (strcmp(level, "ERROR") == 0) log_lvl = LOG_LEVEL_ERROR;
-    else if (strcmp(level, "CRITICAL") == 0) log_lvl = LOG_LEVEL_CRITICAL;
-    
-    log_message_ex(log_lvl, "%s", message);
-}
-
 // ===== Memory Pool for String Operations =====
 string_pool_t *create_string_pool(size_t initial_size) {
     string_pool_t *pool = malloc(sizeof(string_pool_t));
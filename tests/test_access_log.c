@@ -0,0 +1,127 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <dirent.h>
+#include "../include/access_log.h"
+
+#define LOG_DIR "/tmp"
+#define LOG_NAME "aionic_test_access"
+#define THREADS 4
+#define REQUESTS 100
+
+static void *record_requests(void *arg) {
+    (void)arg;
+    for (int i = 0; i < REQUESTS; i++) {
+        access_log_request_begin();
+        access_log_request_end("10.0.0.1", "GET", "/health", 200, 40, 60);
+
+        access_log_request_begin();
+        access_log_note_upstream("test-model", access_log_now(), i % 2);
+        access_log_request_end("10.0.0.2", "POST", "/v1/chat", 200, 500 + i, 1000);
+    }
+    return NULL;
+}
+
+// Reads every segment of the test run, then removes it
+static int read_segments(int *segments, int *health, int *chat, int *cache_hits, int *bad) {
+    DIR *dir = opendir(LOG_DIR);
+    if (!dir) {
+        return -1;
+    }
+
+    struct dirent *entry;
+    while ((entry = readdir(dir))) {
+        if (strncmp(entry->d_name, LOG_NAME "-", strlen(LOG_NAME) + 1) != 0) continue;
+
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s", LOG_DIR, entry->d_name);
+        FILE *file = fopen(path, "rb");
+        if (!file) continue;
+
+        AccessLogHeader header;
+        AccessRecord record;
+        if (fread(&header, sizeof(header), 1, file) != 1 || memcmp(header.magic, ACCESS_LOG_MAGIC, 8) != 0 ||
+            header.record_size != sizeof(AccessRecord)) {
+            (*bad)++;
+        }
+        for (uint64_t i = 0; i < header.record_count && fread(&record, sizeof(record), 1, file) == 1; i++) {
+            if (strcmp(record.route, "/health") == 0) {
+                (*health)++;
+                if (record.sample_ppm != 250000 || record.upstream_us != 0 || record.model[0]) (*bad)++;
+            } else if (strcmp(record.route, "/v1/chat") == 0) {
+                (*chat)++;
+                if (record.flags & ACCESS_FLAG_CACHE_HIT) (*cache_hits)++;
+                if (record.sample_ppm != 1000000 || strcmp(record.model, "test-model") != 0 ||
+                    strcmp(record.ip, "10.0.0.2") != 0 || record.bytes_out != 1000) (*bad)++;
+            } else {
+                (*bad)++;
+            }
+        }
+        fclose(file);
+        remove(path);
+        (*segments)++;
+    }
+    closedir(dir);
+    return 0;
+}
+
+int test_sampled_segments() {
+    printf("Testing access log sampling and rotation...\n");
+
+    if (access_log_set_sample_rate("/health", 0.25) != 0 || access_log_set_sample_rate("/v1/*", 1.0) != 0 ||
+        access_log_set_sample_rate("/bad", 2.0) != -1) {
+        printf("FAILED: Sample rules\n");
+        return -1;
+    }
+
+    // One page per segment holds 31 records, so the run spans many segments
+    if (access_log_init(LOG_DIR "/" LOG_NAME, 4096) != 0) {
+        printf("FAILED: Access log did not start\n");
+        return -1;
+    }
+
+    pthread_t threads[THREADS];
+    for (int i = 0; i < THREADS; i++) {
+        pthread_create(&threads[i], NULL, record_requests, NULL);
+    }
+    for (int i = 0; i < THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    access_log_cleanup();
+
+    uint64_t written, dropped;
+    access_log_get_counts(&written, &dropped);
+
+    int segments = 0, health = 0, chat = 0, cache_hits = 0, bad = 0;
+    if (read_segments(&segments, &health, &chat, &cache_hits, &bad) != 0) {
+        printf("FAILED: Cannot list segments\n");
+        return -1;
+    }
+
+    // Every fourth /health request on each thread is kept
+    int expected = THREADS * (REQUESTS / 4 + REQUESTS);
+    if (bad != 0 || health != THREADS * REQUESTS / 4 || chat != THREADS * REQUESTS ||
+        cache_hits != THREADS * REQUESTS / 2 || written != (uint64_t)expected || dropped != 0 ||
+        segments < expected / 31) {
+        printf("FAILED: Segment contents (%d segments, %d health, %d chat, %d bad)\n",
+               segments, health, chat, bad);
+        return -1;
+    }
+
+    printf("PASSED: Access log sampling and rotation\n");
+    return 0;
+}
+
+int main() {
+    printf("Running access log tests...\n");
+
+    if (test_sampled_segments() != 0) {
+        printf("Access log tests FAILED\n");
+        return -1;
+    }
+
+    printf("All access log tests PASSED\n");
+    return 0;
+}
@@ -0,0 +1,79 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <sched.h>
+#include "../include/affinity.h"
+
+int test_placement() {
+    printf("Testing worker placement...\n");
+
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    sched_getaffinity(0, sizeof(allowed), &allowed);
+    int cpu_count = CPU_COUNT(&allowed);
+    int worker_count = cpu_count + 2;
+
+    if (affinity_init(worker_count) != 0) {
+        printf("FAILED: affinity_init\n");
+        return -1;
+    }
+
+    for (int i = 0; i < worker_count; i++) {
+        int cpu = affinity_worker_cpu(i);
+        if (cpu < 0 || !CPU_ISSET(cpu, &allowed)) {
+            printf("FAILED: Worker %d planned on CPU %d outside the CPU set\n", i, cpu);
+            return -1;
+        }
+        // The first round of workers gets distinct CPUs, later workers share
+        if (i < cpu_count && affinity_steer(cpu) != i) {
+            printf("FAILED: CPU %d steers to worker %d, expected %d\n", cpu, affinity_steer(cpu), i);
+            return -1;
+        }
+    }
+    if (affinity_worker_cpu(worker_count) != -1 || affinity_steer(-1) != -1 || affinity_steer(1 << 20) != -1) {
+        printf("FAILED: Out-of-range lookups\n");
+        return -1;
+    }
+
+    printf("PASSED: Worker placement\n");
+    return 0;
+}
+
+int test_pinning() {
+    printf("Testing worker pinning...\n");
+
+    int cpu = affinity_worker_cpu(0);
+    if (affinity_pin_worker(0) != 0 || sched_getcpu() != cpu) {
+        printf("FAILED: Not running on CPU %d after pinning\n", cpu);
+        return -1;
+    }
+
+    cpu_set_t pinned;
+    CPU_ZERO(&pinned);
+    sched_getaffinity(0, sizeof(pinned), &pinned);
+    if (CPU_COUNT(&pinned) != 1 || !CPU_ISSET(cpu, &pinned)) {
+        printf("FAILED: Affinity mask not narrowed to CPU %d\n", cpu);
+        return -1;
+    }
+
+    affinity_cleanup();
+    if (affinity_worker_cpu(0) != -1 || affinity_pin_worker(0) != -1) {
+        printf("FAILED: Plan kept after cleanup\n");
+        return -1;
+    }
+
+    printf("PASSED: Worker pinning\n");
+    return 0;
+}
+
+int main() {
+    printf("Running affinity tests...\n");
+
+    if (test_placement() != 0 || test_pinning() != 0) {
+        printf("Affinity tests FAILED\n");
+        return -1;
+    }
+
+    printf("All affinity tests PASSED\n");
+    return 0;
+}
@@ -0,0 +1,240 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <time.h>
+
+// The batcher is tested against a stub upstream: its call to the prompt
+// router is redirected to stub_embed() below
+#define prompt_router_embed stub_embed
+#include "../src/ai/embeddings.c"
+#undef prompt_router_embed
+
+#define MAX_CALLS 16
+
+// What the stub upstream saw, one entry per call
+static pthread_mutex_t stub_lock = PTHREAD_MUTEX_INITIALIZER;
+static int stub_calls = 0;
+static int stub_call_inputs[MAX_CALLS];
+
+// Answers with each input echoed as its "vector"; an input "fail" fails the
+// call and an input "drop" is left out of the answer
+int stub_embed(const char *model_name, const char *const *inputs, int count,
+               char **body, const char **served_model) {
+    pthread_mutex_lock(&stub_lock);
+    if (stub_calls < MAX_CALLS) stub_call_inputs[stub_calls] = count;
+    stub_calls++;
+    pthread_mutex_unlock(&stub_lock);
+
+    size_t size = 64;
+    for (int i = 0; i < count; i++) {
+        if (strcmp(inputs[i], "fail") == 0) return PROMPT_ROUTE_ERROR;
+        size += strlen(inputs[i]) + 48;
+    }
+    char *json = malloc(size);
+    size_t length = (size_t)snprintf(json, size, "{\"data\": [");
+    for (int i = 0; i < count; i++) {
+        if (strcmp(inputs[i], "drop") == 0) continue;
+        length += (size_t)snprintf(json + length, size - length, "%s{\"index\": %d, \"embedding\": [\"%s\"]}",
+                                   length > 10 ? ", " : "", i, inputs[i]);
+    }
+    snprintf(json + length, size - length, "]}");
+    *body = json;
+    *served_model = model_name;
+    return 0;
+}
+
+static void reset_stub(void) {
+    pthread_mutex_lock(&stub_lock);
+    stub_calls = 0;
+    memset(stub_call_inputs, 0, sizeof(stub_call_inputs));
+    pthread_mutex_unlock(&stub_lock);
+}
+
+static double elapsed_ms(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1000.0 + (now.tv_nsec - start->tv_nsec) / 1e6;
+}
+
+// One concurrent request and what it got back
+typedef struct {
+    const char *inputs[4];
+    int count;
+    int status;
+    int vectors_ok;
+} Caller;
+
+static void *caller_thread(void *arg) {
+    Caller *caller = arg;
+    EmbeddingResult result;
+    caller->status = embeddings_create("embed", caller->inputs, caller->count, &result);
+    caller->vectors_ok = 0;
+    if (caller->status == 0 && result.count == caller->count && strcmp(result.model, "embed") == 0) {
+        caller->vectors_ok = 1;
+        for (int i = 0; i < caller->count; i++) {
+            char expected[64];
+            snprintf(expected, sizeof(expected), "[\"%s\"]", caller->inputs[i]);
+            if (!result.vectors[i] || strcmp(result.vectors[i], expected) != 0) caller->vectors_ok = 0;
+        }
+        embeddings_result_free(&result);
+    }
+    return NULL;
+}
+
+static void run_callers(Caller *callers, int count) {
+    pthread_t threads[8];
+    for (int i = 0; i < count; i++) {
+        pthread_create(&threads[i], NULL, caller_thread, &callers[i]);
+    }
+    for (int i = 0; i < count; i++) {
+        pthread_join(threads[i], NULL);
+    }
+}
+
+int test_batch_by_size() {
+    printf("Testing batches closed by size...\n");
+
+    // The window is long; the batch must go out as soon as it is full
+    if (embeddings_init("embed", 5000.0, 4) != 0) {
+        printf("FAILED: Setup\n");
+        return -1;
+    }
+    reset_stub();
+
+    Caller callers[2] = {
+        {{"a0", "a1"}, 2, -1, 0},
+        {{"b0", "b1"}, 2, -1, 0}
+    };
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    run_callers(callers, 2);
+    double took = elapsed_ms(&start);
+    embeddings_cleanup();
+
+    if (took > 2500.0 || stub_calls != 1 || stub_call_inputs[0] != 4) {
+        printf("FAILED: %d calls, first with %d inputs, after %.0fms\n", stub_calls, stub_call_inputs[0], took);
+        return -1;
+    }
+    for (int i = 0; i < 2; i++) {
+        if (callers[i].status != 0 || !callers[i].vectors_ok) {
+            printf("FAILED: Caller %d did not get its own vectors\n", i);
+            return -1;
+        }
+    }
+
+    printf("PASSED: Batches closed by size\n");
+    return 0;
+}
+
+int test_batch_by_window() {
+    printf("Testing batches closed by the window...\n");
+
+    if (embeddings_init("embed", 300.0, 64) != 0) {
+        printf("FAILED: Setup\n");
+        return -1;
+    }
+    reset_stub();
+
+    // Three requests of different sizes inside one window share one call
+    Caller callers[3] = {
+        {{"x"}, 1, -1, 0},
+        {{"y0", "y1", "y2"}, 3, -1, 0},
+        {{"z0", "z1"}, 2, -1, 0}
+    };
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    run_callers(callers, 3);
+    double took = elapsed_ms(&start);
+
+    if (took < 250.0 || stub_calls != 1 || stub_call_inputs[0] != 6) {
+        printf("FAILED: %d calls, first with %d inputs, after %.0fms\n", stub_calls, stub_call_inputs[0], took);
+        embeddings_cleanup();
+        return -1;
+    }
+    for (int i = 0; i < 3; i++) {
+        if (callers[i].status != 0 || !callers[i].vectors_ok) {
+            printf("FAILED: Caller %d did not get its own vectors\n", i);
+            embeddings_cleanup();
+            return -1;
+        }
+    }
+
+    EmbeddingStats stats;
+    embeddings_get_stats(&stats);
+    embeddings_cleanup();
+    if (stats.requests != 3 || stats.inputs != 6 || stats.batches != 1 || stats.failed_batches != 0) {
+        printf("FAILED: Stats\n");
+        return -1;
+    }
+
+    printf("PASSED: Batches closed by the window\n");
+    return 0;
+}
+
+int test_batch_failures() {
+    printf("Testing failed batches...\n");
+
+    if (embeddings_init("embed", 300.0, 64) != 0) {
+        printf("FAILED: Setup\n");
+        return -1;
+    }
+    reset_stub();
+
+    // One request's input fails the upstream call: every request in that batch fails
+    Caller failing[3] = {
+        {{"p"}, 1, -1, 0},
+        {{"fail"}, 1, -1, 0},
+        {{"q0", "q1"}, 2, -1, 0}
+    };
+    run_callers(failing, 3);
+    for (int i = 0; i < 3; i++) {
+        if (stub_calls != 1 || failing[i].status != PROMPT_ROUTE_ERROR) {
+            printf("FAILED: Caller %d of a failed batch got status %d\n", i, failing[i].status);
+            embeddings_cleanup();
+            return -1;
+        }
+    }
+
+    // An answer missing one vector fails the batch rather than leaving a hole
+    Caller partial[2] = {
+        {{"r"}, 1, -1, 0},
+        {{"s", "drop"}, 2, -1, 0}
+    };
+    run_callers(partial, 2);
+    for (int i = 0; i < 2; i++) {
+        if (stub_calls != 2 || partial[i].status != PROMPT_ROUTE_ERROR) {
+            printf("FAILED: Caller %d of an incomplete answer got status %d\n", i, partial[i].status);
+            embeddings_cleanup();
+            return -1;
+        }
+    }
+
+    // The next batch is unaffected
+    Caller next[1] = {{{"t"}, 1, -1, 0}};
+    run_callers(next, 1);
+
+    EmbeddingStats stats;
+    embeddings_get_stats(&stats);
+    embeddings_cleanup();
+    if (next[0].status != 0 || !next[0].vectors_ok || stats.batches != 3 || stats.failed_batches != 2) {
+        printf("FAILED: Batch after the failures\n");
+        return -1;
+    }
+
+    printf("PASSED: Failed batches\n");
+    return 0;
+}
+
+int main() {
+    printf("Running embedding batcher tests...\n");
+
+    if (test_batch_by_size() != 0 || test_batch_by_window() != 0 || test_batch_failures() != 0) {
+        printf("Embedding batcher tests FAILED\n");
+        return -1;
+    }
+
+    printf("All embedding batcher tests PASSED\n");
+    return 0;
+}
@@ -0,0 +1,257 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "../include/http2.h"
+
+// A frame header followed by its payload
+static size_t frame(uint8_t *out, uint8_t type, uint8_t flags, uint32_t stream_id,
+                    const uint8_t *payload, size_t length) {
+    out[0] = (uint8_t)(length >> 16);
+    out[1] = (uint8_t)(length >> 8);
+    out[2] = (uint8_t)length;
+    out[3] = type;
+    out[4] = flags;
+    out[5] = (uint8_t)(stream_id >> 24);
+    out[6] = (uint8_t)(stream_id >> 16);
+    out[7] = (uint8_t)(stream_id >> 8);
+    out[8] = (uint8_t)stream_id;
+    memcpy(out + 9, payload, length);
+    return 9 + length;
+}
+
+static const char *header(const HTTPRequest *request, const char *line) {
+    for (int i = 0; i < request->header_count; i++) {
+        if (strcmp(request->headers[i], line) == 0) return request->headers[i];
+    }
+    return NULL;
+}
+
+// Finds the first frame of `type` in the session's output
+static const uint8_t *find_frame(const H2Session *session, uint8_t type, uint32_t stream_id, size_t *length) {
+    size_t output_length;
+    const uint8_t *p = (const uint8_t *)h2_session_output(session, &output_length);
+    const uint8_t *end = p + output_length;
+    while (p + 9 <= end) {
+        size_t frame_length = (size_t)p[0] << 16 | (size_t)p[1] << 8 | p[2];
+        uint32_t id = (uint32_t)p[5] << 24 | (uint32_t)p[6] << 16 | (uint32_t)p[7] << 8 | p[8];
+        if (p[3] == type && id == stream_id) {
+            *length = frame_length;
+            return p;
+        }
+        p += 9 + frame_length;
+    }
+    return NULL;
+}
+
+int test_hpack_requests() {
+    printf("Testing HPACK request decoding (RFC 7541 C.4)...\n");
+
+    // Three requests with Huffman strings sharing one dynamic table
+    static const uint8_t blocks[3][32] = {
+        {0x82, 0x86, 0x84, 0x41, 0x8c, 0xf1, 0xe3, 0xc2, 0xe5, 0xf2, 0x3a, 0x6b, 0xa0, 0xab, 0x90, 0xf4, 0xff},
+        {0x82, 0x86, 0x84, 0xbe, 0x58, 0x86, 0xa8, 0xeb, 0x10, 0x64, 0x9c, 0xbf},
+        {0x82, 0x87, 0x85, 0xbf, 0x40, 0x88, 0x25, 0xa8, 0x49, 0xe9, 0x5b, 0xa9, 0x7d, 0x7f, 0x89, 0x25,
+         0xa8, 0x49, 0xe9, 0x5b, 0xb8, 0xe8, 0xb4, 0xbf}
+    };
+    static const size_t lengths[3] = {17, 12, 24};
+
+    H2Session *session = h2_session_create();
+    Arena arena;
+    if (!session || arena_init(&arena, ARENA_DEFAULT_BLOCK_SIZE) != 0 ||
+        h2_session_receive(session, H2_PREFACE, H2_PREFACE_LENGTH) != 0) {
+        printf("FAILED: Setup\n");
+        return -1;
+    }
+
+    uint8_t data[128];
+    HTTPRequest request;
+    for (int i = 0; i < 3; i++) {
+        uint32_t stream_id = (uint32_t)(2 * i + 1);
+        size_t length = frame(data, 0x1, 0x5, stream_id, blocks[i], lengths[i]);
+        // Split mid-frame to exercise buffering
+        if (h2_session_receive(session, (const char *)data, 5) != 0 ||
+            h2_session_receive(session, (const char *)data + 5, length - 5) != 0 ||
+            h2_session_next_request(session, &request, &arena) != stream_id) {
+            printf("FAILED: Request %d was not decoded\n", i + 1);
+            return -1;
+        }
+        if (request.method != HTTP_GET || strcmp(request.path, i == 2 ? "/index.html" : "/") != 0 ||
+            !header(&request, "Host: www.example.com") ||
+            (i == 1 && !header(&request, "Cache-Control: no-cache")) ||
+            (i == 2 && !header(&request, "Custom-Key: custom-value"))) {
+            printf("FAILED: Request %d decoded wrongly (%s)\n", i + 1, request.path);
+            return -1;
+        }
+        arena_reset(&arena);
+    }
+
+    // A reference past the dynamic table is a compression error
+    static const uint8_t bad[] = {0x82, 0x86, 0xc5};
+    size_t length = frame(data, 0x1, 0x5, 7, bad, sizeof(bad));
+    if (h2_session_receive(session, (const char *)data, length) == 0 || !h2_session_is_closing(session)) {
+        printf("FAILED: Bad index was accepted\n");
+        return -1;
+    }
+
+    h2_session_free(session);
+    arena_destroy(&arena);
+    printf("PASSED: HPACK request decoding\n");
+    return 0;
+}
+
+int test_response_framing() {
+    printf("Testing response framing and flow control...\n");
+
+    H2Session *session = h2_session_create();
+    Arena arena;
+    arena_init(&arena, ARENA_DEFAULT_BLOCK_SIZE);
+    h2_session_receive(session, H2_PREFACE, H2_PREFACE_LENGTH);
+    h2_session_output_sent(session);
+
+    // POST /echo?x=1 with a 4-byte body; the client's stream window is 10 bytes
+    static const uint8_t settings[] = {0x00, 0x04, 0x00, 0x00, 0x00, 0x0a};
+    static const uint8_t block[] = {0x83, 0x86, 0x04, 0x09, '/', 'e', 'c', 'h', 'o', '?', 'x', '=', '1',
+                                    0x0f, 0x10, 0x04, 't', 'e', 'x', 't'};
+    uint8_t data[256];
+    size_t length = frame(data, 0x4, 0, 0, settings, sizeof(settings));
+    length += frame(data + length, 0x1, 0x4, 1, block, sizeof(block));
+    length += frame(data + length, 0x0, 0x1, 1, (const uint8_t *)"ping", 4);
+
+    HTTPRequest request;
+    if (h2_session_receive(session, (const char *)data, length) != 0 ||
+        h2_session_next_request(session, &request, &arena) != 1 || request.method != HTTP_POST ||
+        strcmp(request.path, "/echo") != 0 || strcmp(request.query_string, "x=1") != 0 ||
+        request.body_length != 4 || strcmp(request.body, "ping") != 0 || !request.content_type ||
+        strcmp(request.content_type, "text") != 0) {
+        printf("FAILED: Request with a body was not decoded\n");
+        return -1;
+    }
+    h2_session_output_sent(session);
+
+    char http1[] = "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\nConnection: keep-alive\r\n"
+                   "Content-Length: 16\r\n\r\n0123456789abcdef";
+    RouteResponse response;
+    memset(&response, 0, sizeof(RouteResponse));
+    response.data = http1;
+    response.length = strlen(http1);
+    response.status_code = 200;
+
+    size_t headers_length, data_length;
+    const uint8_t *headers;
+    const uint8_t *body;
+    if (h2_session_respond(session, 1, &response) <= 0 ||
+        !(headers = find_frame(session, 0x1, 1, &headers_length)) ||
+        !(body = find_frame(session, 0x0, 1, &data_length))) {
+        printf("FAILED: No HEADERS and DATA frames\n");
+        return -1;
+    }
+    // :status 200 is indexed; Connection is dropped; only the window's 10 bytes go out
+    if (headers[9] != 0x88 || memmem(headers + 9, headers_length, "keep-alive", 10) ||
+        data_length != 10 || body[4] != 0 || memcmp(body + 9, "0123456789", 10) != 0) {
+        printf("FAILED: Response framed wrongly\n");
+        return -1;
+    }
+    h2_session_output_sent(session);
+
+    static const uint8_t increment[] = {0x00, 0x00, 0x01, 0x00};
+    length = frame(data, 0x8, 0, 1, increment, sizeof(increment));
+    if (h2_session_receive(session, (const char *)data, length) != 0 ||
+        !(body = find_frame(session, 0x0, 1, &data_length)) || data_length != 6 || body[4] != 0x1 ||
+        memcmp(body + 9, "abcdef", 6) != 0) {
+        printf("FAILED: Window update did not release the rest of the body\n");
+        return -1;
+    }
+
+    h2_session_free(session);
+    arena_destroy(&arena);
+    printf("PASSED: Response framing and flow control\n");
+    return 0;
+}
+
+// The increment of the first WINDOW_UPDATE for `stream_id`, or 0 if none was sent
+static uint32_t window_increment(const H2Session *session, uint32_t stream_id) {
+    size_t length;
+    const uint8_t *update = find_frame(session, 0x8, stream_id, &length);
+    if (!update || length != 4) return 0;
+    return (uint32_t)update[9] << 24 | (uint32_t)update[10] << 16 | (uint32_t)update[11] << 8 | update[12];
+}
+
+int test_receive_window() {
+    printf("Testing request body flow control...\n");
+
+    H2Session *session = h2_session_create();
+    Arena arena;
+    arena_init(&arena, ARENA_DEFAULT_BLOCK_SIZE);
+    h2_session_receive(session, H2_PREFACE, H2_PREFACE_LENGTH);
+    h2_session_output_sent(session);
+
+    static const uint8_t block[] = {0x83, 0x86, 0x04, 0x05, '/', 'e', 'c', 'h', 'o'};
+    static uint8_t data[16384 + 64];
+    static char payload[16384];
+    memset(payload, 'x', sizeof(payload));
+
+    // Body bytes are not given back while the body is only buffered; padding is
+    size_t length = frame(data, 0x1, 0x4, 1, block, sizeof(block));
+    uint8_t padded[1 + 100 + 20];
+    padded[0] = 20;
+    memcpy(padded + 1, payload, 100);
+    memset(padded + 101, 0, 20);
+    length += frame(data + length, 0x0, 0x8, 1, padded, sizeof(padded));
+    if (h2_session_receive(session, (const char *)data, length) != 0 ||
+        window_increment(session, 0) != 21 || window_increment(session, 1) != 0) {
+        printf("FAILED: Window given back before the body was dispatched\n");
+        return -1;
+    }
+    h2_session_output_sent(session);
+
+    HTTPRequest request;
+    length = frame(data, 0x0, 0x1, 1, (const uint8_t *)payload, 4);
+    if (h2_session_receive(session, (const char *)data, length) != 0 || window_increment(session, 0) != 0 ||
+        h2_session_next_request(session, &request, &arena) != 1 || request.body_length != 104 ||
+        window_increment(session, 0) != 104) {
+        printf("FAILED: Dispatching the body did not give its window back\n");
+        return -1;
+    }
+    h2_session_free(session);
+
+    // Undispatched bodies on several streams cannot go past the connection window
+    session = h2_session_create();
+    h2_session_receive(session, H2_PREFACE, H2_PREFACE_LENGTH);
+    uint64_t accepted = 0;
+    int result = 0;
+    for (uint32_t stream_id = 1; result == 0 && stream_id <= 5; stream_id += 2) {
+        length = frame(data, 0x1, 0x4, stream_id, block, sizeof(block));
+        result = h2_session_receive(session, (const char *)data, length);
+        // Each stream stays below the 10 MB body cap
+        for (int i = 0; result == 0 && i < 500; i++) {
+            length = frame(data, 0x0, 0, stream_id, (const uint8_t *)payload, sizeof(payload));
+            result = h2_session_receive(session, (const char *)data, length);
+            h2_session_output_sent(session);
+            if (result == 0) accepted += sizeof(payload);
+        }
+    }
+    h2_session_free(session);
+    arena_destroy(&arena);
+
+    if (result == 0 || accepted != 16u << 20) {
+        printf("FAILED: Accepted %llu buffered body bytes\n", (unsigned long long)accepted);
+        return -1;
+    }
+
+    printf("PASSED: Request body flow control\n");
+    return 0;
+}
+
+int main() {
+    printf("Running HTTP/2 tests...\n");
+
+    if (test_hpack_requests() != 0 || test_response_framing() != 0 || test_receive_window() != 0) {
+        printf("HTTP/2 tests FAILED\n");
+        return -1;
+    }
+
+    printf("All HTTP/2 tests PASSED\n");
+    return 0;
+}
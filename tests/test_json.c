@@ -2,6 +2,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include "../include/parser.h"
+#include "../include/json.h"
 
 int test_json_parsing() {
     printf("Testing JSON parsing...\n");
@@ -9,7 +10,7 @@ int test_json_parsing() {
     const char *json_string = "{\"prompt\": \"Hello, world!\", \"model\": \"test\"}";
     char prompt[1024] = {0};
     
-    if (parse_json(json_string, prompt) != 0) {
+    if (parse_json(json_string, prompt, sizeof(prompt)) != 0) {
         printf("FAILED: JSON parsing\n");
         return -1;
     }
@@ -43,6 +44,188 @@ int test_json_get_value() {
     return 0;
 }
 
+int test_json_cursor() {
+    printf("Testing JSON cursor API...\n");
+    
+    const char *json_string = "{\"prompt\": \"say \\\"hi\\\" \\u00e9\", \"stream\": true, "
+                              "\"max_tokens\": 64, \"messages\": [{\"role\": \"user\", \"content\": \"x\"}, 1, []]}";
+    JsonDoc doc;
+    JsonCursor root, value, element;
+    JsonIter it;
+    char text[64];
+    int64_t number;
+    int flag;
+    int count = 0;
+    
+    if (json_doc_parse(&doc, json_string, strlen(json_string)) != 0 || json_doc_root(&doc, &root) != 0) {
+        printf("FAILED: JSON document parsing\n");
+        return -1;
+    }
+    
+    if (json_object_get(&root, "prompt", &value) != 0 ||
+        json_get_string(&value, text, sizeof(text), NULL) != 0 ||
+        strcmp(text, "say \"hi\" \xc3\xa9") != 0) {
+        printf("FAILED: Escaped string value\n");
+        json_doc_free(&doc);
+        return -1;
+    }
+    
+    if (json_object_get(&root, "stream", &value) != 0 || json_get_bool(&value, &flag) != 0 || !flag ||
+        json_object_get(&root, "max_tokens", &value) != 0 || json_get_int64(&value, &number) != 0 || number != 64) {
+        printf("FAILED: Scalar values\n");
+        json_doc_free(&doc);
+        return -1;
+    }
+    
+    if (json_object_get(&root, "messages", &value) != 0 || json_array_begin(&value, &it) != 0) {
+        printf("FAILED: Array lookup\n");
+        json_doc_free(&doc);
+        return -1;
+    }
+    while (json_array_next(&it, &element) == 1) count++;
+    
+    // Raw text of nested values is returned unchanged
+    JsonSlice raw;
+    if (json_array_begin(&value, &it) != 0 || json_array_next(&it, &element) != 1 ||
+        json_get_raw(&element, &raw) != 0 ||
+        raw.len != strlen("{\"role\": \"user\", \"content\": \"x\"}") ||
+        memcmp(raw.ptr, "{\"role\": \"user\", \"content\": \"x\"}", raw.len) != 0 ||
+        json_object_get(&root, "max_tokens", &value) != 0 || json_get_raw(&value, &raw) != 0 ||
+        raw.len != 2 || memcmp(raw.ptr, "64", 2) != 0) {
+        printf("FAILED: Raw value text\n");
+        json_doc_free(&doc);
+        return -1;
+    }
+    json_doc_free(&doc);
+    
+    if (count != 3) {
+        printf("FAILED: Array iteration\n");
+        return -1;
+    }
+    
+    // Integral exponents convert; values outside int64 are refused, not truncated
+    const char *numbers = "[1e3, 1e30, -1e30, 99999999999999999999, 1.5]";
+    int64_t expected[] = {1000, -1, -1, -1, -1};
+    if (json_doc_parse(&doc, numbers, strlen(numbers)) != 0 || json_doc_root(&doc, &root) != 0 ||
+        json_array_begin(&root, &it) != 0) {
+        printf("FAILED: Number array parsing\n");
+        return -1;
+    }
+    for (int i = 0; json_array_next(&it, &element) == 1; i++) {
+        int result = json_get_int64(&element, &number);
+        if (expected[i] >= 0 ? result != 0 || number != expected[i] : result != -1) {
+            printf("FAILED: Integer conversion of element %d\n", i);
+            json_doc_free(&doc);
+            return -1;
+        }
+    }
+    json_doc_free(&doc);
+    
+    // Unbalanced brackets and unterminated strings must be rejected
+    const char *unbalanced = "{\"a\": [1}";
+    const char *unterminated = "{\"a\": \"x}";
+    if (json_doc_parse(&doc, unbalanced, strlen(unbalanced)) == 0 ||
+        json_doc_parse(&doc, unterminated, strlen(unterminated)) == 0) {
+        printf("FAILED: Malformed JSON accepted\n");
+        return -1;
+    }
+    
+    printf("PASSED: JSON cursor API\n");
+    return 0;
+}
+
+int test_json_block_boundaries() {
+    printf("Testing JSON state across 64-byte blocks...\n");
+    
+    // One string running into the fourth block: a backslash run and an
+    // escaped quote cross the first boundary, another escaped quote the
+    // second, and the closing quote is the first byte of the fourth block,
+    // right after an escaped backslash
+    char json_string[256];
+    char expected[256];
+    size_t pos = 0, out = 0;
+    pos += (size_t)sprintf(json_string, "{\"a\": \"");
+    while (pos < 62) json_string[pos++] = 'x', expected[out++] = 'x';
+    memcpy(json_string + pos, "\\\\\\\"", 4);        // Bytes 62-65
+    pos += 4;
+    expected[out++] = '\\';
+    expected[out++] = '"';
+    while (pos < 100) json_string[pos++] = 'x', expected[out++] = 'x';
+    memcpy(json_string + pos, "}, {", 4);           // Structure inside the string
+    memcpy(expected + out, "}, {", 4);
+    pos += 4;
+    out += 4;
+    while (pos < 127) json_string[pos++] = 'x', expected[out++] = 'x';
+    memcpy(json_string + pos, "\\\"", 2);            // Bytes 127-128
+    pos += 2;
+    expected[out++] = '"';
+    while (pos < 190) json_string[pos++] = 'x', expected[out++] = 'x';
+    memcpy(json_string + pos, "\\\\\"", 3);          // Bytes 190-192
+    pos += 3;
+    expected[out++] = '\\';
+    expected[out] = '\0';
+    strcpy(json_string + pos, ", \"b\": [1, \"y\"]}");
+    
+    JsonDoc doc;
+    JsonCursor root, value, element;
+    JsonIter it;
+    char text[256];
+    int64_t number;
+    
+    if (json_doc_parse(&doc, json_string, strlen(json_string)) != 0 || json_doc_root(&doc, &root) != 0) {
+        printf("FAILED: Document with strings across blocks\n");
+        return -1;
+    }
+    if (json_object_get(&root, "a", &value) != 0 ||
+        json_get_string(&value, text, sizeof(text), NULL) != 0 || strcmp(text, expected) != 0) {
+        printf("FAILED: String decoded across blocks\n");
+        json_doc_free(&doc);
+        return -1;
+    }
+    if (json_object_get(&root, "b", &value) != 0 || json_array_begin(&value, &it) != 0 ||
+        json_array_next(&it, &element) != 1 || json_get_int64(&element, &number) != 0 || number != 1 ||
+        json_array_next(&it, &element) != 1 || json_get_string(&element, text, sizeof(text), NULL) != 0 ||
+        strcmp(text, "y") != 0 || json_array_next(&it, &element) != 0) {
+        printf("FAILED: Value after the string\n");
+        json_doc_free(&doc);
+        return -1;
+    }
+    json_doc_free(&doc);
+    
+    printf("PASSED: JSON state across 64-byte blocks\n");
+    return 0;
+}
+
+int test_json_writer() {
+    printf("Testing JSON writer...\n");
+    
+    const char *text = "line1\n\"quoted\" \\ tab\t bell\x07 and a clean run longer than thirty-two bytes";
+    const char *expected = "{\"text\": \"line1\\n\\\"quoted\\\" \\\\ tab\\t bell\\u0007 and a clean run longer than thirty-two bytes\", \"n\": 42}";
+    JsonWriter w;
+    size_t len;
+    
+    if (json_writer_init(&w, 0) != 0) {
+        printf("FAILED: JSON writer init\n");
+        return -1;
+    }
+    json_write_cstr(&w, "{\"text\": ");
+    json_write_string(&w, text, strlen(text));
+    json_write_cstr(&w, ", \"n\": ");
+    json_write_int(&w, 42);
+    json_write_cstr(&w, "}");
+    
+    char *output = json_writer_finish(&w, &len);
+    if (!output || len != strlen(expected) || strcmp(output, expected) != 0) {
+        printf("FAILED: Escaped output mismatch\n");
+        free(output);
+        return -1;
+    }
+    free(output);
+    
+    printf("PASSED: JSON writer\n");
+    return 0;
+}
+
 int main() {
     printf("Running JSON tests...\n");
     
@@ -56,6 +239,21 @@ int main() {
         return -1;
     }
     
+    if (test_json_cursor() != 0) {
+        printf("JSON tests FAILED\n");
+        return -1;
+    }
+    
+    if (test_json_block_boundaries() != 0) {
+        printf("JSON tests FAILED\n");
+        return -1;
+    }
+    
+    if (test_json_writer() != 0) {
+        printf("JSON tests FAILED\n");
+        return -1;
+    }
+    
     printf("All JSON tests PASSED\n");
     return 0;
 }
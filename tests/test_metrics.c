@@ -0,0 +1,89 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "../include/metrics.h"
+
+#define THREADS 4
+#define REQUESTS 10000
+
+static void *serve_requests(void *arg) {
+    metrics_bind_worker((int)(intptr_t)arg);
+    for (int i = 0; i < REQUESTS; i++) {
+        metrics_count_read(100);
+        metrics_count_request();
+        metrics_count_response(i % 10 ? 200 : 503, 50);
+    }
+    return NULL;
+}
+
+int test_worker_counters() {
+    printf("Testing per-worker counters...\n");
+
+    pthread_t threads[THREADS];
+    for (int i = 0; i < THREADS; i++) {
+        pthread_create(&threads[i], NULL, serve_requests, (void *)(intptr_t)i);
+    }
+    for (int i = 0; i < THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    metrics_count_rejected();   // Not a worker: the shared slot
+
+    WorkerMetricsInfo workers[THREADS];
+    if (metrics_get_workers(workers, THREADS) != THREADS || workers[2].requests != REQUESTS ||
+        workers[2].responses[1] != REQUESTS - REQUESTS / 10 || workers[2].responses[4] != REQUESTS / 10) {
+        printf("FAILED: Worker counters\n");
+        return -1;
+    }
+
+    WorkerMetricsInfo totals;
+    metrics_get_totals(&totals);
+    if (totals.requests != THREADS * REQUESTS || totals.rejected != 1 ||
+        totals.bytes_received != 100ULL * THREADS * REQUESTS || totals.bytes_sent != 50ULL * THREADS * REQUESTS) {
+        printf("FAILED: Totals\n");
+        return -1;
+    }
+
+    printf("PASSED: Per-worker counters\n");
+    return 0;
+}
+
+int test_exposition() {
+    printf("Testing OpenMetrics exposition...\n");
+
+    JsonWriter w;
+    if (json_writer_init(&w, 1024) != 0 || metrics_render(NULL, &w) != 0) {
+        printf("FAILED: Render\n");
+        return -1;
+    }
+
+    char *text = json_writer_finish(&w, NULL);
+    size_t length = text ? strlen(text) : 0;
+    int ok = text && length > 6 && strcmp(text + length - 6, "# EOF\n") == 0 &&
+             strstr(text, "# TYPE aionic_requests counter\n") &&
+             strstr(text, "aionic_requests_total{worker=\"1\"} 10000\n") &&
+             strstr(text, "aionic_responses_total{worker=\"3\",code=\"5xx\"} 1000\n") &&
+             strstr(text, "aionic_requests_rejected_total{worker=\"other\"} 1\n");
+    free(text);
+    if (!ok) {
+        printf("FAILED: Exposition text\n");
+        return -1;
+    }
+
+    printf("PASSED: OpenMetrics exposition\n");
+    return 0;
+}
+
+int main() {
+    printf("Running metrics tests...\n");
+
+    metrics_init();
+    if (test_worker_counters() != 0 || test_exposition() != 0) {
+        printf("Metrics tests FAILED\n");
+        return -1;
+    }
+
+    printf("All metrics tests PASSED\n");
+    return 0;
+}
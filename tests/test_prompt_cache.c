@@ -0,0 +1,141 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/ai/prompt_cache.h"
+
+static const char *LONG_PROMPT =
+    "Summarize the following incident report for the on-call channel. "
+    "The database primary in region eu-west failed over to the replica at 10:42 "
+    "after replication lag exceeded the alert threshold, and writes were "
+    "rejected for roughly ninety seconds while clients reconnected. "
+    "Include the customer impact, the timeline and the follow-up actions "
+    "owned by the storage team.";
+
+static int sketch_prompt(PromptSketch *sketch, const char *route, const char *model, const char *prompt) {
+    PromptRequest request = { .prompt = prompt, .model_name = model, .max_tokens = 0, .stream = 0 };
+    return prompt_cache_sketch(sketch, route, &request);
+}
+
+static int lookup(const char *route, const char *model, const char *prompt, char *out, size_t out_size) {
+    PromptSketch sketch;
+    if (sketch_prompt(&sketch, route, model, prompt) != 0) return -1;
+    char served[64];
+    int result = prompt_cache_lookup(&sketch, out, out_size, served, sizeof(served));
+    prompt_cache_sketch_free(&sketch);
+    return result;
+}
+
+int test_near_duplicate_hits() {
+    printf("Testing near-duplicate prompt lookup...\n");
+
+    PromptSketch sketch;
+    if (sketch_prompt(&sketch, "/v1/chat", "m", LONG_PROMPT) != 0 ||
+        prompt_cache_store(&sketch, "cached answer", "m") != 0) {
+        printf("FAILED: Store\n");
+        return -1;
+    }
+    prompt_cache_sketch_free(&sketch);
+
+    char out[64];
+    // Same words, different casing and whitespace
+    const char *reformatted =
+        "summarize the following  incident report for the ON-CALL channel.\n"
+        "The database primary in region eu-west failed over to the replica at 10:42 "
+        "after replication lag exceeded the alert threshold, and writes were "
+        "rejected for roughly ninety seconds while clients reconnected. "
+        "Include the customer impact,  the timeline and the follow-up actions "
+        "owned by the Storage team.";
+    if (lookup("/v1/chat", "m", reformatted, out, sizeof(out)) != 0 || strcmp(out, "cached answer") != 0) {
+        printf("FAILED: Whitespace and casing variant missed\n");
+        return -1;
+    }
+
+    // A different timestamp
+    char *shifted = strdup(LONG_PROMPT);
+    char *stamp = strstr(shifted, "10:42");
+    memcpy(stamp, "11:07", 5);
+    int result = lookup("/v1/chat", "m", shifted, out, sizeof(out));
+    free(shifted);
+    if (result != 0) {
+        printf("FAILED: Timestamp variant missed\n");
+        return -1;
+    }
+
+    printf("PASSED: Near-duplicate prompt lookup\n");
+    return 0;
+}
+
+int test_distinct_prompts_miss() {
+    printf("Testing distinct prompts and scopes...\n");
+
+    char out[64];
+    if (lookup("/v1/chat", "m", "Write a haiku about autumn leaves falling into a quiet pond.", out, sizeof(out)) == 0) {
+        printf("FAILED: Unrelated prompt hit\n");
+        return -1;
+    }
+
+    // Entries only match their own route and model
+    if (lookup("/v1/chat", "other", LONG_PROMPT, out, sizeof(out)) == 0 ||
+        lookup("/v1/other", "m", LONG_PROMPT, out, sizeof(out)) == 0) {
+        printf("FAILED: Lookup crossed scopes\n");
+        return -1;
+    }
+
+    // A stricter route threshold rejects the timestamp variant
+    PromptSketch sketch;
+    if (prompt_cache_set_threshold("/v1/strict", 0.99) != 0 ||
+        sketch_prompt(&sketch, "/v1/strict", "m", LONG_PROMPT) != 0 ||
+        prompt_cache_store(&sketch, "strict answer", "m") != 0) {
+        printf("FAILED: Strict route setup\n");
+        return -1;
+    }
+    prompt_cache_sketch_free(&sketch);
+
+    char *shifted = strdup(LONG_PROMPT);
+    memcpy(strstr(shifted, "10:42"), "11:07", 5);
+    int result = lookup("/v1/strict", "m", shifted, out, sizeof(out));
+    free(shifted);
+    if (result == 0) {
+        printf("FAILED: Route threshold ignored\n");
+        return -1;
+    }
+
+    // Disabled routes are not sketched at all
+    if (prompt_cache_set_threshold("/v1/off", 0.0) != 0 ||
+        sketch_prompt(&sketch, "/v1/off", "m", LONG_PROMPT) == 0) {
+        printf("FAILED: Disabled route\n");
+        return -1;
+    }
+
+    PromptCacheStats stats;
+    prompt_cache_get_stats(&stats);
+    if (stats.hits != 2 || stats.lookups != 6 || stats.sampled != 2 || stats.false_matches != 0) {
+        printf("FAILED: Stats (hits %llu, lookups %llu, sampled %llu)\n",
+               (unsigned long long)stats.hits, (unsigned long long)stats.lookups,
+               (unsigned long long)stats.sampled);
+        return -1;
+    }
+
+    printf("PASSED: Distinct prompts and scopes\n");
+    return 0;
+}
+
+int main() {
+    printf("Running prompt cache tests...\n");
+
+    // Every hit is re-checked against the exact similarity
+    if (prompt_cache_init(64, 60, 0.8, 100.0) != 0) {
+        printf("Prompt cache tests FAILED\n");
+        return -1;
+    }
+
+    if (test_near_duplicate_hits() != 0 || test_distinct_prompts_miss() != 0) {
+        prompt_cache_cleanup();
+        printf("Prompt cache tests FAILED\n");
+        return -1;
+    }
+
+    prompt_cache_cleanup();
+    printf("All prompt cache tests PASSED\n");
+    return 0;
+}
@@ -0,0 +1,393 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+// The selection, hedging and breaker logic is internal; test it directly.
+// Nothing here contacts a real upstream; the timeout test uses a loopback
+// listener that never answers.
+#include "../src/ai/prompt_router.c"
+
+#define MS (1000000ULL)
+
+static AIModel *lookup_model(const char *name) {
+    return table_lookup(atomic_load(&global_router.table), name);
+}
+
+int test_replica_selection() {
+    printf("Testing power-of-two-choices replica selection...\n");
+
+    if (prompt_router_add_model("p2c", "http://127.0.0.1:9/a", 64, 0.0) != 0 ||
+        prompt_router_add_replica("p2c", "http://127.0.0.1:9/b") != 0) {
+        printf("FAILED: Setup\n");
+        return -1;
+    }
+    ReplicaSet *set = atomic_load(&lookup_model("p2c")->replicas);
+    ModelReplica *a = set->replicas[0];
+    ModelReplica *b = set->replicas[1];
+    uint64_t now = get_current_time_ns();
+    int probe;
+
+    // Same latency, but `a` has a queue: both samples are always drawn with
+    // two replicas, so the cheaper one wins every time
+    atomic_store(&a->ewma_ns, 5 * MS);
+    atomic_store(&b->ewma_ns, 5 * MS);
+    atomic_store(&a->ewma_stamp_ns, now);
+    atomic_store(&b->ewma_stamp_ns, now);
+    atomic_store(&a->inflight, 4);
+    for (int i = 0; i < 100; i++) {
+        if (select_replica(set, NULL, &probe) != b || probe) {
+            printf("FAILED: Busier replica picked\n");
+            return -1;
+        }
+    }
+
+    // A hedge never goes back to the replica already in use
+    if (select_replica(set, b, &probe) != a) {
+        printf("FAILED: Hedge excluded replica\n");
+        return -1;
+    }
+
+    // An ejected replica is skipped; a hedge gets nothing rather than it
+    atomic_store(&b->ejected_until_ns, now + 60000 * MS);
+    for (int i = 0; i < 20; i++) {
+        if (select_replica(set, NULL, &probe) != a) {
+            printf("FAILED: Ejected replica picked\n");
+            return -1;
+        }
+    }
+    if (select_replica(set, a, &probe) != NULL) {
+        printf("FAILED: Hedge sent to an ejected replica\n");
+        return -1;
+    }
+
+    // Every replica ejected: the one back soonest still serves
+    atomic_store(&a->ejected_until_ns, now + 120000 * MS);
+    if (select_replica(set, NULL, &probe) != b || probe) {
+        printf("FAILED: Soonest ejected replica not chosen\n");
+        return -1;
+    }
+
+    // Ejection over: one caller gets the probe, the next one does not
+    atomic_store(&a->ejected_until_ns, 0);
+    atomic_store(&a->inflight, 0);
+    atomic_store(&b->ejected_until_ns, now - 1);
+    int probes = 0;
+    for (int i = 0; i < 20; i++) {
+        ModelReplica *picked = select_replica(set, NULL, &probe);
+        if (probe && picked != b) {
+            printf("FAILED: Probe of the wrong replica\n");
+            return -1;
+        }
+        probes += probe;
+    }
+    if (probes != 1) {
+        printf("FAILED: %d probes while one was outstanding\n", probes);
+        return -1;
+    }
+
+    printf("PASSED: Power-of-two-choices replica selection\n");
+    return 0;
+}
+
+int test_hedge_delay() {
+    printf("Testing hedge delay percentile...\n");
+
+    if (prompt_router_add_model("hedge", "http://127.0.0.1:9/", 64, 0.0) != 0) {
+        printf("FAILED: Setup\n");
+        return -1;
+    }
+    AIModel *model = lookup_model("hedge");
+
+    // No hedging until HEDGE_MIN_SAMPLES have been seen
+    for (int i = 1; i < HEDGE_MIN_SAMPLES; i++) {
+        model_record_ttft(model, (uint64_t)i * MS);
+    }
+    if (atomic_load(&model->hedge_delay_ns) != 0) {
+        printf("FAILED: Hedge delay before enough samples\n");
+        return -1;
+    }
+
+    // 64 samples of 1..64ms; the refresh at 64 puts p95 at rank 60, 61ms
+    for (int i = HEDGE_MIN_SAMPLES; i <= 64; i++) {
+        model_record_ttft(model, (uint64_t)i * MS);
+    }
+    uint64_t delay = atomic_load(&model->hedge_delay_ns);
+    if (delay != 61 * MS) {
+        printf("FAILED: p95 hedge delay %llums\n", (unsigned long long)(delay / MS));
+        return -1;
+    }
+
+    // Fast upstreams still wait HEDGE_MIN_DELAY_NS; a zero percentile disables hedging
+    for (int i = 0; i < TTFT_WINDOW; i++) {
+        model_record_ttft(model, 1 * MS);
+    }
+    model_refresh_hedge_delay(model, atomic_load(&model->ttft_count));
+    if (atomic_load(&model->hedge_delay_ns) != HEDGE_MIN_DELAY_NS) {
+        printf("FAILED: Minimum hedge delay\n");
+        return -1;
+    }
+    if (prompt_router_set_hedging("hedge", 0.0, HEDGE_DEFAULT_BUDGET) != 0) {
+        printf("FAILED: Disabling hedging\n");
+        return -1;
+    }
+    model_refresh_hedge_delay(model, atomic_load(&model->ttft_count));
+    if (atomic_load(&model->hedge_delay_ns) != 0) {
+        printf("FAILED: Hedge delay with hedging disabled\n");
+        return -1;
+    }
+
+    printf("PASSED: Hedge delay percentile\n");
+    return 0;
+}
+
+int test_hedge_budget() {
+    printf("Testing hedge token bucket...\n");
+
+    AIModel *model = lookup_model("hedge");
+    if (prompt_router_set_hedging("hedge", HEDGE_DEFAULT_PERCENTILE, 5.0) != 0) {
+        printf("FAILED: Setup\n");
+        return -1;
+    }
+
+    // A new model starts with a full burst, then runs dry
+    for (int i = 0; i < HEDGE_BURST; i++) {
+        if (!model_take_hedge_budget(model)) {
+            printf("FAILED: Burst hedge %d refused\n", i);
+            return -1;
+        }
+    }
+    if (model_take_hedge_budget(model)) {
+        printf("FAILED: Hedge allowed with an empty budget\n");
+        return -1;
+    }
+
+    // 5% budget: every 20 requests earn one hedge
+    for (int i = 0; i < 19; i++) model_earn_hedge_budget(model);
+    if (model_take_hedge_budget(model)) {
+        printf("FAILED: Hedge allowed after 19 requests\n");
+        return -1;
+    }
+    model_earn_hedge_budget(model);
+    if (!model_take_hedge_budget(model) || model_take_hedge_budget(model)) {
+        printf("FAILED: One hedge per 20 requests\n");
+        return -1;
+    }
+
+    // Idle periods do not bank more than HEDGE_BURST hedges
+    for (int i = 0; i < 10000; i++) model_earn_hedge_budget(model);
+    int taken = 0;
+    while (model_take_hedge_budget(model)) taken++;
+    if (taken != HEDGE_BURST) {
+        printf("FAILED: %d hedges banked, burst is %d\n", taken, HEDGE_BURST);
+        return -1;
+    }
+
+    printf("PASSED: Hedge token bucket\n");
+    return 0;
+}
+
+// Stub upstream: fails for the models named in `failing`, counts every call
+typedef struct {
+    const char *failing;
+    int calls_primary;
+    int calls_backup;
+} StubCalls;
+
+static int stub_call(AIModel *model, void *arg) {
+    StubCalls *stub = arg;
+    int primary = strcmp(model->name, "primary") == 0;
+    if (primary) stub->calls_primary++;
+    else stub->calls_backup++;
+    return stub->failing && strstr(stub->failing, model->name) ? -1 : 0;
+}
+
+static void sleep_ms(long ms) {
+    struct timespec ts = {ms / 1000, (ms % 1000) * 1000000L};
+    nanosleep(&ts, NULL);
+}
+
+// Fail `primary` until its breaker opens; every request is served by `backup`
+static int trip_primary(StubCalls *stub) {
+    stub->failing = "primary";
+    for (int i = 0; i < BREAKER_MIN_CALLS; i++) {
+        const char *served = NULL;
+        if (route_through_chain("primary", stub_call, stub, &served) != 0 || strcmp(served, "backup") != 0) {
+            return -1;
+        }
+    }
+    return breaker_state(lookup_model("primary")) == BREAKER_OPEN ? 0 : -1;
+}
+
+int test_circuit_breaker() {
+    printf("Testing circuit breaker and fallback chain...\n");
+
+    if (prompt_router_add_model("primary", "http://127.0.0.1:9/", 64, 0.0) != 0 ||
+        prompt_router_add_model("backup", "http://127.0.0.1:9/", 64, 0.0) != 0 ||
+        prompt_router_set_fallback("primary", "backup") != 0 ||
+        prompt_router_set_breaker("primary", 50.0, 10000, 20) != 0) {
+        printf("FAILED: Setup\n");
+        return -1;
+    }
+    AIModel *model = lookup_model("primary");
+    StubCalls stub = {NULL, 0, 0};
+    const char *served = NULL;
+
+    // closed -> open after enough failures
+    if (trip_primary(&stub) != 0 || stub.calls_primary != BREAKER_MIN_CALLS) {
+        printf("FAILED: Breaker did not open\n");
+        return -1;
+    }
+
+    // Open: the chain goes straight to the fallback without calling the model
+    stub.failing = NULL;
+    if (route_through_chain("primary", stub_call, &stub, &served) != 0 || strcmp(served, "backup") != 0 ||
+        stub.calls_primary != BREAKER_MIN_CALLS) {
+        printf("FAILED: Open breaker let a request through\n");
+        return -1;
+    }
+
+    // open -> half_open after the open period, with exactly the trial permits
+    sleep_ms(30);
+    int trials = 0, trial;
+    for (int i = 0; i < BREAKER_HALF_OPEN_CALLS + 3; i++) {
+        if (breaker_allow(model, &trial)) trials += trial;
+    }
+    if (breaker_state(model) != BREAKER_HALF_OPEN || trials != BREAKER_HALF_OPEN_CALLS) {
+        printf("FAILED: %d trial requests in half_open\n", trials);
+        return -1;
+    }
+
+    // A caller that lost the race to open the trial round changes nothing
+    uint64_t stale = BREAKER_WORD(BREAKER_OPEN, 1);
+    if (breaker_transition(model, stale, BREAKER_HALF_OPEN, get_current_time_ns()) != 0 ||
+        atomic_load(&model->half_open_permits) > 0) {
+        printf("FAILED: Losing transition refilled the permits\n");
+        return -1;
+    }
+
+    // half_open -> closed once every trial succeeded, with a fresh window
+    for (int i = 0; i < BREAKER_HALF_OPEN_CALLS; i++) {
+        breaker_record(model, 1, 1, MS);
+    }
+    if (breaker_state(model) != BREAKER_CLOSED) {
+        printf("FAILED: Breaker did not close\n");
+        return -1;
+    }
+    stub.failing = "primary";
+    if (route_through_chain("primary", stub_call, &stub, &served) != 0 || breaker_state(model) != BREAKER_CLOSED) {
+        printf("FAILED: Closed breaker kept the old window\n");
+        return -1;
+    }
+
+    // A failed trial reopens it, and the open period starts over
+    if (trip_primary(&stub) != 0) {
+        printf("FAILED: Breaker did not open again\n");
+        return -1;
+    }
+    sleep_ms(30);
+    int before = stub.calls_primary;
+    if (route_through_chain("primary", stub_call, &stub, &served) != 0 || stub.calls_primary != before + 1 ||
+        breaker_state(model) != BREAKER_OPEN) {
+        printf("FAILED: Failed trial did not reopen the breaker\n");
+        return -1;
+    }
+    if (breaker_allow(model, &trial) || route_through_chain("primary", stub_call, &stub, &served) != 0 ||
+        stub.calls_primary != before + 1) {
+        printf("FAILED: Reopened breaker let a request through\n");
+        return -1;
+    }
+
+    // Both links failing reports an error; both unavailable reports that instead
+    stub.failing = "primary backup";
+    if (route_through_chain("backup", stub_call, &stub, &served) != PROMPT_ROUTE_ERROR) {
+        printf("FAILED: Failing chain\n");
+        return -1;
+    }
+    prompt_router_set_model_availability("backup", 0);
+    if (route_through_chain("primary", stub_call, &stub, &served) != PROMPT_ROUTE_UNAVAILABLE) {
+        printf("FAILED: Unavailable chain\n");
+        return -1;
+    }
+
+    printf("PASSED: Circuit breaker and fallback chain\n");
+    return 0;
+}
+
+static int payload_call(AIModel *model, void *arg) {
+    (void)arg;
+    char *body = NULL;
+    CURLcode curl_result;
+    int result = send_payload(model, "{}", &body, &curl_result);
+    free(body);
+    return result == 0 && curl_result == CURLE_OK ? 0 : -1;
+}
+
+int test_request_timeout() {
+    printf("Testing upstream request timeout...\n");
+
+    // Connections complete in the backlog, but nothing ever reads or answers
+    struct sockaddr_in addr = {0};
+    socklen_t length = sizeof(addr);
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    if (listener < 0 || bind(listener, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(listener, 4) != 0 ||
+        getsockname(listener, (struct sockaddr *)&addr, &length) != 0) {
+        printf("FAILED: Listener setup\n");
+        return -1;
+    }
+    char endpoint[64];
+    snprintf(endpoint, sizeof(endpoint), "http://127.0.0.1:%d/", ntohs(addr.sin_port));
+
+    if (prompt_router_add_model("blackhole", endpoint, 64, 0.0) != 0 ||
+        prompt_router_set_request_timeout(200) != 0 || prompt_router_set_request_timeout(0) != -1) {
+        printf("FAILED: Setup\n");
+        close(listener);
+        return -1;
+    }
+    AIModel *model = lookup_model("blackhole");
+
+    // The hung call ends at the timeout and counts against the breaker
+    uint64_t start = get_current_time_ns();
+    int result = route_through_chain("blackhole", payload_call, NULL, NULL);
+    uint64_t elapsed = get_current_time_ns() - start;
+    close(listener);
+    prompt_router_set_request_timeout(UPSTREAM_DEFAULT_TIMEOUT_MS);
+
+    if (result != PROMPT_ROUTE_ERROR || elapsed < 150 * MS || elapsed > 5000 * MS) {
+        printf("FAILED: Hung call returned %d after %llu ms\n", result, (unsigned long long)(elapsed / MS));
+        return -1;
+    }
+    if (atomic_load(&model->outcome_count) != 1 || atomic_load(&model->outcomes[0]) != OUTCOME_FAILED) {
+        printf("FAILED: Timeout not recorded as a breaker failure\n");
+        return -1;
+    }
+
+    printf("PASSED: Upstream request timeout\n");
+    return 0;
+}
+
+int main() {
+    printf("Running prompt router tests...\n");
+
+    if (prompt_router_init() != 0) {
+        printf("Prompt router tests FAILED\n");
+        return -1;
+    }
+
+    if (test_replica_selection() != 0 || test_hedge_delay() != 0 || test_hedge_budget() != 0 ||
+        test_circuit_breaker() != 0 || test_request_timeout() != 0) {
+        printf("Prompt router tests FAILED\n");
+        return -1;
+    }
+
+    prompt_router_cleanup();
+    printf("All prompt router tests PASSED\n");
+    return 0;
+}
@@ -0,0 +1,106 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/parser.h"
+#include "../include/route_tree.h"
+
+static int handler_users(Server *s, HTTPRequest *r, RouteResponse *p) { (void)s; (void)r; (void)p; return 1; }
+static int handler_user_new(Server *s, HTTPRequest *r, RouteResponse *p) { (void)s; (void)r; (void)p; return 2; }
+static int handler_user(Server *s, HTTPRequest *r, RouteResponse *p) { (void)s; (void)r; (void)p; return 3; }
+static int handler_user_post(Server *s, HTTPRequest *r, RouteResponse *p) { (void)s; (void)r; (void)p; return 4; }
+static int handler_static(Server *s, HTTPRequest *r, RouteResponse *p) { (void)s; (void)r; (void)p; return 5; }
+static int handler_update(Server *s, HTTPRequest *r, RouteResponse *p) { (void)s; (void)r; (void)p; return 6; }
+
+static int param_equals(const HTTPRequest *request, const char *name, const char *expected) {
+    size_t len;
+    const char *value = http_request_param(request, name, &len);
+    return value && len == strlen(expected) && memcmp(value, expected, len) == 0;
+}
+
+int test_route_tree_lookup() {
+    printf("Testing radix tree route lookup...\n");
+    
+    RouteNode *root = route_tree_create();
+    if (!root ||
+        route_tree_insert(root, "/users", HTTP_GET, handler_users) != 0 ||
+        route_tree_insert(root, "/users/new", HTTP_GET, handler_user_new) != 0 ||
+        route_tree_insert(root, "/users/:id", HTTP_GET, handler_user) != 0 ||
+        route_tree_insert(root, "/users/:id/posts/:post", HTTP_GET, handler_user_post) != 0 ||
+        route_tree_insert(root, "/users/:id", HTTP_PUT, handler_update) != 0 ||
+        route_tree_insert(root, "/static/*path", HTTP_GET, handler_static) != 0) {
+        printf("FAILED: Route registration\n");
+        route_tree_free(root);
+        return -1;
+    }
+    
+    HTTPRequest request;
+    memset(&request, 0, sizeof(HTTPRequest));
+    int path_matched;
+    RouteHandler handler;
+    
+    handler = route_tree_lookup(root, "/users/new", HTTP_GET, &request, NULL);
+    if (handler != handler_user_new || request.param_count != 0) {
+        printf("FAILED: Static segment priority\n");
+        route_tree_free(root);
+        return -1;
+    }
+    
+    handler = route_tree_lookup(root, "/users/newer", HTTP_GET, &request, NULL);
+    if (handler != handler_user || !param_equals(&request, "id", "newer")) {
+        printf("FAILED: Backtracking to parameter\n");
+        route_tree_free(root);
+        return -1;
+    }
+    
+    handler = route_tree_lookup(root, "/users/42/posts/7", HTTP_GET, &request, NULL);
+    if (handler != handler_user_post || !param_equals(&request, "id", "42") || !param_equals(&request, "post", "7")) {
+        printf("FAILED: Multiple parameters\n");
+        route_tree_free(root);
+        return -1;
+    }
+    
+    handler = route_tree_lookup(root, "/static/css/site.css", HTTP_GET, &request, NULL);
+    if (handler != handler_static || !param_equals(&request, "path", "css/site.css")) {
+        printf("FAILED: Wildcard capture\n");
+        route_tree_free(root);
+        return -1;
+    }
+    
+    handler = route_tree_lookup(root, "/users/42", HTTP_DELETE, &request, &path_matched);
+    if (handler != NULL || !path_matched) {
+        printf("FAILED: Method mismatch should report a path match\n");
+        route_tree_free(root);
+        return -1;
+    }
+    
+    handler = route_tree_lookup(root, "/nope", HTTP_GET, &request, &path_matched);
+    if (handler != NULL || path_matched) {
+        printf("FAILED: Unknown path\n");
+        route_tree_free(root);
+        return -1;
+    }
+    
+    // Duplicate handlers and conflicting parameter names are rejected
+    if (route_tree_insert(root, "/users/:id", HTTP_GET, handler_user) == 0 ||
+        route_tree_insert(root, "/users/:name/x", HTTP_GET, handler_user) == 0) {
+        printf("FAILED: Conflicting registration accepted\n");
+        route_tree_free(root);
+        return -1;
+    }
+    
+    route_tree_free(root);
+    printf("PASSED: Radix tree route lookup\n");
+    return 0;
+}
+
+int main() {
+    printf("Running router tests...\n");
+    
+    if (test_route_tree_lookup() != 0) {
+        printf("Router tests FAILED\n");
+        return -1;
+    }
+    
+    printf("All router tests PASSED\n");
+    return 0;
+}
@@ -0,0 +1,168 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include "../include/static_files.h"
+
+#define ROOT "/tmp/aionic_test_static"
+
+static int write_file(const char *name, const char *content) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s", ROOT, name);
+    FILE *file = fopen(path, "w");
+    if (!file) return -1;
+    fputs(content, file);
+    fclose(file);
+    return 0;
+}
+
+static StaticFile *acquire(const char *path) {
+    return static_file_acquire(path, strlen(path));
+}
+
+int test_ranges() {
+    printf("Testing Range and If-None-Match parsing...\n");
+
+    uint64_t start = 0, length = 0;
+    if (static_parse_range("bytes=10-19", 100, &start, &length) != 1 || start != 10 || length != 10 ||
+        static_parse_range("bytes=90-", 100, &start, &length) != 1 || start != 90 || length != 10 ||
+        static_parse_range("bytes=-30", 100, &start, &length) != 1 || start != 70 || length != 30 ||
+        static_parse_range("bytes=50-500", 100, &start, &length) != 1 || length != 50 ||
+        static_parse_range("bytes=100-", 100, &start, &length) != -1 ||
+        static_parse_range("bytes=0-1,5-6", 100, &start, &length) != 0 ||
+        static_parse_range("lines=1-2", 100, &start, &length) != 0 ||
+        static_parse_range("bytes=9-3", 100, &start, &length) != 0) {
+        printf("FAILED: Range parsing\n");
+        return -1;
+    }
+
+    if (!static_etag_matches("\"a\", W/\"abc\"", "\"abc\"") || !static_etag_matches("*", "\"abc\"") ||
+        static_etag_matches("\"abcd\"", "\"abc\"") || static_etag_matches(NULL, "\"abc\"")) {
+        printf("FAILED: ETag matching\n");
+        return -1;
+    }
+
+    printf("PASSED: Range and If-None-Match parsing\n");
+    return 0;
+}
+
+int test_file_cache() {
+    printf("Testing open-file cache...\n");
+
+    mkdir(ROOT, 0755);
+    mkdir(ROOT "/css", 0755);
+    if (write_file("css/app.css", "body{}") != 0 || write_file("other.txt", "other") != 0 ||
+        write_file(".secret", "hidden") != 0 || static_files_init(ROOT, 1) != 0) {
+        printf("FAILED: Setup\n");
+        return -1;
+    }
+
+    StaticFile *first = acquire("css/app.css");
+    StaticFile *second = acquire("css%2Fapp.css");
+    uint64_t hits, misses;
+    static_files_get_counts(&hits, &misses);
+    if (!first || first != second || first->size != 6 || strcmp(first->content_type, "text/css; charset=utf-8") != 0 ||
+        hits != 1 || misses != 1) {
+        printf("FAILED: Repeated lookup was not a cache hit\n");
+        return -1;
+    }
+    char etag[STATIC_ETAG_MAX];
+    snprintf(etag, sizeof(etag), "%s", first->etag);
+
+    if (acquire("../etc/passwd") || acquire(".secret") || acquire("css/./app.css") || acquire("css//app.css") ||
+        acquire("%2e%2e/x") || acquire("missing") || acquire("css")) {
+        printf("FAILED: Refused path was served\n");
+        return -1;
+    }
+
+    // Capacity 1: opening another file evicts app.css, which stays usable while referenced
+    StaticFile *other = acquire("other.txt");
+    char body[16] = {0};
+    if (!other || pread(first->fd, body, sizeof(body) - 1, 0) != 6 || strcmp(body, "body{}") != 0) {
+        printf("FAILED: Evicted entry was closed while in use\n");
+        return -1;
+    }
+    static_file_release(other);
+    static_file_release(first);
+    static_file_release(second);
+
+    // A changed file is noticed once the entry is due for revalidation
+    sleep(STATIC_REVALIDATE_SECONDS + 1);
+    write_file("css/app.css", "body{color:red}");
+    StaticFile *changed = acquire("css/app.css");
+    if (!changed || changed->size != 15 || strcmp(changed->etag, etag) == 0) {
+        printf("FAILED: Changed file kept its old entry\n");
+        return -1;
+    }
+
+    // Headers and a byte range through sendfile()
+    int sockets[2];
+    socketpair(AF_UNIX, SOCK_STREAM, 0, sockets);
+    int64_t sent = static_file_send(sockets[0], "HDR|", 4, changed, 5, 5);
+    char received[32] = {0};
+    ssize_t got = recv(sockets[1], received, sizeof(received) - 1, MSG_WAITALL | MSG_DONTWAIT);
+    close(sockets[0]);
+    close(sockets[1]);
+    static_file_release(changed);
+    static_files_cleanup();
+
+    if (sent != 9 || got != 9 || strcmp(received, "HDR|color") != 0) {
+        printf("FAILED: Sent %lld bytes: %s\n", (long long)sent, received);
+        return -1;
+    }
+
+    remove(ROOT "/css/app.css");
+    remove(ROOT "/other.txt");
+    remove(ROOT "/.secret");
+    rmdir(ROOT "/css");
+    rmdir(ROOT);
+
+    printf("PASSED: Open-file cache\n");
+    return 0;
+}
+
+int test_escapes() {
+    printf("Testing symlinks and special files...\n");
+
+    mkdir(ROOT, 0755);
+    if (write_file("inside.txt", "inside") != 0 || symlink("/etc/passwd", ROOT "/passwd") != 0 ||
+        symlink("/etc", ROOT "/etc") != 0 || mkfifo(ROOT "/pipe", 0644) != 0 || static_files_init(ROOT, 4) != 0) {
+        printf("FAILED: Setup\n");
+        return -1;
+    }
+
+    // Neither a link out of the root nor a FIFO may be opened (or block the opener)
+    StaticFile *inside = acquire("inside.txt");
+    int refused = !acquire("passwd") && !acquire("etc/passwd") && !acquire("pipe");
+    static_file_release(inside);
+    static_files_cleanup();
+
+    remove(ROOT "/inside.txt");
+    remove(ROOT "/passwd");
+    remove(ROOT "/etc");
+    remove(ROOT "/pipe");
+    rmdir(ROOT);
+
+    if (!inside || !refused) {
+        printf("FAILED: Served a path outside the root or a FIFO\n");
+        return -1;
+    }
+
+    printf("PASSED: Symlinks and special files\n");
+    return 0;
+}
+
+int main() {
+    printf("Running static file tests...\n");
+
+    if (test_ranges() != 0 || test_file_cache() != 0 || test_escapes() != 0) {
+        printf("Static file tests FAILED\n");
+        return -1;
+    }
+
+    printf("All static file tests PASSED\n");
+    return 0;
+}
@@ -0,0 +1,194 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <pthread.h>
+#include "../include/ai/stats.h"
+
+#define STATS_PATH "/tmp/aionic_test_stats.bin"
+#define JSON_PATH "/tmp/aionic_test_stats.json"
+#define THREADS 4
+#define SAMPLES 10000
+
+// Each thread records every THREADS-th value of 1..SAMPLES ms
+static void *record_samples(void *arg) {
+    int offset = (int)(intptr_t)arg;
+    for (int ms = 1 + offset; ms <= SAMPLES; ms += THREADS) {
+        stats_record_successful_request("test-model", (double)ms, 2);
+        stats_record_latency(STATS_SCOPE_MODEL, "test-model", STATS_TTFT, (uint64_t)ms * 100);
+    }
+    return NULL;
+}
+
+static int close_to(double value, double expected) {
+    return fabs(value - expected) <= expected * 0.03;
+}
+
+int test_percentiles() {
+    printf("Testing merged percentiles...\n");
+
+    pthread_t threads[THREADS];
+    for (int i = 0; i < THREADS; i++) {
+        pthread_create(&threads[i], NULL, record_samples, (void *)(intptr_t)i);
+    }
+    for (int i = 0; i < THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    ModelStats stats;
+    if (stats_get_model_stats("test-model", &stats) != 0) {
+        printf("FAILED: Model not tracked\n");
+        return -1;
+    }
+    free(stats.model_name);
+
+    const LatencySummary *e2e = &stats.latency[STATS_LATENCY];
+    if (stats.successful_requests != SAMPLES || stats.total_tokens_processed != 2 * SAMPLES ||
+        e2e->count != SAMPLES) {
+        printf("FAILED: Counts across threads\n");
+        return -1;
+    }
+
+    if (!close_to(e2e->p50_ms, 5000.0) || !close_to(e2e->p90_ms, 9000.0) ||
+        !close_to(e2e->p99_ms, 9900.0) || !close_to(e2e->p999_ms, 9990.0) ||
+        e2e->max_ms != 10000.0 || !close_to(e2e->mean_ms, 5000.5)) {
+        printf("FAILED: Percentiles (p50 %.1f p99 %.1f max %.1f)\n", e2e->p50_ms, e2e->p99_ms, e2e->max_ms);
+        return -1;
+    }
+
+    if (stats.avg_response_time != e2e->mean_ms || !close_to(stats.min_response_time, 1.0) ||
+        !close_to(stats.latency[STATS_TTFT].p50_ms, 500.0) || stats.latency[STATS_UPSTREAM].count != 0) {
+        printf("FAILED: Derived and per-metric stats\n");
+        return -1;
+    }
+
+    printf("PASSED: Merged percentiles\n");
+    return 0;
+}
+
+int test_series() {
+    printf("Testing models and routes...\n");
+
+    // Small values are exact
+    for (int us = 1; us <= 20; us++) {
+        stats_record_latency(STATS_SCOPE_ROUTE, "/v1/chat", STATS_LATENCY, (uint64_t)us);
+    }
+    stats_record_failed_request("test-model");
+
+    LatencySummary route[STATS_METRIC_COUNT];
+    if (stats_get_route_stats("/v1/chat", route) != 0 || route[STATS_LATENCY].count != 20 ||
+        route[STATS_LATENCY].p50_ms != 0.010 || route[STATS_LATENCY].max_ms != 0.020) {
+        printf("FAILED: Route latency\n");
+        return -1;
+    }
+
+    // The same name in another scope is another series
+    if (stats_get_route_stats("test-model", route) != -1 || stats_get_model_stats("/v1/chat", &(ModelStats){0}) != -1) {
+        printf("FAILED: Scopes\n");
+        return -1;
+    }
+
+    StatsSeriesInfo series[8];
+    int count = stats_get_series(series, 8, 1);
+    if (count != 2 || strcmp(series[0].name, "test-model") != 0 || series[0].failures != 1 ||
+        series[1].scope != STATS_SCOPE_ROUTE) {
+        printf("FAILED: Series listing\n");
+        return -1;
+    }
+
+    ModelStats *all;
+    int model_count;
+    if (stats_get_all_stats(&all, &model_count) != 0 || model_count != 1 || all[0].total_requests != SAMPLES + 1) {
+        printf("FAILED: All model stats\n");
+        return -1;
+    }
+    free(all[0].model_name);
+    free(all);
+
+    printf("PASSED: Models and routes\n");
+    return 0;
+}
+
+// Loading adds the file's counters to what is already recorded, so after a
+// save and a reload every count doubles while the percentiles stay put
+int test_persistence() {
+    printf("Testing snapshots and reload...\n");
+
+    ModelStats before, after;
+    stats_get_model_stats("test-model", &before);
+    free(before.model_name);
+
+    stats_cleanup();        // Writes the final snapshot
+    FILE *json = fopen(JSON_PATH, "r");
+    char text[256] = {0};
+    if (!json || fread(text, 1, sizeof(text) - 1, json) == 0 || !strstr(text, "\"name\": \"test-model\"")) {
+        printf("FAILED: JSON export\n");
+        if (json) fclose(json);
+        return -1;
+    }
+    fclose(json);
+
+    if (stats_init(STATS_PATH, NULL, 0) != 0 || stats_get_model_stats("test-model", &after) != 0) {
+        printf("FAILED: Reload\n");
+        return -1;
+    }
+    free(after.model_name);
+
+    const LatencySummary *e2e = &after.latency[STATS_LATENCY];
+    if (after.successful_requests != 2 * before.successful_requests ||
+        after.failed_requests != 2 * before.failed_requests || e2e->count != 2 * SAMPLES ||
+        e2e->p99_ms != before.latency[STATS_LATENCY].p99_ms || e2e->max_ms != 10000.0 ||
+        after.latency[STATS_TTFT].count != 2 * SAMPLES) {
+        printf("FAILED: Restored counters and histograms\n");
+        return -1;
+    }
+
+    LatencySummary route[STATS_METRIC_COUNT];
+    if (stats_get_route_stats("/v1/chat", route) != 0 || route[STATS_LATENCY].count != 40) {
+        printf("FAILED: Restored route\n");
+        return -1;
+    }
+
+    // A corrupted snapshot is ignored as a whole
+    stats_cleanup();
+    FILE *file = fopen(STATS_PATH, "r+b");
+    if (!file || fseek(file, -1, SEEK_END) != 0 || fputc(0x55, file) == EOF) {
+        printf("FAILED: Corrupting the snapshot\n");
+        if (file) fclose(file);
+        return -1;
+    }
+    fclose(file);
+
+    if (stats_init(STATS_PATH, NULL, 0) != 0 || stats_get_model_stats("test-model", &before) != 0 ||
+        before.successful_requests != after.successful_requests) {
+        printf("FAILED: Corrupt snapshot was loaded\n");
+        return -1;
+    }
+    free(before.model_name);
+
+    printf("PASSED: Snapshots and reload\n");
+    return 0;
+}
+
+int main() {
+    printf("Running stats tests...\n");
+
+    remove(STATS_PATH);
+    if (stats_init(STATS_PATH, JSON_PATH, 0) != 0) {
+        printf("Stats tests FAILED\n");
+        return -1;
+    }
+
+    int result = test_percentiles() == 0 && test_series() == 0 && test_persistence() == 0 ? 0 : -1;
+    stats_cleanup();
+    remove(STATS_PATH);
+    remove(JSON_PATH);
+    if (result != 0) {
+        printf("Stats tests FAILED\n");
+        return -1;
+    }
+
+    printf("All stats tests PASSED\n");
+    return 0;
+}
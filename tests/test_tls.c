@@ -0,0 +1,162 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+#include <openssl/pem.h>
+#include "../include/tls.h"
+
+#define CERT_FILE "/tmp/aionic_test_tls.crt"
+#define KEY_FILE "/tmp/aionic_test_tls.key"
+
+// Self-signed certificate for "localhost", written as PEM
+static int write_certificate(void) {
+    EVP_PKEY *key = EVP_EC_gen("P-256");
+    X509 *cert = X509_new();
+    if (!key || !cert) return -1;
+
+    ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+    X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+    X509_gmtime_adj(X509_getm_notAfter(cert), 3600);
+    X509_set_pubkey(cert, key);
+    X509_NAME *name = X509_get_subject_name(cert);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, (const unsigned char *)"localhost", -1, -1, 0);
+    X509_set_issuer_name(cert, name);
+    X509_sign(cert, key, EVP_sha256());
+
+    FILE *cert_file = fopen(CERT_FILE, "w");
+    FILE *key_file = fopen(KEY_FILE, "w");
+    int result = cert_file && key_file && PEM_write_X509(cert_file, cert) &&
+                 PEM_write_PrivateKey(key_file, key, NULL, NULL, 0, NULL, NULL) ? 0 : -1;
+    if (cert_file) fclose(cert_file);
+    if (key_file) fclose(key_file);
+    X509_free(cert);
+    EVP_PKEY_free(key);
+    return result;
+}
+
+// Drives both ends of a non-blocking socket pair until the server side is established
+static int handshake_pair(SSL *client, TlsConnection *server) {
+    for (int round = 0; round < 100; round++) {
+        int client_done = SSL_do_handshake(client) == 1;
+        int server_state = tls_handshake(server);
+        if (server_state < 0) return -1;
+        if (client_done && server_state == 1) return 0;
+    }
+    return -1;
+}
+
+// One connection: handshake, a request each way, and the session for resuming
+static int exchange(SSL_CTX *client_ctx, SSL_SESSION *session, SSL_SESSION **session_out,
+                    const char **alpn_out) {
+    int sockets[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) != 0) return -1;
+    fcntl(sockets[0], F_SETFL, O_NONBLOCK);
+    fcntl(sockets[1], F_SETFL, O_NONBLOCK);
+
+    SSL *client = SSL_new(client_ctx);
+    SSL_set_fd(client, sockets[0]);
+    SSL_set_connect_state(client);
+    if (session) SSL_set_session(client, session);
+    TlsConnection *server = tls_connection_create(sockets[1]);
+
+    int result = -1;
+    char buffer[64] = {0};
+    if (server && handshake_pair(client, server) == 0 && tls_is_established(server) &&
+        SSL_write(client, "ping", 4) == 4 && tls_recv(server, buffer, sizeof(buffer)) == 4 &&
+        memcmp(buffer, "ping", 4) == 0 && tls_send(server, "pong", 4) == 4) {
+        // Reading the reply also collects the TLS 1.3 tickets sent after the handshake
+        memset(buffer, 0, sizeof(buffer));
+        if (SSL_read(client, buffer, sizeof(buffer)) == 4 && memcmp(buffer, "pong", 4) == 0) {
+            result = 0;
+        }
+    }
+
+    // Nothing queued: the server reads report EAGAIN rather than end of stream
+    if (result == 0 && tls_recv(server, buffer, sizeof(buffer)) != -1) result = -1;
+
+    const unsigned char *alpn;
+    unsigned int alpn_length;
+    SSL_get0_alpn_selected(client, &alpn, &alpn_length);
+    *alpn_out = alpn_length == 2 && memcmp(alpn, "h2", 2) == 0 ? "h2" : "other";
+    if (session_out) *session_out = SSL_get1_session(client);
+
+    // A session is only resumable after a clean shutdown
+    SSL_shutdown(client);
+    SSL_free(client);
+    tls_connection_free(server);
+    close(sockets[0]);
+    close(sockets[1]);
+    return result;
+}
+
+int test_handshake_and_resumption() {
+    printf("Testing TLS handshake, ALPN and resumption...\n");
+
+    if (write_certificate() != 0 || tls_init(CERT_FILE, KEY_FILE, 0) != 0 || !tls_is_enabled()) {
+        printf("FAILED: Setup\n");
+        return -1;
+    }
+
+    SSL_CTX *client_ctx = SSL_CTX_new(TLS_client_method());
+    SSL_CTX_set_alpn_protos(client_ctx, (const unsigned char *)"\x08http/1.1\x02h2", 12);
+    SSL_SESSION *session = NULL;
+    const char *alpn = NULL;
+    if (exchange(client_ctx, NULL, &session, &alpn) != 0 || !session) {
+        printf("FAILED: Full handshake\n");
+        return -1;
+    }
+    if (strcmp(alpn, "h2") != 0) {
+        printf("FAILED: ALPN did not prefer h2\n");
+        return -1;
+    }
+    if (exchange(client_ctx, session, NULL, &alpn) != 0) {
+        printf("FAILED: Resumed handshake\n");
+        return -1;
+    }
+
+    uint64_t handshakes, resumed, offloaded;
+    tls_get_counts(&handshakes, &resumed, &offloaded);
+    if (handshakes != 2 || resumed != 1 || offloaded != 0) {
+        printf("FAILED: Counted %llu handshakes, %llu resumed\n",
+               (unsigned long long)handshakes, (unsigned long long)resumed);
+        return -1;
+    }
+
+    SSL_SESSION_free(session);
+    SSL_CTX_free(client_ctx);
+    tls_cleanup();
+    remove(CERT_FILE);
+    remove(KEY_FILE);
+
+    printf("PASSED: TLS handshake, ALPN and resumption\n");
+    return 0;
+}
+
+int test_missing_files() {
+    printf("Testing missing certificate files...\n");
+
+    if (tls_init("/nonexistent.crt", "/nonexistent.key", 1) != -1 || tls_is_enabled()) {
+        printf("FAILED: Missing files were accepted\n");
+        return -1;
+    }
+
+    printf("PASSED: Missing certificate files\n");
+    return 0;
+}
+
+int main() {
+    printf("Running TLS tests...\n");
+
+    if (test_missing_files() != 0 || test_handshake_and_resumption() != 0) {
+        printf("TLS tests FAILED\n");
+        return -1;
+    }
+
+    printf("All TLS tests PASSED\n");
+    return 0;
+}
@@ -0,0 +1,217 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "../include/ai/tokenizer.h"
+#include "../include/ai/bpe.h"
+
+#define VOCAB_PATH "/tmp/aionic_test_vocab.bpe"
+#define VOCAB_SLOTS 1024
+
+// Single bytes are ranks 0-255; merges are ranked in the order listed
+static const char *MERGES[] = {"ll", "he", "llo", " hello", "lx", "'m", "123", " ok", "!!\n\n", " x", "34", "  "};
+#define MERGE_COUNT (int)(sizeof(MERGES) / sizeof(MERGES[0]))
+
+// Same as bpe_hash() in src/ai/bpe.c
+static uint64_t vocab_hash(const uint8_t *data, size_t length) {
+    uint64_t h = 0x9e3779b97f4a7c15ULL ^ (length * 0xff51afd7ed558ccdULL);
+    while (length > 0) {
+        uint64_t chunk = 0;
+        size_t n = length < 8 ? length : 8;
+        memcpy(&chunk, data, n);
+        h = (h ^ chunk) * 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 32;
+        data += n;
+        length -= n;
+    }
+    h ^= h >> 29;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    return h ^ (h >> 32);
+}
+
+// Write the vocabulary the way tools/build_bpe_vocab.py does
+static int write_vocab(const char *path) {
+    uint32_t count = 256 + MERGE_COUNT;
+    uint8_t blob[512];
+    uint32_t entries[2 * (256 + MERGE_COUNT)];
+    uint32_t slots[VOCAB_SLOTS] = {0};
+    uint32_t blob_size = 0;
+
+    for (uint32_t rank = 0; rank < count; rank++) {
+        uint8_t byte = (uint8_t)rank;
+        const uint8_t *token = rank < 256 ? &byte : (const uint8_t *)MERGES[rank - 256];
+        uint32_t length = rank < 256 ? 1 : (uint32_t)strlen(MERGES[rank - 256]);
+
+        entries[rank * 2] = blob_size;
+        entries[rank * 2 + 1] = length;
+        memcpy(blob + blob_size, token, length);
+        blob_size += length;
+
+        uint32_t slot = (uint32_t)vocab_hash(token, length) & (VOCAB_SLOTS - 1);
+        while (slots[slot]) slot = (slot + 1) & (VOCAB_SLOTS - 1);
+        slots[slot] = rank + 1;
+    }
+
+    BpeFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, BPE_FILE_MAGIC, sizeof(header.magic));
+    header.version = BPE_FILE_VERSION;
+    header.pattern = BPE_PATTERN_CL100K;
+    header.token_count = count;
+    header.hash_slots = VOCAB_SLOTS;
+    header.tokens_offset = sizeof(header);
+    header.hash_offset = header.tokens_offset + sizeof(uint32_t) * 2 * count;
+    header.bytes_offset = header.hash_offset + sizeof(slots);
+    header.bytes_size = blob_size;
+
+    FILE *f = fopen(path, "wb");
+    if (!f) return -1;
+    int ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+             fwrite(entries, sizeof(uint32_t) * 2 * count, 1, f) == 1 &&
+             fwrite(slots, sizeof(slots), 1, f) == 1 &&
+             fwrite(blob, blob_size, 1, f) == 1;
+    return fclose(f) == 0 && ok ? 0 : -1;
+}
+
+// Tokenize and compare the token texts with `expected` (NULL-terminated)
+static int expect_tokens(const char *text, const char *const *expected) {
+    Token **tokens;
+    int token_count;
+    if (tokenizer_tokenize(text, &tokens, &token_count) != 0) return -1;
+
+    int matched = 1;
+    int i = 0;
+    for (; expected[i]; i++) {
+        if (i >= token_count || strcmp(tokens[i]->text, expected[i]) != 0) {
+            printf("  token %d: got '%s', expected '%s'\n", i, i < token_count ? tokens[i]->text : "", expected[i]);
+            matched = 0;
+            break;
+        }
+    }
+    matched = matched && i == token_count;
+
+    tokenizer_free_tokens(tokens, token_count);
+    return matched ? 0 : -1;
+}
+
+int test_pretokenizer() {
+    printf("Testing cl100k pre-tokenization...\n");
+
+    // Contractions, digit groups of three, punctuation absorbing newlines,
+    // and the last space of a run moving to the next word. "34" and "  " are
+    // in the vocabulary but span piece boundaries here.
+    const char *pieces[] = {"I", "'m", " ", "123", "4", "5", " ok", "!!\n\n", " ", " x", NULL};
+    if (expect_tokens("I'm 12345 ok!!\n\n  x", pieces) != 0) {
+        printf("FAILED: Pre-tokenization\n");
+        return -1;
+    }
+
+    if (tokenizer_count_tokens("I'm 12345 ok!!\n\n  x", 19) != 10) {
+        printf("FAILED: Token count\n");
+        return -1;
+    }
+
+    printf("PASSED: cl100k pre-tokenization\n");
+    return 0;
+}
+
+int test_merges() {
+    printf("Testing BPE merges...\n");
+
+    // "ll" outranks "he" and "lx"; " hello" is a whole piece; ties merge leftmost
+    const char *merged[] = {"he", "ll", "x", " hello", "\t", "W", "O", "R", "L", "D", " ", "ll", "l", NULL};
+    if (expect_tokens("hellx hello\tWORLD lll", merged) != 0) {
+        printf("FAILED: Merge order\n");
+        return -1;
+    }
+
+    Token **tokens;
+    int token_count;
+    if (tokenizer_tokenize(" hello", &tokens, &token_count) != 0 || token_count != 1 || tokens[0]->id != 259) {
+        printf("FAILED: Token id\n");
+        return -1;
+    }
+    tokenizer_free_tokens(tokens, token_count);
+
+    // BPE tokens keep their spacing, so detokenizing restores the text
+    char output[64];
+    if (tokenizer_tokenize("hellx hello", &tokens, &token_count) != 0 ||
+        tokenizer_detokenize(tokens, token_count, output, sizeof(output)) != 0 ||
+        strcmp(output, "hellx hello") != 0) {
+        printf("FAILED: Round trip\n");
+        return -1;
+    }
+    tokenizer_free_tokens(tokens, token_count);
+
+    printf("PASSED: BPE merges\n");
+    return 0;
+}
+
+int test_encode() {
+    printf("Testing allocation-free encoding...\n");
+
+    // "hellx hello" -> he | ll | x | " hello"
+    const char *text = "hellx hello";
+    uint32_t ids[8], offsets[8];
+    const uint32_t expected_ids[] = {257, 256, 'x', 259};
+    const uint32_t expected_offsets[] = {0, 2, 4, 5};
+
+    if (tokenizer_encode(text, strlen(text), ids, offsets, 8) != 4 ||
+        memcmp(ids, expected_ids, sizeof(expected_ids)) != 0 ||
+        memcmp(offsets, expected_offsets, sizeof(expected_offsets)) != 0) {
+        printf("FAILED: Ids and offsets\n");
+        return -1;
+    }
+
+    // Too small a buffer: filled up to capacity, the full count returned
+    memset(ids, 0, sizeof(ids));
+    if (tokenizer_encode(text, strlen(text), ids, NULL, 2) != 4 || ids[1] != 256 || ids[2] != 0) {
+        printf("FAILED: Capacity\n");
+        return -1;
+    }
+
+    Arena arena;
+    uint32_t *arena_ids, *arena_offsets;
+    if (arena_init(&arena, ARENA_DEFAULT_BLOCK_SIZE) != 0) {
+        printf("FAILED: Arena setup\n");
+        return -1;
+    }
+    long count = tokenizer_encode_arena(&arena, text, strlen(text), &arena_ids, &arena_offsets);
+    int matched = count == 4 && memcmp(arena_ids, expected_ids, sizeof(expected_ids)) == 0 &&
+                  memcmp(arena_offsets, expected_offsets, sizeof(expected_offsets)) == 0;
+    arena_destroy(&arena);
+    if (!matched) {
+        printf("FAILED: Arena encoding\n");
+        return -1;
+    }
+
+    printf("PASSED: Allocation-free encoding\n");
+    return 0;
+}
+
+int main() {
+    printf("Running tokenizer tests...\n");
+
+    // Without a vocabulary words are counted
+    if (tokenizer_init() != 0 || tokenizer_count_tokens("hello, world", 12) != 3) {
+        printf("Tokenizer tests FAILED\n");
+        return -1;
+    }
+
+    if (write_vocab(VOCAB_PATH) != 0 || tokenizer_load_vocab(VOCAB_PATH) != 0) {
+        printf("FAILED: Loading the vocabulary\n");
+        tokenizer_cleanup();
+        return -1;
+    }
+    remove(VOCAB_PATH);     // The mapping outlives the file
+
+    if (test_pretokenizer() != 0 || test_merges() != 0 || test_encode() != 0) {
+        tokenizer_cleanup();
+        printf("Tokenizer tests FAILED\n");
+        return -1;
+    }
+
+    tokenizer_cleanup();
+    printf("All tokenizer tests PASSED\n");
+    return 0;
+}
@@ -0,0 +1,164 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "../include/trace.h"
+#include "../include/router.h"
+#include "../include/ai/stats.h"
+
+static void traced_request(const char *path) {
+    trace_request_begin();
+    uint64_t start = trace_now();
+    trace_phase(TRACE_PARSE, start);
+    start = trace_now();
+    trace_phase(TRACE_ROUTE, start);
+    trace_request_end("GET", path, 200);
+}
+
+int test_disabled() {
+    printf("Testing disabled tracing...\n");
+
+    trace_set_enabled(0);
+    if (trace_request_begin() != 0 || trace_now() != 0) {
+        printf("FAILED: Timestamps taken while disabled\n");
+        return -1;
+    }
+    traced_request("/off");
+
+    JsonWriter w;
+    json_writer_init(&w, 256);
+    int written = trace_write_chrome(&w, 10);
+    json_writer_free(&w);
+    if (written != 0) {
+        printf("FAILED: Request recorded while disabled\n");
+        return -1;
+    }
+
+    printf("PASSED: Disabled tracing\n");
+    return 0;
+}
+
+int test_chrome_dump() {
+    printf("Testing trace ring and Chrome export...\n");
+
+    trace_set_enabled(1);
+    for (int i = 0; i < TRACE_RING_SIZE + 10; i++) {
+        traced_request(i == TRACE_RING_SIZE + 9 ? "/last" : "/users/\"x\"");
+    }
+
+    JsonWriter w;
+    json_writer_init(&w, 256);
+    int written = trace_write_chrome(&w, 3);
+    char *text = json_writer_finish(&w, NULL);
+    int ok = written == 3 && text && strstr(text, "\"name\": \"GET /last\"") &&
+             strstr(text, "\"name\": \"GET /users/\\\"x\\\"\"") &&
+             strstr(text, "\"name\": \"route\", \"cat\": \"phase\"") && !strstr(text, "\"recv\"");
+    free(text);
+    if (!ok) {
+        printf("FAILED: Chrome trace JSON\n");
+        return -1;
+    }
+
+    // The ring keeps the newest TRACE_RING_SIZE requests
+    json_writer_init(&w, 256);
+    written = trace_write_chrome(&w, 100000);
+    json_writer_free(&w);
+    if (written != TRACE_RING_SIZE) {
+        printf("FAILED: Ring size (%d)\n", written);
+        return -1;
+    }
+
+    LatencySummary phases[STATS_METRIC_COUNT];
+    StatsSeriesInfo series[8];
+    int count = stats_get_series(series, 8, 0);
+    if (count != 2 || series[0].scope != STATS_SCOPE_PHASE || strcmp(series[0].name, "parse") != 0 ||
+        stats_get_route_stats("parse", phases) != -1) {
+        printf("FAILED: Phase histograms\n");
+        return -1;
+    }
+
+    printf("PASSED: Trace ring and Chrome export\n");
+    return 0;
+}
+
+// POST /debug/trace?enable=... over `client_fd`; returns the status code
+static int toggle_request(int client_fd, const char *query) {
+    char query_string[32];
+    snprintf(query_string, sizeof(query_string), "%s", query);
+    HTTPRequest request;
+    RouteResponse response;
+    memset(&request, 0, sizeof(request));
+    memset(&response, 0, sizeof(response));
+    request.method = HTTP_POST;
+    request.path = "/debug/trace";
+    request.query_string = query_string;
+    request.client_fd = client_fd;
+
+    int status = handle_trace_request(NULL, &request, &response) == 0 ? response.status_code : -1;
+    free_route_response(&response);
+    return status;
+}
+
+int test_toggle_loopback_only() {
+    printf("Testing tracing toggle from loopback only...\n");
+
+    trace_set_enabled(0);
+
+    // No connection, and a peer that is not on the loopback network
+    int pair[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) != 0) {
+        printf("FAILED: socketpair\n");
+        return -1;
+    }
+    int unbound = toggle_request(-1, "enable=1");
+    int unix_peer = toggle_request(pair[0], "enable=1");
+    close(pair[0]);
+    close(pair[1]);
+    if (unbound != 403 || unix_peer != 403 || trace_is_enabled()) {
+        printf("FAILED: Non-loopback toggle answered %d and %d\n", unbound, unix_peer);
+        return -1;
+    }
+
+    // The server side of a connection from 127.0.0.1
+    struct sockaddr_in addr = {0};
+    socklen_t length = sizeof(addr);
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    int client = socket(AF_INET, SOCK_STREAM, 0);
+    if (listener < 0 || client < 0 || bind(listener, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(listener, 1) != 0 || getsockname(listener, (struct sockaddr *)&addr, &length) != 0 ||
+        connect(client, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        printf("FAILED: Loopback connection\n");
+        return -1;
+    }
+    int server_side = accept(listener, NULL, NULL);
+    int enabled = toggle_request(server_side, "enable=1") == 200 && trace_is_enabled();
+    int disabled = toggle_request(server_side, "enable=0") == 200 && !trace_is_enabled();
+    close(server_side);
+    close(client);
+    close(listener);
+    if (!enabled || !disabled) {
+        printf("FAILED: Loopback toggle\n");
+        return -1;
+    }
+
+    printf("PASSED: Tracing toggle from loopback only\n");
+    return 0;
+}
+
+int main() {
+    printf("Running trace tests...\n");
+
+    if (test_disabled() != 0 || test_chrome_dump() != 0 || test_toggle_loopback_only() != 0) {
+        printf("Trace tests FAILED\n");
+        return -1;
+    }
+
+    printf("All trace tests PASSED\n");
+    return 0;
+}
@@ -0,0 +1,242 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include "../include/uring.h"
+
+#define BUFFER_COUNT 4
+#define BUFFER_SIZE 64
+#define BUFFER_GROUP 3
+#define LARGE_RESPONSE (1024 * 1024)
+
+enum { OP_RECV = 1, OP_SEND, OP_CLOSE };
+
+// Waits for the next completion and copies it out
+static int next_cqe(Uring *ring, struct io_uring_cqe *out) {
+    for (int attempt = 0; attempt < 20; attempt++) {
+        struct io_uring_cqe *cqe = uring_peek_cqe(ring);
+        if (cqe) {
+            *out = *cqe;
+            uring_cqe_seen(ring);
+            return 0;
+        }
+        if (uring_submit_wait(ring, 100) != 0) return -1;
+    }
+    return -1;
+}
+
+static void arm_recv(Uring *ring, int fd) {
+    struct io_uring_sqe *sqe = uring_get_sqe(ring);
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = BUFFER_GROUP;
+    sqe->user_data = OP_RECV;
+}
+
+int test_multishot_recv(Uring *ring, UringBuffers *buffers) {
+    printf("Testing multishot receive into provided buffers...\n");
+
+    int sockets[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) != 0) {
+        printf("FAILED: socketpair\n");
+        return -1;
+    }
+    arm_recv(ring, sockets[0]);
+    uring_submit_wait(ring, 0);
+
+    // More messages than buffers: every buffer is handed back once read, so
+    // the one multishot receive keeps going
+    int seen[BUFFER_COUNT] = {0};
+    for (int i = 0; i < BUFFER_COUNT * 3; i++) {
+        char message[16];
+        int length = snprintf(message, sizeof(message), "message %d", i);
+        send(sockets[1], message, (size_t)length, 0);
+
+        struct io_uring_cqe cqe;
+        if (next_cqe(ring, &cqe) != 0 || cqe.user_data != OP_RECV || cqe.res != length ||
+            !(cqe.flags & IORING_CQE_F_BUFFER) || !(cqe.flags & IORING_CQE_F_MORE)) {
+            printf("FAILED: Receive %d completed with %d (flags %x)\n", i, cqe.res, cqe.flags);
+            return -1;
+        }
+        uint16_t id = (uint16_t)(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+        char *buffer = uring_buffer(buffers, id);
+        if (id >= BUFFER_COUNT || memcmp(buffer, message, (size_t)length) != 0) {
+            printf("FAILED: Receive %d landed in buffer %u with the wrong bytes\n", i, id);
+            return -1;
+        }
+        seen[id]++;
+        uring_buffer_recycle(buffers, id);
+    }
+    for (int id = 0; id < BUFFER_COUNT; id++) {
+        if (seen[id] == 0) {
+            printf("FAILED: Buffer %d was never selected\n", id);
+            return -1;
+        }
+    }
+
+    // End of stream ends the multishot receive
+    close(sockets[1]);
+    struct io_uring_cqe cqe;
+    if (next_cqe(ring, &cqe) != 0 || cqe.res != 0 || (cqe.flags & IORING_CQE_F_MORE)) {
+        printf("FAILED: End of stream not reported\n");
+        return -1;
+    }
+    close(sockets[0]);
+
+    printf("PASSED: Multishot receive into provided buffers\n");
+    return 0;
+}
+
+int test_linked_send_close(Uring *ring) {
+    printf("Testing a send linked to a close...\n");
+
+    int sockets[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) != 0) {
+        printf("FAILED: socketpair\n");
+        return -1;
+    }
+
+    static const char response[] = "HTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n";
+    struct io_uring_sqe *sqe = uring_get_sqe(ring);
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = sockets[0];
+    sqe->addr = (uint64_t)(uintptr_t)response;
+    sqe->len = sizeof(response) - 1;
+    sqe->msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+    sqe->flags = IOSQE_IO_LINK;
+    sqe->user_data = OP_SEND;
+    sqe = uring_get_sqe(ring);
+    sqe->opcode = IORING_OP_CLOSE;
+    sqe->fd = sockets[0];
+    sqe->user_data = OP_CLOSE;
+    uring_submit_wait(ring, 0);
+
+    // The close runs only after the send, in that order
+    struct io_uring_cqe first, second;
+    if (next_cqe(ring, &first) != 0 || next_cqe(ring, &second) != 0 ||
+        first.user_data != OP_SEND || first.res != (int)sizeof(response) - 1 ||
+        second.user_data != OP_CLOSE || second.res != 0) {
+        printf("FAILED: Completions %llu (%d), %llu (%d)\n", (unsigned long long)first.user_data, first.res,
+               (unsigned long long)second.user_data, second.res);
+        return -1;
+    }
+
+    // The peer reads the whole response, then end of stream
+    char received[128];
+    ssize_t got = recv(sockets[1], received, sizeof(received), MSG_WAITALL);
+    if (got != (ssize_t)sizeof(response) - 1 || memcmp(received, response, sizeof(response) - 1) != 0 ||
+        recv(sockets[1], received, sizeof(received), 0) != 0) {
+        printf("FAILED: Peer received %zd bytes\n", got);
+        return -1;
+    }
+    close(sockets[1]);
+
+    printf("PASSED: Send linked to a close\n");
+    return 0;
+}
+
+int test_linked_close_after_large_send(Uring *ring) {
+    printf("Testing a linked close behind a send larger than the socket buffer...\n");
+
+    int sockets[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) != 0) {
+        printf("FAILED: socketpair\n");
+        return -1;
+    }
+    // Non-blocking like the server's sockets, with a buffer far smaller than the response
+    int small = 4096;
+    setsockopt(sockets[0], SOL_SOCKET, SO_SNDBUF, &small, sizeof(small));
+    fcntl(sockets[0], F_SETFL, fcntl(sockets[0], F_GETFL, 0) | O_NONBLOCK);
+
+    char *response = malloc(LARGE_RESPONSE);
+    char *received = malloc(LARGE_RESPONSE + 1);
+    if (!response || !received) {
+        printf("FAILED: Out of memory\n");
+        return -1;
+    }
+    for (size_t i = 0; i < LARGE_RESPONSE; i++) {
+        response[i] = (char)('a' + i % 26);
+    }
+
+    struct io_uring_sqe *sqe = uring_get_sqe(ring);
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = sockets[0];
+    sqe->addr = (uint64_t)(uintptr_t)response;
+    sqe->len = LARGE_RESPONSE;
+    // Without MSG_WAITALL the first partial send completes the link and the close truncates the rest
+    sqe->msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+    sqe->flags = IOSQE_IO_LINK;
+    sqe->user_data = OP_SEND;
+    sqe = uring_get_sqe(ring);
+    sqe->opcode = IORING_OP_CLOSE;
+    sqe->fd = sockets[0];
+    sqe->user_data = OP_CLOSE;
+    uring_submit_wait(ring, 0);
+
+    // The send can only finish as the peer reads, and the close must wait for all of it
+    size_t total = 0;
+    for (;;) {
+        ssize_t got = recv(sockets[1], received + total, LARGE_RESPONSE + 1 - total, 0);
+        if (got <= 0) break;
+        total += (size_t)got;
+    }
+    struct io_uring_cqe first, second;
+    if (next_cqe(ring, &first) != 0 || next_cqe(ring, &second) != 0 ||
+        first.user_data != OP_SEND || first.res != LARGE_RESPONSE ||
+        second.user_data != OP_CLOSE || second.res != 0) {
+        printf("FAILED: Completions %llu (%d), %llu (%d)\n", (unsigned long long)first.user_data, first.res,
+               (unsigned long long)second.user_data, second.res);
+        return -1;
+    }
+    if (total != LARGE_RESPONSE || memcmp(received, response, LARGE_RESPONSE) != 0) {
+        printf("FAILED: Peer received %zu of %d bytes before end of stream\n", total, LARGE_RESPONSE);
+        return -1;
+    }
+    close(sockets[1]);
+    free(response);
+    free(received);
+
+    printf("PASSED: Linked close behind a large send\n");
+    return 0;
+}
+
+int main() {
+    printf("Running io_uring tests...\n");
+
+    Uring ring;
+    UringBuffers buffers;
+    if (uring_init(&ring, 64, 0) != 0) {
+        if (errno == ENOSYS || errno == EPERM) {
+            printf("SKIPPED: io_uring unavailable\n");
+            return 0;
+        }
+        printf("FAILED: uring_init\n");
+        return -1;
+    }
+    if (uring_buffers_init(&ring, &buffers, BUFFER_GROUP, BUFFER_COUNT, BUFFER_SIZE) != 0) {
+        // Buffer rings need Linux 5.19
+        printf("SKIPPED: Provided-buffer rings unavailable\n");
+        uring_exit(&ring);
+        return 0;
+    }
+
+    int result = test_multishot_recv(&ring, &buffers) != 0 || test_linked_send_close(&ring) != 0 ||
+                 test_linked_close_after_large_send(&ring) != 0 ? -1 : 0;
+    uring_buffers_free(&ring, &buffers);
+    uring_exit(&ring);
+
+    if (result != 0) {
+        printf("io_uring tests FAILED\n");
+        return -1;
+    }
+
+    printf("All io_uring tests PASSED\n");
+    return 0;
+}
@@ -0,0 +1,92 @@
+#!/usr/bin/env python3
+"""
+Convert access log segments written by src/access_log.c to JSON lines.
+
+Each record becomes one JSON object on stdout, in file order. Segments
+left by a crash are read up to the last record count the writer stored.
+With --summary, records are instead totalled per model and route, each
+scaled by its sampling rate (see include/access_log.h for the layout).
+
+Usage: access_log_convert.py [--summary] logs/access-*.bin
+"""
+
+import json
+import sys
+import struct
+from collections import defaultdict
+
+MAGIC = b"AIACCESS"
+VERSION = 1
+HEADER = struct.Struct("<8sIIqQ32x")
+RECORD = struct.Struct("<QIIIIIHH16s8s40s32s")
+FLAG_CACHE_HIT = 0x1
+FULL_RATE = 1000000
+
+
+def text(field):
+    return field.split(b"\0", 1)[0].decode("utf-8", "replace")
+
+
+def read_segment(path):
+    with open(path, "rb") as f:
+        data = f.read()
+    if len(data) < HEADER.size:
+        sys.exit(f"{path}: too short for an access log segment")
+    magic, version, record_size, _, count = HEADER.unpack_from(data)
+    if magic != MAGIC or version != VERSION or record_size != RECORD.size:
+        sys.exit(f"{path}: not a version {VERSION} access log segment")
+
+    count = min(count, (len(data) - HEADER.size) // RECORD.size)
+    for i in range(count):
+        (timestamp_us, latency_us, upstream_us, bytes_in, bytes_out, sample_ppm,
+         status, flags, ip, method, route, model) = RECORD.unpack_from(data, HEADER.size + i * RECORD.size)
+        yield {
+            "ts": timestamp_us / 1e6,
+            "ip": text(ip),
+            "method": text(method),
+            "route": text(route),
+            "model": text(model),
+            "status": status,
+            "bytes_in": bytes_in,
+            "bytes_out": bytes_out,
+            "latency_ms": latency_us / 1e3,
+            "upstream_ms": upstream_us / 1e3,
+            "cache_hit": bool(flags & FLAG_CACHE_HIT),
+            "sample_rate": sample_ppm / FULL_RATE,
+        }
+
+
+def summarize(records):
+    totals = defaultdict(lambda: {"requests": 0.0, "bytes_in": 0.0, "bytes_out": 0.0,
+                                  "upstream_ms": 0.0, "cache_hits": 0.0})
+    for record in records:
+        if record["sample_rate"] <= 0:
+            continue
+        weight = 1.0 / record["sample_rate"]
+        total = totals[(record["model"], record["route"])]
+        total["requests"] += weight
+        total["bytes_in"] += record["bytes_in"] * weight
+        total["bytes_out"] += record["bytes_out"] * weight
+        total["upstream_ms"] += record["upstream_ms"] * weight
+        total["cache_hits"] += weight if record["cache_hit"] else 0.0
+
+    for (model, route), total in sorted(totals.items()):
+        yield dict({"model": model, "route": route},
+                   **{key: round(value, 3) for key, value in total.items()})
+
+
+def main():
+    args = sys.argv[1:]
+    summary = bool(args) and args[0] == "--summary"
+    paths = args[1:] if summary else args
+    if not paths:
+        sys.exit(__doc__.strip())
+
+    records = (record for path in paths for record in read_segment(path))
+    out = summarize(records) if summary else records
+    for row in out:
+        sys.stdout.write(json.dumps(row) + "\n")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,99 @@
+#!/usr/bin/env python3
+"""
+Build the binary BPE vocabulary read by src/ai/bpe.c.
+
+Input is a tiktoken rank file: one "<base64 token> <rank>" pair per line,
+as shipped for cl100k_base and as Llama 3's tokenizer.model. The output is
+mapped read-only by the server (see include/ai/bpe.h for the layout).
+
+Usage: build_bpe_vocab.py cl100k_base.tiktoken cl100k.bpe
+"""
+
+import base64
+import struct
+import sys
+
+MAGIC = b"AIBPE\0\0\0"
+VERSION = 1
+PATTERN_CL100K = 1
+HEADER = struct.Struct("<8sIIIIQQQQ")
+
+
+MASK64 = 0xFFFFFFFFFFFFFFFF
+
+
+def token_hash(data):
+    """Same as bpe_hash() in src/ai/bpe.c."""
+    h = 0x9E3779B97F4A7C15 ^ ((len(data) * 0xFF51AFD7ED558CCD) & MASK64)
+    for i in range(0, len(data), 8):
+        chunk = int.from_bytes(data[i:i + 8], "little")
+        h = ((h ^ chunk) * 0xC4CEB9FE1A85EC53) & MASK64
+        h ^= h >> 32
+    h ^= h >> 29
+    h = (h * 0xBF58476D1CE4E5B9) & MASK64
+    return h ^ (h >> 32)
+
+
+def load_ranks(path):
+    tokens = {}
+    with open(path, "rb") as f:
+        for line_number, line in enumerate(f, 1):
+            line = line.strip()
+            if not line:
+                continue
+            try:
+                token, rank = line.split()
+                tokens[int(rank)] = base64.b64decode(token)
+            except ValueError:
+                sys.exit(f"{path}:{line_number}: expected '<base64 token> <rank>'")
+
+    count = len(tokens)
+    if sorted(tokens) != list(range(count)):
+        sys.exit(f"{path}: ranks must run from 0 to {count - 1} without gaps")
+    known = set(tokens.values())
+    if len(known) != count:
+        sys.exit(f"{path}: duplicate tokens")
+    missing = [b for b in range(256) if bytes([b]) not in known]
+    if missing:
+        sys.exit(f"{path}: {len(missing)} single bytes have no token")
+    return [tokens[rank] for rank in range(count)]
+
+
+def build(tokens):
+    count = len(tokens)
+    slots = 1
+    while slots < count * 2:
+        slots *= 2
+
+    table = [0] * slots
+    for rank, token in enumerate(tokens):
+        slot = token_hash(token) & (slots - 1)
+        while table[slot]:
+            slot = (slot + 1) & (slots - 1)
+        table[slot] = rank + 1
+
+    blob = bytearray()
+    entries = bytearray()
+    for token in tokens:
+        entries += struct.pack("<II", len(blob), len(token))
+        blob += token
+
+    tokens_offset = HEADER.size
+    hash_offset = tokens_offset + len(entries)
+    bytes_offset = hash_offset + slots * 4
+    header = HEADER.pack(MAGIC, VERSION, PATTERN_CL100K, count, slots,
+                         tokens_offset, hash_offset, bytes_offset, len(blob))
+    return header + entries + struct.pack(f"<{slots}I", *table) + blob
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit(__doc__.strip())
+    tokens = load_ranks(sys.argv[1])
+    with open(sys.argv[2], "wb") as f:
+        f.write(build(tokens))
+    print(f"Wrote {len(tokens)} tokens to {sys.argv[2]}")
+
+
+if __name__ == "__main__":
+    main()